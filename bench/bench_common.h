@@ -0,0 +1,122 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+// Ölçüm araçlarının ortak yardımcıları: relay'e bağlanma, metin protokolüyle tünel kurma
+// ve relay sürecinin CPU/bellek kullanımını /proc üzerinden okuma.
+
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace bench {
+
+// Relay'e bloklayan bir TCP bağlantısı açar; hata durumunda -1 döner
+inline int connect_to_relay(const char* ip, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) return -1;
+
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    if (::connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ::close(sock);
+        return -1;
+    }
+    int one = 1;
+    ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+// '\n' ile biten tek bir satırı byte byte okur (tünel öncesi kontrol trafiği için yeterli)
+inline bool read_line(int sock, std::string& line) {
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t n = ::read(sock, &c, 1);
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+        line += c;
+    }
+}
+
+inline bool send_line(int sock, const std::string& line) {
+    std::string msg = line + "\n";
+    return ::send(sock, msg.data(), msg.size(), MSG_NOSIGNAL) == (ssize_t)msg.size();
+}
+
+// Satırın ilk kelimesi beklenen mesaj türü mü? (ör. "ID 123456" için "ID")
+inline bool expect_line(int sock, const std::string& type, std::string* arg = nullptr) {
+    std::string line;
+    if (!read_line(sock, line)) return false;
+    std::stringstream ss(line);
+    std::string word;
+    ss >> word;
+    if (word != type) return false;
+    if (arg) ss >> *arg;
+    return true;
+}
+
+/**
+ * @brief İki bağlantı arasında gerçek protokolle tünel kurar:
+ * ID -> connect -> accept -> start_vnc_tunnel (iki taraf) -> TUNNEL_ACTIVE.
+ * @param viewer Bağlanan taraf (İstemci A).
+ * @param sharer Kabul eden taraf (İstemci B).
+ */
+inline bool establish_tunnel(int viewer, int sharer) {
+    std::string viewer_id, sharer_id;
+    if (!expect_line(viewer, "ID", &viewer_id) || !expect_line(sharer, "ID", &sharer_id)) return false;
+    if (!send_line(viewer, "connect " + sharer_id)) return false;
+    if (!expect_line(viewer, "CONNECTING") || !expect_line(sharer, "INCOMING")) return false;
+    if (!send_line(sharer, "accept " + viewer_id)) return false;
+    if (!expect_line(viewer, "ACCEPTED") || !expect_line(sharer, "CONNECTION_ESTABLISHED")) return false;
+    if (!send_line(viewer, "start_vnc_tunnel") || !send_line(sharer, "start_vnc_tunnel")) return false;
+    return expect_line(viewer, "TUNNEL_ACTIVE") && expect_line(sharer, "TUNNEL_ACTIVE");
+}
+
+// Sürecin kullanıcı + çekirdek CPU süresini saniye cinsinden döner (/proc/<pid>/stat)
+inline double read_process_cpu_seconds(int pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string content;
+    std::getline(stat, content);
+    // comm alanı boşluk içerebilir; ')' sonrasından itibaren alanları say
+    size_t pos = content.rfind(')');
+    if (pos == std::string::npos) return 0;
+    std::stringstream ss(content.substr(pos + 2));
+    std::string field;
+    unsigned long utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && ss >> field; ++i) {
+        if (i == 14) utime = std::stoul(field);
+        if (i == 15) stime = std::stoul(field);
+    }
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+// /proc/<pid>/status içindeki KB cinsinden bir alanı (ör. "VmHWM:") döner
+inline long read_process_status_kb(int pid, const std::string& field) {
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string key;
+    long value = 0;
+    while (status >> key) {
+        if (key == field) { status >> value; break; }
+        status.ignore(4096, '\n');
+    }
+    return value;
+}
+
+// Sürecin o anki yerleşik bellek (VmRSS) değerini KB cinsinden döner
+inline long read_process_rss_kb(int pid) {
+    return read_process_status_kb(pid, "VmRSS:");
+}
+
+} // namespace bench
+
+#endif // BENCH_COMMON_H
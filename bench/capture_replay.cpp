@@ -0,0 +1,331 @@
+// Relay'in ('--capture-dir=') veya ajanın ('--capture=') kaydettiği tünel trafiğini inceler ve
+// yeniden oynatır; gerçek bir VNC oturumunun zamanlamasıyla relay'i ölçmeye yarar.
+//
+// Kullanım: ./capture_replay <dosya.rcap> info
+//           ./capture_replay <dosya.rcap> relay <sunucu_ip> <sunucu_port> [--speed=original|max|X] [--from=SANİYE]
+//           ./capture_replay <dosya.rcap> serve <port> [--direction=0|1] [--speed=...] [--from=SANİYE]
+//
+// info   : kaydın özetini yazar (süre, yön başına byte/kayıt, atılan veri, boşluklar).
+// relay  : relay'de bir tünel kurar; yön 0'ı bağlanan taraftan, yön 1'i kabul eden taraftan kayıttaki
+//          sırayla ve zamanlamayla gönderir (X: hız çarpanı, max: beklemeden). Her kaydın karşı uca
+//          ulaşma gecikmesi (p50/p99/en fazla), aktarım hızı ve gönderimin programın ne kadar gerisinde
+//          kaldığı raporlanır.
+// serve  : <port>'ta bir bağlantı bekler ve kaydın tek yönünü (varsayılan 0) ona oynatır; gelen
+//          veri okunup atılır. Ajanın kaydı için yön 0 yerel VNC sunucusunun çıktısıdır, yani sahte
+//          bir VNC sunucusu gibi davranır (istemcinin mesajlarına göre değil, kayda göre gönderir).
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "bench_common.h"
+#include "capture.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct ReplayOptions {
+    double speed = 1.0; // 0: beklemeden
+    uint64_t from_ns = 0;
+};
+
+// Bir yönün gönderilen kayıtları: kaydın son byte'ının akış konumu ve gönderim zamanı. Gönderen
+// thread doldurur ve published'ı artırır; okuyan thread yalnızca published'a kadar okur.
+struct SentLog {
+    std::vector<uint64_t> end_offset;
+    std::vector<Clock::time_point> sent_at;
+    std::atomic<size_t> published{0};
+};
+
+static bool send_all(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(sock, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool parse_options(int argc, char* argv[], int first, ReplayOptions* options, int* direction) {
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--speed=max") {
+                options->speed = 0;
+            } else if (arg == "--speed=original") {
+                options->speed = 1.0;
+            } else if (arg.rfind("--speed=", 0) == 0) {
+                options->speed = std::stod(arg.substr(arg.find('=') + 1));
+                if (options->speed <= 0) return false;
+            } else if (arg.rfind("--from=", 0) == 0) {
+                options->from_ns = (uint64_t)(std::stod(arg.substr(arg.find('=') + 1)) * 1e9);
+            } else if (direction && arg.rfind("--direction=", 0) == 0) {
+                *direction = std::stoi(arg.substr(arg.find('=') + 1));
+                if (*direction != 0 && *direction != 1) return false;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static int print_info(const CaptureReader& reader) {
+    uint64_t records[2] = {0, 0}, closes = 0, gaps = 0;
+    CaptureCursor cursor;
+    CaptureRecord record;
+    while (reader.next(&cursor, &record)) {
+        if (record.flags & CAPTURE_FLAG_CLOSE) closes++;
+        if (record.flags & CAPTURE_FLAG_GAP) gaps++;
+        if (record.length > 0) records[record.direction]++;
+    }
+    double seconds = reader.duration_ns() / 1e9;
+    std::cout << "Etiket                : " << reader.label() << std::endl;
+    std::cout << "Parça                 : " << reader.chunk_count() << " x " << reader.header().chunk_size / 1024
+              << " KB" << (reader.indexed() ? "" : " (dizin yok; parçalar tarandı)") << std::endl;
+    std::cout << "Süre                  : " << seconds << " s" << std::endl;
+    for (int dir = 0; dir < 2; ++dir) {
+        std::cout << "Yön " << dir << (dir == 0 ? " (a -> b)" : " (b -> a)") << "      : "
+                  << reader.total_bytes(dir) << " byte, " << records[dir] << " kayıt";
+        if (seconds > 0) std::cout << ", ort. " << reader.total_bytes(dir) / seconds / 1024 << " KB/s";
+        std::cout << std::endl;
+    }
+    std::cout << "Kapanış kaydı         : " << closes << std::endl;
+    std::cout << "Atılan veri           : "
+              << (reader.indexed() ? std::to_string(reader.dropped_bytes()) + " byte" : std::string("bilinmiyor"))
+              << " (" << gaps << " boşluk)" << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Kayıtları sırayla, zamanlamaya uyarak gönderir. socks[d] -1 ise d yönü atlanır.
+ * @param lag_ms Her kaydın programlanan zamanın ne kadar gerisinde gönderildiği (ms).
+ */
+static void replay_records(const CaptureReader& reader, const ReplayOptions& options, const int socks[2],
+                           SentLog* logs, std::vector<double>* lag_ms) {
+    CaptureCursor cursor = reader.seek(options.from_ns);
+    CaptureRecord record;
+    uint64_t offsets[2] = {0, 0};
+    uint64_t base_ns = 0;
+    bool started = false;
+    Clock::time_point start;
+    while (reader.next(&cursor, &record)) {
+        if (record.time_ns < options.from_ns || record.length == 0 || socks[record.direction] < 0) continue;
+        if (!started) {
+            started = true;
+            base_ns = record.time_ns;
+            start = Clock::now();
+        }
+        if (options.speed > 0) {
+            auto due = start + std::chrono::nanoseconds((uint64_t)((record.time_ns - base_ns) / options.speed));
+            auto now = Clock::now();
+            if (due > now) {
+                std::this_thread::sleep_until(due);
+            } else if (lag_ms) {
+                lag_ms->push_back(std::chrono::duration<double, std::milli>(now - due).count());
+            }
+        }
+        if (!send_all(socks[record.direction], record.data, record.length)) break;
+        offsets[record.direction] += record.length;
+        if (logs) {
+            SentLog& log = logs[record.direction];
+            size_t i = log.published.load(std::memory_order_relaxed);
+            log.end_offset[i] = offsets[record.direction];
+            log.sent_at[i] = Clock::now();
+            log.published.store(i + 1, std::memory_order_release);
+        }
+    }
+}
+
+static int run_relay(const CaptureReader& reader, const char* ip, int port, const ReplayOptions& options) {
+    // Yön başına gönderilecek kayıt ve byte sayısı (gönderim günlüğü önceden ayrılır)
+    SentLog logs[2];
+    uint64_t expected[2] = {0, 0};
+    {
+        size_t counts[2] = {0, 0};
+        CaptureCursor cursor = reader.seek(options.from_ns);
+        CaptureRecord record;
+        while (reader.next(&cursor, &record)) {
+            if (record.time_ns < options.from_ns || record.length == 0) continue;
+            counts[record.direction]++;
+            expected[record.direction] += record.length;
+        }
+        for (int dir = 0; dir < 2; ++dir) {
+            logs[dir].end_offset.resize(counts[dir]);
+            logs[dir].sent_at.resize(counts[dir]);
+        }
+    }
+
+    int a = bench::connect_to_relay(ip, port);
+    int b = bench::connect_to_relay(ip, port);
+    if (a < 0 || b < 0) {
+        perror("Relay'e bağlanılamadı");
+        return 1;
+    }
+    if (!bench::establish_tunnel(a, b)) {
+        std::cerr << "Hata: Tünel kurulamadı." << std::endl;
+        return 1;
+    }
+
+    // Yön 0 a'dan b'ye, yön 1 b'den a'ya gider
+    const int senders[2] = {a, b};
+    const int receivers[2] = {b, a};
+    std::vector<double> latencies[2];
+    uint64_t received[2] = {0, 0};
+    std::vector<std::thread> readers;
+    for (int dir = 0; dir < 2; ++dir) {
+        readers.emplace_back([&, dir]() {
+            std::vector<char> buffer(256 * 1024);
+            SentLog& log = logs[dir];
+            size_t next = 0;
+            while (received[dir] < expected[dir]) {
+                ssize_t n = ::read(receivers[dir], buffer.data(), buffer.size());
+                if (n <= 0) break;
+                received[dir] += n;
+                auto now = Clock::now();
+                size_t published = log.published.load(std::memory_order_acquire);
+                while (next < published && log.end_offset[next] <= received[dir]) {
+                    latencies[dir].push_back(std::chrono::duration<double, std::milli>(now - log.sent_at[next]).count());
+                    next++;
+                }
+            }
+        });
+    }
+
+    std::vector<double> lag_ms;
+    auto start = Clock::now();
+    replay_records(reader, options, senders, logs, &lag_ms);
+    auto sent = Clock::now();
+    for (auto& reader_thread : readers) reader_thread.join();
+    auto end = Clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    uint64_t total = received[0] + received[1];
+    std::cout << "Hız kipi              : "
+              << (options.speed > 0 ? std::to_string(options.speed) + "x" : std::string("max")) << std::endl;
+    std::cout << "Aktarılan veri        : " << received[0] << " + " << received[1] << " byte (beklenen "
+              << expected[0] << " + " << expected[1] << ")" << std::endl;
+    std::cout << "Süre                  : " << seconds << " s (gönderim "
+              << std::chrono::duration<double>(sent - start).count() << " s)" << std::endl;
+    if (seconds > 0) std::cout << "Hız                   : " << total / (1024.0 * 1024.0) / seconds << " MB/s" << std::endl;
+    for (int dir = 0; dir < 2; ++dir) {
+        if (latencies[dir].empty()) continue;
+        double max = *std::max_element(latencies[dir].begin(), latencies[dir].end());
+        std::cout << "Gecikme yön " << dir << "         : p50 " << std::fixed << std::setprecision(3)
+                  << percentile(latencies[dir], 0.50) << " ms, p99 " << percentile(latencies[dir], 0.99)
+                  << " ms, en fazla " << max << " ms (" << latencies[dir].size() << " kayıt)" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+    if (options.speed > 0) {
+        double max = lag_ms.empty() ? 0 : *std::max_element(lag_ms.begin(), lag_ms.end());
+        std::cout << "Programdan geri kalma : " << lag_ms.size() << " kayıt, p99 " << percentile(lag_ms, 0.99)
+                  << " ms, en fazla " << max << " ms" << std::endl;
+    }
+
+    ::close(a);
+    ::close(b);
+    return received[0] == expected[0] && received[1] == expected[1] ? 0 : 1;
+}
+
+static int run_serve(const CaptureReader& reader, int port, int direction, const ReplayOptions& options) {
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (listener < 0 || ::bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listener, 1) < 0) {
+        perror("Port dinlenemedi");
+        return 1;
+    }
+    std::cout << "Port " << port << " dinleniyor; yön " << direction << " bağlanan istemciye oynatılacak." << std::endl;
+    int sock = ::accept(listener, nullptr, nullptr);
+    ::close(listener);
+    if (sock < 0) {
+        perror("accept");
+        return 1;
+    }
+
+    // Karşı tarafın gönderdikleri okunup atılır (tamponu dolup gönderimi durdurmasın)
+    std::thread drain([sock]() {
+        char buffer[16 * 1024];
+        while (::read(sock, buffer, sizeof(buffer)) > 0) {
+        }
+    });
+
+    int socks[2] = {-1, -1};
+    socks[direction] = sock;
+    auto start = Clock::now();
+    replay_records(reader, options, socks, nullptr, nullptr);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Oynatma bitti (" << seconds << " s)." << std::endl;
+
+    ::shutdown(sock, SHUT_RDWR);
+    drain.join();
+    ::close(sock);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Kullanım: " << argv[0] << " <dosya.rcap> info" << std::endl;
+        std::cerr << "          " << argv[0]
+                  << " <dosya.rcap> relay <sunucu_ip> <sunucu_port> [--speed=original|max|X] [--from=SANİYE]" << std::endl;
+        std::cerr << "          " << argv[0]
+                  << " <dosya.rcap> serve <port> [--direction=0|1] [--speed=original|max|X] [--from=SANİYE]" << std::endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        CaptureReader reader(argv[1]);
+        std::string mode = argv[2];
+        ReplayOptions options;
+        if (mode == "info") return print_info(reader);
+
+        if (mode == "relay" && argc >= 5) {
+            if (!parse_options(argc, argv, 5, &options, nullptr)) {
+                std::cerr << "Hata: Geçersiz seçenek." << std::endl;
+                return 1;
+            }
+            return run_relay(reader, argv[3], std::stoi(argv[4]), options);
+        }
+        if (mode == "serve" && argc >= 4) {
+            int direction = 0;
+            if (!parse_options(argc, argv, 4, &options, &direction)) {
+                std::cerr << "Hata: Geçersiz seçenek." << std::endl;
+                return 1;
+            }
+            return run_serve(reader, std::stoi(argv[3]), direction, options);
+        }
+        std::cerr << "Hata: Bilinmeyen kip veya eksik argüman (" << mode << ")." << std::endl;
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Hata: " << e.what() << std::endl;
+        return 1;
+    }
+}
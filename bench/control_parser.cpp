@@ -0,0 +1,106 @@
+// Kontrol kanalı ayrıştırıcılarının saniyede işleyebildiği mesaj sayısını ölçer.
+//
+// Kullanım: ./control_parser [mesaj_sayisi] [okuma_boyutu]
+//
+// connect/accept/start_vnc_tunnel karışımı bir mesaj akışı önce eski metin protokolüyle, sonra
+// ikili çerçevelerle kodlanır ve relay'deki gibi okuma_boyutu'luk parçalar halinde komut
+// tamponuna eklenerek çözülür:
+//   metin: Satır için std::find, baştan erase, boşluk kırpma, stringstream ve tolower.
+//   ikili: Başlık tamponda yerinde çözülür; yalnızca 6 baytlık ID argümanı (SSO) kopyalanır.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+#include "control_protocol.h"
+
+static const ControlType MESSAGE_MIX[] = { CTRL_CONNECT, CTRL_ACCEPT, CTRL_START_VNC_TUNNEL };
+
+static void build_streams(size_t count, std::vector<char>* text, std::vector<char>* binary) {
+    char frame[CONTROL_HEADER_SIZE + CONTROL_MAX_PAYLOAD];
+    for (size_t i = 0; i < count; ++i) {
+        ControlType type = MESSAGE_MIX[i % 3];
+        std::string argument = (type == CTRL_START_VNC_TUNNEL) ? "" : std::to_string(100000 + i % 900000);
+
+        std::string line = control_type_text(type);
+        if (!argument.empty()) line += " " + argument;
+        line += "\n";
+        text->insert(text->end(), line.begin(), line.end());
+
+        size_t length = encode_control_frame(type, argument.data(), argument.size(), frame, sizeof(frame));
+        binary->insert(binary->end(), frame, frame + length);
+    }
+}
+
+// Eski yol: server.cpp'deki metin döngüsünün aynısı
+static size_t run_text(const std::vector<char>& stream, size_t read_size, size_t* checksum) {
+    std::vector<char> buffer;
+    std::string line;
+    TextCommand command;
+    size_t messages = 0;
+    for (size_t offset = 0; offset < stream.size(); offset += read_size) {
+        size_t len = std::min(read_size, stream.size() - offset);
+        buffer.insert(buffer.end(), stream.data() + offset, stream.data() + offset + len);
+        while (extract_text_line(buffer, &line)) {
+            if (line.empty()) continue;
+            ControlType type;
+            if (parse_text_command(line, &command, &type)) {
+                *checksum += type + command.argument.size();
+                ++messages;
+            }
+        }
+    }
+    return messages;
+}
+
+// Yeni yol: server.cpp'deki ikili döngünün aynısı
+static size_t run_binary(const std::vector<char>& stream, size_t read_size, size_t* checksum) {
+    std::vector<char> buffer;
+    size_t messages = 0;
+    for (size_t offset = 0; offset < stream.size(); offset += read_size) {
+        size_t len = std::min(read_size, stream.size() - offset);
+        buffer.insert(buffer.end(), stream.data() + offset, stream.data() + offset + len);
+        while (true) {
+            ControlFrame frame;
+            ssize_t used = parse_control_frame(buffer.data(), buffer.size(), &frame);
+            if (used <= 0) break;
+            std::string argument(frame.payload, frame.length);
+            *checksum += frame.type + argument.size();
+            buffer.erase(buffer.begin(), buffer.begin() + used);
+            ++messages;
+        }
+    }
+    return messages;
+}
+
+template <typename Fn>
+static void report(const char* name, size_t stream_bytes, Fn&& fn) {
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    size_t messages = fn(&checksum);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << messages << " mesaj, " << stream_bytes << " byte, "
+              << (messages / seconds) / 1e6 << " M mesaj/s (sağlama: " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = 3000000, read_size = 4096;
+    try {
+        if (argc > 1) count = std::stoul(argv[1]);
+        if (argc > 2) read_size = std::stoul(argv[2]);
+    } catch (const std::exception& e) {
+        std::cerr << "Hata: Geçersiz sayısal argüman. " << e.what() << std::endl;
+        return 1;
+    }
+    if (read_size == 0) read_size = 1;
+
+    std::vector<char> text, binary;
+    build_streams(count, &text, &binary);
+
+    report("metin", text.size(), [&](size_t* checksum) { return run_text(text, read_size, checksum); });
+    report("ikili", binary.size(), [&](size_t* checksum) { return run_binary(binary, read_size, checksum); });
+    return 0;
+}
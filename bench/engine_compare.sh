@@ -0,0 +1,22 @@
+#!/bin/sh
+# G/Ç motorlarını loopback üzerinde 1, 100 ve 1000 eşzamanlı tünelde karşılaştırır.
+#
+# Kullanım: ./engine_compare.sh [sure_saniye] [port]
+# Sunucu ikilisi (../program) önceden 'make' ile derlenmiş olmalıdır.
+
+DURATION=${1:-5}
+PORT=${2:-23500}
+SERVER=../program
+
+for tunnels in 1 100 1000; do
+    for engine in "--engine=epoll" "--engine=epoll --no-splice" "--engine=io_uring"; do
+        echo "=== $tunnels tünel, $engine ==="
+        $SERVER $PORT $engine > /dev/null 2>&1 &
+        pid=$!
+        sleep 0.5
+        ./multi_tunnel_throughput 127.0.0.1 $PORT $tunnels $DURATION $pid
+        kill $pid
+        wait $pid 2> /dev/null
+        PORT=$((PORT + 1))
+    done
+done
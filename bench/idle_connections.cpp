@@ -0,0 +1,131 @@
+// Boşta bekleyen bağlantı başına relay belleğini ve saniyedeki bağlantı sayısını ölçer.
+//
+// Kullanım: ./idle_connections <sunucu_ip> <sunucu_port> <baglanti_sayisi> <sunucu_pid>
+//
+// Her bağlantı, sunucudan "ID <id>" satırı gelene kadar tamamlanmış sayılmaz; böylece ölçülen
+// hız kabul + kayıt + ID gönderimi zincirinin tamamını kapsar. Bellek, /proc/<pid>/status
+// üzerinden bağlantılar açılmadan önce ve sonra okunur.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <stdexcept>
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+struct ProcessMemory {
+    long vm_rss_kb = 0;
+    long vm_size_kb = 0;
+    long threads = 0;
+};
+
+// /proc/<pid>/status dosyasından bellek ve thread bilgilerini okur
+static ProcessMemory read_process_memory(int pid) {
+    ProcessMemory mem;
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "VmRSS:") status >> mem.vm_rss_kb;
+        else if (key == "VmSize:") status >> mem.vm_size_kb;
+        else if (key == "Threads:") status >> mem.threads;
+        status.ignore(4096, '\n');
+    }
+    return mem;
+}
+
+// Sunucudan ilk satırı ("ID ...") okuyana kadar bekler
+static bool wait_for_id_line(int sock) {
+    char c;
+    while (true) {
+        ssize_t n = ::read(sock, &c, 1);
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port> <baglanti_sayisi> <sunucu_pid>" << std::endl;
+        return 1;
+    }
+
+    const char* server_ip = argv[1];
+    int server_port = 0, connection_count = 0, server_pid = 0;
+    try {
+        server_port = std::stoi(argv[2]);
+        connection_count = std::stoi(argv[3]);
+        server_pid = std::stoi(argv[4]);
+    } catch (const std::exception& e) {
+        std::cerr << "Hata: Geçersiz sayısal argüman. " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Çok sayıda soket açabilmek için dosya tanımlayıcı sınırını yükselt
+    struct rlimit rl;
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(server_port);
+    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
+        std::cerr << "Hata: Geçersiz adres: " << server_ip << std::endl;
+        return 1;
+    }
+
+    ProcessMemory before = read_process_memory(server_pid);
+
+    std::vector<int> sockets;
+    sockets.reserve(connection_count);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < connection_count; ++i) {
+        int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0) { perror("socket"); break; }
+        if (::connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+            perror("connect");
+            ::close(sock);
+            break;
+        }
+        if (!wait_for_id_line(sock)) {
+            std::cerr << "Hata: Sunucudan ID alınamadı (bağlantı " << i << ")" << std::endl;
+            ::close(sock);
+            break;
+        }
+        sockets.push_back(sock);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    // Sunucunun kalan log çıktısını bitirmesi için kısa bir süre bekle
+    ::usleep(500 * 1000);
+    ProcessMemory after = read_process_memory(server_pid);
+
+    size_t opened = sockets.size();
+    std::cout << "Açılan bağlantı      : " << opened << std::endl;
+    std::cout << "Süre                 : " << seconds << " s" << std::endl;
+    if (seconds > 0) {
+        std::cout << "Bağlantı/saniye      : " << (opened / seconds) << std::endl;
+    }
+    std::cout << "Sunucu thread sayısı : " << before.threads << " -> " << after.threads << std::endl;
+    std::cout << "Sunucu VmRSS (KB)    : " << before.vm_rss_kb << " -> " << after.vm_rss_kb << std::endl;
+    std::cout << "Sunucu VmSize (KB)   : " << before.vm_size_kb << " -> " << after.vm_size_kb << std::endl;
+    if (opened > 0) {
+        std::cout << "Bağlantı başına RSS  : " << (double)(after.vm_rss_kb - before.vm_rss_kb) * 1024 / opened << " byte" << std::endl;
+        std::cout << "Bağlantı başına VSZ  : " << (double)(after.vm_size_kb - before.vm_size_kb) * 1024 / opened << " byte" << std::endl;
+    }
+
+    for (int sock : sockets) {
+        ::close(sock);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Çok sayıda eşzamanlı tünelden geçen toplam trafiğin hızını ve relay'in GB başına CPU
+// maliyetini ölçer. G/Ç motorlarını (epoll + splice, epoll + kopyalama, io_uring) aynı yük
+// altında karşılaştırmak için kullanılır; bkz. engine_compare.sh.
+//
+// Kullanım: ./multi_tunnel_throughput <sunucu_ip> <sunucu_port> <tunel_sayisi> <sure_saniye> <sunucu_pid>
+//
+// Tüneller gerçek protokolle kurulur. Ardından tek bir epoll döngüsü tüm paylaşan (sharer) uçlara
+// 16 KB'lık parçalar yazar ve tüm görüntüleyen (viewer) uçlardan okur.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+#include <cerrno>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "bench_common.h"
+
+static const size_t CHUNK_SIZE = 16 * 1024;
+
+static void set_nonblocking(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// Sürecin tüm thread'lerinin gönüllü bağlam değişimi toplamı (/proc/<pid>/task/<tid>/status)
+static long read_voluntary_switches(int pid) {
+    std::string task_dir = "/proc/" + std::to_string(pid) + "/task";
+    DIR* dir = ::opendir(task_dir.c_str());
+    if (!dir) return 0;
+    long total = 0;
+    while (struct dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        std::ifstream status(task_dir + "/" + entry->d_name + "/status");
+        std::string key;
+        while (status >> key) {
+            if (key == "voluntary_ctxt_switches:") {
+                long value = 0;
+                status >> value;
+                total += value;
+                break;
+            }
+            status.ignore(4096, '\n');
+        }
+    }
+    ::closedir(dir);
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6) {
+        std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port> <tunel_sayisi> <sure_saniye> <sunucu_pid>" << std::endl;
+        return 1;
+    }
+
+    int server_port = 0, tunnel_count = 0, duration = 0, server_pid = 0;
+    try {
+        server_port = std::stoi(argv[2]);
+        tunnel_count = std::stoi(argv[3]);
+        duration = std::stoi(argv[4]);
+        server_pid = std::stoi(argv[5]);
+    } catch (const std::exception& e) {
+        std::cerr << "Hata: Geçersiz sayısal argüman. " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Her tünel bu süreçte iki soket kullanır
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    std::vector<int> viewers, sharers;
+    for (int i = 0; i < tunnel_count; ++i) {
+        int viewer = bench::connect_to_relay(argv[1], server_port);
+        int sharer = bench::connect_to_relay(argv[1], server_port);
+        if (viewer < 0 || sharer < 0) {
+            perror("Relay'e bağlanılamadı");
+            return 1;
+        }
+        if (!bench::establish_tunnel(viewer, sharer)) {
+            std::cerr << "Hata: " << i << ". tünel kurulamadı." << std::endl;
+            return 1;
+        }
+        viewers.push_back(viewer);
+        sharers.push_back(sharer);
+    }
+
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    for (int i = 0; i < tunnel_count; ++i) {
+        set_nonblocking(viewers[i]);
+        set_nonblocking(sharers[i]);
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = (uint64_t)i << 1;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, viewers[i], &ev);
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.u64 = ((uint64_t)i << 1) | 1;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sharers[i], &ev);
+    }
+
+    std::vector<char> chunk(CHUNK_SIZE, 'x');
+    std::vector<char> sink(256 * 1024);
+    std::vector<struct epoll_event> events(1024);
+    unsigned long long received = 0;
+
+    double cpu_before = bench::read_process_cpu_seconds(server_pid);
+    long switches_before = read_voluntary_switches(server_pid);
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(duration);
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        int n = ::epoll_wait(epoll_fd, events.data(), (int)events.size(), 100);
+        for (int e = 0; e < n; ++e) {
+            int index = (int)(events[e].data.u64 >> 1);
+            bool is_sharer = events[e].data.u64 & 1;
+            if (is_sharer) {
+                while (::send(sharers[index], chunk.data(), chunk.size(), MSG_NOSIGNAL) > 0) {}
+            } else {
+                ssize_t got;
+                while ((got = ::read(viewers[index], sink.data(), sink.size())) > 0) received += got;
+            }
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double cpu_after = bench::read_process_cpu_seconds(server_pid);
+    long switches_after = read_voluntary_switches(server_pid);
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double gigabytes = (double)received / (1024.0 * 1024.0 * 1024.0);
+
+    std::cout << "Tünel sayısı          : " << tunnel_count << std::endl;
+    std::cout << "Aktarılan veri        : " << received / (1024 * 1024) << " MB" << std::endl;
+    std::cout << "Toplam hız            : " << (received / (1024.0 * 1024.0)) / seconds << " MB/s" << std::endl;
+    std::cout << "Relay CPU             : " << (cpu_after - cpu_before) << " s" << std::endl;
+    if (gigabytes > 0) {
+        std::cout << "Relay CPU / GB        : " << (cpu_after - cpu_before) / gigabytes << " s" << std::endl;
+    }
+    std::cout << "Relay bağlam değişimi : " << (switches_after - switches_before) << std::endl;
+
+    ::close(epoll_fd);
+    for (int i = 0; i < tunnel_count; ++i) {
+        ::close(viewers[i]);
+        ::close(sharers[i]);
+    }
+    return 0;
+}
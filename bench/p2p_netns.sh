@@ -0,0 +1,92 @@
+#!/bin/sh
+# Doğrudan bağlantıyı (UDP hole punching) ve relay'e geri dönüşü, ağ ad alanlarıyla (network
+# namespace) kurulan iki NAT'ın arkasındaki iki ajanla yerel olarak dener. root ve iptables gerekir.
+#
+# Kullanım: sudo ./p2p_netns.sh [cone|symmetric|blocked] [megabyte]
+#   cone      : İki NAT da kaynak portunu korur (MASQUERADE); hole punching başarılı olmalı.
+#   symmetric : NAT her hedef için rastgele port seçer (MASQUERADE --random-fully); gözlenen adres
+#               eşe giden paketlerde kullanılmadığından hole punching başarısız olur, relay kullanılır.
+#   blocked   : A tarafının NAT'ı UDP'yi tamamen engeller; relay kullanılır.
+#
+# Topoloji (203.0.113.0/24 "internet" ağı wr_wan içindeki bir köprüdür):
+#   wr_a 192.168.1.2 -- wr_nata 192.168.1.1 / 203.0.113.2 --+
+#   wr_b 192.168.2.2 -- wr_natb 192.168.2.1 / 203.0.113.3 --+-- wr_wan (köprü) -- wr_relay 203.0.113.1
+# Sunucu ikilisi (../program) ve p2p_probe önceden derlenmiş olmalıdır.
+
+SCENARIO=${1:-cone}
+MEGABYTES=${2:-32}
+PORT=12345
+UDP_PORT=3478
+NAMESPACES="wr_a wr_b wr_nata wr_natb wr_wan wr_relay"
+
+cleanup() {
+    [ -n "$RELAY_PID" ] && kill "$RELAY_PID" 2> /dev/null
+    for ns in $NAMESPACES; do ip netns del $ns 2> /dev/null; done
+    rm -f /tmp/wr_p2p_id
+}
+trap cleanup EXIT INT TERM
+
+case "$SCENARIO" in
+    cone|symmetric|blocked) ;;
+    *) echo "Bilinmeyen senaryo: $SCENARIO"; exit 1 ;;
+esac
+command -v iptables > /dev/null || { echo "iptables bulunamadı"; exit 1; }
+
+cleanup
+for ns in $NAMESPACES; do
+    ip netns add $ns
+    ip -n $ns link set lo up
+done
+
+# İnternet: köprü ve relay
+ip -n wr_wan link add br0 type bridge
+ip -n wr_wan link set br0 up
+link_wan() { # <ad alanı> <adres>
+    ip link add wan0 netns $1 type veth peer name "p_$1" netns wr_wan
+    ip -n wr_wan link set "p_$1" master br0 up
+    ip -n $1 addr add $2/24 dev wan0
+    ip -n $1 link set wan0 up
+}
+link_wan wr_relay 203.0.113.1
+link_wan wr_nata 203.0.113.2
+link_wan wr_natb 203.0.113.3
+
+# Ev ağları: ajan -> NAT
+link_lan() { # <ajan> <nat> <ağ>
+    ip link add lan0 netns $2 type veth peer name eth0 netns $1
+    ip -n $2 addr add $3.1/24 dev lan0
+    ip -n $2 link set lan0 up
+    ip -n $1 addr add $3.2/24 dev eth0
+    ip -n $1 link set eth0 up
+    ip -n $1 route add default via $3.1
+    ip netns exec $2 sysctl -qw net.ipv4.ip_forward=1
+}
+link_lan wr_a wr_nata 192.168.1
+link_lan wr_b wr_natb 192.168.2
+
+for nat in wr_nata wr_natb; do
+    if [ "$SCENARIO" = symmetric ]; then
+        ip netns exec $nat iptables -t nat -A POSTROUTING -o wan0 -j MASQUERADE --random-fully
+    else
+        ip netns exec $nat iptables -t nat -A POSTROUTING -o wan0 -j MASQUERADE
+    fi
+    # Bağlantı izleme: içeriye yalnızca içeriden başlatılmış akışların yanıtları girer
+    ip netns exec $nat iptables -A FORWARD -i lan0 -j ACCEPT
+    ip netns exec $nat iptables -A FORWARD -m conntrack --ctstate ESTABLISHED,RELATED -j ACCEPT
+    ip netns exec $nat iptables -P FORWARD DROP
+done
+if [ "$SCENARIO" = blocked ]; then
+    ip netns exec wr_nata iptables -I FORWARD -p udp -j DROP
+fi
+
+ip netns exec wr_relay ../program $PORT --rendezvous-port=$UDP_PORT --workers=1 > /tmp/wr_p2p_relay.log 2>&1 &
+RELAY_PID=$!
+sleep 0.5
+
+echo "=== $SCENARIO NAT, $MEGABYTES MB (B -> A) ==="
+ip netns exec wr_a ./p2p_probe 203.0.113.1 $PORT --id-file=/tmp/wr_p2p_id &
+RECEIVER_PID=$!
+while [ ! -s /tmp/wr_p2p_id ]; do sleep 0.1; done
+ip netns exec wr_b ./p2p_probe 203.0.113.1 $PORT --peer="$(cat /tmp/wr_p2p_id)" --megabytes=$MEGABYTES
+wait $RECEIVER_PID
+grep -h "doğrudan" /tmp/wr_p2p_relay.log
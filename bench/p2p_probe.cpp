@@ -0,0 +1,407 @@
+// Doğrudan (eşler arası) bağlantı için örnek ajan: buluşma, UDP hole punching, UDP üzerinde
+// güvenilir akış ve relay tüneline geri dönüş.
+//
+// Kullanım: ./p2p_probe <sunucu_ip> <sunucu_port> [seçenekler]
+//   --peer=ID            Bu ID'ye bağlan ve veriyi gönder; verilmezse gelen isteği kabul edip alır
+//   --id-file=YOL        Alan taraf ID'sini bu dosyaya yazar (betiklerin eşleştirmesi için)
+//   --megabytes=N        Gönderilecek veri (varsayılan 16)
+//   --punch-timeout=MS   Buluşma + hole punching için süre (varsayılan 3000)
+//   --loss=P             Giden veri paketlerinin P oranını bilerek düşürür (0..1; yeniden gönderim testi)
+//   --force-relay        Adaylar geldikten sonra doğrudan yolu denemeden relay'e döner
+//
+// Akış ve doğrudan yolun paket biçimi için bkz. p2p_link.h (ajanın '--p2p' seçeneği aynı modülü
+// kullanır). Hole punching süresinde başarılamazsa, eş P2P_FALLBACK alırsa ya da doğrudan yol
+// aktarım sırasında 3 sn sessiz kalırsa iki taraf start_vnc_tunnel ile relay tüneline geçer;
+// gönderen, alanın onayladığı konumdan devam eder ([konum: 8 byte][toplam: 8 byte] başlığıyla),
+// yani veri akışı kesintisiz sürer. Rapor: kullanılan yol, hole punching süresi, hız, yeniden
+// gönderimler.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "bench_common.h"
+#include "p2p_link.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string ip;
+    int port = 0;
+    std::string peer;
+    std::string id_file;
+    size_t megabytes = 16;
+    int punch_timeout_ms = 3000;
+    double loss = 0;
+    bool force_relay = false;
+};
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static uint8_t pattern_byte(uint64_t offset) { return (uint8_t)(offset % 251); }
+
+static void put32(char* p, uint32_t v) {
+    p[0] = (char)(v >> 24); p[1] = (char)(v >> 16); p[2] = (char)(v >> 8); p[3] = (char)v;
+}
+static uint32_t get32(const char* p) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+    return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+}
+static void put64(char* p, uint64_t v) { put32(p, (uint32_t)(v >> 32)); put32(p + 4, (uint32_t)v); }
+static uint64_t get64(const char* p) { return (uint64_t)get32(p) << 32 | get32(p + 4); }
+
+/**
+ * @brief Kontrol bağlantısı. Kontrol satırları kendi tamponundan
+ * okunur; tünel açıldıktan sonra tamponda kalanlar tünel verisidir.
+ */
+struct Agent {
+    int control = -1;
+    std::string id;
+    std::string input;
+    bool control_closed = false;
+
+    // Tamponda tam satır varsa çıkarır
+    bool take_line(std::string* line) {
+        size_t newline = input.find('\n');
+        if (newline == std::string::npos) return false;
+        line->assign(input, 0, newline);
+        input.erase(0, newline + 1);
+        return true;
+    }
+
+    // Kontrol soketinden okunabilir olanı tampona alır (bloklamaz)
+    void pump_control() {
+        char buffer[4096];
+        while (true) {
+            ssize_t n = ::recv(control, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0) {
+                input.append(buffer, n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) control_closed = true;
+            return;
+        }
+    }
+
+    // Türü type olan satırı timeout_ms içinde bekler; araya giren diğer satırlar atlanır
+    bool wait_line(const std::string& type, std::string* rest, int timeout_ms) {
+        int64_t deadline = now_ms() + timeout_ms;
+        std::string line;
+        while (true) {
+            while (take_line(&line)) {
+                std::string word = line.substr(0, line.find(' '));
+                if (word == "ERROR") std::cerr << "Relay: " << line << std::endl;
+                if (word != type) continue;
+                if (rest) *rest = line.size() > word.size() ? line.substr(word.size() + 1) : "";
+                return true;
+            }
+            int remaining = (int)(deadline - now_ms());
+            if (remaining <= 0 || control_closed) return false;
+            struct pollfd pfd = {control, POLLIN, 0};
+            if (::poll(&pfd, 1, remaining) > 0) pump_control();
+        }
+    }
+};
+
+struct Result {
+    bool direct = false;
+    int64_t punch_ms = -1;
+    uint64_t direct_bytes = 0;
+    uint64_t relay_bytes = 0;
+    uint64_t retransmits = 0;
+    double srtt_ms = 0;
+    double seconds = 0;
+};
+
+/**
+ * @brief Buluşma ve hole punching. Başarılıysa puncher.peer() doğrudan yolun adresidir.
+ * @return false: relay'e dönülmeli (kendi kararı ise p2p_result relay gönderilmiştir).
+ */
+static bool punch(Agent& agent, HolePuncher& puncher, const Options& options, Result* result) {
+    int64_t start = now_ms();
+    int64_t deadline = start + options.punch_timeout_ms;
+    bench::send_line(agent.control, "p2p " + puncher.local_candidate(agent.control));
+
+    std::string bind;
+    if (!agent.wait_line("P2P_BIND", &bind, options.punch_timeout_ms) || !puncher.on_bind(options.ip, bind)) return false;
+
+    std::string line;
+    while (now_ms() < deadline && !agent.control_closed) {
+        // Kontrol kanalı: adaylar veya eşin relay'e dönüşü
+        while (agent.take_line(&line)) {
+            std::string word = line.substr(0, line.find(' '));
+            if (word == "P2P_FALLBACK") return false;
+            if (word == "P2P_CANDIDATES") puncher.on_candidates(line.substr(word.size() + 1));
+        }
+        if (puncher.has_candidates() && options.force_relay) break;
+
+        puncher.on_timer();
+        struct pollfd pfds[2] = {{agent.control, POLLIN, 0}, {puncher.fd(), POLLIN, 0}};
+        int timeout = (int)std::max<int64_t>(0, std::min<int64_t>(puncher.timeout_ms(), deadline - now_ms()));
+        if (::poll(pfds, 2, timeout) <= 0) continue;
+        if (pfds[0].revents) agent.pump_control();
+        if (pfds[1].revents && puncher.on_readable()) break;
+    }
+    if (!puncher.punched()) {
+        bench::send_line(agent.control, "p2p_result relay");
+        return false;
+    }
+    result->punch_ms = now_ms() - start;
+    bench::send_line(agent.control, "p2p_result direct");
+    return true;
+}
+
+// Eş P2P_FALLBACK gönderdi mi?
+static bool peer_fell_back(Agent& agent) {
+    std::string line;
+    size_t at = agent.input.find("P2P_FALLBACK");
+    if (at == std::string::npos) return false;
+    while (agent.take_line(&line) && line.rfind("P2P_FALLBACK", 0) != 0) {
+    }
+    return true;
+}
+
+// Akışı ve kontrol bağlantısını en fazla timeout_ms bekler
+static void wait_stream(Agent& agent, UdpStream& stream, int fd, int timeout_ms) {
+    stream.on_timer();
+    struct pollfd pfds[2] = {{fd, POLLIN, 0}, {agent.control, POLLIN, 0}};
+    if (::poll(pfds, 2, std::min(stream.timeout_ms(), timeout_ms)) <= 0) return;
+    if (pfds[0].revents) stream.on_readable();
+    if (pfds[1].revents) agent.pump_control();
+}
+
+/**
+ * @brief Doğrudan yoldan test desenini gönderir.
+ * @return Eşin onayladığı byte; doğrudan yol koptuysa total'dan az.
+ */
+static uint64_t send_direct(Agent& agent, HolePuncher& puncher, const Options& options, uint64_t total, Result* result) {
+    UdpStream stream(puncher.fd(), puncher.peer(), puncher.key(), agent.id);
+    stream.set_drop_rate(options.loss);
+    std::vector<char> chunk(64 * 1024);
+    uint64_t written = 0;
+    while (!stream.flushed() && !stream.broken() && !peer_fell_back(agent) && !agent.control_closed) {
+        while (written < total && stream.writable() > 0) {
+            size_t n = (size_t)std::min<uint64_t>({chunk.size(), stream.writable(), total - written});
+            for (size_t i = 0; i < n; ++i) chunk[i] = (char)pattern_byte(written + i);
+            written += stream.write(chunk.data(), n);
+        }
+        if (written == total) stream.finish();
+        wait_stream(agent, stream, puncher.fd(), 20);
+    }
+    result->retransmits = stream.retransmits();
+    result->srtt_ms = stream.srtt_ms();
+    return stream.flushed() ? total : stream.bytes_acked();
+}
+
+/**
+ * @brief Doğrudan yoldan deseni alır ve doğrular.
+ * @return Sırayla alınıp doğrulanan byte; gönderen akışı bitirdiyse *done true. Veri bozuksa -1.
+ */
+static int64_t receive_direct(Agent& agent, HolePuncher& puncher, bool* done, uint64_t* total,
+                              Clock::time_point* finished) {
+    UdpStream stream(puncher.fd(), puncher.peer(), puncher.key(), agent.id);
+    std::vector<char> chunk(64 * 1024);
+    uint64_t delivered = 0;
+    int64_t linger_until = 0;
+    *done = false;
+    while (true) {
+        if (*done && now_ms() >= linger_until) break;
+        if (!*done && (stream.broken() || peer_fell_back(agent) || agent.control_closed)) break;
+        wait_stream(agent, stream, puncher.fd(), 20);
+        while (stream.readable() > 0) {
+            size_t n = stream.read(chunk.data(), chunk.size());
+            for (size_t i = 0; i < n; ++i) {
+                if ((uint8_t)chunk[i] != pattern_byte(delivered + i)) return -1;
+            }
+            delivered += n;
+        }
+        if (stream.peer_finished() && !*done) {
+            // Bitiş onayı kaybolursa gönderen FIN'i yineler; bir süre daha yanıtlanır
+            *done = true;
+            *total = delivered;
+            *finished = Clock::now();
+            linger_until = now_ms() + 1000;
+        }
+    }
+    return (int64_t)delivered;
+}
+
+// Relay tünelini açar (start_vnc_tunnel -> TUNNEL_ACTIVE); tamponda kalanlar tünel verisidir
+static bool open_relay_tunnel(Agent& agent) {
+    bench::send_line(agent.control, "start_vnc_tunnel");
+    return agent.wait_line("TUNNEL_ACTIVE", nullptr, 30000);
+}
+
+static bool send_all(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(sock, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Relay tüneli: [konum: 8][toplam: 8] başlığından sonra konumdan itibaren veri
+static bool send_relay(Agent& agent, uint64_t offset, uint64_t total) {
+    char header[16];
+    put64(header, offset);
+    put64(header + 8, total);
+    if (!send_all(agent.control, header, sizeof(header))) return false;
+    std::vector<char> chunk(256 * 1024);
+    while (offset < total) {
+        size_t n = (size_t)std::min<uint64_t>(chunk.size(), total - offset);
+        for (size_t i = 0; i < n; ++i) chunk[i] = (char)pattern_byte(offset + i);
+        if (!send_all(agent.control, chunk.data(), n)) return false;
+        offset += n;
+    }
+    // Alan taraf kapatana kadar beklenir; erken kapatma bekleyen veriyi relay'de kesebilir
+    char c;
+    return ::recv(agent.control, &c, 1, 0) >= 0;
+}
+
+static bool receive_relay(Agent& agent, uint64_t delivered, uint64_t* total) {
+    std::string& data = agent.input;
+    std::vector<char> buffer(256 * 1024);
+    auto fill = [&](size_t want) {
+        while (data.size() < want) {
+            ssize_t n = ::recv(agent.control, buffer.data(), buffer.size(), 0);
+            if (n <= 0) return false;
+            data.append(buffer.data(), n);
+        }
+        return true;
+    };
+    if (!fill(16)) return false;
+    uint64_t offset = get64(data.data());
+    *total = get64(data.data() + 8);
+    data.erase(0, 16);
+    if (offset > delivered) return false;
+    uint64_t position = offset; // delivered'a kadar olan kısım doğrudan yoldan zaten alındı
+    while (position < *total) {
+        if (data.empty() && !fill(1)) return false;
+        for (size_t i = 0; i < data.size(); ++i, ++position) {
+            if ((uint8_t)data[i] != pattern_byte(position)) return false;
+        }
+        data.clear();
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port> [--peer=ID] [--id-file=YOL] "
+                  << "[--megabytes=N] [--punch-timeout=MS] [--loss=P] [--force-relay]" << std::endl;
+        return 1;
+    }
+    Options options;
+    options.ip = argv[1];
+    options.port = atoi(argv[2]);
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find('=') + 1);
+        if (arg.rfind("--peer=", 0) == 0) options.peer = value;
+        else if (arg.rfind("--id-file=", 0) == 0) options.id_file = value;
+        else if (arg.rfind("--megabytes=", 0) == 0) options.megabytes = std::stoul(value);
+        else if (arg.rfind("--punch-timeout=", 0) == 0) options.punch_timeout_ms = std::stoi(value);
+        else if (arg.rfind("--loss=", 0) == 0) options.loss = std::stod(value);
+        else if (arg == "--force-relay") options.force_relay = true;
+        else {
+            std::cerr << "Bilinmeyen seçenek: " << arg << std::endl;
+            return 1;
+        }
+    }
+    const bool sender = !options.peer.empty();
+
+    Agent agent;
+    agent.control = bench::connect_to_relay(options.ip.c_str(), options.port);
+    if (agent.control < 0) {
+        std::cerr << "Relay'e bağlanılamadı" << std::endl;
+        return 1;
+    }
+    if (!agent.wait_line("ID", &agent.id, 5000)) return 1;
+    if (sender) {
+        bench::send_line(agent.control, "connect " + options.peer);
+        if (!agent.wait_line("ACCEPTED", nullptr, 30000)) {
+            std::cerr << "Bağlantı kabul edilmedi" << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << "ID " << agent.id << std::endl;
+        if (!options.id_file.empty()) std::ofstream(options.id_file) << agent.id << std::endl;
+        std::string requester;
+        if (!agent.wait_line("INCOMING", &requester, 600000)) return 1;
+        bench::send_line(agent.control, "accept " + requester);
+        if (!agent.wait_line("CONNECTION_ESTABLISHED", nullptr, 5000)) return 1;
+    }
+
+    std::unique_ptr<HolePuncher> puncher;
+    try {
+        puncher.reset(new HolePuncher(agent.id));
+    } catch (const std::exception& e) {
+        std::cerr << "UDP soketi açılamadı: " << e.what() << std::endl;
+        return 1;
+    }
+
+    Result result;
+    const uint64_t total_bytes = (uint64_t)options.megabytes * 1024 * 1024;
+    uint64_t total = sender ? total_bytes : 0;
+    Clock::time_point start = Clock::now();
+    bool ok = true;
+    result.direct = punch(agent, *puncher, options, &result);
+    start = Clock::now();
+
+    if (sender) {
+        uint64_t acked = result.direct ? send_direct(agent, *puncher, options, total, &result) : 0;
+        result.direct_bytes = acked;
+        if (acked < total) {
+            if (result.direct) bench::send_line(agent.control, "p2p_result relay");
+            ok = open_relay_tunnel(agent) && send_relay(agent, acked, total);
+            result.relay_bytes = total - acked;
+        }
+    } else {
+        bool done = false;
+        Clock::time_point finished;
+        int64_t delivered = result.direct ? receive_direct(agent, *puncher, &done, &total, &finished) : 0;
+        if (delivered < 0) {
+            std::cerr << "Doğrudan yoldan bozuk veri alındı" << std::endl;
+            return 1;
+        }
+        result.direct_bytes = delivered;
+        if (!done) {
+            if (result.direct) bench::send_line(agent.control, "p2p_result relay");
+            ok = open_relay_tunnel(agent) && receive_relay(agent, delivered, &total);
+            result.relay_bytes = total - delivered;
+            finished = Clock::now();
+        }
+        result.seconds = std::chrono::duration<double>(finished - start).count();
+    }
+    if (sender) result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ::close(agent.control);
+
+    if (!ok) {
+        std::cerr << "Relay tüneli üzerinden aktarım başarısız" << std::endl;
+        return 1;
+    }
+    printf("%s: yol %s", sender ? "gönderen" : "alan",
+           result.direct ? (result.relay_bytes ? "doğrudan -> relay" : "doğrudan") : "relay");
+    if (result.direct) printf(" (eş %s, hole punching %lld ms)", format_udp_address(puncher->peer()).c_str(), (long long)result.punch_ms);
+    printf(" | doğrudan %.1f MB, relay %.1f MB, %.2f sn, %.1f MB/s", result.direct_bytes / 1048576.0,
+           result.relay_bytes / 1048576.0, result.seconds, (result.direct_bytes + result.relay_bytes) / 1048576.0 / result.seconds);
+    if (sender && result.direct) printf(" | yeniden gönderim %lu, srtt %.2f ms", (unsigned long)result.retransmits, result.srtt_ms);
+    printf("\n");
+    return 0;
+}
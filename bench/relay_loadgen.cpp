@@ -0,0 +1,590 @@
+// Relay'e karşı binlerce sentetik ajan (paylaşan + görüntüleyen çiftleri) çalıştıran yük üreteci.
+//
+// Kullanım: ./relay_loadgen <sunucu_ip> <sunucu_port> [seçenekler]
+//   --agents=N          Toplam ajan sayısı; N/2 tünel kurulur (varsayılan 1000)
+//   --duration=S        Trafik süresi, saniye (varsayılan 10)
+//   --pattern=P         frames | interactive | stream (varsayılan frames)
+//   --frame-bytes=B     Kare başına ekran güncellemesi boyutu
+//   --fps=F             Tünel başına saniyedeki kare sayısı
+//   --input-rate=R      Görüntüleyen başına saniyedeki giriş olayı (6 byte PointerEvent)
+//   --connect-rate=R    Saniyede açılan en fazla tünel (0: sınırsız, varsayılan)
+//   --inflight=N        Thread başına aynı anda süren en fazla el sıkışma (varsayılan 256)
+//   --threads=T         Yük üreten thread sayısı (varsayılan 1)
+//   --pid=PID           Relay süreci; verilirse RSS ve CPU raporlanır
+//   --sharer-port=P     Paylaşanlar aynı IP'de bu porttaki relay'e bağlanır (relay kümesinde
+//                       düğümler arası tüneller; görüntüleyenler <sunucu_port>'a bağlanır)
+//
+// Her ajan gerçek metin protokolünü konuşur: ID -> connect -> INCOMING/accept -> ACCEPTED /
+// CONNECTION_ESTABLISHED -> start_vnc_tunnel -> TUNNEL_ACTIVE. El sıkışmalar thread başına tek
+// bir epoll döngüsünde eşzamanlı yürütülür. Tüm tüneller kurulunca trafik aşaması başlar:
+//   frames:      Paylaşan, RFB FramebufferUpdate (raw) biçiminde kareleri fps hızında gönderir;
+//                soket 8 kareden fazla geride kalırsa yeni kareler atlanır (VNC sunucusunun
+//                güncellemeleri birleştirmesi gibi). Görüntüleyen giriş olayları gönderir.
+//   interactive: frames ile aynı, küçük kareler (4 KB, 60 fps) ve daha sık giriş olayı.
+//   stream:      Paylaşan soketin kabul ettiği kadar hızlı gönderir (toplu aktarım).
+// Rapor: bağlantıdan tünel açılışına kadar geçen sürenin yüzdelik dilimleri, iki yöndeki
+// toplam hız, relay RSS (kurulum öncesi/sonrası/bitiş, tepe) ve relay CPU'su.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "bench_common.h"
+
+using Clock = std::chrono::steady_clock;
+
+enum Pattern { PATTERN_FRAMES, PATTERN_INTERACTIVE, PATTERN_STREAM };
+
+struct Options {
+    std::string ip;
+    int port = 0;
+    int agents = 1000;
+    int duration = 10;
+    Pattern pattern = PATTERN_FRAMES;
+    size_t frame_bytes = 64 * 1024;
+    double fps = 30;
+    double input_rate = 60;
+    int connect_rate = 0;
+    int inflight = 256;
+    int threads = 1;
+    int pid = 0;
+    int sharer_port = 0;
+};
+
+static const size_t MAX_BACKLOG_FRAMES = 8;   // Paylaşan bu kadar kare geride kalırsa kare atlanır
+static const size_t POINTER_EVENT_SIZE = 6;   // RFB PointerEvent: [5][düğme][x:2][y:2]
+static const size_t MAX_INPUT_BACKLOG = 64 * 1024;
+static const int TICK_MS = 2;                 // Kare/giriş zamanlama çözünürlüğü
+static const int SETUP_TIMEOUT_SECONDS = 60;
+
+// --- Ortak durum (ana thread <-> yük thread'leri) ---
+static std::atomic<int> threads_ready{0};
+static std::atomic<bool> traffic_started{false};
+static Clock::time_point traffic_start, traffic_end;
+
+// Gönderilen trafik: tekrar eden kare ve giriş olayı desenleri
+static std::vector<char> frame_pattern;
+static std::vector<char> input_pattern;
+
+struct Pair;
+
+struct Endpoint {
+    int fd = -1;
+    bool sharer = false;
+    bool active = false;        // TUNNEL_ACTIVE alındı
+    bool writable = false;
+    std::string line_buffer;    // Tünel öncesi kontrol satırları
+    uint64_t out_pending = 0;   // Gönderilmeyi bekleyen trafik byte'ı
+    uint64_t out_total = 0;     // Toplam gönderilen trafik (desen içindeki konum)
+};
+
+struct Pair {
+    Endpoint viewer;
+    Endpoint sharer;
+    std::string viewer_id, sharer_id;
+    bool connect_sent = false;
+    bool established = false;
+    bool failed = false;
+    Clock::time_point started;
+    uint64_t frames_enqueued = 0;
+    uint64_t inputs_enqueued = 0;
+};
+
+struct ThreadStats {
+    uint64_t established = 0;
+    uint64_t failed = 0;
+    uint64_t dropped = 0;             // Trafik sırasında kopan tüneller
+    std::vector<double> setup_ms;     // Bağlantı -> iki uçta TUNNEL_ACTIVE
+    uint64_t down_received = 0;       // Paylaşan -> görüntüleyen
+    uint64_t up_received = 0;         // Görüntüleyen -> paylaşan
+    uint64_t frames_sent = 0;
+    uint64_t frames_skipped = 0;
+};
+
+static void build_patterns(const Options& opt) {
+    // FramebufferUpdate: [0][pad][rect sayısı:2] + rect [x:2][y:2][w:2][h:2][kodlama:4 = 0 raw] + piksel
+    frame_pattern.assign(std::max<size_t>(opt.frame_bytes, 16), 0);
+    size_t pixels = frame_pattern.size() - 16;
+    uint16_t width = 256, height = (uint16_t)std::min<size_t>(pixels / (width * 4) + 1, 0xffff);
+    unsigned char header[16] = { 0, 0, 0, 1, 0, 0, 0, 0,
+                                 (unsigned char)(width >> 8), (unsigned char)width,
+                                 (unsigned char)(height >> 8), (unsigned char)height, 0, 0, 0, 0 };
+    memcpy(frame_pattern.data(), header, sizeof(header));
+    for (size_t i = 16; i < frame_pattern.size(); ++i) frame_pattern[i] = (char)(i * 31);
+
+    input_pattern.resize(POINTER_EVENT_SIZE * 512);
+    for (size_t i = 0; i < 512; ++i) {
+        unsigned char* ev = reinterpret_cast<unsigned char*>(&input_pattern[i * POINTER_EVENT_SIZE]);
+        uint16_t x = (uint16_t)(i * 3), y = (uint16_t)(i * 2);
+        ev[0] = 5;
+        ev[1] = (i % 16 == 0) ? 1 : 0;
+        ev[2] = x >> 8; ev[3] = x & 0xff;
+        ev[4] = y >> 8; ev[5] = y & 0xff;
+    }
+}
+
+static int open_nonblocking(const struct sockaddr_in& addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (::connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Bir yük thread'i: kendisine düşen çiftleri kurar, trafik aşamasında deseni sürer.
+ */
+class LoadThread {
+public:
+    LoadThread(const Options& opt, const struct sockaddr_in& addr, const struct sockaddr_in& sharer_addr,
+               int pair_count, double connect_rate)
+        : opt_(opt), addr_(addr), sharer_addr_(sharer_addr), pairs_(pair_count), connect_rate_(connect_rate) {}
+
+    void run();
+    const ThreadStats& stats() const { return stats_; }
+
+private:
+    void open_pairs(Clock::time_point setup_start);
+    void fail(Pair& pair);
+    void handle_event(uint64_t key, uint32_t events);
+    void on_line(Pair& pair, Endpoint& self, const std::string& line);
+    void try_connect(Pair& pair);
+    void send_line(Pair& pair, Endpoint& self, const std::string& line);
+    void count_received(Endpoint& self, size_t bytes);
+    void flush(Pair& pair, Endpoint& self);
+    void tick(double elapsed);
+
+    const Options& opt_;
+    struct sockaddr_in addr_;
+    struct sockaddr_in sharer_addr_;
+    std::vector<Pair> pairs_;
+    double connect_rate_;
+    int epoll_fd_ = -1;
+    size_t opened_ = 0;
+    size_t resolved_ = 0; // Kurulan veya başarısız olan çiftler
+    bool in_traffic_ = false;
+    ThreadStats stats_;
+};
+
+void LoadThread::open_pairs(Clock::time_point setup_start) {
+    double elapsed = std::chrono::duration<double>(Clock::now() - setup_start).count();
+    while (opened_ < pairs_.size() && opened_ - resolved_ < (size_t)opt_.inflight &&
+           (connect_rate_ <= 0 || opened_ < elapsed * connect_rate_ + 1)) {
+        size_t index = opened_++;
+        Pair& pair = pairs_[index];
+        pair.started = Clock::now();
+        pair.viewer.fd = open_nonblocking(addr_);
+        pair.sharer.fd = open_nonblocking(sharer_addr_);
+        pair.sharer.sharer = true;
+        if (pair.viewer.fd < 0 || pair.sharer.fd < 0) {
+            fail(pair);
+            continue;
+        }
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = (uint64_t)index << 1;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, pair.viewer.fd, &ev);
+        ev.data.u64 = ((uint64_t)index << 1) | 1;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, pair.sharer.fd, &ev);
+    }
+}
+
+void LoadThread::fail(Pair& pair) {
+    if (pair.failed) return;
+    pair.failed = true;
+    if (pair.established) {
+        ++stats_.dropped;
+    } else {
+        ++stats_.failed;
+        ++resolved_;
+    }
+    for (Endpoint* e : { &pair.viewer, &pair.sharer }) {
+        if (e->fd >= 0) ::close(e->fd);
+        e->fd = -1;
+    }
+}
+
+void LoadThread::send_line(Pair& pair, Endpoint& self, const std::string& line) {
+    std::string msg = line + "\n";
+    // Kontrol satırları küçüktür; tünel öncesi soket tamponu boş olduğundan tek seferde gider
+    if (::send(self.fd, msg.data(), msg.size(), MSG_NOSIGNAL) != (ssize_t)msg.size()) fail(pair);
+}
+
+void LoadThread::try_connect(Pair& pair) {
+    if (pair.connect_sent || pair.viewer_id.empty() || pair.sharer_id.empty()) return;
+    pair.connect_sent = true;
+    send_line(pair, pair.viewer, "connect " + pair.sharer_id);
+}
+
+void LoadThread::on_line(Pair& pair, Endpoint& self, const std::string& line) {
+    std::string type = line.substr(0, line.find(' '));
+    std::string arg = line.find(' ') == std::string::npos ? "" : line.substr(line.find(' ') + 1);
+    if (type == "ID") {
+        (self.sharer ? pair.sharer_id : pair.viewer_id) = arg;
+        try_connect(pair);
+    } else if (type == "INCOMING" && self.sharer) {
+        send_line(pair, self, "accept " + arg);
+    } else if (type == "ACCEPTED" || type == "CONNECTION_ESTABLISHED") {
+        send_line(pair, self, "start_vnc_tunnel");
+    } else if (type == "TUNNEL_ACTIVE") {
+        self.active = true;
+        if (pair.viewer.active && pair.sharer.active) {
+            pair.established = true;
+            ++stats_.established;
+            ++resolved_;
+            stats_.setup_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - pair.started).count());
+        }
+    } else if (type == "ERROR" || type == "PEER_DISCONNECTED") {
+        fail(pair);
+    }
+    // CONNECTING yalnızca bilgi amaçlıdır
+}
+
+void LoadThread::count_received(Endpoint& self, size_t bytes) {
+    if (!in_traffic_) return; // Kurulum aşamasında erken açılan tünellerden gelen veri sayılmaz
+    (self.sharer ? stats_.up_received : stats_.down_received) += bytes;
+}
+
+// Bekleyen trafiği soketin kabul ettiği kadar gönderir
+void LoadThread::flush(Pair& pair, Endpoint& self) {
+    const std::vector<char>& pattern = self.sharer ? frame_pattern : input_pattern;
+    while (self.writable && self.out_pending > 0 && self.fd >= 0) {
+        size_t offset = self.out_total % pattern.size();
+        size_t len = (size_t)std::min<uint64_t>(pattern.size() - offset, self.out_pending);
+        ssize_t n = ::send(self.fd, pattern.data() + offset, len, MSG_NOSIGNAL);
+        if (n > 0) {
+            self.out_pending -= n;
+            self.out_total += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            self.writable = false; // EPOLLOUT ile devam
+            return;
+        }
+        fail(pair);
+        return;
+    }
+}
+
+void LoadThread::handle_event(uint64_t key, uint32_t events) {
+    Pair& pair = pairs_[key >> 1];
+    if (pair.failed) return;
+    Endpoint& self = (key & 1) ? pair.sharer : pair.viewer;
+
+    if (events & EPOLLERR) {
+        fail(pair);
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        char buffer[64 * 1024];
+        while (true) {
+            ssize_t n = ::read(self.fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                if (self.active) {
+                    count_received(self, n);
+                    continue;
+                }
+                self.line_buffer.append(buffer, n);
+                size_t pos;
+                while (!self.active && !pair.failed && (pos = self.line_buffer.find('\n')) != std::string::npos) {
+                    std::string line = self.line_buffer.substr(0, pos);
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    self.line_buffer.erase(0, pos + 1);
+                    on_line(pair, self, line);
+                }
+                if (pair.failed) return;
+                // TUNNEL_ACTIVE'den sonra gelenler karşı ucun trafiğidir
+                if (self.active && !self.line_buffer.empty()) {
+                    count_received(self, self.line_buffer.size());
+                    self.line_buffer.clear();
+                }
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail(pair); // Relay bağlantıyı kapattı
+            return;
+        }
+    }
+    if (events & EPOLLOUT) {
+        self.writable = true;
+        if (self.active) flush(pair, self);
+    }
+}
+
+// Zamanı gelen kareleri ve giriş olaylarını gönderim kuyruklarına ekler
+void LoadThread::tick(double elapsed) {
+    for (Pair& pair : pairs_) {
+        if (!pair.established || pair.failed) continue;
+        if (opt_.pattern == PATTERN_STREAM) {
+            pair.sharer.out_pending = frame_pattern.size() * MAX_BACKLOG_FRAMES;
+        } else {
+            uint64_t due = (uint64_t)(elapsed * opt_.fps);
+            for (; pair.frames_enqueued < due; ++pair.frames_enqueued) {
+                if (pair.sharer.out_pending >= frame_pattern.size() * MAX_BACKLOG_FRAMES) {
+                    ++stats_.frames_skipped;
+                } else {
+                    pair.sharer.out_pending += frame_pattern.size();
+                    ++stats_.frames_sent;
+                }
+            }
+        }
+        uint64_t inputs_due = (uint64_t)(elapsed * opt_.input_rate);
+        if (inputs_due > pair.inputs_enqueued) {
+            uint64_t bytes = (inputs_due - pair.inputs_enqueued) * POINTER_EVENT_SIZE;
+            pair.viewer.out_pending = std::min<uint64_t>(pair.viewer.out_pending + bytes, MAX_INPUT_BACKLOG);
+            pair.inputs_enqueued = inputs_due;
+        }
+        flush(pair, pair.sharer);
+        if (!pair.failed) flush(pair, pair.viewer);
+    }
+}
+
+void LoadThread::run() {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<struct epoll_event> events(1024);
+    auto setup_start = Clock::now();
+    auto setup_deadline = setup_start + std::chrono::seconds(SETUP_TIMEOUT_SECONDS);
+
+    // Kurulum: tüm çiftler kurulana veya başarısız olana kadar
+    while (resolved_ < pairs_.size() && Clock::now() < setup_deadline) {
+        open_pairs(setup_start);
+        int n = ::epoll_wait(epoll_fd_, events.data(), (int)events.size(), TICK_MS);
+        for (int i = 0; i < n; ++i) handle_event(events[i].data.u64, events[i].events);
+    }
+    for (Pair& pair : pairs_) {
+        if (!pair.established) fail(pair); // Zaman aşımı
+    }
+
+    threads_ready.fetch_add(1);
+    while (!traffic_started.load()) {
+        // Diğer thread'ler kurulumu bitirene kadar gelen kontrol olaylarını tüket
+        int n = ::epoll_wait(epoll_fd_, events.data(), (int)events.size(), TICK_MS);
+        for (int i = 0; i < n; ++i) handle_event(events[i].data.u64, events[i].events);
+    }
+
+    in_traffic_ = true;
+    auto next_tick = Clock::now();
+    while (true) {
+        auto now = Clock::now();
+        if (now >= traffic_end) break;
+        if (now >= next_tick) {
+            tick(std::chrono::duration<double>(now - traffic_start).count());
+            next_tick = now + std::chrono::milliseconds(TICK_MS);
+        }
+        int n = ::epoll_wait(epoll_fd_, events.data(), (int)events.size(), TICK_MS);
+        for (int i = 0; i < n; ++i) handle_event(events[i].data.u64, events[i].events);
+    }
+    in_traffic_ = false;
+
+    for (Pair& pair : pairs_) {
+        for (Endpoint* e : { &pair.viewer, &pair.sharer }) {
+            if (e->fd >= 0) ::close(e->fd);
+            e->fd = -1;
+        }
+    }
+    ::close(epoll_fd_);
+}
+
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t index = (size_t)std::ceil(q * sorted.size());
+    return sorted[std::min(sorted.size() - 1, index == 0 ? 0 : index - 1)];
+}
+
+static const char* pattern_name(Pattern pattern) {
+    switch (pattern) {
+        case PATTERN_FRAMES: return "frames";
+        case PATTERN_INTERACTIVE: return "interactive";
+        case PATTERN_STREAM: return "stream";
+    }
+    return "?";
+}
+
+static bool parse_options(int argc, char *argv[], Options* opt) {
+    if (argc < 3) return false;
+    opt->ip = argv[1];
+    opt->port = std::stoi(argv[2]);
+    // Desen önce uygulanır; ardından gelen seçenekler desenin varsayılanlarını değiştirir
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--pattern=", 0) != 0) continue;
+        std::string name = arg.substr(arg.find('=') + 1);
+        if (name == "frames") {
+            opt->pattern = PATTERN_FRAMES;
+        } else if (name == "interactive") {
+            opt->pattern = PATTERN_INTERACTIVE;
+            opt->frame_bytes = 4 * 1024;
+            opt->fps = 60;
+            opt->input_rate = 120;
+        } else if (name == "stream") {
+            opt->pattern = PATTERN_STREAM;
+        } else {
+            return false;
+        }
+    }
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find('=') + 1);
+        if (arg.rfind("--pattern=", 0) == 0) continue;
+        else if (arg.rfind("--agents=", 0) == 0) opt->agents = std::stoi(value);
+        else if (arg.rfind("--duration=", 0) == 0) opt->duration = std::stoi(value);
+        else if (arg.rfind("--frame-bytes=", 0) == 0) opt->frame_bytes = std::stoul(value);
+        else if (arg.rfind("--fps=", 0) == 0) opt->fps = std::stod(value);
+        else if (arg.rfind("--input-rate=", 0) == 0) opt->input_rate = std::stod(value);
+        else if (arg.rfind("--connect-rate=", 0) == 0) opt->connect_rate = std::stoi(value);
+        else if (arg.rfind("--inflight=", 0) == 0) opt->inflight = std::stoi(value);
+        else if (arg.rfind("--threads=", 0) == 0) opt->threads = std::stoi(value);
+        else if (arg.rfind("--pid=", 0) == 0) opt->pid = std::stoi(value);
+        else if (arg.rfind("--sharer-port=", 0) == 0) opt->sharer_port = std::stoi(value);
+        else return false;
+    }
+    return opt->agents >= 2 && opt->threads >= 1 && opt->inflight >= 1 && opt->duration >= 1;
+}
+
+int main(int argc, char *argv[]) {
+    Options opt;
+    try {
+        if (!parse_options(argc, argv, &opt)) {
+            std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port> [--agents=N] [--duration=S]"
+                      << " [--pattern=frames|interactive|stream] [--frame-bytes=B] [--fps=F] [--input-rate=R]"
+                      << " [--connect-rate=R] [--inflight=N] [--threads=T] [--pid=PID] [--sharer-port=P]" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Hata: Geçersiz sayısal argüman. " << e.what() << std::endl;
+        return 1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.ip.c_str(), &addr.sin_addr) <= 0) {
+        std::cerr << "Hata: Geçersiz IP adresi: " << opt.ip << std::endl;
+        return 1;
+    }
+    struct sockaddr_in sharer_addr = addr;
+    if (opt.sharer_port > 0) sharer_addr.sin_port = htons(opt.sharer_port);
+
+    // Her ajan bu süreçte bir soket kullanır
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    build_patterns(opt);
+    int pair_count = opt.agents / 2;
+    long rss_before = opt.pid ? bench::read_process_rss_kb(opt.pid) : 0;
+
+    std::vector<std::unique_ptr<LoadThread>> loaders;
+    for (int t = 0; t < opt.threads; ++t) {
+        int count = pair_count / opt.threads + (t < pair_count % opt.threads ? 1 : 0);
+        loaders.emplace_back(new LoadThread(opt, addr, sharer_addr, count, (double)opt.connect_rate / opt.threads));
+    }
+    auto setup_start = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto& loader : loaders) {
+        LoadThread* l = loader.get();
+        threads.emplace_back([l]() { l->run(); });
+    }
+
+    while (threads_ready.load() < opt.threads) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    double setup_seconds = std::chrono::duration<double>(Clock::now() - setup_start).count();
+    long rss_setup = opt.pid ? bench::read_process_rss_kb(opt.pid) : 0;
+    double cpu_before = opt.pid ? bench::read_process_cpu_seconds(opt.pid) : 0;
+    struct rusage self_before, self_after;
+    ::getrusage(RUSAGE_SELF, &self_before);
+
+    traffic_start = Clock::now();
+    traffic_end = traffic_start + std::chrono::seconds(opt.duration);
+    traffic_started.store(true);
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - traffic_start).count();
+
+    ::getrusage(RUSAGE_SELF, &self_after);
+    double cpu_after = opt.pid ? bench::read_process_cpu_seconds(opt.pid) : 0;
+    long rss_end = opt.pid ? bench::read_process_rss_kb(opt.pid) : 0;
+    long rss_peak = opt.pid ? bench::read_process_status_kb(opt.pid, "VmHWM:") : 0;
+
+    ThreadStats total;
+    for (auto& loader : loaders) {
+        const ThreadStats& s = loader->stats();
+        total.established += s.established;
+        total.failed += s.failed;
+        total.dropped += s.dropped;
+        total.setup_ms.insert(total.setup_ms.end(), s.setup_ms.begin(), s.setup_ms.end());
+        total.down_received += s.down_received;
+        total.up_received += s.up_received;
+        total.frames_sent += s.frames_sent;
+        total.frames_skipped += s.frames_skipped;
+    }
+    std::sort(total.setup_ms.begin(), total.setup_ms.end());
+
+    auto timeval_seconds = [](const struct timeval& tv) { return tv.tv_sec + tv.tv_usec / 1e6; };
+    double self_cpu = timeval_seconds(self_after.ru_utime) + timeval_seconds(self_after.ru_stime) -
+                      timeval_seconds(self_before.ru_utime) - timeval_seconds(self_before.ru_stime);
+    double mb = 1024.0 * 1024.0;
+    double gigabytes = (double)(total.down_received + total.up_received) / (mb * 1024.0);
+
+    std::cout << "Ajan / tünel           : " << pair_count * 2 << " / " << pair_count
+              << " (kurulan: " << total.established << ", başarısız: " << total.failed
+              << ", trafikte kopan: " << total.dropped << ")" << std::endl;
+    std::cout << "Kurulum süresi         : " << setup_seconds << " s ("
+              << total.established / setup_seconds << " tünel/s)" << std::endl;
+    std::cout << "Bağlantı->tünel (ms)   : p50 " << percentile(total.setup_ms, 0.5)
+              << ", p90 " << percentile(total.setup_ms, 0.9)
+              << ", p99 " << percentile(total.setup_ms, 0.99)
+              << ", en fazla " << (total.setup_ms.empty() ? 0 : total.setup_ms.back()) << std::endl;
+    std::cout << "Desen                  : " << pattern_name(opt.pattern);
+    if (opt.pattern != PATTERN_STREAM) {
+        std::cout << " (" << frame_pattern.size() << " byte x " << opt.fps << " fps";
+    } else {
+        std::cout << " (";
+    }
+    std::cout << ", giriş " << opt.input_rate << "/s)" << std::endl;
+    std::cout << "Aşağı (paylaşan->izl.) : " << total.down_received / mb / seconds << " MB/s" << std::endl;
+    std::cout << "Yukarı (izl.->paylaşan): " << total.up_received / mb / seconds << " MB/s" << std::endl;
+    std::cout << "Toplam hız             : " << (total.down_received + total.up_received) / mb / seconds << " MB/s" << std::endl;
+    if (opt.pattern != PATTERN_STREAM) {
+        std::cout << "Kare (gönderilen/atl.) : " << total.frames_sent << " / " << total.frames_skipped << std::endl;
+    }
+    std::cout << "Yük üretici CPU        : " << self_cpu << " s (" << self_cpu / seconds * 100 << "%)" << std::endl;
+    if (opt.pid) {
+        std::cout << "Relay RSS (KB)         : kurulum öncesi " << rss_before << ", sonrası " << rss_setup
+                  << ", bitiş " << rss_end << ", tepe " << rss_peak << std::endl;
+        if (total.established > 0) {
+            std::cout << "Relay RSS / tünel      : " << (double)(rss_setup - rss_before) / total.established << " KB" << std::endl;
+        }
+        std::cout << "Relay CPU (trafik)     : " << (cpu_after - cpu_before) << " s ("
+                  << (cpu_after - cpu_before) / seconds * 100 << "%)" << std::endl;
+        if (gigabytes > 0) {
+            std::cout << "Relay CPU / GB         : " << (cpu_after - cpu_before) / gigabytes << " s" << std::endl;
+        }
+    }
+    return total.established > 0 ? 0 : 1;
+}
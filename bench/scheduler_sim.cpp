@@ -0,0 +1,218 @@
+// Çıkış zamanlayıcısının (EgressScheduler) adaleti ve gecikmesi için süreç içi benzetim.
+//
+// Kullanım: ./scheduler_sim [sure_saniye] [uplink_MB_sn]
+//
+// Gerçek EgressScheduler/EgressLimits sanal bir saatle sürülür; ağ kullanılmaz. Relay'in çıkış
+// bağlantısı (uplink) sabit hızla boşalan tek bir FIFO kuyruk olarak modellenir. Yük:
+//   video      : 1 oturum, her zaman veri hazır, büyük soket tamponu (4 MB) — tam ekran video
+//   masaüstü   : 7 oturum, her zaman veri hazır, 256 KB tampon
+//   etkileşim  : 32 oturum, Poisson ile saniyede 200 küçük paket (100-300 byte; giriş olayları)
+// Senaryolar:
+//   fifo    : Zamanlayıcı yok. Her oturum soket tamponu dolana kadar uplink kuyruğuna yazar;
+//             pay tampon boyuyla orantılıdır ve küçük paketler video verisinin arkasında bekler.
+//   drr     : Toplam çıkış uplink'in %95'i ile sınırlı; toplu oturumlar quantum'lu round robin
+//             ile paylaşır, küçük paketler öncelikli sınıftan hemen geçer.
+//   account : drr + video ve 3 masaüstü oturumu aynı hesapta, hesap sınırı uplink'in %20'si.
+// Toplu oturumların verimi, Jain adalet endeksi (1 = tam adil) ve etkileşim paketlerinin
+// üretimden uplink'ten çıkışa kadar gecikme yüzdelikleri yazdırılır.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "egress_scheduler.h"
+#include "metrics.h"
+
+static uint64_t sim_now = 0;
+static uint64_t sim_clock() { return sim_now; }
+
+static const uint64_t TICK_NS = 50000; // 50 µs
+static const size_t BULK_CHUNK = 16 * 1024;
+
+enum FlowKind { VIDEO, DESKTOP, INTERACTIVE };
+
+struct Chunk {
+    size_t bytes;
+    uint64_t created_ns;
+};
+
+struct SimFlow {
+    FlowKind kind;
+    size_t window;              // Soket tamponu: uplink kuyruğunda bekleyebilecek en fazla byte
+    size_t buffer_limit;        // Relay tamponu (zamanlayıcılı senaryolarda)
+    std::deque<Chunk> relay;    // Relay'de gönderilmeyi bekleyen veri
+    size_t relay_bytes = 0;
+    size_t in_uplink = 0;
+    uint64_t delivered = 0;     // Ölçüm penceresinde uplink'ten çıkan byte
+    EgressFlow flow;
+};
+
+struct Segment {
+    SimFlow* owner;
+    size_t bytes;
+    uint64_t created_ns;
+    bool packet; // Etkileşim paketi: tamamı çıkınca gecikmesi kaydedilir
+};
+
+struct Scenario {
+    const char* name;
+    bool scheduled;
+    bool shared_account;
+};
+
+static void run(const Scenario& scenario, double seconds, uint64_t uplink_rate) {
+    SchedulerConfig config;
+    if (scenario.scheduled) config.egress_rate = uplink_rate * 95 / 100;
+    if (scenario.shared_account) config.account_rate = uplink_rate / 5;
+    EgressLimits limits(config);
+    EgressScheduler scheduler(limits, nullptr, sim_clock);
+
+    std::vector<std::unique_ptr<SimFlow>> flows;
+    auto add_flow = [&](FlowKind kind, size_t window, const std::string& account) {
+        std::unique_ptr<SimFlow> f(new SimFlow());
+        f->kind = kind;
+        f->window = window;
+        f->buffer_limit = 256 * 1024;
+        f->flow.session = limits.new_session();
+        f->flow.account = limits.account(account);
+        flows.push_back(std::move(f));
+    };
+    add_flow(VIDEO, 4 * 1024 * 1024, scenario.shared_account ? "paylasimli" : "video");
+    for (int i = 0; i < 7; ++i) {
+        add_flow(DESKTOP, 256 * 1024, scenario.shared_account && i < 3 ? "paylasimli" : "masaustu" + std::to_string(i));
+    }
+    for (int i = 0; i < 32; ++i) add_flow(INTERACTIVE, 256 * 1024, "etkilesim" + std::to_string(i));
+
+    std::deque<Segment> uplink;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<size_t> packet_size(100, 300);
+    const double packet_probability = 200.0 * TICK_NS / 1e9;
+
+    LatencyHistogram latency;
+    const uint64_t warmup_ns = 500000000;
+    const uint64_t end_ns = warmup_ns + (uint64_t)(seconds * 1e9);
+
+    // Relay tamponundan izin verilen kadar veriyi uplink'e (soket tamponuna) taşır
+    auto transmit = [&](SimFlow& f) {
+        while (f.relay_bytes > 0 && f.in_uplink < f.window) {
+            size_t wanted = std::min(f.relay_bytes, f.window - f.in_uplink);
+            size_t allowed = scenario.scheduled ? scheduler.grant(f.flow, wanted) : wanted;
+            if (allowed == 0) return;
+            size_t moved = 0;
+            while (moved < allowed && !f.relay.empty()) {
+                Chunk& c = f.relay.front();
+                size_t n = std::min(c.bytes, allowed - moved);
+                bool whole = n == c.bytes;
+                uplink.push_back({&f, n, c.created_ns, whole && f.kind == INTERACTIVE});
+                c.bytes -= n;
+                moved += n;
+                if (whole) f.relay.pop_front();
+            }
+            f.relay_bytes -= moved;
+            f.in_uplink += moved;
+            if (scenario.scheduled) scheduler.sent(f.flow, moved);
+        }
+    };
+    for (auto& f : flows) {
+        SimFlow* raw = f.get();
+        f->flow.wake = [&transmit, raw]() { transmit(*raw); };
+    }
+
+    const double bytes_per_tick = (double)uplink_rate * TICK_NS / 1e9;
+    double uplink_credit = 0;
+    for (sim_now = 1; sim_now < end_ns; sim_now += TICK_NS) {
+        bool measuring = sim_now >= warmup_ns;
+
+        // Kaynaklar: toplu oturumlar tamponlarını doldurur, etkileşim oturumları paket üretir
+        for (auto& f : flows) {
+            if (f->kind == INTERACTIVE) {
+                if (uniform(rng) < packet_probability) {
+                    size_t bytes = packet_size(rng);
+                    f->relay.push_back({bytes, sim_now});
+                    f->relay_bytes += bytes;
+                }
+            } else {
+                size_t limit = scenario.scheduled ? f->buffer_limit : f->window;
+                while (f->relay_bytes < limit) {
+                    f->relay.push_back({BULK_CHUNK, sim_now});
+                    f->relay_bytes += BULK_CHUNK;
+                }
+            }
+        }
+
+        // Olay döngüsü: yazılabilir soketler gönderimi dener, zamanlayıcı sırası gelenleri uyandırır
+        size_t start = (sim_now / TICK_NS) % flows.size();
+        for (size_t i = 0; i < flows.size(); ++i) {
+            SimFlow& f = *flows[(start + i) % flows.size()];
+            if (!f.flow.queued) transmit(f);
+        }
+        uint64_t wake = scheduler.next_wake_ns();
+        if (wake != 0 && wake <= sim_now) scheduler.service();
+
+        // Uplink: sabit hızla FIFO boşalır
+        uplink_credit += bytes_per_tick;
+        while (!uplink.empty() && uplink_credit >= 1) {
+            Segment& s = uplink.front();
+            size_t n = std::min(s.bytes, (size_t)uplink_credit);
+            s.bytes -= n;
+            uplink_credit -= n;
+            s.owner->in_uplink -= n;
+            if (measuring) s.owner->delivered += n;
+            if (s.bytes == 0) {
+                if (s.packet && measuring) latency.record(sim_now - s.created_ns);
+                uplink.pop_front();
+            }
+        }
+        if (uplink.empty()) uplink_credit = std::min(uplink_credit, bytes_per_tick);
+    }
+
+    double video = 0, desktop_min = 1e18, desktop_max = 0, desktop_sum = 0, sum = 0, sum_sq = 0;
+    int bulk = 0;
+    for (auto& f : flows) {
+        if (f->kind == INTERACTIVE) continue;
+        double rate = f->delivered / seconds / 1e6;
+        if (f->kind == VIDEO) {
+            video = rate;
+        } else {
+            desktop_min = std::min(desktop_min, rate);
+            desktop_max = std::max(desktop_max, rate);
+            desktop_sum += rate;
+        }
+        sum += rate;
+        sum_sq += rate * rate;
+        ++bulk;
+    }
+    LatencyHistogram::Snapshot snapshot;
+    latency.add_to(&snapshot);
+    printf("%-8s video %6.1f MB/s | masaüstü ort %5.1f (min %5.1f, maks %5.1f) MB/s | Jain %.3f | "
+           "etkileşim p50 %7.2f ms, p99 %7.2f ms, p99.9 %7.2f ms (%lu paket)\n",
+           scenario.name, video, desktop_sum / 7, desktop_min, desktop_max, sum * sum / (bulk * sum_sq),
+           snapshot.quantile(0.5) / 1e6, snapshot.quantile(0.99) / 1e6, snapshot.quantile(0.999) / 1e6,
+           (unsigned long)snapshot.count);
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    uint64_t uplink_rate = (argc > 2 ? strtoull(argv[2], nullptr, 10) : 100) * 1000 * 1000;
+    if (seconds <= 0 || uplink_rate == 0) {
+        std::cerr << "Kullanım: " << argv[0] << " [sure_saniye] [uplink_MB_sn]" << std::endl;
+        return 1;
+    }
+    printf("Uplink %.0f MB/s, %.1f sn (0.5 sn ısınma hariç); 1 video + 7 masaüstü + 32 etkileşim oturumu\n",
+           uplink_rate / 1e6, seconds);
+    static const Scenario scenarios[] = {
+        {"fifo", false, false},
+        {"drr", true, false},
+        {"account", true, true},
+    };
+    for (const Scenario& scenario : scenarios) run(scenario, seconds, uplink_rate);
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Zamanlayıcı çarkının (TimerWheel) sıralı ağaç tabanlı zamanlayıcıya karşı maliyeti.
+//
+// Kullanım: ./timer_wheel_bench [baglanti_sayisi] [sure_saniye] [etkinlik_sn]
+//
+// Ağ kullanılmaz; iki uygulama aynı sanal saat ve aynı rastgele olay dizisiyle sürülür:
+//   wheel    : TimerWheel (100 ms tick), kurma/iptal O(1), düğüm bağlantının içinde
+//   multimap : std::multimap<süre, bağlantı>, kurma/iptal O(log n), her kurmada bellek ayırma
+// Her bağlantının relay'deki gibi tek bir zamanlayıcısı vardır: başlangıçta 1-60 sn arasında
+// kurulur, dolunca 30 sn sonraya yeniden kurulur (kalp atışı). Saniyede etkinlik_sn kez rastgele
+// bir bağlantı veri gönderir ve zamanlayıcısı 60 sn sonraya yeniden kurulur (boşta kalma); bunların
+// yaklaşık %5'i bağlantının kapanıp yeniden açılmasıdır (iptal + kurma). Sanal saat 100 ms
+// adımlarla ilerler. İşlem başına süre ve dolan zamanlayıcı sayısı yazdırılır; çark süreleri en
+// fazla bir tick geç çalıştırdığından sayılar birbirine çok yakın olmalıdır.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "timer_wheel.h"
+
+static uint64_t sim_now_ns = 0;
+static uint64_t sim_clock() { return sim_now_ns; }
+
+static const uint64_t STEP_MS = 100;
+static const uint64_t HEARTBEAT_MS = 30000;
+static const uint64_t IDLE_MS = 60000;
+
+// Olay dizisi: her adımda etkinlik gösteren bağlantılar (negatifse kapanıp yeniden açılır)
+struct Workload {
+    std::vector<uint64_t> initial_ms;
+    std::vector<std::vector<int64_t>> steps;
+};
+
+static Workload make_workload(size_t connections, uint64_t seconds, uint64_t activity_per_sec) {
+    std::mt19937_64 rng(42);
+    Workload work;
+    std::uniform_int_distribution<uint64_t> initial(1000, 60000);
+    for (size_t i = 0; i < connections; ++i) work.initial_ms.push_back(initial(rng));
+    std::uniform_int_distribution<int64_t> pick(0, (int64_t)connections - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    uint64_t per_step = activity_per_sec * STEP_MS / 1000;
+    work.steps.resize(seconds * 1000 / STEP_MS);
+    for (auto& step : work.steps) {
+        step.reserve(per_step);
+        for (uint64_t i = 0; i < per_step; ++i) {
+            int64_t conn = pick(rng);
+            step.push_back(percent(rng) < 5 ? -conn - 1 : conn);
+        }
+    }
+    return work;
+}
+
+struct Result {
+    double seconds;
+    uint64_t operations;
+    uint64_t fired;
+};
+
+struct WheelConn {
+    TimerWheel::Timer timer;
+};
+
+static Result run_wheel(const Workload& work) {
+    sim_now_ns = 0;
+    TimerWheel wheel(nullptr, STEP_MS, sim_clock);
+    std::vector<WheelConn> conns(work.initial_ms.size());
+    uint64_t fired = 0;
+    uint64_t operations = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < conns.size(); ++i) {
+        TimerWheel::Timer* timer = &conns[i].timer;
+        timer->callback = [&wheel, &fired, &operations, timer]() {
+            ++fired;
+            ++operations;
+            wheel.arm(*timer, HEARTBEAT_MS);
+        };
+        wheel.arm(*timer, work.initial_ms[i]);
+        ++operations;
+    }
+    for (const auto& step : work.steps) {
+        sim_now_ns += STEP_MS * 1000000;
+        for (int64_t event : step) {
+            if (event < 0) {
+                TimerWheel::Timer& timer = conns[-event - 1].timer;
+                wheel.cancel(timer);
+                wheel.arm(timer, IDLE_MS);
+                operations += 2;
+            } else {
+                wheel.arm(conns[event].timer, IDLE_MS);
+                ++operations;
+            }
+        }
+        wheel.advance(sim_now_ns / 1000000);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return Result{seconds, operations, fired};
+}
+
+static Result run_multimap(const Workload& work) {
+    using Timers = std::multimap<uint64_t, size_t>;
+    Timers timers;
+    std::vector<Timers::iterator> handles(work.initial_ms.size(), timers.end());
+    uint64_t now_ms = 0;
+    uint64_t fired = 0;
+    uint64_t operations = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < handles.size(); ++i) {
+        handles[i] = timers.emplace(work.initial_ms[i], i);
+        ++operations;
+    }
+    for (const auto& step : work.steps) {
+        now_ms += STEP_MS;
+        for (int64_t event : step) {
+            size_t conn = event < 0 ? (size_t)(-event - 1) : (size_t)event;
+            timers.erase(handles[conn]);
+            handles[conn] = timers.emplace(now_ms + IDLE_MS, conn);
+            operations += event < 0 ? 2 : 1;
+        }
+        while (!timers.empty() && timers.begin()->first <= now_ms) {
+            size_t conn = timers.begin()->second;
+            timers.erase(timers.begin());
+            ++fired;
+            handles[conn] = timers.emplace(now_ms + HEARTBEAT_MS, conn);
+            ++operations;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return Result{seconds, operations, fired};
+}
+
+static void print_result(const char* name, const Result& result) {
+    printf("%-9s %10.3f %12llu %10.1f %12llu\n", name, result.seconds, (unsigned long long)result.operations,
+           result.seconds * 1e9 / (double)result.operations, (unsigned long long)result.fired);
+}
+
+int main(int argc, char* argv[]) {
+    size_t connections = argc > 1 ? strtoull(argv[1], nullptr, 10) : 500000;
+    uint64_t seconds = argc > 2 ? strtoull(argv[2], nullptr, 10) : 120;
+    uint64_t activity = argc > 3 ? strtoull(argv[3], nullptr, 10) : 200000;
+    if (connections == 0 || seconds == 0) {
+        fprintf(stderr, "Kullanım: %s [baglanti_sayisi] [sure_saniye] [etkinlik_sn]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Bağlantı: %zu, sanal süre: %llu sn, etkinlik: %llu/sn\n", connections, (unsigned long long)seconds,
+           (unsigned long long)activity);
+    Workload work = make_workload(connections, seconds, activity);
+    printf("%-9s %10s %12s %10s %12s\n", "yapı", "süre (sn)", "işlem", "ns/işlem", "dolan");
+    print_result("wheel", run_wheel(work));
+    print_result("multimap", run_multimap(work));
+    return 0;
+}
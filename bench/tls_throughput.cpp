@@ -0,0 +1,315 @@
+// Relay bağlantıları şifrelendiğinde aktarım hızını ve aktaran tarafın GB başına CPU maliyetini ölçer.
+//
+// Kullanım: ./tls_throughput [megabyte] [mod...]
+//
+// Loopback üzerinde gönderen -> aktarıcı -> alıcı zinciri kurulur; aktarıcı relay gibi iki
+// bağlantının sunucu tarafıdır ve gönderenden okuduğunu alıcıya yazar. Modlar (varsayılan hepsi):
+//   plain     : şifresiz, aktarıcı splice ile soket->boru->soket (relay'in bugünkü yolu)
+//   userspace : TLS 1.3, aktarıcı her kaydı OpenSSL ile çözüp yeniden şifreler (okuma + yazma)
+//   ktls      : TLS 1.3 el sıkışmasından sonra anahtarlar çekirdeğe verilir, aktarıcı yine splice kullanır
+// Gönderen ve alıcı TLS modlarında kullanıcı alanı TLS kullanır; ölçülen CPU yalnızca aktarıcı
+// thread'inindir. Çekirdek kTLS'i desteklemiyorsa (tls modülü yok) ktls modu "kullanılamıyor" yazar.
+// Sertifika her çalıştırmada bellekte üretilen geçici bir öz imzalı EC anahtarıdır.
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include "tls_link.h"
+
+enum Mode { MODE_PLAIN, MODE_USERSPACE, MODE_KTLS };
+
+static const char* mode_name(Mode mode) {
+    switch (mode) {
+    case MODE_PLAIN: return "plain";
+    case MODE_USERSPACE: return "userspace";
+    default: return "ktls";
+    }
+}
+
+static const size_t CHUNK = 64 * 1024;
+
+// Öz imzalı sertifika ve anahtarı geçici PEM dosyalarına yazar (TlsContext::server dosya bekler)
+static bool write_self_signed(std::string* cert_path, std::string* key_path) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    if (!key || !cert) return false;
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("relay-bench"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    char cert_template[] = "/tmp/tls_bench_cert_XXXXXX";
+    char key_template[] = "/tmp/tls_bench_key_XXXXXX";
+    int cert_fd = ok ? mkstemp(cert_template) : -1;
+    int key_fd = ok ? mkstemp(key_template) : -1;
+    FILE* cert_file = cert_fd >= 0 ? fdopen(cert_fd, "w") : nullptr;
+    FILE* key_file = key_fd >= 0 ? fdopen(key_fd, "w") : nullptr;
+    ok = cert_file && key_file && PEM_write_X509(cert_file, cert) &&
+         PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr);
+    if (cert_file) fclose(cert_file);
+    if (key_file) fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    *cert_path = cert_template;
+    *key_path = key_template;
+    return ok;
+}
+
+static double thread_cpu_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_loopback(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || ::connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Engelleyen soket üzerinde düz veya TLS uç nokta
+struct Endpoint {
+    int fd = -1;
+    std::unique_ptr<TlsStream> tls;
+
+    ssize_t read(char* data, size_t len) { return tls ? tls->read(data, len) : ::read(fd, data, len); }
+    ssize_t write(const char* data, size_t len) { return tls ? tls->write(data, len) : ::send(fd, data, len, MSG_NOSIGNAL); }
+};
+
+static bool open_endpoint(Endpoint& endpoint, int fd, const TlsContext* context) {
+    endpoint.fd = fd;
+    if (!context) return true;
+    endpoint.tls.reset(new TlsStream(*context, fd));
+    return endpoint.tls->handshake() == TLS_DONE;
+}
+
+struct ForwardResult {
+    bool ok = false;
+    std::string error;
+    double cpu_seconds = 0;
+};
+
+// Aktarıcı: gönderenden okunan her şeyi alıcıya yazar, gönderen kapatınca alıcının yazma yönünü kapatır
+static void run_forwarder(int listen_fd, Mode mode, const TlsContext* server_context, ForwardResult* result) {
+    int receiver_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    int sender_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    Endpoint receiver, sender;
+    if (receiver_fd < 0 || sender_fd < 0 || !open_endpoint(receiver, receiver_fd, server_context) ||
+        !open_endpoint(sender, sender_fd, server_context)) {
+        result->error = "bağlantı/el sıkışma başarısız";
+        ::close(receiver_fd);
+        ::close(sender_fd);
+        return;
+    }
+    if (mode == MODE_KTLS) {
+        std::string reason;
+        if (receiver.tls->enable_ktls(&reason) != KTLS_ENABLED || sender.tls->enable_ktls(&reason) != KTLS_ENABLED) {
+            result->error = "kullanılamıyor (" + reason + ")";
+            ::close(receiver_fd);
+            ::close(sender_fd);
+            return;
+        }
+        receiver.tls.reset();
+        sender.tls.reset();
+    }
+
+    double cpu_start = thread_cpu_seconds();
+    bool ok = true;
+    if (mode == MODE_USERSPACE) {
+        std::vector<char> buffer(CHUNK);
+        while (ok) {
+            ssize_t n = sender.read(buffer.data(), buffer.size());
+            if (n <= 0) break;
+            for (ssize_t off = 0; off < n;) {
+                ssize_t written = receiver.write(buffer.data() + off, n - off);
+                if (written <= 0) {
+                    ok = false;
+                    break;
+                }
+                off += written;
+            }
+        }
+        receiver.tls->shutdown();
+    } else {
+        int pipe_fds[2];
+        if (::pipe2(pipe_fds, O_CLOEXEC) < 0) {
+            ok = false;
+        } else {
+            ::fcntl(pipe_fds[1], F_SETPIPE_SZ, 1024 * 1024);
+            while (ok) {
+                // kTLS soketinde close_notify gibi veri dışı kayıtlar splice'ı hata ile bitirir; akış sonu sayılır
+                ssize_t n = ::splice(sender_fd, nullptr, pipe_fds[1], nullptr, 1024 * 1024, SPLICE_F_MOVE);
+                if (n <= 0) break;
+                while (n > 0) {
+                    ssize_t moved = ::splice(pipe_fds[0], nullptr, receiver_fd, nullptr, n, SPLICE_F_MOVE);
+                    if (moved <= 0) {
+                        ok = false;
+                        break;
+                    }
+                    n -= moved;
+                }
+            }
+            ::close(pipe_fds[0]);
+            ::close(pipe_fds[1]);
+        }
+    }
+    result->cpu_seconds = thread_cpu_seconds() - cpu_start;
+    result->ok = ok;
+    if (!ok) result->error = "aktarım hatası";
+    ::shutdown(receiver_fd, SHUT_WR);
+    receiver.tls.reset();
+    sender.tls.reset();
+    ::close(receiver_fd);
+    ::close(sender_fd);
+}
+
+static void run_mode(Mode mode, size_t total_bytes, const TlsContext* server_context, const TlsContext* client_context) {
+    int listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if (listen_fd < 0 || ::bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        ::listen(listen_fd, 4) < 0 || ::getsockname(listen_fd, (struct sockaddr*)&address, &address_len) < 0) {
+        throw std::runtime_error("dinleyen soket açılamadı");
+    }
+    int port = ntohs(address.sin_port);
+    if (mode == MODE_PLAIN) server_context = client_context = nullptr;
+
+    ForwardResult forward;
+    std::thread forwarder(run_forwarder, listen_fd, mode, server_context, &forward);
+
+    // Alıcı önce bağlanır; aktarıcı bağlantıları bu sırayla kabul eder
+    Endpoint receiver, sender;
+    int receiver_fd = connect_loopback(port);
+    size_t received = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::thread receiver_thread([&]() {
+        if (receiver_fd < 0 || !open_endpoint(receiver, receiver_fd, client_context)) return;
+        std::vector<char> buffer(CHUNK);
+        ssize_t n;
+        while ((n = receiver.read(buffer.data(), buffer.size())) > 0) received += (size_t)n;
+    });
+    int sender_fd = connect_loopback(port);
+    if (sender_fd >= 0 && open_endpoint(sender, sender_fd, client_context)) {
+        std::vector<char> chunk(CHUNK);
+        for (size_t i = 0; i < chunk.size(); ++i) chunk[i] = (char)(i * 31);
+        start = std::chrono::steady_clock::now();
+        size_t sent = 0;
+        while (sent < total_bytes) {
+            size_t len = std::min(chunk.size(), total_bytes - sent);
+            ssize_t n = sender.write(chunk.data(), len);
+            if (n <= 0) break;
+            sent += (size_t)n;
+        }
+        if (sender.tls) sender.tls->shutdown();
+        ::shutdown(sender_fd, SHUT_WR);
+    }
+    forwarder.join();
+    receiver_thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sender.tls.reset();
+    receiver.tls.reset();
+    if (sender_fd >= 0) ::close(sender_fd);
+    if (receiver_fd >= 0) ::close(receiver_fd);
+    ::close(listen_fd);
+
+    if (!forward.error.empty() && received == 0) {
+        printf("%-10s %s\n", mode_name(mode), forward.error.c_str());
+        return;
+    }
+    double gigabytes = received / 1e9;
+    printf("%-10s %10.1f %14.3f %10s\n", mode_name(mode), received / seconds / 1e6,
+           gigabytes > 0 ? forward.cpu_seconds / gigabytes : 0.0, received == total_bytes ? "tam" : "EKSİK");
+}
+
+int main(int argc, char* argv[]) {
+    signal(SIGPIPE, SIG_IGN); // OpenSSL write(2) kullanır; kapanan aktarıcı süreci sonlandırmasın
+    size_t megabytes = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1024;
+    if (megabytes == 0) {
+        fprintf(stderr, "Kullanım: %s [megabyte] [plain|userspace|ktls ...]\n", argv[0]);
+        return 1;
+    }
+    std::vector<Mode> modes;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "plain") {
+            modes.push_back(MODE_PLAIN);
+        } else if (arg == "userspace") {
+            modes.push_back(MODE_USERSPACE);
+        } else if (arg == "ktls") {
+            modes.push_back(MODE_KTLS);
+        } else {
+            fprintf(stderr, "Bilinmeyen mod: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (modes.empty()) modes = { MODE_PLAIN, MODE_USERSPACE, MODE_KTLS };
+
+    std::string cert_path, key_path;
+    if (!write_self_signed(&cert_path, &key_path)) {
+        fprintf(stderr, "Geçici sertifika üretilemedi.\n");
+        return 1;
+    }
+    std::unique_ptr<TlsContext> server_context, client_context;
+    try {
+        server_context = TlsContext::server(cert_path, key_path);
+        client_context = TlsContext::client("");
+    } catch (const std::runtime_error& e) {
+        fprintf(stderr, "TLS bağlamı oluşturulamadı: %s\n", e.what());
+        unlink(cert_path.c_str());
+        unlink(key_path.c_str());
+        return 1;
+    }
+    unlink(cert_path.c_str());
+    unlink(key_path.c_str());
+
+    printf("Veri: %zu MB, loopback, tek yön (gönderen -> aktarıcı -> alıcı)\n", megabytes);
+    printf("%-10s %10s %14s %10s\n", "mod", "MB/sn", "CPU sn/GB", "veri");
+    try {
+        for (Mode mode : modes) {
+            // Kullanıcı alanı modunda OpenSSL anahtarları çekirdeğe vermemeli
+            server_context->set_ktls(mode == MODE_KTLS);
+            client_context->set_ktls(mode == MODE_KTLS);
+            run_mode(mode, megabytes * 1024 * 1024, server_context.get(), client_context.get());
+        }
+    } catch (const std::runtime_error& e) {
+        fprintf(stderr, "Hata: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
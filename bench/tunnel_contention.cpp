@@ -0,0 +1,198 @@
+// 64 eşzamanlı tünelde, tünel veri yolunun global kilitten etkilenip etkilenmediğini ölçer.
+//
+// Kullanım: ./tunnel_contention [tunel_sayisi] [sure_saniye]
+//
+// Her tünel kendi thread'inde, gerçek TunnelSession nesnesiyle socketpair'ler üzerinden
+// 4 KB'lık parçalar aktarır. Aynı anda ayrı bir thread sürekli connect/accept benzeri kayıt
+// işlemleri (ekle/bul/sil) yapar. Fark ancak çok çekirdekli bir makinede görünür; tek
+// çekirdekte thread'ler zaten sırayla çalıştığı için kilit çekişmesi oluşmaz.
+// İki mod karşılaştırılır:
+//   global : Eski yol. Her parça için global mutex alınır ve iki unordered_map araması yapılır;
+//            kayıt işlemleri de aynı mutex'i kullanır.
+//   session: Yeni yol. Parça doğrudan oturum nesnesine verilir; kayıt işlemleri parçalı
+//            ClientRegistry üzerinden yapılır ve veri yoluyla hiç kesişmez.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "client_info.h"
+#include "client_registry.h"
+#include "event_loop.h"
+#include "tunnel_session.h"
+
+static const size_t CHUNK_SIZE = 4096;
+
+struct BenchTunnel {
+    int viewer_app, viewer_relay;  // İstemci A <-> relay
+    int sharer_app, sharer_relay;  // İstemci B <-> relay
+};
+
+static bool make_pair(int& app_end, int& relay_end) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) return false;
+    app_end = fds[0];
+    relay_end = fds[1];
+    ::fcntl(relay_end, F_SETFL, ::fcntl(relay_end, F_GETFL, 0) | O_NONBLOCK);
+    return true;
+}
+
+// Tek bir tüneli sürer: B'ye yaz, relay adımını çalıştır, A'dan oku
+static void run_tunnel(const BenchTunnel& t, bool global_mode, std::mutex& global_mutex,
+                       std::unordered_map<std::string, ClientInfo*>& global_map, int index,
+                       std::atomic<bool>& stop, std::atomic<unsigned long>& chunks) {
+    EventLoop loop;
+    ClientInfo viewer, sharer;
+    viewer.socket_fd = t.viewer_relay;
+    viewer.id = CLIENT_ID_MIN + 2 * index;
+    sharer.socket_fd = t.sharer_relay;
+    sharer.id = CLIENT_ID_MIN + 2 * index + 1;
+    sharer.peer_id = viewer.id;
+    // Eski kayıt defteri metin ID'leriyle anahtarlanıyordu
+    std::string viewer_key = "A" + std::to_string(index), sharer_key = "B" + std::to_string(index);
+    TunnelSession session(loop, viewer, sharer, false);
+    // Oturum durdurulan okumayı EPOLL_CTL_MOD ile sürdürür; bu yüzden uçlar döngüye kayıtlı olmalı
+    loop.add(viewer.socket_fd, CLIENT_EVENTS, [](uint32_t) {});
+    loop.add(sharer.socket_fd, CLIENT_EVENTS, [](uint32_t) {});
+
+    if (global_mode) {
+        std::lock_guard<std::mutex> lock(global_mutex);
+        global_map[viewer_key] = &viewer;
+        global_map[sharer_key] = &sharer;
+    }
+
+    std::vector<char> chunk(CHUNK_SIZE, 'x');
+    std::vector<char> sink(CHUNK_SIZE);
+    unsigned long local_chunks = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (::write(t.sharer_app, chunk.data(), chunk.size()) <= 0) break;
+
+        if (global_mode) {
+            // Eski handle_client: kilidi al, kendini ve peer'i haritada ara, sonra gönder
+            std::lock_guard<std::mutex> lock(global_mutex);
+            ClientInfo* self = global_map.at(sharer_key);
+            global_map.at(viewer_key);
+            session.forward_from(*self);
+        } else {
+            session.forward_from(sharer);
+        }
+        // A'nın soket tamponu dolduysa kalan veriyi boşalt (olay döngüsünün EPOLLOUT işini yap)
+        while (!viewer.output_buffer.empty() || sharer.read_paused) {
+            if (!flush_output(viewer)) break;
+            if (viewer.output_buffer.empty()) session.on_writable(viewer);
+            if (!viewer.output_buffer.empty()) break;
+        }
+
+        size_t got = 0;
+        while (got < CHUNK_SIZE) {
+            ssize_t n = ::read(t.viewer_app, sink.data(), CHUNK_SIZE - got);
+            if (n <= 0) break;
+            got += n;
+        }
+        ++local_chunks;
+    }
+    chunks += local_chunks;
+
+    if (global_mode) {
+        std::lock_guard<std::mutex> lock(global_mutex);
+        global_map.erase(viewer_key);
+        global_map.erase(sharer_key);
+    }
+}
+
+// connect/accept trafiğini taklit eder: istemci ekle, iki kez ara, sil
+static void run_control_churn(bool global_mode, std::mutex& global_mutex,
+                              std::unordered_map<std::string, ClientInfo*>& global_map,
+                              ClientRegistry& registry, std::atomic<bool>& stop,
+                              std::atomic<unsigned long>& operations) {
+    ClientInfo dummy;
+    auto client = std::make_shared<ClientInfo>();
+    unsigned long ops = 0;
+    unsigned long counter = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (global_mode) {
+            std::lock_guard<std::mutex> lock(global_mutex);
+            std::string id = "C" + std::to_string(counter++ % 1000);
+            global_map[id] = &dummy;
+            global_map.count(id);
+            global_map.count(id);
+            global_map.erase(id);
+        } else {
+            ClientId id = registry.register_client(client);
+            registry.find(id);
+            registry.find(id);
+            registry.remove(id);
+        }
+        ++ops;
+    }
+    operations += ops;
+}
+
+static void run_mode(bool global_mode, int tunnel_count, int seconds) {
+    std::vector<BenchTunnel> tunnels(tunnel_count);
+    for (auto& t : tunnels) {
+        if (!make_pair(t.viewer_app, t.viewer_relay) || !make_pair(t.sharer_app, t.sharer_relay)) {
+            perror("socketpair");
+            return;
+        }
+    }
+
+    std::mutex global_mutex;
+    std::unordered_map<std::string, ClientInfo*> global_map;
+    ClientRegistry registry;
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned long> chunks(0), operations(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < tunnel_count; ++i) {
+        threads.emplace_back(run_tunnel, std::cref(tunnels[i]), global_mode, std::ref(global_mutex),
+                             std::ref(global_map), i, std::ref(stop), std::ref(chunks));
+    }
+    threads.emplace_back(run_control_churn, global_mode, std::ref(global_mutex), std::ref(global_map),
+                         std::ref(registry), std::ref(stop), std::ref(operations));
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    // Bloklanmış okuma/yazmaları serbest bırakmak için uygulama uçlarını kapat
+    for (auto& t : tunnels) {
+        ::shutdown(t.viewer_app, SHUT_RDWR);
+        ::shutdown(t.sharer_app, SHUT_RDWR);
+    }
+    for (auto& th : threads) th.join();
+    for (auto& t : tunnels) {
+        ::close(t.viewer_app); ::close(t.viewer_relay);
+        ::close(t.sharer_app); ::close(t.sharer_relay);
+    }
+
+    double mb_per_sec = (double)chunks * CHUNK_SIZE / (1024.0 * 1024.0) / seconds;
+    std::cout << (global_mode ? "global " : "session") << " | tünel: " << tunnel_count
+              << " | parça/s: " << chunks / seconds
+              << " | MB/s: " << mb_per_sec
+              << " | kontrol işlemi/s: " << operations / seconds << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int tunnel_count = 64;
+    int seconds = 5;
+    try {
+        if (argc > 1) tunnel_count = std::stoi(argv[1]);
+        if (argc > 2) seconds = std::stoi(argv[2]);
+    } catch (const std::exception& e) {
+        std::cerr << "Kullanım: " << argv[0] << " [tunel_sayisi] [sure_saniye]" << std::endl;
+        return 1;
+    }
+
+    run_mode(true, tunnel_count, seconds);
+    run_mode(false, tunnel_count, seconds);
+    return 0;
+}
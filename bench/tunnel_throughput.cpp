@@ -0,0 +1,88 @@
+// Tek bir VNC tünelinden geçen trafiğin hızını ve relay'in GB başına CPU maliyetini ölçer.
+//
+// Kullanım: ./tunnel_throughput <sunucu_ip> <sunucu_port> <megabyte> <sunucu_pid>
+//
+// Paylaşan taraf (sharer) tünele <megabyte> MB veri yazar, görüntüleyen taraf (viewer) hepsini
+// okur. splice ve kopyalama yollarını karşılaştırmak için sunucuyu bir kez normal, bir kez
+// '--no-splice' ile çalıştırın.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "bench_common.h"
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port> <megabyte> <sunucu_pid>" << std::endl;
+        return 1;
+    }
+
+    int server_port = 0, server_pid = 0;
+    size_t total_bytes = 0;
+    try {
+        server_port = std::stoi(argv[2]);
+        total_bytes = std::stoul(argv[3]) * 1024 * 1024;
+        server_pid = std::stoi(argv[4]);
+    } catch (const std::exception& e) {
+        std::cerr << "Hata: Geçersiz sayısal argüman. " << e.what() << std::endl;
+        return 1;
+    }
+
+    int viewer = bench::connect_to_relay(argv[1], server_port);
+    int sharer = bench::connect_to_relay(argv[1], server_port);
+    if (viewer < 0 || sharer < 0) {
+        perror("Relay'e bağlanılamadı");
+        return 1;
+    }
+    if (!bench::establish_tunnel(viewer, sharer)) {
+        std::cerr << "Hata: Tünel kurulamadı." << std::endl;
+        return 1;
+    }
+
+    double cpu_before = bench::read_process_cpu_seconds(server_pid);
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread writer([sharer, total_bytes]() {
+        std::vector<char> chunk(256 * 1024, 'x');
+        size_t sent = 0;
+        while (sent < total_bytes) {
+            size_t len = std::min(chunk.size(), total_bytes - sent);
+            ssize_t n = ::send(sharer, chunk.data(), len, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+    });
+
+    std::vector<char> buffer(256 * 1024);
+    size_t received = 0;
+    while (received < total_bytes) {
+        ssize_t n = ::read(viewer, buffer.data(), buffer.size());
+        if (n <= 0) break;
+        received += n;
+    }
+    writer.join();
+
+    auto end = std::chrono::steady_clock::now();
+    double cpu_after = bench::read_process_cpu_seconds(server_pid);
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double gigabytes = (double)received / (1024.0 * 1024.0 * 1024.0);
+
+    std::cout << "Aktarılan veri        : " << received / (1024 * 1024) << " MB" << std::endl;
+    std::cout << "Süre                  : " << seconds << " s" << std::endl;
+    std::cout << "Hız                   : " << (received / (1024.0 * 1024.0)) / seconds << " MB/s" << std::endl;
+    std::cout << "Relay CPU             : " << (cpu_after - cpu_before) << " s" << std::endl;
+    if (gigabytes > 0) {
+        std::cout << "Relay CPU / GB        : " << (cpu_after - cpu_before) / gigabytes << " s" << std::endl;
+    }
+
+    ::close(viewer);
+    ::close(sharer);
+    return received == total_bytes ? 0 : 1;
+}
@@ -2,14 +2,55 @@
 #define CLIENT_UTILS_H
 
 #include <string>
+#include <functional> // std::function
 #include <atomic> // std::atomic için
 #include <mutex>  // std::mutex için
 
+#include "vnc_proxy.h"
+#include "vnc_server_manager.h"
+
 extern std::atomic<bool> running;
 extern std::mutex cout_mutex;
 extern std::atomic<bool> client_a_waiting_for_tunnel_activation; // <<-- BU SATIRI EKLEYİN
+// Boş değilse paylaşan tarafın VNC trafiği bu dizine kaydedilir ('--capture=', bkz. capture.h)
+extern std::string capture_dir;
+// '--compress': iki ajan da isterse VNC tüneli sıkıştırılır (bkz. tunnel_compression.h)
+extern bool tunnel_compression;
+// '--p2p': VNC oturumu önce ajanlar arası doğrudan yoldan denenir (bkz. direct_session.h)
+extern bool p2p_enabled;
+// Relay'in IP adresi (main.cpp); doğrudan bağlantının buluşma noktası da odur
+extern std::string relay_ip;
+// Paylaşan tarafın yerel VNC sunucusu (127.0.0.1:5900); connection_established ile bağlantı alınır
+extern VncServerManager local_vnc_server;
 // --- Fonksiyon Bildirimleri ---
 
+/**
+ * @brief Relay'e bağlı sokette TLS 1.3 el sıkışması yapar. Çekirdek destekliyorsa anahtarlar kTLS ile
+ * çekirdeğe verilir ve aynı soket döner; desteklemiyorsa şifrelemeyi yapan bir köprü thread'i başlatılır
+ * ve onun Unix soketi döner. Dönen soket her iki durumda da düz soket gibi okunup yazılır.
+ * @param sock Sunucuya bağlı (engelleyen) TCP soketi.
+ * @param ca_file Sunucu sertifikasını doğrulamak için CA dosyası (boşsa doğrulanmaz).
+ * @param c_mutex_ref Konsol çıktıları için paylaşılan mutex'e referans.
+ * @return Kullanılacak soket veya hata durumunda -1 (sock kapatılmaz).
+ */
+int secure_relay_connection(int sock, const std::string& ca_file, std::mutex& c_mutex_ref);
+
+/**
+ * @brief Relay bağlantısını kanal çoğullamaya geçirir ("mux" -> "MUX_OK", bkz. mux_link.h). Köprü kendi
+ * thread'inde çalışır; dönen kontrol ucu komut satırları için relay soketinin yerine kullanılır. Bundan
+ * sonra VNC verisi veri kanallarından akar ve tünel sürerken de komut gönderilip relay mesajları alınır.
+ * @param sock Relay bağlantısı (köprü kurulursa köprü sahiplenir).
+ * @param preamble "MUX_OK"tan önce okunan satırlar (ör. ID); çağıran bunları alıcı thread'den önce işler.
+ * @param c_mutex_ref Konsol çıktıları için paylaşılan mutex'e referans.
+ * @return Kontrol ucu; relay çoğullamayı desteklemiyorsa sock (tek kanal sürer); hata durumunda -1.
+ */
+int start_mux_link(int sock, std::string* preamble, std::mutex& c_mutex_ref);
+
+/**
+ * @brief Relay bağlantısı çoğullanmış mı (start_mux_link başarılı oldu mu)?
+ */
+bool mux_enabled();
+
 /**
  * @brief Sunucuya formatlanmış bir mesaj gönderir (sonuna '\n' ekler).
  * @param sock Sunucuya bağlı olan soket tanımlayıcısı.
@@ -31,37 +72,42 @@ void process_server_message(const std::string& server_msg_line,
                             int sock_to_server);
 
 /**
- * @brief Platforma göre uygun VNC sunucusunu başlatmayı dener (Kontrol Edilen İstemci - Agent B için).
- * Bu fonksiyon çağrıldığında cout_mutex'in dışarıda (process_server_message içinde)
- * zaten kilitli olduğu varsayılır, bu yüzden içindeki std::cout çağrıları güvendedir.
+ * @brief Tek kanallı bağlantıda relay TUNNEL_ACTIVE gönderdi ve oturumun yerel ucu (paylaşan tarafta yerel
+ * VNC bağlantısı, görüntüleyen tarafta libVNCclient'in soket çifti) bekliyor mu? Alıcı thread her komut
+ * satırından sonra bakar; true ise relay soketini okumayı bırakıp run_sharer_vnc_session'ı çağırır.
  */
-void start_vnc_server();
+bool sharer_vnc_session_ready();
 
 /**
- * @brief Yerel VNC sunucusundan veri okur ve relay sunucusuna gönderir (Kontrol Edilen İstemci - Agent B için).
- * Bu fonksiyon yeni bir thread üzerinde çalıştırılmak üzere tasarlanmıştır.
- * @param local_vnc_fd Yerel VNC sunucusuna (örn. wayvnc) olan soket tanımlayıcısı.
- * @param sock_to_relay Merkezi relay sunucusuna olan soket tanımlayıcısı.
- * @param app_is_running_ref Ana uygulamanın genel çalışma durumunu gösteren atomik boolean'a referans.
- * @param c_mutex_ref Konsol çıktıları için paylaşılan mutex'e referans.
+ * @brief Relay'e yeniden bağlanıp (TLS dahil) kullanılacak soketi döner; bağlanılamazsa -1.
  */
-void vnc_uplink_thread_func(int local_vnc_fd,
-                            int sock_to_relay,
-                            std::atomic<bool>& app_is_running_ref,
-                            std::mutex& c_mutex_ref);
+using RelayConnector = std::function<int()>;
 
 /**
- * @brief Relay sunucusundan gelen VNC verisini alır ve libVNCclient ile işler (Kontrol Eden İstemci - Agent A için).
- * Bu fonksiyon yeni bir thread üzerinde çalıştırılmak üzere tasarlanmıştır.
- * @param sock_to_relay Merkezi relay sunucusuna olan soket tanımlayıcısı.
- * @param app_is_running_ref Ana uygulamanın genel çalışma durumunu gösteren atomik boolean'a referans.
- * @param c_mutex_ref Konsol çıktıları için paylaşılan mutex'e referans.
+ * @brief Bekleyen VNC oturumunu çağıran thread'de VncProxy ile yürütür (yerel uç <-> relay, tek
+ * thread, poll ile) ve oturum bitince döner. Relay tünelden çıkmak için bağlantının kapanmasını
+ * beklediğinden çağıran ardından relay'e yeniden bağlanır.
+ * @param sock_to_relay Relay soketi; oturum boyunca yalnızca vekil tarafından okunur.
+ * @param from_relay TUNNEL_ACTIVE satırından sonra alıcı thread'in okuduğu tünel verisi.
+ * @param reconnect Verilirse ve relay TUNNEL_ACTIVE ile belirteç gönderdiyse, relay bağlantısı koptuğunda
+ * yeni bağlantı açılıp "resume" ile oturum kaldığı yerden sürdürülür; yeni bağlantı sock_to_relay
+ * numarasına konur (dup2).
+ * @return Oturumun nasıl bittiği.
+ */
+VncProxy::Result run_sharer_vnc_session(int sock_to_relay, const std::string& from_relay,
+                                        const RelayConnector& reconnect = RelayConnector());
+
+/**
+ * @brief Sürmekte olan paylaşan oturumu var mı?
+ */
+bool vnc_session_active();
+
+/**
+ * @brief Sürmekte olan paylaşan oturumunu ve çoğullanmış bağlantıda görüntüleyici oturumunu sonlandırır
+ * (herhangi bir thread'den); oturum yoksa bir şey yapmaz.
  */
+void cancel_vnc_session();
 
-void vnc_control_downlink_thread_func(int local_vnc_fd,
-                                      int sock_to_relay,
-                                      std::atomic<bool>& app_is_running_ref,
-                                      std::mutex& c_mutex_ref);
 // manage_vnc_proxy_session_thread fonksiyonu, libVNCclient'in doğrudan entegrasyonuyla
 // şimdilik gereksiz hale geldiği için kaldırıldı. Eğer İstemci A'nın ayrı bir
 // yerel VNC proxy sunucusu gibi davranması istenirse tekrar eklenebilir.
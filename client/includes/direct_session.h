@@ -0,0 +1,108 @@
+#ifndef DIRECT_SESSION_H
+#define DIRECT_SESSION_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+class HolePuncher;
+class UdpStream;
+
+/**
+ * @brief Doğrudan yoldan relay tüneline geçerken akışın kaldığı yer. Relay tünelinin ilk 8 byte'ı
+ * (ağ bayt sırasıyla) her uçta received'dır; uç, eşin bildirdiği konumdan outbound'u gönderir.
+ */
+struct DirectHandover {
+    uint64_t received = 0;  // Eşten doğrudan yoldan alınan toplam byte
+    uint64_t sent_base = 0; // outbound'un ilk byte'ının akıştaki konumu (eşin onayladığı)
+    std::string outbound;   // Yerelden okunmuş, eşin onaylamadığı veri
+    std::string to_local;   // Eşten alınmış, yerel uca yazılmamış veri
+};
+
+/**
+ * @brief '--p2p' ile VNC oturumunu relay tüneli yerine ajanlar arası doğrudan UDP yolundan yürütür
+ * (bkz. p2p_link.h). Kendi thread'inde çalışır: "p2p" gönderir, alıcı thread'in ilettiği P2P_BIND /
+ * P2P_CANDIDATES satırlarıyla hole punching yapar, yol bulunursa "p2p_result direct" gönderir ve yerel
+ * uç (paylaşan tarafta yerel VNC bağlantısı, görüntüleyen tarafta libVNCclient'in soket çiftinin ucu)
+ * ile eş arasında veriyi aktarır. Relay bağlantısı bu sürede komut modunda kalır.
+ *
+ * Yol PUNCH_TIMEOUT_MS içinde bulunamazsa, relay doğrudan bağlantıyı desteklemiyorsa, eş P2P_FALLBACK
+ * ile relay'e dönerse ya da yol aktarım sırasında koparsa on_fallback çağrılır ("p2p_result relay"
+ * gerekiyorsa önceden gönderilmiştir); çağıran relay tüneline geçer ve akış DirectHandover'daki
+ * konumdan sürer. Yerel uç kapanınca kalan veri eşe iletilir ve uçlardan önce kapanan "disconnect"
+ * gönderir. Doğrudan yolda tünel sıkıştırması ve kayıt kullanılmaz.
+ */
+class DirectSession : public std::enable_shared_from_this<DirectSession> {
+public:
+    struct Hooks {
+        // Görüntüleyen taraf: yol kurulunca görüntüleyiciyi başlatır, soket çiftinin vekil ucunu döner (-1: hata)
+        std::function<int()> open_viewer;
+        // Relay tüneline dönülmeli; local_fd (varsa, -1 olabilir) ve akışın konumu çağırana geçer
+        std::function<void(DirectSession* session, int local_fd, DirectHandover handover)> on_fallback;
+        // Oturum doğrudan yolda bitti veya iptal edildi
+        std::function<void(DirectSession* session, const std::string& summary)> on_finished;
+    };
+
+    DirectSession(int sock_to_server, const std::string& relay_ip, const std::string& my_id, bool viewer, Hooks hooks);
+    ~DirectSession();
+
+    DirectSession(const DirectSession&) = delete;
+    DirectSession& operator=(const DirectSession&) = delete;
+
+    /**
+     * @brief UDP soketini açar, relay'e "p2p <yerel aday>" gönderir ve thread'i başlatır.
+     * @return Başlatılamazsa false (çağıran relay tüneline geçer).
+     */
+    bool start();
+
+    /**
+     * @brief Alıcı thread'den relay satırı (P2P_BIND, P2P_CANDIDATES, P2P_FALLBACK, "P2P:" hataları).
+     */
+    void on_control(const std::string& type, const std::string& argument);
+
+    /**
+     * @brief Paylaşan taraf: hazırlanan yerel VNC bağlantısını oturuma verir.
+     * @return Oturum relay'e döndüyse veya bittiyse false; bağlantı çağıranda kalır.
+     */
+    bool offer_local_fd(int fd);
+
+    /**
+     * @brief Oturumu relay'e mesaj göndermeden bitirir (eşleşme bitti); yerel uç kapatılır.
+     */
+    void cancel();
+
+private:
+    enum Outcome { DIRECT_FINISHED, DIRECT_FALLBACK, DIRECT_CANCELLED };
+
+    void run();
+    bool punch(bool* send_result);
+    Outcome bridge(bool* send_result);
+    void fall_back(bool send_result);
+    bool take_lines(std::deque<std::pair<std::string, std::string>>* lines);
+
+    int sock_to_server_;
+    std::string relay_ip_;
+    std::string my_id_;
+    bool viewer_;
+    Hooks hooks_;
+    int wake_fd_ = -1;
+    std::unique_ptr<HolePuncher> puncher_;
+    std::unique_ptr<UdpStream> stream_;
+    int local_fd_ = -1;
+    std::string to_local_; // Eşten alınmış, yerel uca yazılmayı bekleyen veri
+    size_t to_local_off_ = 0;
+    uint64_t local_to_peer_ = 0;
+    uint64_t peer_to_local_ = 0;
+
+    std::mutex mutex_; // Aşağıdakiler thread ile diğer thread'ler arasında paylaşılır
+    std::deque<std::pair<std::string, std::string>> lines_;
+    int offered_fd_ = -1;
+    bool accepting_ = true; // Relay'e dönüldü veya bittiyse yerel bağlantı alınmaz
+    bool cancelled_ = false;
+};
+
+#endif // DIRECT_SESSION_H
@@ -0,0 +1,153 @@
+#ifndef VNC_PROXY_H
+#define VNC_PROXY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class CaptureWriter;
+class RingBuffer;
+class TunnelCompressor;
+class TunnelDecompressor;
+
+/**
+ * @brief Paylaşan taraf (Agent B) için yerel VNC sunucusu ile relay arasında iki yönlü vekil.
+ * Tek thread'de poll(2) ile iki soketi birlikte sürer; yön başına bir tampon tutar, kısmi
+ * gönderimleri tamamlar ve karşı taraf yavaşsa o yönün kaynağından okumayı bekletir.
+ *
+ * Yerel VNC soketinin sahibidir (yıkıcı kapatır); relay soketi yalnızca oturum boyunca
+ * kullanılır ve çıkışta eski dosya bayraklarına döndürülür. Relay bağlantısı komut kanalıyla
+ * paylaşıldığı için yazma yönü kapatılmaz: yerel VNC kapanınca kalan veri relay'e gönderilir ve
+ * oturum biter. Relay kapanınca kalan veri yerel VNC'ye gönderilir, yerel soketin yazma yönü
+ * kapatılır (shutdown) ve yerel taraf kapanana kadar beklenir.
+ *
+ * Oturum kendi iptal tanıtıcısıyla (eventfd) durdurulur; cancel başka bir thread'den çağrılabilir.
+ * Veri yolunda konsola veya günlüğe parça başına yazılmaz; oturum sonunda özet günlüğe yazılır.
+ *
+ * Tünel sıkıştırması açıksa (enable_compression) yerel taraftan okunan veri relay'e sıkıştırılarak
+ * gönderilir, relay'den gelen veri çözülerek yerele yazılır (bkz. tunnel_compression.h). Aynı sınıf
+ * görüntüleyen tarafta da kullanılır: "yerel" uç orada libVNCclient'e verilen soket çiftinin ucudur.
+ *
+ * Devam ettirme açıksa (enable_resume) relay bağlantısı koptuğunda yerel taraf kapatılmaz: run
+ * PROXY_RELAY_LOST döner, tamponlar korunur. Çağıran yeni bağlantıyı aynı soket numarasına koyup
+ * resume ile relay'in aldığı konuma döner ve run'ı yeniden çağırır; relay'e gönderilmiş ama
+ * ulaşmamış veri saklanan kopyadan yeniden gönderilir.
+ */
+class VncProxy {
+public:
+    enum Result {
+        PROXY_LOCAL_CLOSED, // Yerel VNC sunucusu bağlantıyı kapattı
+        PROXY_RELAY_CLOSED, // Relay bağlantısı kapandı
+        PROXY_CANCELLED,    // cancel() çağrıldı
+        PROXY_FAILED,       // Okuma/yazma hatası
+        PROXY_RELAY_LOST    // Relay bağlantısı koptu, oturum devam ettirilebilir (yalnızca enable_resume ile)
+    };
+
+    /**
+     * @throws std::system_error iptal tanıtıcısı oluşturulamazsa (local_fd yine de kapatılır).
+     */
+    VncProxy(int local_fd, int relay_fd);
+    ~VncProxy(); // Sıkıştırma ve yeniden gönderim nesneleri eksik tür olduğundan kaynak dosyada tanımlıdır
+
+    VncProxy(const VncProxy&) = delete;
+    VncProxy& operator=(const VncProxy&) = delete;
+
+    /**
+     * @brief Trafiği ayrıca kaydeder (yön 0: yerel VNC -> relay, yön 1: relay -> yerel VNC).
+     * run'dan önce çağrılır.
+     */
+    void capture_to(std::unique_ptr<CaptureWriter> writer);
+
+    /**
+     * @brief Relay tarafını sıkıştırılmış akışa çevirir (iki uç da "deflate" tünel seçeneğinde anlaştı).
+     * Kayıt her zaman sıkıştırılmamış veriyi tutar. run'dan önce çağrılır.
+     * @throws std::runtime_error zlib akışı oluşturulamazsa.
+     */
+    void enable_compression();
+
+    /**
+     * @brief Relay bağlantısı koparsa oturumu devam ettirilebilir bırakır (PROXY_RELAY_LOST). Relay'e
+     * gönderilen son replay_bytes byte yeniden gönderim için saklanır. run'dan önce çağrılır.
+     */
+    void enable_resume(size_t replay_bytes);
+
+    /**
+     * @brief PROXY_RELAY_LOST'tan sonra akışı relay'in bildirdiği konuma geri alır; relay_received'dan
+     * sonraki veri sonraki run'da önce yeniden gönderilir.
+     * @param relay_received Relay'in bu uçtan aldığı toplam byte ("RESUMED <n>").
+     * @return Eksik veri artık saklanmıyorsa false.
+     */
+    bool resume(uint64_t relay_received);
+
+    /**
+     * @brief Oturum doğrudan (P2P) yoldan relay tüneline geçerken akışı kaldığı yerden devralır. run'dan
+     * önce çağrılır.
+     * @param to_relay Yerelden okunmuş ama eşe ulaşmamış veri; yerelden okunan yeni veriden önce (sıkıştırma
+     * açıksa sıkıştırılarak) relay'e gider.
+     * @param to_local Eşten alınmış, yerel uca yazılmamış veri; relay'den gelenden önce yazılır.
+     * @param relay_offset Vekilden önce tünelde iki yönde de aktarılan byte (devam ettirme konumlarına sayılır).
+     */
+    void take_over(const std::string& to_relay, const std::string& to_local, uint64_t relay_offset);
+
+    /**
+     * @brief timeout_ms boyunca cancel bekler (devam ettirme denemeleri arasında).
+     * @return cancel çağrıldıysa true.
+     */
+    bool wait_for_cancel(int timeout_ms);
+
+    /**
+     * @brief Oturum bitene kadar trafiği aktarır.
+     * @param from_relay Relay'den komut satırlarıyla birlikte okunmuş, henüz aktarılmamış tünel verisi.
+     */
+    Result run(const std::string& from_relay = std::string());
+
+    /**
+     * @brief Oturumu sonlandırır (herhangi bir thread'den); run kısa sürede PROXY_CANCELLED döner.
+     */
+    void cancel();
+
+    uint64_t bytes_to_relay() const { return flows_[0].total; }
+    uint64_t bytes_to_local() const { return flows_[1].total; }
+    uint64_t bytes_from_relay() const { return relay_received_; } // Relay'den okunan (tel üzerindeki) byte
+
+    static const char* result_name(Result result);
+
+private:
+    static const size_t BUFFER_SIZE = 64 * 1024;
+
+    // Tek yön: from'dan okunan veri to'ya gönderilene kadar tamponda bekler. Sıkıştırma açıksa
+    // gönderilecek veri (sıkıştırılmış veya çözülmüş) coded'dadır.
+    struct Flow {
+        int from = -1;
+        int to = -1;
+        std::unique_ptr<char[]> buffer;
+        std::string coded;
+        size_t len = 0;
+        size_t off = 0;
+        bool eof = false;  // Kaynak kapandı
+        uint64_t total = 0; // Hedefe gönderilen toplam byte
+    };
+
+    bool pump(Flow& flow, uint8_t direction);
+    bool accept_input(Flow& flow, uint8_t direction, size_t len);
+    const char* pending_data(const Flow& flow) const;
+
+    int local_fd_;
+    int relay_fd_;
+    int relay_flags_; // Relay soketinin run öncesi dosya bayrakları
+    int cancel_fd_;
+    Flow flows_[2];   // 0: yerel -> relay, 1: relay -> yerel
+    bool local_shut_ = false;
+    bool relay_lost_ = false;      // Relay soketinde hata (devam ettirme açıksa oturum bitmez)
+    uint64_t relay_received_ = 0;  // Relay'den okunan toplam byte (sıkıştırılmışsa sıkıştırılmış)
+    std::string relay_backlog_;    // run'a verilen, henüz aktarılmamış tünel verisi
+    std::string local_backlog_;    // take_over: yerelden okunmuş sayılan, relay'e gidecek veri
+    std::string to_local_backlog_; // take_over: yerel uca yazılacak (çözülmüş) veri
+    std::unique_ptr<RingBuffer> replay_; // Relay'e gönderilmiş, yeniden gönderim için saklanan veri
+    std::unique_ptr<CaptureWriter> capture_;
+    std::unique_ptr<TunnelCompressor> compressor_;     // Yön 0 (yerel -> relay)
+    std::unique_ptr<TunnelDecompressor> decompressor_; // Yön 1 (relay -> yerel)
+};
+
+#endif // VNC_PROXY_H
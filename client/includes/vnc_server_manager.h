@@ -0,0 +1,99 @@
+#ifndef VNC_SERVER_MANAGER_H
+#define VNC_SERVER_MANAGER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+/**
+ * @brief Paylaşan taraftaki (Agent B) yerel VNC sunucusunun yaşam döngüsü.
+ *
+ * Yerel VNC bağlantısı acquire ile alınır: önce adres denenir; cevap veren bir sunucu varsa (dışarıda
+ * başlatılmış veya önceki oturumdan kalan) hemen o kullanılır. Yoksa sunucu başlatılır ve bağlantı
+ * artan aralıklarla (10 ms'den 250 ms'ye) yeniden denenir; sunucunun çıktısında dinlemeye başladığını
+ * bildiren satır (ör. x11vnc'nin "PORT=5900") görülünce bekleme erken biter. Böylece oturum, sunucunun
+ * gerçekten ihtiyaç duyduğu süre kadar gecikir.
+ *
+ * Başlatılan sunucu birden fazla oturuma hizmet edecek şekilde çalıştırılır (x11vnc -forever -shared,
+ * wayvnc) ve oturumlar arasında açık kalır; start ile ajan açılırken önceden ısıtılabilir. Sunucu
+ * kendi thread'inde izlenir: çıktısı günlüğe yazılır, beklenmedik şekilde çıkarsa artan bekleme
+ * süresiyle (0,5 sn'den 30 sn'ye; 30 sn çalışırsa sıfırlanır) yeniden başlatılır. stop sunucuya
+ * SIGTERM gönderir, 2 sn içinde çıkmazsa SIGKILL ile sonlandırır.
+ *
+ * Komut verilmezse oturum türüne göre seçilir (XDG_SESSION_TYPE: wayland -> wayvnc, x11 -> x11vnc);
+ * uygun sunucu yoksa veya yönetim kapatıldıysa (set_managed(false)) yalnızca dışarıda çalışan
+ * sunucu beklenir. Tüm üyeler herhangi bir thread'den çağrılabilir.
+ */
+class VncServerManager {
+public:
+    VncServerManager(const std::string& host, int port);
+    ~VncServerManager();
+
+    VncServerManager(const VncServerManager&) = delete;
+    VncServerManager& operator=(const VncServerManager&) = delete;
+
+    /**
+     * @brief Sunucu başlatılmadan önce çağrılır. false: sunucu hiç başlatılmaz.
+     */
+    void set_managed(bool managed);
+
+    /**
+     * @brief Başlatılacak komutu (argv) belirler; boşsa oturum türüne göre seçilir.
+     */
+    void set_command(const std::vector<std::string>& argv);
+
+    /**
+     * @brief Adreste cevap veren bir sunucu yoksa sunucuyu başlatır ve beklemeden döner (önceden ısıtma).
+     * @return Sunucu çalışıyor, başlatıldı veya dışarıda çalışan bulundu ise true.
+     */
+    bool start();
+
+    /**
+     * @brief Yerel VNC sunucusuna bağlanır; gerekirse sunucuyu başlatır ve hazır olmasını bekler.
+     * @param timeout En fazla bekleme süresi.
+     * @param error Başarısızlıkta nedeni.
+     * @return Bağlı (engelleyen) soket veya -1.
+     */
+    int acquire(std::chrono::milliseconds timeout, std::string* error);
+
+    /**
+     * @brief Başlatılan sunucuyu durdurur ve izleme thread'ini bekler.
+     */
+    void stop();
+
+    const std::string& host() const { return host_; }
+    int port() const { return port_; }
+
+    /**
+     * @brief Oturum türüne uygun VNC sunucusu komutu; bulunamazsa boş.
+     */
+    std::vector<std::string> default_command() const;
+
+private:
+    int try_connect(int* error) const;
+    bool spawn(pid_t* pid, int* output_fd);
+    void supervise();
+    void watch_output(int output_fd);
+    int reap(pid_t pid);
+
+    const std::string host_;
+    const int port_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread supervisor_;
+    std::vector<std::string> command_;
+    bool managed_ = true;
+    bool stopping_ = false;
+    pid_t child_pid_ = -1;
+    uint64_t ready_count_ = 0; // Sunucu her dinlemeye başladığında artar; acquire beklemeyi erken bitirir
+    int wake_fd_ = -1;         // stop, çıktı okuyan poll'u uyandırır
+};
+
+#endif // VNC_SERVER_MANAGER_H
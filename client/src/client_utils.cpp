@@ -1,5 +1,11 @@
 #include "../includes/client_utils.h" // Kendi başlık dosyamız
 #include "../includes/vnc_viewer.h"
+#include "../includes/direct_session.h" // '--p2p': ajanlar arası doğrudan yol
+#include "../../include/logger.h"
+#include "../../include/tls_link.h" // Relay bağlantısı için TLS / kTLS
+#include "../../include/capture.h"  // VNC trafiği kaydı
+#include "../../include/mux_link.h" // Relay bağlantısında kanal çoğullama
+#include "../../include/tunnel_compression.h" // VNC tünelinin sıkıştırılması
 #include <iostream>
 #include <string>
 #include <vector>
@@ -13,6 +19,8 @@
 #include <cstdio>    // perror()
 #include <cstring>   // memset(), strdup()
 #include <cstdint>   // uint8_t için
+#include <memory>    // std::unique_ptr
+#include <stdexcept> // std::runtime_error
 #include <SDL2/SDL.h>     // SDL2 ana başlık dosyası
 #include <sys/select.h>   // select() fonksiyonu için
 // Ağ işlemleri için
@@ -20,16 +28,15 @@
 #include <netinet/in.h> // sockaddr_in, htons
 #include <arpa/inet.h>  // inet_pton, inet_ntoa
 #include <unistd.h>     // ::read, ::send, ::close, fork, execvp, _exit (POSIX)
+#include <fcntl.h>      // fcntl (O_NONBLOCK)
+#include <poll.h>       // poll (TLS köprüsü)
+#include <ctime>        // time (kayıt dosyası adı)
+#include <system_error> // std::system_error
+#include <sys/stat.h>   // mkdir (kayıt dizini)
 #include <rfb/rfbclient.h>
 
-#ifndef _WIN32
-#include <sys/types.h>  // pid_t
-#include <sys/wait.h>   // waitpid
-#endif
-
 // libVNCclient başlık dosyası
 extern std::atomic<bool> client_a_waiting_for_tunnel_activation;
-extern std::atomic<bool> client_a_vnc_data_mode_active; // YENİ EXTERN
 // --- Global Değişkenlere Erişim (client_main.cpp'de tanımlı olanlar) ---
 extern std::atomic<bool> running;
 extern std::mutex cout_mutex;
@@ -104,14 +111,6 @@ static char* GetPassword(rfbClient* client) {
 }
 
 // --- Diğer Yardımcı Fonksiyonlar ---
-#ifndef _WIN32
-bool command_exists(const std::string& command_name) {
-    std::string check_cmd = "which " + command_name + " > /dev/null 2>&1";
-    int ret = system(check_cmd.c_str());
-    return (ret == 0);
-}
-#endif
-
 bool send_server_message(int sock_fd, const std::string& message) {
     if (sock_fd <= 0) return false;
     std::string full_message = message + "\n";
@@ -128,210 +127,355 @@ bool send_server_message(int sock_fd, const std::string& message) {
     return (size_t)bytes_sent == full_message.length();
 }
 
-void start_vnc_server() {
-    // Bu fonksiyon çağrıldığında cout_mutex'in dışarıda kilitli olduğu varsayılır.
-    std::cout << "[DEBUG] Entering start_vnc_server function." << std::endl;
-    int result = -1;
-    std::string command_to_run_str;
-    char** argv_list = nullptr;
-    bool command_attempted = false;
-    bool proceed_to_execute = false;
-    std::string session_type_str = "unknown";
-
-    #ifdef _WIN32
-        std::cout << "[Platform] Windows algılandı." << std::endl;
-        std::cout << "[Bilgi] Önceden yüklenmiş VNC servisi başlatılıyor..." << std::endl;
-        const char* vnc_service_name = "YourVNCServiceName"; // !!! DEĞİŞTİRİLMELİ !!!
-        std::string command_to_run_win = "sc start ";
-        command_to_run_win += vnc_service_name;
-        std::cout << "[DEBUG] Windows komutu deneniyor: " << command_to_run_win << std::endl;
-        result = system(command_to_run_win.c_str());
-        command_attempted = true;
-        if (result == 0) {
-            std::cout << "[Bilgi] 'sc start " << vnc_service_name << "' komutu başarıyla çalıştırıldı (Kod: 0)." << std::endl;
-        } else {
-            std::cerr << "[Hata] VNC servisi ('" << vnc_service_name << "') başlatılamadı! (sc dönüş kodu: " << result << ")" << std::endl;
-            result = -1;
-        }
-    #elif defined(__linux__)
-        std::cout << "[Platform] Linux algılandı." << std::endl;
-        const char* session_type_env = getenv("XDG_SESSION_TYPE");
-        session_type_str = session_type_env ? session_type_env : "unknown";
-        std::cout << "[Bilgi] Oturum Türü (XDG_SESSION_TYPE): " << session_type_str << std::endl;
-
-       
-
-            if (session_type_str == "wayland") {
-                command_to_run_str = "/bin/bash"; 
-                if (command_exists("wayvnc")) {
-                    std::cout << "[Bilgi] 'wayvnc' bulundu. /bin/bash aracılığıyla ve loglama ile başlatılacak..." << std::endl;
-
-                    // --- DEĞİŞİKLİK BURADA: wayvnc'nin çıktısını dosyaya yönlendiriyoruz ---
-                    // Bu komut, wayvnc'nin tüm normal ve hata çıktılarını /tmp/wayvnc_log.txt dosyasına yazacak.
-                    const char* wayvnc_command_with_log = "wayvnc > /tmp/wayvnc_log.txt 2>&1";
-                    
-                    argv_list = new char*[4];
-                    argv_list[0] = strdup("/bin/bash");
-                    argv_list[1] = strdup("-c");
-                    argv_list[2] = strdup(wayvnc_command_with_log);
-                    argv_list[3] = NULL;
-                    // --- DEĞİŞİKLİK SONU ---
-
-                    proceed_to_execute = true;
-                } else {
-                    std::cerr << "[HATA] 'wayvnc' komutu bulunamadı! Lütfen kurun." << std::endl;
-                }
-            }            else if (session_type_str == "x11") {
-            command_to_run_str = "x11vnc";
-            if (command_exists(command_to_run_str)) {
-                std::cout << "[Bilgi] 'x11vnc' bulundu. Argümanlar hazırlanıyor..." << std::endl;
-                argv_list = new char*[7];
-                argv_list[0] = strdup("x11vnc"); argv_list[1] = strdup("-localhost");
-                argv_list[2] = strdup("-nopw"); argv_list[3] = strdup("-once");
-                argv_list[4] = strdup("-quiet"); argv_list[5] = strdup("-bg"); argv_list[6] = NULL;
-                proceed_to_execute = true;
-            } else { std::cerr << "[HATA] 'x11vnc' komutu bulunamadı! Lütfen kurun." << std::endl; }
-        } else { std::cerr << "[Uyarı] Bilinmeyen Linux oturum türü: '" << session_type_str << "'" << std::endl; }
-
-        if (proceed_to_execute && argv_list != nullptr && argv_list[0] != nullptr) {
-
-            // --- YENİ DEBUG KODU: Ortam Değişkenlerini Kontrol Et ---
-            const char* wayland_display_env = getenv("WAYLAND_DISPLAY");
-            const char* xdg_runtime_dir_env = getenv("XDG_RUNTIME_DIR");
-            std::cout << "[DEBUG_ENV] WAYLAND_DISPLAY=" << (wayland_display_env ? wayland_display_env : "YOK") << std::endl;
-            std::cout << "[DEBUG_ENV] XDG_RUNTIME_DIR=" << (xdg_runtime_dir_env ? xdg_runtime_dir_env : "YOK") << std::endl;
-            // --- DEBUG KODU SONU ---
-
-            std::cout << "[Bilgi] '" << command_to_run_str << "' fork/execvp ile deneniyor..." << std::endl;
-            pid_t pid = fork();
-            if (pid == -1) { perror("[HATA] fork başarısız"); result = -1; }
-            else if (pid == 0) { // Çocuk işlem
-                execvp(argv_list[0], argv_list);
-                perror(("[HATA] execvp başarısız (" + std::string(argv_list[0]) + ")").c_str());
-                for(int i = 0; argv_list[i] != NULL; ++i) { free(argv_list[i]); } delete[] argv_list;
-                _exit(1); // _exit!
-            } else { // Ebeveyn işlem
-                std::cout << "[Bilgi] '" << argv_list[0] << "' işlemi (PID: " << pid << ") başarıyla başlatıldı (ebeveyn)." << std::endl;
-                result = 0;
-            }
-            command_attempted = true;
-            if (pid != 0 && argv_list != nullptr) { // Ebeveyn veya fork hatasında temizle
-                for(int i = 0; argv_list[i] != NULL; ++i) { free(argv_list[i]); } delete[] argv_list; argv_list = nullptr;
-            }
-        } else if (!command_to_run_str.empty() && !proceed_to_execute) { // Komut adı var ama bulunamadı/execute edilmedi
-            result = -1; command_attempted = true;
-        } else if (proceed_to_execute && (argv_list == nullptr || argv_list[0] == nullptr)) { // Hatalı argüman listesi
-             std::cerr << "[HATA] Komut için argüman listesi oluşturulamadı: " << command_to_run_str << std::endl;
-             result = -1; command_attempted = true; // Denendi ama başarısız
-        } else { result = -1; } // Diğer durumlar
-    #elif defined(__APPLE__)
-        std::cout << "[Platform] macOS algılandı." << std::endl; command_attempted = false;
-        std::cout << "[Bilgi] Lütfen Sistem Ayarları > Paylaşma > Ekran Paylaşma'yı etkinleştirin." << std::endl;
-    #else
-        std::cout << "[Uyarı] Bilinmeyen işletim sistemi." << std::endl; command_attempted = false;
-    #endif
-
-    if (command_attempted) { // Sadece bir komut denemesi yapıldıysa sonucu değerlendir
-        if (result != 0) { std::cerr << "[Hata] Genel VNC sunucu başlatma denemesi başarısız oldu." << std::endl; }
+std::string capture_dir;
+bool tunnel_compression = false;
+bool p2p_enabled = false;
+VncServerManager local_vnc_server("127.0.0.1", 5900);
+
+// Paylaşan tarafın (Agent B) VNC oturumu. connection_established ile yerel VNC'ye ayrı bir thread'de
+// bağlanılır (local_vnc_server sunucuyu gerekirse başlatır ve hazır olmasını bekler) ve
+// start_vnc_tunnel gönderilir; relay TUNNEL_ACTIVE gönderince oturum alıcı thread'de tek bir
+// VncProxy ile yürütülür (bkz. run_sharer_vnc_session). Oturum sürerken relay soketini yalnızca
+// vekil okur. İptal oturuma özeldir: cancel_vnc_session yalnızca sürmekte olan vekili durdurur.
+static std::mutex vnc_session_mutex;
+static int pending_local_vnc_fd = -1; // TUNNEL_ACTIVE bekleyen yerel VNC bağlantısı (veya görüntüleyicinin soket çifti ucu)
+static bool pending_tunnel_active = false;
+static bool pending_compression = false; // Relay tarafı sıkıştırılmış (iki ajan da "deflate" istedi)
+static bool pending_viewer = false;      // Bekleyen vekil görüntüleyicinin sıkıştırma vekili (kayıt yapılmaz)
+static bool negotiated_compression = false; // TUNNEL_OPTIONS'ta anlaşıldı; TUNNEL_ACTIVE ile oturuma geçer
+static std::string pending_my_id;
+static std::string pending_peer_id;
+static std::string pending_resume_token; // TUNNEL_ACTIVE ile gelen belirteç (boşsa relay devam ettirmeyi kapatmış)
+static VncProxy* active_proxy = nullptr;
+// Yerel VNC sunucusunun hazır olması için en fazla bekleme (ilk başlatma dahil)
+static const int VNC_READY_TIMEOUT_MS = 15000;
+// Relay bağlantısı kopan oturumu devam ettirme denemelerinden önceki beklemeler (toplam ~8 sn; relay ucu
+// yalnızca '--resume-grace=' süresince saklar). Relay kopukluğu geç fark ederse ilk denemeler reddedilir.
+static const int RESUME_RETRY_DELAYS_MS[] = {0, 250, 500, 1000, 2000, 4000};
+// Relay'in "RESUMED" yanıtı için en fazla bekleme
+static const int RESUME_REPLY_TIMEOUT_MS = 5000;
+// Relay'e gönderilmiş ama kopma sırasında ona ulaşmamış olabilecek veri (soket gönderim tamponu kadar)
+static const size_t RESUME_REPLAY_BYTES = 2 * 1024 * 1024;
+// Her eşleşmede ve iptalde artar; hazırlık thread'i bağlantıyı yalnızca kendi eşleşmesi sürüyorsa bırakır
+static uint64_t pending_generation = 0;
+// Görüntüleyici oturumu kendi thread'inde sürer; iptal bu bayrakla yapılır
+static std::shared_ptr<std::atomic<bool>> viewer_running;
+// Çoğullanmış bağlantının köprüsü (start_mux_link; alıcı thread başlamadan bir kez kurulur)
+static std::shared_ptr<MuxBridge> mux_bridge;
+// '--p2p': eşleşmenin doğrudan oturumu (bkz. direct_session.h). Relay iki ajana da P2P_CANDIDATES
+// gönderdiyse ikisi de doğrudan yolu denemiştir; relay tüneline geçilirse tünelin ilk 8 byte'ı iki
+// yönde de ucun doğrudan yoldan aldığı byte sayısıdır ve akış oradan sürer (pending_handover).
+static std::shared_ptr<DirectSession> direct_session;
+static bool p2p_candidates_seen = false;
+static std::unique_ptr<DirectHandover> pending_handover;
+// Tünelin başındaki konum bilgisi için en fazla bekleme
+static const int HANDOVER_TIMEOUT_MS = 10000;
+
+// '--capture=' verildiyse oturumun kayıt dosyasını açar (yön 0: yerel VNC -> relay).
+// Görüntüleyen tarafta soket doğrudan libVNCclient tarafından okunduğu için kayıt yapılmaz.
+static std::unique_ptr<CaptureWriter> open_sharer_capture(const std::string& my_id, const std::string& peer_id) {
+    if (capture_dir.empty()) return nullptr;
+    ::mkdir(capture_dir.c_str(), 0755);
+    std::string path = capture_dir + "/agent-" + std::to_string(time(nullptr)) + "-" + my_id + "-" + peer_id + ".rcap";
+    try {
+        std::unique_ptr<CaptureWriter> writer(new CaptureWriter(path, "agent a=vnc b=" + peer_id));
+        LOG(LOG_INFO) << "[Kayıt] VNC trafiği kaydediliyor: " << path;
+        return writer;
+    } catch (const std::system_error& e) {
+        LOG(LOG_WARN) << "[Kayıt] Kayıt dosyası açılamadı: " << e.what();
+        return nullptr;
     }
-    // Not: (Not: Henüz VNC trafiği...) mesajları process_server_message'a taşındı.
-    std::cout << "[DEBUG] Exiting start_vnc_server function." << std::endl;
 }
 
-// VNC Uplink Thread (Agent B - Yerel VNC'den Sunucuya)
-void vnc_uplink_thread_func(int local_vnc_fd, int sock_to_relay, std::atomic<bool>& app_is_running_ref, std::mutex& c_mutex_ref) {
+// Tünel açılmadan eşleşme bittiyse bekleyen yerel VNC bağlantısını kapatır
+static void discard_pending_vnc_session() {
+    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+    ++pending_generation; // Hazırlanmakta olan bağlantı artık kullanılmaz
+    if (pending_local_vnc_fd >= 0) ::close(pending_local_vnc_fd);
+    pending_local_vnc_fd = -1;
+    pending_tunnel_active = false;
+    pending_compression = false;
+    pending_viewer = false;
+    pending_resume_token.clear();
+    negotiated_compression = false;
+    if (direct_session) direct_session->cancel();
+    direct_session.reset();
+    p2p_candidates_seen = false;
+    pending_handover.reset();
+}
+
+// start_vnc_tunnel komutu; '--compress' verildiyse relay'e sıkıştırma istendiği bildirilir
+static std::string start_tunnel_command() {
+    return tunnel_compression ? std::string("start_vnc_tunnel ") + TUNNEL_OPTION_DEFLATE : "start_vnc_tunnel";
+}
+
+// Yerel VNC sunucusu (gerekirse başlatılır) hazır olunca bağlantıyı bekleyen oturuma koyar ve relay'e
+// start_vnc_tunnel gönderir. Bağlantı gönderimden önce konur; TUNNEL_ACTIVE her zaman onu bulur.
+static void prepare_sharer_vnc_session(int sock_to_server, const std::string& my_id, const std::string& peer_id) {
+    uint64_t generation;
     {
-        std::lock_guard<std::mutex> lock(c_mutex_ref);
-        std::cout << "[VNC Uplink] Thread başlatıldı. Yerel VNC (Soket: " << local_vnc_fd
-                  << ") dinleniyor. Relay sunucusu (Soket: " << sock_to_relay << ")" << std::endl;
-    }
-    // Sunucu komutları küçük harfe çevirdiği için küçük harf gönderiyoruz
-    if (!send_server_message(sock_to_relay, "start_vnc_tunnel")) {
-        std::lock_guard<std::mutex> lock(c_mutex_ref);
-        std::cerr << "[VNC Uplink] HATA: Sunucuya 'start_vnc_tunnel' gönderilemedi." << std::endl;
-        if (local_vnc_fd > 0) ::close(local_vnc_fd);
-        std::cout << "[VNC Uplink] Thread sonlandırılıyor ('start_vnc_tunnel' hatası)." << std::endl;
-        return;
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        generation = ++pending_generation;
     }
-    {
-        std::lock_guard<std::mutex> lock(c_mutex_ref);
-        std::cout << "[VNC Uplink] Sunucuya 'start_vnc_tunnel' komutu gönderildi." << std::endl;
-    }
-
-    std::vector<char> buffer(8192);
-    ssize_t bytes_read; ssize_t bytes_sent;
-    while (app_is_running_ref) {
-        bytes_read = ::read(local_vnc_fd, buffer.data(), buffer.size());
-        if (bytes_read > 0) {
-            { std::lock_guard<std::mutex> lock(c_mutex_ref);
-              std::cout << "[VNC Uplink] Yerel VNC'den " << bytes_read << " byte okundu. Relay sunucusuna gönderiliyor..." << std::endl; }
-            #ifdef __linux__
-                int flags = MSG_NOSIGNAL;
-            #else
-                int flags = 0;
-            #endif
-            bytes_sent = ::send(sock_to_relay, buffer.data(), bytes_read, flags);
-            if (bytes_sent < 0) { std::lock_guard<std::mutex> lock(c_mutex_ref); perror("[VNC Uplink] Relay'e veri gönderme hatası"); break; }
-            else if (bytes_sent < bytes_read) { std::lock_guard<std::mutex> lock(c_mutex_ref); std::cerr << "[VNC Uplink] UYARI: Relay'e eksik veri gönderildi." << std::endl;}
-        } else if (bytes_read == 0) { std::lock_guard<std::mutex> lock(c_mutex_ref); std::cout << "[VNC Uplink] Yerel VNC bağlantısı kapandı." << std::endl; break; }
-        else { // bytes_read < 0
-            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); continue; }
-            std::lock_guard<std::mutex> lock(c_mutex_ref); perror("[VNC Uplink] Yerel VNC'den okuma hatası"); break;
+    std::cout << "[Tünel-Adım1] Yerel VNC sunucusuna (" << local_vnc_server.host() << ":" << local_vnc_server.port()
+              << ") bağlanılıyor..." << std::endl;
+    std::thread([sock_to_server, my_id, peer_id, generation]() {
+        log_set_thread_name("vnc");
+        std::string error;
+        int local_vnc_sock = local_vnc_server.acquire(std::chrono::milliseconds(VNC_READY_TIMEOUT_MS), &error);
+        std::lock_guard<std::mutex> out(cout_mutex);
+        if (local_vnc_sock < 0) {
+            std::cerr << "\n[HATA] Yerel VNC sunucusuna bağlanılamadı: " << error << std::endl;
+            std::cerr << "       - VNC sunucusu kurulu mu, ya da dışarıda başlatıldı ve çalışıyor mu?" << std::endl;
+            std::cout << "> ";
+            std::cout.flush();
+            return;
         }
-    }
-    if (local_vnc_fd > 0) { ::close(local_vnc_fd); }
-    { std::lock_guard<std::mutex> lock(c_mutex_ref); std::cout << "[VNC Uplink] Thread sonlandırıldı." << std::endl; }
+        {
+            std::lock_guard<std::mutex> lock(vnc_session_mutex);
+            if (generation != pending_generation) { // Bu sürede eşleşme bitti
+                ::close(local_vnc_sock);
+                return;
+            }
+            if (direct_session && direct_session->offer_local_fd(local_vnc_sock)) {
+                // Doğrudan oturum bağlantıyı aldı; relay'e dönülürse start_vnc_tunnel'ı o gönderir
+                std::cout << "\n[Bilgi] Yerel VNC sunucusuna başarıyla bağlanıldı (Soket: " << local_vnc_sock
+                          << "), doğrudan oturuma verildi." << std::endl;
+                std::cout << "> ";
+                std::cout.flush();
+                return;
+            }
+            if (pending_local_vnc_fd >= 0) ::close(pending_local_vnc_fd);
+            pending_local_vnc_fd = local_vnc_sock;
+            pending_tunnel_active = false;
+            pending_compression = false;
+            pending_viewer = false;
+            pending_my_id = my_id;
+            pending_peer_id = peer_id;
+        }
+        std::cout << "\n[Bilgi] Yerel VNC sunucusuna başarıyla bağlanıldı (Soket: " << local_vnc_sock << ")." << std::endl;
+        // Oturum relay TUNNEL_ACTIVE gönderince alıcı thread'de başlar (run_sharer_vnc_session)
+        // Sunucu komutları küçük harfe çevirdiği için küçük harf gönderiyoruz
+        if (!send_server_message(sock_to_server, start_tunnel_command())) {
+            std::cerr << "[HATA] Sunucuya 'start_vnc_tunnel' gönderilemedi (Agent B)." << std::endl;
+            discard_pending_vnc_session();
+        } else {
+            std::cout << "[Bilgi] Sunucuya 'start_vnc_tunnel' komutu gönderildi, TUNNEL_ACTIVE bekleniyor..." << std::endl;
+        }
+        std::cout << "> ";
+        std::cout.flush();
+    }).detach();
 }
 
-void vnc_control_downlink_thread_func(int local_vnc_fd, int sock_to_relay, std::atomic<bool>& app_is_running_ref, std::mutex& c_mutex_ref) {
-    {
-        std::lock_guard<std::mutex> lock(c_mutex_ref);
-        std::cout << "[VNC Downlink(B)] Thread başlatıldı. Relay (Soket: " << sock_to_relay
-                  << ") dinleniyor. Hedef: Yerel VNC (Soket: " << local_vnc_fd << ")" << std::endl;
-    }
+bool sharer_vnc_session_ready() {
+    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+    return pending_local_vnc_fd >= 0 && pending_tunnel_active;
+}
 
-    std::vector<char> buffer(8192);
-    ssize_t bytes_read;
-    ssize_t bytes_sent;
+bool vnc_session_active() {
+    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+    return active_proxy != nullptr;
+}
 
-    while (app_is_running_ref) {
-        // 1. Relay sunucusundan veri oku (bu, İstemci A'dan gelen kontrol verisidir)
-        bytes_read = ::read(sock_to_relay, buffer.data(), buffer.size());
+void cancel_vnc_session() {
+    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+    if (active_proxy) active_proxy->cancel();
+    if (viewer_running) {
+        *viewer_running = false;
+        viewer_running.reset();
+    }
+}
 
-        if (bytes_read > 0) {
-            {
-                std::lock_guard<std::mutex> lock(c_mutex_ref);
-                std::cout << "[VNC Downlink(B)] Relay sunucusundan " << bytes_read << " byte kontrol verisi alındı. Yerel VNC'ye gönderiliyor..." << std::endl;
+/**
+ * @brief Kopan tünel için yeni bağlantıda (fresh) "resume <belirteç> <alınan>" gönderir ve "RESUMED <n>"
+ * bekler; öncesindeki satırlar (yeni bağlantıya atanan ID) atlanır. Başarılıysa yeni bağlantı
+ * sock_to_relay numarasına konur (dup2), *relay_received relay'in bu uçtan aldığı byte, *from_relay
+ * yanıttan sonra okunmuş tünel verisidir.
+ */
+static bool resume_relay_tunnel(int fresh, int sock_to_relay, const std::string& token, uint64_t received,
+                                uint64_t* relay_received, std::string* from_relay) {
+    if (!send_server_message(fresh, "resume " + token + " " + std::to_string(received))) return false;
+    std::string incoming;
+    char buffer[4096];
+    while (true) {
+        size_t newline;
+        while ((newline = incoming.find('\n')) != std::string::npos) {
+            std::string line = incoming.substr(0, newline);
+            incoming.erase(0, newline + 1);
+            if (line.rfind("RESUMED ", 0) == 0) {
+                *relay_received = strtoull(line.c_str() + 8, nullptr, 10);
+                if (::dup2(fresh, sock_to_relay) < 0) return false;
+                from_relay->swap(incoming);
+                return true;
             }
-
-            // 2. Okunan veriyi yerel VNC sunucusuna yaz
-            bytes_sent = ::send(local_vnc_fd, buffer.data(), bytes_read, 0);
-            if (bytes_sent < 0) {
-                std::lock_guard<std::mutex> lock(c_mutex_ref);
-                perror("[VNC Downlink(B)] Yerel VNC'ye veri gönderme hatası");
-                break; // Hata durumunda döngüyü sonlandır
-            } else if (bytes_sent < bytes_read) {
-                std::lock_guard<std::mutex> lock(c_mutex_ref);
-                std::cerr << "[VNC Downlink(B)] UYARI: Yerel VNC'ye tüm veri gönderilemedi." << std::endl;
+            if (line.rfind("ERROR", 0) == 0) {
+                LOG(LOG_WARN) << "[VNC Oturum] Relay devam ettirmeyi reddetti: " << line;
+                return false;
             }
+        }
+        struct pollfd fd = {fresh, POLLIN, 0};
+        if (::poll(&fd, 1, RESUME_REPLY_TIMEOUT_MS) <= 0) return false;
+        ssize_t n = ::read(fresh, buffer, sizeof(buffer));
+        if (n <= 0) return false;
+        incoming.append(buffer, n);
+    }
+}
 
-        } else if (bytes_read == 0) {
-            std::lock_guard<std::mutex> lock(c_mutex_ref);
-            std::cout << "[VNC Downlink(B)] Relay sunucusu bağlantısı kapandı." << std::endl;
-            break;
-        } else { // Hata
-            if (errno == EINTR) { continue; } // Sinyal kesintisi, devam et
-            std::lock_guard<std::mutex> lock(c_mutex_ref);
-            perror("[VNC Downlink(B)] Relay sunucusundan okuma hatası");
-            break;
+/**
+ * @brief Relay bağlantısı kopan oturumu yeni bağlantıyla devam ettirir ve oturum bitene kadar yürütür.
+ * Relay yerel tarafın aldığı konumdan yeniden gönderir, vekil de relay'in bildirdiği konumdan; VNC
+ * el sıkışması ve tam ekran yenilemesi gerekmez. Denemeler tükenirse oturum relay kapanmış gibi biter.
+ */
+static VncProxy::Result resume_vnc_proxy(VncProxy& proxy, int sock_to_relay, const std::string& token,
+                                         const RelayConnector& reconnect) {
+    VncProxy::Result result = VncProxy::PROXY_RELAY_LOST;
+    while (result == VncProxy::PROXY_RELAY_LOST) {
+        ::shutdown(sock_to_relay, SHUT_RDWR); // Relay kopukluğu hemen görsün ve tünel ucunu saklasın
+        {
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            std::cout << "\n[Bilgi] Relay bağlantısı koptu; VNC oturumu devam ettiriliyor..." << std::endl;
+        }
+        std::string from_relay;
+        uint64_t relay_received = 0;
+        bool resumed = false;
+        for (int delay : RESUME_RETRY_DELAYS_MS) {
+            if (proxy.wait_for_cancel(delay)) return VncProxy::PROXY_CANCELLED;
+            int fresh = reconnect();
+            if (fresh < 0) continue;
+            resumed = resume_relay_tunnel(fresh, sock_to_relay, token, proxy.bytes_from_relay(), &relay_received, &from_relay);
+            ::close(fresh);
+            if (resumed) break;
+        }
+        if (!resumed) return VncProxy::PROXY_RELAY_CLOSED;
+        if (!proxy.resume(relay_received)) {
+            LOG(LOG_WARN) << "[VNC Oturum] Relay " << relay_received << ". byte'tan istedi ama " << proxy.bytes_to_relay()
+                          << " byte gönderilmiş ve eksik veri artık saklanmıyor; oturum bitiriliyor.";
+            return VncProxy::PROXY_RELAY_CLOSED;
+        }
+        {
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            std::cout << "[Bilgi] VNC oturumu devam ettirildi (relay'den alınan: " << proxy.bytes_from_relay()
+                      << " byte, relay'in aldığı: " << relay_received << " byte)." << std::endl;
         }
+        result = proxy.run(from_relay);
+    }
+    return result;
+}
+
+/**
+ * @brief Doğrudan yoldan relay tüneline geçişte tünelin başında iki yönde de 8 byte'lık konum (ucun doğrudan
+ * yoldan aldığı byte, ağ bayt sırasıyla) gönderilir ve eşinki okunur; önce *from_relay'den, yetmezse
+ * soketten. Eşin almadığı veri *to_relay'e konur.
+ * @return Konum okunamazsa veya eldeki veriyle sürdürülemezse false.
+ */
+static bool exchange_handover(int sock_to_relay, std::string* from_relay, const DirectHandover& handover,
+                              std::string* to_relay) {
+    unsigned char header[8];
+    for (int i = 0; i < 8; ++i) header[i] = (unsigned char)(handover.received >> (56 - 8 * i));
+    if (::send(sock_to_relay, header, sizeof(header), MSG_NOSIGNAL) != (ssize_t)sizeof(header)) return false;
+    char buffer[4096];
+    while (from_relay->size() < sizeof(header)) {
+        struct pollfd fd = {sock_to_relay, POLLIN, 0};
+        if (::poll(&fd, 1, HANDOVER_TIMEOUT_MS) <= 0) return false;
+        ssize_t n = ::read(sock_to_relay, buffer, sizeof(buffer));
+        if (n <= 0) return false;
+        from_relay->append(buffer, n);
+    }
+    uint64_t peer_received = 0;
+    for (int i = 0; i < 8; ++i) peer_received = (peer_received << 8) | (unsigned char)(*from_relay)[i];
+    from_relay->erase(0, sizeof(header));
+    if (peer_received < handover.sent_base || peer_received - handover.sent_base > handover.outbound.size()) {
+        LOG(LOG_ERROR) << "[P2P] Eş doğrudan yoldan " << peer_received << " byte aldığını bildirdi; bu uçta "
+                       << handover.sent_base << ".." << handover.sent_base + handover.outbound.size()
+                       << " aralığı saklanıyor. Oturum sürdürülemiyor.";
+        return false;
+    }
+    to_relay->assign(handover.outbound, peer_received - handover.sent_base, std::string::npos);
+    return true;
+}
+
+// local_fd ile relay arasında vekili çağıran thread'de yürütür; local_fd'yi vekil kapatır. Belirteç ve
+// reconnect verildiyse relay bağlantısı koptuğunda oturum devam ettirilir. handover verildiyse oturum
+// doğrudan yoldan devralınır (from_relay'in başındaki konum bilgisi dahil).
+static VncProxy::Result run_vnc_proxy(int local_fd, int sock_to_relay, const std::string& from_relay,
+                                      bool compress, std::unique_ptr<CaptureWriter> capture,
+                                      const std::string& resume_token = std::string(),
+                                      const RelayConnector& reconnect = RelayConnector(),
+                                      const DirectHandover* handover = nullptr) {
+    std::string relay_data = from_relay;
+    std::string to_relay;
+    if (handover && !exchange_handover(sock_to_relay, &relay_data, *handover, &to_relay)) {
+        ::close(local_fd);
+        return VncProxy::PROXY_FAILED;
     }
-    // Bu thread sonlandığında, muhtemelen tüm VNC oturumu bitmiştir.
-    // Soketler diğer thread veya ana program tarafından kapatılacaktır.
+    std::unique_ptr<VncProxy> proxy;
+    bool resumable = !resume_token.empty() && reconnect;
+    try {
+        proxy.reset(new VncProxy(local_fd, sock_to_relay));
+        if (compress) proxy->enable_compression();
+        if (resumable) proxy->enable_resume(RESUME_REPLAY_BYTES);
+    } catch (const std::exception& e) {
+        LOG(LOG_ERROR) << "[VNC Vekil] Oturum başlatılamadı: " << e.what();
+        return VncProxy::PROXY_FAILED;
+    }
+    proxy->capture_to(std::move(capture));
+    if (handover) proxy->take_over(to_relay, handover->to_local, 8);
     {
-        std::lock_guard<std::mutex> lock(c_mutex_ref);
-        std::cout << "[VNC Downlink(B)] Thread sonlandırıldı." << std::endl;
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        active_proxy = proxy.get();
+    }
+    VncProxy::Result result = proxy->run(relay_data);
+    if (result == VncProxy::PROXY_RELAY_LOST) result = resume_vnc_proxy(*proxy, sock_to_relay, resume_token, reconnect);
+    {
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        active_proxy = nullptr;
+    }
+    return result;
+}
+
+VncProxy::Result run_sharer_vnc_session(int sock_to_relay, const std::string& from_relay, const RelayConnector& reconnect) {
+    int local_fd;
+    bool compress, viewer;
+    std::string my_id, peer_id, resume_token;
+    std::unique_ptr<DirectHandover> handover;
+    {
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        if (p2p_candidates_seen) { // Eş de doğrudan yolu denedi; tünel konum bilgisiyle başlar
+            handover = std::move(pending_handover);
+            if (!handover) handover.reset(new DirectHandover());
+        }
+        p2p_candidates_seen = false;
+        pending_handover.reset();
+        local_fd = pending_local_vnc_fd;
+        compress = pending_compression;
+        viewer = pending_viewer;
+        my_id = pending_my_id;
+        peer_id = pending_peer_id;
+        resume_token.swap(pending_resume_token);
+        pending_local_vnc_fd = -1;
+        pending_tunnel_active = false;
+        pending_compression = false;
+        pending_viewer = false;
     }
+    if (local_fd < 0) return VncProxy::PROXY_FAILED;
+    std::unique_ptr<CaptureWriter> capture;
+    // Doğrudan yolda kayıt yapılmaz; ortasından başlayan kayıt yeniden oynatılamayacağından açılmaz
+    if (!viewer && !(handover && handover->received + handover->sent_base > 0)) capture = open_sharer_capture(my_id, peer_id);
+    return run_vnc_proxy(local_fd, sock_to_relay, from_relay, compress, std::move(capture), resume_token, reconnect,
+                         handover.get());
+}
+
+// Görüntüleyici relay soketini doğrudan okumaz: libVNCclient bir soket çiftinin ucunu alır, diğer uç ile
+// relay arasında vekil (sıkıştırılmışsa akışı çözerek) aktarır. *viewer_fd görüntüleyiciye, *proxy_fd vekile.
+static bool open_viewer_pair(int* viewer_fd, int* proxy_fd) {
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        std::cerr << "[HATA] Görüntüleyici için soket çifti oluşturulamadı: " << strerror(errno) << std::endl;
+        return false;
+    }
+    *viewer_fd = pair[1];
+    *proxy_fd = pair[0];
+    return true;
 }
 
 // Lütfen bu fonksiyonu eskisinin yerine tamamen kopyalayın
@@ -459,6 +603,208 @@ void vnc_downlink_thread_func(int sock_to_relay, std::atomic<bool>& app_is_runni
 }
 
 
+// Tek kanallı bağlantıda görüntüleyici oturumu kendi thread'inde, oturuma özel bayrakla sürer; pencere
+// kapanınca yalnızca oturum biter. cancel_vnc_session bayrağı indirir.
+static void start_viewer_thread(int viewer_fd, std::mutex& c_mutex_ref) {
+    auto session_running = std::make_shared<std::atomic<bool>>(true);
+    {
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        if (viewer_running) *viewer_running = false;
+        viewer_running = session_running;
+    }
+    std::thread([viewer_fd, session_running, &c_mutex_ref]() {
+        log_set_thread_name("vnc");
+        vnc_downlink_thread_func(viewer_fd, *session_running, c_mutex_ref);
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        if (viewer_running == session_running) viewer_running.reset();
+    }).detach();
+}
+
+bool mux_enabled() {
+    return mux_bridge != nullptr;
+}
+
+int start_mux_link(int sock, std::string* preamble, std::mutex& c_mutex_ref) {
+    if (!send_server_message(sock, "mux")) return -1;
+    // Yanıta kadar gelen satırlar (ID, PING) çağırana bırakılır; MUX_OK'tan sonrası çerçevelidir
+    std::string received;
+    char buffer[4096];
+    while (true) {
+        size_t newline;
+        while ((newline = received.find('\n')) != std::string::npos) {
+            std::string line = received.substr(0, newline);
+            received.erase(0, newline + 1);
+            if (line == "MUX_OK") {
+                try {
+                    mux_bridge = std::make_shared<MuxBridge>(sock, received);
+                } catch (const std::system_error& e) {
+                    std::lock_guard<std::mutex> lock(c_mutex_ref);
+                    std::cerr << "[HATA] Kanal çoğullama başlatılamadı: " << e.what() << std::endl;
+                    return -1;
+                }
+                std::shared_ptr<MuxBridge> bridge = mux_bridge;
+                std::thread([bridge]() {
+                    log_set_thread_name("mux");
+                    bridge->run();
+                }).detach();
+                std::lock_guard<std::mutex> lock(c_mutex_ref);
+                std::cout << "[Bilgi] Relay bağlantısı kanallara bölündü (kontrol, giriş, RFB, toplu veri)." << std::endl;
+                return bridge->take_control_fd();
+            }
+            if (line.rfind("ERROR", 0) == 0) {
+                std::lock_guard<std::mutex> lock(c_mutex_ref);
+                std::cerr << "[Uyarı] Relay kanal çoğullamayı desteklemiyor; tek kanal kullanılacak." << std::endl;
+                return sock;
+            }
+            preamble->append(line).append("\n");
+        }
+        ssize_t bytes_read = ::read(sock, buffer, sizeof(buffer));
+        if (bytes_read <= 0) return -1;
+        received.append(buffer, bytes_read);
+    }
+}
+
+// Çoğullanmış bağlantıda paylaşan oturumu kendi thread'inde veri kanallarından yürütür: ekran
+// güncellemeleri RFB kanalından gider, görüntüleyicinin girişleri giriş kanalından gelir. Relay
+// bağlantısı komutlara açık kalır; oturum kendiliğinden biterse eşleşmeden de çıkılır.
+static void start_mux_sharer_session(int sock_to_server) {
+    int stream = mux_bridge->open_stream(MUX_CHANNEL_RFB, MUX_CHANNEL_INPUT);
+    if (stream < 0) {
+        std::cerr << "[HATA] VNC veri kanalı açılamadı." << std::endl;
+        discard_pending_vnc_session();
+        return;
+    }
+    std::thread([stream, sock_to_server]() {
+        log_set_thread_name("vnc");
+        VncProxy::Result result = run_sharer_vnc_session(stream, std::string());
+        ::close(stream);
+        if (result != VncProxy::PROXY_CANCELLED) send_server_message(sock_to_server, "disconnect");
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << "\n[Bilgi] VNC oturumu bitti (" << VncProxy::result_name(result) << ")." << std::endl;
+        std::cout << "> ";
+        std::cout.flush();
+    }).detach();
+}
+
+// Çoğullanmış bağlantıda görüntüleyici oturumu: girişler giriş kanalından gönderilir, ekran
+// güncellemeleri RFB kanalından okunur. Soketi libVNCclient kapatır (rfbClientCleanup). Tünel
+// sıkıştırılmışsa akış ile görüntüleyici arasında ayrı bir thread'de vekil çalışır.
+static void start_mux_viewer_session(int sock_to_server, bool compress, std::mutex& c_mutex_ref) {
+    int stream = mux_bridge->open_stream(MUX_CHANNEL_INPUT, MUX_CHANNEL_RFB);
+    if (stream < 0) {
+        std::cerr << "[HATA] VNC veri kanalı açılamadı." << std::endl;
+        return;
+    }
+    if (compress) {
+        int viewer_fd, proxy_fd;
+        if (!open_viewer_pair(&viewer_fd, &proxy_fd)) {
+            ::close(stream);
+            return;
+        }
+        std::thread([stream, proxy_fd]() {
+            log_set_thread_name("vnc-proxy");
+            run_vnc_proxy(proxy_fd, stream, std::string(), true, nullptr);
+            ::close(stream);
+        }).detach();
+        stream = viewer_fd;
+    }
+    auto session_running = std::make_shared<std::atomic<bool>>(true);
+    {
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        if (viewer_running) *viewer_running = false;
+        viewer_running = session_running;
+    }
+    std::thread([stream, session_running, sock_to_server, &c_mutex_ref]() {
+        log_set_thread_name("vnc");
+        vnc_downlink_thread_func(stream, *session_running, c_mutex_ref);
+        bool ended_here;
+        {
+            std::lock_guard<std::mutex> lock(vnc_session_mutex);
+            ended_here = viewer_running == session_running; // İptal edilmediyse pencere kapatıldı veya akış bitti
+            if (ended_here) viewer_running.reset();
+        }
+        if (ended_here) send_server_message(sock_to_server, "disconnect");
+    }).detach();
+}
+
+// '--p2p': eşleşmenin VNC oturumunu önce doğrudan yoldan dener (bkz. direct_session.h). Relay'e dönülürse
+// oturumun yerel ucu ve akışın konumu bekleyen oturuma konur ve start_vnc_tunnel gönderilir; paylaşan
+// tarafta yerel VNC bağlantısı henüz hazır değilse bunu hazırlık thread'i yapar.
+// @return Doğrudan oturum başlatılamadıysa false (çağıran doğrudan relay tüneline geçer).
+static bool start_direct_session(int sock_to_server, const std::string& my_id, const std::string& peer_id, bool viewer,
+                                 std::mutex& c_mutex_ref) {
+    DirectSession::Hooks hooks;
+    hooks.open_viewer = [&c_mutex_ref]() {
+        int viewer_fd, proxy_fd;
+        if (!open_viewer_pair(&viewer_fd, &proxy_fd)) return -1;
+        start_viewer_thread(viewer_fd, c_mutex_ref);
+        return proxy_fd;
+    };
+    hooks.on_fallback = [sock_to_server, my_id, peer_id, viewer, &c_mutex_ref](DirectSession* session, int local_fd,
+                                                                              DirectHandover handover) {
+        std::lock_guard<std::mutex> out(c_mutex_ref);
+        {
+            std::lock_guard<std::mutex> lock(vnc_session_mutex);
+            if (direct_session.get() != session) { // Bu sürede eşleşme bitti
+                if (local_fd >= 0) ::close(local_fd);
+                return;
+            }
+            direct_session.reset();
+            pending_handover.reset(new DirectHandover(std::move(handover)));
+            if (local_fd >= 0) {
+                if (pending_local_vnc_fd >= 0) ::close(pending_local_vnc_fd);
+                pending_local_vnc_fd = local_fd;
+                pending_tunnel_active = false;
+                pending_compression = false;
+                pending_viewer = viewer;
+                pending_my_id = my_id;
+                pending_peer_id = peer_id;
+            }
+        }
+        std::cout << "\n[Bilgi] Doğrudan bağlantı kurulamadı veya koptu; VNC oturumu relay tüneliyle sürecek." << std::endl;
+        if (local_fd >= 0 || viewer) {
+            if (!send_server_message(sock_to_server, start_tunnel_command())) {
+                std::cerr << "[HATA] Sunucuya 'start_vnc_tunnel' gönderilemedi." << std::endl;
+            } else {
+                std::cout << "[Bilgi] Sunucuya 'start_vnc_tunnel' komutu gönderildi, TUNNEL_ACTIVE bekleniyor..." << std::endl;
+            }
+        }
+        std::cout << "> ";
+        std::cout.flush();
+    };
+    hooks.on_finished = [&c_mutex_ref](DirectSession* session, const std::string& summary) {
+        std::lock_guard<std::mutex> out(c_mutex_ref);
+        {
+            std::lock_guard<std::mutex> lock(vnc_session_mutex);
+            if (direct_session.get() == session) direct_session.reset();
+        }
+        std::cout << "\n[Bilgi] Doğrudan VNC oturumu bitti (" << summary << ")." << std::endl;
+        std::cout << "> ";
+        std::cout.flush();
+    };
+    std::shared_ptr<DirectSession> session =
+        std::make_shared<DirectSession>(sock_to_server, relay_ip, my_id, viewer, std::move(hooks));
+    {
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        if (direct_session) direct_session->cancel();
+        direct_session = session;
+    }
+    if (session->start()) {
+        std::cout << "[Bilgi] Doğrudan bağlantı deneniyor (UDP hole punching)..." << std::endl;
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+    if (direct_session == session) direct_session.reset();
+    return false;
+}
+
+// Doğrudan oturumun relay satırları (P2P_BIND, P2P_CANDIDATES, P2P_FALLBACK, "P2P:" hataları) ona iletilir
+static void forward_to_direct_session(const std::string& type, const std::string& argument) {
+    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+    if (type == "P2P_CANDIDATES") p2p_candidates_seen = true;
+    if (direct_session) direct_session->on_control(type, argument);
+}
+
 // Sunucudan Gelen Mesajları İşleyen Ana Fonksiyon
 void process_server_message(const std::string& server_msg_line, std::string& my_id_ref, std::mutex& cout_mtx_param, int sock_to_server) {
     std::lock_guard<std::mutex> lock(cout_mtx_param);
@@ -469,6 +815,11 @@ void process_server_message(const std::string& server_msg_line, std::string& my_
     std::string msg_type = msg_type_original;
     std::transform(msg_type.begin(), msg_type.end(), msg_type.begin(), ::tolower); // Komutları küçük harfe çevir
 
+    if (msg_type == "ping") { // Sunucunun kalp atışı; ekrana yazılmadan yanıtlanır
+        send_server_message(sock_to_server, "pong");
+        return;
+    }
+
     std::cout << "\n[Sunucu] " << server_msg_line << std::endl;
 
     if (msg_type == "id") {
@@ -488,7 +839,9 @@ void process_server_message(const std::string& server_msg_line, std::string& my_
         std::string peer_id_b; ss >> peer_id_b; // Bu, accept eden İstemci B'nin ID'si
         std::cout << "[Bilgi] Bağlantı isteğiniz ID '" << peer_id_b << "' tarafından KABUL EDİLDİ." << std::endl;
 
-        if (!send_server_message(sock_to_server, "start_vnc_tunnel")) { // Küçük harf
+        if (p2p_enabled && !mux_bridge && start_direct_session(sock_to_server, my_id_ref, peer_id_b, true, cout_mtx_param)) {
+            // Görüntüleyici doğrudan yol kurulunca başlar; kurulamazsa relay tüneline geçilir
+        } else if (!send_server_message(sock_to_server, start_tunnel_command())) { // Küçük harf
             std::cerr << "[HATA] Sunucuya 'start_vnc_tunnel' gönderilemedi (Agent A)." << std::endl;
         } else {
             std::cout << "[Bilgi] Sunucuya 'start_vnc_tunnel' komutu gönderildi (Agent A)." << std::endl;
@@ -506,73 +859,84 @@ void process_server_message(const std::string& server_msg_line, std::string& my_
         std::string peer_id_a; ss >> peer_id_a; // Bu, istek yapan İstemci A'nın ID'si
         std::cout << "[Bilgi] ID '" << peer_id_a << "' ile BAĞLANTI KURULDU." << std::endl;
         
-        // start_vnc_server();
-
-        const int VNC_START_DELAY_SECONDS = 3;
-        std::cout << "[DEBUG_PROCESS] Yerel VNC sunucusunun başlaması için " << VNC_START_DELAY_SECONDS << " saniye bekleniyor..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(VNC_START_DELAY_SECONDS));
-        std::cout << "[DEBUG_PROCESS] Bekleme tamamlandı." << std::endl;
-        
-        std::cout << "[Tünel-Adım1] Yerel VNC sunucusuna (127.0.0.1:5900) bağlanmayı deneniyor..." << std::endl;
-        int local_vnc_sock = -1; struct sockaddr_in local_vnc_addr;
-        const char* LOCAL_VNC_IP = "127.0.0.1"; const int LOCAL_VNC_PORT = 5900;
-        
-        local_vnc_sock = ::socket(AF_INET, SOCK_STREAM, 0);
-        if (local_vnc_sock < 0) { perror("[HATA] Yerel VNC soketi oluşturulamadı"); }
-        else {
-            memset(&local_vnc_addr, 0, sizeof(local_vnc_addr));
-            local_vnc_addr.sin_family = AF_INET; local_vnc_addr.sin_port = htons(LOCAL_VNC_PORT);
-            if (inet_pton(AF_INET, LOCAL_VNC_IP, &local_vnc_addr.sin_addr) <= 0) { 
-                perror(("[HATA] Geçersiz yerel VNC IP adresi: " + std::string(LOCAL_VNC_IP)).c_str()); 
-                ::close(local_vnc_sock); local_vnc_sock = -1;
-            } else {
-                std::cout << "[DEBUG] Yerel VNC'ye connect() çağrılıyor..." << std::endl;
-                if (::connect(local_vnc_sock, (struct sockaddr *)&local_vnc_addr, sizeof(local_vnc_addr)) < 0) { 
-                    perror(("[HATA] Yerel VNC sunucusuna bağlanılamadı (" + std::string(LOCAL_VNC_IP) + ":" + std::to_string(LOCAL_VNC_PORT) + ")").c_str()); 
-                    std::cerr << "       - VNC sunucusu (" << LOCAL_VNC_IP << ":" << LOCAL_VNC_PORT << ") gerçekten başlatıldı ve çalışıyor mu?" << std::endl; 
-                    ::close(local_vnc_sock); local_vnc_sock = -1;
-                } else {
-                                  std::cout << "[Bilgi] Yerel VNC sunucusuna başarıyla bağlanıldı (Soket: " << local_vnc_sock << ")." << std::endl;
-                    
-                    // --- DEĞİŞİKLİK BURADA: İKİ THREAD'İ DE BAŞLAT ---
-                    std::cout << "[Bilgi] İki yönlü VNC tünel thread'leri başlatılıyor..." << std::endl;
-                    
-                    // Uplink Thread (Yerel VNC -> Relay Sunucusu)
-                    std::thread vnc_up_thread(vnc_uplink_thread_func, local_vnc_sock, sock_to_server, std::ref(running), std::ref(cout_mtx_param));
-                    
-                    // Downlink Thread (Relay Sunucusu -> Yerel VNC)
-                    std::thread vnc_down_thread(vnc_control_downlink_thread_func, local_vnc_sock, sock_to_server, std::ref(running), std::ref(cout_mtx_param));
-                    
-                    // Thread'leri ayır, kendi başlarına çalışsınlar
-                    vnc_up_thread.detach();
-                    vnc_down_thread.detach();
-                    
-                }
-            }
-        }
+        // Doğrudan yol, yerel VNC bağlantısı hazırlanırken denenir
+        if (p2p_enabled && !mux_bridge) start_direct_session(sock_to_server, my_id_ref, peer_id_a, false, cout_mtx_param);
+        // Yerel VNC bağlantısı ayrı bir thread'de alınır; sunucu hazır olana kadar konsol kilitlenmez
+        prepare_sharer_vnc_session(sock_to_server, my_id_ref, peer_id_a);
         std::cout << "       (İpucu: İstemci A tarafında VNC Görüntüleyici (dahili) başlayacak.)" << std::endl;
         std::cout << "       Bağlantıyı bitirmek için 'disconnect' komutunu kullanın." << std::endl;
     }
     else if (msg_type == "tunnel_active") {
         std::cout << "[Bilgi] Sunucu VNC tünelinin aktif olduğunu bildirdi." << std::endl;
-        if (client_a_waiting_for_tunnel_activation) { // client_main.cpp'de tanımlı global
+        std::string resume_token; ss >> resume_token; // Relay '--resume-grace=' ile çalışıyorsa verilir
+        bool sharer_session = false;
+        bool viewer_session = false; // Doğrudan yoldan relay'e dönen görüntüleyicinin soket çifti bekliyor
+        bool compress;
+        {
+            std::lock_guard<std::mutex> lock(vnc_session_mutex);
+            compress = negotiated_compression;
+            negotiated_compression = false;
+            pending_resume_token = mux_bridge ? std::string() : resume_token; // Çoğullanmış tüneller devam ettirilmez
+            if (pending_local_vnc_fd >= 0) {
+                // Alıcı thread bu satırdan sonra vekili başlatır; çoğullanmış bağlantıda vekil kendi thread'indedir
+                pending_tunnel_active = !mux_bridge;
+                pending_compression = compress;
+                sharer_session = true;
+                viewer_session = pending_viewer;
+            }
+        }
+        if (compress) std::cout << "[Bilgi] VNC tüneli sıkıştırılıyor (deflate, uyarlamalı seviye)." << std::endl;
+        if (sharer_session) {
+            if (viewer_session) client_a_waiting_for_tunnel_activation = false;
+            std::cout << "[Bilgi] VNC oturumu " << (viewer_session ? "relay tüneliyle sürüyor (görüntüleyici <-> relay)."
+                                                                  : "başlıyor (yerel VNC <-> relay).") << std::endl;
+            if (mux_bridge) start_mux_sharer_session(sock_to_server);
+        } else if (mux_bridge) {
+            client_a_waiting_for_tunnel_activation = false;
+            std::cout << "[Bilgi] TUNNEL_ACTIVE alındı, VNC Downlink (libVNCclient) thread'i veri kanalında başlatılıyor..." << std::endl;
+            start_mux_viewer_session(sock_to_server, compress, cout_mtx_param);
+        } else {
             client_a_waiting_for_tunnel_activation = false;
+            int viewer_fd, proxy_fd;
+            if (open_viewer_pair(&viewer_fd, &proxy_fd)) {
+                // Relay soketini alıcı thread'de vekil okur (run_sharer_vnc_session); görüntüleyici soket çiftinde.
+                // Böylece TUNNEL_ACTIVE ile aynı okumada gelen tünel verisi kaybolmaz ve oturum bitince alıcı
+                // thread komut moduna döner.
+                {
+                    std::lock_guard<std::mutex> lock(vnc_session_mutex);
+                    pending_local_vnc_fd = proxy_fd;
+                    pending_tunnel_active = true;
+                    pending_compression = compress;
+                    pending_viewer = true;
+                }
+                std::cout << "[Bilgi] TUNNEL_ACTIVE alındı, VNC Downlink (libVNCclient) thread'i başlatılıyor..." << std::endl;
+                // Görüntüleyici kapanınca (rfbClientCleanup soketi kapatır) vekil yerel ucun kapandığını görür
+                start_viewer_thread(viewer_fd, cout_mtx_param);
+            }
         }
-            client_a_vnc_data_mode_active = true;
-            // Şimdi libVNCclient thread'ini başlat, soket artık onun.
-            std::cout << "[Bilgi] TUNNEL_ACTIVE alındı, VNC Downlink (libVNCclient) thread'i başlatılıyor..." << std::endl;
-            std::thread vnc_session_thread(vnc_downlink_thread_func, sock_to_server, std::ref(running), std::ref(cout_mtx_param));
-            vnc_session_thread.detach();
+    } else if (msg_type == "tunnel_options") { // Relay, TUNNEL_ACTIVE'den hemen önce anlaşılan seçenekleri bildirir
+        std::string option;
+        bool deflate = false;
+        while (ss >> option) deflate = deflate || option == TUNNEL_OPTION_DEFLATE;
+        std::lock_guard<std::mutex> lock(vnc_session_mutex);
+        negotiated_compression = deflate && tunnel_compression;
+    } else if (msg_type == "p2p_bind" || msg_type == "p2p_candidates" || msg_type == "p2p_fallback") {
+        std::string argument; std::getline(ss, argument);
+        if (!argument.empty() && argument[0] == ' ') argument.erase(0, 1);
+        std::string type = msg_type;
+        std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+        forward_to_direct_session(type, argument);
     } else if (msg_type == "peer_disconnected") { 
         std::string peer_id; ss >> peer_id; 
         std::cout << "[Bilgi] ID '" << peer_id << "' bağlantısı KESİLDİ." << std::endl; 
         client_a_waiting_for_tunnel_activation = false; // Eğer bekliyorsa artık beklemesin
-        // TODO: Aktif VNC thread'lerini (uplink/downlink) burada sonlandırmak için bir flag veya mekanizma.
-        // 'running' flag'i zaten genel olarak bunu yapar ama daha spesifik bir session flag'i olabilir.
+        discard_pending_vnc_session(); // Tünel açılmadan eş ayrıldı
+        if (mux_bridge) cancel_vnc_session(); // Çoğullanmış bağlantı açık kalır; yalnızca oturum biter
     } else if (msg_type == "disconnected_ok") { 
         std::cout << "[Bilgi] Mevcut bağlantınız başarıyla sonlandırıldı." << std::endl; 
         client_a_waiting_for_tunnel_activation = false;
-        // TODO: Aktif VNC thread'lerini sonlandır.
+        discard_pending_vnc_session();
+        if (mux_bridge) cancel_vnc_session();
     } else if (msg_type == "msg_from") { 
         std::string source_id; ss >> source_id;
         std::string message_content; std::getline(ss, message_content);
@@ -582,6 +946,7 @@ void process_server_message(const std::string& server_msg_line, std::string& my_
         std::string error_message; std::getline(ss, error_message);
         if(!error_message.empty() && error_message[0] == ' ') error_message.erase(0,1);
         std::cerr << "[Sunucu Hatası] " << error_message << std::endl;
+        if (error_message.rfind("P2P:", 0) == 0) forward_to_direct_session("ERROR", error_message);
     } else if (msg_type == "list_begin") { std::cout << "--- Bağlı İstemciler Listesi ---" << std::endl; }
     else if (msg_type == "list_end") { std::cout << "--------------------------------" << std::endl; }
     else if (msg_type_original.rfind("ID: ", 0) == 0 ) { // LIST içeriği için orijinal msg_type_original (büyük harf 'ID:')
@@ -594,3 +959,64 @@ void process_server_message(const std::string& server_msg_line, std::string& my_
     std::cout.flush();
 }
 
+int secure_relay_connection(int sock, const std::string& ca_file, std::mutex& c_mutex_ref) {
+    std::unique_ptr<TlsContext> context;
+    std::unique_ptr<TlsStream> stream;
+    try {
+        context = TlsContext::client(ca_file);
+        context->set_ktls(true);
+        stream.reset(new TlsStream(*context, sock));
+    } catch (const std::runtime_error& e) {
+        std::lock_guard<std::mutex> lock(c_mutex_ref);
+        std::cerr << "[HATA] TLS yapılandırılamadı: " << e.what() << std::endl;
+        return -1;
+    }
+    // Soket engelleyen modda olduğundan el sıkışma tek çağrıda biter
+    if (stream->handshake() != TLS_DONE) {
+        std::lock_guard<std::mutex> lock(c_mutex_ref);
+        std::cerr << "[HATA] TLS el sıkışması başarısız (sunucu TLS kullanmıyor veya sertifika doğrulanamadı)." << std::endl;
+        return -1;
+    }
+
+    std::string reason;
+    KtlsResult result = stream->enable_ktls(&reason);
+    if (result == KTLS_ENABLED) {
+        std::lock_guard<std::mutex> lock(c_mutex_ref);
+        std::cout << "[Bilgi] TLS bağlantısı kuruldu (kTLS, " << stream->cipher_name() << ")." << std::endl;
+        return sock;
+    }
+    if (result == KTLS_FAILED) {
+        std::lock_guard<std::mutex> lock(c_mutex_ref);
+        std::cerr << "[HATA] kTLS anahtarları kurulamadı: " << reason << std::endl;
+        return -1;
+    }
+
+    // kTLS yok: şifreleme bir köprü thread'inde yapılır, uygulama soket çiftinin diğer ucunu kullanır
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        perror("[HATA] TLS köprüsü için soket çifti oluşturulamadı");
+        return -1;
+    }
+    ::fcntl(sock, F_SETFL, ::fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    ::fcntl(pair[1], F_SETFL, ::fcntl(pair[1], F_GETFL, 0) | O_NONBLOCK);
+    {
+        std::lock_guard<std::mutex> lock(c_mutex_ref);
+        std::cout << "[Bilgi] TLS bağlantısı kuruldu (" << stream->cipher_name() << ", kullanıcı alanı; kTLS: "
+                  << reason << ")." << std::endl;
+    }
+    std::shared_ptr<TlsContext> shared_context(std::move(context));
+    std::shared_ptr<TlsBridge> bridge = std::make_shared<TlsBridge>(std::move(stream), pair[1]);
+    std::thread([shared_context, bridge]() {
+        log_set_thread_name("tls");
+        while (bridge->pump()) {
+            struct pollfd fds[2];
+            fds[0].fd = bridge->tls_fd();
+            fds[0].events = bridge->tls_events();
+            fds[1].fd = bridge->plain_fd();
+            fds[1].events = bridge->plain_events();
+            if (::poll(fds, 2, -1) < 0 && errno != EINTR) break;
+        }
+        // Köprünün yıkıcısı iki soketi de kapatır; uygulama kendi ucunda EOF görür
+    }).detach();
+    return pair[0];
+}
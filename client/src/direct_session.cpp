@@ -0,0 +1,304 @@
+#include "../includes/direct_session.h"
+#include "../includes/client_utils.h" // send_server_message
+#include "../../include/logger.h"
+#include "../../include/p2p_link.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+// Buluşma + hole punching için en fazla bekleme ("p2p" gönderiminden sonra; paylaşan taraf bu sürede
+// yerel VNC sunucusunu da hazırlıyor olabilir)
+static const int PUNCH_TIMEOUT_MS = 5000;
+static const size_t CHUNK_BYTES = 64 * 1024;
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+DirectSession::DirectSession(int sock_to_server, const std::string& relay_ip, const std::string& my_id, bool viewer,
+                             Hooks hooks)
+    : sock_to_server_(sock_to_server), relay_ip_(relay_ip), my_id_(my_id), viewer_(viewer), hooks_(std::move(hooks)) {}
+
+DirectSession::~DirectSession() {
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+    if (local_fd_ >= 0) ::close(local_fd_);
+    if (offered_fd_ >= 0) ::close(offered_fd_);
+}
+
+bool DirectSession::start() {
+    try {
+        puncher_.reset(new HolePuncher(my_id_));
+    } catch (const std::system_error& e) {
+        LOG(LOG_WARN) << "[P2P] UDP soketi açılamadı: " << e.what();
+        return false;
+    }
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) return false;
+    if (!send_server_message(sock_to_server_, "p2p " + puncher_->local_candidate(sock_to_server_))) return false;
+    std::shared_ptr<DirectSession> self = shared_from_this();
+    std::thread([self]() {
+        log_set_thread_name("p2p");
+        self->run();
+    }).detach();
+    return true;
+}
+
+void DirectSession::on_control(const std::string& type, const std::string& argument) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lines_.emplace_back(type, argument);
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+bool DirectSession::offer_local_fd(int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!accepting_ || cancelled_) return false;
+    offered_fd_ = fd;
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    return true;
+}
+
+void DirectSession::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    accepting_ = false;
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+// Bekleyen satırları ve verilmiş yerel bağlantıyı alır; iptal edildiyse false
+bool DirectSession::take_lines(std::deque<std::pair<std::string, std::string>>* lines) {
+    uint64_t count;
+    ssize_t ignored = ::read(wake_fd_, &count, sizeof(count));
+    (void)ignored;
+    std::lock_guard<std::mutex> lock(mutex_);
+    lines->swap(lines_);
+    if (offered_fd_ >= 0 && local_fd_ < 0) {
+        local_fd_ = offered_fd_;
+        offered_fd_ = -1;
+        ::fcntl(local_fd_, F_SETFL, ::fcntl(local_fd_, F_GETFL, 0) | O_NONBLOCK);
+    }
+    return !cancelled_;
+}
+
+void DirectSession::run() {
+    bool send_result = false;
+    bool punched = punch(&send_result);
+    Outcome outcome = punched ? bridge(&send_result) : DIRECT_FALLBACK;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) outcome = DIRECT_CANCELLED;
+    }
+    if (outcome == DIRECT_FALLBACK) {
+        fall_back(send_result);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accepting_ = false;
+    }
+    if (local_fd_ >= 0) ::close(local_fd_);
+    local_fd_ = -1;
+    std::string summary = outcome == DIRECT_CANCELLED ? "iptal edildi" : "yerel uç kapandı";
+    if (stream_) {
+        summary += ", yerel -> eş " + std::to_string(local_to_peer_) + " byte, eş -> yerel " +
+                   std::to_string(peer_to_local_) + " byte, yeniden gönderim " + std::to_string(stream_->retransmits());
+    }
+    LOG(LOG_INFO) << "[P2P] Doğrudan oturum bitti (" << summary << ").";
+    if (hooks_.on_finished) hooks_.on_finished(this, summary);
+}
+
+/**
+ * Buluşma ve hole punching. Yol bulunursa "p2p_result direct" gönderilir. false dönerse relay'e
+ * dönülür; *send_result, dönüş kararı bu uçta verildiyse ("p2p_result relay" gerekir) true'dur.
+ */
+bool DirectSession::punch(bool* send_result) {
+    int64_t start = now_ms();
+    int64_t deadline = start + PUNCH_TIMEOUT_MS;
+    bool attempt = false; // Relay P2P_BIND ile denemeyi kabul etti
+    std::deque<std::pair<std::string, std::string>> lines;
+    while (true) {
+        if (!take_lines(&lines)) return false;
+        for (const auto& line : lines) {
+            if (line.first == "P2P_BIND") {
+                attempt = puncher_->on_bind(relay_ip_, line.second);
+                if (!attempt) {
+                    *send_result = true;
+                    return false;
+                }
+            } else if (line.first == "P2P_CANDIDATES") {
+                puncher_->on_candidates(line.second);
+            } else if (line.first == "P2P_FALLBACK" || line.first == "ERROR") {
+                LOG(LOG_INFO) << "[P2P] Relay'e dönülüyor (" << line.first << " " << line.second << ").";
+                return false;
+            }
+        }
+        lines.clear();
+        int64_t now = now_ms();
+        if (now >= deadline) {
+            LOG(LOG_INFO) << "[P2P] " << PUNCH_TIMEOUT_MS << " ms içinde doğrudan yol bulunamadı"
+                          << (puncher_->has_candidates() ? "" : " (adaylar gelmedi)") << ".";
+            *send_result = attempt;
+            return false;
+        }
+        puncher_->on_timer();
+        struct pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {puncher_->fd(), POLLIN, 0}};
+        int timeout = (int)std::min<int64_t>(puncher_->timeout_ms(), deadline - now);
+        if (::poll(fds, 2, timeout) <= 0) continue;
+        if ((fds[1].revents & POLLIN) && puncher_->on_readable()) break;
+    }
+    LOG(LOG_INFO) << "[P2P] Doğrudan yol bulundu: eş " << format_udp_address(puncher_->peer()) << ", "
+                  << now_ms() - start << " ms.";
+    if (!send_server_message(sock_to_server_, "p2p_result direct")) return false;
+    return true;
+}
+
+/**
+ * Yerel uç ile doğrudan yol arasında aktarım. Paylaşan tarafta yerel VNC bağlantısı hazır olana kadar
+ * eşten gelen veri akışın tamponunda bekler.
+ */
+DirectSession::Outcome DirectSession::bridge(bool* send_result) {
+    stream_.reset(new UdpStream(puncher_->fd(), puncher_->peer(), puncher_->key(), my_id_));
+    *send_result = true; // Eş doğrudan yolda; relay'e dönüş ona bildirilmeli
+    if (viewer_) {
+        int fd = hooks_.open_viewer ? hooks_.open_viewer() : -1;
+        if (fd < 0) return DIRECT_FALLBACK;
+        std::lock_guard<std::mutex> lock(mutex_);
+        offered_fd_ = fd;
+    }
+    std::unique_ptr<char[]> buffer(new char[CHUNK_BYTES]);
+    std::deque<std::pair<std::string, std::string>> lines;
+    bool local_eof = false;
+    bool local_shut = false;
+    bool closed_first = false; // Yerel uç eşinkinden önce kapandı; eşleşmeyi bu uç bitirir
+    int64_t eof_at = 0;
+    {
+        std::lock_guard<std::mutex> out(cout_mutex);
+        std::cout << "\n[Bilgi] Doğrudan bağlantı kuruldu (eş " << format_udp_address(puncher_->peer())
+                  << "); VNC verisi relay'den geçmiyor." << std::endl;
+        std::cout << "> ";
+        std::cout.flush();
+    }
+    while (true) {
+        if (!take_lines(&lines)) return DIRECT_CANCELLED;
+        for (const auto& line : lines) {
+            if (line.first == "P2P_FALLBACK") {
+                LOG(LOG_INFO) << "[P2P] Eş relay tüneline döndü; akış relay üzerinden sürecek.";
+                *send_result = false;
+                return DIRECT_FALLBACK;
+            }
+        }
+        lines.clear();
+        stream_->on_timer();
+
+        // Yerel uç -> eş: yalnızca akışın tamponunda yer varken okunur
+        for (int reads = 0; local_fd_ >= 0 && !local_eof && stream_->writable() > 0 && reads < 16; ++reads) {
+            ssize_t n = ::read(local_fd_, buffer.get(), std::min(CHUNK_BYTES, stream_->writable()));
+            if (n > 0) {
+                stream_->write(buffer.get(), n);
+                local_to_peer_ += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            local_eof = true;
+            closed_first = !stream_->peer_finished();
+            stream_->finish();
+        }
+        // Eş -> yerel uç
+        while (local_fd_ >= 0 && !local_eof) {
+            if (to_local_off_ == to_local_.size()) {
+                to_local_.clear();
+                to_local_off_ = 0;
+                size_t n = stream_->read(buffer.get(), CHUNK_BYTES);
+                if (n == 0) break;
+                to_local_.assign(buffer.get(), n);
+            }
+            ssize_t n = ::send(local_fd_, to_local_.data() + to_local_off_, to_local_.size() - to_local_off_, MSG_NOSIGNAL);
+            if (n > 0) {
+                to_local_off_ += n;
+                peer_to_local_ += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            local_eof = true; // Yerel uç kapandı
+            closed_first = !stream_->peer_finished();
+            stream_->finish();
+        }
+        // Eşin yerel ucu kapandı ve verisi yazıldı: yerel uca da iletilir, o da kapanır
+        if (local_fd_ >= 0 && !local_shut && stream_->peer_finished() && to_local_off_ == to_local_.size()) {
+            ::shutdown(local_fd_, SHUT_WR);
+            local_shut = true;
+        }
+        if (local_eof && eof_at == 0) eof_at = now_ms();
+        // Eşin yerel ucu da kapanınca (veya kapanmazsa bir süre sonra) oturum biter
+        if (local_eof && stream_->flushed() && (stream_->peer_finished() || now_ms() - eof_at > P2P_SILENCE_MS)) {
+            if (closed_first) send_server_message(sock_to_server_, "disconnect");
+            return DIRECT_FINISHED;
+        }
+        if (stream_->broken()) {
+            LOG(LOG_WARN) << "[P2P] Doğrudan yol koptu (" << P2P_SILENCE_MS << " ms yanıt yok); relay tüneline dönülüyor.";
+            return DIRECT_FALLBACK;
+        }
+
+        struct pollfd fds[3] = {{wake_fd_, POLLIN, 0}, {puncher_->fd(), POLLIN, 0}, {-1, 0, 0}};
+        if (local_fd_ >= 0 && !local_eof) {
+            fds[2].fd = local_fd_;
+            fds[2].events = (stream_->writable() > 0 ? POLLIN : 0) | (to_local_off_ < to_local_.size() ? POLLOUT : 0);
+            if (fds[2].events == 0) fds[2].fd = -1;
+        }
+        if (::poll(fds, 3, stream_->timeout_ms()) <= 0) continue;
+        if (fds[1].revents & POLLIN) stream_->on_readable();
+    }
+}
+
+// Relay tüneline dönüş: yerel uç ve akışın konumu çağırana verilir
+void DirectSession::fall_back(bool send_result) {
+    if (send_result) send_server_message(sock_to_server_, "p2p_result relay");
+    int local_fd;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accepting_ = false;
+        if (offered_fd_ >= 0 && local_fd_ < 0) {
+            local_fd_ = offered_fd_;
+            offered_fd_ = -1;
+        }
+        local_fd = local_fd_;
+        local_fd_ = -1;
+    }
+    DirectHandover handover;
+    if (stream_) {
+        handover.received = stream_->bytes_received();
+        handover.to_local.assign(to_local_, to_local_off_, std::string::npos);
+        std::unique_ptr<char[]> buffer(new char[CHUNK_BYTES]);
+        while (size_t n = stream_->read(buffer.get(), CHUNK_BYTES)) handover.to_local.append(buffer.get(), n);
+        handover.sent_base = stream_->bytes_acked();
+        stream_->unacked_from(handover.sent_base, &handover.outbound);
+        LOG(LOG_INFO) << "[P2P] Doğrudan yoldan eşe " << handover.sent_base << " byte ulaştı (" << handover.outbound.size()
+                      << " byte relay'den yeniden gönderilecek), eşten " << handover.received << " byte alındı.";
+    }
+    if (hooks_.on_fallback) {
+        hooks_.on_fallback(this, local_fd, std::move(handover));
+    } else if (local_fd >= 0) {
+        ::close(local_fd);
+    }
+}
@@ -1,4 +1,5 @@
 #include "../includes/client_utils.h" // Kendi başlık dosyanızın yolu doğru varsayıldı
+#include "../../include/logger.h"        // Relay ile ortak asenkron günlükleyici
 #include <iostream>
 #include <string>
 #include <thread>
@@ -18,7 +19,14 @@ std::string my_id = "UNKNOWN";
 std::atomic<bool> running(true);
 std::mutex cout_mutex;
 std::atomic<bool> client_a_waiting_for_tunnel_activation(false);
-std::atomic<bool> client_a_vnc_data_mode_active(false); //// Sinyal işleyici
+
+// Relay adresi ve bağlantı seçenekleri; tek kanallı oturum bitince aynı ayarlarla yeniden bağlanılır
+std::string relay_ip;
+static int relay_port = 0;
+static bool relay_use_tls = false;
+static std::string relay_tls_ca_file;
+
+//// Sinyal işleyici
 
 void signal_handler(int signum) {
    {
@@ -35,58 +43,159 @@ void signal_handler(int signum) {
    }
 }
 
+// Relay'e TCP ile bağlanır ve istenmişse TLS'e geçer. Kullanılacak soketi veya hata durumunda -1 döner.
+static int connect_to_relay() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[HATA] Soket oluşturma başarısız");
+        return -1;
+    }
+
+    // Sunucu adresi yapısını ayarla
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(relay_port); // Portu network byte order'a çevir
+
+    // IP adresini network formatına çevir ve ayarla
+    if (inet_pton(AF_INET, relay_ip.c_str(), &serv_addr.sin_addr) <= 0) {
+        perror(("[HATA] Geçersiz adres/Desteklenmeyen format: " + relay_ip).c_str());
+        close(fd);
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror(("[HATA] Bağlantı Başarısız (" + relay_ip + ":" + std::to_string(relay_port) + ")").c_str());
+        close(fd);
+        return -1;
+    }
+
+    if (relay_use_tls) {
+        int secured = secure_relay_connection(fd, relay_tls_ca_file, cout_mutex);
+        if (secured < 0) {
+            close(fd);
+            return -1;
+        }
+        fd = secured; // kTLS'te aynı soket, aksi halde TLS köprüsünün ucu
+    }
+    return fd;
+}
+
+// Tek kanallı bağlantıda relay tünelden yalnızca bağlantı kapanınca çıkar. Oturum bitince eski bağlantı
+// yeni bir bağlantıyla değiştirilir; soket numarası (dup2) korunduğu için diğer thread'lerin elindeki
+// 'sock' geçerli kalır. Relay yeni bir ID atar ve ajan komut moduna döner.
+static bool reconnect_to_relay() {
+    int fresh = connect_to_relay();
+    if (fresh < 0) return false;
+    bool replaced = running && sock > 0 && dup2(fresh, sock) >= 0;
+    close(fresh);
+    if (replaced) {
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << "[Bilgi] Relay'e yeniden bağlanıldı. Yeni ID bekleniyor..." << std::endl;
+    }
+    return replaced;
+}
+
 // Sunucudan mesajları dinleyen thread fonksiyonu
 void receive_messages_thread_func() {
     char buffer[4096];
     std::string partial_message;
     std::string current_line;
 
-    // DÖNGÜ KOŞULU GÜNCELLENDİ
-    while (running && !client_a_vnc_data_mode_active) {
+    while (running) {
         if (sock <= 0) { running = false; break; }
 
-        memset(buffer, 0, sizeof(buffer));
-        ssize_t bytes_read = ::read(sock, buffer, sizeof(buffer) - 1);
+        ssize_t bytes_read = ::read(sock, buffer, sizeof(buffer));
 
         if (bytes_read <= 0) {
-            // ... (hata ve bağlantı kopma logları) ...
+            if (running) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                std::cerr << "\n[Hata] Sunucu bağlantısı kapandı." << std::endl;
+            }
             running = false;
             break;
         }
 
-        partial_message += buffer;
+        partial_message.append(buffer, bytes_read); // Tünel verisi 0 byte içerebilir
         size_t newline_pos;
         
-        // İkinci while koşulu da güncellendi
-        while (running && !client_a_vnc_data_mode_active && (newline_pos = partial_message.find('\n')) != std::string::npos) {
+        while (running && (newline_pos = partial_message.find('\n')) != std::string::npos) {
             current_line = partial_message.substr(0, newline_pos);
             partial_message.erase(0, newline_pos + 1);
             if (!current_line.empty()) {
                 process_server_message(current_line, my_id, cout_mutex, sock);
             }
+            if (sharer_vnc_session_ready()) {
+                // TUNNEL_ACTIVE'den sonra okunmuş veri tünel verisidir; relay soketini artık vekil okur
+                VncProxy::Result result = run_sharer_vnc_session(sock, partial_message, connect_to_relay);
+                partial_message.clear();
+                {
+                    std::lock_guard<std::mutex> lock(cout_mutex);
+                    std::cout << "\n[Bilgi] VNC oturumu bitti (" << VncProxy::result_name(result)
+                              << "). Tünel relay bağlantısıyla kapatılıyor, komut moduna dönülüyor." << std::endl;
+                }
+                if (running && !reconnect_to_relay()) {
+                    std::lock_guard<std::mutex> lock(cout_mutex);
+                    std::cerr << "[Hata] Relay'e yeniden bağlanılamadı. Çıkılıyor..." << std::endl;
+                    running = false;
+                    if (sock > 0) shutdown(sock, SHUT_RDWR);
+                }
+                break; // Eski bağlantıdan okunmuş başka satır yok; yeni bağlantı ID ile başlar
+            }
         }
     } // Ana while döngüsü sonu
 
     { // Thread sonlanma logu
         std::lock_guard<std::mutex> lock(cout_mutex);
-        if (client_a_vnc_data_mode_active) {
-            std::cout << "\n[Bilgi] Ana mesaj alıcı thread VNC veri modu nedeniyle durduruldu. Soket libVNCclient'e devredildi." << std::endl;
-        } else {
-            std::cout << "\n[Bilgi] Sunucu dinleme thread'i sonlandırıldı." << std::endl;
-        }
+        std::cout << "\n[Bilgi] Sunucu dinleme thread'i sonlandırıldı." << std::endl;
     }
 }
 
 
 int main(int argc, char *argv[]) {
     // Argüman sayısını kontrol et
-    if (argc != 3) {
+    if (argc < 3) {
         // std::cerr standart hata akışına yazar, genellikle hatalar için tercih edilir
         std::cerr << "Hata: Yanlış argüman sayısı." << std::endl;
-        std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port>" << std::endl;
+        std::cerr << "Kullanım: " << argv[0] << " <sunucu_ip> <sunucu_port> [--tls] [--tls-ca=CA_DOSYASI] [--capture=DİZİN] [--mux] [--vnc-prewarm] [--vnc-external] [--compress] [--p2p]" << std::endl;
         return 1; // Hata kodu ile çık
     }
 
+    // Relay '--tls-cert' ile çalışıyorsa bağlantı TLS ile şifrelenir; CA verilirse sertifika doğrulanır
+    bool use_tls = false;
+    bool use_mux = false; // Komutlar ve VNC verisi aynı bağlantıda ayrı kanallardan akar
+    bool vnc_prewarm = false;
+    std::string tls_ca_file;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tls") {
+            use_tls = true;
+        } else if (arg.rfind("--tls-ca=", 0) == 0) {
+            use_tls = true;
+            tls_ca_file = arg.substr(arg.find('=') + 1);
+        } else if (arg.rfind("--capture=", 0) == 0) {
+            capture_dir = arg.substr(arg.find('=') + 1); // Paylaşan taraf VNC oturumunu kaydeder
+        } else if (arg == "--mux") {
+            use_mux = true;
+        } else if (arg == "--vnc-prewarm") {
+            vnc_prewarm = true; // Yerel VNC sunucusu ilk bağlantı isteği beklenmeden başlatılır
+        } else if (arg == "--vnc-external") {
+            local_vnc_server.set_managed(false); // Yalnızca dışarıda başlatılmış sunucu kullanılır
+        } else if (arg == "--compress") {
+            tunnel_compression = true; // Eş de isterse tünel sıkıştırılır
+        } else if (arg == "--p2p") {
+            p2p_enabled = true; // Relay '--rendezvous-port=' ile çalışıyorsa doğrudan yol denenir
+        } else {
+            std::cerr << "Hata: Bilinmeyen argüman: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (p2p_enabled && use_mux) {
+        std::cerr << "[Uyarı] '--p2p' çoğullanmış bağlantıda desteklenmiyor; yok sayılıyor." << std::endl;
+        p2p_enabled = false;
+    }
+
     const char* SERVER_IP = argv[1];
     int SERVER_PORT = 0;
 
@@ -107,37 +216,47 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    struct sockaddr_in serv_addr;
+    relay_ip = SERVER_IP;
+    relay_port = SERVER_PORT;
+    relay_use_tls = use_tls;
+    relay_tls_ca_file = tls_ca_file;
 
     // Sinyalleri ayarla (programın başında yapmak iyi bir pratik)
     signal(SIGINT, signal_handler);  // Ctrl+C
     signal(SIGTERM, signal_handler); // Sistemden gelen kapatma sinyali
-
-    // Soket oluştur
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        perror("[HATA] Soket oluşturma başarısız");
-        return 1; // Hata kodu ile çık
-    }
-
-    // Sunucu adresi yapısını ayarla
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(SERVER_PORT); // Portu network byte order'a çevir
-
-    // IP adresini network formatına çevir ve ayarla
-    if(inet_pton(AF_INET, SERVER_IP, &serv_addr.sin_addr) <= 0) {
-        perror(("[HATA] Geçersiz adres/Desteklenmeyen format: " + std::string(SERVER_IP)).c_str());
-        close(sock); // Oluşturulan soketi kapat
-        return 1;
-    }
+    // VNC veri yolunun günlükleri arka planda yazılır; SIGUSR1 parça başına (TRACE) günlükleri açıp kapatır
+    log_set_thread_name("main");
+    log_install_level_toggle(SIGUSR1);
+    log_start();
+    // Sunucu relay bağlantısıyla paralel olarak ısınır; ilk oturum hazır sunucuya bağlanır
+    if (vnc_prewarm) local_vnc_server.start();
 
     // Sunucuya bağlanmayı dene
     std::cout << "[Bilgi] Sunucuya (" << SERVER_IP << ":" << SERVER_PORT << ") bağlanılıyor..." << std::endl;
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        perror(("[HATA] Bağlantı Başarısız (" + std::string(SERVER_IP) + ":" + std::to_string(SERVER_PORT) + ")").c_str());
-        close(sock);
+    sock = connect_to_relay();
+    if (sock < 0) {
+        sock = 0;
         return 1;
     }
 
+    if (use_mux) {
+        std::string preamble;
+        int control = start_mux_link(sock, &preamble, cout_mutex);
+        if (control < 0) {
+            std::cerr << "[HATA] Relay ile kanal çoğullama kurulamadı." << std::endl;
+            if (sock > 0) close(sock);
+            return 1;
+        }
+        sock = control; // Köprünün kontrol ucu (relay desteklemiyorsa aynı soket)
+        // Yanıttan önce gelen satırlar (ID) alıcı thread başlamadan işlenir
+        size_t newline_pos;
+        while ((newline_pos = preamble.find('\n')) != std::string::npos) {
+            std::string line = preamble.substr(0, newline_pos);
+            preamble.erase(0, newline_pos + 1);
+            if (!line.empty()) process_server_message(line, my_id, cout_mutex, sock);
+        }
+    }
+
     // Bağlantı başarılıysa devam et
     std::cout << "[Bilgi] Sunucuya bağlanıldı. ID bekleniyor..." << std::endl;
 
@@ -167,6 +286,18 @@ int main(int argc, char *argv[]) {
         // Eğer sinyal handler running'i false yaptıysa döngüden çık
         if (!running) break;
 
+        // VNC oturumu sürerken relay soketi tünel verisi taşır; komutlar gönderilmez. Çoğullanmış
+        // bağlantıda komutlar (disconnect dahil) kontrol kanalından relay'e gider.
+        if (vnc_session_active() && !mux_enabled()) {
+            if (line == "disconnect" || line == "exit") {
+                cancel_vnc_session();
+            } else if (!line.empty()) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                std::cout << "[Bilgi] VNC oturumu sürüyor; yalnızca 'disconnect' kullanılabilir." << std::endl;
+            }
+            continue;
+        }
+
         // Boş satırları gönderme
         if (!line.empty()) {
              // Komutu sunucuya gönder
@@ -202,6 +333,8 @@ int main(int argc, char *argv[]) {
         std::cout << "[Bilgi] Alıcı thread bitti." << std::endl;
     }
 
+    local_vnc_server.stop();
+    log_stop();
     std::cout << "[Bilgi] İstemci programı sonlandı." << std::endl;
     return 0; // Başarılı çıkış kodu
 }
@@ -0,0 +1,288 @@
+#include "../includes/vnc_proxy.h"
+#include "../../include/capture.h"
+#include "../../include/logger.h"
+#include "../../include/ring_buffer.h"
+#include "../../include/tunnel_compression.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+static void set_nonblocking(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+VncProxy::VncProxy(int local_fd, int relay_fd)
+    : local_fd_(local_fd), relay_fd_(relay_fd), relay_flags_(-1), cancel_fd_(-1) {
+    cancel_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (cancel_fd_ < 0) {
+        int error = errno;
+        ::close(local_fd_);
+        throw std::system_error(error, std::generic_category(), "eventfd");
+    }
+    flows_[0].from = local_fd_;
+    flows_[0].to = relay_fd_;
+    flows_[1].from = relay_fd_;
+    flows_[1].to = local_fd_;
+    for (Flow& flow : flows_) flow.buffer.reset(new char[BUFFER_SIZE]);
+}
+
+VncProxy::~VncProxy() {
+    ::close(local_fd_);
+    ::close(cancel_fd_);
+}
+
+void VncProxy::capture_to(std::unique_ptr<CaptureWriter> writer) {
+    capture_ = std::move(writer);
+}
+
+void VncProxy::enable_resume(size_t replay_bytes) {
+    // Saklanan veri boş alandan düştüğü için kapasite iki katıdır; yeni gönderimlere her zaman yer kalır
+    replay_.reset(new RingBuffer(replay_bytes * 2, replay_bytes));
+}
+
+bool VncProxy::resume(uint64_t relay_received) {
+    Flow& uplink = flows_[0];
+    if (!replay_ || relay_received > uplink.total || uplink.total - relay_received > replay_->retained()) return false;
+    replay_->rewind(uplink.total - relay_received);
+    uplink.total = relay_received;
+    return true;
+}
+
+void VncProxy::take_over(const std::string& to_relay, const std::string& to_local, uint64_t relay_offset) {
+    local_backlog_ = to_relay;
+    to_local_backlog_ = to_local;
+    flows_[0].total = relay_offset;
+    relay_received_ = relay_offset;
+}
+
+bool VncProxy::wait_for_cancel(int timeout_ms) {
+    struct pollfd fd = {cancel_fd_, POLLIN, 0};
+    return ::poll(&fd, 1, timeout_ms) > 0 && (fd.revents & POLLIN);
+}
+
+void VncProxy::enable_compression() {
+    compressor_.reset(new TunnelCompressor());
+    decompressor_.reset(new TunnelDecompressor());
+}
+
+const char* VncProxy::pending_data(const Flow& flow) const {
+    bool coded = &flow == &flows_[0] ? compressor_ != nullptr : decompressor_ != nullptr;
+    return coded ? flow.coded.data() : flow.buffer.get();
+}
+
+// Kaynaktan okunup tampona konmuş len byte'ı gönderime hazırlar: sıkıştırma açıksa yön 0 sıkıştırılır,
+// yön 1 çözülür. Kayda her zaman yerel taraftaki (sıkıştırılmamış) veri yazılır.
+bool VncProxy::accept_input(Flow& flow, uint8_t direction, size_t len) {
+    const char* data = flow.buffer.get();
+    if (direction == 0 && compressor_) {
+        if (capture_) capture_->append(direction, data, len);
+        flow.coded.clear();
+        if (!compressor_->compress(data, len, &flow.coded)) {
+            LOG(LOG_ERROR) << "[VNC Vekil] Sıkıştırma hatası.";
+            return false;
+        }
+        flow.len = flow.coded.size();
+    } else if (direction == 1 && decompressor_) {
+        flow.coded.clear();
+        if (!decompressor_->decompress(data, len, &flow.coded)) {
+            LOG(LOG_ERROR) << "[VNC Vekil] Relay'den gelen sıkıştırılmış akış çözülemedi.";
+            return false;
+        }
+        if (capture_ && !flow.coded.empty()) capture_->append(direction, flow.coded.data(), flow.coded.size());
+        flow.len = flow.coded.size();
+    } else {
+        if (capture_) capture_->append(direction, data, len);
+        flow.len = len;
+    }
+    return true;
+}
+
+void VncProxy::cancel() {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(cancel_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+const char* VncProxy::result_name(Result result) {
+    switch (result) {
+    case PROXY_LOCAL_CLOSED: return "yerel VNC kapandı";
+    case PROXY_RELAY_CLOSED: return "relay bağlantısı kapandı";
+    case PROXY_CANCELLED: return "iptal edildi";
+    case PROXY_FAILED: return "aktarım hatası";
+    case PROXY_RELAY_LOST: return "relay bağlantısı koptu";
+    }
+    return "?";
+}
+
+// Yönü engellemeden ilerletir: tampondakini gönderir, tampon boşalınca kaynaktan yeniden okur.
+// Bekleme gerekince (EAGAIN) veya kaynak kapanıp tampon boşalınca döner. Hata olursa false;
+// hata relay soketindeyse relay_lost_ işaretlenir.
+bool VncProxy::pump(Flow& flow, uint8_t direction) {
+    // Devam ettirmeden sonra relay'e ulaşmamış veri, tampondaki yeni veriden önce yeniden gönderilir
+    while (direction == 0 && replay_ && !replay_->empty()) {
+        ssize_t n = replay_->send_to_socket(flow.to);
+        if (n > 0) {
+            flow.total += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        relay_lost_ = true;
+        return false;
+    }
+    while (true) {
+        const char* pending = pending_data(flow);
+        while (flow.off < flow.len) {
+            ssize_t n = ::send(flow.to, pending + flow.off, flow.len - flow.off, MSG_NOSIGNAL);
+            if (n > 0) {
+                if (direction == 0 && replay_) {
+                    replay_->write(pending + flow.off, n);
+                    replay_->discard(n); // Gönderildi; yeniden gönderim için saklanır
+                }
+                flow.off += n;
+                flow.total += n;
+                if (direction == 0 && compressor_) compressor_->note_blocked(false);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (direction == 0 && compressor_) compressor_->note_blocked(true); // Bağlantı darboğaz olabilir
+                return true;
+            }
+            if (flow.to == relay_fd_) relay_lost_ = true;
+            return false;
+        }
+        flow.off = flow.len = 0;
+        if (flow.eof) return true;
+
+        // Doğrudan yoldan devralınan veri her yönde önce aktarılır; yerel uca gidecek olan zaten çözülmüştür
+        std::string& handed_over = direction == 0 ? local_backlog_ : to_local_backlog_;
+        if (!handed_over.empty()) {
+            size_t len = handed_over.size() < BUFFER_SIZE ? handed_over.size() : BUFFER_SIZE;
+            if (direction == 1 && decompressor_) {
+                flow.coded.assign(handed_over, 0, len);
+                flow.len = len;
+                if (capture_) capture_->append(direction, flow.coded.data(), len);
+            } else {
+                memcpy(flow.buffer.get(), handed_over.data(), len);
+                if (!accept_input(flow, direction, len)) return false;
+            }
+            handed_over.erase(0, len);
+            continue;
+        }
+        // Komut satırlarıyla birlikte okunmuş tünel verisi soketten önce aktarılır
+        if (direction == 1 && !relay_backlog_.empty()) {
+            size_t len = relay_backlog_.size() < BUFFER_SIZE ? relay_backlog_.size() : BUFFER_SIZE;
+            memcpy(flow.buffer.get(), relay_backlog_.data(), len);
+            relay_backlog_.erase(0, len);
+            if (!accept_input(flow, direction, len)) return false;
+            continue;
+        }
+
+        ssize_t n = ::read(flow.from, flow.buffer.get(), BUFFER_SIZE);
+        if (n > 0) {
+            if (direction == 1) relay_received_ += n;
+            if (!accept_input(flow, direction, n)) return false;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (flow.from == relay_fd_ && (n < 0 || replay_)) {
+            relay_lost_ = true; // Devam ettirilebilir oturumda relay'in kapanması da kopmadır
+            return false;
+        }
+        if (n < 0) return false;
+        flow.eof = true;
+        if (capture_) capture_->close_direction(direction);
+        return true;
+    }
+}
+
+VncProxy::Result VncProxy::run(const std::string& from_relay) {
+    relay_flags_ = ::fcntl(relay_fd_, F_GETFL, 0);
+    set_nonblocking(local_fd_);
+    set_nonblocking(relay_fd_);
+    auto start = std::chrono::steady_clock::now();
+    LOG(LOG_INFO) << "[VNC Vekil] Oturum " << (relay_received_ ? "devam ediyor" : "başladı") << " (yerel VNC soketi: "
+                  << local_fd_ << ", relay soketi: " << relay_fd_ << ").";
+
+    // Komut satırlarıyla birlikte okunmuş tünel verisi soketten önce gönderilir (bkz. pump)
+    relay_backlog_.append(from_relay);
+    relay_received_ += from_relay.size();
+    relay_lost_ = false;
+
+    Flow& uplink = flows_[0];
+    Flow& downlink = flows_[1];
+    Result result = PROXY_FAILED;
+    while (true) {
+        if (!pump(uplink, 0) || !pump(downlink, 1)) {
+            result = relay_lost_ && replay_ ? PROXY_RELAY_LOST : PROXY_FAILED;
+            break;
+        }
+        // Yerel VNC kapandı ve kalanı relay'e gönderildi
+        if (uplink.eof && uplink.len == 0) {
+            result = downlink.eof ? PROXY_RELAY_CLOSED : PROXY_LOCAL_CLOSED;
+            break;
+        }
+        // Relay kapandı: kalan veri yerel VNC'ye gönderilince yazma yönü kapatılır
+        if (downlink.eof && downlink.len == 0 && !local_shut_) {
+            ::shutdown(local_fd_, SHUT_WR);
+            local_shut_ = true;
+        }
+
+        struct pollfd fds[3];
+        fds[0].fd = local_fd_;
+        bool resending = replay_ && !replay_->empty();
+        fds[0].events = (uplink.len == 0 && !uplink.eof && !resending ? POLLIN : 0) | (downlink.off < downlink.len ? POLLOUT : 0);
+        fds[1].fd = relay_fd_;
+        fds[1].events = (downlink.len == 0 && !downlink.eof ? POLLIN : 0) | (uplink.off < uplink.len || resending ? POLLOUT : 0);
+        fds[2].fd = cancel_fd_;
+        fds[2].events = POLLIN;
+        // Beklenen olayı olmayan soket dışarıda bırakılır; aksi halde kapanmış soketin POLLHUP'ı
+        // poll'u sürekli uyandırır
+        for (struct pollfd& fd : fds) {
+            if (fd.events == 0) fd.fd = -1;
+        }
+        if (::poll(fds, 3, -1) < 0 && errno != EINTR) {
+            result = PROXY_FAILED;
+            break;
+        }
+        if (fds[2].revents & POLLIN) {
+            result = PROXY_CANCELLED;
+            break;
+        }
+    }
+    // Relay kapandıktan sonraki yazma hatası (EPIPE) bağlantının kapanmasıdır
+    if (result == PROXY_FAILED && downlink.eof) result = PROXY_RELAY_CLOSED;
+
+    if (relay_flags_ >= 0) ::fcntl(relay_fd_, F_SETFL, relay_flags_);
+    if (result == PROXY_RELAY_LOST) {
+        // Yerel taraf, tamponlar ve kayıt devam ettirme için korunur
+        LOG(LOG_WARN) << "[VNC Vekil] Relay bağlantısı koptu: relay'den " << relay_received_ << " byte alındı, relay'e "
+                      << uplink.total << " byte gönderildi (" << replay_->retained() << " byte yeniden gönderilebilir).";
+        return result;
+    }
+    capture_.reset();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(LOG_INFO) << "[VNC Vekil] Oturum bitti (" << result_name(result) << "): yerel -> relay "
+                  << uplink.total << " byte, relay -> yerel " << downlink.total << " byte, " << seconds << " sn.";
+    if (compressor_) {
+        const CompressionStats& stats = compressor_->stats();
+        LOG(LOG_INFO) << "[VNC Vekil] Sıkıştırma: yerel " << stats.bytes_in << " -> relay " << stats.bytes_out << " byte (oran "
+                      << std::fixed << std::setprecision(2) << (stats.bytes_out ? (double)stats.bytes_in / stats.bytes_out : 0.0)
+                      << ", saklanan " << stats.stored_bytes << " byte, CPU " << stats.cpu_ns / 1000000 << " ms, son seviye "
+                      << compressor_->level() << "); relay " << decompressor_->bytes_in() << " -> yerel "
+                      << decompressor_->bytes_out() << " byte.";
+    }
+    return result;
+}
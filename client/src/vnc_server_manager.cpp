@@ -0,0 +1,349 @@
+#include "../includes/vnc_server_manager.h"
+#include "../../include/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Sunucunun dinlemeye başladığını bildiren çıktı satırları
+static const char* const READY_MARKERS[] = {
+    "PORT=",         // x11vnc
+    "Listening for", // wayvnc (ayrıntılı günlükte)
+};
+
+static const std::chrono::milliseconds CONNECT_BACKOFF_MIN(10);
+static const std::chrono::milliseconds CONNECT_BACKOFF_MAX(250);
+static const std::chrono::milliseconds RESTART_DELAY_MIN(500);
+static const std::chrono::milliseconds RESTART_DELAY_MAX(30000);
+// Bu süre çalıştıktan sonra çıkan sunucu için yeniden başlatma beklemesi sıfırlanır
+static const std::chrono::seconds STABLE_RUN(30);
+static const std::chrono::seconds KILL_GRACE(2);
+
+// PATH'te çalıştırılabilir bir dosya var mı?
+static bool find_in_path(const std::string& name) {
+    const char* path = getenv("PATH");
+    if (!path) return false;
+    std::string dirs = path;
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) end = dirs.size();
+        std::string dir = dirs.substr(start, end - start);
+        if (dir.empty()) dir = ".";
+        if (::access((dir + "/" + name).c_str(), X_OK) == 0) return true;
+        start = end + 1;
+    }
+    return false;
+}
+
+VncServerManager::VncServerManager(const std::string& host, int port) : host_(host), port_(port) {}
+
+VncServerManager::~VncServerManager() {
+    stop();
+}
+
+void VncServerManager::set_managed(bool managed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    managed_ = managed;
+}
+
+void VncServerManager::set_command(const std::vector<std::string>& argv) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    command_ = argv;
+}
+
+std::vector<std::string> VncServerManager::default_command() const {
+    const char* session_type_env = getenv("XDG_SESSION_TYPE");
+    std::string session_type = session_type_env ? session_type_env : "unknown";
+    std::string port = std::to_string(port_);
+    if (session_type == "wayland") {
+        if (find_in_path("wayvnc")) return {"wayvnc", host_, port};
+        LOG(LOG_WARN) << "[VNC Sunucu] 'wayvnc' bulunamadı; lütfen kurun.";
+    } else if (session_type == "x11") {
+        if (find_in_path("x11vnc")) {
+            return {"x11vnc", "-localhost", "-nopw", "-forever", "-shared", "-rfbport", port};
+        }
+        LOG(LOG_WARN) << "[VNC Sunucu] 'x11vnc' bulunamadı; lütfen kurun.";
+    } else {
+        LOG(LOG_WARN) << "[VNC Sunucu] Bilinmeyen oturum türü (XDG_SESSION_TYPE): '" << session_type << "'.";
+    }
+    return {};
+}
+
+int VncServerManager::try_connect(int* error) const {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) <= 0) {
+        *error = EINVAL;
+        return -1;
+    }
+    int sock = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        *error = errno;
+        return -1;
+    }
+    if (::connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        *error = errno;
+        ::close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool VncServerManager::start() {
+    int error = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (child_pid_ > 0 || supervisor_.joinable()) return !stopping_;
+        if (stopping_) return false;
+    }
+    // Cevap veren bir sunucu varsa (dışarıda başlatılmış) yenisi başlatılmaz
+    int probe = try_connect(&error);
+    if (probe >= 0) {
+        ::close(probe);
+        LOG(LOG_INFO) << "[VNC Sunucu] " << host_ << ":" << port_ << " adresinde çalışan sunucu kullanılacak.";
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (supervisor_.joinable()) return !stopping_;
+    if (!managed_ || stopping_) return false;
+    if (command_.empty()) command_ = default_command();
+    if (command_.empty()) {
+        LOG(LOG_WARN) << "[VNC Sunucu] Başlatılacak sunucu yok; " << host_ << ":" << port_
+                      << " adresinde dışarıda başlatılmış bir sunucu beklenecek.";
+        managed_ = false;
+        return false;
+    }
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOG(LOG_ERROR) << "[VNC Sunucu] eventfd oluşturulamadı: " << strerror(errno);
+        return false;
+    }
+    supervisor_ = std::thread(&VncServerManager::supervise, this);
+    return true;
+}
+
+int VncServerManager::acquire(std::chrono::milliseconds timeout, std::string* error) {
+    auto begin = Clock::now();
+    auto deadline = begin + timeout;
+    std::chrono::milliseconds backoff = CONNECT_BACKOFF_MIN;
+    bool start_requested = false;
+    int last_error = 0;
+    while (true) {
+        uint64_t seen_ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            seen_ready = ready_count_;
+        }
+        int sock = try_connect(&last_error);
+        if (sock >= 0) {
+            auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - begin);
+            if (start_requested) {
+                LOG(LOG_INFO) << "[VNC Sunucu] Sunucu " << waited.count() << " ms içinde hazır oldu.";
+            }
+            return sock;
+        }
+        if (!start_requested) {
+            start_requested = true;
+            start();
+        }
+        auto now = Clock::now();
+        if (now >= deadline) break;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto wake_at = std::min(deadline, now + backoff);
+        cv_.wait_until(lock, wake_at, [&] { return stopping_ || ready_count_ != seen_ready; });
+        if (stopping_) break;
+        backoff = std::min(backoff * 2, CONNECT_BACKOFF_MAX);
+    }
+    if (error) {
+        *error = std::string(host_ + ":" + std::to_string(port_) + " adresine bağlanılamadı (") +
+                 strerror(last_error) + ")";
+    }
+    return -1;
+}
+
+void VncServerManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        if (wake_fd_ >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+    cv_.notify_all();
+    if (supervisor_.joinable() && supervisor_.get_id() != std::this_thread::get_id()) supervisor_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+// Komutu çıktısı bir boruya yönlendirilmiş olarak başlatır
+bool VncServerManager::spawn(pid_t* pid, int* output_fd) {
+    std::vector<std::string> command;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        command = command_;
+    }
+    // fork sonrasında çocukta bellek ayrılmaz; argv önceden hazırlanır
+    std::vector<char*> argv;
+    for (std::string& arg : command) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    int pipe_fds[2];
+    if (::pipe2(pipe_fds, O_CLOEXEC) < 0) {
+        LOG(LOG_ERROR) << "[VNC Sunucu] pipe oluşturulamadı: " << strerror(errno);
+        return false;
+    }
+    pid_t child = ::fork();
+    if (child < 0) {
+        LOG(LOG_ERROR) << "[VNC Sunucu] fork başarısız: " << strerror(errno);
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+        return false;
+    }
+    if (child == 0) {
+#ifdef __linux__
+        ::prctl(PR_SET_PDEATHSIG, SIGTERM); // Ajan beklenmedik şekilde ölürse sunucu da kapanır
+#endif
+        ::dup2(pipe_fds[1], STDOUT_FILENO);
+        ::dup2(pipe_fds[1], STDERR_FILENO);
+        int null_fd = ::open("/dev/null", O_RDONLY);
+        if (null_fd >= 0) ::dup2(null_fd, STDIN_FILENO);
+        ::execvp(argv[0], argv.data());
+        const char msg[] = "execvp başarısız\n";
+        ssize_t ignored = ::write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        (void)ignored;
+        _exit(127);
+    }
+    ::close(pipe_fds[1]);
+    *pid = child;
+    *output_fd = pipe_fds[0];
+
+    std::string joined;
+    for (const std::string& arg : command) joined += (joined.empty() ? "" : " ") + arg;
+    LOG(LOG_INFO) << "[VNC Sunucu] '" << joined << "' başlatıldı (PID: " << child << ").";
+    return true;
+}
+
+// Sunucunun çıktısını satır satır günlüğe yazar; hazır satırında bekleyenleri uyandırır.
+// Boru kapanınca veya stop çağrılınca döner.
+void VncServerManager::watch_output(int output_fd) {
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+        struct pollfd fds[2];
+        fds[0].fd = output_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = wake_fd_;
+        fds[1].events = POLLIN;
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents & POLLIN) return;
+        ssize_t n = ::read(output_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        pending.append(buffer, n);
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (line.empty()) continue;
+            bool ready = std::any_of(std::begin(READY_MARKERS), std::end(READY_MARKERS),
+                                     [&](const char* marker) { return line.find(marker) != std::string::npos; });
+            if (ready) {
+                LOG(LOG_INFO) << "[VNC Sunucu] Hazır: " << line;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ++ready_count_;
+                }
+                cv_.notify_all();
+            } else {
+                LOG(LOG_DEBUG) << "[VNC Sunucu] " << line;
+            }
+        }
+    }
+}
+
+// Çocuğun çıkmasını bekler; stop çağrıldıysa önce SIGTERM, KILL_GRACE sonra SIGKILL gönderir
+int VncServerManager::reap(pid_t pid) {
+    bool terminated = false;
+    Clock::time_point kill_at;
+    while (true) {
+        int status = 0;
+        pid_t done = ::waitpid(pid, &status, WNOHANG);
+        if (done == pid || (done < 0 && errno != EINTR)) return status;
+        bool stopping;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping = stopping_;
+        }
+        if (stopping && !terminated) {
+            ::kill(pid, SIGTERM);
+            terminated = true;
+            kill_at = Clock::now() + KILL_GRACE;
+        } else if (terminated && Clock::now() >= kill_at) {
+            ::kill(pid, SIGKILL);
+            kill_at = Clock::time_point::max();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+void VncServerManager::supervise() {
+    log_set_thread_name("vncsrv");
+    std::chrono::milliseconds delay = RESTART_DELAY_MIN;
+    while (true) {
+        pid_t pid = -1;
+        int output_fd = -1;
+        if (spawn(&pid, &output_fd)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                child_pid_ = pid;
+            }
+            auto started = Clock::now();
+            watch_output(output_fd);
+            int status = reap(pid);
+            ::close(output_fd);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                child_pid_ = -1;
+                if (stopping_) break;
+            }
+            if (WIFSIGNALED(status)) {
+                LOG(LOG_WARN) << "[VNC Sunucu] PID " << pid << " sinyalle sonlandı (" << WTERMSIG(status) << ").";
+            } else {
+                LOG(LOG_WARN) << "[VNC Sunucu] PID " << pid << " çıktı (kod " << WEXITSTATUS(status) << ").";
+            }
+            if (Clock::now() - started >= STABLE_RUN) delay = RESTART_DELAY_MIN;
+        }
+        LOG(LOG_INFO) << "[VNC Sunucu] " << delay.count() << " ms sonra yeniden başlatılacak.";
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (cv_.wait_for(lock, delay, [this] { return stopping_; })) break;
+        delay = std::min(delay * 2, RESTART_DELAY_MAX);
+    }
+    LOG(LOG_INFO) << "[VNC Sunucu] İzleme bitti.";
+}
@@ -0,0 +1,198 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+/**
+ * @brief Tünel trafiği kayıt dosyası (.rcap): yön, zaman ve veri; yalnızca sona eklenir.
+ *
+ * Dosya düzeni (tüm alanlar makinenin bayt sırasında; dosya mmap ile doğrudan okunur):
+ *   [dosya başlığı: CAPTURE_HEADER_SIZE byte]
+ *   [parça 0][parça 1]...[parça N-1]   her parça chunk_size byte, i. parça header_size + i * chunk_size'da
+ *   [dizin: N adet CaptureIndexEntry][son ek: CaptureTrailer]   kayıt kapatılınca yazılır
+ * Her parça bir CaptureChunkHeader ile başlar ve ardışık kayıtlar içerir; kayıtlar parça sınırını
+ * aşmaz (büyük veri birden çok kayda bölünür) ve 8 byte'a hizalanır. Parçanın kullanılmayan sonu
+ * boştur (seyrek dosya). Parçalar sabit konumda olduğundan zamana veya akış konumuna göre arama
+ * dizinde ikili aramayla yapılır; süreç kayıt kapanmadan sonlandıysa (dizin yok) okuyucu dizini
+ * parça başlıklarını tarayarak yeniden kurar. Başlık ve parçalar sayfa hizalıdır.
+ *
+ * Yön 0, kaydı açanın "a" dediği uçtan "b"ye giden veridir (etiket iki ucu adlandırır), yön 1 tersidir.
+ * Zamanlar kaydın başlangıcına göre nanosaniyedir (monoton saat).
+ */
+
+const char CAPTURE_MAGIC[8] = { 'R', 'C', 'A', 'P', 'v', '0', '0', '1' };
+const char CAPTURE_CHUNK_MAGIC[4] = { 'R', 'C', 'C', 'H' };
+const char CAPTURE_TRAILER_MAGIC[8] = { 'R', 'C', 'A', 'P', 'I', 'D', 'X', '1' };
+const uint32_t CAPTURE_HEADER_SIZE = 4096;
+const uint32_t CAPTURE_DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+// Kayıt bayrakları
+const uint8_t CAPTURE_FLAG_CLOSE = 1; // Uzunluk 0: yönün kaynağı bağlantıyı kapattı
+const uint8_t CAPTURE_FLAG_GAP = 2;   // Bu kayıttan önce veri atıldı (yazma kuyruğu doldu)
+
+struct CaptureFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t chunk_size;
+    uint32_t reserved;
+    uint64_t start_unix_ns; // Kaydın başladığı duvar saati (yalnızca bilgi)
+    char label[64];         // Örn. "relay a=123456 b=654321"
+};
+
+struct CaptureChunkHeader {
+    char magic[4];
+    uint32_t used;          // Başlık dahil dolu byte
+    uint32_t records;
+    uint32_t index;         // Parça sırası (bütünlük denetimi)
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t stream_offset[2]; // Parça başında yönlerin toplam veri byte'ı
+};
+
+struct CaptureRecordHeader {
+    uint32_t length;        // Veri byte'ı (hizalama dolgusu hariç)
+    uint8_t direction;
+    uint8_t flags;
+    uint16_t reserved;
+    uint64_t time_ns;
+};
+
+struct CaptureIndexEntry {
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t stream_offset[2];
+    uint32_t records;
+    uint32_t used;
+};
+
+struct CaptureTrailer {
+    char magic[8];
+    uint64_t chunk_count;
+    uint64_t index_offset;
+    uint64_t total_bytes[2];
+    uint64_t dropped_bytes; // Kuyruk dolduğu veya sınır aşıldığı için yazılmayan veri
+};
+
+/**
+ * @brief Kaydı yazar. Parçalar bellekte doldurulur; dolan parça süreç başına tek bir arka plan
+ * thread'ine verilir ve pwrite ile yazılır, çağıran thread diske beklemez. Yazılmayı bekleyen veri
+ * sınırı aşarsa (disk yetişemiyor) yeni veri atılır ve sonraki kayıt CAPTURE_FLAG_GAP taşır.
+ * Tek thread'den kullanılır; yıkıcı son parçayı, dizini ve son eki kuyruğa ekler.
+ */
+class CaptureWriter {
+public:
+    /**
+     * @param limit_bytes Kaydedilecek en fazla veri (0: sınırsız); aşılınca kayıt durur.
+     * @throws std::system_error dosya oluşturulamazsa.
+     */
+    CaptureWriter(const std::string& path, const std::string& label, uint64_t limit_bytes = 0,
+                  uint32_t chunk_size = CAPTURE_DEFAULT_CHUNK_SIZE);
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    void append(uint8_t direction, const char* data, size_t len);
+    void append(uint8_t direction, const struct iovec* iov, int count);
+
+    /**
+     * @brief Yönün kaynağının bağlantıyı kapattığını kaydeder.
+     */
+    void close_direction(uint8_t direction);
+
+    const std::string& path() const { return path_; }
+    uint64_t dropped_bytes() const { return dropped_; }
+
+    struct File; // Yazma thread'iyle paylaşılan dosya (son iş yazılınca kapanır)
+
+private:
+    void begin_record(uint8_t direction, uint8_t flags, size_t length);
+    void new_chunk();
+    void submit_chunk(bool force);
+    char* reserve(size_t len);
+
+    std::shared_ptr<File> file_;
+    std::string path_;
+    uint32_t chunk_size_;
+    uint64_t limit_;
+    uint64_t start_ns_;
+    std::unique_ptr<char[]> chunk_; // Doldurulan parça
+    CaptureChunkHeader* chunk_header_;
+    uint64_t chunk_count_;
+    uint64_t totals_[2];
+    uint64_t dropped_;
+    bool gap_;
+    std::string index_;             // Yazılan parçaların dizin girdileri
+};
+
+struct CaptureRecord {
+    uint8_t direction;
+    uint8_t flags;
+    uint64_t time_ns;
+    const char* data;
+    uint32_t length;
+};
+
+struct CaptureCursor {
+    size_t chunk = 0;
+    size_t offset = 0; // Parça içi konum (0: parçanın ilk kaydı)
+};
+
+/**
+ * @brief Kayıt dosyasını mmap ile açar ve kayıtları sırayla veya bir zamandan itibaren okur.
+ */
+class CaptureReader {
+public:
+    /**
+     * @throws std::runtime_error dosya açılamaz veya kayıt dosyası değilse.
+     */
+    explicit CaptureReader(const std::string& path);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    const CaptureFileHeader& header() const { return *header_; }
+    std::string label() const;
+
+    size_t chunk_count() const { return entries_.size(); }
+    const CaptureIndexEntry& chunk(size_t i) const { return entries_[i]; }
+
+    // Dizin son ekten mi okundu (false: kayıt kapanmamış, parçalar tarandı)
+    bool indexed() const { return indexed_; }
+    uint64_t duration_ns() const { return entries_.empty() ? 0 : entries_.back().last_ns; }
+    uint64_t total_bytes(int direction) const;
+    uint64_t dropped_bytes() const { return dropped_; }
+
+    /**
+     * @brief time_ns anında veya sonrasında başlayan ilk parçanın başına konumlanır
+     * (o andaki kaydı içeren parçanın başından başlanır).
+     */
+    CaptureCursor seek(uint64_t time_ns) const;
+
+    /**
+     * @brief Sıradaki kaydı okur; veri dosyanın eşlemesini gösterir (okuyucu yaşadıkça geçerli).
+     * @return Kayıt kalmadıysa false.
+     */
+    bool next(CaptureCursor* cursor, CaptureRecord* record) const;
+
+private:
+    const char* chunk_data(size_t i) const;
+
+    const char* map_;
+    size_t size_;
+    const CaptureFileHeader* header_;
+    std::vector<CaptureIndexEntry> entries_;
+    bool indexed_;
+    uint64_t totals_[2];
+    uint64_t dropped_;
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,120 @@
+#ifndef CLIENT_INFO_H
+#define CLIENT_INFO_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "control_protocol.h"
+#include "timer_wheel.h"
+
+class TunnelSession;
+class FanoutSession;
+
+// İstemci ID'si: kullanıcıya gösterilen 6 haneli sayı. NO_CLIENT "ID yok / peer yok" demektir.
+using ClientId = uint32_t;
+const ClientId NO_CLIENT = 0;
+const ClientId CLIENT_ID_MIN = 100000;
+const ClientId CLIENT_ID_MAX = 999999;
+
+// İstemci soketleri kenar tetiklemeli (edge-triggered) dinlenir. EPOLLOUT baştan
+// kaydedilir; böylece tampon boşaltma için epoll_ctl(MOD) çağrısına gerek kalmaz.
+const uint32_t CLIENT_EVENTS = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+
+// İstemcinin bağlantı durumu. Adı (client_status_name) günlüklerde ve yükseltme devrinde kullanılır.
+enum class ClientStatus : uint8_t {
+    Idle,          // Komut modunda, eşleşmemiş
+    Connecting,    // Bağlantı isteği karşı tarafın kabulünü bekliyor
+    Connected,     // Eşleşti; tünel kurulumu bekleniyor
+    VncReady,      // Tünel isteğini gönderdi, karşı tarafı bekliyor
+    VncTunnelling, // Tünel açık
+    Resuming,      // Bağlantısı koptu; tünel devam ettirme süresince park edildi
+    Broadcasting,  // Yayın oturumunun paylaşanı
+    Watching,      // Yayın oturumunun izleyicisi
+    Direct,        // Doğrudan (P2P) bağlantı kurdu
+};
+
+/**
+ * @brief Durumun adı ("Idle", "VncTunnelling"...).
+ */
+const char* client_status_name(ClientStatus status);
+
+/**
+ * @brief client_status_name'in tersi.
+ * @return Ad tanınmıyorsa false.
+ */
+bool parse_client_status(const std::string& name, ClientStatus* status);
+
+// İstemci bilgilerini ve durumunu tutan yapı.
+// Alanlar yalnızca istemcinin soketine sahip olan olay döngüsü thread'inden (owner_worker)
+// okunur ve değiştirilir; kayıt defteri (ClientRegistry) sadece ID -> ClientInfo eşlemesini korur.
+// Başka bir worker'daki istemciye dokunmadan önce owner_worker kontrol edilmelidir.
+struct ClientInfo {
+    std::atomic<int> owner_worker{0}; // Soketin sahibi olan worker; yalnızca sahibi değiştirir
+    int socket_fd;
+    ClientId id = NO_CLIENT;
+    std::string ip_address;
+    ClientStatus status = ClientStatus::Idle;
+    ClientId peer_id = NO_CLIENT;
+    std::vector<char> command_buffer; // Sadece komut modu için kullanılacak tampon
+    std::vector<char> command_frame;  // İşlenen ikili kontrol çerçevesi; komut bu tampona işaret eden yükle çağrılır
+    std::vector<char> output_buffer;  // Soket yazılabilir olana kadar bekleyen giden veri
+    bool read_paused = false;         // Peer yavaş olduğu için soketten okuma geçici olarak durduruldu
+    bool binary_protocol = false;     // İstemci ikili kontrol çerçeveleri konuşuyor (bkz. control_protocol.h)
+    bool mux = false;                 // Bağlantı çoğullanmış çerçevelerle sürüyor (bkz. mux_link.h)
+    std::vector<char> mux_input;      // Komut modunda okunmuş, henüz tamamlanmamış çerçeve
+    size_t mux_skip = 0;              // Tünel kapanırken yarım kalan veri çerçevesinin atılacak kalanı
+    std::vector<char> mux_pending;    // VncReady durumunda biriken veri kanalı çerçeveleri (tünel açılınca iletilir)
+    std::shared_ptr<TunnelSession> session; // VncTunnelling durumunda iki ucu bağlayan oturum
+    std::shared_ptr<FanoutSession> fanout;  // Broadcasting/Watching durumunda paylaşanın yayın oturumu
+    std::string resume_token;               // Tünel devam ettirme belirteci (devam ettirme kapalıysa boş)
+    std::string tunnel_options;             // start_vnc_tunnel ile istenen tünel seçenekleri (boşlukla ayrılmış)
+    std::string p2p_token;                  // Doğrudan bağlantı denemesinin buluşma belirteci (deneme yoksa boş)
+    std::string p2p_candidates;             // Ucun UDP adayları; gözlenen adres eklenince eşe gönderilir
+    bool p2p_mapped = false;                // Ucun UDP adresi buluşma portunda gözlendi
+    int remote_node = -1;                   // Başka relay'deki ajanın temsilcisiyse (proxy) o küme düğümü
+    TimerWheel::Timer timer;                // Durumun en yakın süre sınırı (el sıkışma, kalp atışı, boşta kalma, devam ettirme)
+    uint64_t state_since_ms = 0;            // Mevcut duruma geçiş anı (ms, tekdüze saat)
+    uint64_t last_activity_ms = 0;          // Komut modunda istemciden son veri alınan an
+    uint64_t last_ping_ms = 0;              // Son kalp atışı (PING) gönderimi
+};
+
+// Çıkış tamponunda gönderilemeyen veri kaldığında çağrılır. epoll motoru kenar tetiklemeli
+// EPOLLOUT ile zaten haberdar olduğundan kullanmaz; io_uring motoru POLLOUT beklemesi kurar.
+extern void (*output_pending_hook)(ClientInfo& client);
+
+/**
+ * @brief Çıkış tamponundaki bekleyen veriyi soket kabul ettiği kadar gönderir.
+ * @return Bağlantı kullanılamaz durumdaysa false.
+ */
+bool flush_output(ClientInfo& client);
+
+/**
+ * @brief Veriyi istemciye gönderir; soket o an kabul etmezse kalan kısmı çıkış tamponuna ekler.
+ * Sıralamayı korumak için tamponda bekleyen veri varsa yeni veri doğrudan gönderilmez.
+ */
+bool queue_send(ClientInfo& client, const char* data, size_t len);
+
+/**
+ * @brief Bir istemciye '\n' ile biten metin mesajı gönderir.
+ */
+bool send_message(ClientInfo& client, const std::string& message);
+
+/**
+ * @brief Kontrol mesajını istemcinin konuştuğu protokolle gönderir: ikili istemciye çerçeve,
+ * eski istemciye "<TİP> <yük>" metin satırı. Çoğullanmış bağlantıda mesaj kanal 0 çerçevesine
+ * sarılır; tünel sürerken bekleyen tünel verisinden önce, ilk çerçeve sınırında gönderilir.
+ */
+bool send_control(ClientInfo& client, ControlType type, const std::string& payload = "");
+
+/**
+ * @brief Yükü bir istemci ID'si olan kontrol mesajı (ID, INCOMING, ACCEPTED...).
+ */
+bool send_control(ClientInfo& client, ControlType type, ClientId id);
+
+#endif // CLIENT_INFO_H
@@ -0,0 +1,142 @@
+#ifndef CLIENT_REGISTRY_H
+#define CLIENT_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client_info.h"
+
+/**
+ * @brief Metin biçimindeki 6 haneli ID'yi çözer (bellek ayırmaz).
+ * @return Metin geçerli bir ID değilse false.
+ */
+bool parse_client_id(std::string_view text, ClientId* id);
+
+/**
+ * @brief ID -> ClientInfo eşlemesini tutan, doğrudan indekslenen kayıt defteri.
+ *
+ * ID'ler CLIENT_ID_MIN..CLIENT_ID_MAX aralığındaki tamsayılardır ve boş ID'lerin karıştırılmış
+ * listesinden O(1)'de, çekirdeğin rastgele sayı üreteciyle (getrandom) düzgün dağılımlı seçilir;
+ * bu yüzden aralık dolmaya yaklaşsa da ayırma yavaşlamaz ve ID'ler tahmin edilemez. Serbest
+ * bırakılan ID listeye geri döner.
+ *
+ * İstemciler yoğun (dense) bir slot tablosunda tutulur; ID -> slot eşlemesi düz bir dizidir.
+ * Arama ve ekleme hash hesaplamaz, bellek ayırmaz. Dizi boyutu ID aralığı kadardır ama sayfalar
+ * yalnızca dokunuldukça fiziksel bellek tüketir.
+ *
+ * Eşzamanlılık: Slotlar ID'ye göre LOCK_STRIPES kilitten birine bağlıdır; bir çiftin
+ * connect/accept işlemi yalnızca ilgili ID'lerin kilitlerini alır. ID ve slot ayırma ayrı bir
+ * kilitle korunur. Tünel trafiği kayıt defterine hiç uğramaz (bkz. TunnelSession).
+ *
+ * Küme (cluster) modunda ID aralığı düğüm sayısı kadar ardışık bölüme ayrılır ve her relay
+ * yalnızca kendi bölümünden ID ayırır; bir ID'nin hangi relay'e ait olduğu böylece her düğümde
+ * aynı şekilde, eşitleme gerekmeden hesaplanır (partition_of). Başka relay'deki uçların yerel
+ * temsilcileri (proxy) o uçların ID'siyle register_remote ile kaydedilir.
+ */
+class ClientRegistry {
+public:
+    static const size_t LOCK_STRIPES = 16;
+    static const size_t ID_SPACE = CLIENT_ID_MAX - CLIENT_ID_MIN + 1;
+
+    ClientRegistry();
+    ~ClientRegistry();
+
+    ClientRegistry(const ClientRegistry&) = delete;
+    ClientRegistry& operator=(const ClientRegistry&) = delete;
+
+    /**
+     * @brief İstemciye boş bir ID atar ve kaydeder.
+     * @return Atanan ID (client->id alanına da yazılır); ID aralığı doluysa NO_CLIENT.
+     */
+    ClientId register_client(const std::shared_ptr<ClientInfo>& client);
+
+    /**
+     * @brief ID ayırmayı count bölümden index'inciyle sınırlar. İlk kayıttan önce çağrılmalıdır.
+     */
+    void set_partition(uint32_t index, uint32_t count);
+
+    /**
+     * @brief ID'nin ait olduğu bölüm (küme düğümü); bölümleme yoksa 0.
+     */
+    uint32_t partition_of(ClientId id) const;
+
+    /**
+     * @brief Başka bir bölüme ait ID'yi istemciye atar ve kaydeder (ID listesinden ayrılmaz).
+     * @return ID geçersizse, bu bölüme aitse veya zaten kayıtlıysa false.
+     */
+    bool register_remote(ClientId id, const std::shared_ptr<ClientInfo>& client);
+
+    /**
+     * @brief Kesintisiz yükseltmede devralınan istemcileri mevcut ID'leriyle kaydeder ve boş ID
+     * listesini bir kez yeniden kurar. İlk register_client'tan önce çağrılmalıdır. Kaydedilemeyenler
+     * (geçersiz, başka bölüme ait veya yinelenen ID) clients listesinden çıkarılır.
+     */
+    void adopt(std::vector<std::shared_ptr<ClientInfo>>& clients);
+
+    /**
+     * @brief ID'ye karşılık gelen istemciyi döner; yoksa nullptr.
+     */
+    std::shared_ptr<ClientInfo> find(ClientId id) const;
+
+    /**
+     * @brief İstemciyi kayıt defterinden siler ve ID'sini serbest bırakır.
+     * @return Silinen istemci (kayıtlı değilse nullptr). Çağıran tutarsa istemci, kaydın tek
+     *         sahibi olduğu durumda da (park edilmiş uç) işi bitene kadar yaşar.
+     */
+    std::shared_ptr<ClientInfo> remove(ClientId id);
+
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Tüm istemciler üzerinde gezinir (tüm kilitler sırayla alınır; yalnızca hata ayıklama için).
+     */
+    void for_each(const std::function<void(const ClientInfo&)>& fn) const;
+
+private:
+    // Slotlar sabit boyutlu bloklarda tutulur; bloklar hiç taşınmadığından okuyucular ayırma
+    // kilidini almadan slotlara erişebilir
+    static const size_t SLOTS_PER_BLOCK = 1024;
+    static const size_t BLOCK_COUNT = (ID_SPACE + SLOTS_PER_BLOCK - 1) / SLOTS_PER_BLOCK;
+
+    struct Block {
+        std::shared_ptr<ClientInfo> slots[SLOTS_PER_BLOCK];
+    };
+
+    std::mutex& stripe_for(ClientId id) const { return stripes_[id % LOCK_STRIPES]; }
+    std::shared_ptr<ClientInfo>& slot(uint32_t index) const {
+        return blocks_[index / SLOTS_PER_BLOCK]->slots[index % SLOTS_PER_BLOCK];
+    }
+
+    bool allocate(ClientId* id, uint32_t* slot_index);
+    uint32_t allocate_slot();
+    void release(ClientId id, uint32_t slot_index);
+    uint32_t free_id_at(size_t position) const;
+    uint32_t next_random();
+
+    mutable std::mutex stripes_[LOCK_STRIPES];
+
+    // Yalnızca alloc_mutex_ ile
+    std::mutex alloc_mutex_;
+    uint32_t* free_ids_;          // [0, free_count_) boş ID indeksleri; 0 değeri "konum kadar" demektir
+    size_t free_count_;
+    uint32_t partition_index_;
+    uint32_t partition_count_;
+    uint32_t partition_base_;     // Bölümün ilk ID indeksi; free_ids_ konumları buna göredir
+    std::vector<uint32_t> free_slots_;
+    uint32_t random_pool_[64];
+    size_t random_left_;
+
+    std::atomic<uint32_t> slot_limit_; // Şimdiye kadar kullanılan en yüksek slot + 1
+    std::unique_ptr<Block> blocks_[BLOCK_COUNT];
+    uint32_t* slot_by_id_;        // ID indeksi -> slot + 1 (0: kayıtsız); ID'nin kilidiyle korunur
+    std::atomic<size_t> count_;
+};
+
+#endif // CLIENT_REGISTRY_H
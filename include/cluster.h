@@ -0,0 +1,153 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "client_info.h"
+#include "event_loop.h"
+
+/**
+ * @brief Küme düğümünün relay'ler arası bağlantı adresi ("ip:port", IPv4).
+ */
+struct ClusterPeer {
+    std::string host;
+    int port = 0;
+};
+
+/**
+ * @brief "ip:port,ip:port,..." listesini çözer (en az bir, en fazla 64 düğüm).
+ * @return Biçim geçersizse false.
+ */
+bool parse_cluster_peers(const std::string& text, std::vector<ClusterPeer>* peers);
+
+/**
+ * @brief Relay kümesinde düğümler arası kalıcı, çoğullanmış (multiplexed) bağlantılar.
+ *
+ * Her düğüm çifti arasında tek bir TCP bağlantısı vardır; indeksi büyük olan düğüm küçüğe bağlanır
+ * ve bağlantı koparsa saniyede bir yeniden dener. Bağlantı üzerindeki her kanal, bir relay'deki
+ * ajanın diğer relay'deki temsilcisini (proxy istemci) taşır. Çerçeve (ağ bayt sırasıyla):
+ *   [tip: 1 byte][kanal: 4 byte][uzunluk: 4 byte][yük]
+ *   HELLO  : yük "<gönderen düğüm> <düğüm sayısı>" (bağlantının ilk çerçevesi; iki yönde)
+ *   OPEN   : yük "<isteyen ID> <hedef ID>"; alan düğüm isteyen ID'li bir proxy oluşturur
+ *   DATA   : kanalın verisi (en fazla kalan kredi kadar)
+ *   CLOSE  : kanal kapandı; yük (varsa) nedeni
+ *   WINDOW : yük 4 byte; alıcının tükettiği byte kadar gönderene verilen kredi
+ *
+ * Proxy istemci, bir socketpair'in relay tarafındaki ucudur ve relay için sıradan bir ikili
+ * protokol istemcisidir (connect/accept/start_vnc_tunnel, TunnelSession, splice, su işaretleri
+ * değişmeden çalışır). Diğer uç bu sınıftadır: tünel açılana kadar relay'in proxy'ye yazdığı
+ * kontrol çerçeveleri karşı relay'deki proxy'nin göndereceği komutlara çevrilir
+ * (INCOMING -> connect, ACCEPTED -> accept, START_VNC_TUNNEL/TUNNEL_ACTIVE -> start_vnc_tunnel);
+ * ERROR veya PEER_DISCONNECTED kanalı kapatır. TUNNEL_ACTIVE'den sonra her iki yönde ham veri akar.
+ *
+ * Kanal başına kredi (CHANNEL_WINDOW) yavaş bir tünelin bağlantıdaki diğer kanalları bekletmesini
+ * (head-of-line blocking) önler: alıcı tarafın tamponu hiçbir zaman pencereyi aşmaz. Bağlantının
+ * çıkış tamponu LINK_HIGH_WATER'ı aşarsa tüm kanallardan okuma durur.
+ *
+ * Tüm nesne tek bir olay döngüsünün thread'inde çalışır; open_channel ve connect_remote herhangi
+ * bir thread'den çağrılabilir.
+ */
+class Cluster {
+public:
+    // fd'yi sahiplenen ve remote_id ile kaydedilen proxy istemciyi çağıranın thread'inde oluşturur:
+    // OPEN geldiğinde döngünün thread'inde, connect_remote'ta çağıranın thread'inde. false dönerse
+    // fd kapatılır ve kanal reddedilir (açılmaz).
+    using ProxyFactory = std::function<bool(int fd, ClientId remote_id, int node)>;
+
+    static const size_t CHANNEL_WINDOW = 256 * 1024;
+    static const size_t LINK_HIGH_WATER = 1024 * 1024;
+    static const size_t LINK_LOW_WATER = 256 * 1024;
+
+    /**
+     * @brief Kendi adresinin portunda bağlantıları dinler ve küçük indeksli düğümlere bağlanır.
+     * @throws std::system_error Dinleyen soket veya zamanlayıcı açılamazsa.
+     */
+    Cluster(EventLoop& loop, int node, std::vector<ClusterPeer> peers, ProxyFactory create_proxy);
+    ~Cluster();
+
+    Cluster(const Cluster&) = delete;
+    Cluster& operator=(const Cluster&) = delete;
+
+    int node() const { return node_; }
+    size_t size() const { return peers_.size(); }
+
+    /**
+     * @brief Yerel proxy için node'a kanal açar. fd socketpair'in bu sınıfa ait ucudur; bağlantı
+     * yoksa kapatılır (proxy EOF görür). local_id isteyen yerel ajan, remote_id hedef (proxy'nin ID'si).
+     */
+    void open_channel(int node, int fd, ClientId local_id, ClientId remote_id);
+
+    /**
+     * @brief Başka düğümdeki remote_id için yerel proxy oluşturur ve node'a kanal açar: socketpair'in
+     * bir ucu proxy'ye (ProxyFactory ile, çağıranın thread'inde), diğeri kanala verilir.
+     * @return socketpair açılamadıysa veya proxy oluşturulamadıysa false.
+     */
+    bool connect_remote(int node, ClientId local_id, ClientId remote_id);
+
+private:
+    struct Link;
+
+    struct Channel {
+        uint32_t id = 0;
+        Link* link = nullptr;
+        int fd = -1;
+        ClientId proxy_id = NO_CLIENT;  // Bu relay'deki proxy
+        ClientId remote_id = NO_CLIENT; // Karşı relay'deki proxy
+        bool raw = false;               // TUNNEL_ACTIVE'den sonra ham veri
+        bool start_sent = false;
+        bool closing = false;           // CLOSE alındı; bekleyen veri yazılınca kapanır
+        int64_t send_credit = CHANNEL_WINDOW;
+        size_t unacked = 0;             // fd'ye yazılmış ama WINDOW ile bildirilmemiş byte
+        std::vector<char> control;      // Kontrol modunda çözülmeyi bekleyen çerçeveler
+        std::vector<char> pending;      // fd'ye yazılmayı bekleyen veri
+        std::string close_reason;
+    };
+
+    struct Link {
+        int fd = -1;
+        int node = -1;                  // HELLO alınana kadar -1 (kabul edilen bağlantılar)
+        bool connected = false;         // Bağlanan taraf için connect tamamlandı
+        bool throttled = false;         // Çıkış tamponu dolu; kanallardan okunmuyor
+        std::vector<char> in;
+        std::vector<char> out;
+        size_t out_offset = 0;
+        uint32_t next_channel = 1;
+        std::unordered_map<uint32_t, std::unique_ptr<Channel>> channels;
+    };
+
+    void accept_links();
+    void dial_missing();
+    void add_link(int fd, int node, bool connected);
+    void on_link_event(Link* link, uint32_t events);
+    bool read_link(Link* link);
+    bool flush_link(Link* link);
+    void close_link(Link* link);
+    bool handle_frame(Link* link, uint8_t type, uint32_t id, const char* payload, size_t length);
+    void send_frame(Link* link, uint8_t type, uint32_t channel, const char* payload, size_t length);
+    void send_window(Channel* channel);
+
+    Channel* attach_channel(Link* link, uint32_t id, int fd, ClientId proxy_id, ClientId remote_id);
+    void on_channel_event(Link* link, uint32_t id, uint32_t events);
+    void pump_channel(Channel* channel);
+    bool translate_control(Channel* channel);
+    void send_command(Channel* channel, ControlType type, const std::string& argument);
+    bool write_channel(Channel* channel);
+    void close_channel(Channel* channel, const std::string& reason, bool notify);
+
+    EventLoop& loop_;
+    int node_;
+    std::vector<ClusterPeer> peers_;
+    ProxyFactory create_proxy_;
+    int listen_fd_;
+    int timer_fd_;
+    std::vector<Link*> links_by_node_; // Düğüm -> HELLO'su tamamlanmış bağlantı
+    std::unordered_map<int, std::unique_ptr<Link>> links_; // fd -> bağlantı
+};
+
+#endif // CLUSTER_H
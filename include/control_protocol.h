@@ -0,0 +1,141 @@
+#ifndef CONTROL_PROTOCOL_H
+#define CONTROL_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+/**
+ * @brief Relay <-> ajan kontrol kanalı.
+ *
+ * İkili çerçeve (sürüm 1), ağ bayt sırasıyla:
+ *   [0xC1: işaret + sürüm][tip: 1 byte][uzunluk: 2 byte][yük: uzunluk byte]
+ * İşaret baytı ASCII olmadığından, komut modundaki bir mesajın ilk baytına bakılarak istemcinin
+ * ikili mi eski metin protokolünü mü konuştuğu anlaşılır. Eski istemciler '\n' ile biten metin
+ * komutlarını (ör. "connect 123456") göndermeye devam edebilir; ikisi aynı ControlType'a çevrilir.
+ *
+ * Relay bağlantı kabul edildiğinde her zaman metin "ID <id>" satırını gönderir. İkili istemci bu
+ * satırı atlar ve CTRL_HELLO gönderir; bundan sonra relay o istemciye yalnızca ikili çerçeve yollar.
+ *
+ * Devam ettirme açıksa TUNNEL_ACTIVE yükü uca özel bir belirteçtir. Bağlantısı kopan uç, süre
+ * dolmadan yeni bir bağlantıdan "resume <belirteç> <alınan>" gönderir; <alınan>, TUNNEL_ACTIVE'den
+ * sonra relay'den aldığı toplam tünel byte'ıdır. Relay "RESUMED <n>" ile yanıt verir; <n>, relay'in
+ * o uçtan start_vnc_tunnel'dan sonra aldığı toplam byte'tır ve uç göndermeye oradan devam eder.
+ * Relay de <alınan> konumundan sonrasını yeniden gönderir.
+ *
+ * Doğrudan bağlantı (buluşma portu açıksa): Connected durumundaki iki uç da "p2p <yerel adaylar>"
+ * gönderir (adaylar boşlukla ayrılmış "ip:port"; hole punching'de kullanılacak UDP soketinin
+ * yerel adresleri). Relay "P2P_BIND <belirteç> <udp_port>" ile yanıtlar; uç aynı UDP soketinden
+ * buluşma portuna belirteci gönderir (bkz. rendezvous.h). İki ucun da UDP adresi gözlendiğinde
+ * her uç "P2P_CANDIDATES <anahtar> <eşin adayları>" alır; ilk aday relay'in gözlediği (NAT sonrası)
+ * adrestir, anahtar iki uçta aynıdır ve hole punching paketlerini doğrulamak için kullanılır.
+ * Uçlar sonucu "p2p_result direct|relay" ile bildirir. relay bildiren ucun eşi "P2P_FALLBACK"
+ * alır; iki uç da start_vnc_tunnel ile relay tüneline geçer. Doğrudan yol sonradan koparsa da
+ * aynı yolla relay'e dönülür.
+ *
+ * Kalp atışı açıksa ('--heartbeat=') relay komut modundaki (tünel veya yayın dışındaki) istemcilere
+ * aralıklarla "PING" gönderir; istemci "pong" ile yanıt verir. Boşta kalma süresi açıksa
+ * ('--idle-timeout=') bu süre boyunca hiçbir şey göndermeyen istemcinin bağlantısı kapatılır.
+ *
+ * Eşleşmedeki (Connecting, Connected, VncReady, VncTunnelling, Direct) bir uç "disconnect" ile
+ * eşleşmeden çıkar: tünel varsa kapatılır, eşi PEER_DISCONNECTED, kendisi "DISCONNECTED_OK <eş>" alır
+ * ve ikisi de Idle olur. Tünel sürerken komut gönderilebilmesi için bağlantının çoğullanmış olması
+ * gerekir: Idle durumdaki istemci "mux" gönderir, relay "MUX_OK" ile yanıt verir ve bundan sonra
+ * bağlantı kanallara bölünmüş çerçevelerle sürer (bkz. mux_link.h). Kontrol mesajları kanal 0'da
+ * (istemcinin konuştuğu protokolle) taşınır; tünel verisi veri kanallarında uçtan uca iletilir.
+ *
+ * Tünel seçenekleri: uç "start_vnc_tunnel <seçenek> ..." ile tünelde kullanmak istediği özellikleri
+ * (ör. "deflate") bildirebilir. Relay seçenekleri yorumlamaz; iki uç da hazır olduğunda ikisinin de
+ * istediği seçenekler varsa her uca TUNNEL_ACTIVE'den hemen önce "TUNNEL_OPTIONS <seçenekler>" gönderir.
+ * Seçenek bildirmeyen eski ajanlar bu mesajı hiç almaz ve tünel verisi değişmeden akar.
+ */
+
+const uint8_t CONTROL_MAGIC_V1 = 0xC1;
+const size_t CONTROL_HEADER_SIZE = 4;
+const size_t CONTROL_MAX_PAYLOAD = 1024;
+
+enum ControlType : uint8_t {
+    // İstemci -> relay
+    CTRL_HELLO = 0x01,            // Yalnızca ikili; relay CTRL_ID ile yanıt verir
+    CTRL_CONNECT = 0x02,          // Yük: hedef ID
+    CTRL_ACCEPT = 0x03,           // Yük: isteyen ID
+    CTRL_START_VNC_TUNNEL = 0x04, // Yük: tünel seçenekleri (isteğe bağlı); sonrasında gelen baytlar ham VNC verisidir
+    CTRL_BROADCAST = 0x05,        // Yük: yavaş izleyici politikası ve/veya "rfb" (isteğe bağlı); sonrası yayın verisidir
+    CTRL_WATCH = 0x06,            // Yük: yayın yapan ID; sonrası paylaşana giden giriş verisidir
+    CTRL_RESUME = 0x07,           // Yük: "<belirteç> <alınan byte>"; sonrası tünel verisidir
+    CTRL_P2P = 0x08,              // Yük: yerel UDP adayları ("ip:port ...")
+    CTRL_P2P_RESULT = 0x09,       // Yük: "direct" veya "relay"
+    CTRL_PONG = 0x0A,             // PING yanıtı; yalnızca boşta kalma sayacını sıfırlar
+    CTRL_MUX = 0x0B,              // Bağlantıyı çoğullanmış çerçevelere geçirir (yalnızca Idle)
+    CTRL_DISCONNECT = 0x0C,       // Eşleşmeden (ve varsa tünelden) çıkar
+
+    // Relay -> istemci
+    CTRL_ID = 0x41,
+    CTRL_INCOMING,
+    CTRL_CONNECTING,
+    CTRL_ACCEPTED,
+    CTRL_CONNECTION_ESTABLISHED,
+    CTRL_TUNNEL_ACTIVE,
+    CTRL_PEER_DISCONNECTED,
+    CTRL_ERROR,
+    CTRL_RESUMED,                 // Yük: relay'in o uçtan aldığı toplam tünel byte'ı
+    CTRL_P2P_BIND,                // Yük: "<belirteç> <udp_port>"
+    CTRL_P2P_CANDIDATES,          // Yük: "<anahtar> <aday> ..."
+    CTRL_P2P_FALLBACK,            // Yük: relay'e dönen eşin ID'si
+    CTRL_PING,                    // Kalp atışı; istemci pong ile yanıt verir
+    CTRL_MUX_OK,                  // Bu mesajdan sonra relay'den gelen her şey çerçevelidir
+    CTRL_DISCONNECTED_OK,         // Yük: ayrılınan eşin ID'si
+    CTRL_TUNNEL_OPTIONS           // Yük: iki ucun da istediği tünel seçenekleri; TUNNEL_ACTIVE'den hemen önce gider
+};
+
+/**
+ * @brief Çözülmüş bir ikili çerçeve. payload, çözülen tamponun içini gösterir (kopyalanmaz).
+ */
+struct ControlFrame {
+    ControlType type;
+    const char* payload;
+    size_t length;
+};
+
+/**
+ * @brief Tamponun başındaki ikili çerçeveyi yerinde çözer; bellek ayırmaz.
+ * @return Tüketilen byte sayısı, çerçeve henüz tamamlanmadıysa 0, işaret/sürüm veya uzunluk
+ * geçersizse -1.
+ */
+ssize_t parse_control_frame(const char* data, size_t len, ControlFrame* frame);
+
+/**
+ * @brief Çerçeveyi out'a yazar.
+ * @return Yazılan byte sayısı; yük CONTROL_MAX_PAYLOAD'dan büyükse veya out yetmiyorsa 0.
+ */
+size_t encode_control_frame(ControlType type, const char* payload, size_t length, char* out, size_t out_size);
+
+/**
+ * @brief Tipin eski metin protokolündeki karşılığı (ör. "TUNNEL_ACTIVE", "connect").
+ */
+const char* control_type_text(ControlType type);
+
+/**
+ * @brief Eski metin protokolünde çözülmüş komut.
+ */
+struct TextCommand {
+    std::string verb;     // Küçük harfe çevrilmiş
+    std::string argument; // Fiilden sonraki kısım (yoksa boş)
+};
+
+/**
+ * @brief Tampondaki ilk tam satırı ('\n' ile biten) çıkarır ve baştaki/sondaki boşlukları kırpar.
+ * @return Tamponda tam satır yoksa false.
+ */
+bool extract_text_line(std::vector<char>& buffer, std::string* line);
+
+/**
+ * @brief Metin komut satırını fiil ve argümana ayırır.
+ * @return Fiil bilinen bir komutsa true ve type doldurulur.
+ */
+bool parse_text_command(const std::string& line, TextCommand* command, ControlType* type);
+
+#endif // CONTROL_PROTOCOL_H
@@ -0,0 +1,179 @@
+#ifndef EGRESS_SCHEDULER_H
+#define EGRESS_SCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "event_loop.h"
+
+/**
+ * @brief Relay çıkış (egress) hız sınırları. Hızlar byte/saniyedir; 0 sınırsız demektir.
+ */
+struct SchedulerConfig {
+    uint64_t egress_rate = 0;       // Sürecin tüm tünellerinin toplam çıkışı
+    uint64_t session_rate = 0;      // Tünel oturumu başına (iki yön birlikte)
+    uint64_t account_rate = 0;      // Hesap başına (bkz. EgressLimits::account)
+    size_t quantum = 64 * 1024;     // Çekişme varken akışın sırası başına en fazla gönderimi
+    size_t interactive_bytes = 1024; // Bekleyen verisi bu kadar veya az olan gönderim öncelikli sınıftadır
+
+    bool enabled() const { return egress_rate || session_rate || account_rate; }
+};
+
+/**
+ * @brief GCRA (generic cell rate algorithm) ile token bucket eşdeğeri hız sınırlayıcı.
+ * Durum tek bir atomik "teorik varış zamanı"dır (tat); birden çok thread kilitsiz olarak
+ * (CAS ile) aynı sınırlayıcıyı kullanabilir. burst byte'a kadar veri bekletmeden gönderilebilir.
+ * consume() sınırı aşabilir (borç); borç sonraki gönderimleri geciktirir.
+ */
+class RateLimiter {
+public:
+    RateLimiter(uint64_t rate, uint64_t burst);
+
+    /**
+     * @brief now anında bekletmeden gönderilebilecek byte sayısı.
+     */
+    size_t available(uint64_t now_ns) const;
+
+    /**
+     * @brief bytes byte'ı hesaptan düşer.
+     */
+    void consume(size_t bytes, uint64_t now_ns);
+
+    /**
+     * @brief bytes byte'ın gönderilebilmesi için beklenmesi gereken süre (ns; 0: hemen).
+     */
+    uint64_t delay_ns(size_t bytes, uint64_t now_ns) const;
+
+private:
+    uint64_t cost_ns(size_t bytes) const;
+
+    uint64_t rate_;
+    uint64_t burst_ns_;
+    std::atomic<uint64_t> tat_{0};
+};
+
+/**
+ * @brief Süreç genelinde paylaşılan sınırlayıcılar: toplam çıkış ve hesap başına sınırlar.
+ * Hesap sınırlayıcıları yalnızca tünel açılırken (kilitle) alınır; veri aktarımı kilit almaz.
+ */
+class EgressLimits {
+public:
+    explicit EgressLimits(const SchedulerConfig& config);
+
+    const SchedulerConfig& config() const { return config_; }
+
+    /**
+     * @brief Toplam çıkış sınırlayıcısı; sınırsızsa nullptr.
+     */
+    RateLimiter* global() { return global_.get(); }
+
+    /**
+     * @brief Hesabın sınırlayıcısı (yoksa oluşturulur); sınırsızsa nullptr. Hesabın tüm açık
+     * tünelleri aynı sınırlayıcıyı paylaşır.
+     */
+    std::shared_ptr<RateLimiter> account(const std::string& key);
+
+    /**
+     * @brief Oturum başına yeni sınırlayıcı; sınırsızsa nullptr.
+     */
+    std::shared_ptr<RateLimiter> new_session();
+
+private:
+    uint64_t burst_for(uint64_t rate) const;
+
+    SchedulerConfig config_;
+    std::unique_ptr<RateLimiter> global_;
+    std::mutex accounts_mutex_;
+    std::unordered_map<std::string, std::weak_ptr<RateLimiter>> accounts_;
+};
+
+/**
+ * @brief Zamanlayıcıya gönderim için başvuran bir tünel yönü. Sahibi olan oturum yaşadıkça
+ * geçerlidir; oturum kapanırken EgressScheduler::remove ile çıkarılmalıdır.
+ */
+struct EgressFlow {
+    std::shared_ptr<RateLimiter> session; // Oturumun iki yönü paylaşır
+    std::shared_ptr<RateLimiter> account; // Hedef ucun hesabı
+    std::function<void()> wake;           // Sırası gelince bekleyen veriyi göndermeyi yeniden dener
+    uint64_t ready_ns = 0;                // Sıradayken: sınırlayıcıların izin vereceği en erken zaman
+    size_t deficit = 0;                   // Sırası gelince eklenen quantum'dan kalan gönderim hakkı
+    bool queued = false;
+    bool in_turn = false;
+};
+
+/**
+ * @brief Worker başına çıkış zamanlayıcısı: öncelik sınıfı, hız sınırlayıcılar ve deficit round robin.
+ *
+ * Bekleyen verisi interactive_bytes veya daha az olan gönderimler (giriş olayları, küçük
+ * güncellemeler) sıraya girmeden hemen gönderilir ve sınırlayıcılara borç olarak yazılır.
+ * Toplu gönderimler oturum, hesap ve toplam sınırlayıcılarının izin verdiği kadar yapılır;
+ * izin yoksa veya sırada bekleyen başka akış varsa akış halka sıraya girer. Sıradaki akışlar
+ * deficit round robin ile servis edilir: sırası gelen akışın hakkına quantum eklenir ve hakkı
+ * kadar gönderir, sınırlayıcı yüzünden kullanamadığı hak sonraki sırasına kalır. Toplam sınır
+ * tükenince tur durur; böylece çok veri üreten bir oturum diğerlerini aç bırakamaz. Bekleyen veri tünel tamponunda kalır ve
+ * tünelin su işaretleri kaynaktan okumayı durdurur.
+ *
+ * loop verildiyse zamanlayıcı bir timerfd ile kendini uyandırır; verilmezse (benzetim) çağıran
+ * next_wake_ns zamanında service çağırır. Yalnızca sahibi olan thread'den kullanılır.
+ */
+class EgressScheduler {
+public:
+    EgressScheduler(EgressLimits& limits, EventLoop* loop, uint64_t (*clock)() = nullptr);
+    ~EgressScheduler();
+
+    EgressScheduler(const EgressScheduler&) = delete;
+    EgressScheduler& operator=(const EgressScheduler&) = delete;
+
+    bool enabled() const { return config_.enabled(); }
+    EgressLimits& limits() { return limits_; }
+
+    /**
+     * @brief flow'un pending byte'ı için şimdi gönderebileceği miktar. 0 dönerse akış sıraya
+     * alınmıştır ve sırası gelince wake çağrılır. Gönderimden sonra sent() çağrılmalıdır.
+     */
+    size_t grant(EgressFlow& flow, size_t pending);
+
+    /**
+     * @brief grant ile izin verilen veriden gerçekten gönderilen kısmı sınırlayıcılara yazar.
+     */
+    void sent(EgressFlow& flow, size_t bytes);
+
+    /**
+     * @brief Akışı sıradan çıkarır (oturum kapanışı).
+     */
+    void remove(EgressFlow& flow);
+
+    /**
+     * @brief Sıradaki akışlara bir tur servis verir.
+     */
+    void service();
+
+    /**
+     * @brief Bir sonraki turun zamanı: sıradaki en erken hazır akış, toplam sınır varsa ayrıca
+     * o sınırda bir quantum birikmesi. Sıra boşsa 0.
+     */
+    uint64_t next_wake_ns() const;
+
+    size_t queued_flows() const { return ring_.size(); }
+
+private:
+    void enqueue(EgressFlow& flow, size_t pending, uint64_t now);
+    void arm_timer();
+
+    EgressLimits& limits_;
+    const SchedulerConfig& config_;
+    EventLoop* loop_;
+    uint64_t (*clock_)();
+    int timer_fd_;
+    uint64_t armed_ns_;
+    std::deque<EgressFlow*> ring_;
+};
+
+#endif // EGRESS_SCHEDULER_H
@@ -0,0 +1,85 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief epoll tabanlı, tek thread'de çalışan olay döngüsü (reactor).
+ * Her dosya tanımlayıcısı (fd) için bir geri çağırma (callback) kaydedilir;
+ * döngü, hazır olan tanımlayıcıların callback'lerini epoll olay maskesiyle çağırır.
+ * add/modify/remove yalnızca döngünün thread'inden çağrılmalıdır; başka thread'ler döngüye
+ * iş aktarmak için post() kullanır.
+ *
+ * Her kayıt fd başına artan bir kuşak (generation) numarası alır ve epoll olayına fd ile birlikte
+ * yazılır. Bir callback aynı turda bir fd'yi kapatıp numarası yeniden kullanılan yeni bir fd'yi
+ * eklerse, eski fd için turda bekleyen olaylar yeni kaydın callback'ine verilmez.
+ */
+class EventLoop {
+public:
+    using Callback = std::function<void(uint32_t events)>;
+    using Task = std::function<void()>;
+
+    /**
+     * @brief epoll örneğini ve post() için uyandırma eventfd'sini oluşturur.
+     * @throws std::system_error epoll_create1 veya eventfd başarısız olursa.
+     */
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief Bir fd'yi verilen olay maskesiyle (örn. EPOLLIN | EPOLLET) döngüye ekler.
+     * @return epoll_ctl başarılıysa true.
+     */
+    bool add(int fd, uint32_t events, Callback cb);
+
+    /**
+     * @brief Kayıtlı bir fd'nin olay maskesini değiştirir.
+     */
+    bool modify(int fd, uint32_t events);
+
+    /**
+     * @brief fd'yi döngüden çıkarır. fd'yi kapatmaz; kapatmak çağıranın sorumluluğundadır.
+     * Bir callback'in içinden (kendi fd'si için bile) güvenle çağrılabilir.
+     */
+    void remove(int fd);
+
+    /**
+     * @brief stop() çağrılana kadar olayları bekler ve dağıtır.
+     */
+    void run();
+
+    /**
+     * @brief run() döngüsünün mevcut tur bittikten sonra sonlanmasını sağlar.
+     * Başka bir thread'den çağrılabilir.
+     */
+    void stop();
+
+    /**
+     * @brief İşi döngünün thread'inde çalıştırılmak üzere kuyruğa ekler ve döngüyü uyandırır.
+     * Herhangi bir thread'den çağrılabilir; işler eklendikleri sırayla çalışır.
+     */
+    void post(Task task);
+
+private:
+    static uint64_t make_event_data(int fd, uint32_t generation);
+    void run_posted_tasks();
+
+    int epoll_fd_;
+    int wake_fd_;
+    bool running_;
+    std::mutex tasks_mutex_;
+    std::vector<Task> tasks_;
+    // fd ile doğrudan indekslenir. unique_ptr sayesinde vektör büyürken çalışan callback yer değiştirmez.
+    std::vector<std::unique_ptr<Callback>> handlers_;
+    std::vector<uint32_t> generations_; // fd'nin son kaydının kuşağı (add her çağrıldığında artar)
+    std::vector<std::unique_ptr<Callback>> graveyard_; // Dağıtım sırasında silinenler tur sonunda yok edilir
+};
+
+#endif // EVENT_LOOP_H
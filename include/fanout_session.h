@@ -0,0 +1,191 @@
+#ifndef FANOUT_SESSION_H
+#define FANOUT_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "client_info.h"
+#include "event_loop.h"
+#include "metrics.h"
+#include "rfb_cache.h"
+#include "ring_buffer.h"
+#include "tunnel_session.h"
+
+/**
+ * @brief Gecikme sınırını aşan (yavaş) izleyiciye uygulanacak politika.
+ */
+enum SlowViewerPolicy {
+    SLOW_VIEWER_DROP,       // İzleyici yayından çıkarılır (PEER_DISCONNECTED), bağlantısı açık kalır
+    SLOW_VIEWER_COALESCE,   // Bekleyen veri atılır, izleyici canlı akışa atlar (boşluğa dayanıklı akışlar için)
+    SLOW_VIEWER_DISCONNECT  // İzleyicinin bağlantısı kapatılır
+};
+
+/**
+ * @brief "drop", "coalesce" veya "disconnect" metnini çözer.
+ */
+bool parse_slow_viewer_policy(const std::string& text, SlowViewerPolicy* policy);
+const char* slow_viewer_policy_name(SlowViewerPolicy policy);
+
+/**
+ * @brief Bir paylaşanın (sharer) akışını birden çok izleyiciye (viewer) dağıtan yayın oturumu.
+ *
+ * Paylaşandan okunan veri bir kez, referans sayılı sabit boyutlu parçalara (BroadcastChunk)
+ * okunur; her izleyicinin gönderim kuyruğu bu parçaların aralıklarını tutar, veri izleyici başına
+ * kopyalanmaz. Bir parça, onu gösteren son kuyruk aralığı gönderildiğinde havuza döner.
+ * İzleyicilerden gelen veri (giriş olayları) paylaşana giden tek bir halka tamponda, okuma
+ * parçası sınırlarında birleştirilir.
+ *
+ * Akış denetimi: Paylaşandan okuma, en az gecikmiş izleyicinin kuyruğu high_watermark'a
+ * ulaşınca durdurulur ve low_watermark'a inince sürdürülür; yani yayın en hızlı izleyicinin
+ * hızında akar. Kuyruğu lag_limit'i aşan izleyiciye SlowViewerPolicy uygulanır; böylece tek bir
+ * yavaş bağlantı diğerlerini durduramaz ve sabitlediği bellek lag_limit ile sınırlı kalır.
+ * İzleyici yokken paylaşandan okunmaz; ilk izleyici akışı baştan alır.
+ *
+ * Varsayılan olarak oturum aktarım katmanındadır, akışı yorumlamaz: sonradan katılan izleyici
+ * akışı katıldığı noktadan görür. RFB önbelleği açıksa (rfb_cache_limit > 0) paylaşanın akışı
+ * RfbCache ile çözülür: ilk izleyici el sıkışmasını paylaşanla yapar, sonradan katılan veya geri
+ * dönen izleyicinin el sıkışmasını relay yanıtlar ve ilk karesi paylaşana gitmeden önbellekten
+ * gönderilir; izleyici canlı akışa bir mesaj sınırından katılır. İzleyici girişi bu kipte tam
+ * RFB mesajları halinde birleştirilir.
+ *
+ * Paylaşan, tüm izleyicileri ve oturum aynı olay döngüsü thread'inde kullanılır (izleyiciler
+ * watch sırasında paylaşanın worker'ına aktarılır).
+ */
+class FanoutSession {
+public:
+    /**
+     * @brief DROP veya DISCONNECT politikasında yavaş izleyici için çağrılır. Çağıran, izleyiciyi
+     * remove_viewer ile (veya bağlantıyı kapatarak) oturumdan çıkarmalıdır.
+     */
+    using SlowViewerHandler = std::function<void(ClientInfo& viewer)>;
+
+    /**
+     * @param limits high/low_watermark paylaşanın okuma denetimi ve izleyici girişi tamponu içindir.
+     * @param lag_limit Bir izleyicinin kuyruğunda bekleyebilecek en fazla byte (> high_watermark).
+     * @param rfb_cache_limit 0 değilse RFB önbelleği açılır; çerçeve tamponu için en fazla bellek.
+     */
+    FanoutSession(EventLoop& loop, ClientInfo& sharer, const TunnelLimits& limits, size_t lag_limit,
+                  SlowViewerPolicy policy, SlowViewerHandler on_slow_viewer, size_t rfb_cache_limit = 0);
+    ~FanoutSession();
+
+    FanoutSession(const FanoutSession&) = delete;
+    FanoutSession& operator=(const FanoutSession&) = delete;
+
+    ClientInfo& sharer() const { return *sharer_; }
+    SlowViewerPolicy policy() const { return policy_; }
+    size_t viewer_count() const { return viewers_.size(); }
+    bool rfb_cache() const { return rfb_ != nullptr; }
+
+    /**
+     * @brief İzleyiciyi ekler. İlk izleyici, izleyici yokken biriken veriyi (broadcast komutundan
+     * sonra gelenler) alır ve paylaşandan okuma başlar.
+     */
+    void add_viewer(ClientInfo& viewer);
+
+    /**
+     * @brief İzleyiciyi çıkarır; kuyruğundaki parça referansları bırakılır.
+     */
+    void remove_viewer(ClientInfo& viewer);
+
+    /**
+     * @brief Komut tamponunda kalan veriyi akışa ekler: paylaşandan geldiyse yayına, izleyiciden
+     * geldiyse paylaşana giden girişe.
+     */
+    void push(ClientInfo& src, const char* data, size_t len);
+
+    /**
+     * @brief src soketinden okunabilen veriyi aktarır (paylaşansa tüm izleyicilere, izleyiciyse paylaşana).
+     * @return src bağlantısı kapandıysa veya okuma hatası olduysa false.
+     */
+    bool forward_from(ClientInfo& src);
+
+    /**
+     * @brief dst'nin çıkış tamponu boşaldığında çağrılır: dst'ye giden bekleyen veriyi gönderir ve
+     * durdurulmuş okumaları gerekirse sürdürür.
+     */
+    void on_writable(ClientInfo& dst);
+
+    /**
+     * @brief Paylaşan ayrılırken çağrılır: tüm izleyici kuyruklarını bırakır ve izleyicileri döner.
+     * Bundan sonra oturum veri aktarmaz.
+     */
+    std::vector<ClientInfo*> close();
+
+private:
+    static const size_t CHUNK_SIZE = 64 * 1024;
+    static const size_t MAX_IOV = 64;
+    static const size_t MAX_POOLED_CHUNKS = 64;
+
+    // Referans sayısı atomik değildir: tüm kullanıcılar aynı thread'dedir
+    struct BroadcastChunk {
+        uint32_t refs;
+        uint32_t size;
+        char data[CHUNK_SIZE];
+    };
+
+    struct Span {
+        BroadcastChunk* chunk;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct Viewer {
+        ClientInfo* client;
+        std::deque<Span> queue;
+        size_t queued_bytes = 0;
+        bool input_paused = false; // Paylaşana giden giriş tamponu dolu olduğu için okuma durduruldu
+        std::shared_ptr<TunnelMetrics> metrics; // dirs[0] paylaşan->izleyici, dirs[1] izleyici->paylaşan
+        ForwardLatencyTracker latency;
+        // RFB önbelleği açıkken
+        std::unique_ptr<RfbClientStream> rfb; // İzleyicinin paylaşana giden akışı
+        bool attached = true;          // Canlı yayını alıyor (geç izleyici ilk karesinden sonra)
+        bool snapshot_pending = false; // Bir sonraki mesaj sınırında önbellek karesini bekliyor
+        size_t snapshot_offset = 0;    // Kuyrukta karenin önündeki byte
+        size_t snapshot_bytes = 0;     // Karenin gönderilmemiş kısmı (gecikme sınırına sayılmaz)
+    };
+
+    BroadcastChunk* acquire_chunk();
+    void release(BroadcastChunk* chunk);
+    void release_queue(Viewer& viewer);
+    Viewer* find_viewer(const ClientInfo& client);
+
+    void append(BroadcastChunk* chunk, uint32_t begin, uint32_t end);
+    void publish(BroadcastChunk* chunk, uint32_t begin, uint32_t end);
+    void enqueue_bytes(const std::vector<Viewer*>& targets, const std::string& data);
+    void enqueue(Viewer& viewer, BroadcastChunk* chunk, uint32_t begin, uint32_t end);
+    bool read_from_sharer();
+    bool flush_viewer(Viewer& viewer);
+    void apply_lag_limit();
+    void update_sharer_reading();
+
+    bool read_from_viewer(Viewer& viewer);
+    bool take_rfb_input(Viewer& viewer, const char* data, size_t len);
+    void start_rfb_viewers();
+    bool snapshots_pending() const;
+    void send_snapshots();
+    void flush_input();
+    void resume_reading(ClientInfo& client);
+
+    EventLoop& loop_;
+    ClientInfo* sharer_;
+    TunnelLimits limits_;
+    size_t lag_limit_;
+    SlowViewerPolicy policy_;
+    SlowViewerHandler on_slow_viewer_;
+
+    std::vector<std::unique_ptr<Viewer>> viewers_;
+    std::deque<Span> backlog_;        // İzleyici yokken biriken yayın verisi
+    BroadcastChunk* tail_;            // Yeni verinin okunduğu parça (oturumun kendi referansı var)
+    std::vector<BroadcastChunk*> pool_;
+    RingBuffer input_;                // İzleyicilerden paylaşana giden veri
+    std::unique_ptr<RfbCache> rfb_;   // RFB önbelleği kapalıysa nullptr
+    bool rfb_primary_joined_;         // El sıkışmasını paylaşanla yapan ilk izleyici katıldı
+    bool closed_;
+};
+
+#endif // FANOUT_SESSION_H
@@ -0,0 +1,184 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "client_info.h"
+#include "event_loop.h"
+#include "tunnel_session.h"
+
+/**
+ * @brief Kesintisiz yükseltmede eski relay'den yenisine durum aktarımı (Unix soketi üzerinden).
+ *
+ * Akış kayıtlardan oluşur. Kayıt başlığı (ağ bayt sırasıyla):
+ *   [yük uzunluğu: 4 byte][fd sayısı: 2 byte]
+ * Başlık tek bir sendmsg ile gönderilir ve kaydın dosya tanımlayıcıları SCM_RIGHTS ile ona
+ * eklenir; ardından yük gelir. Alıcı başlığı tam olarak kendi uzunluğu kadar okuduğundan fd'ler
+ * her zaman ait oldukları kayıtla birlikte alınır. Yükün alanları sırayla yazılır ve aynı sırayla
+ * okunur (tamsayılar ağ bayt sırasında, metinler uzunluk önekli). Gönderim ve alım verilen son
+ * ana kadar sürer: soket engelleyici olsa da her çağrı MSG_DONTWAIT ve poll ile bekler, yanıt
+ * vermeyen karşı taraf devri süresiz durduramaz.
+ */
+
+// Kayıt başına en fazla fd (çekirdeğin SCM_MAX_FD sınırının altında)
+const size_t HANDOFF_MAX_FDS = 64;
+
+// Devir işlemlerinin son anı (tekdüze saat)
+using HandoffDeadline = std::chrono::steady_clock::time_point;
+
+/**
+ * @brief Tek byte'lık el sıkışma mesajlarını (hazır, onay) son ana kadar gönderir/alır.
+ * @return Süre dolduysa (errno ETIMEDOUT) veya bağlantı kapandıysa false.
+ */
+bool handoff_send_byte(int sock, char value, HandoffDeadline deadline);
+bool handoff_receive_byte(int sock, char* value, HandoffDeadline deadline);
+
+class HandoffWriter {
+public:
+    void put_u8(uint8_t value);
+    void put_u32(uint32_t value);
+    void put_u64(uint64_t value);
+    void put_string(const std::string& value);
+    void put_bytes(const char* data, size_t len);
+
+    /**
+     * @brief Yüke fd'nin sırasını işaretler ve fd'yi kayda ekler (-1 ise yalnızca "fd yok" yazılır).
+     * fd kapatılmaz; alıcıdaki kopya yeni bir tanımlayıcıdır.
+     */
+    void put_fd(int fd);
+
+    /**
+     * @brief Biriken kaydı gönderir ve yazıcıyı sonraki kayıt için boşaltır.
+     * @return Gönderim başarısızsa veya deadline'a kadar bitmediyse false (errno).
+     */
+    bool send(int sock, HandoffDeadline deadline);
+
+    size_t fd_count() const { return fds_.size(); }
+    bool empty() const { return payload_.empty(); }
+
+private:
+    std::string payload_;
+    std::vector<int> fds_;
+};
+
+class HandoffReader {
+public:
+    HandoffReader() = default;
+    ~HandoffReader();
+
+    HandoffReader(const HandoffReader&) = delete;
+    HandoffReader& operator=(const HandoffReader&) = delete;
+
+    /**
+     * @brief Sonraki kaydı okur. Önceki kayıttan alınmamış fd'ler kapatılır.
+     * @return Bağlantı kapandıysa, kayıt bozuksa veya deadline'a kadar gelmediyse false.
+     */
+    bool receive(int sock, HandoffDeadline deadline);
+
+    // Okuma alanın sonunu aşarsa 0/boş döner ve ok() false olur
+    uint8_t get_u8();
+    uint32_t get_u32();
+    uint64_t get_u64();
+    std::string get_string();
+
+    /**
+     * @brief Yükteki sıradaki fd alanını okur ve fd'yi sahiplenir (put_fd(-1) yazıldıysa -1).
+     */
+    int take_fd();
+
+    bool ok() const { return ok_; }
+
+    /**
+     * @brief Kaydın tüm alanları okundu mu? Bir kayıt birden çok öğe taşıyabilir.
+     */
+    bool at_end() const { return offset_ >= payload_.size(); }
+
+private:
+    bool take(void* out, size_t len);
+    void close_fds();
+
+    std::string payload_;
+    size_t offset_ = 0;
+    std::vector<int> fds_; // Alınan ve henüz sahiplenilmemiş fd'ler (sahiplenilenler -1)
+    size_t next_fd_ = 0;
+    bool ok_ = false;
+};
+
+// --- Relay durumunun devri ---
+
+// Devir akışındaki öğe türleri; bir kayıt birden çok öğe taşır
+enum HandoffItem : uint8_t {
+    HANDOFF_WORKERS = 'W', // Akışın ilk öğesi: eski sürecin worker sayısı
+    HANDOFF_LISTENER = 'L',
+    HANDOFF_CLIENT = 'C',
+    HANDOFF_SESSION = 'S',
+    HANDOFF_END = 'E'
+};
+
+/**
+ * @brief İstemci öğesinin alanlarını yazar/okur (öğe türü byte'ı hariç). Durum ad olarak taşınır;
+ * sürümler arasında sıra değişebilir. owner_worker olduğu gibi taşınır, alıcı doğrular.
+ * @return Bilinmeyen durumda nullptr (alınan soket kapatılır).
+ */
+void handoff_put_client(HandoffWriter& out, const ClientInfo& client);
+std::shared_ptr<ClientInfo> handoff_get_client(HandoffReader& in);
+
+// Yeni süreçte alınan oturum öğesi; kurulamazsa devralınan boru uçları yıkıcıda kapatılır
+struct HandedSession {
+    ClientId a = NO_CLIENT;
+    ClientId b = NO_CLIENT;
+    TunnelSession::DirectionState dirs[2]; // a'dan ve b'den çıkan yönler
+
+    HandedSession() = default;
+    ~HandedSession();
+    HandedSession(const HandedSession&) = delete;
+    HandedSession& operator=(const HandedSession&) = delete;
+};
+
+/**
+ * @brief Oturum öğesinin alanlarını (iki uç ve iki yönün durumu) yazar/okur.
+ */
+void handoff_put_session(HandoffWriter& out, const TunnelSession& session, const ClientInfo& a, const ClientInfo& b);
+void handoff_get_session(HandoffReader& in, HandedSession* handed);
+
+/**
+ * @brief Durum gönderilirken diğer worker'ları olay işlemenin arasında bekletir.
+ *
+ * freeze her döngüye bir bekleme işi post eder ve hepsi durana kadar bekler; release'e kadar
+ * hiçbir istemciye dokunulmaz. Bir döngü deadline'a kadar durmazsa (örn. uzun süren bir işte
+ * takılıysa) duranlar bırakılır ve false döner; geciken döngü işine sonradan geldiğinde turun
+ * bittiğini görüp beklemeden devam eder. Nesne döngülerden uzun yaşamalıdır.
+ */
+class LoopFreeze {
+public:
+    bool freeze(const std::vector<EventLoop*>& loops, HandoffDeadline deadline);
+    void release();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t frozen_ = 0;
+    uint64_t round_ = 0; // release her çağrıldığında artar
+};
+
+// --- Süreç yardımcıları ---
+
+// Sürecin çıkışında okunabilir olan tanımlayıcı (pidfd, Linux 5.3+); desteklenmiyorsa -1
+int open_pidfd(pid_t pid);
+
+/**
+ * @brief Süreç yöneticisine (systemd, Type=notify) durum bildirir: "READY=1", "MAINPID=N" gibi
+ * satırlar. NOTIFY_SOCKET tanımlı değilse hiçbir şey yapmaz.
+ */
+void notify_supervisor(const std::string& state);
+
+#endif // HANDOFF_H
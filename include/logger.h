@@ -0,0 +1,126 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Relay ve ajanlar için asenkron günlük (log) altyapısı.
+ *
+ * Her thread kendi tek üreticili/tek tüketicili (SPSC) kilitsiz halkasına yazar; kayıt doğrudan
+ * halkadaki yuvaya biçimlendirilir, yani günlük yazan thread kilit almaz, bellek ayırmaz ve
+ * sistem çağrısı yapmaz. Arka plandaki tek bir yazıcı thread halkaları boşaltıp toplu olarak
+ * stdout/stderr'e yazar. Halka doluysa kayıt düşürülür ve sayısı raporlanır; günlük hiçbir zaman
+ * aktarımı veya komut işlemeyi bekletmez.
+ *
+ * Kullanım:
+ *   LOG(LOG_INFO) << "Yeni bağlantı: " << id;
+ *   LOG_RATE_LIMITED(LOG_WARN, 5) << "accept hatası";   // Saniyede en fazla 5 kayıt
+ *   LOG(LOG_TRACE) << "Paket: " << n << " byte";         // Paket başına; varsayılan kapalı
+ *
+ * Seviye devre dışıysa akış ifadesi hiç değerlendirilmez.
+ */
+
+enum LogLevel : uint8_t {
+    LOG_TRACE = 0, // Paket başına ayrıntılar
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR
+};
+
+extern std::atomic<uint8_t> log_min_level;
+
+inline bool log_enabled(LogLevel level) {
+    return level >= log_min_level.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief "trace", "debug", "info", "warn" veya "error" adını seviyeye çevirir.
+ * @return Ad geçersizse false.
+ */
+bool parse_log_level(const std::string& name, LogLevel* level);
+const char* log_level_name(LogLevel level);
+void set_log_level(LogLevel level);
+
+/**
+ * @brief Arka plan yazıcı thread'ini başlatır. Başlatılmazsa kayıtlar halkalarda birikir
+ * ve halka dolunca düşürülür.
+ */
+void log_start();
+
+/**
+ * @brief Bekleyen tüm kayıtları yazar ve yazıcı thread'ini durdurur.
+ */
+void log_stop();
+
+/**
+ * @brief signo sinyali her geldiğinde seviye LOG_TRACE ile önceki seviye arasında değiştirilir;
+ * paket başına günlükler çalışma anında açılıp kapatılabilir.
+ */
+void log_install_level_toggle(int signo);
+
+/**
+ * @brief Çağıran thread'in kayıtlarda görünecek adı (ör. "w2"). İlk kayıttan önce çağrılmalıdır.
+ */
+void log_set_thread_name(const std::string& name);
+
+/**
+ * @brief Tek bir günlük kaydı. Oluşturulurken çağıran thread'in halkasında yuva ayrılır,
+ * stream() ile yuvaya doğrudan yazılır, yıkıcıda kayıt yayınlanır.
+ */
+class LogMessage {
+public:
+    /**
+     * @param suppressed Hız sınırı nedeniyle bu noktada atlanan kayıt sayısı (kayda eklenir).
+     */
+    explicit LogMessage(LogLevel level, int64_t suppressed = 0);
+    ~LogMessage();
+
+    LogMessage(const LogMessage&) = delete;
+    LogMessage& operator=(const LogMessage&) = delete;
+
+    std::ostream& stream() { return *stream_; }
+
+private:
+    LogLevel level_;
+    int64_t suppressed_;
+    std::ostream* stream_;
+};
+
+/**
+ * @brief Bir günlük noktasının saniyelik hız sınırı. Yarış durumunda sınır birkaç kayıt
+ * aşılabilir; kilit alınmaz.
+ */
+class LogRateLimit {
+public:
+    /**
+     * @return Kayıt izinliyse önceki izinli kayıttan beri atlanan kayıt sayısı, değilse -1.
+     */
+    int64_t admit(unsigned per_second);
+
+private:
+    std::atomic<int64_t> window_{-1};
+    std::atomic<unsigned> count_{0};
+    std::atomic<int64_t> suppressed_{0};
+};
+
+// LOG(...) ifadesinin türünü void yapar; böylece makro if/else içinde güvenle kullanılabilir
+struct LogVoidify {
+    void operator&(std::ostream&) {}
+};
+
+#define LOG(level) \
+    !log_enabled(level) ? (void)0 : LogVoidify() & LogMessage(level).stream()
+
+#define LOG_RATE_LIMITED(level, per_second)                                                         \
+    for (int64_t log_suppressed_ = log_enabled(level)                                               \
+             ? []() -> LogRateLimit& { static LogRateLimit site; return site; }().admit(per_second) \
+             : -1;                                                                                  \
+         log_suppressed_ >= 0; log_suppressed_ = -1)                                                \
+        LogMessage(level, log_suppressed_).stream()
+
+#endif // LOGGER_H
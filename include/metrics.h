@@ -0,0 +1,231 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "client_info.h"
+#include "control_protocol.h"
+
+/**
+ * @brief Relay ölçümleri (metrics) ve Prometheus metin biçiminde dışa aktarımı.
+ *
+ * Sayaçlar kilitsizdir: oturum sayaçlarını yalnızca oturumun sahibi olan olay döngüsü thread'i
+ * yazar (atomik yükle + sakla, kilitli komut yok), dışa aktaran thread yalnızca okur.
+ * Kayıt defteri mutex'i yalnızca tünel açılıp kapanırken ve dışa aktarım sırasında alınır;
+ * veri aktarımı hiçbir kilide uğramaz.
+ */
+
+/**
+ * @brief Tek yazıcılı sayaca ekleme. Okuyucular eski bir değer görebilir ama yırtık değer görmez.
+ */
+inline void metrics_add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Monoton saat (CLOCK_MONOTONIC, vDSO üzerinden sistem çağrısı yapmaz), nanosaniye.
+ */
+uint64_t metrics_now_ns();
+
+/**
+ * @brief HDR tarzı gecikme histogramı: her ikinin kuvveti aralığı SUB_BUCKETS eşit alt kovaya
+ * bölünür, yani tüm aralık boyunca göreli hata %12.5 ile sınırlıdır. Değerler nanosaniyedir;
+ * MAX_MAGNITUDE üstündeki değerler son kovaya yazılır. Kaydetme kilitsizdir ve birden çok
+ * thread'den yapılabilir.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 3;
+    static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static const int MAX_MAGNITUDE = 36; // 2^36 ns ~ 68 s
+    // İlk SUB_BUCKETS kova 0..SUB_BUCKETS-1 değerlerini birebir tutar; ardından her büyüklük için SUB_BUCKETS kova
+    static const size_t BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void record(uint64_t value_ns);
+
+    static size_t bucket_index(uint64_t value_ns);
+    /**
+     * @brief Kovadaki en büyük değer (dahil), nanosaniye.
+     */
+    static uint64_t bucket_upper_bound(size_t index);
+
+    /**
+     * @brief Kova sayılarını, toplamı ve kayıt sayısını snapshot'a ekler (birleştirme için).
+     */
+    struct Snapshot {
+        Snapshot() : counts(BUCKET_COUNT, 0), sum_ns(0), count(0) {}
+        std::vector<uint64_t> counts;
+        uint64_t sum_ns;
+        uint64_t count;
+
+        /**
+         * @brief q (0..1) yüzdelik dilimine düşen kovanın üst sınırı, nanosaniye; kayıt yoksa 0.
+         */
+        uint64_t quantile(double q) const;
+    };
+    void add_to(Snapshot* snapshot) const;
+
+    /**
+     * @brief other'ın kayıtlarını bu histograma ekler.
+     */
+    void merge(const LatencyHistogram& other);
+
+private:
+    std::atomic<uint64_t> counts_[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> count_{0};
+};
+
+/**
+ * @brief Kapsamdan çıkarken geçen süreyi histograma yazar.
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram) : histogram_(histogram), start_(metrics_now_ns()) {}
+    ~ScopedLatency() { histogram_.record(metrics_now_ns() - start_); }
+
+private:
+    LatencyHistogram& histogram_;
+    uint64_t start_;
+};
+
+/**
+ * @brief Alındığı halde karşı uca henüz gönderilmemiş verinin alınma zamanlarını tutar ve
+ * veri gönderildikçe alım->gönderim gecikmesini histograma yazar. Bir tünel yönüne aittir ve
+ * yalnızca o yönün sahibi olan thread'den kullanılır. Zaman damgası kuyruğu doluysa yeni veri
+ * son damgaya eklenir; o veri için gecikme olduğundan büyük (kötümser) ölçülür.
+ */
+class ForwardLatencyTracker {
+public:
+    void on_received(size_t bytes, uint64_t now_ns);
+    void on_sent(size_t bytes, uint64_t now_ns, LatencyHistogram& histogram);
+
+    /**
+     * @brief Bekleyen veri atıldığında (tünel kapanışı) damgaları siler.
+     */
+    void clear();
+
+    /**
+     * @brief Gönderilmiş son bytes byte yeniden gönderilecekse çağrılır; bu veri için gecikme
+     * yeniden kaydedilmez.
+     */
+    void rewind(size_t bytes) { sent_ -= bytes; }
+
+private:
+    struct Stamp {
+        uint64_t end;         // Bu damganın kapsadığı son byte'ın (dahil değil) toplam alım konumu
+        uint64_t received_ns;
+    };
+    static const size_t CAPACITY = 32;
+
+    Stamp stamps_[CAPACITY];
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint64_t received_ = 0; // Toplam alınan byte
+    uint64_t sent_ = 0;     // Toplam gönderilen byte
+};
+
+/**
+ * @brief Bir tünel yönünün sayaçları. Yalnızca oturumun sahibi olan thread yazar.
+ */
+struct TunnelDirectionMetrics {
+    std::atomic<uint64_t> bytes{0};         // Karşı uca gönderilen byte
+    std::atomic<uint64_t> chunks{0};        // Kaynaktan yapılan başarılı okuma (recv/splice) sayısı
+    std::atomic<uint64_t> partial_sends{0}; // Gönderim, bekleyen veri bitmeden EAGAIN ile kesildi
+    std::atomic<uint64_t> queued_bytes{0};  // Karşı uca gönderilmeyi bekleyen byte (anlık)
+};
+
+/**
+ * @brief Bir tünel oturumunun ölçümleri. dirs[0] a->b, dirs[1] b->a yönüdür.
+ */
+struct TunnelMetrics {
+    TunnelMetrics(ClientId a_id, ClientId b_id) : a_id(a_id), b_id(b_id) {}
+
+    const ClientId a_id;
+    const ClientId b_id;
+    TunnelDirectionMetrics dirs[2];
+    LatencyHistogram forward_latency; // Her iki yön
+
+private:
+    friend class RelayMetrics;
+    static const size_t NOT_LISTED = (size_t)-1;
+    size_t list_index_ = NOT_LISTED; // RelayMetrics::tunnels_ içindeki yeri (RelayMetrics::mutex_ ile korunur)
+};
+
+/**
+ * @brief Sürecin tüm ölçümlerini tutar ve Prometheus metin biçiminde dışa aktarır.
+ */
+class RelayMetrics {
+public:
+    /**
+     * @brief Yeni tünel oturumu için sayaçları oluşturur ve dışa aktarıma ekler.
+     */
+    std::shared_ptr<TunnelMetrics> open_tunnel(ClientId a_id, ClientId b_id);
+
+    /**
+     * @brief Oturumu dışa aktarımdan çıkarır; sayaçları ve histogramı süreç toplamlarına eklenir.
+     * O(1): tünel listedeki yerini bilir. Zaten kapatılmış oturum için etkisizdir.
+     */
+    void close_tunnel(const std::shared_ptr<TunnelMetrics>& tunnel);
+
+    /**
+     * @brief Kontrol komutu işleme süresinin yazılacağı histogram (komut tipine göre).
+     */
+    LatencyHistogram& command_latency(ControlType type);
+
+    std::atomic<uint64_t> connections_accepted{0};
+    std::atomic<uint64_t> connections_shed{0}; // Dosya tanımlayıcısı tükendiği için kabul edilip kapatılanlar
+    std::atomic<int64_t> clients_connected{0};
+    std::atomic<uint64_t> control_errors{0};
+    std::atomic<uint64_t> slow_viewers{0}; // Yayın oturumlarında gecikme sınırını aşan izleyiciler
+    std::atomic<uint64_t> tunnel_resumes{0};         // Kopan ucu süresi içinde geri dönen tüneller
+    std::atomic<uint64_t> tunnel_resume_timeouts{0}; // Kopan ucu dönmeden süresi dolan tüneller
+    std::atomic<uint64_t> egress_throttled{0};       // Hız sınırı veya adil sıra için bekletilen gönderimler
+    std::atomic<uint64_t> rfb_snapshots{0};          // Yayın izleyicisine RFB önbelleğinden gönderilen kareler
+    std::atomic<uint64_t> rfb_cache_failures{0};     // Akışı çözülemediği için kapatılan RFB önbellekleri
+    std::atomic<uint64_t> p2p_exchanges{0};          // Aday adresleri değiş tokuş edilen doğrudan bağlantı denemeleri
+    std::atomic<uint64_t> p2p_direct{0};             // İki ucun da doğrudan bağlandığını bildirdiği denemeler
+    std::atomic<uint64_t> p2p_fallbacks{0};          // Relay tüneline dönülen denemeler ve kopan doğrudan yollar
+    std::atomic<int64_t> cluster_links{0};           // Kurulu relay'ler arası bağlantılar
+    std::atomic<uint64_t> cluster_channels{0};       // Relay'ler arası açılan kanallar (iki yönde)
+    std::atomic<uint64_t> handshake_timeouts{0};     // Süresi içinde tünele geçemeyip eşleşmesi kaldırılan uçlar
+    std::atomic<uint64_t> idle_evictions{0};         // Boşta kalma süresini aştığı için kapatılan bağlantılar
+    std::atomic<uint64_t> heartbeats_sent{0};        // Komut modundaki istemcilere gönderilen PING'ler
+    std::atomic<uint64_t> tls_handshake_failures{0}; // Süresi içinde tamamlanmayan veya başarısız TLS el sıkışmaları
+    std::atomic<uint64_t> ktls_connections{0};       // Anahtarları çekirdeğe (kTLS) verilen TLS bağlantıları
+    std::atomic<uint64_t> tls_userspace_connections{0}; // kTLS yokken kullanıcı alanı köprüsüyle şifrelenen bağlantılar
+
+    /**
+     * @brief Tüm ölçümleri Prometheus metin biçiminde (sürüm 0.0.4) yazar.
+     */
+    std::string render() const;
+
+private:
+    static const size_t COMMAND_SLOTS = 5; // hello, connect, accept, start_vnc_tunnel, diğer
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<TunnelMetrics>> tunnels_;
+    uint64_t tunnels_opened_ = 0;
+    uint64_t closed_bytes_ = 0; // Kapanmış oturumlardan
+    uint64_t closed_chunks_ = 0;
+    uint64_t closed_partial_sends_ = 0;
+    LatencyHistogram closed_forward_latency_;
+    LatencyHistogram command_latency_[COMMAND_SLOTS];
+};
+
+extern RelayMetrics relay_metrics;
+
+/**
+ * @brief relay_metrics'i 127.0.0.1:port üzerinde HTTP ile ("GET /metrics") sunan arka plan
+ * thread'ini başlatır. İstekler aktarım thread'lerinden bağımsız olarak bu thread'de işlenir.
+ * @return Dinleyen soket açılamazsa false (hata günlüğe yazılır).
+ */
+bool metrics_start_server(int port);
+
+#endif // METRICS_H
@@ -0,0 +1,179 @@
+#ifndef MUX_LINK_H
+#define MUX_LINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <sys/types.h>
+
+/**
+ * @brief Ajan <-> relay bağlantısında kanal çoğullama (mux).
+ *
+ * Ajan komut modunda "mux" gönderir; relay "MUX_OK" ile yanıt verir ve bu satırdan sonra iki yönde
+ * de her şey çerçevelidir. Çerçeve (ağ bayt sırasıyla):
+ *   [0xD1: işaret + sürüm][kanal: 1 byte][tip: 1 byte][0][uzunluk: 4 byte][yük: uzunluk byte]
+ *
+ * Kanallar aynı zamanda gönderim önceliğidir (küçük numara önce gider):
+ *   0 kontrol: ajan ile relay arasındaki komut/kontrol akışı (eski metin veya ikili protokolün
+ *     baytları). Relay'de sonlanır; tünel sürerken de çalışır (ör. PEER_DISCONNECTED, disconnect).
+ *   1 giriş, 2 RFB, 3 toplu veri: tünelin iki ucu arasında uçtan uca taşınır; relay bu çerçeveleri
+ *     olduğu gibi iletir. Ajanlar VNC akışını yön başına ayırır: görüntüleyicinin gönderdiği RFB
+ *     istemci mesajları (tuş/fare olayları dahil) giriş kanalından, paylaşanın gönderdiği ekran
+ *     güncellemeleri RFB kanalından gider.
+ *
+ * Veri kanallarında akış denetimi kredi ile yapılır: her uç kanal başına MUX_INITIAL_WINDOW byte
+ * krediyle başlar, gönderdiği DATA yükü kadar kredi harcar; alıcı veriyi yerel tüketiciye verdikçe
+ * MUX_WINDOW ile kredi iade eder. Böylece bir kanalın yavaş tüketicisi diğer kanalları tıkamaz ve
+ * alıcıda kanal başına bekleyen veri pencereyle sınırlı kalır.
+ *
+ * Relay bir tünel açılmadan hemen önce ve tünel kapanınca ajana kanal 0'dan MUX_RESET gönderir:
+ * ajan veri kanallarındaki akışları kapatır, bekleyen veriyi atar ve kredileri sıfırlar. Relay bir
+ * tünel kapanırken yarısı gönderilmiş bir veri çerçevesini sıfırla tamamlar; çerçeve sınırı hiçbir
+ * zaman kaybolmaz.
+ */
+
+const uint8_t MUX_MAGIC_V1 = 0xD1;
+const size_t MUX_HEADER_SIZE = 8;
+const size_t MUX_MAX_PAYLOAD = 16 * 1024;
+const uint32_t MUX_INITIAL_WINDOW = 256 * 1024;
+// Çoğullanmış bağlantıda çekirdekte gönderilmeyi bekleyen veri sınırı (TCP_NOTSENT_LOWAT)
+const int MUX_NOTSENT_LOWAT = 32 * 1024;
+
+enum MuxChannel : uint8_t {
+    MUX_CHANNEL_CONTROL = 0,
+    MUX_CHANNEL_INPUT = 1,
+    MUX_CHANNEL_RFB = 2,
+    MUX_CHANNEL_BULK = 3
+};
+const uint8_t MUX_CHANNEL_COUNT = 4;
+
+enum MuxFrameType : uint8_t {
+    MUX_DATA = 0,   // Kanal verisi
+    MUX_WINDOW = 1, // Yük: 4 byte kredi artışı
+    MUX_CLOSE = 2,  // Gönderenin bu kanaldaki akışı bitti (yarı kapanış)
+    MUX_RESET = 3   // Yalnızca relay -> ajan, kanal 0: veri kanallarını sıfırla
+};
+
+struct MuxHeader {
+    uint8_t channel;
+    MuxFrameType type;
+    uint32_t length;
+};
+
+/**
+ * @brief MUX_HEADER_SIZE byte'lık başlığı çözer.
+ * @return İşaret/sürüm, kanal, tip veya uzunluk geçersizse false.
+ */
+bool parse_mux_header(const char* data, MuxHeader* header);
+
+/**
+ * @brief Başlığı out'a (MUX_HEADER_SIZE byte) yazar.
+ */
+void encode_mux_header(uint8_t channel, MuxFrameType type, uint32_t length, char* out);
+
+/**
+ * @brief Yükü MUX_MAX_PAYLOAD'lık çerçevelere bölerek out'a ekler.
+ */
+void append_mux_frames(std::string* out, uint8_t channel, MuxFrameType type, const char* payload, size_t length);
+
+const char* mux_channel_name(uint8_t channel);
+
+/**
+ * @brief Ajan tarafı çoğullayıcı: relay soketi ile yerel uçlar (Unix soket çiftleri) arasında
+ * çerçeveleri taşır. Uygulama her kanalı düz bir soket gibi okur/yazar; TlsBridge gibi kendi
+ * thread'inde run ile sürülür.
+ *
+ * Gönderimde her seferinde bir çerçeve hazırlanır ve gönderilecek veri olan en yüksek öncelikli
+ * kanal seçilir; büyük bir ekran güncellemesinin arkasında bekleyen kontrol veya giriş mesajı en
+ * fazla bir çerçeve (MUX_MAX_PAYLOAD) bekler. Çekirdeğin gönderim kuyruğunda biriken veri de
+ * önceliği geciktireceği için relay soketinde TCP_NOTSENT_LOWAT kullanılır.
+ *
+ * Kontrol ucu baştan vardır ve bağlantı boyunca değişmez; veri kanalı uçları her tünel için
+ * open_stream ile açılır ve MUX_RESET ile kapanır. Relay bağlantısı kapanınca tüm uçlar kapatılır;
+ * uygulama kontrol ucunu kapatınca relay bağlantısı kapatılır.
+ */
+class MuxBridge {
+public:
+    /**
+     * @param net_fd Relay bağlantısı (sahiplenilir; engellemeyen moda alınır).
+     * @param initial "MUX_OK" satırından sonra okunmuş, henüz işlenmemiş veri.
+     * @throws std::system_error soket çifti veya eventfd oluşturulamazsa (net_fd yine de kapatılır).
+     */
+    explicit MuxBridge(int net_fd, const std::string& initial = std::string());
+    ~MuxBridge();
+
+    MuxBridge(const MuxBridge&) = delete;
+    MuxBridge& operator=(const MuxBridge&) = delete;
+
+    /**
+     * @brief Kontrol kanalının uygulama ucu; bir kez alınır ve sahibi çağırandır (kapatınca köprü biter).
+     */
+    int take_control_fd();
+
+    /**
+     * @brief Bir veri akışı açar: uygulamanın yazdıkları send_channel'dan gönderilir, receive_channel'dan
+     * gelenler okunur. Aynı kanalları kullanan eski akış kapatılır. Herhangi bir thread'den çağrılabilir.
+     * @return Uygulama ucu (sahibi çağırandır) veya -1 (köprü bitti ya da soket çifti oluşturulamadı).
+     */
+    int open_stream(uint8_t send_channel, uint8_t receive_channel);
+
+    /**
+     * @brief Relay bağlantısı veya kontrol ucu kapanana kadar trafiği taşır (çağıran thread'de).
+     */
+    void run();
+
+    /**
+     * @brief Köprüyü herhangi bir thread'den durdurur; run kısa sürede döner.
+     */
+    void stop();
+
+private:
+    // Uygulamaya verilen soket çiftinin köprüde kalan ucu
+    struct Endpoint {
+        int fd = -1;
+        uint8_t send_channel = 0;
+        uint8_t receive_channel = 0;
+        bool readable = false; // poll okunabilir bildirdi; EAGAIN alınana kadar okunur
+        bool read_eof = false; // Uygulama yazma yönünü kapattı
+        bool write_shut = false;
+    };
+
+    struct Channel {
+        std::string inbound;      // Relay'den gelen, yerel uca henüz yazılmamış veri
+        size_t inbound_off = 0;
+        uint64_t send_window = MUX_INITIAL_WINDOW; // Karşıya gönderilebilecek byte
+        uint64_t credit = 0;      // Yerel uca yazılan, henüz iade edilmemiş byte
+        bool remote_closed = false;
+        int sender = -1;          // Bu kanaldan gönderen uç (endpoints_ indeksi)
+        int receiver = -1;        // Bu kanaldan alan uç
+    };
+
+    bool pump();
+    bool read_net();
+    bool handle_frame(const MuxHeader& header, const char* payload);
+    void deliver(uint8_t channel);
+    bool send_net();
+    bool next_frame();
+    void close_endpoint(int index);
+    void reset_channels();
+    void queue_signal(uint8_t channel, MuxFrameType type, uint32_t value, bool with_value);
+
+    std::mutex mutex_;
+    int net_fd_;
+    int wake_fd_;
+    int control_app_fd_;
+    Endpoint endpoints_[MUX_CHANNEL_COUNT * 2];
+    Channel channels_[MUX_CHANNEL_COUNT];
+    std::string in_;       // Relay'den okunmuş, çözülmemiş veri
+    std::string out_;      // Relay'e gönderilmekte olan çerçeve(ler)
+    size_t out_off_ = 0;
+    std::string signals_;  // Kredi iadeleri ve kapanışlar; veriden önce gider
+    bool net_eof_ = false;
+    bool stopped_ = false;
+    bool failed_ = false;
+};
+
+#endif // MUX_LINK_H
@@ -0,0 +1,266 @@
+#ifndef P2P_LINK_H
+#define P2P_LINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+/**
+ * @brief Ajanlar arası doğrudan yol: UDP hole punching ve UDP üzerinde güvenilir akış. Ajan ve
+ * bench/p2p_probe ortak kullanır; relay tarafı buluşma noktasıdır (bkz. rendezvous.h).
+ *
+ * Akış: connect/accept -> "p2p <yerel aday>" -> P2P_BIND ile alınan belirteç UDP soketinden
+ * buluşma portuna gönderilir -> P2P_CANDIDATES ile eşin adayları alınır -> tüm adaylara anahtarlı
+ * PUNCH paketleri gönderilir; PUNCHACK alınan ilk adres doğrudan yoldur:
+ *   "WRB1 PUNCH <anahtar> <id>", "WRB1 PUNCHACK <anahtar> <id>"
+ *
+ * Doğrudan yolda iki yön de aynı UDP soketinden akar. Paketler (ağ bayt sırasıyla):
+ *   ['D'][sıra: 4][yük]             veri parçası (en fazla P2P_SEGMENT_BYTES)
+ *   ['A'][beklenen sıra: 4][pencere: 4]  kümülatif onay ve alıcının boş tamponu (parça); boşta kalan
+ *                                   yolda canlılık sinyali olarak da gider
+ *   ['F'][parça sayısı: 4][toplam: 8]  gönderenin akışı bitti; onayı parça sayısı + 1'dir
+ * Gönderen kayan pencere (yavaş başlangıç + AIMD), üç yinelenen onayda hızlı yeniden gönderim
+ * (kısmi onaylarda NewReno gibi sıradaki kayıp da) ve RTO (Jacobson/Karels) kullanır.
+ */
+
+const size_t P2P_SEGMENT_BYTES = 1200;   // Parçalanmadan geçecek UDP yükü
+const int P2P_SILENCE_MS = 3000;         // Doğrudan yol bu kadar sessiz kalırsa koptu sayılır
+const int P2P_KEEPALIVE_MS = 1000;       // Boşta kalan yolda onay bu aralıkla yinelenir
+const uint32_t P2P_MAX_WINDOW = 2048;    // Parça
+
+/**
+ * @brief "ip:port" metnini çözer.
+ * @return IPv4 adresi veya port (1-65535) geçersizse false.
+ */
+bool parse_udp_address(const std::string& text, struct sockaddr_in* addr);
+
+/**
+ * @brief Adresi "ip:port" olarak yazar.
+ */
+std::string format_udp_address(const struct sockaddr_in& addr);
+
+/**
+ * @brief Buluşma ve hole punching. UDP soketinin sahibidir; doğrudan yol bulunursa aynı soket
+ * UdpStream'e ödünç verilir. Olay güdümlüdür: çağıran soketi (fd) ve kendi kontrol kaynağını
+ * poll ile bekler, kontrol satırlarını on_bind/on_candidates ile verir, timeout_ms dolunca
+ * on_timer'ı, soket okunabilir olunca on_readable'ı çağırır.
+ */
+class HolePuncher {
+public:
+    /**
+     * @param id Ucun relay'deki ID'si (PUNCH paketlerinde eşe bildirilir).
+     * @throws std::system_error UDP soketi açılamazsa.
+     */
+    explicit HolePuncher(const std::string& id);
+    ~HolePuncher();
+
+    HolePuncher(const HolePuncher&) = delete;
+    HolePuncher& operator=(const HolePuncher&) = delete;
+
+    int fd() const { return fd_; }
+
+    /**
+     * @brief "p2p" komutunun yerel adayı: relay'e giden kontrol bağlantısının yerel IP'si ve UDP
+     * soketinin portu.
+     */
+    std::string local_candidate(int control_fd) const;
+
+    /**
+     * @brief P2P_BIND argümanı ("<belirteç> <udp_port>"); buluşma noktası relay_ip'dedir.
+     */
+    bool on_bind(const std::string& relay_ip, const std::string& argument);
+
+    /**
+     * @brief P2P_CANDIDATES argümanı ("<anahtar> <ip:port>..."); ilk PUNCH hemen gider.
+     */
+    bool on_candidates(const std::string& argument);
+
+    bool has_candidates() const { return have_candidates_; }
+
+    /**
+     * @brief Sonraki BIND/PUNCH gönderimine kalan süre (ms).
+     */
+    int timeout_ms() const;
+
+    /**
+     * @brief Zamanı gelen BIND ve PUNCH paketlerini gönderir (UDP kayıplı olduğundan yinelenir).
+     */
+    void on_timer();
+
+    /**
+     * @brief Gelen paketleri işler. Eşin ilk veri paketi onaydan önce gelebilir; o paket yerinde
+     * bırakılır (akış okur).
+     * @return Doğrudan yol bulunduysa true (peer()).
+     */
+    bool on_readable();
+
+    bool punched() const { return punched_; }
+    const struct sockaddr_in& peer() const { return peer_; }
+    const std::string& key() const { return key_; }
+
+    /**
+     * @brief Doğrudan yolda gelen PUNCH paketini onaylar (eşin onayı kaybolmuş olabilir).
+     * @return Paket bir PUNCH ise true.
+     */
+    static bool answer_punch(int fd, const std::string& key, const std::string& id, const char* packet, size_t n,
+                             const struct sockaddr_in& from);
+
+private:
+    void send_text(const struct sockaddr_in& to, const std::string& text);
+
+    int fd_;
+    std::string id_;
+    std::string token_;
+    struct sockaddr_in rendezvous_;
+    bool have_rendezvous_ = false;
+    bool mapped_ = false;
+    bool have_candidates_ = false;
+    bool punched_ = false;
+    std::vector<struct sockaddr_in> candidates_;
+    std::string key_;
+    struct sockaddr_in peer_;
+    int64_t next_send_ms_ = 0;
+};
+
+/**
+ * @brief Doğrudan yolda iki yönlü güvenilir akış (bkz. dosya başı). Soketi ödünç alır; tek
+ * thread'den kullanılır ve engellemez: çağıran fd'yi timeout_ms ile bekler, okunabilir olunca
+ * on_readable'ı, her durumda on_timer'ı çağırır.
+ *
+ * Gönderilen veri eş onaylayana kadar tutulur; yol koparsa eşin aldığı konumdan sonrası
+ * unacked_from ile alınıp başka bir yoldan (relay tüneli) gönderilebilir.
+ */
+class UdpStream {
+public:
+    /**
+     * @param buffer_bytes Yön başına bekleyen (onaylanmamış veya okunmamış) veri sınırı.
+     */
+    UdpStream(int fd, const struct sockaddr_in& peer, const std::string& key, const std::string& id,
+              size_t buffer_bytes = 4 * 1024 * 1024);
+
+    UdpStream(const UdpStream&) = delete;
+    UdpStream& operator=(const UdpStream&) = delete;
+
+    /**
+     * @brief Veriyi gönderim tamponuna alır ve pencere elverdiğince gönderir.
+     * @return Alınan byte (tampon doluysa daha az).
+     */
+    size_t write(const char* data, size_t len);
+    size_t writable() const;
+
+    /**
+     * @brief Sırayla alınmış veriyi okur.
+     */
+    size_t read(char* out, size_t len);
+    size_t readable() const { return receive_buffer_.size() - receive_head_; }
+
+    /**
+     * @brief Gönderim tamponu boşalınca eşe akışın bittiğini bildirir (FIN).
+     */
+    void finish();
+
+    void on_readable();
+    void on_timer();
+    int timeout_ms() const;
+
+    /**
+     * @brief Yol P2P_SILENCE_MS boyunca sessiz kaldı veya gönderilen veri hiç onaylanmadı.
+     */
+    bool broken() const;
+
+    /**
+     * @brief Eş akışını bitirdi ve tüm verisi okundu.
+     */
+    bool peer_finished() const { return peer_fin_ && readable() == 0; }
+
+    /**
+     * @brief finish'ten sonra tüm veri ve bitiş onaylandı.
+     */
+    bool flushed() const { return fin_acked_; }
+
+    uint64_t bytes_written() const { return send_base_ + send_buffer_.size() - send_head_; }
+    uint64_t bytes_acked() const { return send_base_; }
+    uint64_t bytes_received() const { return received_bytes_; }
+
+    /**
+     * @brief Eşin offset'e kadar aldığı varsayılarak sonrasını (onaylanmamış ve gönderilmemiş) out'a kopyalar.
+     * @return offset onaylanandan önce veya yazılandan sonraysa false.
+     */
+    bool unacked_from(uint64_t offset, std::string* out) const;
+
+    uint64_t retransmits() const { return retransmits_; }
+    double srtt_ms() const { return srtt_; }
+
+    /**
+     * @brief Giden veri paketlerinin bu oranını bilerek düşürür (yeniden gönderim testi için).
+     */
+    void set_drop_rate(double rate) { drop_rate_ = rate; }
+
+private:
+    struct Segment {
+        uint64_t offset;
+        uint32_t length;
+        int64_t sent_at;
+        bool resent; // Karn: yeniden gönderilen parçadan RTT ölçülmez
+    };
+
+    void send_segments(int64_t now);
+    void transmit(uint32_t seq, int64_t now);
+    void send_ack(int64_t now);
+    void send_fin(int64_t now);
+    void on_ack(uint32_t ack, uint32_t window, int64_t now);
+    void on_data(uint32_t seq, const char* data, size_t n);
+    uint32_t receive_window() const;
+    void send_packet(const char* data, size_t n, int64_t now);
+
+    int fd_;
+    struct sockaddr_in peer_;
+    std::string key_;
+    std::string id_;
+    size_t buffer_bytes_;
+
+    // Gönderim: send_buffer_[send_head_..] onaylanmamış ve gönderilmemiş veridir; ilk byte'ın
+    // akıştaki konumu send_base_. Onaylanan veri baştan düşer (tampon ara sıra sıkıştırılır).
+    // Parça sınırları kesildikten sonra değişmez (alıcı sıra dışı parçaları sırayla saklar).
+    std::string send_buffer_;
+    size_t send_head_ = 0;
+    uint64_t send_base_ = 0;
+    std::deque<Segment> segments_;  // Kesilmiş ve onaylanmamış [base_, base_ + size) parçaları
+    uint32_t base_ = 0;             // İlk onaylanmamış parça
+    uint32_t next_ = 0;             // Sıradaki (yeniden) gönderilecek parça; RTO'da base_'e döner
+    uint32_t peer_window_ = 64;     // Eşin son bildirdiği boş tampon (parça)
+    double cwnd_ = 16, ssthresh_ = P2P_MAX_WINDOW;
+    double srtt_ = 0, rttvar_ = 0, rto_ = 200;
+    bool rtt_sampled_ = false;
+    uint32_t dup_acks_ = 0;
+    uint32_t recover_ = 0; // Hızlı kurtarma bitene kadar kısmi onaylar kaybı gösterir
+    bool finishing_ = false;
+    bool fin_acked_ = false;
+    int64_t fin_sent_ = 0;
+    uint64_t retransmits_ = 0;
+    int64_t last_progress_;   // Gönderilen verinin son onaylandığı an
+
+    // Alım
+    uint32_t expected_ = 0;
+    uint32_t fin_segments_ = UINT32_MAX;
+    uint64_t fin_total_ = 0;
+    bool peer_fin_ = false;
+    std::map<uint32_t, std::string> out_of_order_;
+    std::string receive_buffer_;
+    size_t receive_head_ = 0;
+    uint64_t received_bytes_ = 0;
+    uint32_t advertised_window_ = 0;
+
+    int64_t last_heard_;  // Eşten son paket
+    int64_t last_sent_;   // Eşe son paket (canlılık onayı için)
+    double drop_rate_ = 0;
+    std::mt19937 rng_;
+};
+
+#endif // P2P_LINK_H
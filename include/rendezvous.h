@@ -0,0 +1,85 @@
+#ifndef RENDEZVOUS_H
+#define RENDEZVOUS_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "client_info.h"
+#include "event_loop.h"
+
+// Uç başına en fazla doğrudan bağlantı adayı
+const size_t P2P_MAX_CANDIDATES = 8;
+
+/**
+ * @brief p2p komutundaki "ip:port" adaylarını (IPv4) doğrular ve tek boşlukla birleştirir (boş liste geçerli).
+ * @return Biçim geçersizse veya P2P_MAX_CANDIDATES'ten fazla aday varsa false.
+ */
+bool parse_p2p_candidates(std::string_view argument, std::string* candidates);
+
+/**
+ * @brief Buluşma noktasında gözlenen (NAT sonrası) adresi en olası aday olarak başa koyar; ucun
+ * bildirdiği adaylardan onunla aynı olan (NAT yoksa yerel adres) çıkarılır.
+ */
+std::string prepend_observed_candidate(const std::string& observed, const std::string& candidates);
+
+/**
+ * @brief Doğrudan (eşler arası) bağlantı denemeleri için UDP buluşma noktası.
+ *
+ * Relay, p2p komutu gönderen uca bir belirteç verir (P2P_BIND). Uç, hole punching'de kullanacağı
+ * UDP soketinden relay'in buluşma portuna belirteci gönderir:
+ *   "WRB1 BIND <belirteç>"
+ * Relay paketin geldiği (NAT sonrası) adresi kaydeder ve aynı soketten yanıtlar:
+ *   "WRB1 MAPPED <ip>:<port>"
+ * UDP kayıplı olduğundan uç BIND'i yanıt alana kadar yineler; bilinmeyen belirteçler yanıtsız
+ * kalır. Gözlenen adres bir kez, ilk pakette bildirilir (bound handler).
+ *
+ * Soket tek bir olay döngüsüne kaydedilir; belirteçler herhangi bir thread'den eklenip silinebilir.
+ */
+class RendezvousServer {
+public:
+    using BoundHandler = std::function<void(ClientId id, const std::string& token, const std::string& address)>;
+
+    /**
+     * @brief 0.0.0.0:port'ta UDP soketini açar ve loop'a kaydeder.
+     * @param on_bound Belirtecin ilk paketi geldiğinde loop'un thread'inde çağrılır.
+     * @throws std::system_error Soket açılamaz veya bağlanamazsa.
+     */
+    RendezvousServer(EventLoop& loop, int port, BoundHandler on_bound);
+    ~RendezvousServer();
+
+    RendezvousServer(const RendezvousServer&) = delete;
+    RendezvousServer& operator=(const RendezvousServer&) = delete;
+
+    int port() const { return port_; }
+
+    /**
+     * @brief id'li ucun token ile gelecek BIND paketini bekler.
+     */
+    void expect(const std::string& token, ClientId id);
+
+    /**
+     * @brief Belirteci siler; sonraki BIND paketleri yanıtsız kalır.
+     */
+    void forget(const std::string& token);
+
+private:
+    struct Binding {
+        ClientId id;
+        bool bound;
+    };
+
+    void on_readable();
+
+    EventLoop& loop_;
+    int fd_;
+    int port_;
+    BoundHandler on_bound_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Binding> bindings_;
+};
+
+#endif // RENDEZVOUS_H
@@ -0,0 +1,45 @@
+#ifndef RESUME_TABLE_H
+#define RESUME_TABLE_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "client_info.h"
+
+/**
+ * @brief 128 bit rastgele belirteç (onaltılık): devam ettirme, buluşma ve hole punching anahtarı.
+ */
+std::string generate_random_token();
+
+/**
+ * @brief Devam ettirme belirteci -> bağlantısı kopmuş (Resuming) tünel ucu.
+ *
+ * Kopan uç belirteciyle herhangi bir worker'a yeniden bağlanabildiğinden tablo tüm worker'larca
+ * paylaşılır ve tek bir kilitle korunur. Tablo yalnızca eşlemeyi tutar; uca ve oturumuna yalnızca
+ * sahibi olan worker dokunur (bkz. TunnelSession::reattach).
+ */
+class ResumeTable {
+public:
+    /**
+     * @brief Ucu belirteciyle kaydeder; aynı belirteçli önceki kaydın yerini alır.
+     */
+    void park(const std::string& token, std::shared_ptr<ClientInfo> client);
+
+    /**
+     * @brief Belirtecin ucunu döner (kayıt silinmez); yoksa nullptr.
+     */
+    std::shared_ptr<ClientInfo> find(const std::string& token) const;
+
+    void forget(const std::string& token);
+
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<ClientInfo>> parked_;
+};
+
+#endif // RESUME_TABLE_H
@@ -0,0 +1,213 @@
+#ifndef RFB_CACHE_H
+#define RFB_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Yayın oturumunda paylaşanın (RFB sunucusu) akışını çözüp güncel çerçeve tamponunu
+ * tutan önbellek.
+ *
+ * Akış relay'den değiştirilmeden geçer; önbellek yalnızca okur. El sıkışması (sürüm, güvenlik,
+ * ServerInit) ilk izleyiciyle (birincil) paylaşan arasında yapılır; birincil izleyicinin seçimleri
+ * RfbClientStream aracılığıyla bildirilir. Sonrasında FramebufferUpdate dikdörtgenleri çerçeve
+ * tamponuna uygulanır. Sonradan katılan izleyicinin ilk karesi bu tampondan üretilir ve izleyici
+ * canlı akışa bir mesaj sınırından katılır.
+ *
+ * Geç katılan izleyici canlı akışı da çözebilmeli; bu yüzden yalnızca durumsuz kodlamalar
+ * (Raw, CopyRect, RRE, Hextile, DesktopSize, LastRect) desteklenir ve birincil izleyicinin
+ * SetEncodings mesajı bu kümeye indirgenir. zlib durumu taşıyan kodlamalar (ZRLE, Tight)
+ * akışın ortasından çözülemez. Yalnızca gerçek renkli (true colour) 8/16/32 bpp piksel
+ * biçimleri desteklenir. Çözülemeyen bir şey görülürse önbellek kalıcı olarak devre dışı kalır
+ * (failed); akış birincil izleyiciye aynen akmaya devam eder.
+ */
+class RfbCache {
+public:
+    /**
+     * @param max_framebuffer_bytes Çerçeve tamponu için ayrılabilecek en fazla bellek.
+     */
+    explicit RfbCache(size_t max_framebuffer_bytes);
+
+    /**
+     * @brief Paylaşandan okunan veriyi işler.
+     * @param stop_at_boundary true ise bir mesaj sınırına gelindiğinde durur (at_boundary()).
+     * @return İşlenen byte sayısı. Önbellek devre dışı kalırsa kalan veri işlenmez.
+     */
+    size_t feed_server(const char* data, size_t len, bool stop_at_boundary);
+
+    bool failed() const { return state_ == FAILED; }
+
+    /**
+     * @brief ServerInit alındı ve akış çözülebiliyor: geç katılan izleyicilere hizmet verilebilir.
+     */
+    bool ready() const { return ready_ && state_ != FAILED; }
+
+    /**
+     * @brief Akış iki sunucu mesajının arasında: tampon, şimdiye kadarki tüm mesajları yansıtır.
+     */
+    bool at_boundary() const { return ready() && state_ == MESSAGE_TYPE && buf_.empty(); }
+
+    /**
+     * @brief Paylaşan parola (VNC kimlik doğrulaması) istiyor. Relay parolayı bilmediğinden geç
+     * katılan izleyicilere hizmet vermez; aksi halde parola atlanmış olurdu.
+     */
+    bool requires_auth() const { return security_type_ != SECURITY_NONE; }
+
+    /**
+     * @brief Paylaşanın sürüm satırı ("RFB 003.008\n"); henüz alınmadıysa boş.
+     */
+    const std::string& version() const { return version_; }
+    int server_minor() const { return server_minor_; }
+    int negotiated_minor() const;
+    uint8_t security_type() const { return security_type_; }
+    const uint8_t* pixel_format() const { return pixel_format_; }
+
+    // Birincil izleyicinin el sıkışması ve istemci mesajları (RfbClientStream çağırır)
+    void set_client_version(int minor) { client_minor_ = minor; }
+    void set_client_security(uint8_t type) { client_security_ = type; }
+    void set_pixel_format(const uint8_t* format);
+
+    /**
+     * @brief Önbelleği kalıcı olarak devre dışı bırakır.
+     */
+    void fail(const char* reason);
+
+    /**
+     * @brief Güncel boyut ve piksel biçimiyle ServerInit mesajını out'a ekler.
+     */
+    void server_init(std::string* out) const;
+
+    /**
+     * @brief Tüm çerçeve tamponunu tek dikdörtgenli bir FramebufferUpdate olarak out'a ekler.
+     * hextile true ise düz renkli 16x16 karolar tek pikselle kodlanır, diğerleri Raw.
+     */
+    void snapshot(std::string* out, bool hextile) const;
+
+    static const uint8_t SECURITY_NONE = 1;
+    static const uint8_t SECURITY_VNC_AUTH = 2;
+
+    /**
+     * @brief Önbelleğin çözebildiği kodlama mı (SetEncodings süzgeci için)?
+     */
+    static bool supported_encoding(int32_t encoding);
+
+private:
+    enum State {
+        SERVER_VERSION, SECURITY, SECURITY_33, SECURITY_COUNT, SECURITY_TYPES, SECURITY_WAIT,
+        VNC_CHALLENGE, SECURITY_RESULT, SERVER_INIT, SERVER_NAME,
+        MESSAGE_TYPE, UPDATE_HEADER, RECT_HEADER, RAW_ROW, COPY_RECT, RRE_HEADER, RRE_SUBRECT,
+        HEXTILE_TILE, HEXTILE_RAW, HEXTILE_BODY, HEXTILE_SUBRECTS, COLOUR_MAP_HEADER, CUT_TEXT_HEADER,
+        SKIP, FAILED
+    };
+
+    void step(const uint8_t* unit);
+    void begin_security(uint8_t type);
+    void next_rect();
+    void next_tile();
+    void expect(State state, size_t bytes);
+    bool resize(uint32_t width, uint32_t height);
+    bool valid_pixel_format(const uint8_t* format) const;
+    void fill(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pixel);
+    size_t offset(uint32_t x, uint32_t y) const { return ((size_t)y * width_ + x) * bpp_; }
+
+    size_t max_bytes_;
+    State state_;
+    size_t need_;
+    size_t skip_;
+    std::string buf_; // Parçalar arasında bölünen birimin biriken kısmı
+
+    std::string version_;
+    int server_minor_;
+    int client_minor_;
+    uint8_t client_security_;
+    uint8_t security_type_;
+    bool ready_;
+
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t bpp_; // Piksel başına byte
+    uint8_t pixel_format_[16];
+    std::string name_;
+    std::vector<uint8_t> framebuffer_;
+
+    // Çözülmekte olan FramebufferUpdate
+    uint32_t rects_left_;
+    uint32_t rect_x_, rect_y_, rect_w_, rect_h_;
+    uint32_t row_;
+    uint32_t subrects_left_;
+    uint32_t tile_x_, tile_y_, tile_w_, tile_h_;
+    uint8_t tile_flags_;
+    uint8_t background_[4];
+    uint8_t foreground_[4];
+};
+
+/**
+ * @brief Bir izleyicinin (RFB istemcisi) paylaşana giden akışını tam mesajlara böler.
+ *
+ * Birincil izleyicinin el sıkışması paylaşana aynen iletilir, seçimleri önbelleğe bildirilir;
+ * SetEncodings mesajı önbelleğin çözebildiği kodlamalara indirgenir. Geç katılan izleyicinin
+ * el sıkışmasını relay önbellekten yanıtlar (güvenlik: None); SetPixelFormat ve SetEncodings
+ * mesajları paylaşana iletilmez (tüm izleyiciler oturumun biçimini kullanır) ve tam ekran
+ * (artımlı olmayan) güncelleme istekleri önbellekten karşılanır. Mesajlar paylaşana yalnızca
+ * tamamlandığında verilir; böylece birden çok izleyicinin girişi mesaj sınırlarında birleşir.
+ */
+class RfbClientStream {
+public:
+    /**
+     * @param primary true: el sıkışmasını paylaşanla yapan ilk izleyici.
+     */
+    RfbClientStream(RfbCache& cache, bool primary);
+
+    bool primary() const { return primary_; }
+    bool started() const { return started_; }
+
+    /**
+     * @brief Geç katılan izleyicinin el sıkışmasını başlatır: sürüm satırını reply'a ekler.
+     */
+    void start(std::string* reply);
+
+    /**
+     * @brief İzleyiciden okunan veriyi işler. Tamamlanan mesajlar forward'a (paylaşana),
+     * relay'in yanıtları reply'a (izleyiciye) eklenir.
+     * @return Protokol hatasında false; izleyici çıkarılmalıdır.
+     */
+    bool feed(const char* data, size_t len, std::string* forward, std::string* reply);
+
+    /**
+     * @brief Tamamlanmamış mesajın tamponda bekleyen kısmı.
+     */
+    size_t pending() const { return msg_.size(); }
+
+    /**
+     * @brief İzleyici tam ekran güncelleme istedi (bir kez true döner).
+     */
+    bool take_snapshot_request();
+
+    /**
+     * @brief İzleyici Hextile kodlamasını destekliyor (SetEncodings'ten).
+     */
+    bool hextile() const { return hextile_; }
+
+private:
+    enum State { VERSION, SECURITY, AUTH, INIT, MESSAGE, CUT_TEXT_SKIP, PASSTHROUGH, REFUSED, ERROR };
+
+    bool unit_complete(std::string* forward, std::string* reply);
+    void after_security(uint8_t type);
+    bool message_complete(std::string* forward);
+    void refuse(int minor, const std::string& reason, std::string* reply);
+
+    RfbCache& cache_;
+    bool primary_;
+    bool started_;
+    State state_;
+    size_t expect_;   // Mevcut birimin (mesajın) şimdiye kadar bilinen toplam uzunluğu
+    size_t skip_;
+    std::string msg_;
+    int minor_;
+    bool hextile_;
+    bool snapshot_requested_;
+};
+
+#endif // RFB_CACHE_H
@@ -0,0 +1,109 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+
+/**
+ * @brief Sabit kapasiteli, byte tabanlı halka tampon (ring buffer).
+ * Kapasite ikinin kuvvetine yuvarlanır; bellek ilk kullanımda ayrılır, böylece splice yolunu
+ * kullanan tüneller için hiç bellek harcanmaz. Soketten doğrudan tampona okuma (readv) ve
+ * tampondan doğrudan sokete yazma (sendmsg) desteklenir; ara kopya yapılmaz.
+ *
+ * retain > 0 ise gönderilen son retain byte üzerine hemen yazılmaz; rewind() ile yeniden
+ * gönderilmek üzere geri alınabilir (oturum devam ettirme). Saklanan veri boş alandan düşer.
+ */
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity = 0, size_t retain = 0);
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    size_t size() const { return tail_ - head_; }
+    size_t capacity() const { return capacity_; }
+    size_t free_space() const { return capacity_ - (tail_ - floor_); }
+    bool empty() const { return head_ == tail_; }
+
+    /**
+     * @brief Veriyi tampona kopyalar.
+     * @return Kopyalanan byte sayısı (boş alan kadarıyla sınırlı).
+     */
+    size_t write(const char* data, size_t len);
+
+    /**
+     * @brief fd'den en fazla max_bytes (ve boş alan) kadar veriyi doğrudan tampona okur.
+     * @return read(2) ile aynı anlamda: >0 okunan byte, 0 bağlantı kapandı, -1 hata (errno).
+     */
+    ssize_t read_from_fd(int fd, size_t max_bytes);
+
+    /**
+     * @brief Tampondaki veriyi sokete gönderir ve gönderilen kısmı tampondan düşer.
+     * Kısmi gönderimler desteklenir; kalan veri tamponda kalır.
+     * @param max_bytes En fazla gönderilecek byte (hız sınırı için).
+     * @return Gönderilen byte sayısı veya -1 (errno; EAGAIN dahil).
+     */
+    ssize_t send_to_socket(int fd, size_t max_bytes = SIZE_MAX);
+
+    /**
+     * @brief Gönderilmiş son bytes byte'ı yeniden gönderilecek veriye geri alır.
+     * @return Bu kadar veri saklanmıyorsa false (tampon değişmez).
+     */
+    bool rewind(size_t bytes);
+
+    /**
+     * @brief Baştaki bytes byte'ı gönderilmiş sayar (send_to_socket gibi; veri saklanıyorsa
+     * yeniden gönderim için tutulur).
+     */
+    void discard(size_t bytes);
+
+    /**
+     * @brief Yeniden gönderim için saklanan (gönderilmiş) byte sayısı.
+     */
+    size_t retained() const { return head_ - floor_; }
+
+    /**
+     * @brief Saklanan ve gönderilmeyi bekleyen verinin tamamını (retained() + size() byte) out'a kopyalar.
+     */
+    void copy_to(std::string* out) const;
+
+    /**
+     * @brief Tampona en son yazılan bytes byte'ı (bytes <= size()) kopyalamadan gösterir; veri sonda
+     * ve başta iki parça olabilir.
+     * @return Doldurulan iovec sayısı (0, 1 veya 2).
+     */
+    int tail_iov(size_t bytes, struct iovec iov[2]) const;
+
+    /**
+     * @brief Baştan offset byte sonraki en fazla len byte'ı tampondan çıkarmadan out'a kopyalar.
+     * @return Kopyalanan byte sayısı.
+     */
+    size_t peek(size_t offset, char* out, size_t len) const;
+
+    /**
+     * @brief Gönderilmeyi bekleyen veriyi ilk len byte'a kısaltır (sondan atar; len >= size() ise değişmez).
+     */
+    void truncate(size_t len);
+
+    /**
+     * @brief Tamponu boşaltır (bellek korunur).
+     */
+    void clear() { head_ = tail_ = floor_ = 0; }
+
+private:
+    bool ensure_storage();
+
+    std::unique_ptr<char[]> storage_;
+    size_t capacity_;
+    size_t mask_;
+    size_t retain_;
+    size_t head_;  // Okuma konumu (sürekli artar, indeks için mask_ ile kesilir)
+    size_t tail_;  // Yazma konumu
+    size_t floor_; // Saklanan en eski byte'ın konumu (retain_ 0 ise head_)
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,111 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "event_loop.h"
+
+/**
+ * @brief Hiyerarşik zamanlayıcı çarkı (hierarchical timer wheel).
+ *
+ * Zaman tick_ms çözünürlüklü tick'lere bölünür. LEVELS seviyenin her birinde SLOTS yuva vardır;
+ * seviye L'deki bir yuva SLOTS^L tick'i kapsar. Zamanlayıcı, süresinin dolmasına kalan tick'e göre
+ * seviyesi ve yuvası hesaplanarak yuvanın çift yönlü listesine eklenir; kurma ve iptal O(1)'dir,
+ * bellek ayırmaz (düğüm Timer'ın içindedir). Bir üst seviyenin yuvasına sıra geldiğinde içindeki
+ * zamanlayıcılar alt seviyelere dağıtılır (cascade); her zamanlayıcı en fazla LEVELS kez taşınır.
+ * Yüz binlerce bağlantının kalp atışı, durum ve boşta kalma süreleri böylece bağlantı başına
+ * thread, uyku veya sistem çağrısı olmadan izlenir.
+ *
+ * Kapsam SLOTS^LEVELS tick'tir (100 ms'de yaklaşık 19 gün); daha uzun süreler sınıra kırpılır.
+ * Zamanlayıcı en erken süresinin dolduğu tick'te, en geç bir tick sonra çalışır.
+ *
+ * loop verildiyse çark bir timerfd ile her tick'te kendini ilerletir (çarkta zamanlayıcı yokken
+ * timerfd durur); verilmezse (benzetim, ölçüm) çağıran advance'i çağırır. Yalnızca sahibi olan
+ * thread'den kullanılır.
+ */
+class TimerWheel {
+public:
+    static const unsigned SLOT_BITS = 6;
+    static const unsigned SLOTS = 1u << SLOT_BITS;
+    static const unsigned LEVELS = 4;
+
+    /**
+     * @brief Çarka eklenebilen zamanlayıcı. Çağıran sahiplenir; kuruluyken yok edilirse
+     * listeden kendini çıkarır.
+     */
+    struct Timer {
+        Timer() = default;
+        ~Timer() { unlink(); }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool armed() const { return next != nullptr; }
+
+        // Süre dolunca çağrılır (zamanlayıcı artık kurulu değildir). Çark bir kopyasını çalıştırdığı için
+        // callback zamanlayıcıyı içeren nesneyi yok edebilir; yok ettikten sonra ona dokunmamalıdır.
+        std::function<void()> callback;
+
+    private:
+        friend class TimerWheel;
+        void unlink();
+
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        TimerWheel* wheel = nullptr;
+        uint64_t expires = 0; // Mutlak tick
+    };
+
+    /**
+     * @throws std::system_error loop verildiyse ve timerfd oluşturulamazsa.
+     */
+    explicit TimerWheel(EventLoop* loop, uint64_t tick_ms = 100, uint64_t (*clock)() = nullptr);
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief Zamanlayıcıyı delay_ms sonra çalışacak şekilde kurar; kuruluysa yeniden kurar.
+     */
+    void arm(Timer& timer, uint64_t delay_ms);
+
+    /**
+     * @brief Kurulu zamanlayıcıyı iptal eder; kurulu değilse bir şey yapmaz.
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * @brief Saati now_ms'e kadar ilerletir ve süresi dolanları çalıştırır. Callback'ler
+     * zamanlayıcı kurabilir veya iptal edebilir.
+     */
+    void advance(uint64_t now_ms);
+
+    /**
+     * @brief Çarkın saati (ms; son advance anındaki tick).
+     */
+    uint64_t now_ms() const { return now_ * tick_ms_; }
+
+    size_t size() const { return count_; }
+
+private:
+    struct Slot {
+        Timer head; // Döngüsel listenin nöbetçisi (sentinel)
+    };
+
+    void insert(Timer& timer);
+    void cascade(unsigned level);
+    void update_timerfd();
+
+    EventLoop* loop_;
+    uint64_t tick_ms_;
+    uint64_t (*clock_)();
+    uint64_t now_; // Tick
+    size_t count_;
+    int timer_fd_;
+    bool ticking_;
+    Slot slots_[LEVELS][SLOTS];
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,168 @@
+#ifndef TLS_LINK_H
+#define TLS_LINK_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+
+/**
+ * @brief Relay <-> ajan bağlantıları için TLS 1.3 (OpenSSL) ve çekirdek TLS (kTLS).
+ *
+ * El sıkışma kullanıcı alanında OpenSSL ile yapılır. Bağlamda kTLS açıksa (set_ktls) OpenSSL trafik
+ * anahtarlarını el sıkışma biterken kendisi çekirdeğe verir (SSL_OP_ENABLE_KTLS); OpenSSL kTLS'siz
+ * derlendiyse veya bir yönü (örn. eski sürümlerde TLS 1.3 alımı) kuramadıysa eksik yön
+ * setsockopt(TCP_ULP, "tls") + TLS_TX/TLS_RX ile burada kurulur. Bundan sonra soket şifreyi
+ * kendisi çözer/şifreler ve relay onu düz bir TCP soketi gibi kullanır (read/write, splice, sendfile).
+ * Çekirdek kTLS'i desteklemiyorsa TlsBridge şifrelemeyi kullanıcı alanında yapar ve relay'e bir
+ * Unix soket çiftinin ucunu verir; relay'in veri yolu iki durumda da değişmez.
+ *
+ * Tek şifre takımı seçilir (AES-128/256-GCM veya CHACHA20-POLY1305), oturum bileti gönderilmez ve
+ * el sıkışma sonrası anahtar güncellemesi desteklenmez: kTLS'e geçerken her iki yönün kayıt sırası 0'dır.
+ */
+
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+
+enum TlsResult {
+    TLS_DONE,
+    TLS_WANT_READ,
+    TLS_WANT_WRITE,
+    TLS_FAILED
+};
+
+enum KtlsResult {
+    KTLS_ENABLED,
+    KTLS_UNSUPPORTED, // Oturum TlsStream ile (kullanıcı alanı TLS) sürdürülebilir
+    KTLS_FAILED       // Soket yarı yapılandırıldı; kapatılmalı
+};
+
+class TlsContext {
+public:
+    /**
+     * @brief Sertifika ve özel anahtarla (PEM) sunucu bağlamı. Hata olursa std::runtime_error.
+     */
+    static std::unique_ptr<TlsContext> server(const std::string& cert_file, const std::string& key_file);
+
+    /**
+     * @brief İstemci bağlamı. ca_file boşsa sunucu sertifikası doğrulanmaz (yalnızca şifreleme).
+     */
+    static std::unique_ptr<TlsContext> client(const std::string& ca_file);
+
+    ~TlsContext();
+
+    /**
+     * @brief Bundan sonra açılan oturumlarda OpenSSL'in anahtarları el sıkışmada çekirdeğe vermesini
+     * ister (SSL_OP_ENABLE_KTLS). Kapalıyken (varsayılan) kayıtlar kullanıcı alanında şifrelenir;
+     * enable_ktls yine de anahtarları sonradan çekirdeğe verebilir.
+     */
+    void set_ktls(bool enabled);
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    SSL_CTX* native() const { return ctx_; }
+    bool is_server() const { return server_; }
+
+private:
+    TlsContext(SSL_CTX* ctx, bool server) : ctx_(ctx), server_(server) {}
+
+    SSL_CTX* ctx_;
+    bool server_;
+};
+
+/**
+ * @brief TCP soketi üzerindeki TLS oturumu (soket engelleyen veya engellemeyen olabilir). Soketin
+ * sahibi değildir.
+ */
+class TlsStream {
+public:
+    TlsStream(const TlsContext& context, int fd);
+    ~TlsStream();
+
+    TlsStream(const TlsStream&) = delete;
+    TlsStream& operator=(const TlsStream&) = delete;
+
+    /**
+     * @brief El sıkışmayı ilerletir; WANT_* dönerse soket hazır olunca yeniden çağrılır.
+     */
+    TlsResult handshake();
+
+    /**
+     * @brief El sıkışma bitince iki yönün de çekirdekte olmasını sağlar: OpenSSL'in kurmadığı yönün
+     * anahtarları verilir. ENABLED dönerse soket bundan sonra düz metin okunup yazılır ve bu nesne
+     * artık kullanılmaz. UNSUPPORTED dönerse oturum bu nesneyle (read/write) sürer. reason verilirse
+     * UNSUPPORTED/FAILED nedeni yazılır.
+     */
+    KtlsResult enable_ktls(std::string* reason);
+
+    /**
+     * @brief Kullanıcı alanı TLS ile okur/yazar. Bekleme gerekiyorsa -1 ve errno EAGAIN, hata
+     * olursa -1 ve errno ECONNRESET döner; read karşı taraf close_notify gönderdiyse 0 döner.
+     */
+    ssize_t read(char* data, size_t len);
+    ssize_t write(const char* data, size_t len);
+
+    /**
+     * @brief close_notify gönderir (sonucu beklenmez).
+     */
+    void shutdown();
+
+    int fd() const { return fd_; }
+    std::string cipher_name() const;
+
+private:
+    friend struct TlsSecrets;
+
+    SSL* ssl_;
+    int fd_;
+    bool server_;
+    std::string client_secret_; // CLIENT/SERVER_TRAFFIC_SECRET_0 (keylog geri çağrısından)
+    std::string server_secret_;
+};
+
+/**
+ * @brief kTLS yokken kullanıcı alanı TLS köprüsü: TLS soketiyle bir Unix soketi arasında veri
+ * taşır. Relay soket çiftinin diğer ucunu düz istemci soketi olarak kullanır. İki fd'nin de
+ * sahibidir. TLS tarafı kapanınca düz tarafa yazma yönü kapatılır; düz taraf kapanınca kalan veri
+ * gönderilir, close_notify yollanır ve köprü biter.
+ */
+class TlsBridge {
+public:
+    TlsBridge(std::unique_ptr<TlsStream> stream, int plain_fd);
+    ~TlsBridge();
+
+    TlsBridge(const TlsBridge&) = delete;
+    TlsBridge& operator=(const TlsBridge&) = delete;
+
+    /**
+     * @brief Engellemeden mümkün olan tüm aktarımı yapar. Köprü bittiyse veya hata olduysa false.
+     */
+    bool pump();
+
+    int tls_fd() const { return stream_->fd(); }
+    int plain_fd() const { return plain_fd_; }
+
+    // poll(2) ile süren çağıranlar için beklenecek olaylar
+    short tls_events() const;
+    short plain_events() const;
+
+private:
+    static const size_t BUFFER_SIZE = 16 * 1024;
+
+    std::unique_ptr<TlsStream> stream_;
+    int plain_fd_;
+    char inbound_[BUFFER_SIZE]; // TLS -> düz
+    size_t inbound_len_ = 0;
+    size_t inbound_off_ = 0;
+    char outbound_[BUFFER_SIZE]; // Düz -> TLS
+    size_t outbound_len_ = 0;
+    size_t outbound_off_ = 0;
+    bool tls_eof_ = false;
+    bool plain_eof_ = false;
+    bool plain_shut_ = false;
+    bool failed_ = false;
+};
+
+#endif // TLS_LINK_H
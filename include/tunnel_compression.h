@@ -0,0 +1,129 @@
+#ifndef TUNNEL_COMPRESSION_H
+#define TUNNEL_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <zlib.h>
+
+/**
+ * @brief Ajanlar arasında VNC tünelinin uyarlanabilir sıkıştırması ("deflate" tünel seçeneği).
+ *
+ * Her yön tek bir ham deflate akışıdır (zlib başlığı yok). Gönderen her okuduğu parçayı Z_SYNC_FLUSH
+ * ile sıkıştırır; parça karşı tarafta hemen çözülebilir, etkileşim gecikmesi eklenmez. Sıkıştırma
+ * seviyesi akış sürerken değiştirilebildiği için çözücünün seviyeyi bilmesi gerekmez: seviye 0
+ * (saklanan blok) zaten sıkıştırılmış veriyi neredeyse kopyalama maliyetiyle geçirir.
+ *
+ * Seviye ölçümle seçilir (bkz. TunnelCompressor):
+ *   - Parça bazında: örnek bayt dağılımının entropisi yüksekse (Tight/JPEG, ZRLE gibi zaten sıkıştırılmış
+ *     RFB kodlamaları) parça saklanan blok olarak gönderilir.
+ *   - Pencere bazında (COMPRESSION_WINDOW_MS): bağlantı darboğazsa (gönderim pencerenin en az
+ *     BACKLOG_STEP_UP_SHARE kadarında bekledi) ve sıkıştırmanın CPU payı düşükse seviye artırılır;
+ *     bağlantı yetişiyorsa (neredeyse hiç beklenmedi) veya CPU payı yüksekse azaltılır.
+ *
+ * Relay sıkıştırılmış veriyi olduğu gibi iletir; sıkıştırma yalnızca iki ajan da istediğinde açılır
+ * (bkz. control_protocol.h, tünel seçenekleri).
+ */
+
+const char* const TUNNEL_OPTION_DEFLATE = "deflate";
+
+// Uyarlamada kullanılan seviyeler (0: saklanan blok)
+const int COMPRESSION_LEVELS[] = {1, 3, 6};
+const int COMPRESSION_LEVEL_COUNT = 3;
+const int COMPRESSION_WINDOW_MS = 250;
+// Pencerede gönderimin bekleme payı: bunun üstünde bağlantı darboğaz sayılır, BACKLOG_IDLE_SHARE'in altında yetişiyor
+const double BACKLOG_STEP_UP_SHARE = 0.25;
+const double BACKLOG_IDLE_SHARE = 0.05;
+// Örnek entropisi bu değerin (bit/byte) üstündeyse parça sıkıştırılmaz
+const double INCOMPRESSIBLE_ENTROPY = 7.5;
+
+struct CompressionStats {
+    uint64_t bytes_in = 0;     // Sıkıştırılmamış
+    uint64_t bytes_out = 0;    // Sıkıştırılmış
+    uint64_t stored_bytes = 0; // Zaten sıkıştırılmış sayılıp saklanan blok olarak geçirilen
+    uint64_t cpu_ns = 0;       // deflate içinde geçen thread CPU süresi
+    uint64_t level_changes = 0; // Uyarlamanın seviye adımları (saklanan parçalar sayılmaz)
+};
+
+/**
+ * @brief Gönderen taraf: bir yönün deflate akışı ve seviye uyarlaması.
+ */
+class TunnelCompressor {
+public:
+    /**
+     * @param fixed_level 0-9 verilirse uyarlama yapılmaz ve bu seviye kullanılır (ölçüm için); -1 uyarlamalı.
+     * @throws std::runtime_error zlib akışı oluşturulamazsa.
+     */
+    explicit TunnelCompressor(int fixed_level = -1);
+    ~TunnelCompressor();
+
+    TunnelCompressor(const TunnelCompressor&) = delete;
+    TunnelCompressor& operator=(const TunnelCompressor&) = delete;
+
+    /**
+     * @brief Parçayı sıkıştırıp out'a ekler; çıktı bir sonraki parçayı beklemeden çözülebilir.
+     * @return zlib hatasında false.
+     */
+    bool compress(const char* data, size_t len, std::string* out);
+
+    /**
+     * @brief Sıkıştırılmış verinin gönderimi beklemeye başladı (true, soket doldu) veya yeniden ilerledi
+     * (false); bekleme süresi bağlantının darboğaz olup olmadığını belirler.
+     */
+    void note_blocked(bool blocked);
+
+    // Uyarlamanın seçtiği (veya sabit) seviye; saklanan parçalar bunu değiştirmez
+    int level() const { return fixed_level_ >= 0 ? fixed_level_ : COMPRESSION_LEVELS[level_index_]; }
+    const CompressionStats& stats() const { return stats_; }
+
+private:
+    void adapt(uint64_t now_ns);
+    bool set_level(int level, std::string* out);
+
+    z_stream stream_;
+    int fixed_level_;
+    int level_index_ = 0; // COMPRESSION_LEVELS içinde
+    int level_;           // Akışın şu anki seviyesi (0 dahil)
+    uint64_t blocked_since_ns_ = 0; // 0: gönderim beklemiyor
+    uint64_t window_start_ns_ = 0;
+    uint64_t window_cpu_ns_ = 0;
+    uint64_t window_blocked_ns_ = 0;
+    CompressionStats stats_;
+};
+
+/**
+ * @brief Alan taraf: bir yönün deflate akışını çözer.
+ */
+class TunnelDecompressor {
+public:
+    /**
+     * @throws std::runtime_error zlib akışı oluşturulamazsa.
+     */
+    TunnelDecompressor();
+    ~TunnelDecompressor();
+
+    TunnelDecompressor(const TunnelDecompressor&) = delete;
+    TunnelDecompressor& operator=(const TunnelDecompressor&) = delete;
+
+    /**
+     * @brief Gelen parçayı çözüp out'a ekler (parça bir çerçevenin ortasında bitebilir).
+     * @return Akış bozuksa false.
+     */
+    bool decompress(const char* data, size_t len, std::string* out);
+
+    uint64_t bytes_in() const { return bytes_in_; }
+    uint64_t bytes_out() const { return bytes_out_; }
+
+private:
+    z_stream stream_;
+    uint64_t bytes_in_ = 0;
+    uint64_t bytes_out_ = 0;
+};
+
+/**
+ * @brief Baytların (en fazla 4 KB'lık örnek) Shannon entropisi, bit/byte.
+ */
+double sample_entropy(const char* data, size_t len);
+
+#endif // TUNNEL_COMPRESSION_H
@@ -0,0 +1,237 @@
+#ifndef TUNNEL_SESSION_H
+#define TUNNEL_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capture.h"
+#include "client_info.h"
+#include "egress_scheduler.h"
+#include "event_loop.h"
+#include "metrics.h"
+#include "mux_link.h"
+#include "ring_buffer.h"
+
+/**
+ * @brief Tünel yönü başına tampon sınırları.
+ * Bir yönde bekleyen (karşı uca henüz gönderilemeyen) veri high_watermark'a ulaşınca kaynak
+ * uçtan okuma durdurulur; karşı uç veriyi aldıkça tampon low_watermark'ın altına inince
+ * okuma yeniden başlatılır. Böylece hızlı bir gönderen ile yavaş bir alıcı arasında bellek
+ * kullanımı yön başına high_watermark ile sınırlı kalır.
+ *
+ * replay_bytes > 0 ise oturum devam ettirilebilir: her yönde karşı uca gönderilmiş son
+ * replay_bytes byte saklanır (bkz. TunnelSession::reattach). Bu durumda splice kullanılmaz.
+ */
+struct TunnelLimits {
+    size_t high_watermark = 256 * 1024;
+    size_t low_watermark = 64 * 1024;
+    size_t replay_bytes = 0;
+};
+
+/**
+ * @brief VncTunnelling durumundaki iki istemciyi birbirine bağlayan, kendi kendine yeten oturum.
+ * Her iki ucun soketini ve yön başına aktarım durumunu tutar; veri aktarımı sırasında
+ * kayıt defterine (ClientRegistry) veya global bir kilide erişilmez.
+ *
+ * Linux'ta her yön için bir boru açılır ve veri soket->boru->soket olarak splice(2) ile
+ * taşınır. Boru açılamazsa veya splice desteklenmiyorsa (EINVAL) o yön kopyalama yoluna düşer;
+ * kopyalama yolunda veri yön başına sınırlı bir halka tamponda (RingBuffer) bekletilir.
+ * Her iki yolda da bekleyen veri TunnelLimits ile sınırlandırılır.
+ * Yön başına byte/parça/kısmi gönderim sayaçları, kuyruk derinliği ve alım->gönderim gecikmesi
+ * relay_metrics'e kayıtlı oturum ölçümlerine (TunnelMetrics) yazılır.
+ *
+ * Zamanlayıcı verildiyse karşı uca gönderimler onun izin verdiği kadar yapılır (hız sınırları,
+ * adil sıra, küçük gönderimlere öncelik; bkz. EgressScheduler); izin gelene kadar veri tamponda
+ * bekler.
+ *
+ * Yön başına akış konumları (kaynaktan alınan ve hedefe gönderilen toplam byte) tutulur. Bir
+ * ucun bağlantısı koptuğunda (socket_fd -1) oturum açık kalır: o uca giden veri tamponda
+ * birikir ve tampon dolunca karşı uçtan okuma durur. Uç yeni soketle döndüğünde reattach,
+ * ucun aldığını bildirdiği konumdan sonrasını yeniden gönderilecek şekilde geri sarar.
+ * Oturum, iki ucun sahibi olan olay döngüsü thread'inden kullanılmalıdır.
+ *
+ * İki uç da çoğullanmış bağlantı kullanıyorsa (ClientInfo::mux) tünel çerçevelidir ve kopyalama
+ * yolundan geçer: okunan verinin yalnızca çerçeve başlıklarına bakılır. Veri kanallarının
+ * çerçeveleri olduğu gibi iletilir; kanal 0 çerçeveleri (uçtan relay'e komutlar) tampondan çıkarılır
+ * ve take_control ile alınır. Relay'in uca gönderdiği kontrol çerçeveleri (send_urgent) tampondaki
+ * tünel verisini beklemez: gönderim o an içinde bulunulan çerçevenin sonunda durur ve kontrol
+ * çerçevesi araya girer. Henüz başlığı çözülmemiş veri gönderilmez.
+ */
+class TunnelSession {
+public:
+    /**
+     * @param loop İki ucun soketlerinin kayıtlı olduğu olay döngüsü.
+     * @param use_splice false ise tüm trafik kopyalama yolundan geçer.
+     * @param limits Yön başına tampon sınırları.
+     * @param scheduler Çıkış zamanlayıcısı (loop'un worker'ına ait); nullptr ise gönderim sınırsızdır.
+     */
+    TunnelSession(EventLoop& loop, ClientInfo& a, ClientInfo& b, bool use_splice,
+                  const TunnelLimits& limits = TunnelLimits(), EgressScheduler* scheduler = nullptr);
+    ~TunnelSession();
+
+    TunnelSession(const TunnelSession&) = delete;
+    TunnelSession& operator=(const TunnelSession&) = delete;
+
+    ClientInfo& peer_of(const ClientInfo& client);
+
+    /**
+     * @brief Oturum açılırken replay_bytes > 0 verildiyse true.
+     */
+    bool resumable() const { return limits_.replay_bytes > 0; }
+
+    /**
+     * @brief src'den bugüne kadar alınan toplam tünel byte'ı (push ile eklenenler dahil).
+     */
+    uint64_t received_from(const ClientInfo& src);
+
+    /**
+     * @brief Komut tamponunda kalan src verisini karşı uca giden akışa ekler. Tünel açılışında
+     * ve devam ettirmede, yönde boruda bekleyen veri yokken çağrılır.
+     */
+    void push(ClientInfo& src, const char* data, size_t len);
+
+    /**
+     * @brief Yeniden bağlanan dst için gönderim konumunu, dst'nin aldığını bildirdiği toplam
+     * byte'a geri sarar; aradaki veri dst yazılabilir olunca yeniden gönderilir.
+     * @return Konum ileride ise veya aradaki veri artık saklanmıyorsa false.
+     */
+    bool reattach(ClientInfo& dst, uint64_t received_by_dst);
+
+    /**
+     * @brief dst'ye gönderilmeyi bekleyen (boruda veya halka tamponda) byte sayısı.
+     */
+    size_t pending_bytes_to(const ClientInfo& dst) const;
+
+    /**
+     * @brief src soketinden okunabilen tüm veriyi karşı uca aktarır.
+     * Bekleyen veri high_watermark'a ulaşırsa src'den okuma durdurulur (read_paused).
+     * @return src bağlantısı kapandıysa veya okuma hatası olduysa false.
+     */
+    bool forward_from(ClientInfo& src);
+
+    /**
+     * @brief dst'nin çıkış tamponu boşaldığında çağrılır: dst'ye giden yönün borusunu veya
+     * halka tamponunu aktarır; bekleyen veri low_watermark'a indiyse karşı uçtan okumayı
+     * devam ettirir.
+     */
+    void on_writable(ClientInfo& dst);
+
+    /**
+     * @brief Kesintisiz yükseltmede devredilen yön durumu: akış konumları, splice borusu (içindeki
+     * veriyle birlikte) ve halka tampondaki saklanan ve bekleyen veri.
+     */
+    struct DirectionState {
+        uint64_t received = 0;
+        uint64_t sent = 0;
+        int pipe[2] = {-1, -1};
+        size_t pipe_bytes = 0;
+        std::string buffered; // Önce yeniden gönderim için saklanan retained byte, sonra bekleyen veri
+        size_t retained = 0;
+        // Çerçeveli tünel: çözülme konumu, gönderilmemiş çerçeve sonları, bekleyen kontrol ve
+        // tampona sığmamış veri
+        uint64_t scan_at = 0;
+        std::vector<uint64_t> frame_ends;
+        std::string urgent;
+        std::string backlog;
+    };
+
+    /**
+     * @brief src'den çıkan yönün durumunu yazar. Boru fd'leri oturumda kalır; oturum değişmez.
+     */
+    void export_direction(const ClientInfo& src, DirectionState* state) const;
+
+    /**
+     * @brief src'den çıkan yönü devralınan durumla değiştirir ve boru fd'lerini sahiplenir (state'te
+     * -1 yapılır). Oturum use_splice false ile açılmış olmalıdır; bekleyen veri dst yazılabilir olunca
+     * gönderilir.
+     * @return Tampondaki veri bu oturumun halka tamponuna sığmıyorsa false.
+     */
+    bool restore_direction(ClientInfo& src, DirectionState& state);
+
+    /**
+     * @brief Çerçeveli tünelde relay'in dst'ye gönderdiği kontrol çerçevelerini, bekleyen tünel
+     * verisinden önce ilk çerçeve sınırında gönderir. Tünel çerçeveli değilse queue_send gibidir.
+     * @return dst bağlantısı kullanılamaz durumdaysa false.
+     */
+    bool send_urgent(ClientInfo& dst, const char* data, size_t len);
+
+    /**
+     * @brief Çerçeveli tünelde src'nin kanal 0'dan gönderdiği, henüz işlenmemiş komut baytlarını verir.
+     */
+    std::string take_control(const ClientInfo& src);
+
+    /**
+     * @brief Bundan sonra kaynaklardan alınan veriyi (yön 0: a -> b) writer'a kaydeder. Kayıt
+     * kopyalama yolunda yapılır; oturum use_splice false ile açılmış olmalıdır. Kayıt oturum
+     * kapanınca biter.
+     */
+    void capture_to(std::unique_ptr<CaptureWriter> writer) { capture_ = std::move(writer); }
+
+    /**
+     * @brief Boruları kapatır ve durdurulmuş okumaları serbest bırakır. Bundan sonra
+     * oturum veri aktarmaz; uçlar komut moduna dönebilir. Çerçeveli tünelde her uca yarım kalan
+     * çerçevenin kalanı (sıfırla), bekleyen kontrol çerçeveleri ve MUX_RESET gönderilir; uçtan
+     * gelen yarım çerçeve komut modunda sürdürülür.
+     */
+    void close();
+
+private:
+    struct Direction {
+        Direction(ClientInfo* src, ClientInfo* dst, size_t buffer_capacity, size_t retain)
+            : src(src), dst(dst), pipe{-1, -1}, pipe_bytes(0), buffer(buffer_capacity, retain),
+              received(0), sent(0), stats(nullptr), framed(false), broken(false), scan_at(0) {}
+
+        ClientInfo* src;
+        ClientInfo* dst;
+        int pipe[2];       // splice borusu (okuma, yazma); kopyalama yolunda -1
+        size_t pipe_bytes; // Boruda bekleyen, dst'ye henüz aktarılmamış byte sayısı
+        RingBuffer buffer; // Kopyalama yolunda dst'ye gönderilmeyi bekleyen (ve saklanan) veri
+        uint64_t received; // src'den alınan toplam byte
+        uint64_t sent;     // dst'ye gönderilen toplam byte
+        TunnelDirectionMetrics* stats; // metrics_ içindeki yön sayaçları
+        ForwardLatencyTracker latency;
+        EgressFlow flow;   // Zamanlayıcı varsa dst'ye gönderim izni
+
+        // Çerçeveli tünel. Konumlar dst'ye iletilen akıştadır (sent ile aynı eksen).
+        bool framed;
+        bool broken;                    // src geçersiz çerçeve gönderdi
+        uint64_t scan_at;               // Başlığı henüz çözülmemiş ilk çerçevenin konumu
+        std::deque<uint64_t> frame_ends; // Çözülmüş, sonu henüz gönderilmemiş veri çerçevelerinin sonları
+        std::string urgent;             // Çerçeve sınırında dst'ye gönderilecek relay kontrol çerçeveleri
+        std::string backlog;            // Tampona sığmayan veri (tünel açılışında itilen çerçeveler)
+        std::string control;            // src'den çıkarılan kanal 0 yükleri
+    };
+
+    Direction& direction_from(const ClientInfo& src);
+    size_t pending_bytes(const Direction& dir) const;
+    bool open_pipe(Direction& dir);
+    void close_pipe(Direction& dir);
+    bool drain_pipe(Direction& dir);
+    void fall_back_to_copy(Direction& dir);
+    bool splice_forward(Direction& dir);
+    bool flush_buffer(Direction& dir);
+    bool copy_forward(Direction& dir);
+    void resume_reading(ClientInfo& client);
+    void on_received(Direction& dir, size_t bytes);
+    void on_sent(Direction& dir, size_t bytes);
+    size_t egress_allowance(Direction& dir, size_t pending);
+    bool scan_frames(Direction& dir);
+    void fill_from_backlog(Direction& dir);
+    size_t sendable_frames(Direction& dir);
+    void flush_urgent(Direction& dir);
+    void finish_framing(Direction& dir);
+
+    EventLoop& loop_;
+    TunnelLimits limits_;
+    Direction dirs_[2];
+    std::shared_ptr<TunnelMetrics> metrics_;
+    EgressScheduler* scheduler_;
+    std::unique_ptr<CaptureWriter> capture_; // Trafik kaydı (bkz. capture_to)
+    bool closed_;
+};
+
+#endif // TUNNEL_SESSION_H
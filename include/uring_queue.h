@@ -0,0 +1,140 @@
+#ifndef URING_QUEUE_H
+#define URING_QUEUE_H
+
+#include <cstdint>
+#include <string>
+
+#include <linux/io_uring.h>
+
+/**
+ * @brief io_uring örneğinin ince bir sarmalayıcısı (liburing gerektirmez).
+ * Gönderim (SQ) ve tamamlanma (CQ) halkalarını eşler; SQE alma, gönderme ve CQE tüketme
+ * işlemlerini sağlar. Sınıf thread-safe değildir: tek bir thread'den kullanılmalıdır.
+ */
+class UringQueue {
+public:
+    /**
+     * @param entries SQ halkasının girdi sayısı. CQ halkası bunun dört katı tutulur; çok atışlı
+     * (multishot) işlemler tek SQE için çok sayıda CQE üretir.
+     * @throws std::system_error io_uring_setup veya mmap başarısız olursa.
+     */
+    explicit UringQueue(unsigned entries);
+    ~UringQueue();
+
+    UringQueue(const UringQueue&) = delete;
+    UringQueue& operator=(const UringQueue&) = delete;
+
+    /**
+     * @brief Çekirdeğin relay motorunun kullandığı işlemleri destekleyip desteklemediğini sınar.
+     * @param reason Desteklenmiyorsa nedeni yazılır.
+     */
+    static bool probe(std::string* reason);
+
+    /**
+     * @brief Doldurulmak üzere sıfırlanmış bir SQE döndürür. Halka doluysa önce bekleyenleri gönderir.
+     */
+    io_uring_sqe* get_sqe();
+
+    /**
+     * @brief Hazırlanan SQE'leri çekirdeğe gönderir ve en az wait_nr tamamlanma bekler.
+     * @return io_uring_enter dönüş değeri (hata durumunda -errno).
+     */
+    int submit_and_wait(unsigned wait_nr);
+    int submit() { return submit_and_wait(0); }
+
+    /**
+     * @brief Hazır tüm CQE'leri sırayla fn'e verir ve tüketilmiş olarak işaretler.
+     * @return İşlenen CQE sayısı.
+     */
+    template <typename Fn>
+    unsigned for_each_completion(Fn&& fn) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count) {
+            const io_uring_cqe cqe = cqes_[head & cq_mask_];
+            // CQE kopyalandıktan hemen sonra yer serbest bırakılır; fn yeni SQE'ler gönderebilir
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            fn(cqe);
+        }
+        return count;
+    }
+
+    int ring_fd() const { return ring_fd_; }
+
+private:
+    void release();
+
+    int ring_fd_;
+    unsigned flags_;
+
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sqe_tail_; // Hazırlanmış ama henüz yayınlanmamış SQE'lerin sonu
+
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+};
+
+/**
+ * @brief Çekirdeğe kayıtlı sağlanan arabellek halkası (provided buffer ring).
+ * Çok atışlı recv işlemleri veriyi bu havuzdan seçilen arabelleklere yazar; CQE'de arabellek
+ * kimliği (bid) döner. Veri işlendikten (ör. karşı uca gönderildikten) sonra arabellek
+ * recycle() ile havuza geri verilir.
+ */
+class ProvidedBufferRing {
+public:
+    /**
+     * @param count Arabellek sayısı (ikinin kuvveti, en fazla 32768).
+     * @throws std::system_error bellek ayrılamazsa veya kayıt başarısız olursa.
+     */
+    ProvidedBufferRing(UringQueue& queue, uint16_t group_id, unsigned count, unsigned buffer_size);
+    ~ProvidedBufferRing();
+
+    ProvidedBufferRing(const ProvidedBufferRing&) = delete;
+    ProvidedBufferRing& operator=(const ProvidedBufferRing&) = delete;
+
+    char* buffer(uint16_t bid) { return buffers_ + (size_t)bid * buffer_size_; }
+
+    /**
+     * @brief Arabelleği havuza ekler. Çekirdeğe görünür olması için publish() gerekir.
+     */
+    void recycle(uint16_t bid);
+
+    /**
+     * @brief recycle() ile eklenen arabellekleri çekirdeğe yayınlar.
+     */
+    void publish();
+
+    uint16_t group_id() const { return group_id_; }
+    unsigned buffer_size() const { return buffer_size_; }
+    unsigned in_use() const { return in_use_; }
+    void mark_used() { ++in_use_; }
+
+private:
+    void add_buffer(uint16_t bid);
+
+    UringQueue& queue_;
+    uint16_t group_id_;
+    unsigned count_;
+    unsigned buffer_size_;
+    io_uring_buf_ring* ring_;
+    size_t ring_size_;
+    char* buffers_;
+    size_t buffers_size_;
+    uint16_t local_tail_;
+    unsigned in_use_;
+};
+
+#endif // URING_QUEUE_H
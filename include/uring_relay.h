@@ -0,0 +1,156 @@
+#ifndef URING_RELAY_H
+#define URING_RELAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "client_info.h"
+#include "tunnel_session.h"
+#include "uring_queue.h"
+
+/**
+ * @brief io_uring motorunun sunucu mantığına geri çağırdığı noktalar.
+ */
+struct UringRelayHandlers {
+    std::function<void(int fd)> on_accept;                                   // Yeni kabul edilen soket
+    std::function<void()> on_accept_exhausted;                              // accept EMFILE/ENFILE döndü
+    std::function<bool(ClientInfo&, const char*, size_t)> on_command_data;  // false: okuma durduruldu
+    std::function<void(ClientInfo&)> on_disconnect;                         // Bağlantı koptu veya hata
+};
+
+/**
+ * @brief epoll reaktörüne alternatif, tamamlanma tabanlı (io_uring) relay motoru.
+ * Dinleyen sokette çok atışlı accept, istemci soketlerinde sağlanan arabellek halkasına
+ * çok atışlı recv kullanılır. Tünel trafiği arabellek kopyalanmadan, aynı turda biriken
+ * parçalar birbirine bağlı (IOSQE_IO_LINK) send işlemleri olarak karşı uca gönderilir;
+ * böylece read/send çifti başına iki sistem çağrısı yerine tur başına tek io_uring_enter yapılır.
+ *
+ * Karşı uca gönderilmeyi bekleyen veri TunnelLimits ile sınırlıdır: high_watermark'a ulaşınca
+ * kaynak uçtaki recv iptal edilir, low_watermark'a inince yeniden kurulur.
+ * Tünel ölçümleri epoll yolundaki gibi relay_metrics'e yazılır; MSG_WAITALL nedeniyle kısmi
+ * gönderim oluşmadığından partial_sends sayacı bu motorda artmaz.
+ * Sınıf thread-safe değildir; tüm çağrılar run() ile aynı thread'den yapılmalıdır.
+ */
+class UringRelay {
+public:
+    /**
+     * @throws std::system_error io_uring örneği veya arabellek halkası oluşturulamazsa.
+     */
+    UringRelay(int listen_fd, const TunnelLimits& limits, UringRelayHandlers handlers);
+    ~UringRelay();
+
+    UringRelay(const UringRelay&) = delete;
+    UringRelay& operator=(const UringRelay&) = delete;
+
+    /**
+     * @brief Çekirdeğin motoru çalıştırıp çalıştıramayacağını sınar.
+     */
+    static bool supported(std::string* reason) { return UringQueue::probe(reason); }
+
+    /**
+     * @brief Kabul edilen istemciyi motora ekler ve okumayı başlatır.
+     */
+    void add_client(const std::shared_ptr<ClientInfo>& client);
+
+    /**
+     * @brief İstemcinin bekleyen işlemlerini iptal eder ve soketini kapatır.
+     */
+    void close_client(ClientInfo& client);
+
+    /**
+     * @brief İki istemci arasında tünel veri yolunu kurar; bundan sonra okunan veri karşı uca gider.
+     */
+    void open_tunnel(ClientInfo& a, ClientInfo& b);
+
+    /**
+     * @brief İstemcinin tünelini kapatır; karşı uca henüz gönderilmemiş veri atılır.
+     */
+    void close_tunnel(ClientInfo& client);
+
+    /**
+     * @brief read_paused ile durdurulmuş okumayı yeniden başlatır.
+     */
+    void resume_reading(ClientInfo& client);
+
+    /**
+     * @brief İstemcinin çıkış tamponunda veri kaldığında POLLOUT beklemesi kurar.
+     */
+    void watch_output(ClientInfo& client);
+
+    void run();
+    void stop() { running_ = false; }
+
+private:
+    enum Op : uint8_t { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_POLL_OUT, OP_CANCEL, OP_ACCEPT_RETRY };
+
+    struct Chunk {
+        uint16_t bid;
+        uint32_t len;
+    };
+
+    struct Conn {
+        std::shared_ptr<ClientInfo> client;
+        int fd;
+        uint8_t generation;
+        bool recv_armed = false;
+        bool poll_armed = false;
+        bool starved = false;  // Arabellek havuzu boş olduğu için recv sonlandı (ENOBUFS)
+        bool dirty = false;    // Tur sonunda gönderim kuyruğu işlenecek
+        int peer_fd = -1;      // Tünel karşı ucu
+        std::deque<Chunk> send_queue; // Bu uca gidecek parçalar; ilk sends_in_flight tanesi çekirdekte
+        unsigned sends_in_flight = 0;
+        size_t pending_bytes = 0;     // send_queue'daki toplam byte
+        std::shared_ptr<TunnelMetrics> tunnel_metrics;   // Tünel açıkken oturum ölçümleri
+        TunnelDirectionMetrics* inbound_stats = nullptr; // Bu uca giden yönün sayaçları
+        ForwardLatencyTracker latency;                   // Bu uca giden verinin alım zamanları
+    };
+
+    static uint64_t make_user_data(Op op, uint8_t generation, uint16_t bid, int fd);
+    Conn* find_conn(int fd, uint8_t generation);
+    Conn* conn_for(uint64_t user_data);
+    Conn* conn_of(const ClientInfo& client);
+    Conn* peer_of(const Conn& conn);
+
+    void arm_accept();
+    void arm_accept_retry();
+    void arm_recv(Conn& conn);
+    void cancel_recv(Conn& conn);
+    void arm_poll_out(Conn& conn);
+    void mark_dirty(Conn& conn);
+    void submit_sends(Conn& dst);
+    void drop_queued(Conn& dst);
+    void release_metrics(Conn& conn);
+    void disconnect(Conn& conn);
+
+    void dispatch(const io_uring_cqe& cqe);
+    void on_accept(const io_uring_cqe& cqe);
+    void on_recv(const io_uring_cqe& cqe);
+    void on_send(const io_uring_cqe& cqe);
+    void on_poll_out(const io_uring_cqe& cqe);
+    void after_batch();
+
+    int listen_fd_;
+    TunnelLimits limits_;
+    UringRelayHandlers handlers_;
+    UringQueue queue_;
+    ProvidedBufferRing buffers_;
+    bool running_;
+    struct __kernel_timespec accept_retry_delay_; // Tanımlayıcılar tükenince accept bu kadar sonra yeniden kurulur
+
+    // fd ile doğrudan indekslenir; kuşak (generation) sayacı fd yeniden kullanıldığında
+    // eski bağlantıya ait geç gelen CQE'lerin ayırt edilmesini sağlar.
+    std::vector<std::unique_ptr<Conn>> conns_;
+    std::vector<uint8_t> generations_;
+    std::vector<std::unique_ptr<Conn>> graveyard_; // Dağıtım sırasında kapatılanlar tur sonunda silinir
+    std::vector<std::pair<int, uint8_t>> dirty_;
+    std::vector<std::pair<int, uint8_t>> starved_;
+    bool recycled_;
+};
+
+#endif // URING_RELAY_H
@@ -0,0 +1,426 @@
+#include "capture.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Diske yazılmayı bekleyen veri bu sınırı aşarsa yeni parçalar atılır
+static const size_t MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t align8(size_t len) {
+    return (len + 7) & ~static_cast<size_t>(7);
+}
+
+struct CaptureWriter::File {
+    int fd;
+    std::string path;
+
+    File(int fd, const std::string& path) : fd(fd), path(path) {}
+    ~File() { close(fd); }
+};
+
+namespace {
+
+/**
+ * @brief Süreç başına tek yazma thread'i. Tüm kayıtların parçaları sırayla pwrite ile yazılır;
+ * dosya son işi yazıldıktan sonra (son shared_ptr bırakılınca) kapanır.
+ */
+class CaptureDisk {
+public:
+    struct Job {
+        std::shared_ptr<CaptureWriter::File> file;
+        uint64_t offset;
+        std::unique_ptr<char[]> data;
+        size_t len;
+    };
+
+    static CaptureDisk& instance() {
+        static CaptureDisk disk;
+        return disk;
+    }
+
+    /**
+     * @param force Kuyruk sınırını yok say (başlık, son parça ve dizin kaybolmamalı).
+     * @return Kuyruk dolu olduğu için iş alınmadıysa false.
+     */
+    bool submit(Job job, bool force) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!force && queued_bytes_ + job.len > MAX_QUEUED_BYTES) return false;
+        queued_bytes_ += job.len;
+        jobs_.push_back(std::move(job));
+        cv_.notify_one();
+        return true;
+    }
+
+private:
+    CaptureDisk() : thread_(&CaptureDisk::run, this) {}
+
+    ~CaptureDisk() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return; // Durduruldu ve kuyruk boşaldı
+
+            Job job = std::move(jobs_.front());
+            jobs_.pop_front();
+            lock.unlock();
+
+            write_job(job);
+            job.file.reset();
+
+            lock.lock();
+            queued_bytes_ -= job.len;
+        }
+    }
+
+    static void write_job(const Job& job) {
+        const char* data = job.data.get();
+        size_t left = job.len;
+        uint64_t offset = job.offset;
+        while (left > 0) {
+            ssize_t n = pwrite(job.file->fd, data, left, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                LOG_RATE_LIMITED(LOG_WARN, 1) << "Kayıt dosyasına yazılamadı (" << job.file->path << "): "
+                                              << strerror(errno);
+                return;
+            }
+            data += n;
+            left -= n;
+            offset += n;
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    size_t queued_bytes_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const std::string& path, const std::string& label, uint64_t limit_bytes,
+                             uint32_t chunk_size)
+    : path_(path),
+      chunk_size_(std::max<uint32_t>(chunk_size, 4096)),
+      limit_(limit_bytes),
+      start_ns_(monotonic_ns()),
+      chunk_(new char[chunk_size_]),
+      chunk_header_(reinterpret_cast<CaptureChunkHeader*>(chunk_.get())),
+      chunk_count_(0),
+      totals_{ 0, 0 },
+      dropped_(0),
+      gap_(false) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "kayıt dosyası " + path);
+    file_ = std::make_shared<File>(fd, path);
+
+    CaptureDisk::Job job{ file_, 0, std::unique_ptr<char[]>(new char[CAPTURE_HEADER_SIZE]()),
+                          CAPTURE_HEADER_SIZE };
+    CaptureFileHeader* header = reinterpret_cast<CaptureFileHeader*>(job.data.get());
+    memcpy(header->magic, CAPTURE_MAGIC, sizeof(header->magic));
+    header->version = 1;
+    header->header_size = CAPTURE_HEADER_SIZE;
+    header->chunk_size = chunk_size_;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header->start_unix_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+    strncpy(header->label, label.c_str(), sizeof(header->label) - 1);
+    CaptureDisk::instance().submit(std::move(job), true);
+
+    new_chunk();
+}
+
+CaptureWriter::~CaptureWriter() {
+    if (chunk_header_->records > 0) submit_chunk(true);
+
+    size_t trailer_len = index_.size() + sizeof(CaptureTrailer);
+    CaptureDisk::Job job{ file_, CAPTURE_HEADER_SIZE + chunk_count_ * chunk_size_,
+                          std::unique_ptr<char[]>(new char[trailer_len]()), trailer_len };
+    memcpy(job.data.get(), index_.data(), index_.size());
+    CaptureTrailer* trailer = reinterpret_cast<CaptureTrailer*>(job.data.get() + index_.size());
+    memcpy(trailer->magic, CAPTURE_TRAILER_MAGIC, sizeof(trailer->magic));
+    trailer->chunk_count = chunk_count_;
+    trailer->index_offset = job.offset;
+    trailer->total_bytes[0] = totals_[0];
+    trailer->total_bytes[1] = totals_[1];
+    trailer->dropped_bytes = dropped_;
+    CaptureDisk::instance().submit(std::move(job), true);
+}
+
+void CaptureWriter::new_chunk() {
+    memset(chunk_header_, 0, sizeof(CaptureChunkHeader));
+    memcpy(chunk_header_->magic, CAPTURE_CHUNK_MAGIC, sizeof(chunk_header_->magic));
+    chunk_header_->used = sizeof(CaptureChunkHeader);
+    chunk_header_->index = static_cast<uint32_t>(chunk_count_);
+    chunk_header_->stream_offset[0] = totals_[0];
+    chunk_header_->stream_offset[1] = totals_[1];
+}
+
+void CaptureWriter::submit_chunk(bool force) {
+    // Son parça ve dizin her durumda yazılır; dolan parçalar kuyruk sınırına tabidir
+    size_t len = chunk_header_->used;
+    CaptureDisk::Job job{ file_, CAPTURE_HEADER_SIZE + chunk_count_ * chunk_size_,
+                          std::unique_ptr<char[]>(new char[len]), len };
+    memcpy(job.data.get(), chunk_.get(), len);
+
+    CaptureIndexEntry entry;
+    entry.first_ns = chunk_header_->first_ns;
+    entry.last_ns = chunk_header_->last_ns;
+    entry.stream_offset[0] = chunk_header_->stream_offset[0];
+    entry.stream_offset[1] = chunk_header_->stream_offset[1];
+    entry.records = chunk_header_->records;
+    entry.used = chunk_header_->used;
+
+    if (CaptureDisk::instance().submit(std::move(job), force)) {
+        index_.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        chunk_count_++;
+    } else {
+        // Parça atıldı: dosyada boşluk bırakmamak için aynı sıra yeniden kullanılır ve akış
+        // konumları parça başına geri alınır; kayıp sonraki kayda işaretlenir
+        dropped_ += (totals_[0] - entry.stream_offset[0]) + (totals_[1] - entry.stream_offset[1]);
+        totals_[0] = entry.stream_offset[0];
+        totals_[1] = entry.stream_offset[1];
+        gap_ = true;
+    }
+    new_chunk();
+}
+
+char* CaptureWriter::reserve(size_t len) {
+    if (chunk_header_->used + len > chunk_size_) {
+        submit_chunk(false);
+    }
+    char* out = chunk_.get() + chunk_header_->used;
+    chunk_header_->used += static_cast<uint32_t>(len);
+    return out;
+}
+
+void CaptureWriter::begin_record(uint8_t direction, uint8_t flags, size_t length) {
+    char* out = reserve(sizeof(CaptureRecordHeader) + align8(length));
+
+    CaptureRecordHeader* record = reinterpret_cast<CaptureRecordHeader*>(out);
+    record->length = static_cast<uint32_t>(length);
+    record->direction = direction;
+    record->flags = flags | (gap_ ? CAPTURE_FLAG_GAP : 0);
+    record->reserved = 0;
+    record->time_ns = monotonic_ns() - start_ns_;
+    gap_ = false;
+
+    if (chunk_header_->records == 0) chunk_header_->first_ns = record->time_ns;
+    chunk_header_->last_ns = record->time_ns;
+    chunk_header_->records++;
+}
+
+void CaptureWriter::append(uint8_t direction, const char* data, size_t len) {
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = len;
+    append(direction, &iov, 1);
+}
+
+void CaptureWriter::append(uint8_t direction, const struct iovec* iov, int count) {
+    direction &= 1;
+    size_t total = 0;
+    for (int i = 0; i < count; i++) total += iov[i].iov_len;
+    if (total == 0) return;
+
+    if (limit_ > 0 && totals_[0] + totals_[1] + total > limit_) {
+        dropped_ += total;
+        return;
+    }
+
+    // Parçaya sığan en büyük veri; parça dolarsa kalan veri yeni kayıtla sürer
+    const size_t max_payload = (chunk_size_ - sizeof(CaptureChunkHeader) - sizeof(CaptureRecordHeader)) & ~7;
+    int index = 0;
+    size_t offset = 0;
+    while (total > 0) {
+        size_t room = chunk_size_ - chunk_header_->used;
+        size_t piece;
+        if (room >= sizeof(CaptureRecordHeader) + 64) {
+            piece = std::min(total, (room - sizeof(CaptureRecordHeader)) & ~static_cast<size_t>(7));
+        } else {
+            piece = std::min(total, max_payload); // Yeni parçada başlar
+        }
+
+        begin_record(direction, 0, piece);
+        char* out = chunk_.get() + chunk_header_->used - align8(piece);
+        size_t copied = 0;
+        while (copied < piece) {
+            size_t n = std::min(piece - copied, iov[index].iov_len - offset);
+            memcpy(out + copied, static_cast<const char*>(iov[index].iov_base) + offset, n);
+            copied += n;
+            offset += n;
+            if (offset == iov[index].iov_len) {
+                index++;
+                offset = 0;
+            }
+        }
+        memset(out + piece, 0, align8(piece) - piece);
+
+        totals_[direction] += piece;
+        total -= piece;
+    }
+}
+
+void CaptureWriter::close_direction(uint8_t direction) {
+    begin_record(direction & 1, CAPTURE_FLAG_CLOSE, 0);
+}
+
+CaptureReader::CaptureReader(const std::string& path)
+    : map_(nullptr), size_(0), header_(nullptr), indexed_(false), totals_{ 0, 0 }, dropped_(0) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error(path + " açılamadı: " + strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(CAPTURE_HEADER_SIZE)) {
+        close(fd);
+        throw std::runtime_error(path + " bir kayıt dosyası değil (çok kısa)");
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) throw std::runtime_error(path + " eşlenemedi: " + strerror(errno));
+    map_ = static_cast<const char*>(map);
+    header_ = reinterpret_cast<const CaptureFileHeader*>(map_);
+
+    if (memcmp(header_->magic, CAPTURE_MAGIC, sizeof(header_->magic)) != 0 ||
+        header_->header_size < sizeof(CaptureFileHeader) || header_->chunk_size < 4096) {
+        munmap(const_cast<char*>(map_), size_);
+        throw std::runtime_error(path + " bir kayıt dosyası değil");
+    }
+
+    // Son ek varsa dizin oradan okunur
+    if (size_ >= header_->header_size + sizeof(CaptureTrailer)) {
+        const CaptureTrailer* trailer =
+            reinterpret_cast<const CaptureTrailer*>(map_ + size_ - sizeof(CaptureTrailer));
+        uint64_t index_len = trailer->chunk_count * sizeof(CaptureIndexEntry);
+        if (memcmp(trailer->magic, CAPTURE_TRAILER_MAGIC, sizeof(trailer->magic)) == 0 &&
+            trailer->index_offset + index_len + sizeof(CaptureTrailer) == size_ &&
+            trailer->index_offset == header_->header_size + trailer->chunk_count * header_->chunk_size) {
+            const CaptureIndexEntry* entries =
+                reinterpret_cast<const CaptureIndexEntry*>(map_ + trailer->index_offset);
+            entries_.assign(entries, entries + trailer->chunk_count);
+            totals_[0] = trailer->total_bytes[0];
+            totals_[1] = trailer->total_bytes[1];
+            dropped_ = trailer->dropped_bytes;
+            indexed_ = true;
+            return;
+        }
+    }
+
+    // Kayıt kapanmadan sonlanmış: parçalar sırayla taranır, ilk bozuk/eksik parçada durulur
+    for (size_t i = 0;; i++) {
+        uint64_t offset = header_->header_size + i * static_cast<uint64_t>(header_->chunk_size);
+        if (offset + sizeof(CaptureChunkHeader) > size_) break;
+        const CaptureChunkHeader* chunk = reinterpret_cast<const CaptureChunkHeader*>(map_ + offset);
+        if (memcmp(chunk->magic, CAPTURE_CHUNK_MAGIC, sizeof(chunk->magic)) != 0 || chunk->index != i ||
+            chunk->used < sizeof(CaptureChunkHeader) || chunk->used > header_->chunk_size ||
+            offset + chunk->used > size_) {
+            break;
+        }
+        CaptureIndexEntry entry;
+        entry.first_ns = chunk->first_ns;
+        entry.last_ns = chunk->last_ns;
+        entry.stream_offset[0] = chunk->stream_offset[0];
+        entry.stream_offset[1] = chunk->stream_offset[1];
+        entry.records = chunk->records;
+        entry.used = chunk->used;
+        entries_.push_back(entry);
+    }
+
+    // Toplamlar son parçanın başından itibaren sayılır
+    if (!entries_.empty()) {
+        CaptureCursor cursor;
+        cursor.chunk = entries_.size() - 1;
+        totals_[0] = entries_.back().stream_offset[0];
+        totals_[1] = entries_.back().stream_offset[1];
+        CaptureRecord record;
+        while (next(&cursor, &record)) totals_[record.direction] += record.length;
+    }
+}
+
+CaptureReader::~CaptureReader() {
+    if (map_ != nullptr) munmap(const_cast<char*>(map_), size_);
+}
+
+std::string CaptureReader::label() const {
+    return std::string(header_->label, strnlen(header_->label, sizeof(header_->label)));
+}
+
+uint64_t CaptureReader::total_bytes(int direction) const {
+    return totals_[direction & 1];
+}
+
+const char* CaptureReader::chunk_data(size_t i) const {
+    return map_ + header_->header_size + i * static_cast<uint64_t>(header_->chunk_size);
+}
+
+CaptureCursor CaptureReader::seek(uint64_t time_ns) const {
+    // last_ns parçalar boyunca artan sırada: o anı içeren veya sonraki ilk parça
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), time_ns,
+                               [](const CaptureIndexEntry& entry, uint64_t t) { return entry.last_ns < t; });
+    CaptureCursor cursor;
+    cursor.chunk = static_cast<size_t>(it - entries_.begin());
+    return cursor;
+}
+
+bool CaptureReader::next(CaptureCursor* cursor, CaptureRecord* record) const {
+    while (cursor->chunk < entries_.size()) {
+        const char* base = chunk_data(cursor->chunk);
+        size_t used = entries_[cursor->chunk].used;
+        if (cursor->offset == 0) cursor->offset = sizeof(CaptureChunkHeader);
+        if (cursor->offset + sizeof(CaptureRecordHeader) > used) {
+            cursor->chunk++;
+            cursor->offset = 0;
+            continue;
+        }
+
+        CaptureRecordHeader header;
+        memcpy(&header, base + cursor->offset, sizeof(header));
+        size_t end = cursor->offset + sizeof(CaptureRecordHeader) + align8(header.length);
+        if (end > used || header.direction > 1) {
+            // Bozuk kayıt: parçanın kalanı atlanır
+            cursor->chunk++;
+            cursor->offset = 0;
+            continue;
+        }
+
+        record->direction = header.direction;
+        record->flags = header.flags;
+        record->time_ns = header.time_ns;
+        record->length = header.length;
+        record->data = base + cursor->offset + sizeof(CaptureRecordHeader);
+        cursor->offset = end;
+        return true;
+    }
+    return false;
+}
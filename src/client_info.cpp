@@ -0,0 +1,103 @@
+#include "client_info.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+
+#include "metrics.h"
+#include "mux_link.h"
+#include "tunnel_session.h"
+
+void (*output_pending_hook)(ClientInfo& client) = nullptr;
+
+static const char* const CLIENT_STATUS_NAMES[] = {
+    "Idle", "Connecting", "Connected", "VncReady", "VncTunnelling", "Resuming", "Broadcasting", "Watching", "Direct",
+};
+
+const char* client_status_name(ClientStatus status) {
+    return CLIENT_STATUS_NAMES[(size_t)status];
+}
+
+bool parse_client_status(const std::string& name, ClientStatus* status) {
+    for (size_t i = 0; i < sizeof(CLIENT_STATUS_NAMES) / sizeof(CLIENT_STATUS_NAMES[0]); ++i) {
+        if (name == CLIENT_STATUS_NAMES[i]) {
+            *status = (ClientStatus)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool flush_output(ClientInfo& client) {
+    auto& out = client.output_buffer;
+    size_t offset = 0;
+    while (offset < out.size()) {
+        ssize_t n = ::send(client.socket_fd, out.data() + offset, out.size() - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            offset += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break; // Kalan veri soket yazılabilir olduğunda gönderilecek
+        } else {
+            out.erase(out.begin(), out.begin() + offset);
+            return false;
+        }
+    }
+    out.erase(out.begin(), out.begin() + offset);
+    return true;
+}
+
+bool queue_send(ClientInfo& client, const char* data, size_t len) {
+    if (client.socket_fd <= 0) return false;
+    size_t offset = 0;
+    if (client.output_buffer.empty()) {
+        while (offset < len) {
+            ssize_t n = ::send(client.socket_fd, data + offset, len - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) {
+                offset += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                return false;
+            }
+        }
+    }
+    if (offset < len) {
+        client.output_buffer.insert(client.output_buffer.end(), data + offset, data + len);
+        if (output_pending_hook) output_pending_hook(client);
+    }
+    return true;
+}
+
+// Kontrol akışının baytlarını gönderir; çoğullanmış bağlantıda kanal 0 çerçevesine sarar
+static bool send_control_bytes(ClientInfo& client, const char* data, size_t len) {
+    if (!client.mux) return queue_send(client, data, len);
+    std::string frames;
+    append_mux_frames(&frames, MUX_CHANNEL_CONTROL, MUX_DATA, data, len);
+    if (client.session) return client.session->send_urgent(client, frames.data(), frames.size());
+    return queue_send(client, frames.data(), frames.size());
+}
+
+bool send_message(ClientInfo& client, const std::string& message) {
+    std::string full_message = message + "\n";
+    return send_control_bytes(client, full_message.data(), full_message.size());
+}
+
+bool send_control(ClientInfo& client, ControlType type, const std::string& payload) {
+    if (type == CTRL_ERROR) relay_metrics.control_errors.fetch_add(1, std::memory_order_relaxed);
+    if (!client.binary_protocol) {
+        std::string text = control_type_text(type);
+        return send_message(client, payload.empty() ? text : text + " " + payload);
+    }
+    char frame[CONTROL_HEADER_SIZE + CONTROL_MAX_PAYLOAD];
+    size_t length = encode_control_frame(type, payload.data(), std::min(payload.size(), CONTROL_MAX_PAYLOAD),
+                                         frame, sizeof(frame));
+    return send_control_bytes(client, frame, length);
+}
+
+bool send_control(ClientInfo& client, ControlType type, ClientId id) {
+    return send_control(client, type, std::to_string(id));
+}
@@ -0,0 +1,203 @@
+#include "client_registry.h"
+
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include <sys/random.h>
+
+bool parse_client_id(std::string_view text, ClientId* id) {
+    if (text.size() != 6) return false;
+    ClientId value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    if (value < CLIENT_ID_MIN || value > CLIENT_ID_MAX) return false;
+    *id = value;
+    return true;
+}
+
+ClientRegistry::ClientRegistry()
+    : free_count_(ID_SPACE), partition_index_(0), partition_count_(1), partition_base_(0), random_left_(0), slot_limit_(0), count_(0) {
+    // calloc büyük bloklarda sıfırlanmış sayfaları tembel (ilk dokunuşta) eşler; kullanılmayan
+    // ID aralığı fiziksel bellek tüketmez
+    free_ids_ = static_cast<uint32_t*>(calloc(ID_SPACE, sizeof(uint32_t)));
+    slot_by_id_ = static_cast<uint32_t*>(calloc(ID_SPACE, sizeof(uint32_t)));
+    if (!free_ids_ || !slot_by_id_) {
+        free(free_ids_);
+        free(slot_by_id_);
+        throw std::bad_alloc();
+    }
+}
+
+ClientRegistry::~ClientRegistry() {
+    free(free_ids_);
+    free(slot_by_id_);
+}
+
+// Bölüm k, ID indekslerinin [k * ID_SPACE / count, (k + 1) * ID_SPACE / count) aralığıdır
+void ClientRegistry::set_partition(uint32_t index, uint32_t count) {
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    partition_index_ = index;
+    partition_count_ = count;
+    partition_base_ = (uint32_t)((uint64_t)index * ID_SPACE / count);
+    free_count_ = (size_t)((uint64_t)(index + 1) * ID_SPACE / count) - partition_base_;
+}
+
+uint32_t ClientRegistry::partition_of(ClientId id) const {
+    uint64_t index = id - CLIENT_ID_MIN;
+    return (uint32_t)(((index + 1) * partition_count_ + ID_SPACE - 1) / ID_SPACE - 1);
+}
+
+// Karıştırılmış boş ID listesinin position'daki elemanı. Dokunulmamış konumlar sıfırdır ve
+// bölüm başından itibaren kendi indekslerini temsil eder; böylece liste ilk kullanımda doldurulmaz.
+uint32_t ClientRegistry::free_id_at(size_t position) const {
+    uint32_t value = free_ids_[position];
+    return value == 0 ? partition_base_ + (uint32_t)position : value - 1;
+}
+
+// Çekirdeğin CSPRNG'sinden 64'lük gruplar halinde rastgele sayı (bağlantı başına sistem çağrısı yok)
+uint32_t ClientRegistry::next_random() {
+    if (random_left_ == 0) {
+        ssize_t n = ::getrandom(random_pool_, sizeof(random_pool_), GRND_NONBLOCK);
+        if (n != (ssize_t)sizeof(random_pool_)) {
+            // Açılışta entropi havuzu henüz hazır değilse
+            static thread_local std::mt19937 gen(std::random_device{}());
+            for (uint32_t& value : random_pool_) value = gen();
+        }
+        random_left_ = sizeof(random_pool_) / sizeof(random_pool_[0]);
+    }
+    return random_pool_[--random_left_];
+}
+
+bool ClientRegistry::allocate(ClientId* id, uint32_t* slot_index) {
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    if (free_count_ == 0) return false;
+
+    // Boş ID'ler arasından düzgün dağılımlı seçim; seçilen konuma listenin son elemanı taşınır
+    size_t position = (size_t)(((uint64_t)next_random() * free_count_) >> 32);
+    uint32_t index = free_id_at(position);
+    free_ids_[position] = free_id_at(free_count_ - 1) + 1;
+    --free_count_;
+    *id = CLIENT_ID_MIN + index;
+    *slot_index = allocate_slot();
+    return true;
+}
+
+// alloc_mutex_ tutulurken çağrılır. En son boşalan slot önce kullanılır; tablo yoğun ve önbellekte
+// sıcak kalır.
+uint32_t ClientRegistry::allocate_slot() {
+    if (!free_slots_.empty()) {
+        uint32_t slot_index = free_slots_.back();
+        free_slots_.pop_back();
+        return slot_index;
+    }
+    uint32_t next = slot_limit_.load(std::memory_order_relaxed);
+    if (!blocks_[next / SLOTS_PER_BLOCK]) blocks_[next / SLOTS_PER_BLOCK].reset(new Block());
+    slot_limit_.store(next + 1, std::memory_order_release);
+    return next;
+}
+
+void ClientRegistry::release(ClientId id, uint32_t slot_index) {
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    // Başka bölümün ID'leri (register_remote) boş listeye dönmez
+    if (partition_of(id) == partition_index_) free_ids_[free_count_++] = (id - CLIENT_ID_MIN) + 1;
+    free_slots_.push_back(slot_index);
+}
+
+ClientId ClientRegistry::register_client(const std::shared_ptr<ClientInfo>& client) {
+    ClientId id;
+    uint32_t slot_index;
+    if (!allocate(&id, &slot_index)) return NO_CLIENT;
+
+    client->id = id;
+    std::lock_guard<std::mutex> lock(stripe_for(id));
+    slot(slot_index) = client;
+    slot_by_id_[id - CLIENT_ID_MIN] = slot_index + 1;
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+bool ClientRegistry::register_remote(ClientId id, const std::shared_ptr<ClientInfo>& client) {
+    if (id < CLIENT_ID_MIN || id > CLIENT_ID_MAX || partition_of(id) == partition_index_) return false;
+    uint32_t slot_index;
+    {
+        std::lock_guard<std::mutex> lock(alloc_mutex_);
+        slot_index = allocate_slot();
+    }
+    {
+        std::lock_guard<std::mutex> lock(stripe_for(id));
+        if (slot_by_id_[id - CLIENT_ID_MIN] == 0) {
+            client->id = id;
+            slot(slot_index) = client;
+            slot_by_id_[id - CLIENT_ID_MIN] = slot_index + 1;
+            count_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    free_slots_.push_back(slot_index);
+    return false;
+}
+
+void ClientRegistry::adopt(std::vector<std::shared_ptr<ClientInfo>>& clients) {
+    std::lock_guard<std::mutex> alloc_lock(alloc_mutex_);
+    size_t partition_size = free_count_;
+    size_t kept = 0;
+    for (auto& client : clients) {
+        ClientId id = client->id;
+        if (id < CLIENT_ID_MIN || id > CLIENT_ID_MAX || partition_of(id) != partition_index_) continue;
+        std::lock_guard<std::mutex> lock(stripe_for(id));
+        if (slot_by_id_[id - CLIENT_ID_MIN] != 0) continue;
+        uint32_t slot_index = allocate_slot();
+        slot(slot_index) = client;
+        slot_by_id_[id - CLIENT_ID_MIN] = slot_index + 1;
+        count_.fetch_add(1, std::memory_order_relaxed);
+        clients[kept++] = client;
+    }
+    clients.resize(kept);
+    if (kept == 0) return;
+
+    // Liste henüz dokunulmamıştır (her konum kendi indeksi); kayıtlı olmayan indeksler sıkıştırılır.
+    // Ayırma zaten rastgele konum seçtiğinden listenin yeniden karıştırılması gerekmez.
+    free_count_ = 0;
+    for (size_t position = 0; position < partition_size; ++position) {
+        uint32_t index = partition_base_ + (uint32_t)position;
+        if (slot_by_id_[index] == 0) free_ids_[free_count_++] = index + 1;
+    }
+}
+
+std::shared_ptr<ClientInfo> ClientRegistry::find(ClientId id) const {
+    if (id < CLIENT_ID_MIN || id > CLIENT_ID_MAX) return nullptr;
+    std::lock_guard<std::mutex> lock(stripe_for(id));
+    uint32_t entry = slot_by_id_[id - CLIENT_ID_MIN];
+    return entry == 0 ? nullptr : slot(entry - 1);
+}
+
+std::shared_ptr<ClientInfo> ClientRegistry::remove(ClientId id) {
+    if (id < CLIENT_ID_MIN || id > CLIENT_ID_MAX) return nullptr;
+    uint32_t slot_index;
+    std::shared_ptr<ClientInfo> client; // Kilit dışında çağırana verilir
+    {
+        std::lock_guard<std::mutex> lock(stripe_for(id));
+        uint32_t entry = slot_by_id_[id - CLIENT_ID_MIN];
+        if (entry == 0) return nullptr;
+        slot_index = entry - 1;
+        slot_by_id_[id - CLIENT_ID_MIN] = 0;
+        client.swap(slot(slot_index));
+    }
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    release(id, slot_index);
+    return client;
+}
+
+void ClientRegistry::for_each(const std::function<void(const ClientInfo&)>& fn) const {
+    std::unique_lock<std::mutex> locks[LOCK_STRIPES];
+    for (size_t i = 0; i < LOCK_STRIPES; ++i) locks[i] = std::unique_lock<std::mutex>(stripes_[i]);
+    uint32_t limit = slot_limit_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < limit; ++i) {
+        const std::shared_ptr<ClientInfo>& client = slot(i);
+        if (client) fn(*client);
+    }
+}
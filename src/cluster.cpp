@@ -0,0 +1,600 @@
+#include "cluster.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "client_registry.h"
+#include "control_protocol.h"
+#include "logger.h"
+#include "metrics.h"
+
+enum LinkFrame : uint8_t {
+    LINK_HELLO = 1,
+    LINK_OPEN = 2,
+    LINK_DATA = 3,
+    LINK_CLOSE = 4,
+    LINK_WINDOW = 5
+};
+
+static const size_t LINK_HEADER_SIZE = 9;
+static const size_t LINK_MAX_FRAME = 1024 * 1024;
+static const size_t CHANNEL_READ_CHUNK = 64 * 1024;
+static const size_t MAX_CLUSTER_NODES = 64;
+static const uint32_t LINK_EVENTS = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+
+static void put_u32(char* out, uint32_t value) {
+    out[0] = (char)(value >> 24);
+    out[1] = (char)(value >> 16);
+    out[2] = (char)(value >> 8);
+    out[3] = (char)value;
+}
+
+static uint32_t get_u32(const char* in) {
+    return ((uint32_t)(uint8_t)in[0] << 24) | ((uint32_t)(uint8_t)in[1] << 16) |
+           ((uint32_t)(uint8_t)in[2] << 8) | (uint32_t)(uint8_t)in[3];
+}
+
+bool parse_cluster_peers(const std::string& text, std::vector<ClusterPeer>* peers) {
+    peers->clear();
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t colon = item.rfind(':');
+        struct in_addr addr;
+        if (colon == std::string::npos || ::inet_pton(AF_INET, item.substr(0, colon).c_str(), &addr) != 1) {
+            return false;
+        }
+        const std::string port = item.substr(colon + 1);
+        if (port.empty() || port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoi(port) == 0 || std::stoi(port) > 65535) {
+            return false;
+        }
+        ClusterPeer peer;
+        peer.host = item.substr(0, colon);
+        peer.port = std::stoi(port);
+        peers->push_back(peer);
+    }
+    return !peers->empty() && peers->size() <= MAX_CLUSTER_NODES;
+}
+
+Cluster::Cluster(EventLoop& loop, int node, std::vector<ClusterPeer> peers, ProxyFactory create_proxy)
+    : loop_(loop), node_(node), peers_(std::move(peers)), create_proxy_(std::move(create_proxy)),
+      listen_fd_(-1), timer_fd_(-1), links_by_node_(peers_.size(), nullptr) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) throw std::system_error(errno, std::generic_category(), "socket");
+    int opt = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(peers_[node_].port);
+    if (::bind(listen_fd_, (struct sockaddr*)&address, sizeof(address)) < 0 || ::listen(listen_fd_, 64) < 0) {
+        int err = errno;
+        ::close(listen_fd_);
+        throw std::system_error(err, std::generic_category(), "bind/listen");
+    }
+
+    // Eksik bağlantılar saniyede bir yeniden denenir
+    timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0) {
+        int err = errno;
+        ::close(listen_fd_);
+        throw std::system_error(err, std::generic_category(), "timerfd_create");
+    }
+    struct itimerspec interval = {};
+    interval.it_value.tv_sec = 1;
+    interval.it_interval.tv_sec = 1;
+    ::timerfd_settime(timer_fd_, 0, &interval, nullptr);
+
+    if (!loop_.add(listen_fd_, EPOLLIN, [this](uint32_t) { accept_links(); }) ||
+        !loop_.add(timer_fd_, EPOLLIN, [this](uint32_t) {
+            uint64_t expirations;
+            while (::read(timer_fd_, &expirations, sizeof(expirations)) > 0) {}
+            dial_missing();
+        })) {
+        int err = errno;
+        loop_.remove(listen_fd_);
+        ::close(listen_fd_);
+        ::close(timer_fd_);
+        throw std::system_error(err, std::generic_category(), "epoll_ctl");
+    }
+    dial_missing();
+}
+
+Cluster::~Cluster() {
+    while (!links_.empty()) close_link(links_.begin()->second.get());
+    loop_.remove(listen_fd_);
+    loop_.remove(timer_fd_);
+    ::close(listen_fd_);
+    ::close(timer_fd_);
+}
+
+// Dinleyen soket seviye tetiklemeli; bağlanan düğüm HELLO gönderene kadar kimliği bilinmez
+void Cluster::accept_links() {
+    while (true) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_RATE_LIMITED(LOG_WARN, 5) << "Küme: Bağlantı kabul hatası: " << strerror(errno);
+            }
+            return;
+        }
+        add_link(fd, -1, true);
+    }
+}
+
+// Bağlantılar indeksi büyük düğümden küçüğe kurulur; iki düğüm aynı anda birbirine bağlanmaz
+void Cluster::dial_missing() {
+    for (int peer = 0; peer < node_; ++peer) {
+        if (links_by_node_[peer]) continue;
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return;
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(peers_[peer].port);
+        ::inet_pton(AF_INET, peers_[peer].host.c_str(), &address.sin_addr);
+        int result = ::connect(fd, (struct sockaddr*)&address, sizeof(address));
+        if (result < 0 && errno != EINPROGRESS) {
+            ::close(fd);
+            continue;
+        }
+        add_link(fd, peer, result == 0);
+        if (!links_by_node_[peer]) continue;
+        std::string hello = std::to_string(node_) + " " + std::to_string(peers_.size());
+        send_frame(links_by_node_[peer], LINK_HELLO, 0, hello.data(), hello.size());
+    }
+}
+
+void Cluster::add_link(int fd, int node, bool connected) {
+    int opt = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)); // Etkileşimli trafik beklemesin
+    std::unique_ptr<Link> link(new Link());
+    link->fd = fd;
+    link->node = node;
+    link->connected = connected;
+    link->next_channel = node >= 0 ? 1 : 2; // Bağlanan taraf tek, kabul eden çift kanal numaraları kullanır
+    if (!loop_.add(fd, LINK_EVENTS, [this, fd](uint32_t events) {
+            auto it = links_.find(fd);
+            if (it != links_.end()) on_link_event(it->second.get(), events);
+        })) {
+        ::close(fd);
+        return;
+    }
+    if (node >= 0) links_by_node_[node] = link.get();
+    if (node >= 0 && connected) {
+        relay_metrics.cluster_links.fetch_add(1, std::memory_order_relaxed);
+        LOG(LOG_INFO) << "Küme: Düğüm " << node << " bağlantısı kuruldu.";
+    }
+    links_[fd] = std::move(link);
+}
+
+void Cluster::on_link_event(Link* link, uint32_t events) {
+    if (!link->connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        ::getsockopt(link->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            LOG_RATE_LIMITED(LOG_DEBUG, 5) << "Küme: Düğüm " << link->node << " bağlanamadı: " << strerror(error);
+            close_link(link);
+            return;
+        }
+        link->connected = true;
+        relay_metrics.cluster_links.fetch_add(1, std::memory_order_relaxed);
+        LOG(LOG_INFO) << "Küme: Düğüm " << link->node << " bağlantısı kuruldu.";
+    }
+    if (events & EPOLLERR) {
+        close_link(link);
+        return;
+    }
+    if (events & EPOLLOUT) {
+        if (!flush_link(link)) {
+            close_link(link);
+            return;
+        }
+        // Çıkış tamponu boşaldı; durdurulan kanallar yeniden okunur
+        if (link->throttled && link->out.size() - link->out_offset <= LINK_LOW_WATER) {
+            link->throttled = false;
+            std::vector<uint32_t> ids;
+            for (auto& entry : link->channels) ids.push_back(entry.first);
+            for (uint32_t id : ids) {
+                auto it = link->channels.find(id);
+                if (it != link->channels.end()) pump_channel(it->second.get());
+                if (link->throttled) break;
+            }
+        }
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        if (!read_link(link)) close_link(link);
+    }
+}
+
+bool Cluster::read_link(Link* link) {
+    char buffer[64 * 1024];
+    while (true) {
+        ssize_t n = ::read(link->fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) return false;
+        link->in.insert(link->in.end(), buffer, buffer + n);
+
+        size_t offset = 0;
+        while (link->in.size() - offset >= LINK_HEADER_SIZE) {
+            const char* header = link->in.data() + offset;
+            uint32_t length = get_u32(header + 5);
+            if (length > LINK_MAX_FRAME) {
+                LOG(LOG_WARN) << "Küme: Düğüm " << link->node << " geçersiz çerçeve gönderdi; bağlantı kapatılıyor.";
+                return false;
+            }
+            if (link->in.size() - offset < LINK_HEADER_SIZE + length) break;
+            // Çerçeve işlenirken kanala yazılan veri tampona kopyalanır; in değişmez
+            if (!handle_frame(link, (uint8_t)header[0], get_u32(header + 1), header + LINK_HEADER_SIZE, length)) {
+                return false;
+            }
+            offset += LINK_HEADER_SIZE + length;
+        }
+        link->in.erase(link->in.begin(), link->in.begin() + offset);
+    }
+}
+
+bool Cluster::flush_link(Link* link) {
+    while (link->out_offset < link->out.size()) {
+        ssize_t n = ::send(link->fd, link->out.data() + link->out_offset, link->out.size() - link->out_offset,
+                           MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            link->out_offset += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    if (link->out_offset == link->out.size()) {
+        link->out.clear();
+        link->out_offset = 0;
+    } else if (link->out_offset >= CHANNEL_READ_CHUNK && link->out_offset * 2 >= link->out.size()) {
+        link->out.erase(link->out.begin(), link->out.begin() + link->out_offset);
+        link->out_offset = 0;
+    }
+    return true;
+}
+
+// Bağlantı koparsa üzerindeki tüm kanallar kapanır; proxy'ler EOF görür ve yerel uçlar
+// PEER_DISCONNECTED alır
+void Cluster::close_link(Link* link) {
+    int fd = link->fd;
+    if (link->node >= 0 && link->connected) {
+        relay_metrics.cluster_links.fetch_sub(1, std::memory_order_relaxed);
+        LOG(LOG_WARN) << "Küme: Düğüm " << link->node << " bağlantısı koptu (" << link->channels.size()
+                      << " kanal kapatılıyor).";
+    }
+    for (auto& entry : link->channels) {
+        loop_.remove(entry.second->fd);
+        ::close(entry.second->fd);
+    }
+    link->channels.clear();
+    if (link->node >= 0 && links_by_node_[link->node] == link) links_by_node_[link->node] = nullptr;
+    loop_.remove(fd);
+    ::close(fd);
+    links_.erase(fd);
+}
+
+/**
+ * @brief Bağlantıdan gelen tek bir çerçeveyi işler.
+ * @return Bağlantı protokole uymuyorsa false (çağıran bağlantıyı kapatır).
+ */
+bool Cluster::handle_frame(Link* link, uint8_t type, uint32_t id, const char* payload, size_t length) {
+    if (type == LINK_HELLO) {
+        int peer = -1;
+        size_t size = 0;
+        std::istringstream fields(std::string(payload, length));
+        fields >> peer >> size;
+        if (!fields || size != peers_.size() || peer < 0 || peer >= (int)peers_.size() || peer == node_) {
+            LOG(LOG_WARN) << "Küme: Geçersiz HELLO (" << std::string(payload, length) << "); düğüm listeleri aynı olmalı.";
+            return false;
+        }
+        if (link->node >= 0) return peer == link->node; // Bağlanan taraf: karşı düğümün yanıtı
+        if (peer < node_) return false;                  // Küçük indeksli düğüm bağlanmaz
+        if (links_by_node_[peer]) close_link(links_by_node_[peer]); // Eski bağlantı yarı açık kalmış
+        link->node = peer;
+        links_by_node_[peer] = link;
+        relay_metrics.cluster_links.fetch_add(1, std::memory_order_relaxed);
+        LOG(LOG_INFO) << "Küme: Düğüm " << peer << " bağlandı.";
+        std::string hello = std::to_string(node_) + " " + std::to_string(peers_.size());
+        send_frame(link, LINK_HELLO, 0, hello.data(), hello.size());
+        return true;
+    }
+    if (link->node < 0) return false; // HELLO'dan önce başka çerçeve gelmez
+
+    auto it = link->channels.find(id);
+    Channel* channel = it == link->channels.end() ? nullptr : it->second.get();
+    if (type == LINK_OPEN) {
+        ClientId proxy_id = NO_CLIENT;
+        ClientId target_id = NO_CLIENT;
+        std::string requester, target;
+        std::istringstream fields(std::string(payload, length));
+        fields >> requester >> target;
+        if (channel || !parse_client_id(requester, &proxy_id) || !parse_client_id(target, &target_id)) return false;
+
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0) {
+            std::string reason = "Kanal açılamadı: " + std::string(strerror(errno));
+            send_frame(link, LINK_CLOSE, id, reason.data(), reason.size());
+            return true;
+        }
+        if (!create_proxy_(fds[0], proxy_id, link->node)) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            static const std::string reason = "ID bu relay'de kullanımda";
+            send_frame(link, LINK_CLOSE, id, reason.data(), reason.size());
+            return true;
+        }
+        channel = attach_channel(link, id, fds[1], proxy_id, target_id);
+        if (!channel) {
+            send_frame(link, LINK_CLOSE, id, nullptr, 0);
+            return true;
+        }
+        LOG(LOG_DEBUG) << "Küme: Düğüm " << link->node << " kanal " << id << " açtı (ID " << proxy_id << " -> ID "
+                       << target_id << ")";
+        pump_channel(channel);
+        return true;
+    }
+    if (type == LINK_DATA) {
+        // Kapanmış kanala yolda olan veri atılır
+        if (!channel || channel->closing) return true;
+        channel->pending.insert(channel->pending.end(), payload, payload + length);
+        if (!write_channel(channel)) close_channel(channel, "", true);
+        return true;
+    }
+    if (type == LINK_CLOSE) {
+        if (!channel) return true;
+        channel->closing = true;
+        channel->close_reason.assign(payload, length);
+        if (!channel->close_reason.empty()) {
+            LOG(LOG_INFO) << "Küme: ID " << channel->remote_id << " kanalı düğüm " << link->node
+                          << " tarafından kapatıldı: " << channel->close_reason;
+        }
+        if (channel->pending.empty()) close_channel(channel, "", false);
+        return true;
+    }
+    if (type == LINK_WINDOW) {
+        if (length != 4) return false;
+        if (!channel) return true;
+        bool blocked = channel->send_credit <= 0;
+        channel->send_credit += get_u32(payload);
+        if (blocked && channel->send_credit > 0) pump_channel(channel);
+        return true;
+    }
+    return false;
+}
+
+void Cluster::send_frame(Link* link, uint8_t type, uint32_t channel, const char* payload, size_t length) {
+    bool idle = link->out_offset == link->out.size();
+    char header[LINK_HEADER_SIZE];
+    header[0] = (char)type;
+    put_u32(header + 1, channel);
+    put_u32(header + 5, (uint32_t)length);
+    link->out.insert(link->out.end(), header, header + LINK_HEADER_SIZE);
+    if (length > 0) link->out.insert(link->out.end(), payload, payload + length);
+    // Hata olursa olay döngüsü EPOLLERR/EOF ile bildirir; bağlantı orada kapatılır
+    if (idle && link->connected) flush_link(link);
+    if (link->out.size() - link->out_offset > LINK_HIGH_WATER) link->throttled = true;
+}
+
+void Cluster::send_window(Channel* channel) {
+    char credit[4];
+    put_u32(credit, (uint32_t)channel->unacked);
+    channel->unacked = 0;
+    send_frame(channel->link, LINK_WINDOW, channel->id, credit, sizeof(credit));
+}
+
+Cluster::Channel* Cluster::attach_channel(Link* link, uint32_t id, int fd, ClientId proxy_id, ClientId remote_id) {
+    int link_fd = link->fd;
+    if (!loop_.add(fd, LINK_EVENTS, [this, link_fd, id](uint32_t events) {
+            auto it = links_.find(link_fd);
+            if (it != links_.end()) on_channel_event(it->second.get(), id, events);
+        })) {
+        ::close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<Channel> channel(new Channel());
+    channel->id = id;
+    channel->link = link;
+    channel->fd = fd;
+    channel->proxy_id = proxy_id;
+    channel->remote_id = remote_id;
+    Channel* result = channel.get();
+    link->channels[id] = std::move(channel);
+    relay_metrics.cluster_channels.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+void Cluster::open_channel(int node, int fd, ClientId local_id, ClientId remote_id) {
+    loop_.post([this, node, fd, local_id, remote_id]() {
+        Link* link = node >= 0 && node < (int)peers_.size() ? links_by_node_[node] : nullptr;
+        if (!link) {
+            LOG_RATE_LIMITED(LOG_WARN, 5) << "Küme: Düğüm " << node << " bağlantısı yok; ID " << remote_id
+                                          << "'e bağlanılamıyor.";
+            ::close(fd);
+            return;
+        }
+        uint32_t id = link->next_channel;
+        link->next_channel += 2;
+        Channel* channel = attach_channel(link, id, fd, remote_id, local_id);
+        if (!channel) return;
+        std::string payload = std::to_string(local_id) + " " + std::to_string(remote_id);
+        send_frame(link, LINK_OPEN, id, payload.data(), payload.size());
+        pump_channel(channel);
+    });
+}
+
+bool Cluster::connect_remote(int node, ClientId local_id, ClientId remote_id) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0) {
+        LOG_RATE_LIMITED(LOG_WARN, 5) << "Küme kanalı için socketpair açılamadı: " << strerror(errno);
+        return false;
+    }
+    if (!create_proxy_(fds[0], remote_id, node)) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    open_channel(node, fds[1], local_id, remote_id);
+    return true;
+}
+
+void Cluster::on_channel_event(Link* link, uint32_t id, uint32_t events) {
+    auto it = link->channels.find(id);
+    if (it == link->channels.end()) return;
+    Channel* channel = it->second.get();
+    if (events & EPOLLOUT) {
+        if (!write_channel(channel)) {
+            close_channel(channel, "", true);
+            return;
+        }
+        if (channel->closing && channel->pending.empty()) {
+            close_channel(channel, "", false);
+            return;
+        }
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) pump_channel(channel);
+}
+
+// Proxy'nin relay'den aldığını (kontrol çerçeveleri, tünelde ham veri) karşı düğüme aktarır.
+// Ham veride kredi veya bağlantı tamponu biterse okuma durur; kredi/boşalma ile yeniden çağrılır.
+void Cluster::pump_channel(Channel* channel) {
+    Link* link = channel->link;
+    char buffer[CHANNEL_READ_CHUNK];
+    while (!channel->closing && !link->throttled) {
+        size_t want = sizeof(buffer);
+        if (channel->raw) {
+            if (channel->send_credit <= 0) return;
+            want = std::min(want, (size_t)channel->send_credit);
+        }
+        ssize_t n = ::read(channel->fd, buffer, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            // Proxy relay'de kapatıldı (yerel uç ayrıldı veya oturum bitti)
+            close_channel(channel, channel->close_reason, true);
+            return;
+        }
+        if (channel->raw) {
+            send_frame(link, LINK_DATA, channel->id, buffer, n);
+            channel->send_credit -= n;
+            continue;
+        }
+        channel->control.insert(channel->control.end(), buffer, buffer + n);
+        if (!translate_control(channel)) return;
+    }
+}
+
+/**
+ * @brief Relay'in proxy'ye gönderdiği kontrol çerçevelerini karşı proxy'nin komutlarına çevirir.
+ * @return Kanal kapatıldıysa false.
+ */
+bool Cluster::translate_control(Channel* channel) {
+    auto& buffer = channel->control;
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        ControlFrame frame;
+        ssize_t used = parse_control_frame(buffer.data() + offset, buffer.size() - offset, &frame);
+        if (used == 0) break;
+        if (used < 0) {
+            close_channel(channel, "Geçersiz kontrol çerçevesi", true);
+            return false;
+        }
+        offset += used;
+        const std::string self = std::to_string(channel->proxy_id);
+        switch (frame.type) {
+        case CTRL_INCOMING:
+            send_command(channel, CTRL_CONNECT, self);
+            break;
+        case CTRL_ACCEPTED:
+            send_command(channel, CTRL_ACCEPT, self);
+            break;
+        case CTRL_START_VNC_TUNNEL:
+        case CTRL_TUNNEL_ACTIVE:
+            if (!channel->start_sent) send_command(channel, CTRL_START_VNC_TUNNEL, "");
+            channel->start_sent = true;
+            if (frame.type == CTRL_TUNNEL_ACTIVE) {
+                // Tünel açıldı; aynı okumada gelen kalan byte'lar ham veridir
+                channel->raw = true;
+                if (offset < buffer.size()) {
+                    send_frame(channel->link, LINK_DATA, channel->id, buffer.data() + offset, buffer.size() - offset);
+                    channel->send_credit -= (int64_t)(buffer.size() - offset);
+                }
+                buffer.clear();
+                buffer.shrink_to_fit();
+                return true;
+            }
+            break;
+        case CTRL_ERROR:
+            close_channel(channel, std::string(frame.payload, frame.length), true);
+            return false;
+        case CTRL_PEER_DISCONNECTED:
+            close_channel(channel, "", true);
+            return false;
+        default:
+            break; // CONNECTING, CONNECTION_ESTABLISHED... yalnızca yerel uca anlamlı
+        }
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+    return true;
+}
+
+void Cluster::send_command(Channel* channel, ControlType type, const std::string& argument) {
+    char frame[CONTROL_HEADER_SIZE + CONTROL_MAX_PAYLOAD];
+    size_t length = encode_control_frame(type, argument.data(), argument.size(), frame, sizeof(frame));
+    send_frame(channel->link, LINK_DATA, channel->id, frame, length);
+    channel->send_credit -= (int64_t)length;
+}
+
+// Karşı düğümden gelen veriyi proxy'ye yazar; yazılan byte'lar kredi olarak geri bildirilir
+bool Cluster::write_channel(Channel* channel) {
+    size_t offset = 0;
+    auto& pending = channel->pending;
+    while (offset < pending.size()) {
+        ssize_t n = ::send(channel->fd, pending.data() + offset, pending.size() - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            offset += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    pending.erase(pending.begin(), pending.begin() + offset);
+    channel->unacked += offset;
+    if (!channel->closing && channel->unacked >= CHANNEL_WINDOW / 4) send_window(channel);
+    return true;
+}
+
+void Cluster::close_channel(Channel* channel, const std::string& reason, bool notify) {
+    Link* link = channel->link;
+    uint32_t id = channel->id;
+    if (notify) send_frame(link, LINK_CLOSE, id, reason.data(), reason.size());
+    LOG(LOG_DEBUG) << "Küme: Düğüm " << link->node << " kanal " << id << " (ID " << channel->proxy_id
+                   << ") kapatıldı" << (reason.empty() ? "" : ": " + reason);
+    loop_.remove(channel->fd);
+    ::close(channel->fd);
+    link->channels.erase(id);
+}
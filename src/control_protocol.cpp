@@ -0,0 +1,100 @@
+#include "control_protocol.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+ssize_t parse_control_frame(const char* data, size_t len, ControlFrame* frame) {
+    if (len == 0) return 0;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    if (bytes[0] != CONTROL_MAGIC_V1) return -1;
+    if (len < CONTROL_HEADER_SIZE) return 0;
+
+    size_t length = ((size_t)bytes[2] << 8) | bytes[3];
+    if (length > CONTROL_MAX_PAYLOAD) return -1;
+    if (len < CONTROL_HEADER_SIZE + length) return 0;
+
+    frame->type = static_cast<ControlType>(bytes[1]);
+    frame->payload = data + CONTROL_HEADER_SIZE;
+    frame->length = length;
+    return (ssize_t)(CONTROL_HEADER_SIZE + length);
+}
+
+size_t encode_control_frame(ControlType type, const char* payload, size_t length, char* out, size_t out_size) {
+    if (length > CONTROL_MAX_PAYLOAD || out_size < CONTROL_HEADER_SIZE + length) return 0;
+    out[0] = (char)CONTROL_MAGIC_V1;
+    out[1] = (char)type;
+    out[2] = (char)(length >> 8);
+    out[3] = (char)(length & 0xff);
+    if (length > 0) memcpy(out + CONTROL_HEADER_SIZE, payload, length);
+    return CONTROL_HEADER_SIZE + length;
+}
+
+const char* control_type_text(ControlType type) {
+    switch (type) {
+        case CTRL_HELLO: return "hello";
+        case CTRL_CONNECT: return "connect";
+        case CTRL_ACCEPT: return "accept";
+        case CTRL_START_VNC_TUNNEL: return "start_vnc_tunnel";
+        case CTRL_BROADCAST: return "broadcast";
+        case CTRL_WATCH: return "watch";
+        case CTRL_RESUME: return "resume";
+        case CTRL_P2P: return "p2p";
+        case CTRL_P2P_RESULT: return "p2p_result";
+        case CTRL_PONG: return "pong";
+        case CTRL_MUX: return "mux";
+        case CTRL_DISCONNECT: return "disconnect";
+        case CTRL_ID: return "ID";
+        case CTRL_INCOMING: return "INCOMING";
+        case CTRL_CONNECTING: return "CONNECTING";
+        case CTRL_ACCEPTED: return "ACCEPTED";
+        case CTRL_CONNECTION_ESTABLISHED: return "CONNECTION_ESTABLISHED";
+        case CTRL_TUNNEL_ACTIVE: return "TUNNEL_ACTIVE";
+        case CTRL_PEER_DISCONNECTED: return "PEER_DISCONNECTED";
+        case CTRL_ERROR: return "ERROR";
+        case CTRL_RESUMED: return "RESUMED";
+        case CTRL_P2P_BIND: return "P2P_BIND";
+        case CTRL_P2P_CANDIDATES: return "P2P_CANDIDATES";
+        case CTRL_P2P_FALLBACK: return "P2P_FALLBACK";
+        case CTRL_PING: return "PING";
+        case CTRL_MUX_OK: return "MUX_OK";
+        case CTRL_DISCONNECTED_OK: return "DISCONNECTED_OK";
+        case CTRL_TUNNEL_OPTIONS: return "TUNNEL_OPTIONS";
+    }
+    return "UNKNOWN";
+}
+
+bool extract_text_line(std::vector<char>& buffer, std::string* line) {
+    // Tamponda tam bir komut (newline ile biten) var mı diye kontrol et
+    auto newline_it = std::find(buffer.begin(), buffer.end(), '\n');
+    if (newline_it == buffer.end()) return false;
+
+    // Komutu tampondan çıkar
+    line->assign(buffer.begin(), newline_it);
+    buffer.erase(buffer.begin(), newline_it + 1);
+
+    // Boşlukları temizle
+    line->erase(0, line->find_first_not_of(" \t\r\n"));
+    line->erase(line->find_last_not_of(" \t\r\n") + 1);
+    return true;
+}
+
+bool parse_text_command(const std::string& line, TextCommand* command, ControlType* type) {
+    std::stringstream ss(line);
+    command->verb.clear();
+    command->argument.clear();
+    ss >> command->verb >> std::ws;
+    std::getline(ss, command->argument);
+    std::transform(command->verb.begin(), command->verb.end(), command->verb.begin(), ::tolower);
+
+    // hello yalnızca ikili protokolde anlamlıdır
+    static const ControlType text_commands[] = { CTRL_CONNECT, CTRL_ACCEPT, CTRL_START_VNC_TUNNEL, CTRL_BROADCAST, CTRL_WATCH, CTRL_RESUME,
+                                                 CTRL_P2P, CTRL_P2P_RESULT, CTRL_PONG, CTRL_MUX, CTRL_DISCONNECT };
+    for (ControlType candidate : text_commands) {
+        if (command->verb == control_type_text(candidate)) {
+            *type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
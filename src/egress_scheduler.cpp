@@ -0,0 +1,201 @@
+#include "egress_scheduler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "metrics.h"
+
+static const uint64_t NS_PER_SEC = 1000000000ull;
+
+// Sırası gelen ama sınırlayıcı beklemesi olmayan akışlar için en kısa uyanma aralığı
+static const uint64_t MIN_WAKE_NS = 20000;
+
+// --- RateLimiter ---
+
+RateLimiter::RateLimiter(uint64_t rate, uint64_t burst) : rate_(rate), burst_ns_(0) {
+    burst_ns_ = cost_ns(burst);
+}
+
+uint64_t RateLimiter::cost_ns(size_t bytes) const {
+    return (uint64_t)((unsigned __int128)bytes * NS_PER_SEC / rate_);
+}
+
+size_t RateLimiter::available(uint64_t now_ns) const {
+    uint64_t base = std::max(tat_.load(std::memory_order_relaxed), now_ns);
+    if (base >= now_ns + burst_ns_) return 0;
+    return (size_t)((unsigned __int128)(now_ns + burst_ns_ - base) * rate_ / NS_PER_SEC);
+}
+
+void RateLimiter::consume(size_t bytes, uint64_t now_ns) {
+    uint64_t cost = cost_ns(bytes);
+    uint64_t tat = tat_.load(std::memory_order_relaxed);
+    while (!tat_.compare_exchange_weak(tat, std::max(tat, now_ns) + cost, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t RateLimiter::delay_ns(size_t bytes, uint64_t now_ns) const {
+    // burst'ten büyük istek hiçbir zaman tek seferde karşılanamaz; ilk parçası beklenir
+    uint64_t cost = std::min(cost_ns(bytes), burst_ns_);
+    uint64_t ready = std::max(tat_.load(std::memory_order_relaxed), now_ns) + cost;
+    return ready > now_ns + burst_ns_ ? ready - now_ns - burst_ns_ : 0;
+}
+
+// --- EgressLimits ---
+
+EgressLimits::EgressLimits(const SchedulerConfig& config) : config_(config) {
+    if (config_.egress_rate) global_.reset(new RateLimiter(config_.egress_rate, burst_for(config_.egress_rate)));
+}
+
+// En az bir quantum, yüksek hızlarda 10 ms'lik veri bekletmeden geçebilir
+uint64_t EgressLimits::burst_for(uint64_t rate) const {
+    return std::max<uint64_t>(config_.quantum, rate / 100);
+}
+
+std::shared_ptr<RateLimiter> EgressLimits::account(const std::string& key) {
+    if (!config_.account_rate) return nullptr;
+    std::lock_guard<std::mutex> lock(accounts_mutex_);
+    std::shared_ptr<RateLimiter> limiter = accounts_[key].lock();
+    if (!limiter) {
+        // Tüneli kalmayan hesapların kayıtları ara sıra süpürülür
+        if (accounts_.size() > 1024) {
+            for (auto it = accounts_.begin(); it != accounts_.end();) {
+                it = it->second.expired() && it->first != key ? accounts_.erase(it) : std::next(it);
+            }
+        }
+        limiter = std::make_shared<RateLimiter>(config_.account_rate, burst_for(config_.account_rate));
+        accounts_[key] = limiter;
+    }
+    return limiter;
+}
+
+std::shared_ptr<RateLimiter> EgressLimits::new_session() {
+    if (!config_.session_rate) return nullptr;
+    return std::make_shared<RateLimiter>(config_.session_rate, burst_for(config_.session_rate));
+}
+
+// --- EgressScheduler ---
+
+EgressScheduler::EgressScheduler(EgressLimits& limits, EventLoop* loop, uint64_t (*clock)())
+    : limits_(limits), config_(limits.config()), loop_(loop), clock_(clock ? clock : metrics_now_ns),
+      timer_fd_(-1), armed_ns_(0) {
+    if (!loop_ || !enabled()) return;
+    timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0) throw std::system_error(errno, std::generic_category(), "timerfd_create");
+    loop_->add(timer_fd_, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations;
+        while (::read(timer_fd_, &expirations, sizeof(expirations)) > 0) {
+        }
+        armed_ns_ = 0;
+        service();
+    });
+}
+
+EgressScheduler::~EgressScheduler() {
+    if (timer_fd_ >= 0) {
+        loop_->remove(timer_fd_);
+        ::close(timer_fd_);
+    }
+}
+
+size_t EgressScheduler::grant(EgressFlow& flow, size_t pending) {
+    if (!enabled() || pending <= config_.interactive_bytes) return pending; // Öncelik sınıfı
+    if (flow.queued) return 0;
+    uint64_t now = clock_();
+    // Çekişme varken sırası gelmeyen akış araya giremez
+    if (!flow.in_turn && !ring_.empty()) {
+        enqueue(flow, pending, now);
+        return 0;
+    }
+
+    // Sırasındaki akış hakkı kadar, çekişme yokken quantum kadar gönderir
+    size_t allowed = std::min(pending, flow.in_turn ? flow.deficit : config_.quantum);
+    if (flow.session) allowed = std::min(allowed, flow.session->available(now));
+    if (flow.account) allowed = std::min(allowed, flow.account->available(now));
+    if (limits_.global()) allowed = std::min(allowed, limits_.global()->available(now));
+    if (allowed == 0) enqueue(flow, pending, now);
+    return allowed;
+}
+
+void EgressScheduler::sent(EgressFlow& flow, size_t bytes) {
+    if (!enabled() || bytes == 0) return;
+    uint64_t now = clock_();
+    if (flow.session) flow.session->consume(bytes, now);
+    if (flow.account) flow.account->consume(bytes, now);
+    if (limits_.global()) limits_.global()->consume(bytes, now);
+    if (flow.in_turn) flow.deficit -= std::min(flow.deficit, bytes);
+}
+
+void EgressScheduler::enqueue(EgressFlow& flow, size_t pending, uint64_t now) {
+    size_t wanted = std::min(pending, std::max(flow.deficit, config_.quantum));
+    uint64_t delay = 0;
+    if (flow.session) delay = std::max(delay, flow.session->delay_ns(wanted, now));
+    if (flow.account) delay = std::max(delay, flow.account->delay_ns(wanted, now));
+    if (limits_.global()) delay = std::max(delay, limits_.global()->delay_ns(wanted, now));
+    flow.ready_ns = now + delay;
+    flow.queued = true;
+    ring_.push_back(&flow);
+    relay_metrics.egress_throttled.fetch_add(1, std::memory_order_relaxed);
+    arm_timer();
+}
+
+void EgressScheduler::remove(EgressFlow& flow) {
+    flow.in_turn = false;
+    flow.deficit = 0;
+    if (!flow.queued) return;
+    flow.queued = false;
+    ring_.erase(std::remove(ring_.begin(), ring_.end(), &flow), ring_.end());
+}
+
+void EgressScheduler::service() {
+    uint64_t now = clock_();
+    // Tur başındaki akışlar birer kez ele alınır; tur içinde yeniden sıraya girenler sona eklenir
+    for (size_t turns = ring_.size(); turns > 0 && !ring_.empty(); --turns) {
+        // Toplam sınır tükendiyse tur biter; baştaki akış sırasını korur
+        if (limits_.global() && limits_.global()->available(now) == 0) break;
+        EgressFlow* flow = ring_.front();
+        ring_.pop_front();
+        if (flow->ready_ns > now) {
+            ring_.push_back(flow); // Kendi sınırlayıcısı henüz izin vermiyor; sıradaki akışa geç
+            continue;
+        }
+        flow->queued = false;
+        flow->in_turn = true;
+        flow->deficit = std::min(flow->deficit + config_.quantum, 2 * config_.quantum);
+        flow->wake();
+        flow->in_turn = false;
+        if (!flow->queued) flow->deficit = 0; // Bekleyen verisi kalmadı (veya soketi dolu)
+    }
+    arm_timer();
+}
+
+uint64_t EgressScheduler::next_wake_ns() const {
+    if (ring_.empty()) return 0;
+    uint64_t next = 0;
+    for (const EgressFlow* flow : ring_) {
+        if (next == 0 || flow->ready_ns < next) next = flow->ready_ns;
+    }
+    // Toplam sınır tükendiyse bir quantum birikene kadar tur başlamaz; daha erken başlayan tur
+    // sıranın başındaki akışa yalnızca birikmiş kırıntıyı verir
+    if (limits_.global()) {
+        uint64_t now = clock_();
+        next = std::max(next, now + limits_.global()->delay_ns(config_.quantum, now));
+    }
+    return next;
+}
+
+void EgressScheduler::arm_timer() {
+    if (timer_fd_ < 0) return;
+    uint64_t when = ring_.empty() ? 0 : std::max(next_wake_ns(), clock_() + MIN_WAKE_NS);
+    if (when == armed_ns_) return;
+    armed_ns_ = when;
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = when / NS_PER_SEC;
+    spec.it_value.tv_nsec = when % NS_PER_SEC;
+    ::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
@@ -0,0 +1,131 @@
+#include "event_loop.h"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "logger.h"
+
+EventLoop::EventLoop() : epoll_fd_(-1), wake_fd_(-1), running_(false) {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1) {
+        throw std::system_error(errno, std::generic_category(), "epoll_create1");
+    }
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1 || !add(wake_fd_, EPOLLIN, [this](uint32_t) { run_posted_tasks(); })) {
+        int err = errno;
+        if (wake_fd_ != -1) ::close(wake_fd_);
+        ::close(epoll_fd_);
+        throw std::system_error(err, std::generic_category(), "eventfd");
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (wake_fd_ != -1) {
+        ::close(wake_fd_);
+    }
+    if (epoll_fd_ != -1) {
+        ::close(epoll_fd_);
+    }
+}
+
+// Olayın verisi: üst 32 bit kaydın kuşağı, alt 32 bit fd
+uint64_t EventLoop::make_event_data(int fd, uint32_t generation) {
+    return ((uint64_t)generation << 32) | (uint32_t)fd;
+}
+
+bool EventLoop::add(int fd, uint32_t events, Callback cb) {
+    if (fd < 0) return false;
+    if ((size_t)fd >= handlers_.size()) {
+        handlers_.resize(fd + 1);
+        generations_.resize(fd + 1, 0);
+    }
+
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = make_event_data(fd, generations_[fd] + 1);
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        LOG(LOG_ERROR) << "epoll_ctl(ADD) hatası: " << strerror(errno);
+        return false;
+    }
+    ++generations_[fd];
+    handlers_[fd].reset(new Callback(std::move(cb)));
+    return true;
+}
+
+bool EventLoop::modify(int fd, uint32_t events) {
+    if (fd < 0 || (size_t)fd >= handlers_.size() || !handlers_[fd]) return false;
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = make_event_data(fd, generations_[fd]);
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        LOG(LOG_ERROR) << "epoll_ctl(MOD) hatası: " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::remove(int fd) {
+    if (fd < 0 || (size_t)fd >= handlers_.size() || !handlers_[fd]) return;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    // Callback şu an çalışıyor olabilir; hemen yok etmek yerine tur sonuna ertele.
+    graveyard_.push_back(std::move(handlers_[fd]));
+    handlers_[fd] = nullptr;
+}
+
+void EventLoop::run() {
+    running_ = true;
+    struct epoll_event events[256];
+
+    while (running_) {
+        int n = ::epoll_wait(epoll_fd_, events, 256, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG(LOG_ERROR) << "epoll_wait hatası: " << strerror(errno);
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = (int)(uint32_t)events[i].data.u64;
+            uint32_t generation = (uint32_t)(events[i].data.u64 >> 32);
+            // Aynı turda daha önce kaldırılmış, ya da kaldırılıp numarası yeni bir fd'ye verilmiş olabilir
+            if ((size_t)fd < handlers_.size() && handlers_[fd] && generations_[fd] == generation) {
+                (*handlers_[fd])(events[i].events);
+            }
+        }
+        graveyard_.clear();
+    }
+}
+
+void EventLoop::stop() {
+    post([this]() { running_ = false; });
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+void EventLoop::run_posted_tasks() {
+    uint64_t count;
+    ssize_t ignored = ::read(wake_fd_, &count, sizeof(count));
+    (void)ignored;
+
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex_);
+        tasks.swap(tasks_);
+    }
+    for (Task& task : tasks) {
+        task();
+    }
+}
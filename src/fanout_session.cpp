@@ -0,0 +1,536 @@
+#include "fanout_session.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "logger.h"
+
+bool parse_slow_viewer_policy(const std::string& text, SlowViewerPolicy* policy) {
+    static const SlowViewerPolicy policies[] = { SLOW_VIEWER_DROP, SLOW_VIEWER_COALESCE, SLOW_VIEWER_DISCONNECT };
+    for (SlowViewerPolicy candidate : policies) {
+        if (text == slow_viewer_policy_name(candidate)) {
+            *policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* slow_viewer_policy_name(SlowViewerPolicy policy) {
+    switch (policy) {
+        case SLOW_VIEWER_DROP: return "drop";
+        case SLOW_VIEWER_COALESCE: return "coalesce";
+        case SLOW_VIEWER_DISCONNECT: return "disconnect";
+    }
+    return "unknown";
+}
+
+FanoutSession::FanoutSession(EventLoop& loop, ClientInfo& sharer, const TunnelLimits& limits, size_t lag_limit,
+                             SlowViewerPolicy policy, SlowViewerHandler on_slow_viewer, size_t rfb_cache_limit)
+    : loop_(loop), sharer_(&sharer), limits_(limits), lag_limit_(lag_limit), policy_(policy),
+      on_slow_viewer_(std::move(on_slow_viewer)), tail_(nullptr), input_(limits.high_watermark),
+      rfb_(rfb_cache_limit ? new RfbCache(rfb_cache_limit) : nullptr), rfb_primary_joined_(false), closed_(false) {
+    tail_ = acquire_chunk();
+    tail_->refs = 1;
+    // İzleyici yokken okunan veri kimseye gönderilemez; ilk izleyici gelene kadar sokette bekler
+    sharer_->read_paused = true;
+}
+
+FanoutSession::~FanoutSession() {
+    close();
+    release(tail_);
+    for (BroadcastChunk* chunk : pool_) delete chunk;
+}
+
+FanoutSession::BroadcastChunk* FanoutSession::acquire_chunk() {
+    BroadcastChunk* chunk;
+    if (!pool_.empty()) {
+        chunk = pool_.back();
+        pool_.pop_back();
+    } else {
+        chunk = new BroadcastChunk;
+    }
+    chunk->refs = 0;
+    chunk->size = 0;
+    return chunk;
+}
+
+// Parça son referansı bırakıldığında havuza döner; havuz doluysa serbest bırakılır
+void FanoutSession::release(BroadcastChunk* chunk) {
+    if (--chunk->refs > 0) return;
+    if (pool_.size() < MAX_POOLED_CHUNKS) {
+        pool_.push_back(chunk);
+    } else {
+        delete chunk;
+    }
+}
+
+void FanoutSession::release_queue(Viewer& viewer) {
+    for (const Span& span : viewer.queue) release(span.chunk);
+    viewer.queue.clear();
+    viewer.queued_bytes = 0;
+    viewer.snapshot_offset = 0;
+    viewer.snapshot_bytes = 0;
+    viewer.latency.clear();
+    viewer.metrics->dirs[0].queued_bytes.store(0, std::memory_order_relaxed);
+}
+
+FanoutSession::Viewer* FanoutSession::find_viewer(const ClientInfo& client) {
+    for (auto& viewer : viewers_) {
+        if (viewer->client == &client) return viewer.get();
+    }
+    return nullptr;
+}
+
+void FanoutSession::add_viewer(ClientInfo& client) {
+    if (closed_) return;
+    std::unique_ptr<Viewer> viewer(new Viewer());
+    viewer->client = &client;
+    viewer->metrics = relay_metrics.open_tunnel(sharer_->id, client.id);
+    if (rfb_) {
+        // İlk izleyici el sıkışmasını paylaşanla yapar; sonrakiler önbellekten karşılanır
+        viewer->rfb.reset(new RfbClientStream(*rfb_, !rfb_primary_joined_));
+        viewer->attached = !rfb_primary_joined_;
+        rfb_primary_joined_ = true;
+    }
+    if (viewers_.empty() && viewer->attached) {
+        // Yayın başından beri biriken veri ilk izleyiciye aittir
+        uint64_t now = metrics_now_ns();
+        for (const Span& span : backlog_) {
+            viewer->queued_bytes += span.end - span.begin;
+            viewer->latency.on_received(span.end - span.begin, now);
+        }
+        viewer->queue.swap(backlog_);
+    }
+    viewers_.push_back(std::move(viewer));
+    flush_viewer(*viewers_.back());
+    start_rfb_viewers();
+    update_sharer_reading();
+}
+
+void FanoutSession::remove_viewer(ClientInfo& client) {
+    auto it = std::find_if(viewers_.begin(), viewers_.end(),
+                           [&client](const std::unique_ptr<Viewer>& viewer) { return viewer->client == &client; });
+    if (it == viewers_.end()) return;
+    Viewer& viewer = **it;
+    bool primary = viewer.rfb && viewer.rfb->primary();
+    release_queue(viewer);
+    relay_metrics.close_tunnel(viewer.metrics);
+    if (viewer.input_paused) resume_reading(client);
+    viewers_.erase(it);
+    if (closed_) return;
+    // Paylaşan el sıkışmasının ortasında kaldı; başka bir izleyici onu sürdüremez
+    if (primary && !rfb_->ready()) {
+        rfb_->fail("ilk izleyici el sıkışması bitmeden ayrıldı");
+        start_rfb_viewers();
+    }
+    update_sharer_reading();
+}
+
+// Paylaşanın [begin, end) verisini canlı yayını alan izleyicilerin kuyruğuna (izleyici yoksa
+// bekleme listesine) ekler. Önbellek hazırsa yeni izleyici ilk karesini önbellekten alacağı
+// için bekleme listesi tutulmaz.
+void FanoutSession::append(BroadcastChunk* chunk, uint32_t begin, uint32_t end) {
+    if (begin == end) return;
+    if (viewers_.empty() && !(rfb_ && rfb_->ready())) {
+        if (!backlog_.empty() && backlog_.back().chunk == chunk && backlog_.back().end == begin) {
+            backlog_.back().end = end;
+        } else {
+            ++chunk->refs;
+            backlog_.push_back({chunk, begin, end});
+        }
+        return;
+    }
+    for (auto& viewer : viewers_) {
+        if (viewer->attached) enqueue(*viewer, chunk, begin, end);
+    }
+}
+
+// Paylaşanın [begin, end) verisini yayınlar. RFB önbelleği açıksa veri önce önbelleğe işlenir;
+// kare bekleyen izleyiciler ilk mesaj sınırında, o ana kadarki akışın yerine kareyi alır ve
+// sınırdan sonraki veriyle canlı yayına katılır.
+void FanoutSession::publish(BroadcastChunk* chunk, uint32_t begin, uint32_t end) {
+    if (!rfb_ || rfb_->failed()) {
+        append(chunk, begin, end);
+        return;
+    }
+    uint32_t pos = begin;
+    while (pos < end && !rfb_->failed()) {
+        bool waiting = snapshots_pending();
+        uint32_t used = rfb_->feed_server(chunk->data + pos, end - pos, waiting);
+        append(chunk, pos, pos + used);
+        pos += used;
+        if (waiting && rfb_->at_boundary()) send_snapshots();
+    }
+    append(chunk, pos, end); // Önbellek bu parçada devre dışı kaldıysa kalan veri
+    start_rfb_viewers();
+}
+
+// Relay'in ürettiği veriyi (RFB el sıkışma yanıtları, önbellek karesi) parçalara kopyalayıp
+// izleyici kuyruklarına ekler; aynı veriyi alan izleyiciler parçaları paylaşır
+void FanoutSession::enqueue_bytes(const std::vector<Viewer*>& targets, const std::string& data) {
+    if (targets.empty()) return;
+    for (size_t offset = 0; offset < data.size();) {
+        BroadcastChunk* chunk = acquire_chunk();
+        chunk->size = std::min(data.size() - offset, (size_t)CHUNK_SIZE);
+        memcpy(chunk->data, data.data() + offset, chunk->size);
+        for (Viewer* viewer : targets) enqueue(*viewer, chunk, 0, chunk->size);
+        offset += chunk->size;
+    }
+}
+
+bool FanoutSession::snapshots_pending() const {
+    for (auto& viewer : viewers_) {
+        if (viewer->snapshot_pending) return true;
+    }
+    return false;
+}
+
+// Önbellek bir mesaj sınırındayken kare bekleyen izleyicilere kareyi kuyruklar. Kare, izleyicinin
+// desteklediği kodlamaya göre (Hextile veya Raw) bir kez üretilir ve parçaları paylaşılır.
+void FanoutSession::send_snapshots() {
+    std::vector<Viewer*> targets[2]; // [0]: Raw, [1]: Hextile
+    for (auto& viewer : viewers_) {
+        if (!viewer->snapshot_pending) continue;
+        viewer->snapshot_pending = false;
+        targets[viewer->rfb->hextile() ? 1 : 0].push_back(viewer.get());
+    }
+    for (int hextile = 0; hextile < 2; ++hextile) {
+        if (targets[hextile].empty()) continue;
+        std::string frame;
+        rfb_->snapshot(&frame, hextile == 1);
+        for (Viewer* viewer : targets[hextile]) {
+            viewer->snapshot_offset = viewer->queued_bytes;
+            viewer->snapshot_bytes = frame.size();
+            viewer->attached = true;
+        }
+        enqueue_bytes(targets[hextile], frame);
+        relay_metrics.rfb_snapshots.fetch_add(targets[hextile].size(), std::memory_order_relaxed);
+        LOG(LOG_DEBUG) << "Yayın: ID " << sharer_->id << " önbelleğinden " << targets[hextile].size()
+                       << " izleyiciye " << frame.size() << " byte'lık kare gönderildi";
+        for (Viewer* viewer : targets[hextile]) flush_viewer(*viewer);
+    }
+}
+
+// Önbellek hazır olunca (veya devre dışı kalınca) el sıkışması bekleyen geç izleyicilere
+// relay kendi sürüm satırını gönderir
+void FanoutSession::start_rfb_viewers() {
+    if (!rfb_ || (!rfb_->ready() && !rfb_->failed())) return;
+    for (auto& viewer : viewers_) {
+        if (!viewer->rfb || viewer->rfb->started()) continue;
+        std::string reply;
+        viewer->rfb->start(&reply);
+        enqueue_bytes({viewer.get()}, reply);
+        flush_viewer(*viewer);
+    }
+}
+
+void FanoutSession::enqueue(Viewer& viewer, BroadcastChunk* chunk, uint32_t begin, uint32_t end) {
+    // Aynı parçanın bitişik aralığı son kuyruk elemanına eklenir; gönderimde daha az iovec kullanılır
+    if (!viewer.queue.empty() && viewer.queue.back().chunk == chunk && viewer.queue.back().end == begin) {
+        viewer.queue.back().end = end;
+    } else {
+        ++chunk->refs;
+        viewer.queue.push_back({chunk, begin, end});
+    }
+    viewer.queued_bytes += end - begin;
+    metrics_add(viewer.metrics->dirs[0].chunks, 1);
+    viewer.latency.on_received(end - begin, metrics_now_ns());
+}
+
+void FanoutSession::push(ClientInfo& src, const char* data, size_t len) {
+    if (closed_ || len == 0) return;
+    if (&src != sharer_) {
+        Viewer* viewer = find_viewer(src);
+        if (viewer && viewer->rfb) {
+            take_rfb_input(*viewer, data, len);
+            return;
+        }
+        size_t written = input_.write(data, len);
+        if (written < len) {
+            LOG_RATE_LIMITED(LOG_WARN, 5) << "Yayın: ID " << src.id << " girişinin " << len - written
+                                          << " byte'ı tampona sığmadı ve atıldı";
+        }
+        flush_input();
+        return;
+    }
+    while (len > 0) {
+        if (tail_->size == CHUNK_SIZE) {
+            release(tail_);
+            tail_ = acquire_chunk();
+            tail_->refs = 1;
+        }
+        uint32_t begin = tail_->size;
+        size_t n = std::min(len, CHUNK_SIZE - begin);
+        memcpy(tail_->data + begin, data, n);
+        tail_->size += n;
+        publish(tail_, begin, tail_->size);
+        data += n;
+        len -= n;
+    }
+    for (auto& viewer : viewers_) flush_viewer(*viewer);
+}
+
+bool FanoutSession::forward_from(ClientInfo& src) {
+    if (closed_ || src.read_paused) return true;
+    if (&src == sharer_) return read_from_sharer();
+    Viewer* viewer = find_viewer(src);
+    return viewer ? read_from_viewer(*viewer) : true;
+}
+
+// Paylaşandan okunan her parça bir kez belleğe alınır ve tüm izleyicilere hemen gönderilir
+bool FanoutSession::read_from_sharer() {
+    while (!sharer_->read_paused) {
+        if (tail_->size == CHUNK_SIZE) {
+            release(tail_);
+            tail_ = acquire_chunk();
+            tail_->refs = 1;
+        }
+        ssize_t n = ::read(sharer_->socket_fd, tail_->data + tail_->size, CHUNK_SIZE - tail_->size);
+        if (n > 0) {
+            uint32_t begin = tail_->size;
+            tail_->size += n;
+            publish(tail_, begin, tail_->size);
+            LOG(LOG_TRACE) << "Yayın: ID " << sharer_->id << " -> " << viewers_.size() << " izleyici " << n << " byte";
+            for (auto& viewer : viewers_) flush_viewer(*viewer);
+            apply_lag_limit();
+            if (closed_) return true;
+            update_sharer_reading();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false; // Okuma hatası veya bağlantı kapanması
+    }
+    return true;
+}
+
+// İzleyici kuyruğundaki aralıkları tek bir sendmsg ile (en fazla MAX_IOV parça) gönderir.
+// Kuyruk tamamen boşaldıysa true döner.
+bool FanoutSession::flush_viewer(Viewer& viewer) {
+    ClientInfo& client = *viewer.client;
+    // Sıralamayı korumak için önce çıkış tamponundaki kontrol mesajları gitmeli
+    if (!client.output_buffer.empty()) return viewer.queue.empty();
+    TunnelDirectionMetrics& stats = viewer.metrics->dirs[0];
+    bool drained = true;
+    while (!viewer.queue.empty()) {
+        struct iovec iov[MAX_IOV];
+        size_t count = 0;
+        for (auto it = viewer.queue.begin(); it != viewer.queue.end() && count < MAX_IOV; ++it, ++count) {
+            iov[count].iov_base = it->chunk->data + it->begin;
+            iov[count].iov_len = it->end - it->begin;
+        }
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = ::sendmsg(client.socket_fd, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // EAGAIN: izleyici yavaş, EPOLLOUT beklenir. Diğer hatalarda izleyici kendi olayında kapanır.
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) metrics_add(stats.partial_sends, 1);
+            drained = false;
+            break;
+        }
+
+        viewer.queued_bytes -= n;
+        if (viewer.snapshot_bytes > 0) {
+            size_t before = std::min(viewer.snapshot_offset, (size_t)n);
+            viewer.snapshot_offset -= before;
+            viewer.snapshot_bytes -= std::min(viewer.snapshot_bytes, n - before);
+        }
+        metrics_add(stats.bytes, n);
+        viewer.latency.on_sent(n, metrics_now_ns(), viewer.metrics->forward_latency);
+        size_t left = n;
+        while (left > 0) {
+            Span& span = viewer.queue.front();
+            size_t len = span.end - span.begin;
+            if (left < len) {
+                span.begin += left;
+                break;
+            }
+            left -= len;
+            release(span.chunk);
+            viewer.queue.pop_front();
+        }
+    }
+    stats.queued_bytes.store(viewer.queued_bytes, std::memory_order_relaxed);
+    return drained;
+}
+
+// Kuyruğu lag_limit'i aşan izleyicilere politikayı uygular. İşleyici izleyiciyi oturumdan
+// çıkaracağı için liste önce kopyalanır.
+void FanoutSession::apply_lag_limit() {
+    std::vector<ClientInfo*> slow;
+    for (auto& viewer : viewers_) {
+        // Önbellekten gönderilen kare tek seferlik bir yüktür; izleyicinin gecikmesi sayılmaz
+        if (viewer->queued_bytes - std::min(viewer->queued_bytes, viewer->snapshot_bytes) <= lag_limit_) continue;
+        relay_metrics.slow_viewers.fetch_add(1, std::memory_order_relaxed);
+        LOG_RATE_LIMITED(LOG_WARN, 10) << "Yayın: ID " << viewer->client->id << " izleyicisi " << viewer->queued_bytes
+                                       << " byte geride (sınır " << lag_limit_ << "), politika: "
+                                       << slow_viewer_policy_name(policy_);
+        if (policy_ == SLOW_VIEWER_COALESCE) {
+            // Bekleyen veri atılır; izleyici bir sonraki parçadan itibaren canlı akışı alır
+            release_queue(*viewer);
+        } else {
+            slow.push_back(viewer->client);
+        }
+    }
+    for (ClientInfo* client : slow) on_slow_viewer_(*client);
+}
+
+// Paylaşandan okuma en az gecikmiş izleyicinin kuyruğuna göre durdurulur ve sürdürülür;
+// aradaki fark her küçük boşalmada durdur/başlat salınımını önler
+void FanoutSession::update_sharer_reading() {
+    bool any = false;
+    size_t least = 0;
+    for (auto& viewer : viewers_) {
+        if (!viewer->attached) continue;
+        least = any ? std::min(least, viewer->queued_bytes) : viewer->queued_bytes;
+        any = true;
+    }
+    if (!any) {
+        // Önbellek hazırken paylaşan (yalnızca istenen güncellemeleri gönderdiğinden) okunmaya
+        // devam eder: önbellek güncel kalır ve kare bekleyen izleyici bir mesaj sınırına ulaşır
+        if (rfb_ && rfb_->ready()) {
+            resume_reading(*sharer_);
+        } else {
+            sharer_->read_paused = true;
+        }
+        return;
+    }
+    if (least >= limits_.high_watermark) {
+        if (!sharer_->read_paused) {
+            LOG_RATE_LIMITED(LOG_DEBUG, 10) << "Yayın: ID " << sharer_->id << " okuması durduruldu (en hızlı izleyicide "
+                                            << least << " byte bekliyor)";
+        }
+        sharer_->read_paused = true;
+    } else if (least <= limits_.low_watermark) {
+        resume_reading(*sharer_);
+    }
+}
+
+bool FanoutSession::read_from_viewer(Viewer& viewer) {
+    ClientInfo& client = *viewer.client;
+    char data[16 * 1024]; // RFB kipinde mesajlara bölünmeden önce
+    while (true) {
+        // RFB kipinde yarım kalan mesaj da tamamlanınca tampona yazılacaktır
+        size_t pending = viewer.rfb ? viewer.rfb->pending() : 0;
+        if (input_.free_space() <= pending) {
+            flush_input();
+            if (input_.free_space() <= pending) {
+                // Paylaşan girişi yeterince hızlı alamıyor
+                viewer.input_paused = true;
+                client.read_paused = true;
+                return true;
+            }
+        }
+        size_t room = input_.free_space() - pending;
+        ssize_t n = viewer.rfb ? ::read(client.socket_fd, data, std::min(sizeof(data), room))
+                               : input_.read_from_fd(client.socket_fd, room);
+        if (n > 0) {
+            metrics_add(viewer.metrics->dirs[1].chunks, 1);
+            metrics_add(viewer.metrics->dirs[1].bytes, n);
+            if (!viewer.rfb) {
+                flush_input();
+            } else if (!take_rfb_input(viewer, data, n)) {
+                return false;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false; // Okuma hatası veya bağlantı kapanması
+    }
+}
+
+// İzleyici girişini RFB mesajlarına böler: tamamlanan mesajlar paylaşana giden tampona, relay'in
+// el sıkışma yanıtları izleyiciye gider; tam ekran isteği önbellek karesiyle karşılanır
+bool FanoutSession::take_rfb_input(Viewer& viewer, const char* data, size_t len) {
+    std::string forward, reply;
+    bool valid = viewer.rfb->feed(data, len, &forward, &reply);
+    if (!forward.empty()) {
+        size_t written = input_.write(forward.data(), forward.size());
+        if (written < forward.size()) {
+            LOG_RATE_LIMITED(LOG_WARN, 5) << "Yayın: ID " << viewer.client->id << " girişinin " << forward.size() - written
+                                          << " byte'ı tampona sığmadı ve atıldı";
+        }
+        flush_input();
+    }
+    if (!reply.empty()) {
+        enqueue_bytes({&viewer}, reply);
+        flush_viewer(viewer);
+    }
+    if (viewer.rfb->take_snapshot_request() && rfb_->ready()) {
+        viewer.snapshot_pending = true;
+        if (rfb_->at_boundary()) {
+            send_snapshots();
+        } else {
+            update_sharer_reading();
+        }
+    }
+    if (!valid) {
+        LOG(LOG_WARN) << "Yayın: ID " << viewer.client->id << " izleyicisinden geçersiz RFB verisi";
+    }
+    return valid;
+}
+
+// İzleyicilerden birikmiş girişi paylaşana gönderir; tampon düşük su işaretine indiyse
+// durdurulmuş izleyici okumalarını sürdürür
+void FanoutSession::flush_input() {
+    if (!sharer_->output_buffer.empty()) return;
+    while (!input_.empty()) {
+        ssize_t n = input_.send_to_socket(sharer_->socket_fd);
+        if (n > 0) continue;
+        if (n < 0 && errno == EINTR) continue;
+        break; // EAGAIN: paylaşanın EPOLLOUT olayı devam ettirir
+    }
+    if (input_.size() > limits_.low_watermark) return;
+    for (auto& viewer : viewers_) {
+        if (!viewer->input_paused) continue;
+        viewer->input_paused = false;
+        resume_reading(*viewer->client);
+    }
+}
+
+void FanoutSession::on_writable(ClientInfo& dst) {
+    if (closed_) return;
+    if (&dst == sharer_) {
+        flush_input();
+        return;
+    }
+    Viewer* viewer = find_viewer(dst);
+    if (!viewer) return;
+    flush_viewer(*viewer);
+    if (sharer_->read_paused && viewer->queued_bytes <= limits_.low_watermark) {
+        resume_reading(*sharer_);
+    }
+}
+
+// Kenar tetiklemeli sokette durdurulan okumayı yeniden başlatır (bkz. TunnelSession::resume_reading)
+void FanoutSession::resume_reading(ClientInfo& client) {
+    if (!client.read_paused) return;
+    client.read_paused = false;
+    if (client.socket_fd < 0) return;
+    loop_.modify(client.socket_fd, CLIENT_EVENTS);
+}
+
+std::vector<ClientInfo*> FanoutSession::close() {
+    std::vector<ClientInfo*> clients;
+    if (closed_) return clients;
+    closed_ = true;
+    for (auto& viewer : viewers_) {
+        release_queue(*viewer);
+        relay_metrics.close_tunnel(viewer->metrics);
+        clients.push_back(viewer->client);
+    }
+    viewers_.clear();
+    for (const Span& span : backlog_) release(span.chunk);
+    backlog_.clear();
+    input_.clear();
+    return clients;
+}
@@ -0,0 +1,428 @@
+#include "handoff.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+#include "logger.h"
+
+static const size_t HEADER_SIZE = 6;
+
+/**
+ * @brief Engellemeyen çağrının sonucunu değerlendirir: EINTR'de yeniden denenir, EAGAIN'de soket
+ * hazır olana kadar (en geç deadline'a kadar) beklenir.
+ * @return Çağrı yinelenmeliyse true; hata veya süre dolduysa false (errno).
+ */
+static bool should_retry(ssize_t n, int sock, short events, HandoffDeadline deadline) {
+    if (n >= 0) return false;
+    if (errno == EINTR) return true;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        struct pollfd pfd = {sock, events, 0};
+        int polled = ::poll(&pfd, 1, (int)std::min<long long>(left.count(), INT_MAX));
+        if (polled > 0) return true;
+        if (polled < 0 && errno != EINTR) return false;
+    }
+}
+
+// len byte'ın tamamını deadline'a kadar yazar/okur
+static bool write_all(int sock, const char* data, size_t len, HandoffDeadline deadline) {
+    while (len > 0) {
+        ssize_t n = ::send(sock, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (should_retry(n, sock, POLLOUT, deadline)) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool read_all(int sock, char* data, size_t len, HandoffDeadline deadline) {
+    while (len > 0) {
+        ssize_t n = ::recv(sock, data, len, MSG_DONTWAIT);
+        if (should_retry(n, sock, POLLIN, deadline)) continue;
+        if (n == 0) errno = ECONNRESET;
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool handoff_send_byte(int sock, char value, HandoffDeadline deadline) {
+    return write_all(sock, &value, 1, deadline);
+}
+
+bool handoff_receive_byte(int sock, char* value, HandoffDeadline deadline) {
+    return read_all(sock, value, 1, deadline);
+}
+
+// --- HandoffWriter ---
+
+void HandoffWriter::put_u8(uint8_t value) {
+    payload_.push_back((char)value);
+}
+
+void HandoffWriter::put_u32(uint32_t value) {
+    uint32_t network = htonl(value);
+    payload_.append(reinterpret_cast<const char*>(&network), sizeof(network));
+}
+
+void HandoffWriter::put_u64(uint64_t value) {
+    put_u32((uint32_t)(value >> 32));
+    put_u32((uint32_t)value);
+}
+
+void HandoffWriter::put_string(const std::string& value) {
+    put_bytes(value.data(), value.size());
+}
+
+void HandoffWriter::put_bytes(const char* data, size_t len) {
+    put_u32((uint32_t)len);
+    payload_.append(data, len);
+}
+
+void HandoffWriter::put_fd(int fd) {
+    put_u8(fd >= 0 ? 1 : 0);
+    if (fd >= 0) fds_.push_back(fd);
+}
+
+bool HandoffWriter::send(int sock, HandoffDeadline deadline) {
+    if (fds_.size() > HANDOFF_MAX_FDS || payload_.size() > UINT32_MAX) {
+        errno = EMSGSIZE;
+        return false;
+    }
+    char header[HEADER_SIZE];
+    uint32_t length = htonl((uint32_t)payload_.size());
+    uint16_t count = htons((uint16_t)fds_.size());
+    memcpy(header, &length, sizeof(length));
+    memcpy(header + sizeof(length), &count, sizeof(count));
+
+    struct iovec iov;
+    iov.iov_base = header;
+    iov.iov_len = sizeof(header);
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    if (!fds_.empty()) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds_.size());
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds_.size());
+        memcpy(CMSG_DATA(cmsg), fds_.data(), sizeof(int) * fds_.size());
+    }
+    ssize_t n;
+    do {
+        n = ::sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (should_retry(n, sock, POLLOUT, deadline));
+    // fd'ler başlığın ilk byte'ıyla gider; başlık bölünürse kalan kısım ayrıca yazılır
+    bool sent = n > 0 && write_all(sock, header + n, sizeof(header) - n, deadline) &&
+                write_all(sock, payload_.data(), payload_.size(), deadline);
+    payload_.clear();
+    fds_.clear();
+    return sent;
+}
+
+// --- HandoffReader ---
+
+HandoffReader::~HandoffReader() {
+    close_fds();
+}
+
+void HandoffReader::close_fds() {
+    for (int fd : fds_) {
+        if (fd >= 0) ::close(fd);
+    }
+    fds_.clear();
+    next_fd_ = 0;
+}
+
+bool HandoffReader::receive(int sock, HandoffDeadline deadline) {
+    close_fds();
+    payload_.clear();
+    offset_ = 0;
+    ok_ = false;
+
+    char header[HEADER_SIZE];
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    struct iovec iov;
+    iov.iov_base = header;
+    iov.iov_len = sizeof(header);
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+    } while (should_retry(n, sock, POLLIN, deadline));
+    if (n == 0) errno = ECONNRESET;
+    if (n <= 0) return false;
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const unsigned char* data = CMSG_DATA(cmsg);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, data + i * sizeof(int), sizeof(int));
+            fds_.push_back(fd);
+        }
+    }
+    if ((msg.msg_flags & MSG_CTRUNC) || !read_all(sock, header + n, sizeof(header) - n, deadline)) return false;
+
+    uint32_t length;
+    uint16_t count;
+    memcpy(&length, header, sizeof(length));
+    memcpy(&count, header + sizeof(length), sizeof(count));
+    if (ntohs(count) != fds_.size()) return false;
+    payload_.resize(ntohl(length));
+    if (!read_all(sock, &payload_[0], payload_.size(), deadline)) return false;
+    ok_ = true;
+    return true;
+}
+
+bool HandoffReader::take(void* out, size_t len) {
+    if (!ok_ || payload_.size() - offset_ < len) {
+        ok_ = false;
+        memset(out, 0, len);
+        return false;
+    }
+    memcpy(out, payload_.data() + offset_, len);
+    offset_ += len;
+    return true;
+}
+
+uint8_t HandoffReader::get_u8() {
+    uint8_t value;
+    take(&value, sizeof(value));
+    return value;
+}
+
+uint32_t HandoffReader::get_u32() {
+    uint32_t value;
+    take(&value, sizeof(value));
+    return ntohl(value);
+}
+
+uint64_t HandoffReader::get_u64() {
+    uint64_t high = get_u32();
+    return (high << 32) | get_u32();
+}
+
+std::string HandoffReader::get_string() {
+    uint32_t len = get_u32();
+    if (!ok_ || payload_.size() - offset_ < len) {
+        ok_ = false;
+        return std::string();
+    }
+    std::string value = payload_.substr(offset_, len);
+    offset_ += len;
+    return value;
+}
+
+int HandoffReader::take_fd() {
+    if (get_u8() == 0) return -1;
+    if (next_fd_ >= fds_.size()) {
+        ok_ = false;
+        return -1;
+    }
+    int fd = fds_[next_fd_];
+    fds_[next_fd_++] = -1;
+    return fd;
+}
+
+// --- Relay durumunun devri ---
+
+void handoff_put_client(HandoffWriter& out, const ClientInfo& client) {
+    out.put_u32(client.owner_worker.load(std::memory_order_acquire));
+    out.put_u32(client.id);
+    out.put_string(client.ip_address);
+    out.put_string(client_status_name(client.status));
+    out.put_u32(client.peer_id);
+    out.put_u8(client.binary_protocol ? 1 : 0);
+    out.put_u8(client.read_paused ? 1 : 0);
+    out.put_string(client.resume_token);
+    out.put_bytes(client.command_buffer.data(), client.command_buffer.size());
+    out.put_bytes(client.output_buffer.data(), client.output_buffer.size());
+    out.put_u8(client.mux ? 1 : 0);
+    out.put_bytes(client.mux_input.data(), client.mux_input.size());
+    out.put_u64(client.mux_skip);
+    out.put_bytes(client.mux_pending.data(), client.mux_pending.size());
+    out.put_string(client.tunnel_options);
+    // Tekdüze saat sistem genelidir; süre sınırları yeni süreçte kaldığı yerden devam eder
+    out.put_u64(client.state_since_ms);
+    out.put_u64(client.last_activity_ms);
+    out.put_u64(client.last_ping_ms);
+    out.put_fd(client.socket_fd); // Resuming durumunda -1
+}
+
+std::shared_ptr<ClientInfo> handoff_get_client(HandoffReader& in) {
+    auto client = std::make_shared<ClientInfo>();
+    client->owner_worker.store(in.get_u32(), std::memory_order_release);
+    client->id = in.get_u32();
+    client->ip_address = in.get_string();
+    std::string status = in.get_string();
+    client->peer_id = in.get_u32();
+    client->binary_protocol = in.get_u8() != 0;
+    client->read_paused = in.get_u8() != 0;
+    client->resume_token = in.get_string();
+    std::string buffer = in.get_string();
+    client->command_buffer.assign(buffer.begin(), buffer.end());
+    buffer = in.get_string();
+    client->output_buffer.assign(buffer.begin(), buffer.end());
+    client->mux = in.get_u8() != 0;
+    buffer = in.get_string();
+    client->mux_input.assign(buffer.begin(), buffer.end());
+    client->mux_skip = in.get_u64();
+    buffer = in.get_string();
+    client->mux_pending.assign(buffer.begin(), buffer.end());
+    client->tunnel_options = in.get_string();
+    client->state_since_ms = in.get_u64();
+    client->last_activity_ms = in.get_u64();
+    client->last_ping_ms = in.get_u64();
+    client->socket_fd = in.take_fd();
+    if (!parse_client_status(status, &client->status)) {
+        LOG(LOG_ERROR) << "Yükseltme: Bilinmeyen istemci durumu: " << status;
+        if (client->socket_fd >= 0) ::close(client->socket_fd);
+        return nullptr;
+    }
+    return client;
+}
+
+static void put_direction(HandoffWriter& out, const TunnelSession& session, const ClientInfo& src) {
+    TunnelSession::DirectionState state;
+    session.export_direction(src, &state);
+    out.put_u64(state.received);
+    out.put_u64(state.sent);
+    out.put_u64(state.pipe_bytes);
+    out.put_fd(state.pipe[0]);
+    out.put_fd(state.pipe[1]);
+    out.put_u64(state.retained);
+    out.put_string(state.buffered);
+    out.put_u64(state.scan_at);
+    out.put_u32(state.frame_ends.size());
+    for (uint64_t end : state.frame_ends) out.put_u64(end);
+    out.put_string(state.urgent);
+    out.put_string(state.backlog);
+}
+
+static void get_direction(HandoffReader& in, TunnelSession::DirectionState* state) {
+    state->received = in.get_u64();
+    state->sent = in.get_u64();
+    state->pipe_bytes = in.get_u64();
+    state->pipe[0] = in.take_fd();
+    state->pipe[1] = in.take_fd();
+    state->retained = in.get_u64();
+    state->buffered = in.get_string();
+    state->scan_at = in.get_u64();
+    uint32_t frame_count = in.get_u32();
+    for (uint32_t i = 0; i < frame_count && in.ok(); ++i) state->frame_ends.push_back(in.get_u64());
+    state->urgent = in.get_string();
+    state->backlog = in.get_string();
+}
+
+HandedSession::~HandedSession() {
+    for (auto& dir : dirs) {
+        if (dir.pipe[0] >= 0) ::close(dir.pipe[0]);
+        if (dir.pipe[1] >= 0) ::close(dir.pipe[1]);
+    }
+}
+
+void handoff_put_session(HandoffWriter& out, const TunnelSession& session, const ClientInfo& a, const ClientInfo& b) {
+    out.put_u32(a.id);
+    out.put_u32(b.id);
+    put_direction(out, session, a);
+    put_direction(out, session, b);
+}
+
+void handoff_get_session(HandoffReader& in, HandedSession* handed) {
+    handed->a = in.get_u32();
+    handed->b = in.get_u32();
+    get_direction(in, &handed->dirs[0]);
+    get_direction(in, &handed->dirs[1]);
+}
+
+// --- LoopFreeze ---
+
+bool LoopFreeze::freeze(const std::vector<EventLoop*>& loops, HandoffDeadline deadline) {
+    uint64_t round;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frozen_ = 0;
+        round = round_;
+    }
+    for (EventLoop* loop : loops) {
+        loop->post([this, round]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (round_ != round) return; // Tur süre dolduğu için bitti
+            ++frozen_;
+            cv_.notify_all();
+            cv_.wait(lock, [this, round]() { return round_ != round; });
+        });
+    }
+    bool frozen;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        frozen = cv_.wait_until(lock, deadline, [this, &loops]() { return frozen_ == loops.size(); });
+    }
+    if (!frozen) release();
+    return frozen;
+}
+
+void LoopFreeze::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++round_;
+    cv_.notify_all();
+}
+
+// --- Süreç yardımcıları ---
+
+int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)::syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void notify_supervisor(const std::string& state) {
+    const char* path = ::getenv("NOTIFY_SOCKET");
+    if (!path || (path[0] != '/' && path[0] != '@')) return;
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    size_t length = strlen(path);
+    if (length >= sizeof(address.sun_path)) return;
+    memcpy(address.sun_path, path, length);
+    if (address.sun_path[0] == '@') address.sun_path[0] = '\0'; // Soyut ad alanı
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return;
+    socklen_t address_length = offsetof(struct sockaddr_un, sun_path) + length;
+    if (::sendto(fd, state.data(), state.size(), MSG_NOSIGNAL, (struct sockaddr *)&address, address_length) < 0) {
+        LOG(LOG_WARN) << "Uyarı: Süreç yöneticisine bildirilemedi (" << state << "): " << strerror(errno);
+    }
+    ::close(fd);
+}
@@ -0,0 +1,340 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+std::atomic<uint8_t> log_min_level{LOG_INFO};
+
+namespace {
+
+const size_t RING_SLOTS = 1024; // Thread başına; ikinin kuvveti
+const size_t TEXT_SIZE = 240;   // Daha uzun kayıtlar kırpılır
+
+struct Slot {
+    int64_t timestamp_ns;
+    uint8_t level;
+    uint16_t length;
+    char text[TEXT_SIZE];
+};
+
+// Tek üreticili (sahibi olan thread) / tek tüketicili (yazıcı thread) kayıt halkası
+class LogRing {
+public:
+    explicit LogRing(const std::string& name) : name_(name), slots_(RING_SLOTS) {}
+
+    // Üretici: sıradaki boş yuvayı döndürür; halka doluysa nullptr
+    Slot* reserve() {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == RING_SLOTS) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &slots_[tail & (RING_SLOTS - 1)];
+    }
+
+    // Üretici: reserve() ile alınan yuvayı tüketiciye görünür yapar
+    void publish() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Tüketici: yayınlanmış tüm kayıtları fn'e verir; yuvalar fn döndükten sonra serbest kalır
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        for (uint64_t i = head; i != tail; ++i) {
+            fn(slots_[i & (RING_SLOTS - 1)]);
+        }
+        head_.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    const std::string& name() const { return name_; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    std::atomic<bool> orphaned{false}; // Sahibi olan thread sonlandı
+    uint64_t reported_dropped = 0;     // Yalnızca yazıcı thread kullanır
+
+private:
+    std::string name_;
+    std::vector<Slot> slots_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+std::mutex rings_mutex; // Yalnızca halka kaydı/silinmesi için; kayıt yazma yolunda alınmaz
+std::vector<std::shared_ptr<LogRing>> rings;
+
+// Kayıt metnini doğrudan halka yuvasına yazan, taşarsa kırpan akış arabelleği
+class SlotBuffer : public std::streambuf {
+public:
+    void reset(char* begin, size_t size) { setp(begin, begin + size); }
+    size_t written() const { return pptr() - pbase(); }
+
+protected:
+    int_type overflow(int_type) override { return traits_type::eof(); }
+};
+
+struct ThreadLog {
+    std::shared_ptr<LogRing> ring;
+    std::string name;
+    SlotBuffer buffer;
+    std::ostream stream{&buffer};
+    Slot* slot = nullptr;
+    char scratch[TEXT_SIZE]; // Halka doluyken kayıt buraya yazılıp atılır
+
+    LogRing& ring_ref() {
+        if (!ring) {
+            if (name.empty()) name = "t" + std::to_string((long)::syscall(SYS_gettid));
+            ring = std::make_shared<LogRing>(name);
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            rings.push_back(ring);
+        }
+        return *ring;
+    }
+
+    ~ThreadLog() {
+        if (ring) ring->orphaned.store(true, std::memory_order_release);
+    }
+};
+
+thread_local ThreadLog thread_log;
+
+std::thread flusher;
+std::mutex flusher_mutex;
+std::condition_variable flusher_cv;
+bool flusher_stopping = false;
+
+std::atomic<uint8_t> level_before_toggle{LOG_INFO};
+std::atomic<unsigned> toggle_count{0};
+unsigned reported_toggles = 0;
+
+void append_record(std::string& out, const Slot& slot, const std::string& thread_name) {
+    time_t seconds = slot.timestamp_ns / 1000000000;
+    struct tm tm_buf;
+    ::localtime_r(&seconds, &tm_buf);
+    char prefix[64];
+    size_t n = ::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    n += ::snprintf(prefix + n, sizeof(prefix) - n, ".%03d %-5s ", (int)(slot.timestamp_ns / 1000000 % 1000),
+                    log_level_name((LogLevel)slot.level));
+    out.append(prefix, n);
+    out += '[';
+    out += thread_name;
+    out += "] ";
+    out.append(slot.text, slot.length);
+    out += '\n';
+}
+
+void write_all(int fd, std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = ::write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        offset += n;
+    }
+    data.clear();
+}
+
+// Tüm halkaları bir kez boşaltır. @return Yazılan kayıt sayısı.
+size_t flush_rings(std::string& out, std::string& err) {
+    std::vector<std::shared_ptr<LogRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        snapshot = rings;
+    }
+
+    size_t records = 0;
+    unsigned toggles = toggle_count.load(std::memory_order_relaxed);
+    if (toggles != reported_toggles) {
+        reported_toggles = toggles;
+        out += "Günlük seviyesi değiştirildi: ";
+        out += log_level_name((LogLevel)log_min_level.load(std::memory_order_relaxed));
+        out += '\n';
+    }
+    for (const auto& ring : snapshot) {
+        records += ring->drain([&](const Slot& slot) {
+            append_record(slot.level >= LOG_WARN ? err : out, slot, ring->name());
+        });
+        uint64_t dropped = ring->dropped();
+        if (dropped != ring->reported_dropped) {
+            err += "[" + ring->name() + "] " + std::to_string(dropped - ring->reported_dropped) +
+                   " günlük kaydı halka dolu olduğu için düşürüldü\n";
+            ring->reported_dropped = dropped;
+        }
+    }
+    write_all(STDOUT_FILENO, out);
+    write_all(STDERR_FILENO, err);
+
+    // Thread'i sonlanmış ve boşaltılmış halkalar bırakılır
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<LogRing>& ring) {
+        return ring->orphaned.load(std::memory_order_acquire) && ring->empty();
+    }), rings.end());
+    return records;
+}
+
+void flusher_main() {
+    std::string out, err;
+    std::unique_lock<std::mutex> lock(flusher_mutex);
+    while (!flusher_stopping) {
+        lock.unlock();
+        size_t records = flush_rings(out, err);
+        lock.lock();
+        // Yazacak kayıt yoksa kısa bir süre beklenir; üreticiler yazıcıyı hiç uyandırmaz
+        if (records == 0) {
+            flusher_cv.wait_for(lock, std::chrono::milliseconds(20));
+        }
+    }
+    lock.unlock();
+    while (flush_rings(out, err) > 0) {}
+}
+
+void toggle_handler(int) {
+    // Yalnızca kilitsiz atomikler: sinyal işleyicide güvenli
+    uint8_t current = log_min_level.load(std::memory_order_relaxed);
+    if (current != LOG_TRACE) {
+        level_before_toggle.store(current, std::memory_order_relaxed);
+        log_min_level.store(LOG_TRACE, std::memory_order_relaxed);
+    } else {
+        log_min_level.store(level_before_toggle.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    toggle_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t monotonic_seconds() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec;
+}
+
+} // namespace
+
+bool parse_log_level(const std::string& name, LogLevel* level) {
+    static const LogLevel levels[] = { LOG_TRACE, LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR };
+    for (LogLevel candidate : levels) {
+        std::string candidate_name = log_level_name(candidate);
+        std::transform(candidate_name.begin(), candidate_name.end(), candidate_name.begin(), ::tolower);
+        if (name == candidate_name) {
+            *level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LOG_TRACE: return "TRACE";
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return "INFO";
+        case LOG_WARN: return "WARN";
+        case LOG_ERROR: return "ERROR";
+    }
+    return "?";
+}
+
+void set_log_level(LogLevel level) {
+    log_min_level.store(level, std::memory_order_relaxed);
+}
+
+void log_start() {
+    std::lock_guard<std::mutex> lock(flusher_mutex);
+    if (flusher.joinable()) return;
+    // exit() yolunda da bekleyen kayıtlar yazılsın ve thread nesnesi çalışırken yok edilmesin
+    static bool exit_hook_installed = false;
+    if (!exit_hook_installed) {
+        std::atexit(log_stop);
+        exit_hook_installed = true;
+    }
+    flusher_stopping = false;
+    flusher = std::thread(flusher_main);
+}
+
+void log_stop() {
+    {
+        std::lock_guard<std::mutex> lock(flusher_mutex);
+        flusher_stopping = true;
+    }
+    flusher_cv.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    } else {
+        std::string out, err;
+        flush_rings(out, err);
+    }
+}
+
+void log_install_level_toggle(int signo) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = toggle_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(signo, &action, nullptr);
+}
+
+void log_set_thread_name(const std::string& name) {
+    if (!thread_log.ring) thread_log.name = name;
+    thread_log.ring_ref();
+}
+
+LogMessage::LogMessage(LogLevel level, int64_t suppressed) : level_(level), suppressed_(suppressed) {
+    ThreadLog& log = thread_log;
+    log.slot = log.ring_ref().reserve();
+    log.buffer.reset(log.slot ? log.slot->text : log.scratch, TEXT_SIZE);
+    // Akış thread'e özeldir; önceki kaydın biçim ayarları taşınmasın
+    log.stream.clear();
+    log.stream.flags(std::ios_base::dec | std::ios_base::skipws);
+    log.stream.precision(6);
+    log.stream.fill(' ');
+    stream_ = &log.stream;
+}
+
+LogMessage::~LogMessage() {
+    ThreadLog& log = thread_log;
+    if (suppressed_ > 0) {
+        log.stream << " (hız sınırı: " << suppressed_ << " kayıt atlandı)";
+    }
+    if (!log.slot) return;
+
+    size_t length = log.buffer.written();
+    while (length > 0 && log.slot->text[length - 1] == '\n') --length; // std::endl ile bitenler
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    log.slot->timestamp_ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    log.slot->level = level_;
+    log.slot->length = (uint16_t)length;
+    log.ring->publish();
+    log.slot = nullptr;
+}
+
+int64_t LogRateLimit::admit(unsigned per_second) {
+    int64_t now = monotonic_seconds();
+    int64_t window = window_.load(std::memory_order_relaxed);
+    if (window != now && window_.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        count_.store(0, std::memory_order_relaxed);
+    }
+    if (count_.fetch_add(1, std::memory_order_relaxed) < per_second) {
+        return suppressed_.exchange(0, std::memory_order_relaxed);
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+}
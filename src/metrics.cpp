@@ -0,0 +1,446 @@
+#include "metrics.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <ctime>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "logger.h"
+
+RelayMetrics relay_metrics;
+
+// Prometheus'a aktarılan kova sınırları: 2^FIRST_EXPORTED_MAGNITUDE ns'den (256 ns) başlayarak
+// ikinin kuvvetleri. İçteki ince kovalar yalnızca yüzdelik dilim hesabında kullanılır.
+static const int FIRST_EXPORTED_MAGNITUDE = 8;
+
+// Dışa aktarılan yüzdelik dilimler
+static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+uint64_t metrics_now_ns() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// --- LatencyHistogram ---
+
+size_t LatencyHistogram::bucket_index(uint64_t value_ns) {
+    if (value_ns < SUB_BUCKETS) return (size_t)value_ns;
+    int magnitude = 63 - __builtin_clzll(value_ns);
+    if (magnitude > MAX_MAGNITUDE) return BUCKET_COUNT - 1;
+    size_t sub = (value_ns >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (size_t)(magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+    int magnitude = (int)(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    uint64_t width = uint64_t(1) << (magnitude - SUB_BUCKET_BITS);
+    return (SUB_BUCKETS + sub) * width + width - 1;
+}
+
+void LatencyHistogram::record(uint64_t value_ns) {
+    counts_[bucket_index(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(value_ns, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::add_to(Snapshot* snapshot) const {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot->counts[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+    snapshot->sum_ns += sum_ns_.load(std::memory_order_relaxed);
+    snapshot->count += count_.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t n = other.counts_[i].load(std::memory_order_relaxed);
+        if (n > 0) counts_[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    sum_ns_.fetch_add(other.sum_ns_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::quantile(double q) const {
+    // Kovalar ve sayaç ayrı ayrı okunduğu için toplam, kova sayılarının toplamıyla kullanılır
+    uint64_t total = 0;
+    for (uint64_t n : counts) total += n;
+    if (total == 0) return 0;
+    uint64_t target = (uint64_t)std::ceil(q * total);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= target) return bucket_upper_bound(i);
+    }
+    return bucket_upper_bound(counts.size() - 1);
+}
+
+// --- ForwardLatencyTracker ---
+
+void ForwardLatencyTracker::on_received(size_t bytes, uint64_t now_ns) {
+    received_ += bytes;
+    if (count_ == CAPACITY) {
+        stamps_[(head_ + count_ - 1) % CAPACITY].end = received_;
+        return;
+    }
+    stamps_[(head_ + count_) % CAPACITY] = {received_, now_ns};
+    ++count_;
+}
+
+void ForwardLatencyTracker::on_sent(size_t bytes, uint64_t now_ns, LatencyHistogram& histogram) {
+    sent_ += bytes;
+    // Tamamı gönderilen damgalar için gecikme bir kez kaydedilir
+    while (count_ > 0 && stamps_[head_].end <= sent_) {
+        histogram.record(now_ns - stamps_[head_].received_ns);
+        head_ = (head_ + 1) % CAPACITY;
+        --count_;
+    }
+}
+
+void ForwardLatencyTracker::clear() {
+    head_ = count_ = 0;
+    sent_ = received_;
+}
+
+// --- RelayMetrics ---
+
+std::shared_ptr<TunnelMetrics> RelayMetrics::open_tunnel(ClientId a_id, ClientId b_id) {
+    auto tunnel = std::make_shared<TunnelMetrics>(a_id, b_id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    tunnel->list_index_ = tunnels_.size();
+    tunnels_.push_back(tunnel);
+    ++tunnels_opened_;
+    return tunnel;
+}
+
+void RelayMetrics::close_tunnel(const std::shared_ptr<TunnelMetrics>& tunnel) {
+    if (!tunnel) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t index = tunnel->list_index_;
+    if (index == TunnelMetrics::NOT_LISTED) return;
+    // Sonuncuyla yer değiştirerek silinir; taşınan tünelin yeri güncellenir
+    if (index + 1 < tunnels_.size()) {
+        tunnels_[index] = std::move(tunnels_.back());
+        tunnels_[index]->list_index_ = index;
+    }
+    tunnels_.pop_back();
+    tunnel->list_index_ = TunnelMetrics::NOT_LISTED;
+    for (const TunnelDirectionMetrics& dir : tunnel->dirs) {
+        closed_bytes_ += dir.bytes.load(std::memory_order_relaxed);
+        closed_chunks_ += dir.chunks.load(std::memory_order_relaxed);
+        closed_partial_sends_ += dir.partial_sends.load(std::memory_order_relaxed);
+    }
+    closed_forward_latency_.merge(tunnel->forward_latency);
+}
+
+LatencyHistogram& RelayMetrics::command_latency(ControlType type) {
+    switch (type) {
+        case CTRL_HELLO: return command_latency_[0];
+        case CTRL_CONNECT: return command_latency_[1];
+        case CTRL_ACCEPT: return command_latency_[2];
+        case CTRL_START_VNC_TUNNEL: return command_latency_[3];
+        default: return command_latency_[4];
+    }
+}
+
+namespace {
+
+void append_header(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void append_sample(std::string& out, const char* name, const std::string& labels, double value) {
+    char number[32];
+    snprintf(number, sizeof(number), "%.9g", value);
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += number;
+    out += '\n';
+}
+
+void append_sample(std::string& out, const char* name, const std::string& labels, uint64_t value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+// Histogramı ikinin kuvveti kova sınırlarıyla (saniye) toplamalı Prometheus histogramı olarak yazar
+void append_histogram(std::string& out, const std::string& name, const std::string& labels,
+                      const LatencyHistogram::Snapshot& snapshot) {
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    std::string bucket_name = name + "_bucket";
+    uint64_t cumulative = 0;
+    size_t index = 0;
+    for (int magnitude = FIRST_EXPORTED_MAGNITUDE; magnitude <= LatencyHistogram::MAX_MAGNITUDE; ++magnitude) {
+        uint64_t bound = uint64_t(1) << magnitude;
+        while (index < LatencyHistogram::BUCKET_COUNT && LatencyHistogram::bucket_upper_bound(index) < bound) {
+            cumulative += snapshot.counts[index++];
+        }
+        char le[32];
+        snprintf(le, sizeof(le), "%.9g", bound / 1e9);
+        append_sample(out, bucket_name.c_str(), prefix + "le=\"" + le + "\"", cumulative);
+    }
+    while (index < LatencyHistogram::BUCKET_COUNT) cumulative += snapshot.counts[index++];
+    append_sample(out, bucket_name.c_str(), prefix + "le=\"+Inf\"", cumulative);
+    append_sample(out, (name + "_sum").c_str(), labels, snapshot.sum_ns / 1e9);
+    append_sample(out, (name + "_count").c_str(), labels, cumulative);
+}
+
+} // namespace
+
+std::string RelayMetrics::render() const {
+    std::string out;
+    out.reserve(16 * 1024);
+
+    append_header(out, "relay_connections_accepted_total", "counter", "Kabul edilen istemci bağlantıları.");
+    append_sample(out, "relay_connections_accepted_total", "", connections_accepted.load(std::memory_order_relaxed));
+    append_header(out, "relay_connections_shed_total", "counter",
+                  "Dosya tanımlayıcısı tükendiği (EMFILE/ENFILE) için kabul edilip hemen kapatılan bağlantılar.");
+    append_sample(out, "relay_connections_shed_total", "", connections_shed.load(std::memory_order_relaxed));
+    append_header(out, "relay_clients_connected", "gauge", "Bağlı istemci sayısı.");
+    append_sample(out, "relay_clients_connected", "",
+                  (double)clients_connected.load(std::memory_order_relaxed));
+    append_header(out, "relay_control_errors_total", "counter", "ERROR ile yanıtlanan kontrol mesajları.");
+    append_sample(out, "relay_control_errors_total", "", control_errors.load(std::memory_order_relaxed));
+    append_header(out, "relay_slow_viewers_total", "counter",
+                  "Yayın oturumlarında gecikme sınırını aşıp politikası uygulanan izleyiciler.");
+    append_sample(out, "relay_slow_viewers_total", "", slow_viewers.load(std::memory_order_relaxed));
+    append_header(out, "relay_tunnel_resumes_total", "counter",
+                  "Bağlantısı kopan ucu süresi içinde yeniden bağlanıp devam eden tüneller.");
+    append_sample(out, "relay_tunnel_resumes_total", "", tunnel_resumes.load(std::memory_order_relaxed));
+    append_header(out, "relay_tunnel_resume_timeouts_total", "counter",
+                  "Bağlantısı kopan ucu süresi içinde dönmediği için kapanan tüneller.");
+    append_sample(out, "relay_tunnel_resume_timeouts_total", "", tunnel_resume_timeouts.load(std::memory_order_relaxed));
+    append_header(out, "relay_egress_throttled_total", "counter",
+                  "Çıkış zamanlayıcısında hız sınırı veya adil sıra için bekletilen gönderimler.");
+    append_sample(out, "relay_egress_throttled_total", "", egress_throttled.load(std::memory_order_relaxed));
+    append_header(out, "relay_rfb_snapshots_total", "counter",
+                  "Yayın izleyicilerine paylaşana gitmeden RFB önbelleğinden gönderilen tam kareler.");
+    append_sample(out, "relay_rfb_snapshots_total", "", rfb_snapshots.load(std::memory_order_relaxed));
+    append_header(out, "relay_rfb_cache_failures_total", "counter",
+                  "Akış çözülemediği için devre dışı kalan RFB önbellekleri.");
+    append_sample(out, "relay_rfb_cache_failures_total", "", rfb_cache_failures.load(std::memory_order_relaxed));
+    append_header(out, "relay_p2p_exchanges_total", "counter",
+                  "Buluşma noktasında aday adresleri değiş tokuş edilen doğrudan bağlantı denemeleri.");
+    append_sample(out, "relay_p2p_exchanges_total", "", p2p_exchanges.load(std::memory_order_relaxed));
+    append_header(out, "relay_p2p_direct_total", "counter",
+                  "İki ucun da doğrudan (relay'siz) bağlandığını bildirdiği denemeler.");
+    append_sample(out, "relay_p2p_direct_total", "", p2p_direct.load(std::memory_order_relaxed));
+    append_header(out, "relay_p2p_fallbacks_total", "counter",
+                  "Hole punching başarısız olduğu veya doğrudan yol koptuğu için relay tüneline dönülen denemeler.");
+    append_sample(out, "relay_p2p_fallbacks_total", "", p2p_fallbacks.load(std::memory_order_relaxed));
+    append_header(out, "relay_cluster_links", "gauge", "Kurulu relay'ler arası (küme) bağlantılar.");
+    append_sample(out, "relay_cluster_links", "", (double)cluster_links.load(std::memory_order_relaxed));
+    append_header(out, "relay_cluster_channels_total", "counter",
+                  "Başka relay'deki ajanla tünel için açılan küme kanalları.");
+    append_sample(out, "relay_cluster_channels_total", "", cluster_channels.load(std::memory_order_relaxed));
+    append_header(out, "relay_handshake_timeouts_total", "counter",
+                  "Bağlantı isteği veya tünel kurulumu süresi içinde tamamlanmadığı için eşleşmesi kaldırılan uçlar.");
+    append_sample(out, "relay_handshake_timeouts_total", "", handshake_timeouts.load(std::memory_order_relaxed));
+    append_header(out, "relay_idle_evictions_total", "counter",
+                  "Komut modunda boşta kalma süresini aştığı için kapatılan bağlantılar.");
+    append_sample(out, "relay_idle_evictions_total", "", idle_evictions.load(std::memory_order_relaxed));
+    append_header(out, "relay_heartbeats_sent_total", "counter", "Komut modundaki istemcilere gönderilen kalp atışları (PING).");
+    append_sample(out, "relay_heartbeats_sent_total", "", heartbeats_sent.load(std::memory_order_relaxed));
+    append_header(out, "relay_tls_handshake_failures_total", "counter",
+                  "Başarısız olan veya süresi içinde tamamlanmayan TLS el sıkışmaları.");
+    append_sample(out, "relay_tls_handshake_failures_total", "", tls_handshake_failures.load(std::memory_order_relaxed));
+    append_header(out, "relay_tls_connections_total", "counter",
+                  "TLS el sıkışması tamamlanan bağlantılar (ktls: çekirdek şifreler, userspace: relay'deki köprü).");
+    append_sample(out, "relay_tls_connections_total", "mode=\"ktls\"", ktls_connections.load(std::memory_order_relaxed));
+    append_sample(out, "relay_tls_connections_total", "mode=\"userspace\"",
+                  tls_userspace_connections.load(std::memory_order_relaxed));
+
+    static const char* const command_names[COMMAND_SLOTS] = { "hello", "connect", "accept", "start_vnc_tunnel", "other" };
+    append_header(out, "relay_control_command_duration_seconds", "histogram",
+                  "Kontrol komutu işleme süresi (komut tipine göre).");
+    for (size_t i = 0; i < COMMAND_SLOTS; ++i) {
+        LatencyHistogram::Snapshot snapshot;
+        command_latency_[i].add_to(&snapshot);
+        append_histogram(out, "relay_control_command_duration_seconds",
+                         std::string("command=\"") + command_names[i] + "\"", snapshot);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t bytes = closed_bytes_, chunks = closed_chunks_, partial_sends = closed_partial_sends_;
+    LatencyHistogram::Snapshot forward_latency;
+    closed_forward_latency_.add_to(&forward_latency);
+    for (const auto& tunnel : tunnels_) {
+        for (const TunnelDirectionMetrics& dir : tunnel->dirs) {
+            bytes += dir.bytes.load(std::memory_order_relaxed);
+            chunks += dir.chunks.load(std::memory_order_relaxed);
+            partial_sends += dir.partial_sends.load(std::memory_order_relaxed);
+        }
+        tunnel->forward_latency.add_to(&forward_latency);
+    }
+
+    append_header(out, "relay_tunnels_opened_total", "counter", "Açılan tünel oturumları.");
+    append_sample(out, "relay_tunnels_opened_total", "", tunnels_opened_);
+    append_header(out, "relay_tunnels_active", "gauge", "Açık tünel oturumları.");
+    append_sample(out, "relay_tunnels_active", "", (double)tunnels_.size());
+    append_header(out, "relay_forwarded_bytes_total", "counter", "Tünellerde karşı uca aktarılan byte (tüm oturumlar).");
+    append_sample(out, "relay_forwarded_bytes_total", "", bytes);
+    append_header(out, "relay_forwarded_chunks_total", "counter", "Tünellerde kaynaktan okunan parça sayısı (tüm oturumlar).");
+    append_sample(out, "relay_forwarded_chunks_total", "", chunks);
+    append_header(out, "relay_partial_sends_total", "counter",
+                  "Karşı uç yavaş olduğu için yarıda kalan gönderimler (tüm oturumlar).");
+    append_sample(out, "relay_partial_sends_total", "", partial_sends);
+
+    append_header(out, "relay_forward_latency_seconds", "histogram",
+                  "Tünel verisinin kaynaktan alınmasından karşı uca gönderilmesine kadar geçen süre.");
+    append_histogram(out, "relay_forward_latency_seconds", "", forward_latency);
+    append_header(out, "relay_forward_latency_quantile_seconds", "gauge",
+                  "Aktarım gecikmesi yüzdelik dilimleri (HDR kovalarından, göreli hata <= %12.5).");
+    for (double q : QUANTILES) {
+        char label[32];
+        snprintf(label, sizeof(label), "quantile=\"%g\"", q);
+        append_sample(out, "relay_forward_latency_quantile_seconds", label, forward_latency.quantile(q) / 1e9);
+    }
+
+    // Oturum başına ölçümler; yön etiketleri kaynak ve hedef ID'leridir
+    static const char* const per_tunnel[] = {
+        "relay_tunnel_bytes_total", "counter", "Oturumda karşı uca aktarılan byte.",
+        "relay_tunnel_chunks_total", "counter", "Oturumda kaynaktan okunan parça sayısı.",
+        "relay_tunnel_partial_sends_total", "counter", "Oturumda yarıda kalan gönderimler.",
+        "relay_tunnel_queued_bytes", "gauge", "Karşı uca gönderilmeyi bekleyen byte (kuyruk derinliği).",
+    };
+    for (size_t metric = 0; metric < 4; ++metric) {
+        const char* name = per_tunnel[metric * 3];
+        append_header(out, name, per_tunnel[metric * 3 + 1], per_tunnel[metric * 3 + 2]);
+        for (const auto& tunnel : tunnels_) {
+            for (int d = 0; d < 2; ++d) {
+                const TunnelDirectionMetrics& dir = tunnel->dirs[d];
+                std::string src = std::to_string(d == 0 ? tunnel->a_id : tunnel->b_id);
+                std::string dst = std::to_string(d == 0 ? tunnel->b_id : tunnel->a_id);
+                const std::atomic<uint64_t>* fields[] = { &dir.bytes, &dir.chunks, &dir.partial_sends, &dir.queued_bytes };
+                append_sample(out, name, "src=\"" + src + "\",dst=\"" + dst + "\"",
+                              fields[metric]->load(std::memory_order_relaxed));
+            }
+        }
+    }
+    append_header(out, "relay_tunnel_forward_latency_p99_seconds", "gauge", "Oturumun aktarım gecikmesinin 99. yüzdelik dilimi.");
+    for (const auto& tunnel : tunnels_) {
+        LatencyHistogram::Snapshot snapshot;
+        tunnel->forward_latency.add_to(&snapshot);
+        append_sample(out, "relay_tunnel_forward_latency_p99_seconds",
+                      "a=\"" + std::to_string(tunnel->a_id) + "\",b=\"" + std::to_string(tunnel->b_id) + "\"", snapshot.quantile(0.99) / 1e9);
+    }
+    return out;
+}
+
+// --- HTTP sunucusu ---
+
+namespace {
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Tek bir isteği okur ve yanıtlar. Prometheus her çekimde yeni bağlantı açabilir; bağlantı
+// yanıttan sonra kapatılır (HTTP/1.0).
+void serve_request(int fd) {
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        request.append(buffer, n);
+    }
+
+    std::string line = request.substr(0, request.find("\r\n"));
+    std::string status, body;
+    if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0) {
+        status = "200 OK";
+        body = relay_metrics.render();
+    } else {
+        status = "404 Not Found";
+        body = "Yalnızca GET /metrics desteklenir.\n";
+    }
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    send_all(fd, response);
+}
+
+} // namespace
+
+bool metrics_start_server(int port) {
+    int listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        LOG(LOG_ERROR) << "Ölçüm soketi oluşturulamadı: " << strerror(errno);
+        return false;
+    }
+    int opt = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Yalnızca yerel erişim
+    address.sin_port = htons(port);
+    if (::bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0 || ::listen(listen_fd, 16) < 0) {
+        LOG(LOG_ERROR) << "Ölçüm portu açılamadı (" << port << "): " << strerror(errno);
+        ::close(listen_fd);
+        return false;
+    }
+
+    std::thread([listen_fd]() {
+        log_set_thread_name("metrics");
+        while (true) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                LOG_RATE_LIMITED(LOG_WARN, 1) << "Ölçüm bağlantısı kabul edilemedi: " << strerror(errno);
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            // Yanıt vermeyen bir istemci ölçüm thread'ini sonsuza kadar bekletmesin
+            struct timeval timeout = {2, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            serve_request(fd);
+            ::close(fd);
+        }
+    }).detach();
+    return true;
+}
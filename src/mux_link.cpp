@@ -0,0 +1,422 @@
+#include "mux_link.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+// Kredi, alıcıda pencerenin bu kadarı tüketilince iade edilir (küçük iadelerle bağlantıyı doldurmamak için)
+static const uint64_t MUX_WINDOW_UPDATE_THRESHOLD = MUX_INITIAL_WINDOW / 4;
+// Relay soketinden ve yerel uçlardan okuma başına en fazla byte
+static const size_t MUX_READ_CHUNK = 64 * 1024;
+
+bool parse_mux_header(const char* data, MuxHeader* header) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    if (bytes[0] != MUX_MAGIC_V1 || bytes[1] >= MUX_CHANNEL_COUNT || bytes[2] > MUX_RESET) return false;
+    uint32_t length = ((uint32_t)bytes[4] << 24) | ((uint32_t)bytes[5] << 16) | ((uint32_t)bytes[6] << 8) | bytes[7];
+    if (length > MUX_MAX_PAYLOAD) return false;
+    header->channel = bytes[1];
+    header->type = static_cast<MuxFrameType>(bytes[2]);
+    header->length = length;
+    return true;
+}
+
+void encode_mux_header(uint8_t channel, MuxFrameType type, uint32_t length, char* out) {
+    out[0] = (char)MUX_MAGIC_V1;
+    out[1] = (char)channel;
+    out[2] = (char)type;
+    out[3] = 0;
+    out[4] = (char)(length >> 24);
+    out[5] = (char)(length >> 16);
+    out[6] = (char)(length >> 8);
+    out[7] = (char)(length & 0xff);
+}
+
+void append_mux_frames(std::string* out, uint8_t channel, MuxFrameType type, const char* payload, size_t length) {
+    do {
+        size_t part = std::min(length, MUX_MAX_PAYLOAD);
+        char header[MUX_HEADER_SIZE];
+        encode_mux_header(channel, type, (uint32_t)part, header);
+        out->append(header, sizeof(header));
+        out->append(payload, part);
+        payload += part;
+        length -= part;
+    } while (length > 0);
+}
+
+const char* mux_channel_name(uint8_t channel) {
+    switch (channel) {
+        case MUX_CHANNEL_CONTROL: return "kontrol";
+        case MUX_CHANNEL_INPUT: return "giriş";
+        case MUX_CHANNEL_RFB: return "RFB";
+        case MUX_CHANNEL_BULK: return "toplu";
+    }
+    return "?";
+}
+
+static void set_nonblocking(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static bool would_block(ssize_t n) {
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+MuxBridge::MuxBridge(int net_fd, const std::string& initial)
+    : net_fd_(net_fd), wake_fd_(-1), control_app_fd_(-1), in_(initial) {
+    int pair[2];
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0 || ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        int error = errno;
+        if (wake_fd_ >= 0) ::close(wake_fd_);
+        ::close(net_fd_);
+        throw std::system_error(error, std::generic_category(), "mux");
+    }
+    set_nonblocking(net_fd_);
+    // TLS köprüsünün Unix soketinde desteklenmez; o durumda önceliği yalnızca çerçeve sırası belirler
+    int lowat = MUX_NOTSENT_LOWAT;
+    ::setsockopt(net_fd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+
+    set_nonblocking(pair[1]);
+    control_app_fd_ = pair[0];
+    endpoints_[0].fd = pair[1];
+    endpoints_[0].readable = true;
+    channels_[MUX_CHANNEL_CONTROL].sender = 0;
+    channels_[MUX_CHANNEL_CONTROL].receiver = 0;
+}
+
+MuxBridge::~MuxBridge() {
+    for (int i = 0; i < (int)(sizeof(endpoints_) / sizeof(endpoints_[0])); ++i) close_endpoint(i);
+    if (control_app_fd_ >= 0) ::close(control_app_fd_);
+    ::close(wake_fd_);
+    ::close(net_fd_);
+}
+
+int MuxBridge::take_control_fd() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int fd = control_app_fd_;
+    control_app_fd_ = -1;
+    return fd;
+}
+
+int MuxBridge::open_stream(uint8_t send_channel, uint8_t receive_channel) {
+    if (send_channel == MUX_CHANNEL_CONTROL || receive_channel == MUX_CHANNEL_CONTROL ||
+        send_channel >= MUX_CHANNEL_COUNT || receive_channel >= MUX_CHANNEL_COUNT) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_ || failed_ || net_eof_) return -1;
+    if (channels_[send_channel].sender >= 0) close_endpoint(channels_[send_channel].sender);
+    if (channels_[receive_channel].receiver >= 0) close_endpoint(channels_[receive_channel].receiver);
+
+    int slot = -1;
+    for (int i = 1; i < (int)(sizeof(endpoints_) / sizeof(endpoints_[0])); ++i) {
+        if (endpoints_[i].fd < 0) {
+            slot = i;
+            break;
+        }
+    }
+    int pair[2];
+    if (slot < 0 || ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return -1;
+    set_nonblocking(pair[1]);
+    Endpoint& endpoint = endpoints_[slot];
+    endpoint = Endpoint();
+    endpoint.fd = pair[1];
+    endpoint.send_channel = send_channel;
+    endpoint.receive_channel = receive_channel;
+    endpoint.readable = true;
+    channels_[send_channel].sender = slot;
+    channels_[receive_channel].receiver = slot;
+
+    // Köprü thread'i poll'da bekliyor olabilir; yeni uç ve bekleyen gelen veri için uyandırılır
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    return pair[0];
+}
+
+void MuxBridge::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+// Ucu kapatır ve kanallardan ayırır. Uygulama kendi ucunda EOF görür.
+void MuxBridge::close_endpoint(int index) {
+    Endpoint& endpoint = endpoints_[index];
+    if (endpoint.fd < 0) return;
+    ::close(endpoint.fd);
+    for (Channel& channel : channels_) {
+        if (channel.sender == index) channel.sender = -1;
+        if (channel.receiver == index) channel.receiver = -1;
+    }
+    endpoint = Endpoint();
+}
+
+void MuxBridge::queue_signal(uint8_t channel, MuxFrameType type, uint32_t value, bool with_value) {
+    char frame[MUX_HEADER_SIZE + 4];
+    encode_mux_header(channel, type, with_value ? 4 : 0, frame);
+    frame[8] = (char)(value >> 24);
+    frame[9] = (char)(value >> 16);
+    frame[10] = (char)(value >> 8);
+    frame[11] = (char)(value & 0xff);
+    signals_.append(frame, with_value ? sizeof(frame) : MUX_HEADER_SIZE);
+}
+
+// Relay bir tüneli açarken veya kapatırken: veri kanallarının akışları ve bekleyen verisi atılır
+void MuxBridge::reset_channels() {
+    for (uint8_t ch = MUX_CHANNEL_INPUT; ch < MUX_CHANNEL_COUNT; ++ch) {
+        if (channels_[ch].sender >= 0) close_endpoint(channels_[ch].sender);
+        if (channels_[ch].receiver >= 0) close_endpoint(channels_[ch].receiver);
+        channels_[ch] = Channel();
+    }
+    // Önceki tünelin kredi iadeleri ve henüz gönderilmeye başlanmamış veri çerçevesi de geçersizdir;
+    // yarısı gönderilmiş çerçeve ise sınır korunsun diye tamamlanır (relay onu komut modunda atar)
+    std::string control;
+    for (size_t off = 0; off + MUX_HEADER_SIZE <= signals_.size();) {
+        MuxHeader header;
+        parse_mux_header(signals_.data() + off, &header);
+        size_t frame = MUX_HEADER_SIZE + header.length;
+        if (header.channel == MUX_CHANNEL_CONTROL) control.append(signals_, off, frame);
+        off += frame;
+    }
+    signals_.swap(control);
+    if (out_off_ == 0 && out_.size() >= MUX_HEADER_SIZE && out_[1] != (char)MUX_CHANNEL_CONTROL) out_.clear();
+}
+
+bool MuxBridge::handle_frame(const MuxHeader& header, const char* payload) {
+    Channel& channel = channels_[header.channel];
+    switch (header.type) {
+    case MUX_DATA:
+        // Gönderen krediye uymalı; uymazsa bekleyen veri sınırsız büyümesin
+        if (header.channel != MUX_CHANNEL_CONTROL &&
+            channel.inbound.size() - channel.inbound_off + header.length > MUX_INITIAL_WINDOW) {
+            return false;
+        }
+        channel.inbound.append(payload, header.length);
+        return true;
+    case MUX_WINDOW:
+        if (header.length == 4) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(payload);
+            channel.send_window += ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+        }
+        return true;
+    case MUX_CLOSE:
+        channel.remote_closed = true;
+        return true;
+    case MUX_RESET:
+        if (header.channel == MUX_CHANNEL_CONTROL) reset_channels();
+        return true;
+    }
+    return true;
+}
+
+bool MuxBridge::read_net() {
+    char buffer[MUX_READ_CHUNK];
+    ssize_t n = ::read(net_fd_, buffer, sizeof(buffer));
+    if (n == 0) {
+        net_eof_ = true;
+    } else if (n < 0) {
+        if (!would_block(n)) {
+            failed_ = true;
+            return false;
+        }
+    } else {
+        in_.append(buffer, n);
+    }
+    // Okuma beklese de in_'deki çerçeveler işlenir: "MUX_OK" ile aynı okumada gelmiş (initial) olabilirler
+
+    size_t off = 0;
+    while (in_.size() - off >= MUX_HEADER_SIZE) {
+        MuxHeader header;
+        if (!parse_mux_header(in_.data() + off, &header)) {
+            failed_ = true; // Çerçeve sınırı kaybedildi
+            return false;
+        }
+        if (in_.size() - off < MUX_HEADER_SIZE + header.length) break;
+        if (!handle_frame(header, in_.data() + off + MUX_HEADER_SIZE)) {
+            failed_ = true;
+            return false;
+        }
+        off += MUX_HEADER_SIZE + header.length;
+    }
+    in_.erase(0, off);
+    return n > 0;
+}
+
+// Kanalın bekleyen verisini alıcı uca yazar; yazılanlar için krediyi iade eder
+void MuxBridge::deliver(uint8_t ch) {
+    Channel& channel = channels_[ch];
+    if (channel.receiver < 0) return;
+    Endpoint& endpoint = endpoints_[channel.receiver];
+    while (channel.inbound_off < channel.inbound.size()) {
+        ssize_t n = ::send(endpoint.fd, channel.inbound.data() + channel.inbound_off,
+                           channel.inbound.size() - channel.inbound_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            channel.inbound_off += n;
+            channel.credit += n;
+            continue;
+        }
+        if (would_block(n)) break;
+        // Uygulama ucunu kapattı; kanal sonraki akışa kadar kullanılmaz
+        close_endpoint(channel.receiver);
+        break;
+    }
+    if (channel.inbound_off == channel.inbound.size()) {
+        channel.inbound.clear();
+        channel.inbound_off = 0;
+    }
+    if (ch != MUX_CHANNEL_CONTROL && channel.credit >= MUX_WINDOW_UPDATE_THRESHOLD) {
+        queue_signal(ch, MUX_WINDOW, (uint32_t)channel.credit, true);
+        channel.credit = 0;
+    }
+    if (channel.receiver >= 0 && channel.remote_closed && channel.inbound.empty()) {
+        Endpoint& receiver = endpoints_[channel.receiver];
+        if (!receiver.write_shut) {
+            ::shutdown(receiver.fd, SHUT_WR);
+            receiver.write_shut = true;
+        }
+    }
+}
+
+// Gönderilecek bir sonraki çerçeveyi out_'a hazırlar: önce kredi iadeleri ve kapanışlar, sonra
+// verisi olan en yüksek öncelikli kanal. Gönderilecek bir şey yoksa false.
+bool MuxBridge::next_frame() {
+    while (true) {
+        if (!signals_.empty()) {
+            out_.swap(signals_);
+            signals_.clear();
+            return true;
+        }
+        bool closed_any = false;
+        for (uint8_t ch = 0; ch < MUX_CHANNEL_COUNT; ++ch) {
+            Channel& channel = channels_[ch];
+            if (channel.sender < 0) continue;
+            Endpoint& endpoint = endpoints_[channel.sender];
+            if (endpoint.read_eof || !endpoint.readable) continue;
+            size_t room = ch == MUX_CHANNEL_CONTROL ? MUX_MAX_PAYLOAD
+                                                    : (size_t)std::min<uint64_t>(MUX_MAX_PAYLOAD, channel.send_window);
+            if (room == 0) continue;
+            out_.resize(MUX_HEADER_SIZE + room);
+            ssize_t n = ::read(endpoint.fd, &out_[MUX_HEADER_SIZE], room);
+            if (n > 0) {
+                encode_mux_header(ch, MUX_DATA, (uint32_t)n, &out_[0]);
+                out_.resize(MUX_HEADER_SIZE + n);
+                if (ch != MUX_CHANNEL_CONTROL) channel.send_window -= n;
+                return true;
+            }
+            out_.clear();
+            if (would_block(n)) {
+                endpoint.readable = false;
+                continue;
+            }
+            // Uygulama yazma yönünü kapattı (veya hata): karşı uca kapanış bildirilir
+            endpoint.read_eof = true;
+            if (ch != MUX_CHANNEL_CONTROL) {
+                queue_signal(ch, MUX_CLOSE, 0, false);
+                closed_any = true;
+            }
+        }
+        if (!closed_any) return false;
+    }
+}
+
+bool MuxBridge::send_net() {
+    bool progress = false;
+    while (true) {
+        if (out_off_ == out_.size()) {
+            out_.clear();
+            out_off_ = 0;
+            if (!next_frame()) return progress;
+        }
+        ssize_t n = ::send(net_fd_, out_.data() + out_off_, out_.size() - out_off_, MSG_NOSIGNAL);
+        if (n > 0) {
+            out_off_ += n;
+            progress = true;
+            continue;
+        }
+        if (!would_block(n)) failed_ = true;
+        return progress;
+    }
+}
+
+bool MuxBridge::pump() {
+    bool progress = true;
+    while (progress && !failed_ && !stopped_) {
+        progress = false;
+        if (!net_eof_ && read_net()) progress = true;
+        for (uint8_t ch = 0; ch < MUX_CHANNEL_COUNT; ++ch) {
+            size_t before = channels_[ch].inbound.size() - channels_[ch].inbound_off;
+            deliver(ch);
+            if (channels_[ch].inbound.size() - channels_[ch].inbound_off != before) progress = true;
+        }
+        if (!failed_ && send_net()) progress = true;
+    }
+    if (failed_ || stopped_ || net_eof_) return false;
+    // Uygulama kontrol ucunu kapattı ve kalan her şey gönderildi
+    return !(endpoints_[0].read_eof && out_off_ == out_.size() && signals_.empty());
+}
+
+void MuxBridge::run() {
+    const int max_endpoints = (int)(sizeof(endpoints_) / sizeof(endpoints_[0]));
+    struct pollfd fds[2 + max_endpoints];
+    int polled[max_endpoints]; // fds[2 + i] hangi uç
+    while (true) {
+        int count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!pump()) break;
+            fds[0].fd = net_fd_;
+            fds[0].events = (net_eof_ ? 0 : POLLIN) | (out_off_ < out_.size() ? POLLOUT : 0);
+            fds[1].fd = wake_fd_;
+            fds[1].events = POLLIN;
+            count = 2;
+            for (int i = 0; i < max_endpoints; ++i) {
+                const Endpoint& endpoint = endpoints_[i];
+                if (endpoint.fd < 0) continue;
+                short events = 0;
+                const Channel& out_channel = channels_[endpoint.send_channel];
+                if (out_channel.sender == i && !endpoint.read_eof && !endpoint.readable &&
+                    (endpoint.send_channel == MUX_CHANNEL_CONTROL || out_channel.send_window > 0)) {
+                    events |= POLLIN;
+                }
+                const Channel& in_channel = channels_[endpoint.receive_channel];
+                if (in_channel.receiver == i && in_channel.inbound_off < in_channel.inbound.size()) events |= POLLOUT;
+                // Beklenen olayı olmayan uç dışarıda bırakılır (kapanmış ucun POLLHUP'ı poll'u sürekli uyandırır)
+                if (events == 0) continue;
+                polled[count - 2] = i;
+                fds[count].fd = endpoint.fd;
+                fds[count].events = events;
+                ++count;
+            }
+        }
+        if (::poll(fds, count, -1) < 0 && errno != EINTR) break;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            ssize_t ignored = ::read(wake_fd_, &value, sizeof(value));
+            (void)ignored;
+        }
+        for (int k = 2; k < count; ++k) {
+            // Uç poll sırasında open_stream ile değiştirilmiş olabilir
+            Endpoint& endpoint = endpoints_[polled[k - 2]];
+            if (endpoint.fd == fds[k].fd && (fds[k].revents & (POLLIN | POLLHUP | POLLERR))) endpoint.readable = true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true; // Bundan sonra open_stream -1 döner
+    for (int i = 0; i < max_endpoints; ++i) close_endpoint(i);
+    ::shutdown(net_fd_, SHUT_RDWR);
+}
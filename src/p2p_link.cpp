@@ -0,0 +1,429 @@
+#include "p2p_link.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+static const size_t MAX_PACKET = 1 + 4 + P2P_SEGMENT_BYTES;
+static const int UDP_BUFFER_BYTES = 4 * 1024 * 1024;
+static const size_t COMPACT_BYTES = 1024 * 1024; // Tamponun okunmuş başı bu kadarı geçince silinir
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void put32(char* p, uint32_t v) {
+    p[0] = (char)(v >> 24); p[1] = (char)(v >> 16); p[2] = (char)(v >> 8); p[3] = (char)v;
+}
+static uint32_t get32(const char* p) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+    return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+}
+static void put64(char* p, uint64_t v) { put32(p, (uint32_t)(v >> 32)); put32(p + 4, (uint32_t)v); }
+static uint64_t get64(const char* p) { return (uint64_t)get32(p) << 32 | get32(p + 4); }
+
+bool parse_udp_address(const std::string& text, struct sockaddr_in* addr) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) return false;
+    const std::string port = text.substr(colon + 1);
+    if (port.empty() || port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos) return false;
+    int number = std::stoi(port);
+    if (number == 0 || number > 65535) return false;
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((uint16_t)number);
+    return inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr->sin_addr) == 1;
+}
+
+std::string format_udp_address(const struct sockaddr_in& addr) {
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+// --- HolePuncher ---
+
+HolePuncher::HolePuncher(const std::string& id) : fd_(-1), id_(id) {
+    memset(&rendezvous_, 0, sizeof(rendezvous_));
+    memset(&peer_, 0, sizeof(peer_));
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "socket");
+    int buffer_size = UDP_BUFFER_BYTES;
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    struct sockaddr_in any;
+    memset(&any, 0, sizeof(any));
+    any.sin_family = AF_INET;
+    if (::bind(fd_, (struct sockaddr*)&any, sizeof(any)) < 0) {
+        int err = errno;
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "bind");
+    }
+}
+
+HolePuncher::~HolePuncher() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+std::string HolePuncher::local_candidate(int control_fd) const {
+    struct sockaddr_in local, udp_local;
+    socklen_t len = sizeof(local);
+    memset(&local, 0, sizeof(local));
+    ::getsockname(control_fd, (struct sockaddr*)&local, &len);
+    len = sizeof(udp_local);
+    ::getsockname(fd_, (struct sockaddr*)&udp_local, &len);
+    local.sin_port = udp_local.sin_port;
+    return format_udp_address(local);
+}
+
+bool HolePuncher::on_bind(const std::string& relay_ip, const std::string& argument) {
+    int udp_port = 0;
+    std::istringstream(argument) >> token_ >> udp_port;
+    if (token_.empty() || udp_port <= 0 || udp_port > 65535) return false;
+    if (!parse_udp_address(relay_ip + ":" + std::to_string(udp_port), &rendezvous_)) return false;
+    have_rendezvous_ = true;
+    next_send_ms_ = 0;
+    return true;
+}
+
+bool HolePuncher::on_candidates(const std::string& argument) {
+    if (have_candidates_) return true;
+    std::istringstream fields(argument);
+    fields >> key_;
+    std::string text;
+    struct sockaddr_in addr;
+    while (fields >> text) {
+        if (parse_udp_address(text, &addr)) candidates_.push_back(addr);
+    }
+    if (key_.empty() || candidates_.empty()) return false;
+    have_candidates_ = true;
+    next_send_ms_ = 0; // İlk PUNCH beklemeden gider
+    on_timer();
+    return true;
+}
+
+int HolePuncher::timeout_ms() const {
+    if (!have_rendezvous_ || punched_) return 1000;
+    return (int)std::max<int64_t>(0, next_send_ms_ - now_ms());
+}
+
+void HolePuncher::on_timer() {
+    int64_t now = now_ms();
+    if (!have_rendezvous_ || punched_ || now < next_send_ms_) return;
+    // UDP kayıplı: BIND yanıt gelene kadar, PUNCH doğrudan yol bulunana kadar yinelenir
+    if (!mapped_) send_text(rendezvous_, "WRB1 BIND " + token_);
+    for (const auto& candidate : candidates_) send_text(candidate, "WRB1 PUNCH " + key_ + " " + id_);
+    next_send_ms_ = now + (have_candidates_ ? 50 : 200);
+}
+
+bool HolePuncher::on_readable() {
+    char packet[MAX_PACKET + 1];
+    while (!punched_) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = ::recvfrom(fd_, packet, sizeof(packet) - 1, MSG_DONTWAIT | MSG_PEEK, (struct sockaddr*)&from, &from_len);
+        if (n < 0) break;
+        // Eşin ilk veri paketi onaydan önce gelebilir; yol açıktır ve paket akışa bırakılır
+        if (have_candidates_ && (n < 4 || memcmp(packet, "WRB1", 4) != 0)) {
+            punched_ = true;
+            peer_ = from;
+            break;
+        }
+        ::recv(fd_, packet, 0, MSG_DONTWAIT);
+        packet[n] = '\0';
+        std::istringstream fields(std::string(packet, n));
+        std::string magic, word, packet_key;
+        fields >> magic >> word >> packet_key;
+        if (magic != "WRB1") continue;
+        if (word == "MAPPED") {
+            mapped_ = true;
+        } else if (word == "PUNCH" && have_candidates_ && packet_key == key_) {
+            // Eşin paketi NAT'tan geçti; onay aynı adrese gider (eşin NAT'ında delik açık)
+            send_text(from, "WRB1 PUNCHACK " + key_ + " " + id_);
+        } else if (word == "PUNCHACK" && have_candidates_ && packet_key == key_) {
+            punched_ = true;
+            peer_ = from;
+        }
+    }
+    return punched_;
+}
+
+bool HolePuncher::answer_punch(int fd, const std::string& key, const std::string& id, const char* packet, size_t n,
+                               const struct sockaddr_in& from) {
+    if (n < 11 || memcmp(packet, "WRB1 ", 5) != 0) return false;
+    if (memcmp(packet, "WRB1 PUNCH ", 11) == 0 && std::string(packet, n).find(" " + key + " ") != std::string::npos) {
+        std::string ack = "WRB1 PUNCHACK " + key + " " + id;
+        ::sendto(fd, ack.data(), ack.size(), MSG_DONTWAIT, (const struct sockaddr*)&from, sizeof(from));
+    }
+    return true; // Diğer WRB1 paketleri (geç gelen PUNCHACK, MAPPED) yok sayılır
+}
+
+void HolePuncher::send_text(const struct sockaddr_in& to, const std::string& text) {
+    ::sendto(fd_, text.data(), text.size(), MSG_DONTWAIT, (const struct sockaddr*)&to, sizeof(to));
+}
+
+// --- UdpStream ---
+
+UdpStream::UdpStream(int fd, const struct sockaddr_in& peer, const std::string& key, const std::string& id,
+                     size_t buffer_bytes)
+    : fd_(fd), peer_(peer), key_(key), id_(id), buffer_bytes_(buffer_bytes), rng_(7) {
+    int64_t now = now_ms();
+    last_progress_ = now;
+    last_heard_ = now;
+    last_sent_ = 0; // İlk onay pencereyi hemen bildirir
+}
+
+size_t UdpStream::writable() const {
+    size_t pending = send_buffer_.size() - send_head_;
+    return finishing_ || pending >= buffer_bytes_ ? 0 : buffer_bytes_ - pending;
+}
+
+size_t UdpStream::write(const char* data, size_t len) {
+    size_t n = std::min(len, writable());
+    if (n == 0) return 0;
+    send_buffer_.append(data, n);
+    send_segments(now_ms());
+    return n;
+}
+
+size_t UdpStream::read(char* out, size_t len) {
+    size_t n = std::min(len, readable());
+    memcpy(out, receive_buffer_.data() + receive_head_, n);
+    receive_head_ += n;
+    if (receive_head_ == receive_buffer_.size()) {
+        receive_buffer_.clear();
+        receive_head_ = 0;
+    } else if (receive_head_ > COMPACT_BYTES && receive_head_ * 2 > receive_buffer_.size()) {
+        receive_buffer_.erase(0, receive_head_);
+        receive_head_ = 0;
+    }
+    // Tampon dolduğu için küçülen pencere açıldıysa eş beklemeden haberdar edilir
+    if (n > 0 && advertised_window_ * 2 < receive_window()) send_ack(now_ms());
+    return n;
+}
+
+void UdpStream::finish() {
+    if (finishing_) return;
+    finishing_ = true;
+    send_segments(now_ms());
+}
+
+uint32_t UdpStream::receive_window() const {
+    // Sıra dışı parçalar sayılmaz: pencere onlarla değişseydi yinelenen onaylar tanınmazdı
+    size_t free = buffer_bytes_ > readable() ? buffer_bytes_ - readable() : 0;
+    return (uint32_t)std::min<size_t>(free / P2P_SEGMENT_BYTES, 4 * P2P_MAX_WINDOW);
+}
+
+void UdpStream::send_packet(const char* data, size_t n, int64_t now) {
+    ::sendto(fd_, data, n, MSG_DONTWAIT, (const struct sockaddr*)&peer_, sizeof(peer_));
+    last_sent_ = now;
+}
+
+void UdpStream::send_ack(int64_t now) {
+    char ack[9];
+    ack[0] = 'A';
+    put32(ack + 1, peer_fin_ ? fin_segments_ + 1 : expected_);
+    advertised_window_ = receive_window();
+    put32(ack + 5, advertised_window_);
+    send_packet(ack, sizeof(ack), now);
+}
+
+void UdpStream::transmit(uint32_t seq, int64_t now) {
+    Segment& segment = segments_[seq - base_];
+    if (segment.sent_at != 0) {
+        segment.resent = true;
+        ++retransmits_;
+    }
+    segment.sent_at = now;
+    char packet[MAX_PACKET];
+    packet[0] = 'D';
+    put32(packet + 1, seq);
+    memcpy(packet + 5, send_buffer_.data() + send_head_ + (segment.offset - send_base_), segment.length);
+    if (drop_rate_ > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < drop_rate_) return;
+    send_packet(packet, 5 + segment.length, now);
+}
+
+void UdpStream::send_segments(int64_t now) {
+    uint32_t window = std::min((uint32_t)cwnd_, peer_window_);
+    while (next_ - base_ < window) {
+        if (next_ - base_ == segments_.size()) {
+            // Yeni parça gönderilmemiş veriden kesilir
+            uint64_t cut = segments_.empty() ? send_base_ : segments_.back().offset + segments_.back().length;
+            uint64_t unsent = bytes_written() - cut;
+            if (unsent == 0) break;
+            if (segments_.empty()) last_progress_ = now; // Boşta beklenen süre ilerlemesizlik sayılmaz
+            segments_.push_back({cut, (uint32_t)std::min<uint64_t>(unsent, P2P_SEGMENT_BYTES), 0, false});
+        }
+        transmit(next_++, now);
+    }
+    if (finishing_ && !fin_acked_ && fin_sent_ == 0 && segments_.empty() && bytes_written() == send_base_) {
+        last_progress_ = now;
+        send_fin(now);
+    }
+}
+
+void UdpStream::send_fin(int64_t now) {
+    char fin[13];
+    fin[0] = 'F';
+    put32(fin + 1, base_);
+    put64(fin + 5, send_base_);
+    send_packet(fin, sizeof(fin), now);
+    fin_sent_ = now;
+}
+
+void UdpStream::on_ack(uint32_t ack, uint32_t window, int64_t now) {
+    if (fin_sent_ != 0 && segments_.empty() && ack == base_ + 1) { // Bitiş onayı
+        fin_acked_ = true;
+        last_progress_ = now;
+        return;
+    }
+    if (ack < base_ || ack > base_ + segments_.size()) return;
+    bool window_changed = window != peer_window_;
+    bool reopened = peer_window_ == 0 && window > 0;
+    peer_window_ = window;
+    if (ack == base_) {
+        // Pencere açıldıysa dolu tampon yüzünden düşen parçalar beklemeden yeniden gönderilir
+        if (reopened) next_ = base_;
+        // Yinelenen onay: üçüncüsünde kayıp parça beklemeden yeniden gönderilir
+        if (!window_changed && base_ < next_ && ++dup_acks_ == 3 && base_ >= recover_) {
+            recover_ = next_;
+            transmit(base_, now);
+            ssthresh_ = std::max(cwnd_ / 2, 4.0);
+            cwnd_ = ssthresh_;
+        }
+        return;
+    }
+    const Segment& last = segments_[ack - base_ - 1];
+    if (!last.resent && last.sent_at != 0) {
+        double sample = (double)(now - last.sent_at);
+        if (!rtt_sampled_) {
+            rtt_sampled_ = true;
+            srtt_ = sample;
+            rttvar_ = sample / 2;
+        } else {
+            rttvar_ = 0.75 * rttvar_ + 0.25 * std::fabs(srtt_ - sample);
+            srtt_ = 0.875 * srtt_ + 0.125 * sample;
+        }
+    }
+    for (; base_ < ack; ++base_) {
+        send_base_ += segments_.front().length;
+        send_head_ += segments_.front().length;
+        segments_.pop_front();
+        cwnd_ = cwnd_ < ssthresh_ ? cwnd_ + 1 : cwnd_ + 1 / cwnd_;
+    }
+    cwnd_ = std::min<double>(cwnd_, P2P_MAX_WINDOW);
+    if (send_head_ == send_buffer_.size()) {
+        send_buffer_.clear();
+        send_head_ = 0;
+    } else if (send_head_ > COMPACT_BYTES && send_head_ * 2 > send_buffer_.size()) {
+        send_buffer_.erase(0, send_head_);
+        send_head_ = 0;
+    }
+    if (next_ < base_ || reopened) next_ = base_;
+    dup_acks_ = 0;
+    last_progress_ = now;
+    if (rtt_sampled_) rto_ = std::min(std::max(srtt_ + 4 * rttvar_, 20.0), 2000.0); // Geri çekilme sona erer
+    // Kurtarma sırasındaki kısmi onay: sıradaki kayıp parça da hemen yeniden gönderilir (NewReno)
+    if (base_ < recover_ && base_ < next_) transmit(base_, now);
+}
+
+void UdpStream::on_data(uint32_t seq, const char* data, size_t n) {
+    if (seq < expected_ || seq >= fin_segments_) return; // Yinelenen parça; onay yine gider
+    // Tampon dolu: parça düşer, onaydaki pencere göndereni durdurur
+    if (seq - expected_ >= receive_window()) return;
+    if (seq != expected_) {
+        out_of_order_.emplace(seq, std::string(data, n));
+        return;
+    }
+    receive_buffer_.append(data, n);
+    received_bytes_ += n;
+    ++expected_;
+    for (auto it = out_of_order_.begin(); it != out_of_order_.end() && it->first <= expected_;
+         it = out_of_order_.erase(it)) {
+        if (it->first != expected_) continue;
+        receive_buffer_.append(it->second);
+        received_bytes_ += it->second.size();
+        ++expected_;
+    }
+    if (expected_ == fin_segments_) peer_fin_ = true;
+}
+
+void UdpStream::on_readable() {
+    char packet[MAX_PACKET];
+    int64_t now = now_ms();
+    while (true) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = ::recvfrom(fd_, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr*)&from, &from_len);
+        if (n < 0) break;
+        if (HolePuncher::answer_punch(fd_, key_, id_, packet, n, from)) continue;
+        if (n == 9 && packet[0] == 'A') {
+            on_ack(get32(packet + 1), get32(packet + 5), now);
+        } else if (n > 5 && packet[0] == 'D') {
+            on_data(get32(packet + 1), packet + 5, n - 5);
+            send_ack(now);
+        } else if (n == 13 && packet[0] == 'F') {
+            if (fin_segments_ == UINT32_MAX) {
+                fin_segments_ = get32(packet + 1);
+                fin_total_ = get64(packet + 5);
+                if (expected_ == fin_segments_) peer_fin_ = true;
+            }
+            send_ack(now);
+        } else {
+            continue;
+        }
+        // Eş başka bir adayından gönderiyor olabilir; yanıtlar son paketin geldiği adrese gider
+        peer_ = from;
+        last_heard_ = now;
+    }
+    send_segments(now);
+}
+
+void UdpStream::on_timer() {
+    int64_t now = now_ms();
+    // Zaman aşımı: onaylanmamış parçalar küçülen pencereyle baştan yeniden gönderilir (go-back-N)
+    if (base_ < next_ && now - segments_.front().sent_at > (int64_t)rto_) {
+        next_ = base_;
+        ssthresh_ = std::max(cwnd_ / 2, 4.0);
+        cwnd_ = 4;
+        rto_ = std::min(rto_ * 2, 2000.0);
+        recover_ = 0;
+    }
+    if (fin_sent_ != 0 && !fin_acked_ && now - fin_sent_ >= (int64_t)rto_) {
+        send_fin(now);
+        ++retransmits_;
+    }
+    send_segments(now);
+    if (now - last_sent_ >= P2P_KEEPALIVE_MS) send_ack(now);
+}
+
+int UdpStream::timeout_ms() const {
+    int64_t now = now_ms();
+    int64_t deadline = std::min(last_sent_ + P2P_KEEPALIVE_MS, last_heard_ + P2P_SILENCE_MS + 1);
+    if (base_ < next_) deadline = std::min(deadline, segments_.front().sent_at + (int64_t)rto_ + 1);
+    if (fin_sent_ != 0 && !fin_acked_) deadline = std::min(deadline, fin_sent_ + (int64_t)rto_);
+    return (int)std::max<int64_t>(0, std::min<int64_t>(deadline - now, 1000));
+}
+
+bool UdpStream::broken() const {
+    int64_t now = now_ms();
+    if (now - last_heard_ > P2P_SILENCE_MS) return true;
+    // Eş canlı ama gönderilen veri onaylanmıyor (tamponu dolu olduğunu bildirmediyse)
+    bool outstanding = !segments_.empty() || (fin_sent_ != 0 && !fin_acked_);
+    return outstanding && peer_window_ > 0 && now - last_progress_ > P2P_SILENCE_MS;
+}
+
+bool UdpStream::unacked_from(uint64_t offset, std::string* out) const {
+    if (offset < send_base_ || offset > bytes_written()) return false;
+    out->assign(send_buffer_, send_head_ + (size_t)(offset - send_base_), std::string::npos);
+    return true;
+}
@@ -0,0 +1,123 @@
+#include "rendezvous.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "logger.h"
+
+static const char BIND_PREFIX[] = "WRB1 BIND ";
+static const size_t MAX_DATAGRAM = 512;
+
+bool parse_p2p_candidates(std::string_view argument, std::string* candidates) {
+    std::istringstream fields{std::string(argument)};
+    std::string candidate;
+    size_t count = 0;
+    candidates->clear();
+    while (fields >> candidate) {
+        size_t colon = candidate.rfind(':');
+        struct in_addr addr;
+        if (colon == std::string::npos || ++count > P2P_MAX_CANDIDATES ||
+            ::inet_pton(AF_INET, candidate.substr(0, colon).c_str(), &addr) != 1) {
+            return false;
+        }
+        const std::string port = candidate.substr(colon + 1);
+        if (port.empty() || port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoi(port) == 0 || std::stoi(port) > 65535) {
+            return false;
+        }
+        if (!candidates->empty()) *candidates += ' ';
+        *candidates += candidate;
+    }
+    return true;
+}
+
+std::string prepend_observed_candidate(const std::string& observed, const std::string& candidates) {
+    std::string ordered = observed;
+    std::istringstream fields(candidates);
+    std::string local;
+    while (fields >> local) {
+        if (local != observed) ordered += " " + local;
+    }
+    return ordered;
+}
+
+RendezvousServer::RendezvousServer(EventLoop& loop, int port, BoundHandler on_bound)
+    : loop_(loop), fd_(-1), port_(port), on_bound_(std::move(on_bound)) {
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if (::bind(fd_, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        int err = errno;
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "bind");
+    }
+    if (!loop_.add(fd_, EPOLLIN, [this](uint32_t) { on_readable(); })) {
+        int err = errno;
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "epoll_ctl");
+    }
+}
+
+RendezvousServer::~RendezvousServer() {
+    loop_.remove(fd_);
+    ::close(fd_);
+}
+
+void RendezvousServer::expect(const std::string& token, ClientId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bindings_[token] = Binding{id, false};
+}
+
+void RendezvousServer::forget(const std::string& token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bindings_.erase(token);
+}
+
+// Soket seviye tetiklemeli kaydedilir; bir turda en fazla 64 paket işlenir, kalanlar sonraki turda
+void RendezvousServer::on_readable() {
+    char packet[MAX_DATAGRAM];
+    for (int i = 0; i < 64; ++i) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = ::recvfrom(fd_, packet, sizeof(packet), 0, (struct sockaddr*)&from, &from_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return;
+
+        size_t prefix = sizeof(BIND_PREFIX) - 1;
+        if ((size_t)n <= prefix || memcmp(packet, BIND_PREFIX, prefix) != 0) continue;
+        std::string token(packet + prefix, n - prefix);
+        token.erase(token.find_last_not_of(" \r\n") + 1);
+
+        ClientId id = NO_CLIENT;
+        bool first = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = bindings_.find(token);
+            if (it == bindings_.end()) continue;
+            id = it->second.id;
+            first = !it->second.bound;
+            it->second.bound = true;
+        }
+
+        char ip[INET_ADDRSTRLEN];
+        ::inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+        std::string address = std::string(ip) + ":" + std::to_string(ntohs(from.sin_port));
+        std::string reply = "WRB1 MAPPED " + address;
+        ::sendto(fd_, reply.data(), reply.size(), MSG_DONTWAIT, (struct sockaddr*)&from, from_len);
+        LOG(LOG_TRACE) << "Buluşma: ID " << id << " UDP adresi " << address;
+        if (first) on_bound_(id, token, address);
+    }
+}
@@ -0,0 +1,42 @@
+#include "resume_table.h"
+
+#include <random>
+
+#include <sys/random.h>
+
+std::string generate_random_token() {
+    unsigned char bytes[16];
+    if (::getrandom(bytes, sizeof(bytes), GRND_NONBLOCK) != (ssize_t)sizeof(bytes)) {
+        std::random_device device; // Açılışta entropi havuzu henüz hazır değilse
+        for (unsigned char& b : bytes) b = (unsigned char)device();
+    }
+    static const char digits[] = "0123456789abcdef";
+    std::string token;
+    token.reserve(sizeof(bytes) * 2);
+    for (unsigned char b : bytes) {
+        token += digits[b >> 4];
+        token += digits[b & 0x0f];
+    }
+    return token;
+}
+
+void ResumeTable::park(const std::string& token, std::shared_ptr<ClientInfo> client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    parked_[token] = std::move(client);
+}
+
+std::shared_ptr<ClientInfo> ResumeTable::find(const std::string& token) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = parked_.find(token);
+    return it != parked_.end() ? it->second : nullptr;
+}
+
+void ResumeTable::forget(const std::string& token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    parked_.erase(token);
+}
+
+size_t ResumeTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return parked_.size();
+}
@@ -0,0 +1,782 @@
+#include "rfb_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "logger.h"
+#include "metrics.h"
+
+static const int32_t ENCODING_RAW = 0;
+static const int32_t ENCODING_COPY_RECT = 1;
+static const int32_t ENCODING_RRE = 2;
+static const int32_t ENCODING_HEXTILE = 5;
+static const int32_t ENCODING_LAST_RECT = -224;
+static const int32_t ENCODING_DESKTOP_SIZE = -223;
+
+// Hextile alt kodlama bitleri
+static const uint8_t HEXTILE_RAW_BIT = 1;
+static const uint8_t HEXTILE_BACKGROUND = 2;
+static const uint8_t HEXTILE_FOREGROUND = 4;
+static const uint8_t HEXTILE_ANY_SUBRECTS = 8;
+static const uint8_t HEXTILE_COLOURED = 16;
+
+static const size_t MAX_NAME_LENGTH = 64 * 1024;
+// Bundan uzun pano metinleri tamamı beklenemeyeceği için paylaşana iletilmez
+static const size_t MAX_CUT_TEXT = 64 * 1024;
+
+static uint16_t get16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+static void put8(std::string* out, uint8_t value) { out->push_back((char)value); }
+static void put16(std::string* out, uint16_t value) {
+    put8(out, value >> 8);
+    put8(out, value & 0xff);
+}
+static void put32(std::string* out, uint32_t value) {
+    put16(out, value >> 16);
+    put16(out, value & 0xffff);
+}
+
+// "RFB 003.008\n" satırının alt sürümü: 3, 7 veya 8 (aradaki ve sonraki sürümler en yakın alta
+// yuvarlanır). Geçersiz satırda 0.
+static int parse_version(const uint8_t* p) {
+    if (memcmp(p, "RFB ", 4) != 0 || p[7] != '.' || p[11] != '\n') return 0;
+    int major = 0, minor = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (p[4 + i] < '0' || p[4 + i] > '9' || p[8 + i] < '0' || p[8 + i] > '9') return 0;
+        major = major * 10 + (p[4 + i] - '0');
+        minor = minor * 10 + (p[8 + i] - '0');
+    }
+    if (major != 3 || minor < 3) return 0;
+    return minor >= 8 ? 8 : minor >= 7 ? 7 : 3;
+}
+
+// --- RfbCache ---
+
+RfbCache::RfbCache(size_t max_framebuffer_bytes)
+    : max_bytes_(max_framebuffer_bytes), state_(SERVER_VERSION), need_(12), skip_(0), server_minor_(0),
+      client_minor_(0), client_security_(0), security_type_(0), ready_(false), width_(0), height_(0), bpp_(0),
+      pixel_format_(), rects_left_(0), rect_x_(0), rect_y_(0), rect_w_(0), rect_h_(0), row_(0),
+      subrects_left_(0), tile_x_(0), tile_y_(0), tile_w_(0), tile_h_(0), tile_flags_(0), background_(),
+      foreground_() {}
+
+bool RfbCache::supported_encoding(int32_t encoding) {
+    return encoding == ENCODING_RAW || encoding == ENCODING_COPY_RECT || encoding == ENCODING_RRE ||
+           encoding == ENCODING_HEXTILE || encoding == ENCODING_LAST_RECT || encoding == ENCODING_DESKTOP_SIZE;
+}
+
+int RfbCache::negotiated_minor() const {
+    return std::min(server_minor_, client_minor_);
+}
+
+void RfbCache::fail(const char* reason) {
+    if (state_ == FAILED) return;
+    state_ = FAILED;
+    std::vector<uint8_t>().swap(framebuffer_);
+    relay_metrics.rfb_cache_failures.fetch_add(1, std::memory_order_relaxed);
+    LOG(LOG_WARN) << "RFB önbelleği devre dışı: " << reason;
+}
+
+void RfbCache::expect(State state, size_t bytes) {
+    state_ = state;
+    need_ = bytes;
+}
+
+size_t RfbCache::feed_server(const char* data, size_t len, bool stop_at_boundary) {
+    size_t used = 0;
+    while (used < len && state_ != FAILED) {
+        if (stop_at_boundary && at_boundary()) break;
+        if (state_ == SKIP) {
+            size_t n = std::min(skip_, len - used);
+            used += n;
+            skip_ -= n;
+            if (skip_ == 0) expect(MESSAGE_TYPE, 1);
+            continue;
+        }
+        // Güvenlik mesajlarının biçimi istemcinin sürümüne ve seçimine bağlıdır; sunucu bunları
+        // ancak istemci yanıtladıktan sonra gönderdiği için o anda bilinirler
+        if (state_ == SECURITY) {
+            int minor = negotiated_minor();
+            if (minor == 0) {
+                fail("istemci sürümü bilinmiyor");
+                break;
+            }
+            if (minor == 3) {
+                expect(SECURITY_33, 4);
+            } else {
+                expect(SECURITY_COUNT, 1);
+            }
+            continue;
+        }
+        if (state_ == SECURITY_WAIT) {
+            if (client_security_ == 0) {
+                fail("istemcinin güvenlik seçimi bilinmiyor");
+                break;
+            }
+            begin_security(client_security_);
+            continue;
+        }
+
+        // Birim tamamen bu parçadaysa kopyalanmadan işlenir
+        const uint8_t* unit;
+        bool buffered = false;
+        if (buf_.empty() && len - used >= need_) {
+            unit = reinterpret_cast<const uint8_t*>(data + used);
+            used += need_;
+        } else {
+            size_t n = std::min(need_ - buf_.size(), len - used);
+            buf_.append(data + used, n);
+            used += n;
+            if (buf_.size() < need_) break;
+            unit = reinterpret_cast<const uint8_t*>(buf_.data());
+            buffered = true;
+        }
+        step(unit);
+        if (buffered) buf_.clear();
+    }
+    return used;
+}
+
+void RfbCache::begin_security(uint8_t type) {
+    security_type_ = type;
+    if (type == SECURITY_NONE) {
+        // 3.8'de None için de SecurityResult gönderilir
+        if (negotiated_minor() == 8) {
+            expect(SECURITY_RESULT, 4);
+        } else {
+            expect(SERVER_INIT, 24);
+        }
+    } else if (type == SECURITY_VNC_AUTH) {
+        expect(VNC_CHALLENGE, 16);
+    } else {
+        fail("desteklenmeyen güvenlik türü");
+    }
+}
+
+void RfbCache::step(const uint8_t* unit) {
+    switch (state_) {
+        case SERVER_VERSION:
+            server_minor_ = parse_version(unit);
+            if (server_minor_ == 0) {
+                fail("geçersiz sürüm satırı");
+                return;
+            }
+            version_.assign(reinterpret_cast<const char*>(unit), 12);
+            expect(SECURITY, 0);
+            return;
+        case SECURITY_33: {
+            uint32_t type = get32(unit);
+            if (type == 0) {
+                fail("paylaşan bağlantıyı reddetti");
+                return;
+            }
+            begin_security(type > 0xff ? 0 : (uint8_t)type);
+            return;
+        }
+        case SECURITY_COUNT:
+            if (unit[0] == 0) {
+                fail("paylaşan bağlantıyı reddetti");
+                return;
+            }
+            expect(SECURITY_TYPES, unit[0]);
+            return;
+        case SECURITY_TYPES:
+            expect(SECURITY_WAIT, 0);
+            return;
+        case VNC_CHALLENGE:
+            expect(SECURITY_RESULT, 4);
+            return;
+        case SECURITY_RESULT:
+            if (get32(unit) != 0) {
+                fail("kimlik doğrulama başarısız");
+                return;
+            }
+            expect(SERVER_INIT, 24);
+            return;
+        case SERVER_INIT: {
+            if (!valid_pixel_format(unit + 4)) {
+                fail("desteklenmeyen piksel biçimi");
+                return;
+            }
+            memcpy(pixel_format_, unit + 4, sizeof(pixel_format_));
+            bpp_ = unit[4] / 8;
+            if (!resize(get16(unit), get16(unit + 2))) return;
+            uint32_t name_length = get32(unit + 20);
+            if (name_length > MAX_NAME_LENGTH) {
+                fail("masaüstü adı çok uzun");
+            } else if (name_length == 0) {
+                ready_ = true;
+                expect(MESSAGE_TYPE, 1);
+            } else {
+                expect(SERVER_NAME, name_length);
+            }
+            return;
+        }
+        case SERVER_NAME:
+            name_.assign(reinterpret_cast<const char*>(unit), need_);
+            ready_ = true;
+            expect(MESSAGE_TYPE, 1);
+            return;
+        case MESSAGE_TYPE:
+            switch (unit[0]) {
+                case 0: expect(UPDATE_HEADER, 3); return;     // FramebufferUpdate
+                case 1: expect(COLOUR_MAP_HEADER, 5); return; // SetColourMapEntries
+                case 2: return;                               // Bell
+                case 3: expect(CUT_TEXT_HEADER, 7); return;   // ServerCutText
+            }
+            fail("bilinmeyen sunucu mesajı");
+            return;
+        case UPDATE_HEADER:
+            rects_left_ = get16(unit + 1);
+            if (rects_left_ == 0) {
+                expect(MESSAGE_TYPE, 1);
+            } else {
+                expect(RECT_HEADER, 12);
+            }
+            return;
+        case RECT_HEADER: {
+            rect_x_ = get16(unit);
+            rect_y_ = get16(unit + 2);
+            rect_w_ = get16(unit + 4);
+            rect_h_ = get16(unit + 6);
+            int32_t encoding = (int32_t)get32(unit + 8);
+            if (encoding == ENCODING_LAST_RECT) {
+                expect(MESSAGE_TYPE, 1);
+                return;
+            }
+            if (encoding == ENCODING_DESKTOP_SIZE) {
+                if (resize(rect_w_, rect_h_)) next_rect();
+                return;
+            }
+            if (rect_x_ + rect_w_ > width_ || rect_y_ + rect_h_ > height_) {
+                fail("dikdörtgen çerçeve tamponunun dışında");
+                return;
+            }
+            if (rect_w_ == 0 || rect_h_ == 0) {
+                if (encoding == ENCODING_RAW || encoding == ENCODING_HEXTILE) {
+                    next_rect();
+                    return;
+                }
+            }
+            switch (encoding) {
+                case ENCODING_RAW:
+                    row_ = 0;
+                    expect(RAW_ROW, rect_w_ * bpp_);
+                    return;
+                case ENCODING_COPY_RECT:
+                    expect(COPY_RECT, 4);
+                    return;
+                case ENCODING_RRE:
+                    expect(RRE_HEADER, 4 + bpp_);
+                    return;
+                case ENCODING_HEXTILE:
+                    tile_x_ = rect_x_;
+                    tile_y_ = rect_y_;
+                    tile_w_ = std::min<uint32_t>(16, rect_w_);
+                    tile_h_ = std::min<uint32_t>(16, rect_h_);
+                    expect(HEXTILE_TILE, 1);
+                    return;
+            }
+            fail("desteklenmeyen kodlama");
+            return;
+        }
+        case RAW_ROW:
+            memcpy(&framebuffer_[offset(rect_x_, rect_y_ + row_)], unit, need_);
+            if (++row_ == rect_h_) next_rect();
+            return;
+        case COPY_RECT: {
+            uint32_t src_x = get16(unit);
+            uint32_t src_y = get16(unit + 2);
+            if (src_x + rect_w_ > width_ || src_y + rect_h_ > height_) {
+                fail("CopyRect kaynağı çerçeve tamponunun dışında");
+                return;
+            }
+            // Kaynak ve hedef çakışabilir; satırlar kaynağın üzerine yazılmayacak sırada kopyalanır
+            size_t row_bytes = (size_t)rect_w_ * bpp_;
+            if (src_y < rect_y_) {
+                for (uint32_t r = rect_h_; r-- > 0;) {
+                    memmove(&framebuffer_[offset(rect_x_, rect_y_ + r)], &framebuffer_[offset(src_x, src_y + r)], row_bytes);
+                }
+            } else {
+                for (uint32_t r = 0; r < rect_h_; ++r) {
+                    memmove(&framebuffer_[offset(rect_x_, rect_y_ + r)], &framebuffer_[offset(src_x, src_y + r)], row_bytes);
+                }
+            }
+            next_rect();
+            return;
+        }
+        case RRE_HEADER:
+            subrects_left_ = get32(unit);
+            fill(rect_x_, rect_y_, rect_w_, rect_h_, unit + 4);
+            if (subrects_left_ == 0) {
+                next_rect();
+            } else {
+                expect(RRE_SUBRECT, bpp_ + 8);
+            }
+            return;
+        case RRE_SUBRECT: {
+            const uint8_t* geometry = unit + bpp_;
+            uint32_t x = get16(geometry), y = get16(geometry + 2);
+            uint32_t w = get16(geometry + 4), h = get16(geometry + 6);
+            if (x + w > rect_w_ || y + h > rect_h_) {
+                fail("RRE alt dikdörtgeni sınır dışında");
+                return;
+            }
+            fill(rect_x_ + x, rect_y_ + y, w, h, unit);
+            if (--subrects_left_ == 0) next_rect();
+            return;
+        }
+        case HEXTILE_TILE: {
+            tile_flags_ = unit[0];
+            if (tile_flags_ & HEXTILE_RAW_BIT) {
+                expect(HEXTILE_RAW, (size_t)tile_w_ * tile_h_ * bpp_);
+                return;
+            }
+            size_t body = (tile_flags_ & HEXTILE_BACKGROUND ? bpp_ : 0) + (tile_flags_ & HEXTILE_FOREGROUND ? bpp_ : 0) +
+                          (tile_flags_ & HEXTILE_ANY_SUBRECTS ? 1 : 0);
+            if (body == 0) {
+                // Arka plan önceki karodan kalır
+                fill(tile_x_, tile_y_, tile_w_, tile_h_, background_);
+                next_tile();
+                return;
+            }
+            expect(HEXTILE_BODY, body);
+            return;
+        }
+        case HEXTILE_RAW: {
+            size_t row_bytes = (size_t)tile_w_ * bpp_;
+            for (uint32_t r = 0; r < tile_h_; ++r) {
+                memcpy(&framebuffer_[offset(tile_x_, tile_y_ + r)], unit + r * row_bytes, row_bytes);
+            }
+            next_tile();
+            return;
+        }
+        case HEXTILE_BODY: {
+            const uint8_t* p = unit;
+            if (tile_flags_ & HEXTILE_BACKGROUND) {
+                memcpy(background_, p, bpp_);
+                p += bpp_;
+            }
+            if (tile_flags_ & HEXTILE_FOREGROUND) {
+                memcpy(foreground_, p, bpp_);
+                p += bpp_;
+            }
+            fill(tile_x_, tile_y_, tile_w_, tile_h_, background_);
+            if (!(tile_flags_ & HEXTILE_ANY_SUBRECTS) || *p == 0) {
+                next_tile();
+                return;
+            }
+            subrects_left_ = *p;
+            expect(HEXTILE_SUBRECTS, subrects_left_ * ((tile_flags_ & HEXTILE_COLOURED ? bpp_ : 0) + 2));
+            return;
+        }
+        case HEXTILE_SUBRECTS: {
+            const uint8_t* p = unit;
+            for (uint32_t i = 0; i < subrects_left_; ++i) {
+                const uint8_t* pixel = foreground_;
+                if (tile_flags_ & HEXTILE_COLOURED) {
+                    pixel = p;
+                    p += bpp_;
+                }
+                uint32_t x = p[0] >> 4, y = p[0] & 0x0f;
+                uint32_t w = (p[1] >> 4) + 1, h = (p[1] & 0x0f) + 1;
+                p += 2;
+                if (x + w > tile_w_ || y + h > tile_h_) {
+                    fail("Hextile alt dikdörtgeni karo dışında");
+                    return;
+                }
+                fill(tile_x_ + x, tile_y_ + y, w, h, pixel);
+            }
+            next_tile();
+            return;
+        }
+        case COLOUR_MAP_HEADER:
+        case CUT_TEXT_HEADER:
+            // Renk tablosu (gerçek renkli biçimde kullanılmaz) ve pano metni çerçeveyi değiştirmez
+            skip_ = state_ == COLOUR_MAP_HEADER ? (size_t)get16(unit + 3) * 6 : get32(unit + 3);
+            if (skip_ == 0) {
+                expect(MESSAGE_TYPE, 1);
+            } else {
+                expect(SKIP, 0);
+            }
+            return;
+        default:
+            return;
+    }
+}
+
+void RfbCache::next_rect() {
+    if (--rects_left_ == 0) {
+        expect(MESSAGE_TYPE, 1);
+    } else {
+        expect(RECT_HEADER, 12);
+    }
+}
+
+// Hextile karoları soldan sağa, yukarıdan aşağıya 16x16'lıktır; kenardakiler daha küçük olabilir
+void RfbCache::next_tile() {
+    tile_x_ += 16;
+    if (tile_x_ >= rect_x_ + rect_w_) {
+        tile_x_ = rect_x_;
+        tile_y_ += 16;
+        if (tile_y_ >= rect_y_ + rect_h_) {
+            next_rect();
+            return;
+        }
+    }
+    tile_w_ = std::min<uint32_t>(16, rect_x_ + rect_w_ - tile_x_);
+    tile_h_ = std::min<uint32_t>(16, rect_y_ + rect_h_ - tile_y_);
+    expect(HEXTILE_TILE, 1);
+}
+
+// Yeni boyutta boş bir tampon ayırır; sunucu boyut değişiminden sonra tam güncelleme gönderir
+bool RfbCache::resize(uint32_t width, uint32_t height) {
+    size_t bytes = (size_t)width * height * bpp_;
+    if (bytes > max_bytes_) {
+        fail("çerçeve tamponu bellek sınırını aşıyor");
+        return false;
+    }
+    width_ = width;
+    height_ = height;
+    framebuffer_.assign(bytes, 0);
+    return true;
+}
+
+bool RfbCache::valid_pixel_format(const uint8_t* format) const {
+    uint8_t bits = format[0];
+    bool true_colour = format[3] != 0;
+    return true_colour && (bits == 8 || bits == 16 || bits == 32);
+}
+
+void RfbCache::set_pixel_format(const uint8_t* format) {
+    if (state_ == FAILED) return;
+    if (!valid_pixel_format(format)) {
+        fail("desteklenmeyen piksel biçimi");
+        return;
+    }
+    memcpy(pixel_format_, format, sizeof(pixel_format_));
+    uint32_t bpp = format[0] / 8;
+    if (bpp != bpp_) {
+        bpp_ = bpp;
+        resize(width_, height_);
+    }
+}
+
+void RfbCache::fill(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pixel) {
+    if (width == 0 || height == 0) return;
+    uint8_t* first = &framebuffer_[offset(x, y)];
+    for (uint32_t c = 0; c < width; ++c) memcpy(first + c * bpp_, pixel, bpp_);
+    size_t row_bytes = (size_t)width * bpp_;
+    for (uint32_t r = 1; r < height; ++r) memcpy(&framebuffer_[offset(x, y + r)], first, row_bytes);
+}
+
+void RfbCache::server_init(std::string* out) const {
+    put16(out, width_);
+    put16(out, height_);
+    out->append(reinterpret_cast<const char*>(pixel_format_), sizeof(pixel_format_));
+    put32(out, name_.size());
+    out->append(name_);
+}
+
+void RfbCache::snapshot(std::string* out, bool hextile) const {
+    put8(out, 0); // FramebufferUpdate
+    put8(out, 0);
+    if (width_ == 0 || height_ == 0) {
+        put16(out, 0);
+        return;
+    }
+    put16(out, 1);
+    put16(out, 0);
+    put16(out, 0);
+    put16(out, width_);
+    put16(out, height_);
+    put32(out, hextile ? ENCODING_HEXTILE : ENCODING_RAW);
+    const char* pixels = reinterpret_cast<const char*>(framebuffer_.data());
+    if (!hextile) {
+        out->append(pixels, framebuffer_.size());
+        return;
+    }
+
+    // Düz renkli karo yalnızca arka plan pikselini taşır; önceki karoyla aynı renkteyse hiç
+    // piksel taşımaz. Ham karodan sonra arka plan yeniden belirtilir.
+    bool have_background = false;
+    const char* background = nullptr;
+    for (uint32_t ty = 0; ty < height_; ty += 16) {
+        uint32_t th = std::min<uint32_t>(16, height_ - ty);
+        for (uint32_t tx = 0; tx < width_; tx += 16) {
+            uint32_t tw = std::min<uint32_t>(16, width_ - tx);
+            const char* first = pixels + offset(tx, ty);
+            bool solid = true;
+            for (uint32_t r = 0; r < th && solid; ++r) {
+                const char* row = pixels + offset(tx, ty + r);
+                for (uint32_t c = 0; c < tw; ++c) {
+                    if (memcmp(row + c * bpp_, first, bpp_) != 0) {
+                        solid = false;
+                        break;
+                    }
+                }
+            }
+            if (solid) {
+                if (have_background && memcmp(background, first, bpp_) == 0) {
+                    put8(out, 0);
+                } else {
+                    put8(out, HEXTILE_BACKGROUND);
+                    out->append(first, bpp_);
+                    background = first;
+                    have_background = true;
+                }
+            } else {
+                put8(out, HEXTILE_RAW_BIT);
+                for (uint32_t r = 0; r < th; ++r) out->append(pixels + offset(tx, ty + r), (size_t)tw * bpp_);
+                have_background = false;
+            }
+        }
+    }
+}
+
+// --- RfbClientStream ---
+
+RfbClientStream::RfbClientStream(RfbCache& cache, bool primary)
+    : cache_(cache), primary_(primary), started_(primary), state_(VERSION), expect_(12), skip_(0), minor_(0),
+      hextile_(false), snapshot_requested_(false) {}
+
+void RfbClientStream::start(std::string* reply) {
+    started_ = true;
+    reply->append(cache_.version().empty() ? "RFB 003.008\n" : cache_.version());
+}
+
+bool RfbClientStream::take_snapshot_request() {
+    bool requested = snapshot_requested_;
+    snapshot_requested_ = false;
+    return requested;
+}
+
+bool RfbClientStream::feed(const char* data, size_t len, std::string* forward, std::string* reply) {
+    size_t used = 0;
+    while (used < len) {
+        // Önbellek devre dışı kaldıysa birincil izleyicinin akışı artık değiştirilmez
+        if (primary_ && cache_.failed() && msg_.empty() && state_ != CUT_TEXT_SKIP) state_ = PASSTHROUGH;
+        switch (state_) {
+            case ERROR:
+                return false;
+            case PASSTHROUGH:
+                forward->append(data + used, len - used);
+                return true;
+            case REFUSED:
+                return true; // Ret yanıtından sonra gelenler atılır
+            case CUT_TEXT_SKIP: {
+                size_t n = std::min(skip_, len - used);
+                used += n;
+                skip_ -= n;
+                if (skip_ == 0) {
+                    state_ = MESSAGE;
+                    expect_ = 1;
+                }
+                continue;
+            }
+            case SECURITY:
+                // 3.3'te güvenlik türünü sunucu seçer; istemci ancak onu aldıktan sonra devam eder
+                if (minor_ == 3) {
+                    after_security(cache_.security_type());
+                    continue;
+                }
+                break;
+            default:
+                break;
+        }
+        size_t n = std::min(expect_ - msg_.size(), len - used);
+        msg_.append(data + used, n);
+        used += n;
+        if (msg_.size() < expect_) break;
+        if (!unit_complete(forward, reply)) {
+            state_ = ERROR;
+            msg_.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RfbClientStream::after_security(uint8_t type) {
+    if (type == RfbCache::SECURITY_NONE) {
+        state_ = INIT;
+        expect_ = 1;
+    } else if (type == RfbCache::SECURITY_VNC_AUTH) {
+        state_ = AUTH;
+        expect_ = 16;
+    } else {
+        cache_.fail("desteklenmeyen güvenlik türü");
+        state_ = PASSTHROUGH;
+    }
+}
+
+// Geç katılan izleyiciye RFB bağlantı reddi (güvenlik türü listesi yerine) gönderir
+void RfbClientStream::refuse(int minor, const std::string& reason, std::string* reply) {
+    if (minor == 3) {
+        put32(reply, 0);
+    } else {
+        put8(reply, 0);
+    }
+    put32(reply, reason.size());
+    reply->append(reason);
+    state_ = REFUSED;
+}
+
+bool RfbClientStream::unit_complete(std::string* forward, std::string* reply) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(msg_.data());
+    switch (state_) {
+        case VERSION: {
+            int minor = parse_version(p);
+            if (minor == 0) return false;
+            if (primary_) {
+                forward->append(msg_);
+                cache_.set_client_version(minor);
+                minor_ = cache_.negotiated_minor();
+                state_ = minor_ == 0 ? PASSTHROUGH : SECURITY;
+            } else {
+                minor_ = std::min(minor, cache_.server_minor() ? cache_.server_minor() : 8);
+                if (cache_.failed()) {
+                    refuse(minor_, "Relay önbelleği bu yayında kullanılamıyor", reply);
+                } else if (cache_.requires_auth()) {
+                    refuse(minor_, "Yayın parola korumalı; relay önbellekten izleyici kabul edemez", reply);
+                } else if (minor_ == 3) {
+                    put32(reply, RfbCache::SECURITY_NONE);
+                    state_ = INIT;
+                } else {
+                    put8(reply, 1);
+                    put8(reply, RfbCache::SECURITY_NONE);
+                    state_ = SECURITY;
+                }
+            }
+            expect_ = 1;
+            break;
+        }
+        case SECURITY:
+            if (primary_) {
+                forward->append(msg_);
+                cache_.set_client_security(p[0]);
+                after_security(p[0]);
+            } else {
+                if (p[0] != RfbCache::SECURITY_NONE) return false;
+                if (minor_ == 8) put32(reply, 0); // SecurityResult: başarılı
+                state_ = INIT;
+                expect_ = 1;
+            }
+            break;
+        case AUTH:
+            forward->append(msg_);
+            state_ = INIT;
+            expect_ = 1;
+            break;
+        case INIT:
+            // ClientInit (paylaşım bayrağı); relay'de oturum her zaman paylaşımlıdır
+            if (primary_) {
+                forward->append(msg_);
+            } else {
+                cache_.server_init(reply);
+            }
+            state_ = MESSAGE;
+            expect_ = 1;
+            break;
+        case MESSAGE:
+            return message_complete(forward);
+        default:
+            break;
+    }
+    msg_.clear();
+    return true;
+}
+
+// İstemci mesajının uzunluğu başlığından anlaşılır; tamamlanmadıysa beklenen uzunluk büyütülür
+bool RfbClientStream::message_complete(std::string* forward) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(msg_.data());
+    size_t length;
+    switch (p[0]) {
+        case 0: length = 20; break; // SetPixelFormat
+        case 2:                     // SetEncodings
+            if (msg_.size() < 4) {
+                expect_ = 4;
+                return true;
+            }
+            length = 4 + 4 * (size_t)get16(p + 2);
+            break;
+        case 3: length = 10; break; // FramebufferUpdateRequest
+        case 4: length = 8; break;  // KeyEvent
+        case 5: length = 6; break;  // PointerEvent
+        case 6: {                   // ClientCutText
+            if (msg_.size() < 8) {
+                expect_ = 8;
+                return true;
+            }
+            uint32_t text = get32(p + 4);
+            if (text > MAX_CUT_TEXT) {
+                LOG_RATE_LIMITED(LOG_WARN, 10) << "RFB: " << text << " byte'lık pano metni paylaşana iletilmedi";
+                skip_ = text;
+                msg_.clear();
+                state_ = skip_ ? CUT_TEXT_SKIP : MESSAGE;
+                expect_ = 1;
+                return true;
+            }
+            length = 8 + text;
+            break;
+        }
+        default:
+            if (!primary_) return false;
+            // Sunucuya özgü bir uzantı; mesaj sınırları artık bilinemez
+            cache_.fail("bilinmeyen istemci mesajı");
+            forward->append(msg_);
+            msg_.clear();
+            state_ = PASSTHROUGH;
+            return true;
+    }
+    if (msg_.size() < length) {
+        expect_ = length;
+        return true;
+    }
+
+    switch (p[0]) {
+        case 0:
+            if (primary_) {
+                cache_.set_pixel_format(p + 4);
+                forward->append(msg_);
+            } else if (memcmp(p + 4, cache_.pixel_format(), 16) != 0) {
+                LOG(LOG_DEBUG) << "RFB: izleyicinin piksel biçimi yok sayıldı; yayının biçimi kullanılıyor";
+            }
+            break;
+        case 2: {
+            // Önbelleğin çözemeyeceği kodlamalar süzülür; geç izleyicinin tercihi yalnızca kare
+            // kodlamasını seçmek için kullanılır
+            size_t count = get16(p + 2);
+            std::string encodings;
+            hextile_ = false;
+            for (size_t i = 0; i < count; ++i) {
+                int32_t encoding = (int32_t)get32(p + 4 + 4 * i);
+                if (encoding == ENCODING_HEXTILE) hextile_ = true;
+                if (RfbCache::supported_encoding(encoding)) encodings.append(msg_, 4 + 4 * i, 4);
+            }
+            if (primary_) {
+                if (encodings.empty()) put32(&encodings, ENCODING_RAW);
+                put8(forward, 2);
+                put8(forward, 0);
+                put16(forward, encodings.size() / 4);
+                forward->append(encodings);
+            }
+            break;
+        }
+        case 3:
+            // Geç izleyicinin tam ekran isteği paylaşana gitmez, önbellekten karşılanır
+            if (!primary_ && p[1] == 0) {
+                snapshot_requested_ = true;
+                break;
+            }
+            forward->append(msg_);
+            break;
+        default:
+            forward->append(msg_);
+            break;
+    }
+    msg_.clear();
+    expect_ = 1;
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "ring_buffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+static size_t round_up_to_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+RingBuffer::RingBuffer(size_t capacity, size_t retain)
+    : capacity_(capacity ? round_up_to_power_of_two(capacity) : 0),
+      mask_(capacity_ ? capacity_ - 1 : 0), retain_(retain), head_(0), tail_(0), floor_(0) {}
+
+bool RingBuffer::ensure_storage() {
+    if (storage_) return true;
+    if (capacity_ == 0) return false;
+    storage_.reset(new (std::nothrow) char[capacity_]);
+    return storage_ != nullptr;
+}
+
+size_t RingBuffer::write(const char* data, size_t len) {
+    len = std::min(len, free_space());
+    if (len == 0 || !ensure_storage()) return 0;
+
+    size_t start = tail_ & mask_;
+    size_t first = std::min(len, capacity_ - start);
+    memcpy(storage_.get() + start, data, first);
+    memcpy(storage_.get(), data + first, len - first);
+    tail_ += len;
+    return len;
+}
+
+ssize_t RingBuffer::read_from_fd(int fd, size_t max_bytes) {
+    size_t len = std::min(max_bytes, free_space());
+    if (len == 0 || !ensure_storage()) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // Boş alan tamponun sonunda ve başında iki parça halinde olabilir
+    size_t start = tail_ & mask_;
+    size_t first = std::min(len, capacity_ - start);
+    struct iovec iov[2];
+    iov[0].iov_base = storage_.get() + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = storage_.get();
+    iov[1].iov_len = len - first;
+
+    ssize_t n = ::readv(fd, iov, iov[1].iov_len ? 2 : 1);
+    if (n > 0) tail_ += n;
+    return n;
+}
+
+int RingBuffer::tail_iov(size_t bytes, struct iovec iov[2]) const {
+    bytes = std::min(bytes, size());
+    if (bytes == 0) return 0;
+
+    size_t start = (tail_ - bytes) & mask_;
+    size_t first = std::min(bytes, capacity_ - start);
+    iov[0].iov_base = storage_.get() + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = storage_.get();
+    iov[1].iov_len = bytes - first;
+    return iov[1].iov_len ? 2 : 1;
+}
+
+ssize_t RingBuffer::send_to_socket(int fd, size_t max_bytes) {
+    size_t len = std::min(size(), max_bytes);
+    if (len == 0) return 0;
+
+    size_t start = head_ & mask_;
+    size_t first = std::min(len, capacity_ - start);
+    struct iovec iov[2];
+    iov[0].iov_base = storage_.get() + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = storage_.get();
+    iov[1].iov_len = len - first;
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov[1].iov_len ? 2 : 1;
+
+    ssize_t n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n > 0) discard(n);
+    return n;
+}
+
+void RingBuffer::discard(size_t bytes) {
+    head_ += std::min(bytes, size());
+    if (retain_ == 0) {
+        floor_ = head_;
+        if (head_ == tail_) head_ = tail_ = floor_ = 0; // Sonraki yazımlar bitişik olsun
+    } else if (head_ - floor_ > retain_) {
+        floor_ = head_ - retain_;
+    }
+}
+
+void RingBuffer::copy_to(std::string* out) const {
+    out->clear();
+    size_t len = tail_ - floor_;
+    if (len == 0) return;
+    size_t start = floor_ & mask_;
+    size_t first = std::min(len, capacity_ - start);
+    out->reserve(len);
+    out->append(storage_.get() + start, first);
+    out->append(storage_.get(), len - first);
+}
+
+bool RingBuffer::rewind(size_t bytes) {
+    if (bytes > head_ - floor_) return false;
+    head_ -= bytes;
+    return true;
+}
+
+size_t RingBuffer::peek(size_t offset, char* out, size_t len) const {
+    if (offset >= size()) return 0;
+    len = std::min(len, size() - offset);
+    size_t start = (head_ + offset) & mask_;
+    size_t first = std::min(len, capacity_ - start);
+    memcpy(out, storage_.get() + start, first);
+    memcpy(out + first, storage_.get(), len - first);
+    return len;
+}
+
+void RingBuffer::truncate(size_t len) {
+    if (len < size()) tail_ = head_ + len;
+}
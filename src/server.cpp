@@ -1,366 +1,2403 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <thread>
-#include <mutex>
-#include <random>
-#include <sstream>
+#include <memory>
 #include <iomanip>
 #include <algorithm>
+#include <sstream>
 #include <stdexcept>
 #include <system_error>
+#include <thread>
 
+#include <cerrno>
+#include <cstddef>
 #include <cstring>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <poll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <csignal>
+#include <pthread.h>
+#include <sched.h>
 
-// --- Veri Yapıları ---
+#include "event_loop.h"
+#include "client_info.h"
+#include "client_registry.h"
+#include "capture.h"
+#include "cluster.h"
+#include "control_protocol.h"
+#include "egress_scheduler.h"
+#include "fanout_session.h"
+#include "handoff.h"
+#include "logger.h"
+#include "metrics.h"
+#include "mux_link.h"
+#include "rendezvous.h"
+#include "resume_table.h"
+#include "timer_wheel.h"
+#include "tls_link.h"
+#include "tunnel_session.h"
+#include "uring_relay.h"
 
-// İstemci bilgilerini ve durumunu tutan yapı
-struct ClientInfo {
-    int socket_fd;
-    std::string ip_address;
-    std::string status = "Idle"; // Olası Durumlar: Idle, Connecting, Connected, VncReady, VncTunnelling
-    std::string peer_id = "";
-    std::vector<char> command_buffer; // Sadece komut modu için kullanılacak tampon
+// --- Global Değişkenler ---
+
+// ID -> ClientInfo kayıt defteri (doğrudan indeksli, kilitleri ID'ye göre bölünmüş; bkz. client_registry.h)
+ClientRegistry registry;
+
+/**
+ * @brief Kendi SO_REUSEPORT dinleyen soketi, olay döngüsü ve thread'i olan relay parçası.
+ * Çekirdek gelen bağlantıları dinleyen soketler arasında dağıtır; kabul edilen soket onu kabul
+ * eden worker'ın döngüsüne aittir. Bir oturumun iki ucu connect sırasında tek worker'da toplanır
+ * (bkz. hand_off_client), böylece tünel trafiği hiçbir zaman thread sınırı aşmaz.
+ */
+struct Worker {
+    int index;
+    int listen_fd;
+    std::unique_ptr<EventLoop> loop;
+    std::unique_ptr<EgressScheduler> scheduler;
+    std::unique_ptr<TimerWheel> timers; // İstemcilerin süre sınırları (bkz. schedule_client_timer)
+    std::thread thread;
 };
 
-// Global Değişkenler ve Mutex
-std::unordered_map<std::string, ClientInfo> clients_by_id;
-std::unordered_map<int, std::string> id_by_socket;
-std::mutex clients_mutex;
+std::vector<std::unique_ptr<Worker>> workers;
+
+// Çalışan thread'in worker'ı ve onun olay döngüsü (io_uring motorunda worker 0, döngü nullptr)
+thread_local int current_worker = 0;
+thread_local EventLoop* relay_loop = nullptr;
+thread_local EgressScheduler* egress_scheduler = nullptr;
+thread_local TimerWheel* timer_wheel = nullptr;
+
+// '--engine=io_uring' ile seçilirse epoll döngüsü yerine soketlerin sahibi olan io_uring motoru.
+// Çekirdek desteklemiyorsa nullptr kalır ve epoll kullanılır.
+UringRelay* uring_relay = nullptr;
+
+// VncTunnelling durumunda veri soket->boru->soket olarak splice(2) ile, kullanıcı alanına
+// kopyalanmadan aktarılır. '--no-splice' ile kapatılırsa tüm trafik kopyalama yolundan geçer.
+bool splice_forwarding_enabled = true;
+
+// Tünel yönü başına bekleyen veri sınırları ('--high-watermark=' / '--low-watermark=' ile
+// değiştirilebilir). Yüksek su işareti, tünel açılmadan önce VncReady durumunda biriken
+// veriyi de sınırlar.
+TunnelLimits tunnel_limits;
+
+// Yayın oturumlarında bir izleyicinin kuyruğunda bekleyebilecek en fazla veri ve bu sınırı aşan
+// izleyiciye varsayılan olarak uygulanan politika ('--viewer-lag-limit=' / '--slow-viewer=').
+// Paylaşan broadcast komutunda kendi politikasını seçebilir.
+size_t viewer_lag_limit = 4 * 1024 * 1024;
+SlowViewerPolicy slow_viewer_policy = SLOW_VIEWER_DROP;
+
+// 'broadcast ... rfb' ile açılan RFB önbelleğinin oturum başına çerçeve tamponu sınırı
+// ('--rfb-cache-limit='). Daha büyük masaüstlerinde önbellek devre dışı kalır.
+size_t rfb_cache_limit = 64 * 1024 * 1024;
+
+// Tünel ucunun bağlantısı koptuğunda oturumun açık tutulduğu süre ('--resume-grace=' saniye;
+// 0 ise kapalı) ve yön başına yeniden gönderim için saklanan veri ('--replay-buffer=').
+// Devam ettirilebilir tüneller splice yerine kopyalama yolunu kullanır.
+// Tünel çıkış hız sınırları ve öncelik sınıfı ('--egress-rate=', '--session-rate=',
+// '--account-rate=' byte/sn; '--interactive-bytes='). Hesap, relay'de kimlik doğrulama
+// olmadığından verinin gittiği ucun IP adresidir. Sınır verilmezse zamanlayıcı devre dışıdır.
+SchedulerConfig scheduler_config;
+
+int resume_grace_seconds = 0;
+size_t replay_buffer_bytes = 1024 * 1024;
+
+// Devam ettirme belirteci -> bağlantısı kopmuş (Resuming) tünel ucu (tüm worker'larca paylaşılır)
+ResumeTable parked_clients;
+
+// Doğrudan bağlantı denemeleri için UDP buluşma noktası ('--rendezvous-port='; 0 ise kapalı).
+// Soket worker 0'ın döngüsündedir; gözlenen adresler ucun worker'ına aktarılır.
+int rendezvous_port = 0;
+std::unique_ptr<RendezvousServer> rendezvous;
+
+// Relay kümesi ('--cluster=ip:port,...' tüm düğümlerin küme adresleri, '--node=K' bu düğüm).
+// ID aralığı düğümler arasında bölünür; ID'nin sahibi olan relay her düğümde aynı hesaplanır
+// (bkz. ClientRegistry::partition_of). Başka relay'deki hedefe connect, o relay'e kalıcı
+// bağlantı üzerinden açılan bir kanal ve iki taraftaki proxy istemcilerle yapılır (bkz. cluster.h).
+// Bağlantılar worker 0'ın döngüsündedir.
+std::vector<ClusterPeer> cluster_peers;
+int cluster_node = 0;
+std::unique_ptr<Cluster> cluster;
+
+// İstemci süre sınırları (saniye; 0 ise kapalı). Her worker'ın zamanlayıcı çarkında istemci başına
+// tek bir zamanlayıcıyla izlenir. '--heartbeat=' komut modundaki istemcilere bu aralıkla PING
+// gönderir ve tüm bağlantılarda TCP keepalive'ı aynı süreyle açar (tünel verisinin arasına PING
+// yazılamaz); '--idle-timeout=' komut modunda bu süre boyunca hiçbir şey göndermeyen istemciyi
+// kapatır; '--handshake-timeout=' bağlantı isteği, kabul ve tünel kurulumunun (Connecting,
+// Connected, VncReady) en uzun süresidir, dolarsa iki uç da Idle durumuna alınır.
+int heartbeat_seconds = 0;
+int idle_timeout_seconds = 0;
+int handshake_timeout_seconds = 300;
+
+// Relay <-> ajan bağlantılarında TLS 1.3 ('--tls-cert=' ve '--tls-key=' PEM dosyaları; ikisi birlikte
+// verilir). El sıkışma worker'ın döngüsünde engellemeden yapılır ve '--handshake-timeout=' ile sınırlanır.
+// Ardından trafik anahtarları çekirdeğe verilir (kTLS): istemci soketi düz TCP soketi gibi okunur ve
+// tünel verisi splice ile kopyasız aktarılmaya devam eder. Çekirdek kTLS'i desteklemiyorsa veya
+// '--no-ktls' verildiyse şifreleme kullanıcı alanındaki bir köprüde yapılır ve istemci bir Unix soket
+// çiftinin ucu olarak kaydedilir (bkz. tls_link.h). Küme bağlantıları ve buluşma portu şifrelenmez.
+std::unique_ptr<TlsContext> tls_context;
+bool ktls_enabled = true;
+
+// Tünel trafiği kaydı ('--capture-dir=' dizin; boşsa kapalı). Her tünel DIR/tunnel-<zaman>-<a>-<b>.rcap
+// dosyasına yön ve zamanıyla kaydedilir (bkz. capture.h); kaydedilen tüneller splice yerine kopyalama
+// yolunu kullanır. Dosyalar arka plandaki tek thread tarafından yazılır, worker diske beklemez.
+// '--capture-limit=' tünel başına kaydedilecek en fazla byte'tır (0: sınırsız).
+std::string capture_dir;
+uint64_t capture_limit_bytes = 1024ULL * 1024 * 1024;
+
+// Kesintisiz yükseltme (SIGUSR2): relay diskteki ikili dosyayı aynı argümanlar ve '--takeover-fd=N'
+// ile yeniden çalıştırır. Yeni süreç hazır olunca worker'lar dondurulur; dinleyen soketler, istemci
+// soketleri, splice boruları ve kayıt/oturum durumu bir Unix soketi üzerinden SCM_RIGHTS ile devredilir
+// (bkz. handoff.h) ve onay gelince eski süreç çıkar. Yayın oturumları, küme temsilcileri ve doğrudan
+// bağlantı buluşmaları devredilmez; bunların uçları yeni süreçte PEER_DISCONNECTED alır.
+// Süreç yöneticisi altında (NOTIFY_SOCKET) eski süreç çıkmadan önce yöneticiye yeni ana PID'i bildirir.
+std::vector<std::string> upgrade_args; // Yeniden çalıştırılacak komut satırı ('--takeover-fd=' hariç)
+int upgrade_sock = -1;                 // Yeni sürece bağlı soket (yükseltme sürerken)
+pid_t upgrade_pid = -1;
+TimerWheel::Timer upgrade_timer;       // Yeni sürecin hazır olma süresi (worker 0'ın çarkında)
+const int UPGRADE_TIMEOUT_SECONDS = 10;
+// Durum devri sürerken tüm tüneller durur: worker'ların durması ve devrin tamamı (gönderim ve
+// yeni sürecin onayı) bu sürelerle sınırlıdır; aşılırsa eski süreç çalışmaya devam eder
+const int UPGRADE_FREEZE_TIMEOUT_MS = 1000;
+const int UPGRADE_TRANSFER_TIMEOUT_SECONDS = 5;
+LoopFreeze worker_freeze; // Durum gönderilirken worker 0 dışındaki worker'lar bekletilir
 
 // --- Fonksiyon Bildirimleri ---
 
-std::string generate_unique_id_unlocked();
-bool send_message(int socket_fd, const std::string& message);
 void print_server_clients_list();
-void handle_client(int client_socket, std::string client_id);
-void cleanup_client(const std::string& client_id, int client_socket);
+void handle_command_line(ClientInfo& self, const std::string& command_line);
+void handle_command(ClientInfo& self, ControlType type, std::string_view argument, bool allow_handoff = true);
+void process_command_data(ClientInfo& self, const char* data, size_t len);
+void process_mux_data(ClientInfo& self, const char* data, size_t len);
+void push_mux_input(TunnelSession& session, ClientInfo& end);
+void run_tunnel_commands(ClientInfo& client);
+void schedule_tunnel_commands(ClientInfo& client);
+void handle_client_event(const std::shared_ptr<ClientInfo>& client, uint32_t events);
+void accept_new_clients(int server_fd);
+void admit_client(int new_socket, const struct sockaddr_in& client_address);
+void start_tls_handshake(int new_socket, const struct sockaddr_in& client_address);
+bool consume_client_data(ClientInfo& self, const char* data, size_t len);
+void cleanup_client(ClientInfo& client);
+void close_client(ClientInfo& client);
+void resume_client_reading(ClientInfo& client);
+bool owned_here(const ClientInfo& client);
+void release_peer(ClientInfo& peer, ClientId gone_id);
+void leave_fanout(ClientInfo& client);
+void handle_slow_viewer(ClientInfo& viewer);
+void hand_off_client(ClientInfo& self, int target_worker, ControlType type, std::string_view argument);
+bool park_client(ClientInfo& client);
+void cancel_resume(ClientInfo& client);
+void resume_parked_client(ClientInfo& self, const std::shared_ptr<ClientInfo>& parked_ptr, uint64_t received);
+void clear_p2p(ClientInfo& client);
+void set_status(ClientInfo& client, ClientStatus status);
+void schedule_client_timer(ClientInfo& client);
+void watch_client_timer(ClientInfo& client);
+std::shared_ptr<ClientInfo> open_remote_peer(ClientInfo& self, ClientId target_id);
 
 // --- Fonksiyon Tanımları ---
 
-// Benzersiz ID üreten fonksiyon (çağrıldığı yerde mutex kilitli olmalı)
-std::string generate_unique_id_unlocked() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(100000, 999999);
-    std::string new_id;
-    do {
-        new_id = std::to_string(dist(gen));
-    } while (clients_by_id.count(new_id));
-    return new_id;
-}
-
-// Bir istemciye mesaj gönderen fonksiyon
-bool send_message(int socket_fd, const std::string& message) {
-    if (socket_fd <= 0) return false;
-    std::string full_message = message + "\n";
-    #ifdef __linux__
-        int flags = MSG_NOSIGNAL;
-    #else
-        int flags = 0;
-    #endif
-    ssize_t bytes_sent = ::send(socket_fd, full_message.c_str(), full_message.length(), flags);
-    return (bytes_sent > 0 && (size_t)bytes_sent == full_message.length());
-}
-
-// Sunucudaki istemci listesini yazdıran fonksiyon (mutex kilitli olmalı)
+// Sunucudaki istemci listesini DEBUG seviyesinde günlüğe yazan fonksiyon. Liste O(n) olduğundan
+// DEBUG kapalıyken hiç gezilmez. Diğer worker'ların istemcilerinin alanları o thread'lerde
+// değişebileceğinden yalnızca çağıran worker'ın istemcileri listelenir.
 void print_server_clients_list() {
-    std::cout << "\n--- Sunucu: Bağlı İstemciler ---" << std::endl;
-    if (clients_by_id.empty()) {
-        std::cout << "(Şu an bağlı istemci yok)" << std::endl;
+    if (!log_enabled(LOG_DEBUG)) return;
+    LOG(LOG_DEBUG) << "--- Sunucu (worker " << current_worker << "): Bağlı İstemciler ---";
+    size_t listed = 0;
+    registry.for_each([&listed](const ClientInfo& client) {
+        if (!owned_here(client)) return;
+        ++listed;
+        LOG(LOG_DEBUG) << "  - ID: " << client.id << ", IP: " << client.ip_address
+                       << ", Soket: " << client.socket_fd << ", Durum: " << client_status_name(client.status)
+                       << (client.peer_id == NO_CLIENT ? "" : " (Peer: " + std::to_string(client.peer_id) + ")");
+    });
+    if (listed == 0) {
+        LOG(LOG_DEBUG) << "(Şu an bağlı istemci yok)";
+    }
+}
+
+// Zamanlayıcıların kullandığı tekdüze saat (ms)
+uint64_t relay_now_ms() {
+    return metrics_now_ns() / 1000000;
+}
+
+// İstemci bu thread'in worker'ına mı ait?
+bool owned_here(const ClientInfo& client) {
+    return client.owner_worker.load(std::memory_order_acquire) == current_worker;
+}
+
+// Karşı ucu kopan peer'i Idle durumuna alır ve bilgilendirir (peer'in worker'ında çağrılır).
+// Peer bir proxy ise kapatılır; kanal kapanışı diğer relay'deki ajana iletilir.
+void release_peer(ClientInfo& peer, ClientId gone_id) {
+    if (peer.remote_node >= 0) {
+        close_client(peer);
+        return;
+    }
+    set_status(peer, ClientStatus::Idle);
+    peer.peer_id = NO_CLIENT;
+    if (peer.mux) {
+        // Komut tamponu kanal 0 akışıdır; yalnızca tünel için biriken veri atılır
+        peer.mux_pending.clear();
     } else {
-        for (const auto& pair : clients_by_id) {
-            std::cout << "  - ID: " << pair.first << ", IP: " << pair.second.ip_address
-                      << ", Soket: " << pair.second.socket_fd << ", Durum: " << pair.second.status;
-            if (!pair.second.peer_id.empty()) {
-                std::cout << " (Peer: " << pair.second.peer_id << ")";
-            }
-            std::cout << std::endl;
+        peer.command_buffer.clear();
+    }
+    peer.session.reset();
+    peer.fanout.reset();
+    peer.resume_token.clear();
+    clear_p2p(peer);
+    resume_client_reading(peer); // VncReady tamponu dolduğu için durdurulmuş olabilir
+    send_control(peer, CTRL_PEER_DISCONNECTED, gone_id);
+    schedule_tunnel_commands(peer); // Kapanan tünelden devralınan çözülmemiş veri
+}
+
+// İstemciyi yayın oturumundan çıkarır. Paylaşan ayrılırsa tüm izleyiciler Idle durumuna alınır;
+// izleyici ayrılırsa paylaşan etkilenmez.
+void leave_fanout(ClientInfo& client) {
+    std::shared_ptr<FanoutSession> fanout = client.fanout;
+    client.fanout.reset();
+    if (&fanout->sharer() == &client) {
+        for (ClientInfo* viewer : fanout->close()) {
+            release_peer(*viewer, client.id);
         }
+        return;
+    }
+    fanout->remove_viewer(client);
+    client.peer_id = NO_CLIENT; // Paylaşan bu istemcinin eşi değildir; bilgilendirilmez
+}
+
+// Kuyruğu gecikme sınırını aşan izleyiciye yayının politikasını uygular (drop veya disconnect).
+// Oturum bu işleyiciyi paylaşanın okuma döngüsünden çağırır.
+void handle_slow_viewer(ClientInfo& viewer) {
+    if (!viewer.fanout) return;
+    if (viewer.fanout->policy() == SLOW_VIEWER_DISCONNECT) {
+        close_client(viewer);
+        return;
     }
-    std::cout << "---------------------------------" << std::endl;
-    std::cout << "Yeni bağlantılar bekleniyor..." << std::endl;
+    ClientId sharer_id = viewer.peer_id;
+    viewer.fanout->remove_viewer(viewer);
+    release_peer(viewer, sharer_id);
 }
 
 // Bir istemci bağlantısı koptuğunda kaynakları temizleyen fonksiyon
-void cleanup_client(const std::string& client_id, int client_socket) {
-    std::lock_guard<std::mutex> lock(clients_mutex);
-    
-    // İstemcinin var olup olmadığını kontrol et
-    if (!clients_by_id.count(client_id)) {
+void cleanup_client(ClientInfo& client) {
+    if (timer_wheel) timer_wheel->cancel(client.timer);
+    if (client.status == ClientStatus::Resuming) cancel_resume(client);
+    clear_p2p(client);
+    // İstemcinin var olup olmadığını kontrol et. Park edilmiş istemcinin tek sahibi kayıt olabilir;
+    // serbest kalmasın diye fonksiyon sonuna kadar tutulur.
+    std::shared_ptr<ClientInfo> removed = registry.remove(client.id);
+    if (!removed) {
         return; // Zaten temizlenmiş
     }
+    if (client.remote_node < 0) relay_metrics.clients_connected.fetch_sub(1, std::memory_order_relaxed);
+
+    // Tünel oturumu varsa kapat; peer'in durdurulmuş okuması serbest bırakılır
+    if (client.fanout) {
+        leave_fanout(client);
+    } else if (client.session) {
+        client.session->close();
+        client.session.reset();
+    } else if (uring_relay) {
+        uring_relay->close_tunnel(client);
+    }
 
     // Eğer bir peere bağlıysa, o peer'i bilgilendir ve Idle durumuna al
-    const auto& client_info = clients_by_id.at(client_id);
-    if (!client_info.peer_id.empty() && clients_by_id.count(client_info.peer_id)) {
-        ClientInfo& peer_info = clients_by_id.at(client_info.peer_id);
-        peer_info.status = "Idle";
-        peer_info.peer_id = "";
-        peer_info.command_buffer.clear();
-        send_message(peer_info.socket_fd, "PEER_DISCONNECTED " + client_id);
-        std::cout << "Sunucu: Bağlı olan diğer istemci (" << client_info.peer_id
-                  << ") bilgilendirildi ve Idle yapıldı." << std::endl;
-    }
-
-    // Ana haritalardan istemciyi sil
-    clients_by_id.erase(client_id);
-    id_by_socket.erase(client_socket);
-
-    std::cout << "\nSunucu: İstemci bağlantısı sonlandı (ID: " << client_id << ", Soket: " << client_socket << ")" << std::endl;
+    std::shared_ptr<ClientInfo> peer_info = registry.find(client.peer_id);
+    if (peer_info && owned_here(*peer_info) && peer_info->status == ClientStatus::Resuming) {
+        // Peer'in de bağlantısı kopmuştu; dönebileceği bir tünel kalmadı
+        cleanup_client(*peer_info);
+    } else if (peer_info && owned_here(*peer_info) && peer_info->peer_id == client.id) {
+        release_peer(*peer_info, client.id);
+        LOG(LOG_INFO) << "Sunucu: Bağlı olan diğer istemci (" << client.peer_id
+                      << ") bilgilendirildi ve Idle yapıldı.";
+    } else if (peer_info && !owned_here(*peer_info)) {
+        // Eşleşme connect ile aynı worker'da yapılır; yine de peer başka bir worker'daysa
+        // sıfırlama onun döngüsüne aktarılır. Peer bu arada başkasıyla eşleşmişse dokunulmaz.
+        ClientId gone_id = client.id;
+        workers[peer_info->owner_worker.load(std::memory_order_acquire)]->loop->post([peer_info, gone_id]() {
+            if (owned_here(*peer_info) && peer_info->socket_fd >= 0 && peer_info->peer_id == gone_id) {
+                release_peer(*peer_info, gone_id);
+            }
+        });
+    }
+
+    LOG(LOG_INFO) << "Sunucu: İstemci bağlantısı sonlandı (ID: " << client.id << ", Soket: " << client.socket_fd << ")";
     print_server_clients_list();
 }
 
+// İstemciyi kayıtlardan siler, soketini olay döngüsünden çıkarır ve kapatır
+void close_client(ClientInfo& client) {
+    if (client.socket_fd < 0) return;
+    if (park_client(client)) return;
+    cleanup_client(client);
+    if (uring_relay) {
+        uring_relay->close_client(client);
+        return;
+    }
+    relay_loop->remove(client.socket_fd);
+    ::close(client.socket_fd);
+    client.socket_fd = -1;
+}
+
+// Süresi içinde geri dönmeyen tünel ucunu temizler; peer PEER_DISCONNECTED alır
+void expire_parked_client(ClientInfo& client) {
+    if (client.status != ClientStatus::Resuming) return;
+    LOG(LOG_INFO) << "Sunucu: ID " << client.id << " " << resume_grace_seconds
+                  << " sn içinde geri dönmedi; tünel kapatılıyor.";
+    relay_metrics.tunnel_resume_timeouts.fetch_add(1, std::memory_order_relaxed);
+    cleanup_client(client); // İstemci (zamanlayıcısıyla birlikte) burada serbest kalabilir
+}
 
-// --- YENİDEN YAZILMIŞ handle_client FONKSİYONU ---
 /**
- * @brief Her istemci için ayrı bir thread'de çalışan ana mantık.
- * Gelen veriyi okur ve istemcinin durumuna göre ya komut olarak işler ya da diğer istemciye yönlendirir.
+ * @brief Bağlantısı kopan tünel ucunun soketini kapatır ama oturumu resume_grace_seconds boyunca
+ * açık tutar (Resuming). Peer'den gelen veri oturum tamponunda birikir; tampon dolunca peer'den
+ * okuma durur. Uç bu sürede belirteciyle yeniden bağlanabilir.
+ * @return Devam ettirme kapalıysa, uç tünelde değilse veya peer de kopmuşsa false.
  */
-void handle_client(int client_socket, std::string client_id) {
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        std::cout << "Sunucu: İstemci thread'i başlatıldı ID: " << client_id << ", Soket: " << client_socket << std::endl;
+bool park_client(ClientInfo& client) {
+    if (resume_grace_seconds <= 0 || uring_relay || client.remote_node >= 0 || client.status != ClientStatus::VncTunnelling || !client.session ||
+        !client.session->resumable() || client.resume_token.empty()) {
+        return false;
     }
+    if (client.session->peer_of(client).socket_fd < 0) return false;
+    std::shared_ptr<ClientInfo> self = registry.find(client.id);
+    if (!self) return false;
+
+    relay_loop->remove(client.socket_fd);
+    ::close(client.socket_fd);
+    client.socket_fd = -1;
+    set_status(client, ClientStatus::Resuming); // Bekleme süresi istemcinin zamanlayıcısıyla izlenir
+    client.read_paused = false;
+    client.output_buffer.clear();
+    parked_clients.park(client.resume_token, self);
+    LOG(LOG_INFO) << "Sunucu: ID " << client.id << " bağlantısı koptu; tünel " << resume_grace_seconds
+                  << " sn boyunca devam ettirilebilir.";
+    return true;
+}
 
-    char buffer[8192]; // Veri okumak için tek bir buffer
+// Park edilmiş ucun belirtecini eşlemeden siler
+void cancel_resume(ClientInfo& client) {
+    parked_clients.forget(client.resume_token);
+}
 
-    while (true) {
-        ssize_t bytes_read = ::read(client_socket, buffer, sizeof(buffer));
+// Bağlantı isteği, kabul veya tünel kurulumu bekleyen durumlar ('--handshake-timeout=')
+bool handshake_state(const ClientInfo& client) {
+    return client.status == ClientStatus::Connecting || client.status == ClientStatus::Connected || client.status == ClientStatus::VncReady;
+}
 
-        if (bytes_read <= 0) {
-            // Okuma hatası veya bağlantı kapanması
-            break;
-        }
+// Relay'in istemciye kontrol mesajı yazabildiği ve istemcinin komut gönderebildiği durumlar
+// (kalp atışı ve boşta kalma). Proxy'lerin canlılığı küme bağlantısıyla izlenir.
+bool command_state(const ClientInfo& client) {
+    return client.remote_node < 0 && (client.status == ClientStatus::Idle || client.status == ClientStatus::Connecting ||
+                                      client.status == ClientStatus::Connected || client.status == ClientStatus::Direct);
+}
 
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        
-        // İstemci hala listede mi diye kontrol et (başka bir thread temizlemiş olabilir)
-        if (!clients_by_id.count(client_id)) {
-            break;
+// Durum değişikliğini kaydeder ve istemcinin zamanlayıcısını yeni duruma göre kurar
+void set_status(ClientInfo& client, ClientStatus status) {
+    client.status = status;
+    client.state_since_ms = relay_now_ms();
+    schedule_client_timer(client);
+}
+
+/**
+ * @brief İstemcinin zamanlayıcısını mevcut durumunun en yakın süre sınırına kurar; sınır yoksa iptal
+ * eder. Etkinlik gibi sınırı ileri taşıyan olaylarda yeniden kurulmaz; zamanlayıcı eski sınırda
+ * çalışır ve kalan süreye göre kendini yeniden kurar.
+ */
+void schedule_client_timer(ClientInfo& client) {
+    if (!timer_wheel) return; // io_uring motoru
+    uint64_t deadline = UINT64_MAX;
+    if (client.status == ClientStatus::Resuming) {
+        deadline = client.state_since_ms + resume_grace_seconds * 1000ull;
+    } else if (client.socket_fd >= 0) {
+        if (handshake_timeout_seconds > 0 && handshake_state(client)) {
+            deadline = std::min<uint64_t>(deadline, client.state_since_ms + handshake_timeout_seconds * 1000ull);
+        }
+        if (heartbeat_seconds > 0 && command_state(client)) {
+            deadline = std::min<uint64_t>(deadline, client.last_ping_ms + heartbeat_seconds * 1000ull);
         }
+        if (idle_timeout_seconds > 0 && command_state(client)) {
+            deadline = std::min<uint64_t>(deadline, client.last_activity_ms + idle_timeout_seconds * 1000ull);
+        }
+    }
+    if (deadline == UINT64_MAX) {
+        timer_wheel->cancel(client.timer);
+        return;
+    }
+    uint64_t now = relay_now_ms();
+    timer_wheel->arm(client.timer, deadline > now ? deadline - now : 0);
+}
 
-        ClientInfo& self = clients_by_id.at(client_id);
-
-        // DURUM KONTROLÜ: Tünel modunda mıyız?
-        if (self.status == "VncTunnelling") {
-            // Evet, tünel modundayız. Veriyi doğrudan diğer istemciye yönlendir.
-            if (!self.peer_id.empty() && clients_by_id.count(self.peer_id)) {
-                int peer_socket = clients_by_id.at(self.peer_id).socket_fd;
-                #ifdef __linux__
-                    int flags = MSG_NOSIGNAL;
-                #else
-                    int flags = 0;
-                #endif
-                ::send(peer_socket, buffer, bytes_read, flags);
-            }
-        } 
-        else {
-            // Hayır, komut modundayız. Gelen veriyi komut olarak işle.
-            // Okunan veriyi istemcinin kişisel komut tamponuna ekle
-            self.command_buffer.insert(self.command_buffer.end(), buffer, buffer + bytes_read);
-
-            // Tamponda tam bir komut (newline ile biten) var mı diye kontrol et
-            auto& cb = self.command_buffer;
-            auto newline_it = std::find(cb.begin(), cb.end(), '\n');
-
-            while (newline_it != cb.end()) {
-                // Komutu tampondan çıkar
-                std::string command_line(cb.begin(), newline_it);
-                cb.erase(cb.begin(), newline_it + 1);
-
-                // Boşlukları temizle
-                command_line.erase(0, command_line.find_first_not_of(" \t\r\n"));
-                command_line.erase(command_line.find_last_not_of(" \t\r\n") + 1);
-
-                if(command_line.empty()) {
-                    // Bir sonraki komuta geç
-                    newline_it = std::find(cb.begin(), cb.end(), '\n');
-                    continue;
-                }
-                
-                std::cout << "Sunucu: ID " << client_id << "'den komut alındı: " << command_line << std::endl;
-
-                std::stringstream ss(command_line);
-                std::string command_verb;
-                ss >> command_verb;
-                std::transform(command_verb.begin(), command_verb.end(), command_verb.begin(), ::tolower);
-                
-                // --- Komut İşleme Mantığı ---
-                if (command_verb == "start_vnc_tunnel") {
-                    self.status = "VncReady";
-                    std::cout << "Sunucu: ID " << client_id << " durumu VncReady olarak ayarlandı." << std::endl;
-                    if (!self.peer_id.empty() && clients_by_id.count(self.peer_id)) {
-                        ClientInfo& peer = clients_by_id.at(self.peer_id);
-                        if (peer.status == "VncReady") {
-                            std::cout << "Sunucu: Her iki taraf da VncReady! ID " << client_id << " ve ID " << self.peer_id << " için VncTunnelling başlatılıyor." << std::endl;
-                            
-                            self.status = "VncTunnelling";
-                            peer.status = "VncTunnelling";
-                            
-                            send_message(self.socket_fd, "TUNNEL_ACTIVE");
-                            send_message(peer.socket_fd, "TUNNEL_ACTIVE");
-
-                            // Komut modundayken birikmiş olabilecek verileri temizle ve yönlendir
-                            if (!peer.command_buffer.empty()) {
-                                ::send(self.socket_fd, peer.command_buffer.data(), peer.command_buffer.size(), 0);
-                                peer.command_buffer.clear();
-                            }
-                            if (!self.command_buffer.empty()) {
-                                ::send(peer.socket_fd, self.command_buffer.data(), self.command_buffer.size(), 0);
-                                self.command_buffer.clear();
-                            }
-                        }
-                    }
-                }
-                else if (command_verb == "connect") {
-                    std::string target_id;
-                    ss >> target_id;
-                    if (clients_by_id.count(target_id) && client_id != target_id && self.status == "Idle" && clients_by_id.at(target_id).status == "Idle") {
-                        ClientInfo& target = clients_by_id.at(target_id);
-                        self.status = "Connecting";
-                        self.peer_id = target_id;
-                        target.status = "Connecting";
-                        target.peer_id = client_id;
-                        send_message(target.socket_fd, "INCOMING " + client_id);
-                        send_message(self.socket_fd, "CONNECTING " + target_id);
-                        std::cout << "Sunucu: " << client_id << " -> " << target_id << " bağlantı isteği gönderildi." << std::endl;
-                    } else {
-                        send_message(client_socket, "ERROR CONNECT: Hedef veya siz uygun durumda değilsiniz ya da ID geçersiz.");
-                    }
-                }
-                else if (command_verb == "accept") {
-                    std::string requester_id;
-                    ss >> requester_id;
-                    if (self.status == "Connecting" && self.peer_id == requester_id && clients_by_id.count(requester_id) && clients_by_id.at(requester_id).status == "Connecting") {
-                        ClientInfo& requester = clients_by_id.at(requester_id);
-                        self.status = "Connected";
-                        requester.status = "Connected";
-                        send_message(requester.socket_fd, "ACCEPTED " + client_id);
-                        send_message(self.socket_fd, "CONNECTION_ESTABLISHED " + requester_id);
-                        std::cout << "Sunucu: " << client_id << " <-> " << requester_id << " bağlantısı kuruldu." << std::endl;
-                    } else {
-                        send_message(client_socket, "ERROR ACCEPT: Geçersiz kabul komutu veya durum.");
-                    }
-                }
-                // ... diğer komutlar (list, reject, disconnect, msg) buraya eklenebilir ...
-                else {
-                    send_message(client_socket, "ERROR Bilinmeyen komut: " + command_verb);
-                }
-                print_server_clients_list();
+// Süresi içinde tünele geçemeyen ucun eşleşmesini kaldırır; iki uç da PEER_DISCONNECTED alır
+void expire_handshake(ClientInfo& client) {
+    LOG(LOG_INFO) << "Sunucu: ID " << client.id << " " << client_status_name(client.status) << " durumunda "
+                  << handshake_timeout_seconds << " sn içinde ilerlemedi; eşleşme kaldırılıyor.";
+    relay_metrics.handshake_timeouts.fetch_add(1, std::memory_order_relaxed);
+    ClientId peer_id = client.peer_id;
+    std::shared_ptr<ClientInfo> peer = registry.find(peer_id);
+    if (peer && owned_here(*peer) && peer->peer_id == client.id) release_peer(*peer, client.id);
+    // Peer bir proxy ise kapanışı bu ucu zaten serbest bırakmıştır
+    if (client.socket_fd >= 0 && client.peer_id == peer_id) release_peer(client, peer_id);
+}
 
-                // Bir sonraki komut için döngüye devam et
-                newline_it = std::find(cb.begin(), cb.end(), '\n');
+// İstemcinin zamanlayıcısı dolduğunda (sahibi olan worker'da) çağrılır
+void on_client_timer(ClientInfo& client) {
+    uint64_t now = relay_now_ms();
+    if (client.status == ClientStatus::Resuming) {
+        if (now >= client.state_since_ms + resume_grace_seconds * 1000ull) {
+            expire_parked_client(client);
+            return;
+        }
+    } else if (client.socket_fd < 0) {
+        return;
+    } else if (handshake_timeout_seconds > 0 && handshake_state(client) &&
+               now >= client.state_since_ms + handshake_timeout_seconds * 1000ull) {
+        expire_handshake(client);
+        return; // Idle durumuna geçişte zamanlayıcı yeniden kuruldu
+    } else if (command_state(client)) {
+        if (idle_timeout_seconds > 0 && now >= client.last_activity_ms + idle_timeout_seconds * 1000ull) {
+            LOG(LOG_INFO) << "Sunucu: ID " << client.id << " " << idle_timeout_seconds
+                          << " sn boyunca bir şey göndermedi; bağlantı kapatılıyor.";
+            relay_metrics.idle_evictions.fetch_add(1, std::memory_order_relaxed);
+            close_client(client);
+            return;
+        }
+        if (heartbeat_seconds > 0 && now >= client.last_ping_ms + heartbeat_seconds * 1000ull) {
+            client.last_ping_ms = now;
+            relay_metrics.heartbeats_sent.fetch_add(1, std::memory_order_relaxed);
+            if (!send_control(client, CTRL_PING)) {
+                close_client(client);
+                return;
             }
         }
-    } // while(true) sonu
+    }
+    schedule_client_timer(client);
+}
 
-    // Döngüden çıkıldıysa, bağlantı kopmuştur. Temizlik yap.
-    cleanup_client(client_id, client_socket);
-    ::close(client_socket);
-    std::cout << "Sunucu: İstemci thread'i sonlandırıldı ID: " << client_id << std::endl;
+// Yeni istemcinin süre sınırlarını başlatır (istemcinin worker'ında, kayıttan sonra)
+void start_client_timer(ClientInfo& client) {
+    client.state_since_ms = client.last_activity_ms = client.last_ping_ms = relay_now_ms();
+    watch_client_timer(client);
 }
 
+// İstemcinin zamanlayıcısını worker'ın çarkına bağlar ve mevcut durumuna göre kurar
+void watch_client_timer(ClientInfo& client) {
+    ClientInfo* self = &client; // Zamanlayıcı istemcinin içindedir ve cleanup_client'ta iptal edilir
+    client.timer.callback = [self]() { on_client_timer(*self); };
+    schedule_client_timer(client);
+}
 
-// --- Ana Sunucu Fonksiyonu ---
-int main(int argc, char *argv[]) {
-    // Sinyal yönetimi (isteğe bağlı ama iyi pratik)
-    signal(SIGPIPE, SIG_IGN); 
+/**
+ * @brief Yeni bağlantıyı (self) park edilmiş tünel ucunun yerine geçirir: soket parked'a devredilir,
+ * self'in geçici ID'si bırakılır ve oturum ucun bildirdiği konumdan devam eder. Eksik veri artık
+ * saklanmıyorsa akış byte-byte sürdürülemeyeceği için tünel kapatılır.
+ */
+void resume_parked_client(ClientInfo& self, const std::shared_ptr<ClientInfo>& parked_ptr, uint64_t received) {
+    ClientInfo& parked = *parked_ptr;
+    if (!parked.session->reattach(parked, received)) {
+        LOG(LOG_INFO) << "Sunucu: ID " << parked.id << " devam ettirilemedi (alınan: " << received
+                      << " byte, eksik veri saklanmıyor); tünel kapatılıyor.";
+        send_control(self, CTRL_ERROR, "RESUME: Eksik veri artık saklanmıyor; tünel kapatıldı.");
+        cleanup_client(parked);
+        return;
+    }
+    cancel_resume(parked);
 
-    int listen_port = 12345;
-    if (argc == 2) {
-        try {
-            listen_port = std::stoi(argv[1]);
-        } catch (const std::exception& e) {
-            std::cerr << "Hata: Geçersiz port numarası. " << e.what() << std::endl;
-            return 1;
-        }
+    int fd = self.socket_fd;
+    relay_loop->remove(fd);
+    self.socket_fd = -1;
+    timer_wheel->cancel(self.timer);
+    if (registry.remove(self.id)) {
+        relay_metrics.clients_connected.fetch_sub(1, std::memory_order_relaxed);
     }
+    bool registered = relay_loop->add(fd, CLIENT_EVENTS, [parked_ptr](uint32_t events) {
+        handle_client_event(parked_ptr, events);
+    });
+    if (!registered) {
+        ::close(fd);
+        cleanup_client(parked);
+        return;
+    }
+    parked.socket_fd = fd;
+    parked.ip_address = self.ip_address;
+    parked.binary_protocol = self.binary_protocol;
+    parked.output_buffer.swap(self.output_buffer); // ID satırı henüz gönderilmemiş olabilir
+    set_status(parked, ClientStatus::VncTunnelling);
+    send_control(parked, CTRL_RESUMED, std::to_string(parked.session->received_from(parked)));
 
-    int server_fd;
-    struct sockaddr_in address;
-    if ((server_fd = ::socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-        perror("Soket oluşturulamadı");
-        exit(EXIT_FAILURE);
+    // Komuttan sonra gelenler ucun kaldığı yerden gönderdiği tünel verisidir
+    if (!self.command_buffer.empty()) {
+        parked.session->push(parked, self.command_buffer.data(), self.command_buffer.size());
+        self.command_buffer.clear();
     }
+    parked.session->on_writable(parked); // Eksik kalan veriyi yeniden gönder
+    relay_metrics.tunnel_resumes.fetch_add(1, std::memory_order_relaxed);
+    LOG(LOG_INFO) << "Sunucu: ID " << parked.id << " yeni bağlantıyla döndü (Soket: " << fd << "); tünel "
+                  << received << ". byte'tan devam ediyor.";
+}
 
-    int opt = 1;
-    if (::setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
-        perror("setsockopt hatası");
-        ::close(server_fd);
-        exit(EXIT_FAILURE);
+// Doğrudan bağlantı denemesinin durumunu siler; buluşma belirteci artık yanıtlanmaz
+void clear_p2p(ClientInfo& client) {
+    if (!client.p2p_token.empty() && rendezvous) rendezvous->forget(client.p2p_token);
+    client.p2p_token.clear();
+    client.p2p_candidates.clear();
+    client.p2p_mapped = false;
+}
+
+// İki ucun da UDP adresi gözlendiyse her uca eşinin adaylarını ve ortak hole punching anahtarını gönderir
+void exchange_p2p_candidates(ClientInfo& self) {
+    std::shared_ptr<ClientInfo> peer_ptr = registry.find(self.peer_id);
+    if (!peer_ptr || !owned_here(*peer_ptr) || peer_ptr->peer_id != self.id || !self.p2p_mapped ||
+        !peer_ptr->p2p_mapped) {
+        return;
     }
-    
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY; // Tüm arayüzlerden dinle
-    address.sin_port = htons(listen_port);
+    ClientInfo& peer = *peer_ptr;
+    const std::string key = generate_random_token();
+    send_control(self, CTRL_P2P_CANDIDATES, key + " " + peer.p2p_candidates);
+    send_control(peer, CTRL_P2P_CANDIDATES, key + " " + self.p2p_candidates);
+    relay_metrics.p2p_exchanges.fetch_add(1, std::memory_order_relaxed);
+    LOG(LOG_INFO) << "Sunucu: ID " << self.id << " (" << self.p2p_candidates << ") <-> ID " << peer.id << " ("
+                  << peer.p2p_candidates << ") doğrudan bağlantı adayları gönderildi.";
+}
 
-    if (::bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        perror("Bağlama (bind) hatası");
-        ::close(server_fd);
-        exit(EXIT_FAILURE);
+// Buluşma soketinin thread'inde (worker 0) çağrılır; ucun durumu kendi worker'ında güncellenir
+void on_rendezvous_bound(ClientId id, const std::string& token, const std::string& address) {
+    std::shared_ptr<ClientInfo> client = registry.find(id);
+    if (!client) return;
+    workers[client->owner_worker.load(std::memory_order_acquire)]->loop->post([client, token, address]() {
+        ClientInfo& self = *client;
+        if (!owned_here(self) || self.socket_fd < 0 || self.p2p_token != token || self.p2p_mapped) return;
+        self.p2p_mapped = true;
+        self.p2p_candidates = prepend_observed_candidate(address, self.p2p_candidates);
+        exchange_p2p_candidates(self);
+    });
+}
+
+/**
+ * @brief Başka relay'deki ajanı temsil eden istemciyi (proxy) bu worker'da oluşturur. fd bir
+ * socketpair'in relay ucudur; diğer ucu küme kanalıdır. Proxy ikili protokol konuşan sıradan
+ * bir istemci gibi işlenir.
+ * @return ID bu relay'de zaten kayıtlıysa veya soket döngüye eklenemezse nullptr (fd kapatılmaz).
+ */
+std::shared_ptr<ClientInfo> create_proxy(int fd, ClientId id, int node) {
+    auto proxy = std::make_shared<ClientInfo>();
+    proxy->socket_fd = fd;
+    proxy->ip_address = "relay#" + std::to_string(node);
+    proxy->binary_protocol = true;
+    proxy->remote_node = node;
+    proxy->owner_worker.store(current_worker, std::memory_order_release);
+    if (!registry.register_remote(id, proxy)) return nullptr;
+    bool registered = relay_loop->add(fd, CLIENT_EVENTS, [proxy](uint32_t events) {
+        handle_client_event(proxy, events);
+    });
+    if (!registered) {
+        registry.remove(id);
+        return nullptr;
     }
+    start_client_timer(*proxy);
+    LOG(LOG_DEBUG) << "Sunucu: ID " << id << " için düğüm " << node << " proxy'si oluşturuldu (Soket: " << fd << ")";
+    return proxy;
+}
 
-    if (::listen(server_fd, 10) < 0) {
-        perror("Dinleme (listen) hatası");
-        ::close(server_fd);
-        exit(EXIT_FAILURE);
+// Hedef ID başka bir düğüme aitse o düğüme kanal açar ve hedefin proxy'sini döner
+std::shared_ptr<ClientInfo> open_remote_peer(ClientInfo& self, ClientId target_id) {
+    int node = (int)registry.partition_of(target_id);
+    if (node == cluster->node() || !cluster->connect_remote(node, self.id, target_id)) return nullptr;
+    return registry.find(target_id);
+}
+
+// Durdurulmuş okumayı yeniden başlatır (EPOLL_CTL_MOD kenar tetiklemeli kaydı yeniden kurar)
+void resume_client_reading(ClientInfo& client) {
+    if (uring_relay) {
+        uring_relay->resume_reading(client);
+        return;
     }
+    if (!client.read_paused || client.socket_fd < 0) return;
+    client.read_paused = false;
+    relay_loop->modify(client.socket_fd, CLIENT_EVENTS);
+}
+
+/**
+ * @brief Idle durumdaki istemciyi hedef worker'a aktarır: soket bu döngüden çıkarılır, sahiplik
+ * devredilir, hedef döngüde yeniden kaydedilir ve komut ile tamponda kalanlar orada işlenir.
+ * Çağrıdan sonra istemcinin alanlarına bu thread'den dokunulmamalıdır.
+ */
+void hand_off_client(ClientInfo& self, int target_worker, ControlType type, std::string_view argument) {
+    std::shared_ptr<ClientInfo> client = registry.find(self.id);
+    if (!client) return;
+
+    LOG(LOG_DEBUG) << "Sunucu: ID " << self.id << " worker " << current_worker << " -> worker " << target_worker
+                   << " aktarılıyor (" << control_type_text(type) << " " << argument << ")";
+    relay_loop->remove(self.socket_fd);
+    timer_wheel->cancel(self.timer); // Zamanlayıcı hedef worker'ın çarkında yeniden kurulur
+    client->owner_worker.store(target_worker, std::memory_order_release);
+
+    // Argüman çağıranın tamponuna işaret eder; hedef döngüde çalışacak görev kendi kopyasını taşır
+    workers[target_worker]->loop->post([client, type, argument = std::string(argument)]() {
+        ClientInfo& self = *client;
+        // Kenar tetiklemeli kayıt eklenirken soket zaten okunabilir/yazılabilirse olay hemen üretilir
+        bool registered = relay_loop->add(self.socket_fd, CLIENT_EVENTS, [client](uint32_t events) {
+            handle_client_event(client, events);
+        });
+        if (!registered) {
+            close_client(self);
+            return;
+        }
+        schedule_client_timer(self);
+        handle_command(self, type, argument, false);
+        consume_client_data(self, nullptr, 0);
+    });
+}
 
-    std::cout << "Sunucu başlatıldı. Dinlenen Port: " << listen_port << std::endl;
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
+/**
+ * @brief Eski metin protokolündeki tek bir komut satırını çözer ve işler.
+ */
+void handle_command_line(ClientInfo& self, const std::string& command_line) {
+    TextCommand command;
+    ControlType type;
+    if (!parse_text_command(command_line, &command, &type)) {
+        LOG(LOG_INFO) << "Sunucu: ID " << self.id << "'den bilinmeyen komut alındı: " << command_line;
+        send_control(self, CTRL_ERROR, "Bilinmeyen komut: " + command.verb);
         print_server_clients_list();
+        return;
     }
+    handle_command(self, type, command.argument);
+}
 
-    while (true) {
-        struct sockaddr_in client_address;
-        socklen_t client_addrlen = sizeof(client_address);
-        int new_socket = ::accept(server_fd, (struct sockaddr *)&client_address, &client_addrlen);
 
-        if (new_socket < 0) {
-            if (errno == EINTR) continue;
-            perror("Bağlantı kabul (accept) hatası");
-            continue;
+/**
+ * @brief '--capture-dir=' verildiyse tünelin trafiğini yeni bir kayıt dosyasına yönlendirir
+ * (yön 0: a -> b). Dosya açılamazsa tünel kayıtsız devam eder.
+ */
+void start_capture(TunnelSession& session, const ClientInfo& a, const ClientInfo& b) {
+    if (capture_dir.empty()) return;
+    std::string path = capture_dir + "/tunnel-" + std::to_string(time(nullptr)) + "-" + std::to_string(a.id) +
+                       "-" + std::to_string(b.id) + ".rcap";
+    try {
+        session.capture_to(std::unique_ptr<CaptureWriter>(new CaptureWriter(
+            path, "relay a=" + std::to_string(a.id) + " b=" + std::to_string(b.id), capture_limit_bytes)));
+        LOG(LOG_INFO) << "Tünel: ID " << a.id << " - ID " << b.id << " trafiği kaydediliyor: " << path;
+    } catch (const std::system_error& e) {
+        LOG_RATE_LIMITED(LOG_WARN, 1) << "Tünel kaydı açılamadı: " << e.what();
+    }
+}
+
+/**
+ * @brief İki ucun start_vnc_tunnel ile istediği seçeneklerin kesişimi (ilk ucun sırasıyla).
+ */
+std::string common_tunnel_options(const std::string& a, const std::string& b) {
+    std::istringstream wanted(a);
+    std::string option;
+    std::string common;
+    while (wanted >> option) {
+        std::istringstream offered(b);
+        std::string other;
+        bool found = false;
+        while (offered >> other) {
+            if (other == option) found = true;
         }
+        if (found && (" " + common + " ").find(" " + option + " ") == std::string::npos) {
+            common += (common.empty() ? "" : " ") + option;
+        }
+    }
+    return common;
+}
+
+/**
+ * @brief Çoğullanmış uca veri kanallarını sıfırlatan MUX_RESET çerçevesini gönderir.
+ */
+void send_mux_reset(ClientInfo& client) {
+    char frame[MUX_HEADER_SIZE];
+    encode_mux_header(MUX_CHANNEL_CONTROL, MUX_RESET, 0, frame);
+    queue_send(client, frame, sizeof(frame));
+}
+
+/**
+ * @brief Komut modundaki tek bir kontrol mesajını işler (metin ve ikili protokol için ortak).
+ * @param allow_handoff false ise hedef başka bir worker'daki connect isteği reddedilir
+ * (istemci zaten bir kez aktarılmıştır; iki ucun karşılıklı aktarımla yer değiştirmesini önler).
+ */
+void handle_command(ClientInfo& self, ControlType type, std::string_view argument, bool allow_handoff) {
+    ScopedLatency timer(relay_metrics.command_latency(type)); // İşleme süresi (aktarımlar dahil)
+    const ClientId client_id = self.id;
+    LOG(LOG_DEBUG) << "Sunucu: ID " << client_id << "'den komut alındı: " << control_type_text(type)
+                   << (argument.empty() ? "" : " ") << argument;
+
+    // --- Komut İşleme Mantığı ---
+    // Çoğullanmış uç tünel sürerken de komut gönderebilir; tünelin durumunu değiştirmeyenler dışında
+    if (self.status == ClientStatus::VncTunnelling && type != CTRL_PONG && type != CTRL_DISCONNECT) {
+        send_control(self, CTRL_ERROR, "Tünel sürerken yalnızca disconnect ve pong kabul edilir.");
+        return;
+    }
+    if (type == CTRL_HELLO) {
+        // İkili istemci metin ID satırını atlar; ID'yi çerçeve olarak yeniden alır
+        send_control(self, CTRL_ID, client_id);
+        return;
+    }
+    else if (type == CTRL_START_VNC_TUNNEL) {
+        clear_p2p(self); // Doğrudan bağlantı denemesi (varsa) bırakıldı
+        self.tunnel_options = argument;
+        set_status(self, ClientStatus::VncReady);
+        LOG(LOG_DEBUG) << "Sunucu: ID " << client_id << " durumu VncReady olarak ayarlandı.";
+        std::shared_ptr<ClientInfo> peer_ptr = registry.find(self.peer_id);
+        if (peer_ptr && owned_here(*peer_ptr) && peer_ptr->status == ClientStatus::VncReady) {
+            ClientInfo& peer = *peer_ptr;
+            LOG(LOG_INFO) << "Sunucu: Her iki taraf da VncReady! ID " << client_id << " ve ID " << self.peer_id << " için VncTunnelling başlatılıyor.";
+
+            set_status(self, ClientStatus::VncTunnelling);
+            set_status(peer, ClientStatus::VncTunnelling);
+
+            // Devam ettirme açıksa her uç kendi belirtecini TUNNEL_ACTIVE yükünde alır (proxy yok sayar).
+            // Çoğullanmış tünel devam ettirilmez; uçlar önce veri kanallarını sıfırlar.
+            if (resume_grace_seconds > 0 && !uring_relay && !self.mux) {
+                self.resume_token = generate_random_token();
+                peer.resume_token = generate_random_token();
+            }
+            if (self.mux) {
+                send_mux_reset(self);
+                send_mux_reset(peer);
+            }
+            std::string options = common_tunnel_options(self.tunnel_options, peer.tunnel_options);
+            if (!options.empty()) {
+                send_control(self, CTRL_TUNNEL_OPTIONS, options);
+                send_control(peer, CTRL_TUNNEL_OPTIONS, options);
+            }
+            send_control(self, CTRL_TUNNEL_ACTIVE, self.resume_token);
+            send_control(peer, CTRL_TUNNEL_ACTIVE, peer.resume_token);
 
-        std::string client_ip_str = inet_ntoa(client_address.sin_addr);
-        std::string new_id_str;
-        
-        {
-            std::lock_guard<std::mutex> lock(clients_mutex);
-            new_id_str = generate_unique_id_unlocked();
-            clients_by_id[new_id_str] = {new_socket, client_ip_str, "Idle", ""};
-            id_by_socket[new_socket] = new_id_str;
+            // Bundan sonra iki uç arasındaki trafik yalnızca oturum nesnesi (io_uring motorunda
+            // motorun kendi tünel yolu) üzerinden akar
+            if (uring_relay) {
+                // VncReady durumundayken birikmiş olabilecek verileri temizle ve yönlendir
+                if (!peer.command_buffer.empty()) {
+                    queue_send(self, peer.command_buffer.data(), peer.command_buffer.size());
+                    peer.command_buffer.clear();
+                }
+                if (!self.command_buffer.empty()) {
+                    queue_send(peer, self.command_buffer.data(), self.command_buffer.size());
+                    self.command_buffer.clear();
+                }
+                uring_relay->open_tunnel(self, peer);
+                resume_client_reading(self);
+                resume_client_reading(peer);
+                print_server_clients_list();
+                return;
+            }
+            auto session = std::make_shared<TunnelSession>(*relay_loop, self, peer,
+                                                           splice_forwarding_enabled && capture_dir.empty(),
+                                                           tunnel_limits, egress_scheduler);
+            start_capture(*session, self, peer);
+            self.session = session;
+            peer.session = session;
+            // VncReady durumundayken biriken veri oturumdan geçer; devam ettirmede akış konumuna sayılır
+            if (self.mux) {
+                push_mux_input(*session, peer);
+                push_mux_input(*session, self);
+            } else {
+                if (!peer.command_buffer.empty()) {
+                    session->push(peer, peer.command_buffer.data(), peer.command_buffer.size());
+                    peer.command_buffer.clear();
+                }
+                if (!self.command_buffer.empty()) {
+                    session->push(self, self.command_buffer.data(), self.command_buffer.size());
+                    self.command_buffer.clear();
+                }
+            }
+            // VncReady tamponu dolduğu için durdurulmuş okumalar artık oturum üzerinden devam eder
+            resume_client_reading(self);
+            resume_client_reading(peer);
+        } else if (peer_ptr && owned_here(*peer_ptr) && peer_ptr->remote_node >= 0 && self.remote_node < 0) {
+            // Diğer relay'deki eş hazır olduğunda proxy'si start_vnc_tunnel gönderir
+            send_control(*peer_ptr, CTRL_START_VNC_TUNNEL);
+        }
+    }
+    else if (type == CTRL_CONNECT) {
+        ClientId target_id = NO_CLIENT;
+        parse_client_id(argument, &target_id); // Geçersizse NO_CLIENT kalır ve find nullptr döner
+        std::shared_ptr<ClientInfo> target_ptr = registry.find(target_id);
+        if (!target_ptr && cluster && target_id != NO_CLIENT && self.status == ClientStatus::Idle && self.remote_node < 0 && !self.mux) {
+            target_ptr = open_remote_peer(self, target_id); // Hedef başka bir relay'de
+        }
+        // Hedefin alanları yalnızca sahibi olan worker'da okunabilir; hedef başka bir worker'daysa
+        // bu istemci oraya aktarılır ve komut orada yeniden işlenir
+        if (target_ptr && client_id != target_id && self.status == ClientStatus::Idle && !owned_here(*target_ptr) && allow_handoff) {
+            hand_off_client(self, target_ptr->owner_worker.load(std::memory_order_acquire), type, argument);
+            return;
+        }
+        if (target_ptr && client_id != target_id && self.status == ClientStatus::Idle && owned_here(*target_ptr) && target_ptr->status == ClientStatus::Idle &&
+            target_ptr->mux != self.mux) {
+            send_control(self, CTRL_ERROR, "CONNECT: İki uç da aynı bağlantı kipini (mux) kullanmalıdır.");
+        } else if (target_ptr && client_id != target_id && self.status == ClientStatus::Idle && owned_here(*target_ptr) && target_ptr->status == ClientStatus::Idle) {
+            ClientInfo& target = *target_ptr;
+            set_status(self, ClientStatus::Connecting);
+            self.peer_id = target_id;
+            set_status(target, ClientStatus::Connecting);
+            target.peer_id = client_id;
+            send_control(target, CTRL_INCOMING, client_id);
+            send_control(self, CTRL_CONNECTING, target_id);
+            LOG(LOG_INFO) << "Sunucu: " << client_id << " -> " << target_id << " bağlantı isteği gönderildi.";
+        } else {
+            send_control(self, CTRL_ERROR, "CONNECT: Hedef veya siz uygun durumda değilsiniz ya da ID geçersiz.");
+        }
+    }
+    else if (type == CTRL_ACCEPT) {
+        ClientId requester_id = NO_CLIENT;
+        parse_client_id(argument, &requester_id);
+        std::shared_ptr<ClientInfo> requester_ptr = registry.find(requester_id);
+        if (self.status == ClientStatus::Connecting && self.peer_id == requester_id && requester_ptr && owned_here(*requester_ptr) &&
+            requester_ptr->status == ClientStatus::Connecting) {
+            ClientInfo& requester = *requester_ptr;
+            set_status(self, ClientStatus::Connected);
+            set_status(requester, ClientStatus::Connected);
+            send_control(requester, CTRL_ACCEPTED, client_id);
+            send_control(self, CTRL_CONNECTION_ESTABLISHED, requester_id);
+            LOG(LOG_INFO) << "Sunucu: " << client_id << " <-> " << requester_id << " bağlantısı kuruldu.";
+        } else {
+            send_control(self, CTRL_ERROR, "ACCEPT: Geçersiz kabul komutu veya durum.");
+        }
+    }
+    else if (type == CTRL_BROADCAST) {
+        // Yük: [drop|coalesce|disconnect] [rfb] (sıra önemsiz)
+        SlowViewerPolicy policy = slow_viewer_policy;
+        bool rfb = false;
+        bool valid = true;
+        std::istringstream options{std::string(argument)};
+        std::string option;
+        while (options >> option) {
+            if (option == "rfb") {
+                rfb = true;
+            } else if (!parse_slow_viewer_policy(option, &policy)) {
+                valid = false;
+            }
+        }
+        if (uring_relay) {
+            send_control(self, CTRL_ERROR, "BROADCAST: Yayın oturumları io_uring motorunda desteklenmiyor.");
+        } else if (self.mux) {
+            send_control(self, CTRL_ERROR, "BROADCAST: Çoğullanmış bağlantılarda yayın desteklenmiyor.");
+        } else if (self.status != ClientStatus::Idle || !valid) {
+            send_control(self, CTRL_ERROR, "BROADCAST: Uygun durumda değilsiniz veya seçenek geçersiz (drop|coalesce|disconnect, rfb).");
+        } else {
+            auto fanout = std::make_shared<FanoutSession>(*relay_loop, self, tunnel_limits, viewer_lag_limit, policy,
+                                                          handle_slow_viewer, rfb ? rfb_cache_limit : 0);
+            set_status(self, ClientStatus::Broadcasting);
+            self.fanout = fanout;
+            send_control(self, CTRL_TUNNEL_ACTIVE);
+            // Komuttan sonra gelenler yayın verisidir; ilk izleyiciye kadar oturumda bekler
+            if (!self.command_buffer.empty()) {
+                fanout->push(self, self.command_buffer.data(), self.command_buffer.size());
+                self.command_buffer.clear();
+            }
+            LOG(LOG_INFO) << "Sunucu: ID " << client_id << " yayın başlattı (yavaş izleyici politikası: "
+                          << slow_viewer_policy_name(policy) << (rfb ? ", RFB önbelleği açık" : "") << ").";
+        }
+    }
+    else if (type == CTRL_WATCH) {
+        ClientId sharer_id = NO_CLIENT;
+        parse_client_id(argument, &sharer_id);
+        std::shared_ptr<ClientInfo> sharer_ptr = registry.find(sharer_id);
+        // İzleyiciler paylaşanın worker'ında toplanır; yayın verisi thread sınırı aşmaz
+        if (sharer_ptr && self.status == ClientStatus::Idle && !owned_here(*sharer_ptr) && allow_handoff) {
+            hand_off_client(self, sharer_ptr->owner_worker.load(std::memory_order_acquire), type, argument);
+            return;
+        }
+        if (self.mux) {
+            send_control(self, CTRL_ERROR, "WATCH: Çoğullanmış bağlantılarda yayın desteklenmiyor.");
+        } else if (sharer_ptr && self.status == ClientStatus::Idle && owned_here(*sharer_ptr) && sharer_ptr->status == ClientStatus::Broadcasting &&
+                   sharer_ptr->fanout) {
+            set_status(self, ClientStatus::Watching);
+            self.peer_id = sharer_id;
+            self.fanout = sharer_ptr->fanout;
+            send_control(self, CTRL_TUNNEL_ACTIVE); // Yayın verisinden önce gider
+            self.fanout->add_viewer(self);
+            if (!self.command_buffer.empty()) {
+                self.fanout->push(self, self.command_buffer.data(), self.command_buffer.size());
+                self.command_buffer.clear();
+            }
+            LOG(LOG_INFO) << "Sunucu: ID " << client_id << ", ID " << sharer_id << " yayınını izliyor (izleyici sayısı: "
+                          << self.fanout->viewer_count() << ").";
+        } else {
+            send_control(self, CTRL_ERROR, "WATCH: Yayın bulunamadı veya uygun durumda değilsiniz.");
+        }
+    }
+    else if (type == CTRL_RESUME) {
+        std::string token;
+        uint64_t received = 0;
+        std::istringstream fields{std::string(argument)};
+        fields >> token >> received;
+        std::shared_ptr<ClientInfo> parked = fields ? parked_clients.find(token) : nullptr;
+        // Oturum park edilmiş ucun worker'ındadır; yeni bağlantı oraya aktarılır
+        if (parked && self.status == ClientStatus::Idle && !owned_here(*parked) && allow_handoff) {
+            hand_off_client(self, parked->owner_worker.load(std::memory_order_acquire), type, argument);
+            return;
+        }
+        if (parked && self.status == ClientStatus::Idle && owned_here(*parked) && parked->status == ClientStatus::Resuming) {
+            resume_parked_client(self, parked, received);
+        } else {
+            send_control(self, CTRL_ERROR, "RESUME: Belirteç geçersiz veya süresi dolmuş.");
+        }
+    }
+    else if (type == CTRL_P2P) {
+        std::shared_ptr<ClientInfo> peer_ptr = registry.find(self.peer_id);
+        std::string candidates;
+        if (!rendezvous) {
+            send_control(self, CTRL_ERROR, "P2P: Doğrudan bağlantı kapalı (buluşma portu yok).");
+        } else if (self.status != ClientStatus::Connected || !peer_ptr || !owned_here(*peer_ptr) || peer_ptr->remote_node >= 0 ||
+                   !self.p2p_token.empty() || !parse_p2p_candidates(argument, &candidates)) {
+            send_control(self, CTRL_ERROR, "P2P: Uygun durumda değilsiniz veya aday listesi geçersiz.");
+        } else {
+            self.p2p_token = generate_random_token();
+            self.p2p_candidates = candidates;
+            rendezvous->expect(self.p2p_token, client_id);
+            send_control(self, CTRL_P2P_BIND, self.p2p_token + " " + std::to_string(rendezvous->port()));
+        }
+    }
+    else if (type == CTRL_P2P_RESULT) {
+        std::shared_ptr<ClientInfo> peer_ptr = registry.find(self.peer_id);
+        bool peer_here = peer_ptr && owned_here(*peer_ptr);
+        if (argument == "direct" && self.status == ClientStatus::Connected && self.p2p_mapped && peer_here) {
+            set_status(self, ClientStatus::Direct);
+            if (peer_ptr->status == ClientStatus::Direct) {
+                relay_metrics.p2p_direct.fetch_add(1, std::memory_order_relaxed);
+                LOG(LOG_INFO) << "Sunucu: ID " << client_id << " <-> ID " << self.peer_id
+                              << " doğrudan bağlandı; relay tüneli kullanılmıyor.";
+            }
+        } else if (argument == "relay" && (self.status == ClientStatus::Connected || self.status == ClientStatus::Direct) && peer_here) {
+            // Eşi hâlâ deniyorsa veya doğrudan yoldaysa o da relay tüneline yönlendirilir
+            ClientInfo& peer = *peer_ptr;
+            bool attempt = !self.p2p_token.empty() || self.status == ClientStatus::Direct;
+            bool notify = (peer.status == ClientStatus::Connected || peer.status == ClientStatus::Direct) &&
+                          (!peer.p2p_token.empty() || peer.status == ClientStatus::Direct);
+            clear_p2p(self);
+            set_status(self, ClientStatus::Connected);
+            if (notify) {
+                clear_p2p(peer);
+                set_status(peer, ClientStatus::Connected);
+                send_control(peer, CTRL_P2P_FALLBACK, client_id);
+            }
+            if (attempt || notify) {
+                relay_metrics.p2p_fallbacks.fetch_add(1, std::memory_order_relaxed);
+                LOG(LOG_INFO) << "Sunucu: ID " << client_id << " <-> ID " << self.peer_id
+                              << " doğrudan bağlantı kurulamadı veya koptu; relay tüneline dönülüyor.";
+            }
+        } else {
+            send_control(self, CTRL_ERROR, "P2P_RESULT: Geçersiz sonuç (direct|relay) veya durum.");
+        }
+    }
+    else if (type == CTRL_PONG) {
+        return; // Kalp atışı yanıtı; alınan veri boşta kalma sayacını zaten sıfırladı
+    }
+    else if (type == CTRL_MUX) {
+        if (uring_relay) {
+            send_control(self, CTRL_ERROR, "MUX: Kanal çoğullama io_uring motorunda desteklenmiyor.");
+        } else if (self.status != ClientStatus::Idle || self.mux || self.remote_node >= 0) {
+            send_control(self, CTRL_ERROR, "MUX: Uygun durumda değilsiniz.");
+        } else {
+            send_control(self, CTRL_MUX_OK); // Çerçevesiz son mesaj
+            self.mux = true;
+            // Kontrol çerçeveleri çekirdekte biriken tünel verisinin arkasında beklemesin
+            int lowat = MUX_NOTSENT_LOWAT;
+            ::setsockopt(self.socket_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+            LOG(LOG_INFO) << "Sunucu: ID " << client_id << " çoğullanmış bağlantıya geçti.";
+        }
+    }
+    else if (type == CTRL_DISCONNECT) {
+        bool paired = self.status == ClientStatus::Connecting || self.status == ClientStatus::Connected || self.status == ClientStatus::VncReady ||
+                      self.status == ClientStatus::VncTunnelling || self.status == ClientStatus::Direct;
+        if (!paired) {
+            send_control(self, CTRL_ERROR, "DISCONNECT: Bir eşleşmede değilsiniz.");
+            return;
+        }
+        ClientId peer_id = self.peer_id;
+        if (self.session) {
+            self.session->close();
+            self.session.reset();
         }
+        set_status(self, ClientStatus::Idle);
+        self.peer_id = NO_CLIENT;
+        self.mux_pending.clear();
+        self.resume_token.clear();
+        clear_p2p(self);
+        resume_client_reading(self);
+        std::shared_ptr<ClientInfo> peer_ptr = registry.find(peer_id);
+        if (peer_ptr && owned_here(*peer_ptr) && peer_ptr->peer_id == client_id) {
+            release_peer(*peer_ptr, client_id);
+        } else if (peer_ptr && !owned_here(*peer_ptr)) {
+            workers[peer_ptr->owner_worker.load(std::memory_order_acquire)]->loop->post([peer_ptr, client_id]() {
+                if (owned_here(*peer_ptr) && peer_ptr->socket_fd >= 0 && peer_ptr->peer_id == client_id) {
+                    release_peer(*peer_ptr, client_id);
+                }
+            });
+        }
+        send_control(self, CTRL_DISCONNECTED_OK, peer_id);
+        LOG(LOG_INFO) << "Sunucu: ID " << client_id << ", ID " << peer_id << " ile eşleşmeden ayrıldı.";
+    }
+    // ... diğer komutlar (list, reject, msg) buraya eklenebilir ...
+    else {
+        send_control(self, CTRL_ERROR, "Bilinmeyen komut tipi: " + std::to_string((int)type));
+    }
+    print_server_clients_list();
+}
+
+/**
+ * @brief Komut modunda okunan veriyi istemcinin komut tamponuna ekler ve tamamlanmış mesajları işler.
+ * İlk baytı CONTROL_MAGIC_V1 olan bir mesaj istemciyi ikili protokole geçirir; aksi halde
+ * '\n' ile biten metin satırları beklenir.
+ */
+void process_command_data(ClientInfo& self, const char* data, size_t len) {
+    const bool was_mux = self.mux;
+    // Okunan veriyi istemcinin kişisel komut tamponuna ekle
+    auto& cb = self.command_buffer;
+    if (!self.binary_protocol && cb.empty() && len > 0 && (uint8_t)data[0] == CONTROL_MAGIC_V1 && self.status == ClientStatus::Idle) {
+        self.binary_protocol = true;
+    }
+    cb.insert(cb.end(), data, data + len);
 
-        std::cout << "\nYeni bağlantı kabul edildi. Gelen IP: " << client_ip_str
-                  << ", Atanan ID: " << new_id_str << std::endl;
-        
-        if (!send_message(new_socket, "ID " + new_id_str)) {
-             cleanup_client(new_id_str, new_socket); // Temizlik fonksiyonunu çağır
-             ::close(new_socket);
+    // VncReady durumunda 'start_vnc_tunnel' komutundan sonra gelenler ham VNC verisidir;
+    // tünel açılana kadar komut olarak yorumlanmadan tamponda bekletilir. Yayın oturumuna
+    // girildiğinde kalan veri oturuma aktarılmıştır. Çoğullanmış bağlantıda komut tamponu
+    // yalnızca kanal 0 akışıdır ve her durumda işlenir.
+    while ((self.mux || (self.status != ClientStatus::VncReady && self.status != ClientStatus::VncTunnelling)) && !self.fanout) {
+        if (self.binary_protocol) {
+            ControlFrame frame;
+            ssize_t used = parse_control_frame(cb.data(), cb.size(), &frame);
+            if (used == 0) break;
+            if (used < 0) {
+                // Çerçeve sınırı kaybedildi; bağlantı kapatılır (olay döngüsü kapanışı görür)
+                send_control(self, CTRL_ERROR, "Geçersiz kontrol çerçevesi.");
+                cb.clear();
+                ::shutdown(self.socket_fd, SHUT_RDWR);
+                return;
+            }
+            // Komut, tampondaki kalan veriyi devralabilir (tünel açılışı, worker aktarımı); çerçeve
+            // önce tampondan ayrılır. Tamponun belleği çerçeveyle birlikte command_frame'e geçer ve
+            // yalnızca kalan veri geri taşınır (erase'in kaydırdığı kadar); yük kopyalanmaz.
+            std::vector<char>& frame_bytes = self.command_frame;
+            frame_bytes.clear();
+            frame_bytes.swap(cb);
+            cb.assign(frame_bytes.begin() + used, frame_bytes.end());
+            handle_command(self, frame.type, std::string_view(frame.payload, frame.length));
         } else {
-             {
-                std::lock_guard<std::mutex> lock(clients_mutex);
-                print_server_clients_list();
-             }
-            try {
-                std::thread(handle_client, new_socket, new_id_str).detach();
-            } catch (const std::system_error& e) {
-                std::cerr << "Hata: İstemci thread'i başlatılamadı (ID: " << new_id_str << "): " << e.what() << std::endl;
-                cleanup_client(new_id_str, new_socket);
-                ::close(new_socket);
+            std::string command_line;
+            if (!extract_text_line(cb, &command_line)) break;
+            if (command_line.empty()) {
+                continue; // Bir sonraki komuta geç
             }
+            handle_command_line(self, command_line);
+        }
+        // İstemci başka bir worker'a aktarıldıysa kalan tampon orada işlenir
+        if (!owned_here(self)) return;
+        if (self.mux && !was_mux) {
+            // 'mux' komutundan sonra okunmuş veri çerçevelidir
+            std::vector<char> framed;
+            framed.swap(cb);
+            process_mux_data(self, framed.data(), framed.size());
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Çoğullanmış bağlantıda komut modunda okunan veriyi çerçevelere ayırır. Kanal 0'ın yükü
+ * komut akışıdır; veri kanallarının çerçeveleri VncReady durumunda tünel açılana kadar bekletilir,
+ * diğer durumlarda (karşı uç yokken) atılır. Tünel açılınca kalan veri oturuma aktarılmıştır.
+ */
+void process_mux_data(ClientInfo& self, const char* data, size_t len) {
+    // Tünel kapanırken yarısı alınmış veri çerçevesinin kalanı atlanır
+    size_t skip = std::min(self.mux_skip, len);
+    self.mux_skip -= skip;
+    auto& in = self.mux_input;
+    in.insert(in.end(), data + skip, data + len);
+    // Worker aktarımından veya tünel kapanışından kalan komutlar önce işlenir
+    if (!self.command_buffer.empty()) process_command_data(self, nullptr, 0);
+
+    while (owned_here(self) && !self.session && in.size() >= MUX_HEADER_SIZE) {
+        MuxHeader header;
+        if (!parse_mux_header(in.data(), &header)) {
+            // Çerçeve sınırı kaybedildi; bağlantı kapatılır (olay döngüsü kapanışı görür)
+            send_control(self, CTRL_ERROR, "Geçersiz mux çerçevesi.");
+            in.clear();
+            ::shutdown(self.socket_fd, SHUT_RDWR);
+            return;
+        }
+        size_t frame_size = MUX_HEADER_SIZE + header.length;
+        if (in.size() < frame_size) break;
+        if (header.channel == MUX_CHANNEL_CONTROL) {
+            // Komut işlenirken kalan veri oturuma veya başka bir worker'a aktarılabilir; çerçeve önce çıkarılır
+            std::string payload(in.begin() + MUX_HEADER_SIZE, in.begin() + frame_size);
+            in.erase(in.begin(), in.begin() + frame_size);
+            if (header.type == MUX_DATA) process_command_data(self, payload.data(), payload.size());
+            continue;
+        }
+        if (self.status == ClientStatus::VncReady) {
+            self.mux_pending.insert(self.mux_pending.end(), in.begin(), in.begin() + frame_size);
+        }
+        in.erase(in.begin(), in.begin() + frame_size);
+    }
+}
+
+/**
+ * @brief Çoğullanmış ucun tünel açılmadan önce biriken veri kanalı çerçevelerini ve henüz
+ * çözülmemiş verisini oturuma aktarır.
+ */
+void push_mux_input(TunnelSession& session, ClientInfo& end) {
+    end.mux_pending.insert(end.mux_pending.end(), end.mux_input.begin(), end.mux_input.end());
+    end.mux_input.clear();
+    if (!end.mux_pending.empty()) session.push(end, end.mux_pending.data(), end.mux_pending.size());
+    end.mux_pending.clear();
+    schedule_tunnel_commands(end); // Aktarılan veride kanal 0 çerçevesi olabilir
+}
+
+/**
+ * @brief Çerçeveli tünelde ucun kanal 0'dan gönderdiği komutları işler. Bir komut tüneli
+ * kapattıysa uçtan okunmuş kalan veri komut modunda işlenir.
+ */
+void run_tunnel_commands(ClientInfo& client) {
+    while (client.session) {
+        std::string commands = client.session->take_control(client);
+        if (commands.empty()) return;
+        process_command_data(client, commands.data(), commands.size());
+        if (!owned_here(client)) return;
+    }
+    if (client.mux && client.socket_fd >= 0) consume_client_data(client, nullptr, 0);
+}
+
+/**
+ * @brief Oturumun ucun okuma olayı dışında (tampon boşalırken, tünel açılış ve kapanışında)
+ * çıkardığı komutları ve devrettiği veriyi döngünün bir sonraki turunda işler.
+ */
+void schedule_tunnel_commands(ClientInfo& client) {
+    if (!client.mux) return;
+    std::shared_ptr<ClientInfo> ptr = registry.find(client.id);
+    if (!ptr) return;
+    relay_loop->post([ptr]() {
+        if (owned_here(*ptr) && ptr->socket_fd >= 0) run_tunnel_commands(*ptr);
+    });
+}
+
+/**
+ * @brief Komut modunda okunan veriyi işler (her iki motor için ortak).
+ * @return Tünel açılmadan biriken ham veri sınıra ulaştıysa okumayı durdurur ve false döner.
+ */
+bool consume_client_data(ClientInfo& self, const char* data, size_t len) {
+    if (len > 0) self.last_activity_ms = relay_now_ms(); // Boşta kalma süresi zamanlayıcı dolunca denetlenir
+    if (self.mux) {
+        process_mux_data(self, data, len);
+    } else {
+        process_command_data(self, data, len);
+    }
+    if (!owned_here(self)) return false; // Başka bir worker'a aktarıldı; okuma orada sürer
+    // Peer tünele hazır olana kadar biriken ham veri sınırsız büyümesin
+    size_t held = self.mux ? self.mux_pending.size() + self.mux_input.size() : self.command_buffer.size();
+    if (self.status == ClientStatus::VncReady && held >= tunnel_limits.high_watermark) {
+        self.read_paused = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Bir istemci soketi için olay döngüsünün çağırdığı callback.
+ * Soket kenar tetiklemeli olduğundan, okunabilir olduğunda EAGAIN alınana kadar okunur.
+ * Tünel modunda veri doğrudan istemcinin TunnelSession nesnesine devredilir.
+ */
+void handle_client_event(const std::shared_ptr<ClientInfo>& client, uint32_t events) {
+    ClientInfo& self = *client;
+    if (self.socket_fd < 0) return; // Aynı turda kapatılmış
+
+    bool disconnected = (events & EPOLLERR) != 0;
+
+    if (!disconnected && (events & EPOLLOUT)) {
+        disconnected = !flush_output(self);
+        // Çıkış tamponu boşaldıysa oturum bu istemciye giden bekleyen veriyi aktarır
+        if (!disconnected && self.output_buffer.empty() && self.session) {
+            self.session->on_writable(self);
+            // Tampona yeni alınan veride eşin komutları olabilir
+            if (self.session && self.mux) schedule_tunnel_commands(self.session->peer_of(self));
+        } else if (!disconnected && self.output_buffer.empty() && self.fanout) {
+            self.fanout->on_writable(self);
         }
     }
 
-    ::close(server_fd);
+    if (!disconnected && !self.read_paused && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+        char buffer[8192]; // Veri okumak için tek bir buffer
+        while (true) {
+            // Tünel bu okuma sırasında açılmış olabilir
+            if (self.session) {
+                disconnected = !self.session->forward_from(self);
+                if (disconnected || !self.mux) break;
+                run_tunnel_commands(self);
+                if (!owned_here(self)) return;
+                if (self.session || self.read_paused) break;
+                continue; // Tünel komutla kapandı; kalan veri komut modunda okunur
+            }
+            if (self.fanout) {
+                std::shared_ptr<FanoutSession> fanout = self.fanout; // Yavaş izleyici işleyicisi sıfırlayabilir
+                disconnected = !fanout->forward_from(self);
+                break;
+            }
+            ssize_t bytes_read = ::read(self.socket_fd, buffer, sizeof(buffer));
+            if (bytes_read > 0) {
+                if (!consume_client_data(self, buffer, bytes_read)) {
+                    if (!owned_here(self)) return; // Artık diğer worker'ın; alanlarına dokunulmaz
+                    break;
+                }
+                continue;
+            }
+            if (bytes_read < 0 && errno == EINTR) continue;
+            if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            // Okuma hatası veya bağlantı kapanması
+            disconnected = true;
+            break;
+        }
+    }
+
+    if (disconnected) {
+        close_client(self);
+    }
+}
+
+// Dosya tanımlayıcıları tükendiğinde (EMFILE/ENFILE) kuyruktaki bağlantı kabul edilemez ve seviye
+// tetiklemeli dinleyen soket her turda yeniden hazır olur; worker boşa döner. Bu thread'in ayırdığı
+// yedek tanımlayıcı o anda serbest bırakılıp bağlantı kabul edilerek kapatılır.
+thread_local int reserve_fd = -1;
+thread_local TimerWheel::Timer accept_retry_timer; // Yedek de kullanılamazsa dinleyen soketi yeniden kurar
+const uint64_t ACCEPT_RETRY_MS = 100;
+
+void open_reserve_fd() {
+    if (reserve_fd < 0) reserve_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void close_reserve_fd() {
+    if (reserve_fd >= 0) ::close(reserve_fd);
+    reserve_fd = -1;
+}
+
+/**
+ * @brief Tanımlayıcı tükenince kuyruktaki bir bağlantıyı yedek tanımlayıcıyla kabul edip kapatır;
+ * istemci bekleyip zaman aşımına uğramak yerine bağlantının kapandığını görür.
+ * @return Bir bağlantı kuyruktan çıkarıldıysa true (yedek yoksa veya kuyruk boşaldıysa false).
+ */
+bool shed_pending_connection(int listen_fd) {
+    if (reserve_fd < 0) open_reserve_fd(); // Önceki denemede geri alınamamış olabilir
+    if (reserve_fd < 0) return false;
+    // io_uring motorunun dinleyen soketi bloklayan kipte; bağlantı bu arada düşmüşse accept beklemesin
+    struct pollfd pending = {listen_fd, POLLIN, 0};
+    if (::poll(&pending, 1, 0) <= 0) return false;
+    close_reserve_fd();
+    int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0) ::close(fd);
+    open_reserve_fd();
+    if (fd < 0) return false;
+    relay_metrics.connections_shed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Dinleyen soketi ACCEPT_RETRY_MS boyunca dinlemez; süre dolunca yeniden kurar ve bekleyenleri
+ * kabul eder. Böylece yedek tanımlayıcı da yokken döngü aynı hata için dönüp durmaz.
+ */
+void pause_accepting(int server_fd) {
+    if (!relay_loop->modify(server_fd, 0)) return;
+    accept_retry_timer.callback = [server_fd]() {
+        relay_loop->modify(server_fd, EPOLLIN);
+        accept_new_clients(server_fd);
+    };
+    timer_wheel->arm(accept_retry_timer, ACCEPT_RETRY_MS);
+}
+
+/**
+ * @brief Dinleyen sokette bekleyen tüm bağlantıları kabul eder ve olay döngüsüne kaydeder.
+ */
+void accept_new_clients(int server_fd) {
+    while (true) {
+        struct sockaddr_in client_address;
+        socklen_t client_addrlen = sizeof(client_address);
+        int new_socket = ::accept4(server_fd, (struct sockaddr *)&client_address, &client_addrlen,
+                                   SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (new_socket < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            int error = errno;
+            // EMFILE gibi hatalar her turda tekrarlanabilir; günlük taşmasın
+            LOG_RATE_LIMITED(LOG_WARN, 5) << "Bağlantı kabul (accept) hatası: " << strerror(error);
+            if ((error == EMFILE || error == ENFILE) && shed_pending_connection(server_fd)) continue;
+            // Dinleyen soket seviye tetiklemeli: bağlantı kuyrukta kaldıysa olay hemen yeniden gelir.
+            // Soket kısa bir süre dinlenmez; kalanlar sonra denenir.
+            pause_accepting(server_fd);
+            return;
+        }
+
+        if (tls_context) {
+            start_tls_handshake(new_socket, client_address);
+        } else {
+            admit_client(new_socket, client_address);
+        }
+    }
+}
+
+/**
+ * @brief Tünel ve yayın verisinin arasına PING yazılamaz; '--heartbeat=' açıksa ölü bağlantıları
+ * orada çekirdek yoklar.
+ */
+void set_keepalive(int fd) {
+    if (heartbeat_seconds <= 0) return;
+    int on = 1;
+    int interval = std::max(1, heartbeat_seconds / 3);
+    int probes = 3;
+    ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &heartbeat_seconds, sizeof(heartbeat_seconds));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+}
+
+/**
+ * @brief Kabul edilen soketi kayıt defterine ve soketlerin sahibi olan motora ekler, ID'sini gönderir.
+ */
+void admit_client(int new_socket, const struct sockaddr_in& client_address) {
+    auto client = std::make_shared<ClientInfo>();
+    client->socket_fd = new_socket;
+    client->ip_address = inet_ntoa(client_address.sin_addr);
+    set_keepalive(new_socket);
+    client->owner_worker.store(current_worker, std::memory_order_release); // Kayıt defterinde görünmeden önce
+    ClientId new_id = registry.register_client(client);
+    if (new_id == NO_CLIENT) {
+        // 900 000 ID'nin tamamı kullanımda
+        LOG_RATE_LIMITED(LOG_WARN, 1) << "Uyarı: Boş istemci ID'si kalmadı, bağlantı reddedildi (IP: "
+                                      << client->ip_address << ")";
+        ::close(new_socket);
+        return;
+    }
+
+    LOG(LOG_INFO) << "Yeni bağlantı kabul edildi. Gelen IP: " << client->ip_address
+                  << ", Atanan ID: " << new_id;
+
+    if (uring_relay) {
+        uring_relay->add_client(client);
+    } else {
+        bool registered = relay_loop->add(new_socket, CLIENT_EVENTS, [client](uint32_t events) {
+            handle_client_event(client, events);
+        });
+        if (!registered) {
+            LOG(LOG_ERROR) << "Hata: İstemci soketi olay döngüsüne eklenemedi (ID: " << new_id << ")";
+            registry.remove(new_id);
+            ::close(new_socket);
+            return;
+        }
+    }
+    relay_metrics.connections_accepted.fetch_add(1, std::memory_order_relaxed);
+    relay_metrics.clients_connected.fetch_add(1, std::memory_order_relaxed); // cleanup_client'ta azalır
+    start_client_timer(*client);
+
+    if (send_control(*client, CTRL_ID, new_id)) { // Her zaman metin: protokol henüz bilinmiyor
+        print_server_clients_list();
+    } else {
+        close_client(*client); // Temizlik fonksiyonunu çağır
+    }
+}
+
+// El sıkışması süren TLS bağlantısı; henüz kayıt defterinde değildir
+struct PendingTls {
+    int fd;
+    struct sockaddr_in address;
+    std::unique_ptr<TlsStream> stream;
+    TimerWheel::Timer timer; // '--handshake-timeout='
+};
+
+/**
+ * @brief El sıkışması biten soketi relay'e verir: kTLS kurulabildiyse soketin kendisini, yoksa
+ * kullanıcı alanı köprüsüne bağlı Unix soketini istemci olarak kaydeder.
+ */
+void finish_tls_handshake(PendingTls& pending) {
+    int fd = pending.fd;
+    std::string reason = "--no-ktls";
+    if (ktls_enabled) {
+        KtlsResult result = pending.stream->enable_ktls(&reason);
+        if (result == KTLS_ENABLED) {
+            LOG(LOG_DEBUG) << "TLS el sıkışması tamamlandı (kTLS, " << pending.stream->cipher_name()
+                           << "). IP: " << inet_ntoa(pending.address.sin_addr);
+            relay_metrics.ktls_connections.fetch_add(1, std::memory_order_relaxed);
+            pending.stream.reset();
+            admit_client(fd, pending.address);
+            return;
+        }
+        if (result == KTLS_FAILED) {
+            LOG_RATE_LIMITED(LOG_WARN, 5) << "Uyarı: kTLS anahtarları kurulamadı (" << reason << "), bağlantı kapatıldı.";
+            relay_metrics.tls_handshake_failures.fetch_add(1, std::memory_order_relaxed);
+            ::close(fd);
+            return;
+        }
+        LOG_RATE_LIMITED(LOG_WARN, 60) << "Uyarı: kTLS kullanılamıyor (" << reason
+                                       << "); şifreleme relay'de kullanıcı alanında yapılacak.";
+    }
+
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) < 0) {
+        LOG_RATE_LIMITED(LOG_WARN, 5) << "Uyarı: TLS köprüsü için soket çifti oluşturulamadı: " << strerror(errno);
+        ::close(fd);
+        return;
+    }
+    auto bridge = std::make_shared<TlsBridge>(std::move(pending.stream), pair[1]);
+    auto on_event = [bridge](uint32_t) {
+        if (!bridge->pump()) {
+            // Soketler köprüyle birlikte, callback'ler yok edilince kapanır
+            relay_loop->remove(bridge->tls_fd());
+            relay_loop->remove(bridge->plain_fd());
+        }
+    };
+    const uint32_t bridge_events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    if (!relay_loop->add(fd, bridge_events, on_event) || !relay_loop->add(pair[1], bridge_events, on_event)) {
+        LOG(LOG_ERROR) << "Hata: TLS köprüsü olay döngüsüne eklenemedi.";
+        relay_loop->remove(fd);
+        ::close(pair[0]);
+        return;
+    }
+    LOG(LOG_DEBUG) << "TLS el sıkışması tamamlandı (kullanıcı alanı, " << bridge->tls_fd() << " <-> " << pair[0]
+                   << "). IP: " << inet_ntoa(pending.address.sin_addr);
+    relay_metrics.tls_userspace_connections.fetch_add(1, std::memory_order_relaxed);
+    admit_client(pair[0], pending.address);
+}
+
+/**
+ * @brief Kabul edilen soketi TLS el sıkışması bitene kadar kayıt defterinin dışında, worker'ın
+ * döngüsünde bekletir.
+ */
+void start_tls_handshake(int new_socket, const struct sockaddr_in& client_address) {
+    auto pending = std::make_shared<PendingTls>();
+    pending->fd = new_socket;
+    pending->address = client_address;
+    try {
+        pending->stream.reset(new TlsStream(*tls_context, new_socket));
+    } catch (const std::runtime_error& e) {
+        LOG_RATE_LIMITED(LOG_WARN, 5) << "Uyarı: TLS oturumu oluşturulamadı: " << e.what();
+        ::close(new_socket);
+        return;
+    }
+    set_keepalive(new_socket);
+
+    // Bekleyen el sıkışmanın sahibi soketin callback'idir; soket döngüden çıkınca yok edilir
+    bool registered = relay_loop->add(new_socket, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [pending](uint32_t) {
+        TlsResult result = pending->stream->handshake();
+        if (result == TLS_WANT_READ || result == TLS_WANT_WRITE) return;
+        relay_loop->remove(pending->fd);
+        timer_wheel->cancel(pending->timer);
+        if (result == TLS_FAILED) {
+            LOG(LOG_DEBUG) << "TLS el sıkışması başarısız. IP: " << inet_ntoa(pending->address.sin_addr);
+            relay_metrics.tls_handshake_failures.fetch_add(1, std::memory_order_relaxed);
+            ::close(pending->fd);
+            return;
+        }
+        finish_tls_handshake(*pending);
+    });
+    if (!registered) {
+        LOG(LOG_ERROR) << "Hata: TLS soketi olay döngüsüne eklenemedi.";
+        ::close(new_socket);
+        return;
+    }
+    if (handshake_timeout_seconds > 0) {
+        PendingTls* raw = pending.get();
+        raw->timer.callback = [raw]() {
+            LOG(LOG_DEBUG) << "TLS el sıkışması " << handshake_timeout_seconds << " sn içinde tamamlanmadı. IP: "
+                           << inet_ntoa(raw->address.sin_addr);
+            relay_metrics.tls_handshake_failures.fetch_add(1, std::memory_order_relaxed);
+            relay_loop->remove(raw->fd);
+            ::close(raw->fd);
+        };
+        timer_wheel->arm(raw->timer, handshake_timeout_seconds * 1000ull);
+    }
+}
+
+/**
+ * @brief io_uring motorunu oluşturur. Çekirdek desteklemiyorsa veya motor kurulamazsa nullptr
+ * döner; çağıran epoll döngüsüne geri düşer.
+ */
+std::unique_ptr<UringRelay> create_uring_engine(int server_fd) {
+    std::string reason;
+    if (!UringRelay::supported(&reason)) {
+        LOG(LOG_WARN) << "Uyarı: io_uring kullanılamıyor (" << reason << "), epoll kullanılacak.";
+        return nullptr;
+    }
+
+    UringRelayHandlers handlers;
+    handlers.on_accept = [](int new_socket) {
+        struct sockaddr_in client_address;
+        socklen_t client_addrlen = sizeof(client_address);
+        memset(&client_address, 0, sizeof(client_address));
+        ::getpeername(new_socket, (struct sockaddr *)&client_address, &client_addrlen);
+        admit_client(new_socket, client_address);
+    };
+    handlers.on_accept_exhausted = [server_fd]() {
+        shed_pending_connection(server_fd);
+    };
+    handlers.on_command_data = consume_client_data;
+    handlers.on_disconnect = close_client;
+    open_reserve_fd();
+
+    try {
+        return std::unique_ptr<UringRelay>(new UringRelay(server_fd, tunnel_limits, handlers));
+    } catch (const std::system_error& e) {
+        LOG(LOG_WARN) << "Uyarı: io_uring motoru oluşturulamadı (" << e.what() << "), epoll kullanılacak.";
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Port üzerinde SO_REUSEPORT ile dinleyen, engellemeyen bir soket açar. Her worker kendi
+ * dinleyen soketine sahiptir; çekirdek gelen bağlantıları bu soketler arasında dağıtır.
+ * @return Dinleyen soket veya hata durumunda -1 (hata yazdırılır).
+ */
+int create_listener(int listen_port, int backlog) {
+    int server_fd;
+    struct sockaddr_in address;
+    if ((server_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+        LOG(LOG_ERROR) << "Soket oluşturulamadı: " << strerror(errno);
+        return -1;
+    }
+
+    int opt = 1;
+    if (::setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1 ||
+        ::setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+        LOG(LOG_ERROR) << "setsockopt hatası: " << strerror(errno);
+        ::close(server_fd);
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY; // Tüm arayüzlerden dinle
+    address.sin_port = htons(listen_port);
+
+    if (::bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        LOG(LOG_ERROR) << "Bağlama (bind) hatası: " << strerror(errno);
+        ::close(server_fd);
+        return -1;
+    }
+
+    if (::listen(server_fd, backlog) < 0) {
+        LOG(LOG_ERROR) << "Dinleme (listen) hatası: " << strerror(errno);
+        ::close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+/**
+ * @brief Thread'i sürecin izin verilen CPU'larından index'e karşılık gelene sabitler.
+ */
+void pin_to_core(std::thread& thread, int index) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) return;
+
+    int target = index % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed) || target-- > 0) continue;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = ::pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+        if (err != 0) {
+            LOG(LOG_WARN) << "Uyarı: worker " << index << " CPU " << cpu << "'e sabitlenemedi: " << strerror(err);
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Worker thread'inin gövdesi: dinleyen soketini kendi döngüsüne ekler ve döngüyü çalıştırır.
+ */
+void run_worker(Worker& worker) {
+    log_set_thread_name("w" + std::to_string(worker.index));
+    current_worker = worker.index;
+    relay_loop = worker.loop.get();
+    egress_scheduler = worker.scheduler.get();
+    timer_wheel = worker.timers.get();
+
+    // Dinleyen soket seviye tetiklemeli: accept hatasında (örn. EMFILE) bağlantılar kaybolmaz
+    int listen_fd = worker.listen_fd;
+    open_reserve_fd();
+    if (relay_loop->add(listen_fd, EPOLLIN, [listen_fd](uint32_t) { accept_new_clients(listen_fd); })) {
+        relay_loop->run();
+    }
+    timer_wheel->cancel(accept_retry_timer);
+    close_reserve_fd();
+    relay_loop = nullptr;
+    egress_scheduler = nullptr;
+    timer_wheel = nullptr;
+}
+
+// --- Kesintisiz Yükseltme ---
+
+/**
+ * @brief Dinleyen soketleri, istemcileri ve tünel oturumlarını yeni sürece gönderir. Worker'lar
+ * dondurulmuşken worker 0'dan çağrılır. Kayıtlar HANDOFF_MAX_FDS'i aşmayacak şekilde doldurulur.
+ * @return Gönderim başarısızsa veya deadline'a kadar bitmediyse false.
+ */
+bool send_relay_state(int sock, HandoffDeadline deadline) {
+    HandoffWriter out;
+    // Oturum öğesi en fazla 4 fd taşır
+    auto flush_if_full = [&out, sock, deadline]() {
+        return out.fd_count() + 4 <= HANDOFF_MAX_FDS || out.send(sock, deadline);
+    };
+
+    out.put_u8(HANDOFF_WORKERS);
+    out.put_u32(workers.size());
+    for (auto& worker : workers) {
+        out.put_u8(HANDOFF_LISTENER);
+        out.put_fd(worker->listen_fd);
+        if (!flush_if_full()) return false;
+    }
+    // Küme temsilcilerinin soketleri küme bağlantısına aittir; devredilmez
+    std::vector<ClientId> ids;
+    registry.for_each([&ids](const ClientInfo& client) {
+        if (client.remote_node < 0) ids.push_back(client.id);
+    });
+    size_t sessions = 0;
+    for (ClientId id : ids) {
+        std::shared_ptr<ClientInfo> client = registry.find(id);
+        if (!client) continue;
+        out.put_u8(HANDOFF_CLIENT);
+        handoff_put_client(out, *client);
+        if (!flush_if_full()) return false;
+    }
+    for (ClientId id : ids) {
+        std::shared_ptr<ClientInfo> client = registry.find(id);
+        if (!client || !client->session) continue;
+        ClientInfo& peer = client->session->peer_of(*client);
+        if (peer.remote_node >= 0 || peer.id < client->id) continue; // Oturum küçük ID'li uçtan bir kez yazılır
+        out.put_u8(HANDOFF_SESSION);
+        handoff_put_session(out, *client->session, *client, peer);
+        ++sessions;
+        if (!flush_if_full()) return false;
+    }
+    out.put_u8(HANDOFF_END);
+    if (!out.send(sock, deadline)) return false;
+    LOG(LOG_INFO) << "Yükseltme: " << workers.size() << " dinleyen soket, " << ids.size() << " istemci ve "
+                  << sessions << " tünel devredildi.";
+    return true;
+}
+
+// Yükseltmede başlatılan süreç çıkınca (pidfd okunabilir olunca) olay döngüsünde toplanır;
+// abort_upgrade öldürdüğü süreci beklemez
+void watch_upgrade_child(pid_t pid) {
+    int pidfd = open_pidfd(pid);
+    if (pidfd < 0) return; // Eski çekirdek: bir sonraki yükseltme denemesinde toplanır
+    bool registered = relay_loop->add(pidfd, EPOLLIN, [pid, pidfd](uint32_t) {
+        ::waitpid(pid, nullptr, WNOHANG);
+        relay_loop->remove(pidfd);
+        ::close(pidfd);
+    });
+    if (!registered) ::close(pidfd);
+}
+
+// Başarısız yükseltmeyi geri alır; yeni süreç (başladıysa) sonlandırılır, relay çalışmaya devam eder
+void abort_upgrade() {
+    timer_wheel->cancel(upgrade_timer);
+    relay_loop->remove(upgrade_sock);
+    ::close(upgrade_sock);
+    upgrade_sock = -1;
+    ::kill(upgrade_pid, SIGKILL);
+    ::waitpid(upgrade_pid, nullptr, WNOHANG); // Henüz çıkmadıysa watch_upgrade_child toplar
+    upgrade_pid = -1;
+}
+
+// Yeni süreç hazır ('R') olduğunda çağrılır: durum devredilir ve onay ('A') gelirse süreç çıkar
+void on_upgrade_ready() {
+    char reply = 0;
+    ssize_t n = ::read(upgrade_sock, &reply, 1);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    if (n != 1 || reply != 'R') {
+        LOG(LOG_ERROR) << "Yükseltme: Yeni süreç hazır olmadan sonlandı; eski süreç çalışmaya devam ediyor.";
+        abort_upgrade();
+        return;
+    }
+    timer_wheel->cancel(upgrade_timer);
+
+    auto now = std::chrono::steady_clock::now();
+    std::vector<EventLoop*> others;
+    for (size_t i = 1; i < workers.size(); ++i) others.push_back(workers[i]->loop.get());
+    if (!worker_freeze.freeze(others, now + std::chrono::milliseconds(UPGRADE_FREEZE_TIMEOUT_MS))) {
+        LOG(LOG_ERROR) << "Yükseltme: Worker'lar " << UPGRADE_FREEZE_TIMEOUT_MS
+                       << " ms içinde durmadı; eski süreç çalışmaya devam ediyor.";
+        abort_upgrade();
+        return;
+    }
+    // Yeni süreç tüm soketleri olay döngülerine ekleyince onaylar
+    HandoffDeadline deadline = now + std::chrono::seconds(UPGRADE_TRANSFER_TIMEOUT_SECONDS);
+    bool handed_over = send_relay_state(upgrade_sock, deadline) &&
+                       handoff_receive_byte(upgrade_sock, &reply, deadline) && reply == 'A';
+    if (!handed_over) {
+        LOG(LOG_ERROR) << "Yükseltme: Durum devredilemedi (" << strerror(errno)
+                       << "); eski süreç çalışmaya devam ediyor.";
+        abort_upgrade();
+        worker_freeze.release();
+        return;
+    }
+    LOG(LOG_INFO) << "Yükseltme: Yeni süreç (PID " << upgrade_pid << ") devraldı; eski süreç çıkıyor.";
+    // Yönetici ana süreç olarak yeni süreci izlemeye başlar; eski sürecin çıkışı hizmetin durması sayılmaz
+    notify_supervisor("MAINPID=" + std::to_string(upgrade_pid) + "\nREADY=1");
+    log_stop();
+    // Worker'lar dondurulmuş bekliyor; soketlerin bu süreçteki kopyaları çıkışta kapanır
+    ::_exit(0);
+}
+
+/**
+ * @brief SIGUSR2 alındığında (worker 0'da) ikili dosyayı '--takeover-fd=' ile yeniden çalıştırır.
+ * Durum, yeni süreç hazır olduğunu bildirince on_upgrade_ready'de gönderilir.
+ */
+void start_upgrade() {
+    if (upgrade_sock >= 0) {
+        LOG(LOG_WARN) << "Yükseltme: Önceki yükseltme sürüyor; SIGUSR2 yok sayıldı.";
+        return;
+    }
+    while (::waitpid(-1, nullptr, WNOHANG) > 0) {} // pidfd yoksa önceki denemeden kalan süreçler
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1) {
+        LOG(LOG_ERROR) << "Yükseltme: socketpair hatası: " << strerror(errno);
+        return;
+    }
+    std::vector<std::string> args = upgrade_args;
+    args.push_back("--takeover-fd=" + std::to_string(pair[1]));
+    std::vector<char*> argv;
+    for (std::string& arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        // Alt süreç: exec'e kadar yalnızca async-signal-safe çağrılar
+        ::fcntl(pair[1], F_SETFD, 0);
+        sigset_t none;
+        sigemptyset(&none);
+        ::sigprocmask(SIG_SETMASK, &none, nullptr);
+        ::execvp(argv[0], argv.data());
+        ::_exit(127);
+    }
+    ::close(pair[1]);
+    if (pid < 0) {
+        LOG(LOG_ERROR) << "Yükseltme: fork hatası: " << strerror(errno);
+        ::close(pair[0]);
+        return;
+    }
+    upgrade_sock = pair[0];
+    upgrade_pid = pid;
+    watch_upgrade_child(pid);
+    relay_loop->add(upgrade_sock, EPOLLIN, [](uint32_t) { on_upgrade_ready(); });
+    upgrade_timer.callback = []() {
+        LOG(LOG_ERROR) << "Yükseltme: Yeni süreç " << UPGRADE_TIMEOUT_SECONDS << " sn içinde hazır olmadı.";
+        abort_upgrade();
+    };
+    timer_wheel->arm(upgrade_timer, UPGRADE_TIMEOUT_SECONDS * 1000ull);
+    LOG(LOG_INFO) << "Yükseltme: Yeni süreç başlatıldı (PID " << pid << ", " << argv[0] << ").";
+}
+
+/**
+ * @brief Devralınan oturumu yeniden kurar (uçların worker'ında). Uçlardan biri eksikse, başka
+ * worker'daysa veya veri bu sürecin sınırlarına sığmıyorsa oturum kurulmaz; uçlar sonra serbest bırakılır.
+ */
+void restore_session(HandedSession& handed) {
+    std::shared_ptr<ClientInfo> a = registry.find(handed.a);
+    std::shared_ptr<ClientInfo> b = registry.find(handed.b);
+    if (!a || !b || !owned_here(*a) || !owned_here(*b) || a->peer_id != b->id || b->peer_id != a->id) return;
+    // Boru devralınan yönler splice ile devam eder; diğerleri kopyalama yolundadır
+    auto session = std::make_shared<TunnelSession>(*relay_loop, *a, *b, false, tunnel_limits, egress_scheduler);
+    if (!session->restore_direction(*a, handed.dirs[0]) || !session->restore_direction(*b, handed.dirs[1])) {
+        LOG(LOG_WARN) << "Yükseltme: ID " << a->id << " - ID " << b->id
+                      << " tüneli bu sürecin tampon sınırlarına sığmıyor; kapatılıyor.";
+        session->close();
+        return;
+    }
+    start_capture(*session, *a, *b);
+    a->session = session;
+    b->session = session;
+    for (ClientInfo* end : {a.get(), b.get()}) {
+        if (end->status == ClientStatus::Resuming) parked_clients.park(end->resume_token, registry.find(end->id));
+    }
+}
+
+/**
+ * @brief Devralınan istemcinin durumunu bu süreçte karşılığı olmayan eşleşmelerden arındırır:
+ * oturumu kurulamayan tünel uçları, yayın katılımcıları ve eşi devredilmemiş uçlar serbest bırakılır.
+ */
+void settle_handed_client(ClientInfo& client) {
+    if (client.status == ClientStatus::Resuming) {
+        if (!client.session) cleanup_client(client); // Dönebileceği bir tünel yok
+        return;
+    }
+    if (client.status == ClientStatus::Idle || client.session) return;
+    std::shared_ptr<ClientInfo> peer = registry.find(client.peer_id);
+    bool paired = peer && peer->peer_id == client.id && client.status != ClientStatus::Broadcasting &&
+                  client.status != ClientStatus::Watching && client.status != ClientStatus::VncTunnelling;
+    if (!paired) release_peer(client, client.peer_id);
+}
+
+/**
+ * @brief Eski relay'in devrettiği durumu alır ve worker'lara yerleştirir ('--takeover-fd='). Worker
+ * thread'leri başlamadan, ana thread'de çağrılır; eski süreç çıktığında döner.
+ *
+ * Eski worker i'nin dinleyen soketi ve istemcileri bu süreçte worker i'ye geçer; tüneller böylece
+ * uçlarıyla aynı worker'da kalır. Bu süreçte daha çok worker varsa fazlaları kendi dinleyen soketini
+ * açar ve yeni bağlantılardan pay alır. Daha az worker varsa devir reddedilir: fazla dinleyen
+ * soketlerin kapatılması kuyruklarındaki bağlantıları düşürürdü.
+ * @return Durum alınamadıysa false (eski süreç çalışmaya devam eder).
+ */
+bool take_over_relay(int sock) {
+    // Eski süreç devri kendi süresiyle sınırlar; bu taraf da yanıt vermeyen eski süreci süresiz beklemez
+    HandoffDeadline deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UPGRADE_TIMEOUT_SECONDS);
+    pid_t old_pid = ::getppid(); // Yeni süreci eski relay fork eder
+    char ready = 'R';
+    if (!handoff_send_byte(sock, ready, deadline)) {
+        LOG(LOG_ERROR) << "Yükseltme: Eski sürece ulaşılamadı: " << strerror(errno);
+        return false;
+    }
+
+    HandoffReader in;
+    uint32_t old_workers = 0;
+    std::vector<int> listeners;
+    std::vector<std::shared_ptr<ClientInfo>> handed_clients;
+    std::vector<std::unique_ptr<HandedSession>> handed_sessions;
+    bool done = false;
+    bool corrupt = false;
+    while (!done) {
+        if (!in.receive(sock, deadline)) {
+            LOG(LOG_ERROR) << "Yükseltme: Durum alınamadı: " << strerror(errno);
+            return false;
+        }
+        while (in.ok() && !in.at_end() && !done && !corrupt) {
+            uint8_t item = in.get_u8();
+            if (item == HANDOFF_WORKERS && old_workers == 0) {
+                old_workers = in.get_u32();
+                if (old_workers > workers.size()) {
+                    LOG(LOG_ERROR) << "Yükseltme: Eski süreçte " << old_workers << " worker var, bu süreçte "
+                                   << workers.size() << "; devir reddedildi (--workers=" << old_workers
+                                   << " veya daha fazlasıyla yeniden deneyin).";
+                    return false;
+                }
+            } else if (old_workers == 0) {
+                corrupt = true; // Worker sayısı ilk öğe olmalı
+            } else if (item == HANDOFF_LISTENER && listeners.size() < old_workers) {
+                listeners.push_back(in.take_fd());
+            } else if (item == HANDOFF_CLIENT) {
+                std::shared_ptr<ClientInfo> client = handoff_get_client(in);
+                if (!client) return false;
+                if ((uint32_t)client->owner_worker.load(std::memory_order_relaxed) >= old_workers) {
+                    if (client->socket_fd >= 0) ::close(client->socket_fd);
+                    corrupt = true;
+                } else {
+                    handed_clients.push_back(std::move(client));
+                }
+            } else if (item == HANDOFF_SESSION) {
+                std::unique_ptr<HandedSession> handed(new HandedSession());
+                handoff_get_session(in, handed.get());
+                handed_sessions.push_back(std::move(handed));
+            } else if (item == HANDOFF_END && listeners.size() == old_workers) {
+                done = true;
+            } else {
+                corrupt = true;
+            }
+        }
+        if (corrupt || !in.ok() || (!done && !in.at_end())) {
+            LOG(LOG_ERROR) << "Yükseltme: Devir akışı bozuk.";
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < listeners.size(); ++i) workers[i]->listen_fd = listeners[i];
+    std::vector<std::shared_ptr<ClientInfo>> adopted = handed_clients;
+    registry.adopt(adopted);
+    for (auto& client : handed_clients) {
+        if (registry.find(client->id) == client) continue;
+        LOG(LOG_WARN) << "Yükseltme: ID " << client->id << " bu süreçte kaydedilemedi; bağlantı kapatılıyor.";
+        if (client->socket_fd >= 0) ::close(client->socket_fd);
+    }
+    relay_metrics.clients_connected.fetch_add(adopted.size(), std::memory_order_relaxed);
+
+    // Yerleştirme her worker'ın kimliğiyle yapılır; thread'ler henüz başlamadığından döngüler boştadır
+    for (auto& worker : workers) {
+        current_worker = worker->index;
+        relay_loop = worker->loop.get();
+        egress_scheduler = worker->scheduler.get();
+        timer_wheel = worker->timers.get();
+        std::vector<ClientInfo*> owned;
+        for (auto& client : adopted) {
+            if (!owned_here(*client)) continue;
+            owned.push_back(client.get());
+            if (client->socket_fd >= 0) {
+                bool registered = relay_loop->add(client->socket_fd, CLIENT_EVENTS, [client](uint32_t events) {
+                    handle_client_event(client, events);
+                });
+                if (!registered) {
+                    ::close(client->socket_fd);
+                    client->socket_fd = -1;
+                }
+            }
+            watch_client_timer(*client);
+        }
+        for (auto& handed : handed_sessions) restore_session(*handed);
+        for (ClientInfo* client : owned) {
+            if (client->socket_fd < 0 && client->status != ClientStatus::Resuming) {
+                cleanup_client(*client);
+                continue;
+            }
+            settle_handed_client(*client);
+        }
+        // Devralınan bekleyen veri yazılabilir uçlara gönderilir; okumalar gerekirse sürdürülür
+        for (ClientInfo* client : owned) {
+            if (client->session && client->socket_fd >= 0) client->session->on_writable(*client);
+        }
+    }
+    current_worker = 0;
+    relay_loop = nullptr;
+    egress_scheduler = nullptr;
+    timer_wheel = nullptr;
+    LOG(LOG_INFO) << "Yükseltme: " << listeners.size() << " dinleyen soket, " << adopted.size() << " istemci ve "
+                  << handed_sessions.size() << " tünel devralındı.";
+
+    if (!handoff_send_byte(sock, 'A', deadline)) {
+        LOG(LOG_ERROR) << "Yükseltme: Eski sürece onay gönderilemedi: " << strerror(errno);
+        return false;
+    }
+    // Ölçüm, küme ve buluşma portları eski süreç çıkana kadar onundur. pidfd süreç tümüyle çıkınca
+    // (tüm soketleri kapandıktan sonra) okunabilir olur; süreç zaten toplandıysa açılamaz (ESRCH).
+    // pidfd desteklenmiyorsa devir soketinin kapanması beklenir; bu çıkışın ortasında da
+    // görülebileceğinden portlar hemen açılamayabilir.
+    int old_pidfd = open_pidfd(old_pid);
+    bool exited = old_pidfd < 0 && errno == ESRCH;
+    if (!exited) {
+        struct pollfd pfd = {old_pidfd >= 0 ? old_pidfd : sock, POLLIN, 0};
+        int polled;
+        do {
+            polled = ::poll(&pfd, 1, UPGRADE_TIMEOUT_SECONDS * 1000);
+        } while (polled < 0 && errno == EINTR);
+        exited = polled > 0 && (old_pidfd >= 0 || ::read(sock, &ready, 1) == 0);
+    }
+    if (!exited) LOG(LOG_WARN) << "Yükseltme: Eski sürecin çıkışı doğrulanamadı; devam ediliyor.";
+    if (old_pidfd >= 0) ::close(old_pidfd);
+    ::close(sock);
+    return true;
+}
+
+// --- Ana Sunucu Fonksiyonu ---
+int main(int argc, char *argv[]) {
+    // Sinyal yönetimi (isteğe bağlı ama iyi pratik)
+    signal(SIGPIPE, SIG_IGN);
+    // SIGUSR2 (kesintisiz yükseltme) worker 0'ın döngüsünde signalfd ile alınır; tüm thread'ler
+    // bu maskeyi devralır
+    sigset_t upgrade_signals;
+    sigemptyset(&upgrade_signals);
+    sigaddset(&upgrade_signals, SIGUSR2);
+    ::pthread_sigmask(SIG_BLOCK, &upgrade_signals, nullptr);
+
+    // Varsayılan worker sayısı: sürecin çalışabileceği CPU sayısı
+    int worker_count = 1;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0) {
+        worker_count = CPU_COUNT(&allowed);
+    }
+
+    // Kullanım: server [port] [--no-splice] [--engine=epoll|io_uring] [--workers=N] [--backlog=N]
+    //                 [--high-watermark=BYTE] [--low-watermark=BYTE]
+    //                 [--viewer-lag-limit=BYTE] [--slow-viewer=drop|coalesce|disconnect] [--rfb-cache-limit=BYTE]
+    //                 [--resume-grace=SANİYE] [--replay-buffer=BYTE]
+    //                 [--egress-rate=BYTE/SN] [--session-rate=BYTE/SN] [--account-rate=BYTE/SN] [--interactive-bytes=BYTE]
+    //                 [--rendezvous-port=N] [--cluster=IP:PORT,IP:PORT,...] [--node=K]
+    //                 [--heartbeat=SANİYE] [--idle-timeout=SANİYE] [--handshake-timeout=SANİYE]
+    //                 [--tls-cert=PEM --tls-key=PEM] [--no-ktls]
+    //                 [--capture-dir=DİZİN] [--capture-limit=BYTE]
+    //                 [--log-level=trace|debug|info|warn|error] [--metrics-port=N]
+    int listen_port = 12345;
+    int backlog = SOMAXCONN;
+    int metrics_port = 0; // 0: ölçüm portu kapalı
+    int takeover_fd = -1; // Yükseltmede eski relay'e bağlı soket (yalnızca start_upgrade verir)
+    bool use_uring = false;
+    std::string tls_cert_file;
+    std::string tls_key_file;
+    upgrade_args.push_back(argv[0]);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--takeover-fd=", 0) != 0) upgrade_args.push_back(arg);
+        if (arg == "--no-splice") {
+            splice_forwarding_enabled = false;
+            continue;
+        }
+        if (arg == "--engine=io_uring" || arg == "--engine=epoll") {
+            use_uring = (arg == "--engine=io_uring");
+            continue;
+        }
+        if (arg == "--no-ktls") {
+            ktls_enabled = false;
+            continue;
+        }
+        if (arg.rfind("--tls-cert=", 0) == 0) {
+            tls_cert_file = arg.substr(arg.find('=') + 1);
+            continue;
+        }
+        if (arg.rfind("--tls-key=", 0) == 0) {
+            tls_key_file = arg.substr(arg.find('=') + 1);
+            continue;
+        }
+        if (arg.rfind("--capture-dir=", 0) == 0) {
+            capture_dir = arg.substr(arg.find('=') + 1);
+            continue;
+        }
+        if (arg.rfind("--slow-viewer=", 0) == 0) {
+            if (!parse_slow_viewer_policy(arg.substr(arg.find('=') + 1), &slow_viewer_policy)) {
+                std::cerr << "Hata: Geçersiz yavaş izleyici politikası (" << arg << ")." << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        if (arg.rfind("--cluster=", 0) == 0) {
+            if (!parse_cluster_peers(arg.substr(arg.find('=') + 1), &cluster_peers)) {
+                std::cerr << "Hata: Geçersiz küme düğüm listesi (" << arg << "); ip:port,ip:port,... bekleniyor." << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        if (arg.rfind("--log-level=", 0) == 0) {
+            LogLevel level;
+            if (!parse_log_level(arg.substr(arg.find('=') + 1), &level)) {
+                std::cerr << "Hata: Geçersiz günlük seviyesi (" << arg << ")." << std::endl;
+                return 1;
+            }
+            set_log_level(level);
+            continue;
+        }
+        try {
+            if (arg.rfind("--high-watermark=", 0) == 0) {
+                tunnel_limits.high_watermark = std::stoul(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--low-watermark=", 0) == 0) {
+                tunnel_limits.low_watermark = std::stoul(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--viewer-lag-limit=", 0) == 0) {
+                viewer_lag_limit = std::stoul(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--rfb-cache-limit=", 0) == 0) {
+                rfb_cache_limit = std::stoul(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--capture-limit=", 0) == 0) {
+                capture_limit_bytes = std::stoull(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--replay-buffer=", 0) == 0) {
+                replay_buffer_bytes = std::stoul(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--egress-rate=", 0) == 0) {
+                scheduler_config.egress_rate = std::stoull(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--session-rate=", 0) == 0) {
+                scheduler_config.session_rate = std::stoull(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--account-rate=", 0) == 0) {
+                scheduler_config.account_rate = std::stoull(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--interactive-bytes=", 0) == 0) {
+                scheduler_config.interactive_bytes = std::stoul(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Hata: Geçersiz byte değeri (" << arg << "). " << e.what() << std::endl;
+            return 1;
+        }
+        try {
+            if (arg.rfind("--workers=", 0) == 0) {
+                worker_count = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--backlog=", 0) == 0) {
+                backlog = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--metrics-port=", 0) == 0) {
+                metrics_port = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--resume-grace=", 0) == 0) {
+                resume_grace_seconds = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--rendezvous-port=", 0) == 0) {
+                rendezvous_port = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--node=", 0) == 0) {
+                cluster_node = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--heartbeat=", 0) == 0) {
+                heartbeat_seconds = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--idle-timeout=", 0) == 0) {
+                idle_timeout_seconds = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--handshake-timeout=", 0) == 0) {
+                handshake_timeout_seconds = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+            if (arg.rfind("--takeover-fd=", 0) == 0) {
+                takeover_fd = std::stoi(arg.substr(arg.find('=') + 1));
+                continue;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Hata: Geçersiz sayısal değer (" << arg << "). " << e.what() << std::endl;
+            return 1;
+        }
+        try {
+            listen_port = std::stoi(arg);
+        } catch (const std::exception& e) {
+            std::cerr << "Hata: Geçersiz port numarası. " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (tunnel_limits.high_watermark == 0 || tunnel_limits.low_watermark >= tunnel_limits.high_watermark) {
+        std::cerr << "Hata: Su işaretleri 0 <= low < high olmalı (high: " << tunnel_limits.high_watermark
+                  << ", low: " << tunnel_limits.low_watermark << ")." << std::endl;
+        return 1;
+    }
+    if (viewer_lag_limit <= tunnel_limits.high_watermark) {
+        std::cerr << "Hata: İzleyici gecikme sınırı yüksek su işaretinden büyük olmalı (" << viewer_lag_limit
+                  << " <= " << tunnel_limits.high_watermark << ")." << std::endl;
+        return 1;
+    }
+    if (worker_count < 1 || backlog < 1) {
+        std::cerr << "Hata: Worker sayısı ve backlog en az 1 olmalı." << std::endl;
+        return 1;
+    }
+    if (metrics_port < 0 || metrics_port > 65535) {
+        std::cerr << "Hata: Geçersiz ölçüm portu (" << metrics_port << ")." << std::endl;
+        return 1;
+    }
+    if (rendezvous_port < 0 || rendezvous_port > 65535) {
+        std::cerr << "Hata: Geçersiz buluşma portu (" << rendezvous_port << ")." << std::endl;
+        return 1;
+    }
+    if (cluster_node < 0 || (cluster_peers.empty() && cluster_node != 0) ||
+        (!cluster_peers.empty() && cluster_node >= (int)cluster_peers.size())) {
+        std::cerr << "Hata: Düğüm indeksi küme listesinde olmalı (--node=" << cluster_node << ", düğüm sayısı: "
+                  << cluster_peers.size() << ")." << std::endl;
+        return 1;
+    }
+    if (resume_grace_seconds < 0 || (resume_grace_seconds > 0 && replay_buffer_bytes == 0)) {
+        std::cerr << "Hata: Devam ettirme süresi negatif olamaz ve yeniden gönderim tamponu 0 olamaz." << std::endl;
+        return 1;
+    }
+    if (resume_grace_seconds > 0) tunnel_limits.replay_bytes = replay_buffer_bytes;
+    if (heartbeat_seconds < 0 || idle_timeout_seconds < 0 || handshake_timeout_seconds < 0) {
+        std::cerr << "Hata: Kalp atışı, boşta kalma ve el sıkışma süreleri negatif olamaz." << std::endl;
+        return 1;
+    }
+    if (heartbeat_seconds > 0 && idle_timeout_seconds > 0 && idle_timeout_seconds <= heartbeat_seconds) {
+        // PING'e yanıt veren istemci de yanıtını göndermeden kapatılırdı
+        std::cerr << "Hata: Boşta kalma süresi kalp atışı aralığından büyük olmalı (" << idle_timeout_seconds
+                  << " <= " << heartbeat_seconds << ")." << std::endl;
+        return 1;
+    }
+
+    if (tls_cert_file.empty() != tls_key_file.empty()) {
+        std::cerr << "Hata: --tls-cert ve --tls-key birlikte verilmeli." << std::endl;
+        return 1;
+    }
+    if (!capture_dir.empty() && mkdir(capture_dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        std::cerr << "Hata: Kayıt dizini oluşturulamadı (" << capture_dir << "): " << strerror(errno) << std::endl;
+        return 1;
+    }
+    if (!tls_cert_file.empty()) {
+        try {
+            tls_context = TlsContext::server(tls_cert_file, tls_key_file);
+            tls_context->set_ktls(ktls_enabled);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Hata: TLS yapılandırılamadı: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Günlükler arka planda yazılır; SIGUSR1 paket başına (TRACE) günlükleri açıp kapatır
+    log_set_thread_name("main");
+    log_install_level_toggle(SIGUSR1);
+    log_start();
+
+    // Prometheus ölçümleri yalnızca yerel arayüzden, ayrı bir thread'de sunulur. Yükseltmede port
+    // eski süreç çıkınca açılır.
+    if (metrics_port > 0 && takeover_fd < 0) {
+        if (!metrics_start_server(metrics_port)) return 1;
+        LOG(LOG_INFO) << "Ölçümler: http://127.0.0.1:" << metrics_port << "/metrics";
+    }
+    if (takeover_fd >= 0 && use_uring) {
+        // Yükseltme yalnızca epoll motorunda başlatılır; eski süreç io_uring'den epoll'a düşmüştü
+        LOG(LOG_WARN) << "Uyarı: Devralınan relay epoll motoruyla çalışır; --engine=io_uring yok sayıldı.";
+        use_uring = false;
+    }
+
+    std::unique_ptr<UringRelay> relay;
+    if (use_uring) {
+        int server_fd = create_listener(listen_port, backlog);
+        if (server_fd < 0) exit(EXIT_FAILURE);
+        // io_uring beklemeyi kendisi yapar; bloklayan dinleyen soket çok atışlı accept'in
+        // EAGAIN döndürmeden beklemesini sağlar
+        ::fcntl(server_fd, F_SETFL, ::fcntl(server_fd, F_GETFL, 0) & ~O_NONBLOCK);
+        relay = create_uring_engine(server_fd);
+        if (relay) {
+            uring_relay = relay.get();
+            output_pending_hook = [](ClientInfo& client) { uring_relay->watch_output(client); };
+            if (worker_count > 1) {
+                LOG(LOG_WARN) << "Uyarı: io_uring motoru tek worker ile çalışır; --workers=" << worker_count
+                              << " yok sayıldı.";
+            }
+            if (resume_grace_seconds > 0) {
+                LOG(LOG_WARN) << "Uyarı: Tünel devam ettirme io_uring motorunda desteklenmiyor; --resume-grace yok sayıldı.";
+            }
+            if (scheduler_config.enabled()) {
+                LOG(LOG_WARN) << "Uyarı: Çıkış hız sınırları io_uring motorunda desteklenmiyor; yok sayıldı.";
+            }
+            if (rendezvous_port > 0) {
+                LOG(LOG_WARN) << "Uyarı: Doğrudan bağlantı buluşması io_uring motorunda desteklenmiyor; --rendezvous-port yok sayıldı.";
+            }
+            if (!cluster_peers.empty()) {
+                LOG(LOG_WARN) << "Uyarı: Relay kümesi io_uring motorunda desteklenmiyor; --cluster yok sayıldı.";
+            }
+            if (tls_context) {
+                LOG(LOG_WARN) << "Uyarı: TLS io_uring motorunda desteklenmiyor; --tls-cert/--tls-key yok sayıldı.";
+                tls_context.reset();
+            }
+            if (!capture_dir.empty()) {
+                LOG(LOG_WARN) << "Uyarı: Tünel kaydı io_uring motorunda desteklenmiyor; --capture-dir yok sayıldı.";
+                capture_dir.clear();
+            }
+            if (heartbeat_seconds > 0 || idle_timeout_seconds > 0) {
+                LOG(LOG_WARN) << "Uyarı: Kalp atışı ve boşta kalma süresi io_uring motorunda desteklenmiyor; yok sayıldı.";
+                heartbeat_seconds = idle_timeout_seconds = 0;
+            }
+            worker_count = 1;
+
+            LOG(LOG_INFO) << "Sunucu başlatıldı. Dinlenen Port: " << listen_port
+                          << ", G/Ç motoru: io_uring, Tünel aktarımı: io_uring send, Backlog: " << backlog
+                          << ", Su işaretleri: " << tunnel_limits.high_watermark << "/" << tunnel_limits.low_watermark
+                          << " byte";
+            notify_supervisor("READY=1");
+            uring_relay->run();
+
+            output_pending_hook = nullptr;
+            uring_relay = nullptr;
+            ::close(server_fd);
+            return 0;
+        }
+        ::close(server_fd);
+    }
+
+    // Tüm dinleyen soketler ve döngüler thread'ler başlamadan kurulur; port başka bir süreçte
+    // kullanılıyorsa ilk bind hata verir. Toplam ve hesap sınırları worker'lar arasında paylaşılır.
+    // Yükseltmede dinleyen soketler eski süreçten devralınır.
+    EgressLimits egress_limits(scheduler_config);
+    for (int i = 0; i < worker_count; ++i) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->index = i;
+        worker->listen_fd = takeover_fd >= 0 ? -1 : create_listener(listen_port, backlog);
+        if (worker->listen_fd < 0 && takeover_fd < 0) exit(EXIT_FAILURE);
+        try {
+            worker->loop.reset(new EventLoop());
+            worker->scheduler.reset(new EgressScheduler(egress_limits, worker->loop.get()));
+            worker->timers.reset(new TimerWheel(worker->loop.get()));
+        } catch (const std::system_error& e) {
+            LOG(LOG_ERROR) << "Hata: Olay döngüsü oluşturulamadı: " << e.what();
+            return 1;
+        }
+        workers.push_back(std::move(worker));
+    }
+    // Kendi bölümünden ID ayırır; bölümleme ilk bağlantıdan (ve devralınan istemcilerden) önce kurulmalıdır
+    if (!cluster_peers.empty()) registry.set_partition(cluster_node, cluster_peers.size());
+    if (takeover_fd >= 0) {
+        if (!take_over_relay(takeover_fd)) {
+            log_stop();
+            return 1;
+        }
+        for (auto& worker : workers) {
+            if (worker->listen_fd < 0) worker->listen_fd = create_listener(listen_port, backlog);
+            if (worker->listen_fd < 0) exit(EXIT_FAILURE);
+        }
+        if (metrics_port > 0) {
+            if (!metrics_start_server(metrics_port)) return 1;
+            LOG(LOG_INFO) << "Ölçümler: http://127.0.0.1:" << metrics_port << "/metrics";
+        }
+    }
+    if (!cluster_peers.empty()) {
+        try {
+            cluster.reset(new Cluster(*workers[0]->loop, cluster_node, cluster_peers, [](int fd, ClientId id, int node) {
+                return create_proxy(fd, id, node) != nullptr;
+            }));
+        } catch (const std::system_error& e) {
+            LOG(LOG_ERROR) << "Hata: Küme portu " << cluster_peers[cluster_node].port << " açılamadı: " << e.what();
+            return 1;
+        }
+    }
+    if (rendezvous_port > 0) {
+        try {
+            rendezvous.reset(new RendezvousServer(*workers[0]->loop, rendezvous_port, on_rendezvous_bound));
+        } catch (const std::system_error& e) {
+            LOG(LOG_ERROR) << "Hata: Buluşma (UDP) portu " << rendezvous_port << " açılamadı: " << e.what();
+            return 1;
+        }
+    }
+
+    int upgrade_fd = ::signalfd(-1, &upgrade_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (upgrade_fd >= 0) {
+        workers[0]->loop->add(upgrade_fd, EPOLLIN, [upgrade_fd](uint32_t) {
+            struct signalfd_siginfo info;
+            while (::read(upgrade_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) start_upgrade();
+        });
+    } else {
+        LOG(LOG_WARN) << "Uyarı: signalfd oluşturulamadı (" << strerror(errno) << "); kesintisiz yükseltme kapalı.";
+    }
+
+    LOG(LOG_INFO) << "Sunucu " << (takeover_fd >= 0 ? "devralındı" : "başlatıldı") << ". Dinlenen Port: " << listen_port
+                  << ", G/Ç motoru: epoll, Worker: " << worker_count << ", Backlog: " << backlog
+                  << ", Tünel aktarımı: "
+                  << (splice_forwarding_enabled && resume_grace_seconds == 0 && capture_dir.empty() ? "splice" : "kopyalama")
+                  << ", Su işaretleri: " << tunnel_limits.high_watermark << "/" << tunnel_limits.low_watermark
+                  << " byte, Devam ettirme: " << (resume_grace_seconds > 0 ? std::to_string(resume_grace_seconds) + " sn" : "kapalı")
+                  << ", Çıkış sınırları (toplam/oturum/hesap): "
+                  << (scheduler_config.enabled() ? std::to_string(scheduler_config.egress_rate) + "/" +
+                                                       std::to_string(scheduler_config.session_rate) + "/" +
+                                                       std::to_string(scheduler_config.account_rate) + " B/sn"
+                                                 : "kapalı")
+                  << ", Buluşma (UDP): " << (rendezvous ? std::to_string(rendezvous_port) : "kapalı")
+                  << ", Küme: " << (cluster ? "düğüm " + std::to_string(cluster_node) + "/" +
+                                                  std::to_string(cluster_peers.size())
+                                            : "kapalı")
+                  << ", Kalp atışı/boşta kalma/el sıkışma: "
+                  << (heartbeat_seconds > 0 ? std::to_string(heartbeat_seconds) + " sn" : "kapalı") << "/"
+                  << (idle_timeout_seconds > 0 ? std::to_string(idle_timeout_seconds) + " sn" : "kapalı") << "/"
+                  << (handshake_timeout_seconds > 0 ? std::to_string(handshake_timeout_seconds) + " sn" : "kapalı")
+                  << ", TLS: " << (tls_context ? (ktls_enabled ? "kTLS" : "kullanıcı alanı") : "kapalı")
+                  << ", Trafik kaydı: " << (capture_dir.empty() ? "kapalı" : capture_dir)
+                  << ", Günlük seviyesi: " << log_level_name((LogLevel)log_min_level.load());
+
+    for (auto& worker : workers) {
+        Worker* w = worker.get();
+        w->thread = std::thread([w]() { run_worker(*w); });
+        pin_to_core(w->thread, w->index);
+    }
+    // Devralan süreç için yöneticiye yeni ana PID'i eski süreç bildirmişti; bu yalnızca hazır olduğunu doğrular
+    notify_supervisor("READY=1");
+    for (auto& worker : workers) {
+        worker->thread.join();
+        ::close(worker->listen_fd);
+    }
     return 0;
 }
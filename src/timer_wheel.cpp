@@ -0,0 +1,142 @@
+#include "timer_wheel.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "metrics.h"
+
+static const uint64_t NS_PER_MS = 1000000;
+
+void TimerWheel::Timer::unlink() {
+    if (!next) return;
+    prev->next = next;
+    next->prev = prev;
+    prev = next = nullptr;
+    if (wheel) {
+        --wheel->count_;
+        wheel = nullptr;
+    }
+}
+
+TimerWheel::TimerWheel(EventLoop* loop, uint64_t tick_ms, uint64_t (*clock)())
+    : loop_(loop), tick_ms_(tick_ms ? tick_ms : 1), clock_(clock ? clock : metrics_now_ns), count_(0),
+      timer_fd_(-1), ticking_(false) {
+    now_ = clock_() / NS_PER_MS / tick_ms_;
+    for (auto& level : slots_) {
+        for (Slot& slot : level) slot.head.prev = slot.head.next = &slot.head;
+    }
+    if (!loop_) return;
+    timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0) throw std::system_error(errno, std::generic_category(), "timerfd_create");
+    loop_->add(timer_fd_, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations;
+        while (::read(timer_fd_, &expirations, sizeof(expirations)) > 0) {
+        }
+        advance(clock_() / NS_PER_MS);
+    });
+}
+
+TimerWheel::~TimerWheel() {
+    for (auto& level : slots_) {
+        for (Slot& slot : level) {
+            while (slot.head.next != &slot.head) slot.head.next->unlink();
+            slot.head.prev = slot.head.next = nullptr;
+        }
+    }
+    if (timer_fd_ >= 0) {
+        loop_->remove(timer_fd_);
+        ::close(timer_fd_);
+    }
+}
+
+void TimerWheel::arm(Timer& timer, uint64_t delay_ms) {
+    timer.unlink();
+    uint64_t now_ms = clock_() / NS_PER_MS;
+    if (count_ == 0) now_ = now_ms / tick_ms_; // Boş çark ilerletilmez; saat burada yakalanır
+    // Süre gerçek saate göre hesaplanır; çark bir tick geride olabilir
+    uint64_t expires = (now_ms + delay_ms + tick_ms_ - 1) / tick_ms_;
+    timer.expires = expires > now_ ? expires : now_ + 1;
+    timer.wheel = this;
+    ++count_;
+    insert(timer);
+    if (!ticking_) update_timerfd();
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    timer.unlink();
+}
+
+// Kalan tick'e göre seviye, mutlak tick'in o seviyedeki bitlerine göre yuva seçilir
+void TimerWheel::insert(Timer& timer) {
+    const uint64_t max_delta = (1ull << (SLOT_BITS * LEVELS)) - 1;
+    uint64_t delta = timer.expires > now_ ? timer.expires - now_ : 0;
+    if (delta > max_delta) {
+        delta = max_delta;
+        timer.expires = now_ + max_delta;
+    }
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= (1ull << (SLOT_BITS * (level + 1)))) ++level;
+    Timer& head = slots_[level][(timer.expires >> (SLOT_BITS * level)) & (SLOTS - 1)].head;
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+// Üst seviyenin sırası gelen yuvasındaki zamanlayıcılar kalan sürelerine göre yeniden yerleştirilir
+void TimerWheel::cascade(unsigned level) {
+    Timer& head = slots_[level][(now_ >> (SLOT_BITS * level)) & (SLOTS - 1)].head;
+    if (head.next == &head) return;
+    Timer* first = head.next;
+    Timer* last = head.prev;
+    head.prev = head.next = &head;
+    last->next = nullptr;
+    for (Timer* timer = first; timer;) {
+        Timer* next = timer->next;
+        insert(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t now_ms) {
+    uint64_t target = now_ms / tick_ms_;
+    while (now_ < target) {
+        if (count_ == 0) {
+            now_ = target;
+            break;
+        }
+        ++now_;
+        for (unsigned level = LEVELS - 1; level > 0; --level) {
+            if ((now_ & ((1ull << (SLOT_BITS * level)) - 1)) == 0) cascade(level);
+        }
+        Timer& head = slots_[0][now_ & (SLOTS - 1)].head;
+        // Callback'ler en erken bir sonraki tick'e kurulabildiğinden bu yuvaya yeni eleman eklenmez
+        while (head.next != &head) {
+            Timer* timer = head.next;
+            timer->unlink();
+            if (!timer->callback) continue;
+            // Callback zamanlayıcının sahibini (ve zamanlayıcıyı) yok edebilir; çalışan std::function
+            // serbest kalmasın diye kopyası çağrılır. Zamanlayıcının callback'i yeniden kurulabilmesi
+            // için yerinde kalır (yakalanan tek işaretçi küçük nesne tamponuna sığar, bellek ayrılmaz).
+            std::function<void()> callback = timer->callback;
+            callback();
+        }
+    }
+    update_timerfd();
+}
+
+// Çarkta zamanlayıcı varken timerfd her tick'te tetiklenir; boşken durdurulur
+void TimerWheel::update_timerfd() {
+    if (timer_fd_ < 0 || ticking_ == (count_ > 0)) return;
+    ticking_ = count_ > 0;
+    struct itimerspec spec = {};
+    if (ticking_) {
+        spec.it_value.tv_sec = spec.it_interval.tv_sec = tick_ms_ / 1000;
+        spec.it_value.tv_nsec = spec.it_interval.tv_nsec = (tick_ms_ % 1000) * NS_PER_MS;
+    }
+    ::timerfd_settime(timer_fd_, 0, &spec, nullptr);
+}
@@ -0,0 +1,421 @@
+#include "tls_link.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/ssl.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+// OpenSSL'in TLS 1.3 şifre takımı kimlikleri (0x0300 | IANA değeri)
+static const unsigned long SUITE_AES_128_GCM_SHA256 = 0x03001301;
+static const unsigned long SUITE_AES_256_GCM_SHA384 = 0x03001302;
+static const unsigned long SUITE_CHACHA20_POLY1305_SHA256 = 0x03001303;
+
+static std::string openssl_error(const char* what) {
+    char buffer[256];
+    unsigned long code = ERR_get_error();
+    ERR_clear_error();
+    if (code == 0) return what;
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    return std::string(what) + ": " + buffer;
+}
+
+// SSL nesnesinden ona ait TlsStream'e (keylog geri çağrısı için)
+static int stream_index() {
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+static std::string from_hex(const char* hex, size_t len) {
+    std::string out;
+    if (len % 2 != 0) return out;
+    for (size_t i = 0; i < len; i += 2) {
+        char pair[3] = { hex[i], hex[i + 1], 0 };
+        char* end;
+        long value = strtol(pair, &end, 16);
+        if (*end != 0) return std::string();
+        out.push_back((char)value);
+    }
+    return out;
+}
+
+// El sıkışmada türetilen ilk uygulama trafik anahtarları keylog satırlarından alınır
+// ("<etiket> <client_random> <secret>"); OpenSSL bunları başka yoldan vermez.
+struct TlsSecrets {
+    static void keylog(const SSL* ssl, const char* line) {
+        TlsStream* stream = static_cast<TlsStream*>(SSL_get_ex_data(ssl, stream_index()));
+        if (!stream) return;
+        const char* random_end = nullptr;
+        std::string* target = nullptr;
+        if (strncmp(line, "CLIENT_TRAFFIC_SECRET_0 ", 24) == 0) {
+            target = &stream->client_secret_;
+        } else if (strncmp(line, "SERVER_TRAFFIC_SECRET_0 ", 24) == 0) {
+            target = &stream->server_secret_;
+        } else {
+            return;
+        }
+        random_end = strchr(line + 24, ' ');
+        if (random_end) *target = from_hex(random_end + 1, strlen(random_end + 1));
+    }
+};
+
+static SSL_CTX* new_context(const SSL_METHOD* method) {
+    SSL_CTX* ctx = SSL_CTX_new(method);
+    if (!ctx) throw std::runtime_error(openssl_error("SSL_CTX_new"));
+    // kTLS'e geçişte kayıt sırası 0 olmalı: TLS 1.3 dışı, oturum bileti ve PSK yok
+    SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION);
+    SSL_CTX_set_num_tickets(ctx, 0);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_ciphersuites(ctx, "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256");
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF | SSL_OP_NO_TICKET);
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    SSL_CTX_set_keylog_callback(ctx, TlsSecrets::keylog);
+    return ctx;
+}
+
+// --- TlsContext ---
+
+std::unique_ptr<TlsContext> TlsContext::server(const std::string& cert_file, const std::string& key_file) {
+    SSL_CTX* ctx = new_context(TLS_server_method());
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert_file.c_str()) != 1) {
+        SSL_CTX_free(ctx);
+        throw std::runtime_error(openssl_error(("sertifika okunamadı (" + cert_file + ")").c_str()));
+    }
+    if (SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1) {
+        SSL_CTX_free(ctx);
+        throw std::runtime_error(openssl_error(("özel anahtar okunamadı (" + key_file + ")").c_str()));
+    }
+    return std::unique_ptr<TlsContext>(new TlsContext(ctx, true));
+}
+
+std::unique_ptr<TlsContext> TlsContext::client(const std::string& ca_file) {
+    SSL_CTX* ctx = new_context(TLS_client_method());
+    if (!ca_file.empty()) {
+        if (SSL_CTX_load_verify_locations(ctx, ca_file.c_str(), nullptr) != 1) {
+            SSL_CTX_free(ctx);
+            throw std::runtime_error(openssl_error(("CA dosyası okunamadı (" + ca_file + ")").c_str()));
+        }
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    } else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    }
+    return std::unique_ptr<TlsContext>(new TlsContext(ctx, false));
+}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(ctx_);
+}
+
+void TlsContext::set_ktls(bool enabled) {
+    if (enabled) {
+        SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+    } else {
+        SSL_CTX_clear_options(ctx_, SSL_OP_ENABLE_KTLS);
+    }
+}
+
+// --- TlsStream ---
+
+TlsStream::TlsStream(const TlsContext& context, int fd) : ssl_(SSL_new(context.native())), fd_(fd),
+                                                         server_(context.is_server()) {
+    if (!ssl_ || SSL_set_fd(ssl_, fd) != 1) {
+        SSL_free(ssl_);
+        throw std::runtime_error(openssl_error("SSL_new"));
+    }
+    SSL_set_ex_data(ssl_, stream_index(), this);
+    if (server_) {
+        SSL_set_accept_state(ssl_);
+    } else {
+        SSL_set_connect_state(ssl_);
+    }
+}
+
+TlsStream::~TlsStream() {
+    SSL_free(ssl_);
+}
+
+TlsResult TlsStream::handshake() {
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl_);
+    if (ret == 1) return TLS_DONE;
+    switch (SSL_get_error(ssl_, ret)) {
+    case SSL_ERROR_WANT_READ:
+        return TLS_WANT_READ;
+    case SSL_ERROR_WANT_WRITE:
+        return TLS_WANT_WRITE;
+    default:
+        ERR_clear_error();
+        return TLS_FAILED;
+    }
+}
+
+std::string TlsStream::cipher_name() const {
+    const char* name = SSL_get_cipher_name(ssl_);
+    return name ? name : "?";
+}
+
+// RFC 8446 7.1/7.3: HKDF-Expand-Label(secret, label, "", len). Çıktı tek özet bloğuna sığar.
+static std::string expand_label(const EVP_MD* md, const std::string& secret, const char* label, size_t len) {
+    std::string info;
+    info.push_back((char)(len >> 8));
+    info.push_back((char)len);
+    std::string full_label = std::string("tls13 ") + label;
+    info.push_back((char)full_label.size());
+    info += full_label;
+    info.push_back(0); // Boş bağlam
+    info.push_back(1); // HKDF-Expand sayacı T(1)
+    unsigned char out[EVP_MAX_MD_SIZE];
+    unsigned int out_len = 0;
+    if (!HMAC(md, secret.data(), (int)secret.size(), reinterpret_cast<const unsigned char*>(info.data()), info.size(),
+              out, &out_len) || out_len < len) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<char*>(out), len);
+}
+
+template <typename Info>
+static bool install_keys(int fd, int direction, uint16_t cipher_type, const std::string& key, const std::string& iv) {
+    Info info;
+    memset(&info, 0, sizeof(info));
+    info.info.version = TLS_1_3_VERSION;
+    info.info.cipher_type = cipher_type;
+    if (key.size() != sizeof(info.key) || iv.size() != sizeof(info.salt) + sizeof(info.iv)) {
+        errno = EINVAL;
+        return false;
+    }
+    memcpy(info.key, key.data(), sizeof(info.key));
+    // TLS 1.3 nonce'u: salt + iv birlikte 12 byte'lık write_iv; rec_seq 0
+    memcpy(info.salt, iv.data(), sizeof(info.salt));
+    memcpy(info.iv, iv.data() + sizeof(info.salt), sizeof(info.iv));
+    bool ok = ::setsockopt(fd, SOL_TLS, direction, &info, sizeof(info)) == 0;
+    memset(&info, 0, sizeof(info));
+    return ok;
+}
+
+static bool install_direction(int fd, int direction, unsigned long suite, const EVP_MD* md, const std::string& secret) {
+    size_t key_len = suite == SUITE_AES_128_GCM_SHA256 ? 16 : 32;
+    std::string key = expand_label(md, secret, "key", key_len);
+    std::string iv = expand_label(md, secret, "iv", 12);
+    if (key.empty() || iv.empty()) {
+        errno = EINVAL;
+        return false;
+    }
+    if (suite == SUITE_AES_128_GCM_SHA256) {
+        return install_keys<tls12_crypto_info_aes_gcm_128>(fd, direction, TLS_CIPHER_AES_GCM_128, key, iv);
+    }
+    if (suite == SUITE_AES_256_GCM_SHA384) {
+        return install_keys<tls12_crypto_info_aes_gcm_256>(fd, direction, TLS_CIPHER_AES_GCM_256, key, iv);
+    }
+    return install_keys<tls12_crypto_info_chacha20_poly1305>(fd, direction, TLS_CIPHER_CHACHA20_POLY1305, key, iv);
+}
+
+KtlsResult TlsStream::enable_ktls(std::string* reason) {
+    std::string ignored;
+    if (!reason) reason = &ignored;
+    if (SSL_has_pending(ssl_)) {
+        // OpenSSL'in okuyup işlemediği kayıtlar çekirdeğe aktarılamaz
+        *reason = "bekleyen TLS kaydı var";
+        return KTLS_UNSUPPORTED;
+    }
+    // SSL_OP_ENABLE_KTLS ile OpenSSL yönleri el sıkışmada kendisi kurmuş olabilir
+    bool native_tx = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+    bool native_rx = BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+    if (native_tx && native_rx) {
+        client_secret_.assign(client_secret_.size(), 0);
+        server_secret_.assign(server_secret_.size(), 0);
+        return KTLS_ENABLED;
+    }
+
+    const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl_);
+    unsigned long suite = cipher ? SSL_CIPHER_get_id(cipher) : 0;
+    const EVP_MD* md = cipher ? SSL_CIPHER_get_handshake_digest(cipher) : nullptr;
+    if (suite != SUITE_AES_128_GCM_SHA256 && suite != SUITE_AES_256_GCM_SHA384 &&
+        suite != SUITE_CHACHA20_POLY1305_SHA256) {
+        *reason = "desteklenmeyen şifre takımı " + cipher_name();
+        return KTLS_UNSUPPORTED;
+    }
+    if (!md || client_secret_.empty() || server_secret_.empty()) {
+        *reason = "trafik anahtarları alınamadı";
+        return KTLS_UNSUPPORTED;
+    }
+
+    // Henüz uygulama kaydı gönderilmemiş/alınmamış olduğundan elle kurulan yönün kayıt sırası 0'dır
+    const std::string& tx_secret = server_ ? server_secret_ : client_secret_;
+    const std::string& rx_secret = server_ ? client_secret_ : server_secret_;
+    if (!native_tx) {
+        if (::setsockopt(fd_, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+            *reason = std::string("TCP_ULP: ") + strerror(errno);
+            return KTLS_UNSUPPORTED;
+        }
+        // Anahtarsız tls ULP'si soketi olduğu gibi bırakır; yalnızca TX kurulduktan sonraki hata kalıcıdır
+        if (!install_direction(fd_, TLS_TX, suite, md, tx_secret)) {
+            *reason = std::string("TLS_TX (") + cipher_name() + "): " + strerror(errno);
+            return KTLS_UNSUPPORTED;
+        }
+    }
+    if (!install_direction(fd_, TLS_RX, suite, md, rx_secret)) {
+        *reason = std::string("TLS_RX (") + cipher_name() + "): " + strerror(errno);
+        // OpenSSL'in kurduğu TX'i OpenSSL bilir; oturum kullanıcı alanında sürebilir
+        return native_tx ? KTLS_UNSUPPORTED : KTLS_FAILED;
+    }
+    client_secret_.assign(client_secret_.size(), 0);
+    server_secret_.assign(server_secret_.size(), 0);
+    return KTLS_ENABLED;
+}
+
+ssize_t TlsStream::read(char* data, size_t len) {
+    ERR_clear_error();
+    int ret = SSL_read(ssl_, data, (int)std::min<size_t>(len, INT_MAX));
+    if (ret > 0) return ret;
+    switch (SSL_get_error(ssl_, ret)) {
+    case SSL_ERROR_ZERO_RETURN:
+        return 0;
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    default:
+        ERR_clear_error();
+        errno = ECONNRESET;
+        return -1;
+    }
+}
+
+ssize_t TlsStream::write(const char* data, size_t len) {
+    ERR_clear_error();
+    int ret = SSL_write(ssl_, data, (int)std::min<size_t>(len, INT_MAX));
+    if (ret > 0) return ret;
+    switch (SSL_get_error(ssl_, ret)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    default:
+        ERR_clear_error();
+        errno = ECONNRESET;
+        return -1;
+    }
+}
+
+void TlsStream::shutdown() {
+    ERR_clear_error();
+    SSL_shutdown(ssl_);
+    ERR_clear_error();
+}
+
+// --- TlsBridge ---
+
+TlsBridge::TlsBridge(std::unique_ptr<TlsStream> stream, int plain_fd)
+    : stream_(std::move(stream)), plain_fd_(plain_fd) {}
+
+TlsBridge::~TlsBridge() {
+    int tls_fd = stream_->fd();
+    stream_.reset();
+    ::close(tls_fd);
+    ::close(plain_fd_);
+}
+
+static bool would_block(ssize_t n) {
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+bool TlsBridge::pump() {
+    bool progress = true;
+    while (progress && !failed_) {
+        progress = false;
+
+        // TLS -> düz
+        if (inbound_off_ == inbound_len_ && !tls_eof_) {
+            ssize_t n = stream_->read(inbound_, sizeof(inbound_));
+            if (n > 0) {
+                inbound_off_ = 0;
+                inbound_len_ = (size_t)n;
+                progress = true;
+            } else if (n == 0) {
+                tls_eof_ = true;
+                progress = true;
+            } else if (!would_block(n)) {
+                failed_ = true;
+            }
+        }
+        if (inbound_off_ < inbound_len_) {
+            ssize_t n = ::send(plain_fd_, inbound_ + inbound_off_, inbound_len_ - inbound_off_, MSG_NOSIGNAL);
+            if (n > 0) {
+                inbound_off_ += (size_t)n;
+                progress = true;
+            } else if (!would_block(n)) {
+                failed_ = true;
+            }
+        }
+        if (tls_eof_ && inbound_off_ == inbound_len_ && !plain_shut_) {
+            ::shutdown(plain_fd_, SHUT_WR);
+            plain_shut_ = true;
+        }
+
+        // Düz -> TLS
+        if (outbound_off_ == outbound_len_ && !plain_eof_) {
+            ssize_t n = ::read(plain_fd_, outbound_, sizeof(outbound_));
+            if (n > 0) {
+                outbound_off_ = 0;
+                outbound_len_ = (size_t)n;
+                progress = true;
+            } else if (n == 0) {
+                plain_eof_ = true;
+                progress = true;
+            } else if (!would_block(n)) {
+                failed_ = true;
+            }
+        }
+        if (outbound_off_ < outbound_len_) {
+            ssize_t n = stream_->write(outbound_ + outbound_off_, outbound_len_ - outbound_off_);
+            if (n > 0) {
+                outbound_off_ += (size_t)n;
+                progress = true;
+            } else if (!would_block(n)) {
+                failed_ = true;
+            }
+        }
+    }
+    if (failed_) return false;
+    if (plain_eof_ && outbound_off_ == outbound_len_) {
+        // Relay ucu kapattı; kalan her şey gönderildi
+        stream_->shutdown();
+        return false;
+    }
+    return true;
+}
+
+short TlsBridge::tls_events() const {
+    short events = 0;
+    if (!tls_eof_ && inbound_off_ == inbound_len_) events |= POLLIN;
+    if (outbound_off_ < outbound_len_) events |= POLLOUT;
+    return events;
+}
+
+short TlsBridge::plain_events() const {
+    short events = 0;
+    if (!plain_eof_ && outbound_off_ == outbound_len_) events |= POLLIN;
+    if (inbound_off_ < inbound_len_) events |= POLLOUT;
+    return events;
+}
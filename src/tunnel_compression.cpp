@@ -0,0 +1,189 @@
+#include "tunnel_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+// Ham deflate (zlib/gzip başlığı ve sağlama toplamı yok); akışın bütünlüğünü TCP/TLS sağlar
+static const int DEFLATE_WINDOW_BITS = -15;
+static const int DEFLATE_MEM_LEVEL = 8;
+// Entropi örneği ve bu boyuttan küçük parçalar (giriş olayları) için örnekleme yapılmaz
+static const size_t ENTROPY_SAMPLE = 4096;
+static const size_t ENTROPY_MIN_CHUNK = 256;
+// Pencerede sıkıştırmanın CPU payı (CPU süresi / duvar saati): bunun altındaysa seviye artırılabilir,
+// üstündeyse bağlantı darboğaz olsa bile azaltılır
+static const double CPU_HEADROOM_SHARE = 0.5;
+static const double CPU_MAX_SHARE = 0.8;
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+double sample_entropy(const char* data, size_t len) {
+    if (len == 0) return 0;
+    // Parçanın tamamına yayılmış örnek: karışık içerikte (ör. başlık + JPEG) yalnızca başa bakılmaz
+    size_t stride = std::max<size_t>(1, len / ENTROPY_SAMPLE);
+    uint32_t counts[256] = {0};
+    size_t samples = 0;
+    for (size_t i = 0; i < len; i += stride) {
+        ++counts[(uint8_t)data[i]];
+        ++samples;
+    }
+    double entropy = 0;
+    for (uint32_t count : counts) {
+        if (count == 0) continue;
+        double p = (double)count / samples;
+        entropy -= p * std::log2(p);
+    }
+    return entropy;
+}
+
+TunnelCompressor::TunnelCompressor(int fixed_level) : fixed_level_(fixed_level) {
+    level_ = fixed_level_ >= 0 ? fixed_level_ : COMPRESSION_LEVELS[level_index_];
+    memset(&stream_, 0, sizeof(stream_));
+    if (deflateInit2(&stream_, level_, Z_DEFLATED, DEFLATE_WINDOW_BITS, DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflateInit2 başarısız");
+    }
+}
+
+TunnelCompressor::~TunnelCompressor() {
+    deflateEnd(&stream_);
+}
+
+// Seviyeyi akışı bozmadan değiştirir. Her parça Z_SYNC_FLUSH ile bittiği için bekleyen girdi yoktur;
+// zlib yine de boş bir blok yazabileceği için çıktısı out'a eklenir.
+bool TunnelCompressor::set_level(int level, std::string* out) {
+    if (level == level_) return true;
+    Bytef scratch[64];
+    stream_.next_in = nullptr;
+    stream_.avail_in = 0;
+    stream_.next_out = scratch;
+    stream_.avail_out = sizeof(scratch);
+    int rc = deflateParams(&stream_, level, Z_DEFAULT_STRATEGY);
+    if (rc != Z_OK) return false;
+    out->append((const char*)scratch, sizeof(scratch) - stream_.avail_out);
+    level_ = level;
+    return true;
+}
+
+void TunnelCompressor::note_blocked(bool blocked) {
+    if (blocked == (blocked_since_ns_ != 0)) return;
+    uint64_t now = monotonic_ns();
+    if (blocked) {
+        blocked_since_ns_ = now;
+    } else {
+        window_blocked_ns_ += now - blocked_since_ns_;
+        blocked_since_ns_ = 0;
+    }
+}
+
+void TunnelCompressor::adapt(uint64_t now_ns) {
+    if (window_start_ns_ == 0) {
+        window_start_ns_ = now_ns;
+        return;
+    }
+    uint64_t elapsed = now_ns - window_start_ns_;
+    if (elapsed < (uint64_t)COMPRESSION_WINDOW_MS * 1000000ull) return;
+
+    if (blocked_since_ns_ != 0) { // Süren bekleme bu pencereye sayılır
+        window_blocked_ns_ += now_ns - blocked_since_ns_;
+        blocked_since_ns_ = now_ns;
+    }
+    double cpu_share = (double)window_cpu_ns_ / elapsed;
+    double blocked_share = (double)window_blocked_ns_ / elapsed;
+    int previous = level_index_;
+    if (cpu_share > CPU_MAX_SHARE || blocked_share < BACKLOG_IDLE_SHARE) {
+        // CPU yetmiyor veya bağlantı zaten yetişiyor: daha az sıkıştırmak gecikmeyi ve CPU'yu azaltır
+        if (level_index_ > 0) --level_index_;
+    } else if (blocked_share >= BACKLOG_STEP_UP_SHARE && cpu_share < CPU_HEADROOM_SHARE &&
+               level_index_ + 1 < COMPRESSION_LEVEL_COUNT) {
+        // Bağlantı darboğaz ve CPU boşta: aynı bağlantıdan daha fazla ekran verisi geçer
+        ++level_index_;
+    }
+    if (level_index_ != previous) ++stats_.level_changes;
+    window_start_ns_ = now_ns;
+    window_cpu_ns_ = 0;
+    window_blocked_ns_ = 0;
+}
+
+bool TunnelCompressor::compress(const char* data, size_t len, std::string* out) {
+    if (len == 0) return true;
+    uint64_t cpu_start = thread_cpu_ns();
+
+    int level = level_;
+    bool incompressible = false;
+    if (fixed_level_ < 0) {
+        adapt(monotonic_ns());
+        level = COMPRESSION_LEVELS[level_index_];
+        incompressible = len >= ENTROPY_MIN_CHUNK && sample_entropy(data, len) > INCOMPRESSIBLE_ENTROPY;
+        if (incompressible) level = 0;
+    }
+    size_t out_start = out->size();
+    if (!set_level(level, out)) return false;
+
+    stream_.next_in = (Bytef*)data;
+    stream_.avail_in = len;
+    size_t room = deflateBound(&stream_, len) + 16;
+    do {
+        size_t old_size = out->size();
+        out->resize(old_size + room);
+        stream_.next_out = (Bytef*)&(*out)[old_size];
+        stream_.avail_out = room;
+        int rc = deflate(&stream_, Z_SYNC_FLUSH);
+        out->resize(old_size + room - stream_.avail_out);
+        if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+    } while (stream_.avail_out == 0);
+
+    uint64_t cpu = thread_cpu_ns() - cpu_start;
+    window_cpu_ns_ += cpu;
+    stats_.cpu_ns += cpu;
+    stats_.bytes_in += len;
+    stats_.bytes_out += out->size() - out_start;
+    if (incompressible) stats_.stored_bytes += len;
+    return true;
+}
+
+TunnelDecompressor::TunnelDecompressor() {
+    memset(&stream_, 0, sizeof(stream_));
+    if (inflateInit2(&stream_, DEFLATE_WINDOW_BITS) != Z_OK) {
+        throw std::runtime_error("inflateInit2 başarısız");
+    }
+}
+
+TunnelDecompressor::~TunnelDecompressor() {
+    inflateEnd(&stream_);
+}
+
+bool TunnelDecompressor::decompress(const char* data, size_t len, std::string* out) {
+    stream_.next_in = (Bytef*)data;
+    stream_.avail_in = len;
+    size_t room = std::max<size_t>(len * 4, 16 * 1024);
+    size_t produced = 0;
+    while (true) {
+        size_t old_size = out->size();
+        out->resize(old_size + room);
+        stream_.next_out = (Bytef*)&(*out)[old_size];
+        stream_.avail_out = room;
+        int rc = inflate(&stream_, Z_SYNC_FLUSH);
+        size_t written = room - stream_.avail_out;
+        out->resize(old_size + written);
+        produced += written;
+        // Gönderen akışı hiç bitirmez (son blok yazılmaz); bitmiş akış veya bozuk veri hatadır
+        if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+        if (stream_.avail_out != 0) break; // Girdi bitti ve bekleyen çıktı kalmadı
+    }
+    if (stream_.avail_in != 0) return false;
+    bytes_in_ += len;
+    bytes_out_ += produced;
+    return true;
+}
@@ -0,0 +1,498 @@
+#include "tunnel_session.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "logger.h"
+
+// splice çağrısı başına soketten boruya taşınacak en fazla byte
+static const size_t SPLICE_CHUNK_SIZE = 64 * 1024;
+
+TunnelSession::TunnelSession(EventLoop& loop, ClientInfo& a, ClientInfo& b, bool use_splice,
+                             const TunnelLimits& limits, EgressScheduler* scheduler)
+    : loop_(loop), limits_(limits),
+      dirs_{{&a, &b, limits.high_watermark + limits.replay_bytes, limits.replay_bytes},
+            {&b, &a, limits.high_watermark + limits.replay_bytes, limits.replay_bytes}},
+      metrics_(relay_metrics.open_tunnel(a.id, b.id)),
+      scheduler_(scheduler && scheduler->enabled() ? scheduler : nullptr), closed_(false) {
+    dirs_[0].stats = &metrics_->dirs[0];
+    dirs_[1].stats = &metrics_->dirs[1];
+    dirs_[0].framed = dirs_[1].framed = a.mux && b.mux;
+    if (scheduler_) {
+        // Oturum sınırı iki yönü birlikte kapsar; hesap, verinin gittiği ucun hesabıdır
+        std::shared_ptr<RateLimiter> session_limiter = scheduler_->limits().new_session();
+        for (Direction& dir : dirs_) {
+            ClientInfo* dst = dir.dst;
+            dir.flow.session = session_limiter;
+            dir.flow.account = scheduler_->limits().account(dst->ip_address);
+            dir.flow.wake = [this, dst]() { on_writable(*dst); };
+        }
+    }
+    // Yeniden gönderim için gönderilen verinin saklanması gerekir; splice veriyi saklamaz.
+    // Çerçeveli tünelde çerçeve başlıkları okunmalıdır.
+    if (use_splice && !resumable() && !dirs_[0].framed) {
+        open_pipe(dirs_[0]);
+        open_pipe(dirs_[1]);
+    }
+}
+
+TunnelSession::~TunnelSession() {
+    if (scheduler_) {
+        scheduler_->remove(dirs_[0].flow);
+        scheduler_->remove(dirs_[1].flow);
+    }
+    close_pipe(dirs_[0]);
+    close_pipe(dirs_[1]);
+    if (!closed_) relay_metrics.close_tunnel(metrics_); // close() çağrıldıysa ölçümler zaten kapatıldı
+}
+
+ClientInfo& TunnelSession::peer_of(const ClientInfo& client) {
+    return *direction_from(client).dst;
+}
+
+TunnelSession::Direction& TunnelSession::direction_from(const ClientInfo& src) {
+    return dirs_[0].src == &src ? dirs_[0] : dirs_[1];
+}
+
+size_t TunnelSession::pending_bytes(const Direction& dir) const {
+    return dir.pipe_bytes + dir.buffer.size() + dir.backlog.size();
+}
+
+size_t TunnelSession::pending_bytes_to(const ClientInfo& dst) const {
+    return pending_bytes(dirs_[0].dst == &dst ? dirs_[0] : dirs_[1]);
+}
+
+// Kaynaktan okunan parçayı sayar ve alım zamanını gecikme ölçümü için saklar
+void TunnelSession::on_received(Direction& dir, size_t bytes) {
+    dir.received += bytes;
+    metrics_add(dir.stats->chunks, 1);
+    dir.latency.on_received(bytes, metrics_now_ns());
+}
+
+// dst'ye gönderilen veriyi sayar; tamamı gönderilen parçaların gecikmesi histograma yazılır
+void TunnelSession::on_sent(Direction& dir, size_t bytes) {
+    if (scheduler_) scheduler_->sent(dir.flow, bytes);
+    dir.sent += bytes;
+    metrics_add(dir.stats->bytes, bytes);
+    dir.latency.on_sent(bytes, metrics_now_ns(), metrics_->forward_latency);
+}
+
+// dst'ye şimdi gönderilebilecek byte (zamanlayıcı yoksa tamamı). 0 ise yön sıraya alınmıştır;
+// sırası gelince on_writable ile devam edilir.
+size_t TunnelSession::egress_allowance(Direction& dir, size_t pending) {
+    return scheduler_ ? scheduler_->grant(dir.flow, pending) : pending;
+}
+
+// Yön için splice borusunu açar. Boru açılamazsa (örn. EMFILE) bu yön kopyalama yolunda kalır.
+bool TunnelSession::open_pipe(Direction& dir) {
+    if (::pipe2(dir.pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+        LOG_RATE_LIMITED(LOG_WARN, 5) << "Tünel borusu (pipe2) oluşturulamadı, kopyalama yolu kullanılacak: "
+                                      << strerror(errno);
+        dir.pipe[0] = dir.pipe[1] = -1;
+        return false;
+    }
+    dir.pipe_bytes = 0;
+    // Boru, yükseğe su işaretine kadar veri tutabilsin. Sınır (pipe-max-size) aşılırsa
+    // varsayılan kapasite kalır; bekleyen veri yine high_watermark ile sınırlıdır.
+    ::fcntl(dir.pipe[1], F_SETPIPE_SZ, (int)limits_.high_watermark);
+    return true;
+}
+
+// Splice borusunu kapatır; içinde kalan veri atılır
+void TunnelSession::close_pipe(Direction& dir) {
+    if (dir.pipe[0] != -1) {
+        ::close(dir.pipe[0]);
+        ::close(dir.pipe[1]);
+    }
+    dir.pipe[0] = dir.pipe[1] = -1;
+    dir.pipe_bytes = 0;
+}
+
+// Splice desteklenmiyorsa (EINVAL) borudaki veriyi yönün halka tamponuna taşır ve
+// bu yönü kopyalama yoluna geri alır. Boruda en fazla high_watermark byte bulunabildiği için
+// veri tampona sığar.
+void TunnelSession::fall_back_to_copy(Direction& dir) {
+    while (dir.pipe_bytes > 0) {
+        ssize_t n = dir.buffer.read_from_fd(dir.pipe[0], dir.pipe_bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        dir.pipe_bytes -= n;
+    }
+    close_pipe(dir);
+    flush_buffer(dir);
+    LOG(LOG_INFO) << "Sunucu: splice desteklenmiyor (Soket: " << dir.src->socket_fd << "), kopyalama yoluna dönüldü.";
+}
+
+// Borudaki veriyi dst soketine aktarır. Sıralamayı korumak için dst'nin çıkış tamponunda
+// bekleyen veri varsa önce onun boşalması beklenir. Boru tamamen boşaldıysa true döner.
+bool TunnelSession::drain_pipe(Direction& dir) {
+    if (!dir.dst->output_buffer.empty()) return dir.pipe_bytes == 0;
+    while (dir.pipe_bytes > 0) {
+        size_t allowed = egress_allowance(dir, dir.pipe_bytes);
+        if (allowed == 0) return false;
+        ssize_t n = ::splice(dir.pipe[0], nullptr, dir.dst->socket_fd, nullptr, allowed,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            dir.pipe_bytes -= n;
+            on_sent(dir, n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno == EINVAL) {
+            fall_back_to_copy(dir);
+            return dir.buffer.empty();
+        } else {
+            // EAGAIN: peer yavaş, EPOLLOUT beklenir. Diğer hatalarda peer kendi olayında kapanır.
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) metrics_add(dir.stats->partial_sends, 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Tampona eklenen veride başlığı tamamlanan çerçeveleri çözer. Veri çerçevelerinin yalnızca
+// sonu kaydedilir; kanal 0 çerçeveleri tamamlanınca tampondan çıkarılır, DATA yükü control'a
+// eklenir. Tamamlanmamış bir kanal 0 çerçevesinin ötesi çözülmez (ve gönderilmez).
+// src geçersiz çerçeve gönderdiyse false döner.
+bool TunnelSession::scan_frames(Direction& dir) {
+    uint64_t tail = dir.sent + dir.buffer.size();
+    while (dir.scan_at + MUX_HEADER_SIZE <= tail) {
+        char bytes[MUX_HEADER_SIZE];
+        dir.buffer.peek(dir.scan_at - dir.sent, bytes, MUX_HEADER_SIZE);
+        MuxHeader header;
+        if (!parse_mux_header(bytes, &header)) return false;
+        uint64_t end = dir.scan_at + MUX_HEADER_SIZE + header.length;
+        if (header.channel != MUX_CHANNEL_CONTROL) {
+            dir.scan_at = end;
+            dir.frame_ends.push_back(end);
+            continue;
+        }
+        if (end > tail) break;
+        size_t start = dir.scan_at - dir.sent;
+        if (header.type == MUX_DATA) {
+            size_t old_size = dir.control.size();
+            dir.control.resize(old_size + header.length);
+            dir.buffer.peek(start + MUX_HEADER_SIZE, &dir.control[old_size], header.length);
+        }
+        // Çerçeveden sonra okunmuş veri çerçevenin yerine kaydırılır
+        std::string rest(tail - end, '\0');
+        dir.buffer.peek(end - dir.sent, &rest[0], rest.size());
+        dir.buffer.truncate(start);
+        dir.buffer.write(rest.data(), rest.size());
+        tail -= end - dir.scan_at;
+    }
+    return true;
+}
+
+// Tampona sığmamış veriyi yer açıldıkça tampona alır
+void TunnelSession::fill_from_backlog(Direction& dir) {
+    if (dir.backlog.empty()) return;
+    size_t n = dir.buffer.write(dir.backlog.data(), dir.backlog.size());
+    dir.backlog.erase(0, n);
+    if (!scan_frames(dir)) dir.broken = true;
+}
+
+// Çerçeveli yönde şimdi gönderilebilecek byte: yalnızca çözülmüş çerçeveler; bekleyen kontrol
+// çerçevesi varsa gönderim içinde bulunulan çerçevenin sonunda durur
+size_t TunnelSession::sendable_frames(Direction& dir) {
+    while (!dir.frame_ends.empty() && dir.frame_ends.front() <= dir.sent) dir.frame_ends.pop_front();
+    uint64_t limit = dir.scan_at;
+    if (!dir.urgent.empty() && !dir.frame_ends.empty()) limit = dir.frame_ends.front();
+    return std::min<uint64_t>(dir.buffer.size(), limit - dir.sent);
+}
+
+// Gönderim bir çerçeve sınırındaysa bekleyen kontrol çerçevelerini dst'nin çıkış tamponuna ekler
+void TunnelSession::flush_urgent(Direction& dir) {
+    if (dir.urgent.empty()) return;
+    while (!dir.frame_ends.empty() && dir.frame_ends.front() <= dir.sent) dir.frame_ends.pop_front();
+    if (!dir.frame_ends.empty()) return;
+    queue_send(*dir.dst, dir.urgent.data(), dir.urgent.size());
+    dir.urgent.clear();
+}
+
+// Halka tampondaki veriyi dst soketine gönderir. Kısmi gönderimde kalan veri tamponda kalır
+// ve EPOLLOUT ile devam edilir. Tampon tamamen boşaldıysa true döner.
+bool TunnelSession::flush_buffer(Direction& dir) {
+    if (dir.framed) {
+        fill_from_backlog(dir);
+        flush_urgent(dir);
+    }
+    if (!dir.dst->output_buffer.empty()) return dir.buffer.empty();
+    while (!dir.buffer.empty()) {
+        size_t pending = dir.framed ? sendable_frames(dir) : dir.buffer.size();
+        if (pending == 0) return false;
+        size_t allowed = egress_allowance(dir, pending);
+        if (allowed == 0) return false;
+        ssize_t n = dir.buffer.send_to_socket(dir.dst->socket_fd, allowed);
+        if (n > 0) {
+            on_sent(dir, n);
+            if (dir.framed) {
+                fill_from_backlog(dir);
+                flush_urgent(dir);
+                if (!dir.dst->output_buffer.empty()) return false;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        // EAGAIN: peer yavaş. Diğer hatalarda peer kendi olayında kapanır.
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) metrics_add(dir.stats->partial_sends, 1);
+        return false;
+    }
+    return true;
+}
+
+bool TunnelSession::splice_forward(Direction& dir) {
+    while (dir.pipe[0] != -1) {
+        if (dir.pipe_bytes > 0) drain_pipe(dir);
+        if (dir.pipe[0] == -1) break; // drain sırasında kopyalama yoluna dönülmüş olabilir
+
+        // Boruda yüksek su işareti kadar veri birikti: peer yetişene kadar src'yi durdur
+        if (dir.pipe_bytes >= limits_.high_watermark) {
+            LOG_RATE_LIMITED(LOG_DEBUG, 10) << "Tünel: ID " << dir.src->id << " okuması durduruldu (boruda "
+                                            << dir.pipe_bytes << " byte)";
+            dir.src->read_paused = true;
+            return true;
+        }
+
+        size_t room = std::min(SPLICE_CHUNK_SIZE, limits_.high_watermark - dir.pipe_bytes);
+        ssize_t n = ::splice(dir.src->socket_fd, nullptr, dir.pipe[1], nullptr, room,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            dir.pipe_bytes += n;
+            on_received(dir, n);
+            LOG(LOG_TRACE) << "Tünel: ID " << dir.src->id << " -> ID " << dir.dst->id << " " << n << " byte (splice)";
+        } else if (n == 0) {
+            return false; // Bağlantı kapandı
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // Soket boş ya da boru dolu. Boru boşsa soket boştur.
+            if (dir.pipe_bytes == 0) return true;
+            // Boru boşaltılabiliyorsa tekrar dene; peer de tıkalıysa src'yi durdur. Peer'in
+            // EPOLLOUT olayı boruyu boşaltıp okumayı sürdürür.
+            size_t before = dir.pipe_bytes;
+            drain_pipe(dir);
+            if (dir.pipe[0] != -1 && dir.pipe_bytes == before) {
+                dir.src->read_paused = true;
+                return true;
+            }
+        } else if (errno == EINVAL) {
+            fall_back_to_copy(dir);
+        } else {
+            return false;
+        }
+    }
+    // Kopyalama yoluna dönüldü; kalan veriyi o yoldan aktar
+    return copy_forward(dir);
+}
+
+bool TunnelSession::copy_forward(Direction& dir) {
+    while (true) {
+        flush_buffer(dir);
+        // Peer veriyi yeterince hızlı alamıyor: tampon yüksek su işaretine ulaştıysa src'yi durdur
+        if (dir.buffer.size() >= limits_.high_watermark || !dir.backlog.empty()) {
+            LOG_RATE_LIMITED(LOG_DEBUG, 10) << "Tünel: ID " << dir.src->id << " okuması durduruldu (tamponda "
+                                            << dir.buffer.size() << " byte)";
+            dir.src->read_paused = true;
+            return true;
+        }
+
+        ssize_t bytes_read = dir.buffer.read_from_fd(dir.src->socket_fd,
+                                                     limits_.high_watermark - dir.buffer.size());
+        if (bytes_read > 0) {
+            on_received(dir, bytes_read);
+            if (capture_) {
+                struct iovec iov[2];
+                int count = dir.buffer.tail_iov(bytes_read, iov);
+                capture_->append(&dir == &dirs_[0] ? 0 : 1, iov, count);
+            }
+            if (dir.framed && !scan_frames(dir)) {
+                LOG(LOG_WARN) << "Tünel: ID " << dir.src->id << " geçersiz mux çerçevesi gönderdi.";
+                return false;
+            }
+            LOG(LOG_TRACE) << "Tünel: ID " << dir.src->id << " -> ID " << dir.dst->id << " " << bytes_read << " byte";
+            continue;
+        }
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (capture_) capture_->close_direction(&dir == &dirs_[0] ? 0 : 1);
+        return false; // Okuma hatası veya bağlantı kapanması
+    }
+}
+
+bool TunnelSession::forward_from(ClientInfo& src) {
+    if (closed_ || src.read_paused) return true;
+    Direction& dir = direction_from(src);
+    if (dir.broken) {
+        LOG(LOG_WARN) << "Tünel: ID " << src.id << " geçersiz mux çerçevesi gönderdi.";
+        return false;
+    }
+    bool open = dir.pipe[0] != -1 ? splice_forward(dir) : copy_forward(dir);
+    dir.stats->queued_bytes.store(pending_bytes(dir), std::memory_order_relaxed);
+    return open;
+}
+
+void TunnelSession::on_writable(ClientInfo& dst) {
+    if (closed_) return;
+    Direction& dir = direction_from(peer_of(dst));
+    if (dir.pipe[0] != -1) {
+        drain_pipe(dir);
+    } else {
+        flush_buffer(dir);
+    }
+    dir.stats->queued_bytes.store(pending_bytes(dir), std::memory_order_relaxed);
+    // Okuma, tampon düşük su işaretine inince sürdürülür; aradaki fark, her küçük
+    // boşalmada durdur/başlat (EPOLL_CTL_MOD) salınımını önler.
+    if (pending_bytes(dir) <= limits_.low_watermark) {
+        resume_reading(*dir.src);
+    }
+}
+
+// Kenar tetiklemeli sokette durdurulan okumayı yeniden başlatır. EPOLL_CTL_MOD hazır olma
+// durumunu yeniden değerlendirir; sokette veri varsa bir sonraki turda EPOLLIN üretilir.
+void TunnelSession::resume_reading(ClientInfo& client) {
+    if (!client.read_paused) return;
+    client.read_paused = false;
+    if (client.socket_fd < 0) return;
+    loop_.modify(client.socket_fd, CLIENT_EVENTS);
+}
+
+uint64_t TunnelSession::received_from(const ClientInfo& src) {
+    return direction_from(src).received;
+}
+
+void TunnelSession::push(ClientInfo& src, const char* data, size_t len) {
+    if (closed_ || len == 0) return;
+    Direction& dir = direction_from(src);
+    on_received(dir, len);
+    if (capture_) capture_->append(&dir == &dirs_[0] ? 0 : 1, data, len);
+    if (dir.framed) {
+        // Çerçeveler tampondan geçmelidir; sığmayan kısım tampon boşaldıkça alınır
+        dir.backlog.append(data, len);
+        flush_buffer(dir);
+    } else if (dir.pipe[0] == -1 && dir.buffer.free_space() >= len) {
+        dir.buffer.write(data, len);
+        flush_buffer(dir);
+    } else {
+        // Boru boşken çıkış tamponu borudan önce gönderildiği için sıra korunur
+        queue_send(*dir.dst, data, len);
+        on_sent(dir, len);
+    }
+    dir.stats->queued_bytes.store(pending_bytes(dir), std::memory_order_relaxed);
+}
+
+bool TunnelSession::send_urgent(ClientInfo& dst, const char* data, size_t len) {
+    Direction& dir = direction_from(peer_of(dst));
+    if (closed_ || !dir.framed) return queue_send(dst, data, len);
+    dir.urgent.append(data, len);
+    flush_buffer(dir);
+    dir.stats->queued_bytes.store(pending_bytes(dir), std::memory_order_relaxed);
+    return dst.socket_fd >= 0;
+}
+
+std::string TunnelSession::take_control(const ClientInfo& src) {
+    std::string commands;
+    commands.swap(direction_from(src).control);
+    return commands;
+}
+
+// Kapanışta çerçeveli yönü komut moduna bırakır. dst'ye yarısı gönderilmiş çerçeve sıfırla
+// tamamlanır, ardından bekleyen kontrol çerçeveleri ve MUX_RESET gider. src'den alınıp henüz
+// çözülmemiş veri (ve yarısı alınmış çerçevenin atlanacak kalanı) src'nin komut modu çözücüsüne
+// devredilir; src'den çıkarılmış, henüz işlenmemiş komutlar komut tamponuna eklenir.
+void TunnelSession::finish_framing(Direction& dir) {
+    while (!dir.frame_ends.empty() && dir.frame_ends.front() <= dir.sent) dir.frame_ends.pop_front();
+    std::string tail;
+    if (!dir.frame_ends.empty()) tail.assign(dir.frame_ends.front() - dir.sent, '\0');
+    tail += dir.urgent;
+    char reset[MUX_HEADER_SIZE];
+    encode_mux_header(MUX_CHANNEL_CONTROL, MUX_RESET, 0, reset);
+    tail.append(reset, sizeof(reset));
+    queue_send(*dir.dst, tail.data(), tail.size());
+
+    uint64_t buffered_to = dir.sent + dir.buffer.size();
+    std::string unparsed;
+    if (dir.scan_at < buffered_to) {
+        unparsed.resize(buffered_to - dir.scan_at);
+        dir.buffer.peek(dir.scan_at - dir.sent, &unparsed[0], unparsed.size());
+    }
+    unparsed += dir.backlog;
+    uint64_t skip = dir.scan_at > buffered_to ? dir.scan_at - buffered_to : 0;
+    size_t dropped = std::min<uint64_t>(skip, unparsed.size());
+    unparsed.erase(0, dropped);
+    dir.src->mux_input.assign(unparsed.begin(), unparsed.end());
+    dir.src->mux_skip = skip - dropped;
+    dir.src->command_buffer.insert(dir.src->command_buffer.end(), dir.control.begin(), dir.control.end());
+
+    dir.frame_ends.clear();
+    dir.urgent.clear();
+    dir.backlog.clear();
+    dir.control.clear();
+}
+
+bool TunnelSession::reattach(ClientInfo& dst, uint64_t received_by_dst) {
+    if (closed_) return false;
+    Direction& dir = direction_from(peer_of(dst));
+    if (received_by_dst > dir.sent || !dir.buffer.rewind(dir.sent - received_by_dst)) return false;
+    dir.latency.rewind(dir.sent - received_by_dst);
+    dir.sent = received_by_dst;
+    dir.stats->queued_bytes.store(pending_bytes(dir), std::memory_order_relaxed);
+    return true;
+}
+
+void TunnelSession::export_direction(const ClientInfo& src, DirectionState* state) const {
+    const Direction& dir = dirs_[0].src == &src ? dirs_[0] : dirs_[1];
+    state->received = dir.received;
+    state->sent = dir.sent;
+    state->pipe[0] = dir.pipe[0];
+    state->pipe[1] = dir.pipe[1];
+    state->pipe_bytes = dir.pipe_bytes;
+    state->retained = dir.buffer.retained();
+    dir.buffer.copy_to(&state->buffered);
+    state->scan_at = dir.scan_at;
+    state->frame_ends.assign(dir.frame_ends.begin(), dir.frame_ends.end());
+    state->urgent = dir.urgent;
+    state->backlog = dir.backlog;
+}
+
+bool TunnelSession::restore_direction(ClientInfo& src, DirectionState& state) {
+    Direction& dir = direction_from(src);
+    close_pipe(dir);
+    dir.pipe[0] = state.pipe[0];
+    dir.pipe[1] = state.pipe[1];
+    dir.pipe_bytes = dir.pipe[0] != -1 ? state.pipe_bytes : 0;
+    state.pipe[0] = state.pipe[1] = -1;
+    dir.received = state.received;
+    dir.sent = state.sent;
+    dir.buffer.clear();
+    if (dir.buffer.write(state.buffered.data(), state.buffered.size()) != state.buffered.size()) return false;
+    dir.buffer.discard(state.retained);
+    dir.scan_at = state.scan_at;
+    dir.frame_ends.assign(state.frame_ends.begin(), state.frame_ends.end());
+    dir.urgent = state.urgent;
+    dir.backlog = state.backlog;
+    // Devralınan veri için gecikme devralma anından ölçülür
+    dir.latency.clear();
+    dir.latency.on_received(pending_bytes(dir), metrics_now_ns());
+    dir.stats->queued_bytes.store(pending_bytes(dir), std::memory_order_relaxed);
+    return true;
+}
+
+void TunnelSession::close() {
+    if (closed_) return;
+    closed_ = true;
+    for (Direction& dir : dirs_) {
+        if (scheduler_) scheduler_->remove(dir.flow);
+        if (dir.framed) finish_framing(dir);
+        close_pipe(dir);
+        dir.buffer.clear();
+        dir.latency.clear();
+        dir.stats->queued_bytes.store(0, std::memory_order_relaxed);
+        resume_reading(*dir.src);
+    }
+    capture_.reset();
+    relay_metrics.close_tunnel(metrics_);
+}
@@ -0,0 +1,230 @@
+#include "uring_queue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return (int)::syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void* map_ring(int fd, size_t size, off_t offset) {
+    void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+UringQueue::UringQueue(unsigned entries)
+    : ring_fd_(-1), flags_(0), sq_ring_(nullptr), sq_ring_size_(0), cq_ring_(nullptr), cq_ring_size_(0),
+      sqes_(nullptr), sqes_size_(0), sqe_tail_(0) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = entries * 4;
+    ring_fd_ = sys_io_uring_setup(entries, &params);
+    if (ring_fd_ < 0 && errno == EINVAL) {
+        // SINGLE_ISSUER/DEFER_TASKRUN 6.1 öncesi çekirdeklerde yok; bunlar yalnızca iyileştirme
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        ring_fd_ = sys_io_uring_setup(entries, &params);
+    }
+    if (ring_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+    }
+    flags_ = params.flags;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = map_ring(ring_fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ && (params.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq_ring_ = sq_ring_;
+    } else if (sq_ring_) {
+        cq_ring_ = map_ring(ring_fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map_ring(ring_fd_, sqes_size_, IORING_OFF_SQES));
+    if (!sq_ring_ || !cq_ring_ || !sqes_) {
+        int err = errno;
+        release();
+        throw std::system_error(err, std::generic_category(), "io_uring mmap");
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    // SQ dizisi birebir eşlenir: i. yuva i. SQE'yi gösterir
+    unsigned* sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) sq_array[i] = i;
+    sqe_tail_ = *sq_tail_;
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+UringQueue::~UringQueue() {
+    release();
+}
+
+void UringQueue::release() {
+    if (sqes_) ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) ::munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+    sqes_ = nullptr;
+    cq_ring_ = sq_ring_ = nullptr;
+    ring_fd_ = -1;
+}
+
+bool UringQueue::probe(std::string* reason) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(4, &params);
+    if (fd < 0) {
+        if (reason) *reason = std::string("io_uring_setup: ") + strerror(errno);
+        return false;
+    }
+
+    const unsigned op_count = 256;
+    std::vector<char> storage(sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    int ret = sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, op_count);
+    int err = errno;
+    ::close(fd);
+    if (ret < 0) {
+        if (reason) *reason = std::string("IORING_REGISTER_PROBE: ") + strerror(err);
+        return false;
+    }
+
+    // Çok atışlı recv ve sağlanan arabellek halkaları 6.0 ile geldi; bayraklar sınanamadığı
+    // için aynı sürümde eklenen SEND_ZC işlemi 6.0+ göstergesi olarak kullanılır.
+    const struct { int op; const char* name; } required[] = {
+        {IORING_OP_ACCEPT, "ACCEPT"},
+        {IORING_OP_RECV, "RECV"},
+        {IORING_OP_SEND, "SEND"},
+        {IORING_OP_POLL_ADD, "POLL_ADD"},
+        {IORING_OP_ASYNC_CANCEL, "ASYNC_CANCEL"},
+        {IORING_OP_SEND_ZC, "SEND_ZC (çekirdek 6.0+)"},
+    };
+    for (const auto& r : required) {
+        if (r.op > probe->last_op || !(probe->ops[r.op].flags & IO_URING_OP_SUPPORTED)) {
+            if (reason) *reason = std::string("desteklenmeyen işlem: ") + r.name;
+            return false;
+        }
+    }
+    return true;
+}
+
+io_uring_sqe* UringQueue::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+        submit();
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int UringQueue::submit_and_wait(unsigned wait_nr) {
+    unsigned to_submit = sqe_tail_ - *sq_tail_;
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+    unsigned enter_flags = 0;
+    // DEFER_TASKRUN kipinde tamamlanmalar yalnızca GETEVENTS ile işlenir
+    if (wait_nr > 0 || (flags_ & IORING_SETUP_DEFER_TASKRUN)) enter_flags |= IORING_ENTER_GETEVENTS;
+    if (to_submit == 0 && enter_flags == 0) return 0;
+
+    int ret;
+    do {
+        ret = sys_io_uring_enter(ring_fd_, to_submit, wait_nr, enter_flags);
+    } while (ret < 0 && errno == EINTR);
+    return ret < 0 ? -errno : ret;
+}
+
+ProvidedBufferRing::ProvidedBufferRing(UringQueue& queue, uint16_t group_id, unsigned count, unsigned buffer_size)
+    : queue_(queue), group_id_(group_id), count_(count), buffer_size_(buffer_size), ring_(nullptr),
+      ring_size_(count * sizeof(io_uring_buf)), buffers_(nullptr), buffers_size_((size_t)count * buffer_size),
+      local_tail_(0), in_use_(0) {
+    void* ring = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "buffer ring mmap");
+    }
+    ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+    // Arabellek belleği yalnızca kullanıldıkça fiziksel belleğe yansır
+    void* buffers = ::mmap(nullptr, buffers_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) {
+        int err = errno;
+        ::munmap(ring_, ring_size_);
+        throw std::system_error(err, std::generic_category(), "buffer mmap");
+    }
+    buffers_ = static_cast<char*>(buffers);
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring_);
+    reg.ring_entries = count;
+    reg.bgid = group_id;
+    if (sys_io_uring_register(queue_.ring_fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        ::munmap(buffers_, buffers_size_);
+        ::munmap(ring_, ring_size_);
+        throw std::system_error(err, std::generic_category(), "IORING_REGISTER_PBUF_RING");
+    }
+
+    for (unsigned bid = 0; bid < count; ++bid) add_buffer((uint16_t)bid);
+    publish();
+}
+
+ProvidedBufferRing::~ProvidedBufferRing() {
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = group_id_;
+    sys_io_uring_register(queue_.ring_fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    ::munmap(buffers_, buffers_size_);
+    ::munmap(ring_, ring_size_);
+}
+
+void ProvidedBufferRing::recycle(uint16_t bid) {
+    add_buffer(bid);
+    --in_use_;
+}
+
+void ProvidedBufferRing::add_buffer(uint16_t bid) {
+    // Yalnızca addr/len/bid yazılır: ilk girdinin 'resv' alanı halkanın tail sayacıdır.
+    // Bazı uapi başlıklarında __DECLARE_FLEX_ARRAY C++'ta 'bufs' dizisini 8 byte kaydırdığından
+    // halka doğrudan io_uring_buf dizisi olarak indekslenir.
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(ring_) + (local_tail_ & (count_ - 1));
+    buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+    buf->len = buffer_size_;
+    buf->bid = bid;
+    ++local_tail_;
+}
+
+void ProvidedBufferRing::publish() {
+    __atomic_store_n(&ring_->tail, local_tail_, __ATOMIC_RELEASE);
+}
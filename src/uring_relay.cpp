@@ -0,0 +1,421 @@
+#include "uring_relay.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "logger.h"
+
+// SQ halkası boyutu; tur başına hazırlanabilecek işlem sayısını sınırlar (dolarsa ara gönderim yapılır)
+static const unsigned QUEUE_ENTRIES = 1024;
+// Sağlanan arabellek havuzu: 1024 x 64 KB. Bellek yalnızca kullanıldıkça fiziksel karşılık bulur.
+static const unsigned BUFFER_COUNT = 1024;
+static const unsigned BUFFER_SIZE = 64 * 1024;
+static const uint16_t BUFFER_GROUP = 0;
+// Tek zincirde birbirine bağlanan en fazla send sayısı
+static const unsigned MAX_LINKED_SENDS = 16;
+// Tanımlayıcılar tükendiğinde accept'in yeniden kurulma gecikmesi
+static const long ACCEPT_RETRY_NS = 100 * 1000 * 1000;
+
+UringRelay::UringRelay(int listen_fd, const TunnelLimits& limits, UringRelayHandlers handlers)
+    : listen_fd_(listen_fd), limits_(limits), handlers_(std::move(handlers)), queue_(QUEUE_ENTRIES),
+      buffers_(queue_, BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE), running_(false), recycled_(false) {
+    accept_retry_delay_.tv_sec = 0;
+    accept_retry_delay_.tv_nsec = ACCEPT_RETRY_NS;
+}
+
+UringRelay::~UringRelay() = default;
+
+// user_data düzeni: [işlem:8][kuşak:8][arabellek:16][fd:32]
+uint64_t UringRelay::make_user_data(Op op, uint8_t generation, uint16_t bid, int fd) {
+    return ((uint64_t)op << 56) | ((uint64_t)generation << 48) | ((uint64_t)bid << 32) | (uint32_t)fd;
+}
+
+UringRelay::Conn* UringRelay::find_conn(int fd, uint8_t generation) {
+    if (fd < 0 || (size_t)fd >= conns_.size() || !conns_[fd]) return nullptr;
+    return conns_[fd]->generation == generation ? conns_[fd].get() : nullptr;
+}
+
+UringRelay::Conn* UringRelay::conn_for(uint64_t user_data) {
+    return find_conn((int)(uint32_t)user_data, (uint8_t)(user_data >> 48));
+}
+
+UringRelay::Conn* UringRelay::conn_of(const ClientInfo& client) {
+    int fd = client.socket_fd;
+    if (fd < 0 || (size_t)fd >= conns_.size() || !conns_[fd]) return nullptr;
+    return conns_[fd]->client.get() == &client ? conns_[fd].get() : nullptr;
+}
+
+UringRelay::Conn* UringRelay::peer_of(const Conn& conn) {
+    if (conn.peer_fd < 0 || (size_t)conn.peer_fd >= conns_.size()) return nullptr;
+    return conns_[conn.peer_fd].get();
+}
+
+void UringRelay::arm_accept() {
+    io_uring_sqe* sqe = queue_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC; // Soketler bloklayan kalır: io_uring beklemeyi kendisi yapar
+    sqe->user_data = make_user_data(OP_ACCEPT, 0, 0, listen_fd_);
+}
+
+// io_uring accept'i önce tanımlayıcı ayırır: tablo doluyken kuyruk boş olsa da hemen EMFILE döner.
+// Hemen yeniden kurmak döngüyü boşa döndürür; tanımlayıcı serbest kalması için kısa süre beklenir.
+void UringRelay::arm_accept_retry() {
+    io_uring_sqe* sqe = queue_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&accept_retry_delay_;
+    sqe->len = 1;
+    sqe->user_data = make_user_data(OP_ACCEPT_RETRY, 0, 0, listen_fd_);
+}
+
+void UringRelay::arm_recv(Conn& conn) {
+    if (conn.recv_armed || conn.client->read_paused || conn.client->socket_fd < 0) return;
+    io_uring_sqe* sqe = queue_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffers_.group_id();
+    sqe->user_data = make_user_data(OP_RECV, conn.generation, 0, conn.fd);
+    conn.recv_armed = true;
+    conn.starved = false;
+}
+
+void UringRelay::cancel_recv(Conn& conn) {
+    if (!conn.recv_armed) return;
+    io_uring_sqe* sqe = queue_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(OP_RECV, conn.generation, 0, conn.fd);
+    sqe->user_data = make_user_data(OP_CANCEL, conn.generation, 0, conn.fd);
+    // recv_armed, iptal edilen recv'in son CQE'si geldiğinde temizlenir
+}
+
+void UringRelay::arm_poll_out(Conn& conn) {
+    if (conn.poll_armed) return;
+    io_uring_sqe* sqe = queue_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = conn.fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = make_user_data(OP_POLL_OUT, conn.generation, 0, conn.fd);
+    conn.poll_armed = true;
+}
+
+void UringRelay::mark_dirty(Conn& conn) {
+    if (conn.dirty) return;
+    conn.dirty = true;
+    dirty_.emplace_back(conn.fd, conn.generation);
+}
+
+// Bekleyen parçaları tek bir bağlı send zinciri olarak gönderir. Zincirdeki işlemler sırayla
+// yürütülür; bir önceki zincir tamamlanmadan yenisi kurulmaz, böylece bayt sırası korunur.
+void UringRelay::submit_sends(Conn& dst) {
+    if (dst.sends_in_flight > 0 || dst.send_queue.empty()) return;
+    // Kontrol mesajları (TUNNEL_ACTIVE ve tünel öncesi biriken veri) tünel verisinden önce gider
+    if (!dst.client->output_buffer.empty()) {
+        if (!flush_output(*dst.client)) return; // Hata kendi recv'inde algılanır
+        if (!dst.client->output_buffer.empty()) {
+            arm_poll_out(dst);
+            return;
+        }
+    }
+
+    unsigned count = std::min<size_t>(dst.send_queue.size(), MAX_LINKED_SENDS);
+    for (unsigned i = 0; i < count; ++i) {
+        const Chunk& chunk = dst.send_queue[i];
+        io_uring_sqe* sqe = queue_.get_sqe();
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = dst.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffers_.buffer(chunk.bid));
+        sqe->len = chunk.len;
+        // MSG_WAITALL: kısmi gönderimler çekirdek içinde tamamlanır
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        if (i + 1 < count) sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = make_user_data(OP_SEND, dst.generation, chunk.bid, dst.fd);
+        ++dst.sends_in_flight;
+    }
+}
+
+// Henüz çekirdeğe verilmemiş parçaları atar; çekirdekteki parçalar tamamlanınca geri döner
+void UringRelay::drop_queued(Conn& dst) {
+    while (dst.send_queue.size() > dst.sends_in_flight) {
+        const Chunk& chunk = dst.send_queue.back();
+        dst.pending_bytes -= chunk.len;
+        buffers_.recycle(chunk.bid);
+        dst.send_queue.pop_back();
+        recycled_ = true;
+    }
+}
+
+void UringRelay::disconnect(Conn& conn) {
+    if (conn.client->socket_fd < 0) return;
+    handlers_.on_disconnect(*conn.client);
+}
+
+void UringRelay::add_client(const std::shared_ptr<ClientInfo>& client) {
+    int fd = client->socket_fd;
+    if ((size_t)fd >= conns_.size()) {
+        conns_.resize(fd + 1);
+        generations_.resize(fd + 1, 0);
+    }
+    std::unique_ptr<Conn> conn(new Conn());
+    conn->client = client;
+    conn->fd = fd;
+    conn->generation = ++generations_[fd];
+    conns_[fd] = std::move(conn);
+    arm_recv(*conns_[fd]);
+}
+
+void UringRelay::close_client(ClientInfo& client) {
+    Conn* conn = conn_of(client);
+    if (conn) {
+        drop_queued(*conn);
+        // Soketteki tüm işlemleri iptal et; geç gelen CQE'ler kuşak farkından tanınır ve
+        // taşıdıkları arabellekler havuza döner
+        io_uring_sqe* sqe = queue_.get_sqe();
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = conn->fd;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = make_user_data(OP_CANCEL, conn->generation, 0, conn->fd);
+            queue_.submit(); // fd numarası kapatılmadan önce iptal çekirdeğe ulaşmalı
+        }
+        graveyard_.push_back(std::move(conns_[conn->fd]));
+    }
+    ::close(client.socket_fd);
+    client.socket_fd = -1;
+}
+
+void UringRelay::open_tunnel(ClientInfo& a, ClientInfo& b) {
+    Conn* conn_a = conn_of(a);
+    Conn* conn_b = conn_of(b);
+    if (!conn_a || !conn_b) return;
+    conn_a->peer_fd = conn_b->fd;
+    conn_b->peer_fd = conn_a->fd;
+
+    std::shared_ptr<TunnelMetrics> metrics = relay_metrics.open_tunnel(a.id, b.id);
+    conn_a->tunnel_metrics = metrics;
+    conn_b->tunnel_metrics = metrics;
+    conn_b->inbound_stats = &metrics->dirs[0];
+    conn_a->inbound_stats = &metrics->dirs[1];
+    conn_a->latency = ForwardLatencyTracker();
+    conn_b->latency = ForwardLatencyTracker();
+}
+
+// Bağlantının tünel ölçümlerini bırakır; oturum ölçümleri iki uç da bırakınca kapanır
+void UringRelay::release_metrics(Conn& conn) {
+    if (!conn.tunnel_metrics) return;
+    relay_metrics.close_tunnel(conn.tunnel_metrics);
+    conn.tunnel_metrics.reset();
+    conn.inbound_stats = nullptr;
+    conn.latency.clear();
+}
+
+void UringRelay::close_tunnel(ClientInfo& client) {
+    Conn* conn = conn_of(client);
+    if (!conn) return;
+    Conn* peer = peer_of(*conn);
+    conn->peer_fd = -1;
+    drop_queued(*conn);
+    release_metrics(*conn);
+    if (peer && peer->peer_fd == conn->fd) {
+        peer->peer_fd = -1;
+        drop_queued(*peer);
+        release_metrics(*peer);
+        resume_reading(*peer->client);
+    }
+    resume_reading(client);
+}
+
+void UringRelay::resume_reading(ClientInfo& client) {
+    if (!client.read_paused) return;
+    client.read_paused = false;
+    Conn* conn = conn_of(client);
+    if (conn) arm_recv(*conn);
+}
+
+void UringRelay::watch_output(ClientInfo& client) {
+    Conn* conn = conn_of(client);
+    if (conn) arm_poll_out(*conn);
+}
+
+void UringRelay::dispatch(const io_uring_cqe& cqe) {
+    switch ((Op)(cqe.user_data >> 56)) {
+    case OP_ACCEPT:   on_accept(cqe); break;
+    case OP_RECV:     on_recv(cqe); break;
+    case OP_SEND:     on_send(cqe); break;
+    case OP_POLL_OUT: on_poll_out(cqe); break;
+    case OP_CANCEL:   break;
+    case OP_ACCEPT_RETRY:
+        if (running_) arm_accept();
+        break;
+    }
+}
+
+void UringRelay::on_accept(const io_uring_cqe& cqe) {
+    if (cqe.res >= 0) {
+        handlers_.on_accept(cqe.res);
+    } else if (cqe.res != -ECANCELED) {
+        LOG_RATE_LIMITED(LOG_WARN, 5) << "Bağlantı kabul (accept) hatası: " << strerror(-cqe.res);
+        // Kuyrukta kalan bağlantılar boşaltılmazsa yeniden kurulan accept aynı hatayla hemen döner
+        if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+            if (handlers_.on_accept_exhausted) handlers_.on_accept_exhausted();
+            if (!(cqe.flags & IORING_CQE_F_MORE) && running_) arm_accept_retry();
+            return;
+        }
+    }
+    // Çok atışlı accept hata veya taşma nedeniyle sonlandıysa yeniden kur
+    if (!(cqe.flags & IORING_CQE_F_MORE) && running_) arm_accept();
+}
+
+void UringRelay::on_recv(const io_uring_cqe& cqe) {
+    bool has_buffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t bid = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (has_buffer) buffers_.mark_used();
+
+    Conn* conn = conn_for(cqe.user_data);
+    if (!conn) {
+        // Kapatılmış bağlantıdan geç gelen veri
+        if (has_buffer) { buffers_.recycle(bid); recycled_ = true; }
+        return;
+    }
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+    if (!more) conn->recv_armed = false;
+
+    if (cqe.res > 0 && has_buffer) {
+        Conn* peer = peer_of(*conn);
+        if (peer && conn->client->status == ClientStatus::VncTunnelling) {
+            // Arabellek kopyalanmadan karşı ucun gönderim kuyruğuna geçer
+            peer->send_queue.push_back({bid, (uint32_t)cqe.res});
+            peer->pending_bytes += cqe.res;
+            if (peer->inbound_stats) {
+                metrics_add(peer->inbound_stats->chunks, 1);
+                peer->inbound_stats->queued_bytes.store(peer->pending_bytes, std::memory_order_relaxed);
+                peer->latency.on_received(cqe.res, metrics_now_ns());
+            }
+            mark_dirty(*peer);
+            LOG(LOG_TRACE) << "Tünel: ID " << conn->client->id << " -> ID " << peer->client->id << " "
+                           << cqe.res << " byte (io_uring)";
+            if (peer->pending_bytes >= limits_.high_watermark && !conn->client->read_paused) {
+                conn->client->read_paused = true;
+                cancel_recv(*conn);
+            }
+        } else {
+            bool keep_reading = handlers_.on_command_data(*conn->client, buffers_.buffer(bid), cqe.res);
+            buffers_.recycle(bid);
+            recycled_ = true;
+            if (!keep_reading) cancel_recv(*conn);
+        }
+    } else if (cqe.res == -ENOBUFS) {
+        // Havuzdaki tüm arabellekler başka tünellerde bekliyor; arabellek dönünce yeniden kurulur
+        LOG_RATE_LIMITED(LOG_DEBUG, 10) << "io_uring: arabellek havuzu boş (Soket: " << conn->fd << ")";
+        if (!conn->starved) {
+            conn->starved = true;
+            starved_.emplace_back(conn->fd, conn->generation);
+        }
+        return;
+    } else if (cqe.res != -ECANCELED) {
+        // 0: bağlantı kapandı; diğer negatif değerler okuma hatası
+        if (has_buffer) { buffers_.recycle(bid); recycled_ = true; }
+        disconnect(*conn);
+        return;
+    }
+
+    if (!conn->recv_armed && conn->client->socket_fd >= 0) arm_recv(*conn);
+}
+
+void UringRelay::on_send(const io_uring_cqe& cqe) {
+    uint16_t bid = (uint16_t)(cqe.user_data >> 32);
+    buffers_.recycle(bid);
+    recycled_ = true;
+
+    Conn* dst = conn_for(cqe.user_data);
+    if (!dst || dst->send_queue.empty()) return;
+    Chunk chunk = dst->send_queue.front();
+    dst->send_queue.pop_front();
+    --dst->sends_in_flight;
+    dst->pending_bytes -= chunk.len;
+
+    if (cqe.res != (int)chunk.len) {
+        // Hata veya kısmi gönderim (MSG_WAITALL ile yalnızca hata durumunda). Zincirin kalanı
+        // -ECANCELED ile döner; bağlantı kapatılır.
+        disconnect(*dst);
+        return;
+    }
+    if (dst->inbound_stats) {
+        metrics_add(dst->inbound_stats->bytes, chunk.len);
+        dst->inbound_stats->queued_bytes.store(dst->pending_bytes, std::memory_order_relaxed);
+        dst->latency.on_sent(chunk.len, metrics_now_ns(), dst->tunnel_metrics->forward_latency);
+    }
+    if (dst->sends_in_flight == 0) mark_dirty(*dst);
+
+    // Karşı uca giden kuyruk düşük su işaretine indiyse kaynaktan okumayı sürdür
+    Conn* src = peer_of(*dst);
+    if (src && src->client->read_paused && dst->pending_bytes <= limits_.low_watermark) {
+        resume_reading(*src->client);
+    }
+}
+
+void UringRelay::on_poll_out(const io_uring_cqe& cqe) {
+    Conn* conn = conn_for(cqe.user_data);
+    if (!conn) return;
+    conn->poll_armed = false;
+    if (!flush_output(*conn->client)) {
+        disconnect(*conn);
+        return;
+    }
+    if (!conn->client->output_buffer.empty()) {
+        arm_poll_out(*conn);
+    } else {
+        mark_dirty(*conn);
+    }
+}
+
+void UringRelay::after_batch() {
+    for (const auto& entry : dirty_) {
+        Conn* conn = find_conn(entry.first, entry.second);
+        if (!conn) continue;
+        conn->dirty = false;
+        submit_sends(*conn);
+    }
+    dirty_.clear();
+
+    if (recycled_) {
+        buffers_.publish();
+        recycled_ = false;
+        std::vector<std::pair<int, uint8_t>> starved;
+        starved.swap(starved_);
+        for (const auto& entry : starved) {
+            Conn* conn = find_conn(entry.first, entry.second);
+            if (conn && conn->starved) arm_recv(*conn);
+        }
+    }
+    graveyard_.clear();
+}
+
+void UringRelay::run() {
+    running_ = true;
+    arm_accept();
+    while (running_) {
+        int ret = queue_.submit_and_wait(1);
+        if (ret < 0 && ret != -EBUSY && ret != -EAGAIN) {
+            LOG(LOG_ERROR) << "io_uring_enter hatası: " << strerror(-ret);
+            break;
+        }
+        queue_.for_each_completion([this](const io_uring_cqe& cqe) { dispatch(cqe); });
+        after_batch();
+    }
+}
@@ -0,0 +1,261 @@
+// Capture: kayıtların parçalara bölünerek yazılması ve sırayla geri okunması, zamana göre arama,
+// kayıt sınırı, kapanmadan kalan dosyada dizinin parçalardan yeniden kurulması, hatalı dosyalar
+
+#include "capture.h"
+#include "test_common.h"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+static std::string directory;
+
+static std::string temp_path(const std::string& name) {
+    return directory + "/" + name;
+}
+
+// Yazma arka planda sürer: dosya son eki yazılınca kapanmış sayılır
+static bool wait_closed(const std::string& path) {
+    for (int i = 0; i < 500; ++i) {
+        try {
+            CaptureReader reader(path);
+            if (reader.indexed()) return true;
+        } catch (const std::runtime_error&) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// Okuyucunun verdiği yön başına veri ve kapanış kayıtları
+struct Replay {
+    std::string data[2];
+    int closes[2] = {0, 0};
+    size_t records = 0;
+    bool ordered = true;
+};
+
+static Replay replay(const CaptureReader& reader, CaptureCursor cursor = CaptureCursor()) {
+    Replay out;
+    CaptureRecord record;
+    uint64_t last_ns = 0;
+    while (reader.next(&cursor, &record)) {
+        ++out.records;
+        if (record.time_ns < last_ns) out.ordered = false;
+        last_ns = record.time_ns;
+        if (record.flags & CAPTURE_FLAG_CLOSE) {
+            ++out.closes[record.direction];
+        } else {
+            out.data[record.direction].append(record.data, record.length);
+        }
+    }
+    return out;
+}
+
+// Küçük parçalı kayda iki yönde farklı boylarda veri yazılır: parçayı aşan veri bölünür, iovec
+// parçaları birleşir; okuyucu her yönün verisini yazıldığı sırayla ve kapanışlarıyla verir
+static void test_round_trip() {
+    const std::string path = temp_path("round.rcap");
+    std::string sent[2];
+    {
+        CaptureWriter writer(path, "relay a=100001 b=100002", 0, 4096);
+        CHECK(writer.path() == path);
+        size_t sizes[] = {1, 7, 100, 3000, 4096, 10000, 64};
+        for (int round = 0; round < 3; ++round) {
+            for (size_t size : sizes) {
+                std::string data = pattern(sent[0].size(), size);
+                writer.append(0, data.data(), data.size());
+                sent[0] += data;
+                std::string first = pattern(sent[1].size() + 3, size / 2);
+                std::string second = pattern(sent[1].size() + 3 + size / 2, size - size / 2);
+                struct iovec iov[2] = {{&first[0], first.size()}, {&second[0], second.size()}};
+                writer.append(1, iov, 2);
+                sent[1] += first + second;
+            }
+        }
+        writer.append(0, "", 0); // Boş veri kayıt üretmez
+        writer.close_direction(1);
+        writer.close_direction(0);
+        CHECK(writer.dropped_bytes() == 0);
+    }
+    CHECK(wait_closed(path));
+
+    CaptureReader reader(path);
+    CHECK(reader.indexed());
+    CHECK(reader.label() == "relay a=100001 b=100002");
+    CHECK(reader.header().chunk_size == 4096);
+    CHECK(reader.chunk_count() > 10);
+    CHECK(reader.total_bytes(0) == sent[0].size());
+    CHECK(reader.total_bytes(1) == sent[1].size());
+    CHECK(reader.dropped_bytes() == 0);
+    for (size_t i = 1; i < reader.chunk_count(); ++i) {
+        CHECK(reader.chunk(i).first_ns >= reader.chunk(i - 1).last_ns);
+        CHECK(reader.chunk(i).used <= 4096);
+    }
+    Replay out = replay(reader);
+    CHECK(out.ordered);
+    CHECK(out.data[0] == sent[0]);
+    CHECK(out.data[1] == sent[1]);
+    CHECK(out.closes[0] == 1 && out.closes[1] == 1);
+    ::unlink(path.c_str());
+}
+
+// Arama istenen anı içeren parçanın başına konumlanır; sonraki kayıtlar oradan okunur
+static void test_seek() {
+    const std::string path = temp_path("seek.rcap");
+    {
+        CaptureWriter writer(path, "seek", 0, 4096);
+        for (int i = 0; i < 40; ++i) {
+            std::string data = pattern(i * 2000, 2000);
+            writer.append(0, data.data(), data.size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    CHECK(wait_closed(path));
+
+    CaptureReader reader(path);
+    CHECK(reader.duration_ns() >= 40 * 1000000ull);
+    CaptureCursor start = reader.seek(0);
+    CHECK(start.chunk == 0);
+    // Ortadaki parçanın son anına aranırsa o parçadan başlanır
+    size_t middle = reader.chunk_count() / 2;
+    CaptureCursor cursor = reader.seek(reader.chunk(middle).last_ns);
+    CHECK(cursor.chunk == middle);
+    Replay tail = replay(reader, cursor);
+    uint64_t offset = reader.chunk(middle).stream_offset[0];
+    CHECK(tail.data[0] == pattern(offset, 40 * 2000 - offset));
+    // Kaydın sonundan sonrası boştur
+    cursor = reader.seek(reader.duration_ns() + 1);
+    CaptureRecord record;
+    CHECK(!reader.next(&cursor, &record));
+    ::unlink(path.c_str());
+}
+
+// Sınırı aşacak veri yazılmaz ve atılan veri olarak sayılır
+static void test_limit() {
+    const std::string path = temp_path("limit.rcap");
+    {
+        CaptureWriter writer(path, "limit", 1000, 4096);
+        std::string data = pattern(0, 600);
+        writer.append(0, data.data(), data.size());
+        writer.append(1, data.data(), data.size());
+        writer.append(1, data.data(), 400);
+        CHECK(writer.dropped_bytes() == 600);
+    }
+    CHECK(wait_closed(path));
+    CaptureReader reader(path);
+    CHECK(reader.total_bytes(0) == 600);
+    CHECK(reader.total_bytes(1) == 400);
+    CHECK(reader.dropped_bytes() == 600);
+    Replay out = replay(reader);
+    CHECK(out.data[0] == pattern(0, 600));
+    CHECK(out.data[1] == pattern(0, 400));
+    ::unlink(path.c_str());
+}
+
+// Süreç kayıt kapanmadan sonlanmış gibi: son ek ve dizin yoksa parçalar taranır; yarım kalan
+// parçada durulur
+static void test_unclosed() {
+    const std::string path = temp_path("unclosed.rcap");
+    std::string sent;
+    {
+        CaptureWriter writer(path, "unclosed", 0, 4096);
+        for (int i = 0; i < 20; ++i) {
+            std::string data = pattern(sent.size(), 1500);
+            writer.append(0, data.data(), data.size());
+            sent += data;
+        }
+    }
+    CHECK(wait_closed(path));
+    size_t chunks;
+    uint64_t third_offset;
+    {
+        CaptureReader reader(path);
+        chunks = reader.chunk_count();
+        third_offset = reader.chunk(2).stream_offset[0];
+    }
+    CHECK(chunks > 3);
+
+    CHECK(::truncate(path.c_str(), CAPTURE_HEADER_SIZE + chunks * 4096) == 0);
+    {
+        CaptureReader reader(path);
+        CHECK(!reader.indexed());
+        CHECK(reader.chunk_count() == chunks);
+        CHECK(reader.total_bytes(0) == sent.size());
+        CHECK(replay(reader).data[0] == sent);
+    }
+    // Üçüncü parçanın yalnızca başlığı yazılmış
+    CHECK(::truncate(path.c_str(), CAPTURE_HEADER_SIZE + 2 * 4096 + sizeof(CaptureChunkHeader)) == 0);
+    {
+        CaptureReader reader(path);
+        CHECK(!reader.indexed());
+        CHECK(reader.chunk_count() == 2);
+        CHECK(reader.total_bytes(0) == third_offset);
+        CHECK(replay(reader).data[0] == sent.substr(0, third_offset));
+    }
+    ::unlink(path.c_str());
+}
+
+// Var olan dosyanın üzerine yazılmaz; kayıt olmayan veya kısa dosya okunmaz
+static void test_errors() {
+    const std::string path = temp_path("other.rcap");
+    std::string junk = pattern(0, 8192);
+    FILE* file = fopen(path.c_str(), "w");
+    CHECK(file != nullptr);
+    fwrite(junk.data(), 1, junk.size(), file);
+    fclose(file);
+
+    bool thrown = false;
+    try {
+        CaptureWriter writer(path, "exists");
+    } catch (const std::system_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    const std::string paths[] = {path, temp_path("missing.rcap")};
+    for (const std::string& bad : paths) {
+        thrown = false;
+        try {
+            CaptureReader reader(bad);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    CHECK(::truncate(path.c_str(), 100) == 0);
+    thrown = false;
+    try {
+        CaptureReader reader(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    ::unlink(path.c_str());
+}
+
+int main() {
+    char dir_template[] = "/tmp/capture_test_XXXXXX";
+    CHECK(mkdtemp(dir_template) != nullptr);
+    directory = dir_template;
+    test_round_trip();
+    test_seek();
+    test_limit();
+    test_unclosed();
+    test_errors();
+    ::rmdir(directory.c_str());
+    return test::finish("capture");
+}
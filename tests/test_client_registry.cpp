@@ -0,0 +1,151 @@
+// ClientRegistry: ID ayırma (benzersiz, bölüm içinde, aralık dolunca NO_CLIENT), serbest bırakma,
+// başka bölümün ID'leri ve devralınan istemciler
+
+#include "client_registry.h"
+#include "test_common.h"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+static std::shared_ptr<ClientInfo> make_client() {
+    return std::make_shared<ClientInfo>();
+}
+
+static void test_parse_client_id() {
+    ClientId id = NO_CLIENT;
+    CHECK(parse_client_id("123456", &id) && id == 123456);
+    CHECK(parse_client_id("999999", &id) && id == 999999);
+    CHECK(!parse_client_id("099999", &id)); // Aralık dışı
+    CHECK(!parse_client_id("12345", &id));
+    CHECK(!parse_client_id("1234567", &id));
+    CHECK(!parse_client_id("12a456", &id));
+}
+
+// Küçük bir bölüm tamamen doldurulur: her ID bir kez ve yalnızca bu bölümden verilir
+static void test_allocation_exhausts_partition() {
+    const uint32_t PARTITIONS = 1000; // Bölüm başına 900 ID
+    const uint32_t INDEX = 7;
+    ClientRegistry registry;
+    registry.set_partition(INDEX, PARTITIONS);
+    const size_t partition_size = ClientRegistry::ID_SPACE / PARTITIONS;
+
+    std::set<ClientId> ids;
+    std::vector<std::shared_ptr<ClientInfo>> clients;
+    for (size_t i = 0; i < partition_size; ++i) {
+        std::shared_ptr<ClientInfo> client = make_client();
+        ClientId id = registry.register_client(client);
+        CHECK(id != NO_CLIENT);
+        CHECK(client->id == id);
+        CHECK(registry.partition_of(id) == INDEX);
+        CHECK(ids.insert(id).second);
+        clients.push_back(client);
+    }
+    CHECK(registry.size() == partition_size);
+    CHECK(*ids.begin() == CLIENT_ID_MIN + INDEX * partition_size);
+    CHECK(*ids.rbegin() == CLIENT_ID_MIN + (INDEX + 1) * partition_size - 1);
+    CHECK(registry.register_client(make_client()) == NO_CLIENT); // Bölüm doldu
+
+    // Serbest kalan ID yeniden verilir; bulma ve silme aynı nesneyi döner
+    ClientId released = clients[123]->id;
+    CHECK(registry.find(released) == clients[123]);
+    CHECK(registry.remove(released) == clients[123]);
+    CHECK(registry.find(released) == nullptr);
+    CHECK(registry.remove(released) == nullptr);
+    CHECK(registry.size() == partition_size - 1);
+    std::shared_ptr<ClientInfo> again = make_client();
+    CHECK(registry.register_client(again) == released);
+    CHECK(registry.find(released) == again);
+    CHECK(registry.register_client(make_client()) == NO_CLIENT);
+
+    size_t visited = 0;
+    registry.for_each([&](const ClientInfo&) { ++visited; });
+    CHECK(visited == partition_size);
+}
+
+// Tüm aralıkta ayrılan ID'ler düzgün dağılır (sıralı değil) ve hepsi geçerlidir
+static void test_allocation_spread() {
+    ClientRegistry registry;
+    const size_t COUNT = 20000;
+    std::set<ClientId> ids;
+    size_t low_half = 0;
+    for (size_t i = 0; i < COUNT; ++i) {
+        ClientId id = registry.register_client(make_client());
+        CHECK(id >= CLIENT_ID_MIN && id <= CLIENT_ID_MAX);
+        CHECK(registry.partition_of(id) == 0);
+        ids.insert(id);
+        if (id < CLIENT_ID_MIN + ClientRegistry::ID_SPACE / 2) ++low_half;
+    }
+    CHECK(ids.size() == COUNT);
+    CHECK(low_half > COUNT * 45 / 100 && low_half < COUNT * 55 / 100);
+}
+
+// Başka bölümün ID'leri kaydedilir ama silinince bu bölümün boş listesine girmez
+static void test_remote() {
+    const uint32_t PARTITIONS = 1000;
+    ClientRegistry registry;
+    registry.set_partition(0, PARTITIONS);
+    const size_t partition_size = ClientRegistry::ID_SPACE / PARTITIONS;
+
+    ClientId remote_id = CLIENT_ID_MIN + 5 * partition_size + 3;
+    CHECK(registry.partition_of(remote_id) == 5);
+    std::shared_ptr<ClientInfo> remote = make_client();
+    CHECK(registry.register_remote(remote_id, remote));
+    CHECK(remote->id == remote_id);
+    CHECK(registry.find(remote_id) == remote);
+    CHECK(!registry.register_remote(remote_id, make_client()));        // Zaten kayıtlı
+    CHECK(!registry.register_remote(CLIENT_ID_MIN + 1, make_client())); // Bu bölüme ait
+    CHECK(!registry.register_remote(CLIENT_ID_MAX + 1, make_client()));
+    CHECK(registry.remove(remote_id) == remote);
+
+    for (size_t i = 0; i < partition_size; ++i) {
+        ClientId id = registry.register_client(make_client());
+        CHECK(id != NO_CLIENT && registry.partition_of(id) == 0);
+    }
+    CHECK(registry.register_client(make_client()) == NO_CLIENT);
+}
+
+// Kesintisiz yükseltmede devralınan ID'ler korunur ve yeni ayırmalarda verilmez
+static void test_adopt() {
+    const uint32_t PARTITIONS = 1000;
+    const uint32_t INDEX = 2;
+    const size_t partition_size = ClientRegistry::ID_SPACE / PARTITIONS;
+    const ClientId base = CLIENT_ID_MIN + INDEX * partition_size;
+    ClientRegistry registry;
+    registry.set_partition(INDEX, PARTITIONS);
+
+    std::vector<std::shared_ptr<ClientInfo>> adopted;
+    const ClientId kept_ids[] = {base, base + 10, base + partition_size - 1};
+    for (ClientId id : kept_ids) {
+        adopted.push_back(make_client());
+        adopted.back()->id = id;
+    }
+    adopted.push_back(make_client());
+    adopted.back()->id = base + 10; // Yinelenen
+    adopted.push_back(make_client());
+    adopted.back()->id = CLIENT_ID_MIN; // Başka bölüm
+    adopted.push_back(make_client());
+    adopted.back()->id = NO_CLIENT;
+    registry.adopt(adopted);
+    CHECK(adopted.size() == 3);
+    CHECK(registry.size() == 3);
+    for (ClientId id : kept_ids) CHECK(registry.find(id) != nullptr);
+
+    std::set<ClientId> ids;
+    for (size_t i = 0; i < partition_size - 3; ++i) {
+        ClientId id = registry.register_client(make_client());
+        CHECK(id != NO_CLIENT);
+        CHECK(id != kept_ids[0] && id != kept_ids[1] && id != kept_ids[2]);
+        CHECK(ids.insert(id).second);
+    }
+    CHECK(registry.register_client(make_client()) == NO_CLIENT);
+}
+
+int main() {
+    test_parse_client_id();
+    test_allocation_exhausts_partition();
+    test_allocation_spread();
+    test_remote();
+    test_adopt();
+    return test::finish("client_registry");
+}
@@ -0,0 +1,196 @@
+// Cluster: düğüm listesinin çözülmesi, iki düğüm arasında kanal açılması, proxy kontrol
+// çerçevelerinin karşı düğümde komutlara çevrilmesi, tünelde kredi pencereli ham veri, kapanış
+
+#include "cluster.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+// Boş bir TCP portu: çekirdeğin verdiği port bırakılıp düğüme verilir
+static int free_tcp_port() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, (struct sockaddr*)&address, sizeof(address));
+    socklen_t len = sizeof(address);
+    ::getsockname(fd, (struct sockaddr*)&address, &len);
+    ::close(fd);
+    return ntohs(address.sin_port);
+}
+
+// Proxy istemcinin relay tarafındaki ucu: test bu uçta relay rolündedir
+struct ProxyEnd {
+    int fd = -1;
+    ClientId id = NO_CLIENT;
+    std::string in;
+
+    // En fazla timeout_ms bekleyerek okunabilen veriyi in'e ekler; EOF'ta false
+    bool receive(int timeout_ms) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (::poll(&pfd, 1, timeout_ms) <= 0) return true;
+        char chunk[65536];
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n == 0) return false;
+        if (n > 0) in.append(chunk, n);
+        return true;
+    }
+
+    bool next_frame(ControlType* type, std::string* payload) {
+        for (int i = 0; i < 200; ++i) {
+            ControlFrame frame;
+            ssize_t used = parse_control_frame(in.data(), in.size(), &frame);
+            if (used > 0) {
+                *type = frame.type;
+                payload->assign(frame.payload, frame.length);
+                in.erase(0, used);
+                return true;
+            }
+            if (used < 0 || !receive(10)) return false;
+        }
+        return false;
+    }
+
+    void send_frame(ControlType type, const std::string& payload, const std::string& tail = "") {
+        char frame[CONTROL_HEADER_SIZE + CONTROL_MAX_PAYLOAD];
+        size_t length = encode_control_frame(type, payload.data(), payload.size(), frame, sizeof(frame));
+        std::string data = std::string(frame, length) + tail;
+        CHECK(::write(fd, data.data(), data.size()) == (ssize_t)data.size());
+    }
+};
+
+// Geçerli listeler sırayla çözülür; biçim hatası, boş liste ve geçersiz port reddedilir
+static void test_parse_peers() {
+    std::vector<ClusterPeer> peers;
+    CHECK(parse_cluster_peers("10.0.0.1:7000,10.0.0.2:7001", &peers));
+    CHECK(peers.size() == 2);
+    CHECK(peers[1].host == "10.0.0.2" && peers[1].port == 7001);
+    CHECK(!parse_cluster_peers("", &peers));
+    CHECK(!parse_cluster_peers("10.0.0.1", &peers));
+    CHECK(!parse_cluster_peers("10.0.0.1:0", &peers));
+    CHECK(!parse_cluster_peers("10.0.0.1:7000,relay:7001", &peers));
+}
+
+// Düğüm 1'deki A (200001), düğüm 0'daki B'ye (100001) bağlanır. Düğüm 1'de B'nin proxy'si,
+// düğüm 0'da A'nın proxy'si oluşur; relay'lerin proxy'lere yazdığı kontrol çerçeveleri karşı
+// tarafta proxy'nin komutları olarak görünür. Tünel açılınca iki yönde ham veri akar.
+static void test_channel() {
+    EventLoop loop;
+    std::vector<ClusterPeer> peers(2);
+    peers[0].host = peers[1].host = "127.0.0.1";
+    peers[0].port = free_tcp_port();
+    peers[1].port = free_tcp_port();
+
+    std::mutex mutex;
+    ProxyEnd proxies[2]; // Düğüm başına oluşturulan son proxy
+    auto factory = [&](int self) {
+        return [&, self](int fd, ClientId remote_id, int) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (proxies[self].fd >= 0) ::close(proxies[self].fd);
+            proxies[self].fd = fd;
+            proxies[self].id = remote_id;
+            proxies[self].in.clear();
+            return true;
+        };
+    };
+    Cluster node0(loop, 0, peers, factory(0));
+    Cluster node1(loop, 1, peers, factory(1));
+    CHECK(node1.node() == 1 && node1.size() == 2);
+    std::thread loop_thread([&]() { loop.run(); });
+
+    // Düğümler arası bağlantı kurulana kadar açılan kanallar kapanır (proxy EOF görür)
+    bool opened = false;
+    auto start = std::chrono::steady_clock::now();
+    while (!opened && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        CHECK(node1.connect_remote(0, 200001, 100001));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::lock_guard<std::mutex> lock(mutex);
+        opened = proxies[0].fd >= 0;
+    }
+    CHECK(opened);
+    ProxyEnd* a_proxy = &proxies[0]; // Düğüm 0'da A'nın proxy'si
+    ProxyEnd* b_proxy = &proxies[1]; // Düğüm 1'de B'nin proxy'si
+    CHECK(b_proxy->id == 100001);
+    CHECK(a_proxy->id == 200001);
+
+    if (opened) {
+        ControlType type;
+        std::string payload;
+        // Relay 1, B'nin proxy'sine A'nın isteğini bildirir -> düğüm 0'da A'nın proxy'si B'ye bağlanır
+        b_proxy->send_frame(CTRL_INCOMING, "200001");
+        CHECK(a_proxy->next_frame(&type, &payload));
+        CHECK(type == CTRL_CONNECT && payload == "100001");
+        // Relay 0'da B kabul etti -> düğüm 1'de B'nin proxy'si A'yı kabul eder
+        a_proxy->send_frame(CTRL_ACCEPTED, "100001");
+        CHECK(b_proxy->next_frame(&type, &payload));
+        CHECK(type == CTRL_ACCEPT && payload == "200001");
+
+        // Tünel iki relay'de de açılır; TUNNEL_ACTIVE ile aynı yazımdaki veri hamdır
+        b_proxy->send_frame(CTRL_TUNNEL_ACTIVE, "", "first");
+        CHECK(a_proxy->next_frame(&type, &payload));
+        CHECK(type == CTRL_START_VNC_TUNNEL);
+        a_proxy->send_frame(CTRL_TUNNEL_ACTIVE, "");
+        CHECK(b_proxy->next_frame(&type, &payload));
+        CHECK(type == CTRL_START_VNC_TUNNEL);
+        for (int i = 0; i < 100 && a_proxy->in.size() < 5; ++i) a_proxy->receive(10);
+        CHECK(a_proxy->in == "first");
+        a_proxy->in.clear();
+
+        // Kanal penceresinden çok büyük veri iki yönde eşzamanlı akar
+        const size_t total = 8 * Cluster::CHANNEL_WINDOW;
+        size_t sent[2] = {0, 0};
+        ProxyEnd* ends[2] = {a_proxy, b_proxy};
+        for (ProxyEnd* end : ends) ::fcntl(end->fd, F_SETFL, O_NONBLOCK);
+        start = std::chrono::steady_clock::now();
+        while ((a_proxy->in.size() < total || b_proxy->in.size() < total) &&
+               std::chrono::steady_clock::now() - start < std::chrono::seconds(20)) {
+            for (int i = 0; i < 2; ++i) {
+                if (sent[i] < total) {
+                    std::string chunk = pattern(sent[i] + i, std::min<size_t>(65536, total - sent[i]));
+                    ssize_t n = ::write(ends[i]->fd, chunk.data(), chunk.size());
+                    if (n > 0) sent[i] += n;
+                }
+                ends[i]->receive(1);
+            }
+        }
+        CHECK(b_proxy->in == pattern(0, total));
+        CHECK(a_proxy->in == pattern(1, total));
+
+        // Bir proxy kapanınca kanal kapanır ve karşı proxy EOF görür
+        ::close(a_proxy->fd);
+        a_proxy->fd = -1;
+        bool eof = false;
+        start = std::chrono::steady_clock::now();
+        while (!eof && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) eof = !b_proxy->receive(20);
+        CHECK(eof);
+    }
+
+    loop.stop();
+    loop_thread.join();
+    for (ProxyEnd& proxy : proxies) {
+        if (proxy.fd >= 0) ::close(proxy.fd);
+    }
+}
+
+int main() {
+    test_parse_peers();
+    test_channel();
+    return test::finish("cluster");
+}
@@ -0,0 +1,35 @@
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+// Davranış testlerinin ortak yardımcıları. Her test ayrı bir programdır ('make test'); başarısız
+// CHECK dosya ve satırıyla yazılır, program başarısız kontrol varsa 1 ile çıkar.
+
+#include <cstdio>
+
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int finish(const char* name) {
+    if (failures() == 0) {
+        std::printf("%s: tamam\n", name);
+        return 0;
+    }
+    std::fprintf(stderr, "%s: %d kontrol başarısız\n", name, failures());
+    return 1;
+}
+
+} // namespace test
+
+#define CHECK(condition)                                                                              \
+    do {                                                                                              \
+        if (!(condition)) {                                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) başarısız\n", __FILE__, __LINE__, #condition);   \
+            ++test::failures();                                                                       \
+        }                                                                                             \
+    } while (0)
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,126 @@
+// Kontrol kanalı: ikili çerçeve çözme/kodlama (parça parça gelen ve bozuk girdi dahil) ve metin komutları
+
+#include "control_protocol.h"
+#include "test_common.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+static std::string encode(ControlType type, const std::string& payload) {
+    std::string out(CONTROL_HEADER_SIZE + payload.size(), '\0');
+    size_t n = encode_control_frame(type, payload.data(), payload.size(), &out[0], out.size());
+    out.resize(n);
+    return out;
+}
+
+static void test_round_trip() {
+    std::string frame = encode(CTRL_CONNECT, "123456");
+    CHECK(frame.size() == CONTROL_HEADER_SIZE + 6);
+    CHECK((unsigned char)frame[0] == CONTROL_MAGIC_V1);
+
+    ControlFrame parsed;
+    CHECK(parse_control_frame(frame.data(), frame.size(), &parsed) == (ssize_t)frame.size());
+    CHECK(parsed.type == CTRL_CONNECT);
+    CHECK(parsed.length == 6);
+    CHECK(std::string(parsed.payload, parsed.length) == "123456");
+    CHECK(parsed.payload == frame.data() + CONTROL_HEADER_SIZE); // Yük kopyalanmaz
+
+    std::string empty = encode(CTRL_HELLO, "");
+    CHECK(parse_control_frame(empty.data(), empty.size(), &parsed) == (ssize_t)CONTROL_HEADER_SIZE);
+    CHECK(parsed.type == CTRL_HELLO && parsed.length == 0);
+
+    // En büyük yük kodlanır, bir fazlası reddedilir
+    std::string largest(CONTROL_MAX_PAYLOAD, 'x');
+    std::string big = encode(CTRL_ERROR, largest);
+    CHECK(parse_control_frame(big.data(), big.size(), &parsed) == (ssize_t)big.size());
+    CHECK(parsed.length == CONTROL_MAX_PAYLOAD);
+    char out[CONTROL_HEADER_SIZE + CONTROL_MAX_PAYLOAD + 1];
+    CHECK(encode_control_frame(CTRL_ERROR, largest.data(), CONTROL_MAX_PAYLOAD + 1, out, sizeof(out)) == 0);
+    CHECK(encode_control_frame(CTRL_ERROR, "abc", 3, out, CONTROL_HEADER_SIZE + 2) == 0); // Çıktı yetmiyor
+}
+
+// Çerçeve tamamlanana kadar 0 döner; ardışık çerçeveler sırayla çözülür
+static void test_partial_and_stream() {
+    std::string stream = encode(CTRL_ACCEPT, "654321") + encode(CTRL_TUNNEL_ACTIVE, "") + encode(CTRL_ERROR, "hata");
+    ControlFrame parsed;
+    for (size_t len = 0; len < CONTROL_HEADER_SIZE + 6; ++len) {
+        CHECK(parse_control_frame(stream.data(), len, &parsed) == 0);
+    }
+
+    std::vector<ControlType> types;
+    std::vector<std::string> payloads;
+    size_t offset = 0;
+    while (offset < stream.size()) {
+        ssize_t n = parse_control_frame(stream.data() + offset, stream.size() - offset, &parsed);
+        CHECK(n > 0);
+        if (n <= 0) break;
+        types.push_back(parsed.type);
+        payloads.emplace_back(parsed.payload, parsed.length);
+        offset += n;
+    }
+    CHECK(types.size() == 3);
+    if (types.size() == 3) {
+        CHECK(types[0] == CTRL_ACCEPT && payloads[0] == "654321");
+        CHECK(types[1] == CTRL_TUNNEL_ACTIVE && payloads[1].empty());
+        CHECK(types[2] == CTRL_ERROR && payloads[2] == "hata");
+    }
+}
+
+// İşaret/sürüm baytı yanlışsa (ör. metin komutu) veya uzunluk sınırı aşılıyorsa -1
+static void test_invalid() {
+    ControlFrame parsed;
+    const char text[] = "connect 123456\n";
+    CHECK(parse_control_frame(text, strlen(text), &parsed) == -1);
+    CHECK(parse_control_frame(text, 1, &parsed) == -1); // İlk bayt yeter
+    CHECK(parse_control_frame(text, 0, &parsed) == 0);
+
+    unsigned char oversized[CONTROL_HEADER_SIZE] = {CONTROL_MAGIC_V1, CTRL_CONNECT, 0x04, 0x01}; // 1025
+    CHECK(parse_control_frame((const char*)oversized, sizeof(oversized), &parsed) == -1);
+
+    unsigned char other_version[CONTROL_HEADER_SIZE] = {0xC2, CTRL_CONNECT, 0, 0};
+    CHECK(parse_control_frame((const char*)other_version, sizeof(other_version), &parsed) == -1);
+}
+
+static void test_text_commands() {
+    std::vector<char> buffer;
+    std::string input = "  CONNECT 123456 \r\nstart_vnc_tunnel deflate\nhalf";
+    buffer.assign(input.begin(), input.end());
+
+    std::string line;
+    CHECK(extract_text_line(buffer, &line));
+    CHECK(line == "CONNECT 123456");
+    TextCommand command;
+    ControlType type;
+    CHECK(parse_text_command(line, &command, &type));
+    CHECK(type == CTRL_CONNECT);
+    CHECK(command.verb == "connect");
+    CHECK(command.argument == "123456");
+
+    CHECK(extract_text_line(buffer, &line));
+    CHECK(parse_text_command(line, &command, &type));
+    CHECK(type == CTRL_START_VNC_TUNNEL);
+    CHECK(command.argument == "deflate"); // Tünel seçenekleri
+
+    CHECK(!extract_text_line(buffer, &line)); // Yarım satır tamponda kalır
+    CHECK(std::string(buffer.begin(), buffer.end()) == "half");
+
+    CHECK(parse_text_command("resume 0123456789abcdef 4096", &command, &type)); // Argüman satırın kalanıdır
+    CHECK(type == CTRL_RESUME);
+    CHECK(command.argument == "0123456789abcdef 4096");
+
+    // hello yalnızca ikili protokolde, relay -> istemci tipleri hiç kabul edilmez
+    CHECK(!parse_text_command("hello", &command, &type));
+    CHECK(!parse_text_command("TUNNEL_ACTIVE", &command, &type));
+    CHECK(!parse_text_command("bilinmeyen 1", &command, &type));
+    CHECK(std::string(control_type_text(CTRL_TUNNEL_ACTIVE)) == "TUNNEL_ACTIVE");
+    CHECK(std::string(control_type_text(CTRL_TUNNEL_OPTIONS)) == "TUNNEL_OPTIONS");
+}
+
+int main() {
+    test_round_trip();
+    test_partial_and_stream();
+    test_invalid();
+    test_text_commands();
+    return test::finish("control_protocol");
+}
@@ -0,0 +1,149 @@
+// EgressScheduler: GCRA sınırlayıcısı, hesap sınırlayıcılarının paylaşımı, küçük gönderimlerin
+// önceliği, hız sınırına uyum ve deficit round robin ile adil paylaşım (benzetim saatiyle)
+
+#include "egress_scheduler.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <vector>
+
+static const uint64_t NS_PER_SEC = 1000000000ull;
+static const uint64_t NS_PER_MS = 1000000ull;
+
+static uint64_t fake_now = 1;
+static uint64_t fake_clock() { return fake_now; }
+
+// Sınırlayıcı burst kadarını bekletmeden verir, borcu zamanla öder
+static void test_rate_limiter() {
+    RateLimiter limiter(1000000, 64 * 1024); // 1 MB/s
+    const uint64_t start = 10 * NS_PER_SEC;
+    CHECK(limiter.available(start) == 64 * 1024);
+    CHECK(limiter.delay_ns(64 * 1024, start) == 0);
+
+    limiter.consume(64 * 1024, start);
+    CHECK(limiter.available(start) == 0);
+    CHECK(limiter.delay_ns(1000, start) > 0);
+    // 10 ms'de 10000 byte birikir
+    size_t after = limiter.available(start + 10 * NS_PER_MS);
+    CHECK(after >= 9999 && after <= 10001);
+    CHECK(limiter.delay_ns(10000, start + 10 * NS_PER_MS) <= 1000);
+
+    // Sınır aşılabilir (borç); borç ödenene kadar izin verilmez
+    limiter.consume(500000, start + 10 * NS_PER_MS);
+    CHECK(limiter.available(start + 100 * NS_PER_MS) == 0);
+    CHECK(limiter.available(start + 600 * NS_PER_MS) > 0);
+}
+
+// Aynı hesabın tünelleri tek sınırlayıcıyı paylaşır; sınırsız ayar sınırlayıcı üretmez
+static void test_limits() {
+    SchedulerConfig config;
+    EgressLimits unlimited(config);
+    CHECK(unlimited.global() == nullptr);
+    CHECK(unlimited.account("10.0.0.1") == nullptr);
+    CHECK(unlimited.new_session() == nullptr);
+
+    config.account_rate = 1000000;
+    config.session_rate = 500000;
+    EgressLimits limits(config);
+    std::shared_ptr<RateLimiter> first = limits.account("10.0.0.1");
+    CHECK(first != nullptr);
+    CHECK(limits.account("10.0.0.1") == first);
+    CHECK(limits.account("10.0.0.2") != first);
+    CHECK(limits.new_session() != limits.new_session());
+}
+
+// Akışın wake'i: izin verildiği kadar gönderir, izin bitince sıraya girer
+struct SimFlow {
+    EgressFlow flow;
+    uint64_t sent = 0;
+
+    void pump(EgressScheduler& scheduler) {
+        while (true) {
+            size_t allowed = scheduler.grant(flow, 1024 * 1024);
+            if (allowed == 0) return;
+            scheduler.sent(flow, allowed);
+            sent += allowed;
+        }
+    }
+};
+
+// Zamanı sıradaki uyanmaya (en az 1 ms) ilerletip tur servis eder
+static void run_for(EgressScheduler& scheduler, uint64_t duration_ns) {
+    uint64_t end = fake_now + duration_ns;
+    while (fake_now < end) {
+        uint64_t next = scheduler.next_wake_ns();
+        fake_now = std::max(fake_now + NS_PER_MS, next);
+        scheduler.service();
+    }
+}
+
+// Tek toplu akış oturum hızına uyar; küçük gönderimler sırayı beklemez
+static void test_session_rate() {
+    fake_now = NS_PER_SEC;
+    SchedulerConfig config;
+    config.session_rate = 1000000;
+    EgressLimits limits(config);
+    EgressScheduler scheduler(limits, nullptr, fake_clock);
+    CHECK(scheduler.enabled());
+
+    SimFlow bulk;
+    bulk.flow.session = limits.new_session();
+    bulk.flow.wake = [&]() { bulk.pump(scheduler); };
+    bulk.pump(scheduler);
+    CHECK(scheduler.queued_flows() == 1);
+    CHECK(bulk.flow.queued);
+
+    // Öncelik sınıfı: bekleyen verisi interactive_bytes'tan az olan gönderim hemen geçer
+    EgressFlow input;
+    input.session = limits.new_session();
+    CHECK(scheduler.grant(input, 100) == 100);
+    CHECK(scheduler.grant(bulk.flow, config.interactive_bytes) == config.interactive_bytes);
+
+    run_for(scheduler, 5 * NS_PER_SEC);
+    // 5 saniyede 5 MB ve başlangıçtaki burst (bir quantum)
+    CHECK(bulk.sent >= 4900000);
+    CHECK(bulk.sent <= 5000000 + 2 * config.quantum);
+
+    scheduler.remove(bulk.flow);
+    CHECK(scheduler.queued_flows() == 0);
+    CHECK(!bulk.flow.queued);
+    CHECK(scheduler.next_wake_ns() == 0);
+}
+
+// Toplam sınır altında çekişen akışlar çıkışı eşit paylaşır; sonradan gelen akış aç kalmaz
+static void test_fair_share() {
+    fake_now = NS_PER_SEC;
+    SchedulerConfig config;
+    config.egress_rate = 2000000;
+    EgressLimits limits(config);
+    EgressScheduler scheduler(limits, nullptr, fake_clock);
+
+    std::vector<SimFlow> flows(3);
+    for (SimFlow& sim : flows) sim.flow.wake = [&sim, &scheduler]() { sim.pump(scheduler); };
+    flows[0].pump(scheduler);
+    flows[1].pump(scheduler);
+    run_for(scheduler, 2 * NS_PER_SEC);
+
+    // Üçüncü akış çekişme varken gelir: sıraya girer ve sonraki turlarda payını alır
+    uint64_t before[2] = {flows[0].sent, flows[1].sent};
+    flows[2].pump(scheduler);
+    CHECK(flows[2].sent == 0);
+    run_for(scheduler, 3 * NS_PER_SEC);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < flows.size(); ++i) {
+        uint64_t share = flows[i].sent - (i < 2 ? before[i] : 0);
+        total += share;
+        CHECK(share >= 1600000 && share <= 2400000); // 3 saniyede 6 MB'ın üçte biri civarı
+    }
+    CHECK(total <= 6000000 + 4 * config.quantum);
+    for (SimFlow& sim : flows) scheduler.remove(sim.flow);
+}
+
+int main() {
+    test_rate_limiter();
+    test_limits();
+    test_session_rate();
+    test_fair_share();
+    return test::finish("egress_scheduler");
+}
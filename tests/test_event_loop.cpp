@@ -0,0 +1,63 @@
+// EventLoop: aynı turda kapatılıp numarası yeniden kullanılan fd'nin eski olayı yeni kayda verilmez
+
+#include "event_loop.h"
+#include "test_common.h"
+
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// İki pipe'ın okuma ucu aynı turda hazırdır. Önce çalışan callback diğer ucu kaldırıp kapatır ve
+// numarasına yeni (boş) bir pipe'ı oturtup kaydeder; turda bekleyen eski olay yeni callback'i çağırmamalı.
+static void test_reused_fd() {
+    EventLoop loop;
+    int first[2], second[2];
+    CHECK(::pipe(first) == 0);
+    CHECK(::pipe(second) == 0);
+    CHECK(::write(first[1], "x", 1) == 1);
+    CHECK(::write(second[1], "x", 1) == 1);
+
+    int replaced = -1;
+    int fresh_writer = -1; // Açık kalır; kapanırsa okuma ucu EOF ile hazır olur
+    int stale_calls = 0;
+    int calls = 0;
+    auto on_ready = [&](int self, int other) {
+        ++calls;
+        char byte;
+        CHECK(::read(self, &byte, 1) == 1);
+        if (replaced >= 0) return;
+        replaced = other;
+        loop.remove(other);
+        ::close(other);
+        int fresh[2];
+        CHECK(::pipe(fresh) == 0);
+        if (fresh[0] != other) { // Genellikle en küçük boş numara, yani zaten other'dır
+            CHECK(::dup2(fresh[0], other) == other);
+            ::close(fresh[0]);
+        }
+        fresh_writer = fresh[1];
+        CHECK(loop.add(other, EPOLLIN, [&](uint32_t) { ++stale_calls; }));
+        loop.stop(); // Sonraki tur post edilen işle biter; yeni pipe boş olduğundan olay gelmez
+    };
+    int a = first[0], b = second[0];
+    CHECK(loop.add(a, EPOLLIN, [&, a, b](uint32_t) { on_ready(a, b); }));
+    CHECK(loop.add(b, EPOLLIN, [&, a, b](uint32_t) { on_ready(b, a); }));
+    loop.run();
+
+    CHECK(calls == 1);
+    CHECK(stale_calls == 0);
+    // Yeni kayıt gerçekten döngüde: üzerindeki değişiklik geçerli kuşağı kullanır
+    CHECK(loop.modify(replaced, EPOLLIN | EPOLLET));
+    loop.remove(replaced);
+    CHECK(!loop.modify(replaced, EPOLLIN));
+
+    ::close(replaced);
+    ::close(fresh_writer);
+    ::close(a == replaced ? b : a);
+    ::close(first[1]);
+    ::close(second[1]);
+}
+
+int main() {
+    test_reused_fd();
+    return test::finish("event_loop");
+}
@@ -0,0 +1,205 @@
+// FanoutSession: paylaşan akışının tüm izleyicilere dağıtılması, izleyici girişinin paylaşana
+// birleştirilmesi, izleyici yokken bekleme, yavaş izleyici politikaları, kapanış
+
+#include "fanout_session.h"
+#include "test_common.h"
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+// Uç: relay tarafındaki soketi tutan ClientInfo ve testin istemci rolündeki karşı soketi
+struct Endpoint {
+    ClientInfo info;
+    int peer = -1;
+
+    explicit Endpoint(ClientId id) {
+        int fds[2];
+        CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        info.id = id;
+        info.socket_fd = fds[0];
+        peer = fds[1];
+    }
+    ~Endpoint() {
+        ::close(info.socket_fd);
+        ::close(peer);
+    }
+};
+
+static size_t write_some(int fd, const std::string& data) {
+    ssize_t n = ::write(fd, data.data(), data.size());
+    return n > 0 ? (size_t)n : 0;
+}
+
+static std::string read_available(int fd) {
+    std::string out;
+    char chunk[16384];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) out.append(chunk, n);
+    return out;
+}
+
+static TunnelLimits small_limits() {
+    TunnelLimits limits;
+    limits.high_watermark = 64 * 1024;
+    limits.low_watermark = 16 * 1024;
+    return limits;
+}
+
+// Politika adları iki yönde çözülür
+static void test_policy_names() {
+    SlowViewerPolicy policy;
+    CHECK(parse_slow_viewer_policy("drop", &policy) && policy == SLOW_VIEWER_DROP);
+    CHECK(parse_slow_viewer_policy("coalesce", &policy) && policy == SLOW_VIEWER_COALESCE);
+    CHECK(parse_slow_viewer_policy("disconnect", &policy) && policy == SLOW_VIEWER_DISCONNECT);
+    CHECK(!parse_slow_viewer_policy("slow", &policy));
+    CHECK(std::string(slow_viewer_policy_name(SLOW_VIEWER_COALESCE)) == "coalesce");
+}
+
+// İzleyici yokken paylaşan okunmaz ve itilen veri bekletilir; ilk izleyici bunu baştan alır,
+// sonraki veri tüm izleyicilere aynı sırayla gider. İzleyici girişi paylaşana ulaşır.
+static void test_fanout() {
+    EventLoop loop;
+    Endpoint sharer(100001), first(100002), second(100003);
+    FanoutSession session(loop, sharer.info, small_limits(), 1024 * 1024, SLOW_VIEWER_DROP,
+                          [](ClientInfo&) { CHECK(false); });
+    CHECK(sharer.info.read_paused);
+
+    std::string early = pattern(0, 1000);
+    session.push(sharer.info, early.data(), early.size());
+    session.add_viewer(first.info);
+    CHECK(session.viewer_count() == 1);
+    CHECK(!sharer.info.read_paused);
+    CHECK(read_available(first.peer) == early);
+
+    session.add_viewer(second.info);
+    std::string live = pattern(early.size(), 200000);
+    size_t written = 0;
+    std::string got_first, got_second;
+    while (got_second.size() < live.size()) {
+        if (written < live.size()) written += write_some(sharer.peer, live.substr(written, 65536));
+        CHECK(session.forward_from(sharer.info));
+        got_first += read_available(first.peer);
+        got_second += read_available(second.peer);
+        session.on_writable(first.info);
+        session.on_writable(second.info);
+    }
+    CHECK(got_first == live);
+    CHECK(got_second == live);
+
+    CHECK(write_some(first.peer, "key1") == 4);
+    CHECK(session.forward_from(first.info));
+    CHECK(write_some(second.peer, "key2") == 4);
+    CHECK(session.forward_from(second.info));
+    CHECK(read_available(sharer.peer) == "key1key2");
+
+    session.remove_viewer(first.info);
+    CHECK(session.viewer_count() == 1);
+}
+
+// Paylaşan, en hızlı izleyicinin kuyruğu yüksek su işaretine ulaşınca durur; izleyici okudukça sürer
+static void test_sharer_backpressure() {
+    EventLoop loop;
+    Endpoint sharer(100004), viewer(100005);
+    TunnelLimits limits = small_limits();
+    FanoutSession session(loop, sharer.info, limits, 1024 * 1024, SLOW_VIEWER_DROP,
+                          [](ClientInfo&) { CHECK(false); });
+    session.add_viewer(viewer.info);
+
+    int sndbuf = 4096;
+    ::setsockopt(viewer.info.socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    size_t written = 0;
+    for (int round = 0; round < 10000 && !sharer.info.read_paused; ++round) {
+        written += write_some(sharer.peer, pattern(written, 65536));
+        CHECK(session.forward_from(sharer.info));
+    }
+    CHECK(sharer.info.read_paused);
+
+    std::string received;
+    for (int round = 0; round < 10000 && sharer.info.read_paused; ++round) {
+        received += read_available(viewer.peer);
+        session.on_writable(viewer.info);
+    }
+    CHECK(!sharer.info.read_paused);
+    CHECK(received == pattern(0, received.size()));
+}
+
+// Kuyruğu gecikme sınırını aşan izleyici: DROP'ta işleyiciye verilir, COALESCE'te kuyruğu atılıp
+// canlı akışa atlar. Hızlı izleyici her iki durumda da akışın tamamını alır.
+static void test_slow_viewer(SlowViewerPolicy policy) {
+    EventLoop loop;
+    Endpoint sharer(100006), fast(100007), slow(100008);
+    const size_t lag_limit = 256 * 1024;
+    std::vector<ClientInfo*> reported;
+    FanoutSession* session_ptr = nullptr;
+    FanoutSession session(loop, sharer.info, small_limits(), lag_limit, policy, [&](ClientInfo& viewer) {
+        reported.push_back(&viewer);
+        session_ptr->remove_viewer(viewer);
+    });
+    session_ptr = &session;
+    session.add_viewer(fast.info);
+    session.add_viewer(slow.info);
+    int sndbuf = 4096;
+    ::setsockopt(slow.info.socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    const size_t total = 2 * 1024 * 1024;
+    size_t written = 0;
+    std::string got_fast;
+    for (int round = 0; round < 100000 && got_fast.size() < total; ++round) {
+        if (written < total) written += write_some(sharer.peer, pattern(written, std::min<size_t>(65536, total - written)));
+        CHECK(session.forward_from(sharer.info));
+        got_fast += read_available(fast.peer);
+        session.on_writable(fast.info);
+    }
+    CHECK(got_fast == pattern(0, total));
+
+    if (policy == SLOW_VIEWER_DROP) {
+        CHECK(reported.size() == 1 && reported[0] == &slow.info);
+        CHECK(session.viewer_count() == 1);
+    } else {
+        // Yavaş izleyici oturumda kalır ama aldığı akışta boşluk vardır
+        CHECK(reported.empty());
+        CHECK(session.viewer_count() == 2);
+        std::string got_slow = read_available(slow.peer);
+        CHECK(got_slow.size() < total);
+    }
+}
+
+// Kapanış tüm izleyicileri döner; sonrasında veri aktarılmaz
+static void test_close() {
+    EventLoop loop;
+    Endpoint sharer(100009), first(100010), second(100011);
+    FanoutSession session(loop, sharer.info, small_limits(), 1024 * 1024, SLOW_VIEWER_DROP,
+                          [](ClientInfo&) { CHECK(false); });
+    session.add_viewer(first.info);
+    session.add_viewer(second.info);
+    std::vector<ClientInfo*> viewers = session.close();
+    CHECK(viewers.size() == 2);
+    CHECK(session.viewer_count() == 0);
+    CHECK(session.close().empty());
+
+    CHECK(write_some(sharer.peer, "late") == 4);
+    CHECK(session.forward_from(sharer.info));
+    CHECK(read_available(first.peer).empty());
+}
+
+int main() {
+    test_policy_names();
+    test_fanout();
+    test_sharer_backpressure();
+    test_slow_viewer(SLOW_VIEWER_DROP);
+    test_slow_viewer(SLOW_VIEWER_COALESCE);
+    test_close();
+    return test::finish("fanout_session");
+}
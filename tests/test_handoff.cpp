@@ -0,0 +1,298 @@
+// Handoff: kayıtların alanları ve fd'leriyle taşınması, son an dolunca gönderim/alımın bitmesi,
+// istemci ve tünel oturumu öğelerinin devri, worker döngülerinin dondurulması, süreç yöneticisi bildirimi
+
+#include "handoff.h"
+#include "test_common.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+static HandoffDeadline after_ms(int ms) { return steady_clock::now() + milliseconds(ms); }
+
+static std::string read_available(int fd) {
+    std::string out;
+    char chunk[16384];
+    ssize_t n;
+    while ((n = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0) out.append(chunk, n);
+    return out;
+}
+
+// Alanlar yazıldığı sırayla okunur; fd'ler kayıtlarıyla birlikte gelir ve çalışır durumdadır
+static void test_records() {
+    int sock[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sock) == 0);
+    int pipe_fds[2];
+    CHECK(::pipe(pipe_fds) == 0);
+
+    HandoffWriter out;
+    CHECK(out.empty());
+    out.put_u8(7);
+    out.put_u32(0xdeadbeef);
+    out.put_u64(0x0123456789abcdefull);
+    out.put_string("merhaba");
+    out.put_bytes("\0\1\2", 3);
+    out.put_fd(pipe_fds[1]);
+    out.put_fd(-1);
+    CHECK(out.fd_count() == 1);
+    CHECK(out.send(sock[0], after_ms(1000)));
+    CHECK(out.empty());
+    // İkinci kayıt, alıcının tek fd sınırına kadar fd taşır
+    std::vector<int> many;
+    for (size_t i = 0; i < HANDOFF_MAX_FDS; ++i) {
+        many.push_back(::dup(pipe_fds[0]));
+        out.put_fd(many.back());
+    }
+    CHECK(out.send(sock[0], after_ms(1000)));
+
+    HandoffReader in;
+    CHECK(in.receive(sock[1], after_ms(1000)));
+    CHECK(in.get_u8() == 7);
+    CHECK(in.get_u32() == 0xdeadbeef);
+    CHECK(in.get_u64() == 0x0123456789abcdefull);
+    CHECK(in.get_string() == "merhaba");
+    CHECK(in.get_string() == std::string("\0\1\2", 3));
+    int writer = in.take_fd();
+    CHECK(writer >= 0 && writer != pipe_fds[1]);
+    CHECK(in.take_fd() == -1);
+    CHECK(in.at_end());
+    CHECK(in.ok());
+    CHECK(::write(writer, "x", 1) == 1);
+    char byte = 0;
+    CHECK(::read(pipe_fds[0], &byte, 1) == 1 && byte == 'x');
+    ::close(writer);
+    // Alan sonunu aşan okuma kaydı bozuk işaretler
+    CHECK(in.get_u32() == 0);
+    CHECK(!in.ok());
+
+    // Sahiplenilmeyen fd'ler sonraki kayıtta kapatılır
+    CHECK(in.receive(sock[1], after_ms(1000)));
+    CHECK(in.ok());
+    int first = in.take_fd();
+    CHECK(first >= 0);
+    ::close(first);
+    for (int fd : many) ::close(fd);
+
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
+    ::close(sock[0]);
+    ::close(sock[1]);
+}
+
+// Karşı taraf yanıt vermezse alım ve gönderim son anda ETIMEDOUT ile biter; kapanan bağlantıda
+// beklemeden false döner
+static void test_deadlines() {
+    int sock[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sock) == 0);
+
+    auto start = steady_clock::now();
+    char value;
+    CHECK(!handoff_receive_byte(sock[1], &value, after_ms(100)));
+    CHECK(errno == ETIMEDOUT);
+    HandoffReader in;
+    CHECK(!in.receive(sock[1], after_ms(100)));
+    CHECK(errno == ETIMEDOUT);
+    // Okunmayan büyük kayıt soket tamponuna sığmaz
+    HandoffWriter out;
+    std::string large = pattern(0, 8 * 1024 * 1024);
+    out.put_bytes(large.data(), large.size());
+    CHECK(!out.send(sock[0], after_ms(100)));
+    CHECK(errno == ETIMEDOUT);
+    auto elapsed = steady_clock::now() - start;
+    CHECK(elapsed >= milliseconds(300) && elapsed < milliseconds(2000));
+
+    ::close(sock[0]);
+    read_available(sock[1]);
+    start = steady_clock::now();
+    CHECK(!handoff_receive_byte(sock[1], &value, after_ms(1000)));
+    CHECK(steady_clock::now() - start < milliseconds(500));
+    ::close(sock[1]);
+
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sock) == 0);
+    CHECK(handoff_send_byte(sock[0], 'R', after_ms(100)));
+    CHECK(handoff_receive_byte(sock[1], &value, after_ms(100)) && value == 'R');
+    ::close(sock[0]);
+    ::close(sock[1]);
+}
+
+// İstemcinin durumu, tamponları ve soketi devredilir; tünel oturumunun bekleyen verisi yeni
+// oturumda kaldığı yerden gönderilir
+static void test_client_and_session() {
+    int sock[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sock) == 0);
+    int a_pair[2], b_pair[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, a_pair) == 0);
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, b_pair) == 0);
+
+    EventLoop loop;
+    ClientInfo a, b;
+    a.id = 100001;
+    b.id = 100002;
+    a.socket_fd = a_pair[0];
+    b.socket_fd = b_pair[0];
+    a.owner_worker = 2;
+    a.ip_address = "10.0.0.7";
+    a.status = b.status = ClientStatus::VncTunnelling;
+    a.peer_id = b.id;
+    b.peer_id = a.id;
+    a.binary_protocol = true;
+    a.tunnel_options = "zlib";
+    a.output_buffer.assign(3, 'o');
+    a.state_since_ms = 12345;
+    int sndbuf = 4096;
+    ::setsockopt(b.socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    TunnelLimits limits;
+    limits.high_watermark = 256 * 1024;
+    auto session = std::make_shared<TunnelSession>(loop, a, b, false, limits);
+    // b okumadığı için a'dan gelen verinin bir kısmı oturumun tamponunda bekler
+    const size_t total = 200 * 1024;
+    size_t written = 0;
+    while (written < total) {
+        ssize_t n = ::write(a_pair[1], pattern(written, total - written).data(), total - written);
+        if (n <= 0) break;
+        written += n;
+        CHECK(session->forward_from(a));
+    }
+    CHECK(session->forward_from(a));
+    size_t buffered = session->pending_bytes_to(b);
+    CHECK(buffered > 0);
+
+    HandoffWriter out;
+    out.put_u8(HANDOFF_CLIENT);
+    handoff_put_client(out, a);
+    out.put_u8(HANDOFF_CLIENT);
+    handoff_put_client(out, b);
+    out.put_u8(HANDOFF_SESSION);
+    handoff_put_session(out, *session, a, b);
+    out.put_u8(HANDOFF_END);
+    CHECK(out.send(sock[0], after_ms(1000)));
+
+    HandoffReader in;
+    CHECK(in.receive(sock[1], after_ms(1000)));
+    CHECK(in.get_u8() == HANDOFF_CLIENT);
+    std::shared_ptr<ClientInfo> a2 = handoff_get_client(in);
+    CHECK(in.get_u8() == HANDOFF_CLIENT);
+    std::shared_ptr<ClientInfo> b2 = handoff_get_client(in);
+    CHECK(a2 && b2);
+    if (!a2 || !b2) return;
+    CHECK(a2->id == a.id && a2->peer_id == b.id);
+    CHECK(a2->owner_worker == 2);
+    CHECK(a2->ip_address == "10.0.0.7");
+    CHECK(a2->status == ClientStatus::VncTunnelling);
+    CHECK(a2->binary_protocol);
+    CHECK(a2->tunnel_options == "zlib");
+    CHECK(a2->output_buffer == a.output_buffer);
+    CHECK(a2->state_since_ms == 12345);
+    CHECK(a2->socket_fd >= 0 && a2->socket_fd != a.socket_fd);
+
+    CHECK(in.get_u8() == HANDOFF_SESSION);
+    HandedSession handed;
+    handoff_get_session(in, &handed);
+    CHECK(in.get_u8() == HANDOFF_END);
+    CHECK(in.ok() && in.at_end());
+    CHECK(handed.a == a.id && handed.b == b.id);
+    CHECK(handed.dirs[0].received == written);
+
+    // Eski süreç kapanır; yeni oturum bekleyen veriyi b'ye gönderir
+    std::string received = read_available(b_pair[1]);
+    session.reset();
+    ::close(a.socket_fd);
+    ::close(b.socket_fd);
+    TunnelSession restored(loop, *a2, *b2, false, limits);
+    CHECK(restored.restore_direction(*a2, handed.dirs[0]));
+    CHECK(restored.restore_direction(*b2, handed.dirs[1]));
+    CHECK(restored.received_from(*a2) == written);
+    for (int i = 0; i < 1000 && received.size() < written; ++i) {
+        restored.on_writable(*b2);
+        received += read_available(b_pair[1]);
+    }
+    CHECK(received == pattern(0, written));
+
+    ::close(a2->socket_fd);
+    ::close(b2->socket_fd);
+    ::close(a_pair[1]);
+    ::close(b_pair[1]);
+    ::close(sock[0]);
+    ::close(sock[1]);
+}
+
+// Dondurulan döngüler release'e kadar iş çalıştırmaz. Uzun bir işte takılan döngü son anı
+// kaçırırsa dondurma başarısız olur ve diğerleri bırakılır; geciken döngü de sonradan beklemez.
+static void test_loop_freeze() {
+    EventLoop first, second;
+    std::thread first_thread([&]() { first.run(); });
+    std::thread second_thread([&]() { second.run(); });
+    LoopFreeze freeze;
+
+    CHECK(freeze.freeze({&first, &second}, after_ms(1000)));
+    std::atomic<int> ran{0};
+    first.post([&]() { ++ran; });
+    second.post([&]() { ++ran; });
+    std::this_thread::sleep_for(milliseconds(50));
+    CHECK(ran == 0);
+    freeze.release();
+    for (int i = 0; i < 100 && ran < 2; ++i) std::this_thread::sleep_for(milliseconds(10));
+    CHECK(ran == 2);
+
+    second.post([]() { std::this_thread::sleep_for(milliseconds(300)); });
+    auto start = steady_clock::now();
+    CHECK(!freeze.freeze({&first, &second}, after_ms(100)));
+    CHECK(steady_clock::now() - start < milliseconds(250));
+    first.post([&]() { ++ran; });
+    second.post([&]() { ++ran; });
+    for (int i = 0; i < 100 && ran < 4; ++i) std::this_thread::sleep_for(milliseconds(10));
+    CHECK(ran == 4);
+
+    first.stop();
+    second.stop();
+    first_thread.join();
+    second_thread.join();
+}
+
+// NOTIFY_SOCKET tanımlıysa durum satırı datagram olarak oraya gider
+static void test_notify_supervisor() {
+    std::string path = "/tmp/handoff_test_notify_" + std::to_string(::getpid());
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size());
+    ::unlink(path.c_str());
+    CHECK(::bind(fd, (struct sockaddr*)&address, sizeof(address)) == 0);
+
+    ::unsetenv("NOTIFY_SOCKET");
+    notify_supervisor("READY=1"); // Tanımlı değil: hiçbir şey yapılmaz
+    ::setenv("NOTIFY_SOCKET", path.c_str(), 1);
+    notify_supervisor("MAINPID=42");
+    char buffer[64];
+    ssize_t n = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    CHECK(n > 0 && std::string(buffer, n) == "MAINPID=42");
+    ::unsetenv("NOTIFY_SOCKET");
+    ::close(fd);
+    ::unlink(path.c_str());
+}
+
+int main() {
+    test_records();
+    test_deadlines();
+    test_client_and_session();
+    test_loop_freeze();
+    test_notify_supervisor();
+    return test::finish("handoff");
+}
@@ -0,0 +1,278 @@
+// MuxLink: çerçeve başlığı ve bölme, ajan köprüsünün kontrol kanalı, veri akışlarında kredi ile akış
+// denetimi ve iade, yarı kapanış, MUX_RESET, krediyi aşan karşı tarafın reddi ve köprünün durması
+
+#include "mux_link.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+static void set_nonblocking(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// Köprünün karşısındaki relay: gelen çerçeveler kanal başına toplanır
+struct RelayEnd {
+    int fd = -1;
+    std::string in;
+    std::string data[MUX_CHANNEL_COUNT];
+    uint64_t credit[MUX_CHANNEL_COUNT] = {0, 0, 0, 0};
+    bool closed[MUX_CHANNEL_COUNT] = {false, false, false, false};
+    bool eof = false;
+
+    // En fazla timeout_ms bekleyerek gelen veriyi okur ve tam çerçeveleri işler
+    void poll_frames(int timeout_ms) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (eof || ::poll(&pfd, 1, timeout_ms) <= 0) return;
+        char chunk[65536];
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+            eof = true;
+            return;
+        }
+        in.append(chunk, n);
+        size_t off = 0;
+        MuxHeader header;
+        while (in.size() - off >= MUX_HEADER_SIZE && parse_mux_header(in.data() + off, &header) &&
+               in.size() - off >= MUX_HEADER_SIZE + header.length) {
+            const char* payload = in.data() + off + MUX_HEADER_SIZE;
+            if (header.type == MUX_DATA) {
+                data[header.channel].append(payload, header.length);
+            } else if (header.type == MUX_WINDOW && header.length == 4) {
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(payload);
+                credit[header.channel] += ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                                          ((uint32_t)bytes[2] << 8) | bytes[3];
+            } else if (header.type == MUX_CLOSE) {
+                closed[header.channel] = true;
+            }
+            off += MUX_HEADER_SIZE + header.length;
+        }
+        in.erase(0, off);
+    }
+
+    template <typename Done>
+    bool wait_for(Done done) {
+        for (int i = 0; i < 500 && !done(); ++i) poll_frames(10);
+        return done();
+    }
+
+    void send(uint8_t channel, MuxFrameType type, const std::string& payload) {
+        std::string frames;
+        append_mux_frames(&frames, channel, type, payload.data(), payload.size());
+        CHECK(::send(fd, frames.data(), frames.size(), MSG_NOSIGNAL) == (ssize_t)frames.size());
+    }
+
+    void send_window(uint8_t channel, uint32_t value) {
+        std::string payload(4, '\0');
+        payload[0] = (char)(value >> 24);
+        payload[1] = (char)(value >> 16);
+        payload[2] = (char)(value >> 8);
+        payload[3] = (char)value;
+        send(channel, MUX_WINDOW, payload);
+    }
+};
+
+// Uygulama ucundan en fazla timeout_ms bekleyerek okur; EOF'ta false
+static bool read_app(int fd, std::string* out, int timeout_ms) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (::poll(&pfd, 1, timeout_ms) <= 0) return true;
+    char chunk[65536];
+    ssize_t n = ::read(fd, chunk, sizeof(chunk));
+    if (n > 0) out->append(chunk, n);
+    return n != 0;
+}
+
+// Başlık iki yönde çözülür; bozuk işaret, kanal, tip ve uzunluk reddedilir; büyük yük bölünür
+static void test_frames() {
+    char header[MUX_HEADER_SIZE];
+    MuxHeader parsed;
+    encode_mux_header(MUX_CHANNEL_RFB, MUX_DATA, 1234, header);
+    CHECK(parse_mux_header(header, &parsed));
+    CHECK(parsed.channel == MUX_CHANNEL_RFB && parsed.type == MUX_DATA && parsed.length == 1234);
+
+    encode_mux_header(MUX_CHANNEL_COUNT, MUX_DATA, 1, header);
+    CHECK(!parse_mux_header(header, &parsed));
+    encode_mux_header(MUX_CHANNEL_INPUT, (MuxFrameType)(MUX_RESET + 1), 0, header);
+    CHECK(!parse_mux_header(header, &parsed));
+    encode_mux_header(MUX_CHANNEL_INPUT, MUX_DATA, MUX_MAX_PAYLOAD + 1, header);
+    CHECK(!parse_mux_header(header, &parsed));
+    encode_mux_header(MUX_CHANNEL_INPUT, MUX_DATA, 1, header);
+    header[0] = 'D';
+    CHECK(!parse_mux_header(header, &parsed));
+
+    std::string frames;
+    std::string payload = pattern(0, 2 * MUX_MAX_PAYLOAD + 100);
+    append_mux_frames(&frames, MUX_CHANNEL_BULK, MUX_DATA, payload.data(), payload.size());
+    CHECK(frames.size() == payload.size() + 3 * MUX_HEADER_SIZE);
+    std::string joined;
+    for (size_t off = 0; off < frames.size();) {
+        CHECK(parse_mux_header(frames.data() + off, &parsed));
+        CHECK(parsed.channel == MUX_CHANNEL_BULK);
+        joined.append(frames, off + MUX_HEADER_SIZE, parsed.length);
+        off += MUX_HEADER_SIZE + parsed.length;
+    }
+    CHECK(joined == payload);
+    frames.clear();
+    append_mux_frames(&frames, MUX_CHANNEL_CONTROL, MUX_RESET, nullptr, 0);
+    CHECK(frames.size() == MUX_HEADER_SIZE);
+
+    CHECK(std::string(mux_channel_name(MUX_CHANNEL_CONTROL)) == "kontrol");
+    CHECK(std::string(mux_channel_name(MUX_CHANNEL_COUNT)) == "?");
+}
+
+// Kontrol kanalı iki yönde akar. Veri akışı krediyle sınırlıdır: kredi bitince aynı akışın verisi
+// bekler ama kontrol kanalı akmaya devam eder; relay kredi verince kalan veri gelir. Alınan veri
+// uygulamaya verildikçe kredi iade edilir. Kapanışlar iki yönde taşınır, MUX_RESET akışları kapatır.
+static void test_bridge() {
+    int net[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, net) == 0);
+    RelayEnd relay;
+    relay.fd = net[1];
+    std::string initial;
+    append_mux_frames(&initial, MUX_CHANNEL_CONTROL, MUX_DATA, "merhaba", 7);
+    MuxBridge bridge(net[0], initial);
+    int control = bridge.take_control_fd();
+    CHECK(control >= 0);
+    CHECK(bridge.take_control_fd() == -1);
+    CHECK(bridge.open_stream(MUX_CHANNEL_CONTROL, MUX_CHANNEL_RFB) == -1);
+    std::thread thread([&]() { bridge.run(); });
+
+    // "MUX_OK"tan sonra okunmuş veri uygulamaya verilir
+    std::string from_relay;
+    for (int i = 0; i < 100 && from_relay.size() < 7; ++i) read_app(control, &from_relay, 10);
+    CHECK(from_relay == "merhaba");
+    CHECK(::write(control, "list\n", 5) == 5);
+    CHECK(relay.wait_for([&]() { return relay.data[MUX_CHANNEL_CONTROL] == "list\n"; }));
+
+    // Paylaşan taraf: ekran güncellemelerini RFB'den gönderir, girişi INPUT'tan alır
+    int stream = bridge.open_stream(MUX_CHANNEL_RFB, MUX_CHANNEL_INPUT);
+    CHECK(stream >= 0);
+    set_nonblocking(stream);
+    const size_t total = MUX_INITIAL_WINDOW + 300 * 1024;
+    size_t written = 0;
+    auto write_stream = [&]() {
+        while (written < total) {
+            ssize_t n = ::write(stream, pattern(written, std::min<size_t>(65536, total - written)).data(),
+                                std::min<size_t>(65536, total - written));
+            if (n <= 0) break;
+            written += n;
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    while (relay.data[MUX_CHANNEL_RFB].size() < MUX_INITIAL_WINDOW &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        write_stream();
+        relay.poll_frames(10);
+    }
+    for (int i = 0; i < 10; ++i) relay.poll_frames(10);
+    CHECK(relay.data[MUX_CHANNEL_RFB].size() == MUX_INITIAL_WINDOW);
+    CHECK(::write(control, "ping\n", 5) == 5);
+    CHECK(relay.wait_for([&]() { return relay.data[MUX_CHANNEL_CONTROL] == "list\nping\n"; }));
+    CHECK(relay.data[MUX_CHANNEL_RFB].size() == MUX_INITIAL_WINDOW);
+
+    relay.send_window(MUX_CHANNEL_RFB, 1024 * 1024);
+    start = std::chrono::steady_clock::now();
+    while (relay.data[MUX_CHANNEL_RFB].size() < total &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        write_stream();
+        relay.poll_frames(10);
+    }
+    CHECK(relay.data[MUX_CHANNEL_RFB] == pattern(0, total));
+
+    // Görüntüleyicinin girişi: pencere kadar veri, okundukça kredi olarak geri döner
+    const size_t input_total = MUX_INITIAL_WINDOW;
+    relay.send(MUX_CHANNEL_INPUT, MUX_DATA, pattern(5, input_total));
+    relay.send(MUX_CHANNEL_INPUT, MUX_CLOSE, "");
+    std::string input;
+    bool open = true;
+    for (int i = 0; i < 500 && open; ++i) {
+        open = read_app(stream, &input, 10);
+        relay.poll_frames(0);
+    }
+    CHECK(!open); // Karşı tarafın kapanışı veriden sonra EOF olarak görülür
+    CHECK(input == pattern(5, input_total));
+    CHECK(relay.wait_for([&]() { return relay.credit[MUX_CHANNEL_INPUT] == input_total; }));
+
+    // Uygulama yazma yönünü kapatınca relay kanalın kapanışını alır
+    ::shutdown(stream, SHUT_WR);
+    CHECK(relay.wait_for([&]() { return relay.closed[MUX_CHANNEL_RFB]; }));
+    ::close(stream);
+
+    // MUX_RESET açık akışları kapatır; sonraki tünel için yeni akış açılabilir
+    stream = bridge.open_stream(MUX_CHANNEL_INPUT, MUX_CHANNEL_RFB);
+    CHECK(stream >= 0);
+    relay.send(MUX_CHANNEL_CONTROL, MUX_RESET, "");
+    std::string ignored;
+    open = true;
+    for (int i = 0; i < 500 && open; ++i) open = read_app(stream, &ignored, 10);
+    CHECK(!open);
+    ::close(stream);
+    stream = bridge.open_stream(MUX_CHANNEL_INPUT, MUX_CHANNEL_RFB);
+    CHECK(stream >= 0);
+    relay.send(MUX_CHANNEL_RFB, MUX_DATA, "frame");
+    std::string frame;
+    for (int i = 0; i < 100 && frame.size() < 5; ++i) read_app(stream, &frame, 10);
+    CHECK(frame == "frame");
+    ::close(stream);
+
+    // Kontrol ucu kapanınca köprü biter ve relay bağlantısı kapanır
+    ::close(control);
+    thread.join();
+    CHECK(relay.wait_for([&]() { return relay.eof; }));
+    CHECK(bridge.open_stream(MUX_CHANNEL_INPUT, MUX_CHANNEL_RFB) == -1);
+    ::close(net[1]);
+}
+
+// Krediye uymayan relay bağlantıyı bozar: köprü biter ve uygulama uçları EOF görür
+static void test_overrun() {
+    int net[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, net) == 0);
+    RelayEnd relay;
+    relay.fd = net[1];
+    MuxBridge bridge(net[0]);
+    int control = bridge.take_control_fd();
+    std::thread thread([&]() { bridge.run(); });
+
+    relay.send(MUX_CHANNEL_BULK, MUX_DATA, pattern(0, MUX_INITIAL_WINDOW + MUX_MAX_PAYLOAD));
+    thread.join();
+    std::string ignored;
+    CHECK(!read_app(control, &ignored, 1000));
+    ::close(control);
+    ::close(net[1]);
+}
+
+// stop başka bir thread'den çağrılınca run döner
+static void test_stop() {
+    int net[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, net) == 0);
+    MuxBridge bridge(net[0]);
+    int control = bridge.take_control_fd();
+    std::thread thread([&]() { bridge.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    bridge.stop();
+    thread.join();
+    CHECK(bridge.open_stream(MUX_CHANNEL_INPUT, MUX_CHANNEL_RFB) == -1);
+    ::close(control);
+    ::close(net[1]);
+}
+
+int main() {
+    test_frames();
+    test_bridge();
+    test_overrun();
+    test_stop();
+    return test::finish("mux_link");
+}
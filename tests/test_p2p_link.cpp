@@ -0,0 +1,212 @@
+// Doğrudan yol: aday listesi ve adres çözümleme, buluşma noktasında gözlenen adres, yerel
+// ağda hole punching ve kayıplı yolda UdpStream'in veriyi eksiksiz, sırayla taşıması
+
+#include "p2p_link.h"
+#include "rendezvous.h"
+#include "test_common.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+static int64_t elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Boş bir UDP portu: çekirdeğin verdiği port bırakılıp buluşma noktasına verilir
+static int free_udp_port() {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, (struct sockaddr*)&address, sizeof(address));
+    socklen_t len = sizeof(address);
+    ::getsockname(fd, (struct sockaddr*)&address, &len);
+    ::close(fd);
+    return ntohs(address.sin_port);
+}
+
+// Adres metinleri iki yönde çözülür; aday listesi doğrulanır, gözlenen adres başa alınır
+static void test_addresses() {
+    struct sockaddr_in address;
+    CHECK(parse_udp_address("10.1.2.3:4567", &address));
+    CHECK(format_udp_address(address) == "10.1.2.3:4567");
+    CHECK(!parse_udp_address("10.1.2.3", &address));
+    CHECK(!parse_udp_address("10.1.2.3:0", &address));
+    CHECK(!parse_udp_address("10.1.2.3:70000", &address));
+    CHECK(!parse_udp_address("host:80", &address));
+
+    std::string candidates;
+    CHECK(parse_p2p_candidates("", &candidates) && candidates.empty());
+    CHECK(parse_p2p_candidates("192.168.1.5:4000  10.0.0.2:4001", &candidates));
+    CHECK(candidates == "192.168.1.5:4000 10.0.0.2:4001");
+    CHECK(!parse_p2p_candidates("192.168.1.5", &candidates));
+    CHECK(!parse_p2p_candidates("192.168.1.5:4000 ::1:5", &candidates));
+    std::string many;
+    for (size_t i = 0; i <= P2P_MAX_CANDIDATES; ++i) many += "10.0.0.1:" + std::to_string(4000 + i) + " ";
+    CHECK(!parse_p2p_candidates(many, &candidates));
+
+    CHECK(prepend_observed_candidate("1.2.3.4:5", "10.0.0.2:6 1.2.3.4:5") == "1.2.3.4:5 10.0.0.2:6");
+    CHECK(prepend_observed_candidate("1.2.3.4:5", "") == "1.2.3.4:5");
+}
+
+// Hole punching'den sonra bir uç: puncher soketin sahibidir, akış onu ödünç alır
+struct Peer {
+    std::unique_ptr<HolePuncher> puncher;
+    std::unique_ptr<UdpStream> stream;
+
+    explicit Peer(const std::string& id) : puncher(new HolePuncher(id)) {}
+
+    void step(const std::string& id) {
+        if (stream) {
+            stream->on_readable();
+            stream->on_timer();
+            return;
+        }
+        puncher->on_timer();
+        if (puncher->on_readable()) {
+            stream.reset(new UdpStream(puncher->fd(), puncher->peer(), puncher->key(), id, 256 * 1024));
+        }
+    }
+    int timeout_ms() const { return stream ? stream->timeout_ms() : puncher->timeout_ms(); }
+};
+
+// İki ucu, en fazla timeout_ms kadar bekleyerek bir adım ilerletir
+static void drive(Peer& a, Peer& b) {
+    struct pollfd fds[2] = {{a.puncher->fd(), POLLIN, 0}, {b.puncher->fd(), POLLIN, 0}};
+    ::poll(fds, 2, std::min(std::min(a.timeout_ms(), b.timeout_ms()), 20));
+    a.step("100001");
+    b.step("100002");
+}
+
+// Uçlar buluşma noktasından gözlenen adreslerini öğrenir, birbirinin adayına PUNCH gönderir ve
+// doğrudan yolu bulur; kayıplı yolda iki yönlü akış eksiksiz ve sırayla ulaşır, bitiş onaylanır
+static void test_punch_and_stream() {
+    EventLoop loop;
+    std::mutex mutex;
+    std::string observed[2];
+    std::atomic<int> bound{0};
+    int port = free_udp_port();
+    RendezvousServer rendezvous(loop, port, [&](ClientId id, const std::string&, const std::string& address) {
+        std::lock_guard<std::mutex> lock(mutex);
+        observed[id - 100001] = address;
+        ++bound;
+    });
+    CHECK(rendezvous.port() == port);
+    rendezvous.expect("token-a", 100001);
+    rendezvous.expect("token-b", 100002);
+    std::thread loop_thread([&]() { loop.run(); });
+
+    Peer a("100001"), b("100002");
+    CHECK(a.puncher->on_bind("127.0.0.1", "token-a " + std::to_string(port)));
+    CHECK(b.puncher->on_bind("127.0.0.1", "token-b " + std::to_string(port)));
+    CHECK(!a.puncher->on_bind("127.0.0.1", "token-a 0"));
+    auto start = std::chrono::steady_clock::now();
+    while (bound < 2 && elapsed_ms(start) < 5000) drive(a, b);
+    CHECK(bound == 2);
+
+    std::string a_address, b_address;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        a_address = observed[0];
+        b_address = observed[1];
+    }
+    struct sockaddr_in a_local = {}, b_local = {};
+    CHECK(parse_udp_address(a_address, &a_local));
+    CHECK(parse_udp_address(b_address, &b_local));
+    // Ulaşılamayan aday yolu engellemez
+    CHECK(a.puncher->on_candidates("key1 127.0.0.1:1 " + b_address));
+    CHECK(b.puncher->on_candidates("key1 " + a_address));
+    CHECK(a.puncher->has_candidates());
+    start = std::chrono::steady_clock::now();
+    while ((!a.stream || !b.stream) && elapsed_ms(start) < 5000) drive(a, b);
+    CHECK(a.stream && b.stream);
+    if (!a.stream || !b.stream) {
+        loop.stop();
+        loop_thread.join();
+        return;
+    }
+    CHECK(format_udp_address(a.puncher->peer()) == b_address);
+    CHECK(format_udp_address(b.puncher->peer()) == a_address);
+
+    a.stream->set_drop_rate(0.05);
+    const size_t up_total = 2 * 1024 * 1024, down_total = 300 * 1024;
+    size_t up_written = 0, down_written = 0;
+    std::string up, down;
+    char buffer[65536];
+    start = std::chrono::steady_clock::now();
+    while (!(b.stream->peer_finished() && a.stream->peer_finished() && a.stream->flushed() &&
+             b.stream->flushed()) && elapsed_ms(start) < 30000) {
+        if (up_written < up_total) {
+            up_written += a.stream->write(pattern(up_written, std::min<size_t>(16384, up_total - up_written)).data(),
+                                          std::min<size_t>(std::min<size_t>(16384, up_total - up_written),
+                                                           a.stream->writable()));
+            if (up_written == up_total) a.stream->finish();
+        }
+        if (down_written < down_total) {
+            size_t n = std::min<size_t>(std::min<size_t>(8192, down_total - down_written), b.stream->writable());
+            down_written += b.stream->write(pattern(down_written, n).data(), n);
+            if (down_written == down_total) b.stream->finish();
+        }
+        drive(a, b);
+        size_t n;
+        while ((n = b.stream->read(buffer, sizeof(buffer))) > 0) up.append(buffer, n);
+        while ((n = a.stream->read(buffer, sizeof(buffer))) > 0) down.append(buffer, n);
+        CHECK(!a.stream->broken() && !b.stream->broken());
+    }
+    CHECK(up == pattern(0, up_total));
+    CHECK(down == pattern(0, down_total));
+    CHECK(a.stream->flushed() && b.stream->flushed());
+    CHECK(a.stream->retransmits() > 0);
+    CHECK(a.stream->bytes_acked() == up_total);
+    CHECK(b.stream->bytes_received() == up_total);
+
+    // Tümü onaylandıktan sonra yeniden gönderilecek veri kalmaz
+    std::string rest;
+    CHECK(a.stream->unacked_from(up_total, &rest) && rest.empty());
+    CHECK(!a.stream->unacked_from(0, &rest));
+    CHECK(!a.stream->unacked_from(up_total + 1, &rest));
+
+    loop.stop();
+    loop_thread.join();
+}
+
+// Onaylanmamış veri, eşin aldığı konumdan itibaren başka yoldan gönderilmek üzere alınabilir
+static void test_unacked() {
+    int fds[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) == 0);
+    struct sockaddr_in nowhere;
+    CHECK(parse_udp_address("127.0.0.1:9", &nowhere));
+    UdpStream stream(fds[0], nowhere, "key", "100001", 4096);
+    std::string data = pattern(0, 10000);
+    CHECK(stream.write(data.data(), data.size()) == 4096);
+    CHECK(stream.writable() == 0);
+    CHECK(stream.bytes_written() == 4096);
+    std::string rest;
+    CHECK(stream.unacked_from(1000, &rest));
+    CHECK(rest == data.substr(1000, 3096));
+    CHECK(!stream.unacked_from(5000, &rest));
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main() {
+    test_addresses();
+    test_punch_and_stream();
+    test_unacked();
+    return test::finish("p2p_link");
+}
@@ -0,0 +1,328 @@
+// RfbCache: el sıkışmasının izlenmesi, Raw/RRE/CopyRect/Hextile güncellemelerinin çerçeve
+// tamponuna uygulanması, kare üretimi, geç izleyicinin relay tarafından karşılanması ve
+// çözülemeyen akışta önbelleğin devre dışı kalması
+
+#include "rfb_cache.h"
+#include "test_common.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint32_t WIDTH = 40;
+static const uint32_t HEIGHT = 20;
+static const uint32_t BPP = 4;
+
+static void put8(std::string* out, uint8_t value) { out->push_back((char)value); }
+static void put16(std::string* out, uint16_t value) {
+    put8(out, value >> 8);
+    put8(out, value & 0xff);
+}
+static void put32(std::string* out, uint32_t value) {
+    put16(out, value >> 16);
+    put16(out, value & 0xffff);
+}
+
+// 32 bpp, 24 bit derinlik, gerçek renk
+static std::string pixel_format() {
+    static const uint8_t format[16] = {32, 24, 0, 1, 0, 255, 0, 255, 0, 255, 16, 8, 0, 0, 0, 0};
+    return std::string(reinterpret_cast<const char*>(format), sizeof(format));
+}
+
+static std::string pixel(uint32_t value) {
+    std::string out;
+    put32(&out, value);
+    return out;
+}
+
+static std::string rect_header(uint16_t x, uint16_t y, uint16_t w, uint16_t h, int32_t encoding) {
+    std::string out;
+    put16(&out, x);
+    put16(&out, y);
+    put16(&out, w);
+    put16(&out, h);
+    put32(&out, (uint32_t)encoding);
+    return out;
+}
+
+static std::string update_header(uint16_t rects) {
+    std::string out;
+    put8(&out, 0);
+    put8(&out, 0);
+    put16(&out, rects);
+    return out;
+}
+
+// Testin beklediği çerçeve tamponu
+struct Framebuffer {
+    std::vector<char> bytes = std::vector<char>(WIDTH * HEIGHT * BPP, 0);
+
+    void fill(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t value) {
+        std::string p = pixel(value);
+        for (uint32_t r = y; r < y + h; ++r) {
+            for (uint32_t c = x; c < x + w; ++c) memcpy(&bytes[(r * WIDTH + c) * BPP], p.data(), BPP);
+        }
+    }
+    std::string raw(uint32_t x, uint32_t y, uint32_t w, uint32_t h) const {
+        std::string out;
+        for (uint32_t r = y; r < y + h; ++r) out.append(&bytes[(r * WIDTH + x) * BPP], w * BPP);
+        return out;
+    }
+};
+
+// Önbelleğin Raw karesindeki piksel verisi (güncelleme ve dikdörtgen başlıklarından sonrası)
+static std::string snapshot_pixels(const RfbCache& cache) {
+    std::string snapshot;
+    cache.snapshot(&snapshot, false);
+    return snapshot.size() > 16 ? snapshot.substr(16) : std::string();
+}
+
+static void feed_bytewise(RfbCache& cache, const std::string& data) {
+    for (char byte : data) CHECK(cache.feed_server(&byte, 1, false) == 1);
+}
+
+// Birincil izleyici ile paylaşan arasındaki 3.8 el sıkışmasını (varsayılan güvenlik: None) önbellekten geçirir
+static void handshake(RfbCache& cache, RfbClientStream& primary, uint8_t security = RfbCache::SECURITY_NONE) {
+    std::string forward, reply;
+    std::string version = "RFB 003.008\n";
+    CHECK(cache.feed_server(version.data(), version.size(), false) == version.size());
+    CHECK(primary.feed(version.data(), version.size(), &forward, &reply));
+    std::string types;
+    put8(&types, 2);
+    put8(&types, RfbCache::SECURITY_NONE);
+    put8(&types, RfbCache::SECURITY_VNC_AUTH);
+    CHECK(cache.feed_server(types.data(), types.size(), false) == types.size());
+    char choice = (char)security;
+    CHECK(primary.feed(&choice, 1, &forward, &reply));
+    if (security == RfbCache::SECURITY_VNC_AUTH) {
+        std::string challenge(16, 'c');
+        cache.feed_server(challenge.data(), challenge.size(), false);
+        CHECK(primary.feed(challenge.data(), challenge.size(), &forward, &reply));
+    }
+    std::string result;
+    put32(&result, 0);
+    cache.feed_server(result.data(), result.size(), false);
+    char shared = 1;
+    CHECK(primary.feed(&shared, 1, &forward, &reply));
+
+    std::string init;
+    put16(&init, WIDTH);
+    put16(&init, HEIGHT);
+    init += pixel_format();
+    put32(&init, 4);
+    init += "test";
+    cache.feed_server(init.data(), init.size(), false);
+    CHECK(reply.empty()); // Birincil izleyiciye relay yanıt vermez; her şey paylaşana gider
+}
+
+// El sıkışması izlenir; birincil izleyicinin SetEncodings'i çözülebilen kodlamalara indirgenir
+static void test_handshake() {
+    RfbCache cache(1 << 20);
+    RfbClientStream primary(cache, true);
+    CHECK(!cache.ready());
+    handshake(cache, primary);
+    CHECK(cache.ready());
+    CHECK(cache.at_boundary());
+    CHECK(!cache.requires_auth());
+    CHECK(cache.version() == "RFB 003.008\n");
+    CHECK(cache.negotiated_minor() == 8);
+
+    std::string set_encodings, forward, reply;
+    put8(&set_encodings, 2);
+    put8(&set_encodings, 0);
+    put16(&set_encodings, 3);
+    put32(&set_encodings, 16); // ZRLE: süzülür
+    put32(&set_encodings, 5);  // Hextile
+    put32(&set_encodings, 0);  // Raw
+    CHECK(primary.feed(set_encodings.data(), set_encodings.size(), &forward, &reply));
+    std::string expected;
+    put8(&expected, 2);
+    put8(&expected, 0);
+    put16(&expected, 2);
+    put32(&expected, 5);
+    put32(&expected, 0);
+    CHECK(forward == expected);
+    CHECK(primary.hextile());
+    CHECK(!RfbCache::supported_encoding(16));
+
+    std::string init;
+    cache.server_init(&init);
+    CHECK(init.size() == 24 + 4);
+    CHECK(init.substr(4, 16) == pixel_format());
+}
+
+// Dikdörtgenler parça sınırlarından bağımsız olarak tampona uygulanır; kare tamponu yansıtır.
+// Hextile kare başka bir önbellekte çözüldüğünde aynı tamponu verir.
+static void test_updates() {
+    RfbCache cache(1 << 20);
+    RfbClientStream primary(cache, true);
+    handshake(cache, primary);
+    Framebuffer expected;
+
+    std::string update = update_header(5);
+    // Raw: tüm ekran, her piksel farklı
+    update += rect_header(0, 0, WIDTH, HEIGHT, 0);
+    for (uint32_t i = 0; i < WIDTH * HEIGHT; ++i) {
+        update += pixel(i * 2654435761u);
+        expected.fill(i % WIDTH, i / WIDTH, 1, 1, i * 2654435761u);
+    }
+    // RRE: arka plan ve bir alt dikdörtgen
+    update += rect_header(2, 3, 10, 6, 2);
+    put32(&update, 1);
+    update += pixel(0x112233);
+    expected.fill(2, 3, 10, 6, 0x112233);
+    update += pixel(0x445566);
+    put16(&update, 1);
+    put16(&update, 2);
+    put16(&update, 4);
+    put16(&update, 3);
+    expected.fill(3, 5, 4, 3, 0x445566);
+    // CopyRect: çakışan kaynaktan
+    update += rect_header(4, 4, 12, 8, 1);
+    put16(&update, 2);
+    put16(&update, 3);
+    std::string moved = expected.raw(2, 3, 12, 8);
+    for (uint32_t r = 0; r < 8; ++r) {
+        for (uint32_t c = 0; c < 12; ++c) memcpy(&expected.bytes[((4 + r) * WIDTH + 4 + c) * BPP], &moved[(r * 12 + c) * BPP], BPP);
+    }
+    // Hextile: 20x16 -> düz renkli karo ve ön plan alt dikdörtgenli karo
+    update += rect_header(16, 2, 20, 16, 5);
+    put8(&update, 2 | 4 | 8); // Arka plan, ön plan, alt dikdörtgenler
+    update += pixel(0x0000ff);
+    update += pixel(0x00ff00);
+    put8(&update, 1);
+    put8(&update, 2 << 4 | 3);
+    put8(&update, 3 << 4 | 1);
+    expected.fill(16, 2, 16, 16, 0x0000ff);
+    expected.fill(18, 5, 4, 2, 0x00ff00);
+    put8(&update, 0); // Önceki arka planla düz
+    expected.fill(32, 2, 4, 16, 0x0000ff);
+    // LastRect: kalan dikdörtgen sayısına bakılmaz
+    update += rect_header(0, 0, 0, 0, -224);
+
+    feed_bytewise(cache, update);
+    CHECK(!cache.failed());
+    CHECK(cache.at_boundary());
+    CHECK(snapshot_pixels(cache) == expected.raw(0, 0, WIDTH, HEIGHT));
+
+    // Mesaj sınırında durma: yarım mesaj tamamlanır, sonraki mesaj işlenmez
+    std::string two = update_header(0) + update_header(0);
+    CHECK(cache.feed_server(two.data(), 1, false) == 1);
+    CHECK(!cache.at_boundary());
+    CHECK(cache.feed_server(two.data() + 1, two.size() - 1, true) == 3);
+    CHECK(cache.at_boundary());
+
+    RfbCache copy(1 << 20);
+    RfbClientStream copy_primary(copy, true);
+    handshake(copy, copy_primary);
+    CHECK(copy.ready());
+    std::string hextile;
+    cache.snapshot(&hextile, true);
+    CHECK(hextile.size() < 16 + WIDTH * HEIGHT * BPP + 100);
+    CHECK(copy.feed_server(hextile.data(), hextile.size(), false) == hextile.size());
+    CHECK(snapshot_pixels(copy) == expected.raw(0, 0, WIDTH, HEIGHT));
+}
+
+// Geç izleyicinin el sıkışmasını relay yanıtlar; tam ekran isteği önbellekten karşılanır, giriş
+// mesajları paylaşana yalnızca tamamlandığında gider, izleyicinin biçim seçimleri iletilmez
+static void test_late_viewer() {
+    RfbCache cache(1 << 20);
+    RfbClientStream primary(cache, true);
+    handshake(cache, primary);
+
+    RfbClientStream late(cache, false);
+    std::string forward, reply;
+    late.start(&reply);
+    CHECK(late.started());
+    CHECK(reply == "RFB 003.008\n");
+    reply.clear();
+    CHECK(late.feed("RFB 003.008\n", 12, &forward, &reply));
+    CHECK(reply == std::string("\x01\x01", 2));
+    reply.clear();
+    CHECK(late.feed("\x01", 1, &forward, &reply));
+    CHECK(reply == std::string(4, '\0'));
+    reply.clear();
+    CHECK(late.feed("\x01", 1, &forward, &reply));
+    std::string init;
+    cache.server_init(&init);
+    CHECK(reply == init);
+    CHECK(forward.empty());
+
+    std::string request;
+    put8(&request, 3);
+    put8(&request, 0); // Artımlı değil
+    put16(&request, 0);
+    put16(&request, 0);
+    put16(&request, WIDTH);
+    put16(&request, HEIGHT);
+    CHECK(late.feed(request.data(), request.size(), &forward, &reply));
+    CHECK(forward.empty());
+    CHECK(late.take_snapshot_request());
+    CHECK(!late.take_snapshot_request());
+    request[1] = 1; // Artımlı istek paylaşana gider
+    CHECK(late.feed(request.data(), request.size(), &forward, &reply));
+    CHECK(forward == request);
+    forward.clear();
+
+    std::string key = std::string("\x04\x01\0\0\0\0\xff\x0d", 8);
+    CHECK(late.feed(key.data(), 5, &forward, &reply));
+    CHECK(forward.empty());
+    CHECK(late.pending() == 5);
+    CHECK(late.feed(key.data() + 5, 3, &forward, &reply));
+    CHECK(forward == key);
+    forward.clear();
+
+    std::string set_format;
+    put8(&set_format, 0);
+    set_format.append(3, '\0');
+    set_format += pixel_format();
+    CHECK(late.feed(set_format.data(), set_format.size(), &forward, &reply));
+    CHECK(forward.empty());
+
+    // Geç izleyici bilinmeyen mesaj gönderirse çıkarılır
+    CHECK(!late.feed("\x7f", 1, &forward, &reply));
+}
+
+// Çözülemeyen kodlama önbelleği kalıcı olarak kapatır; parola korumalı yayında ve devre dışı
+// önbellekte geç izleyici reddedilir
+static void test_refusals() {
+    RfbCache cache(1 << 20);
+    RfbClientStream primary(cache, true);
+    handshake(cache, primary);
+    std::string update = update_header(1) + rect_header(0, 0, 8, 8, 16); // ZRLE
+    cache.feed_server(update.data(), update.size(), false);
+    CHECK(cache.failed());
+    CHECK(!cache.ready());
+
+    RfbClientStream late(cache, false);
+    std::string forward, reply;
+    late.start(&reply);
+    reply.clear();
+    CHECK(late.feed("RFB 003.008\n", 12, &forward, &reply));
+    CHECK(reply.size() > 5 && reply[0] == 0); // Güvenlik türü yok: ret nedeni
+    CHECK(late.feed("x", 1, &forward, &reply));
+
+    RfbCache protected_cache(1 << 20);
+    RfbClientStream protected_primary(protected_cache, true);
+    handshake(protected_cache, protected_primary, RfbCache::SECURITY_VNC_AUTH);
+    CHECK(protected_cache.ready());
+    CHECK(protected_cache.requires_auth());
+    RfbClientStream refused(protected_cache, false);
+    reply.clear();
+    CHECK(refused.feed("RFB 003.008\n", 12, &forward, &reply));
+    CHECK(reply.size() > 5 && reply[0] == 0);
+
+    // Çerçeve tamponu bellek sınırına sığmıyorsa önbellek açılmaz
+    RfbCache small(WIDTH * HEIGHT * BPP - 1);
+    RfbClientStream small_primary(small, true);
+    handshake(small, small_primary);
+    CHECK(small.failed());
+}
+
+int main() {
+    test_handshake();
+    test_updates();
+    test_late_viewer();
+    test_refusals();
+    return test::finish("rfb_cache");
+}
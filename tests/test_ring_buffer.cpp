@@ -0,0 +1,220 @@
+// RingBuffer: kapasite, sarmalanan yazma, saklama (retain) ve geri alma (rewind), soketten/sokete aktarım
+
+#include "ring_buffer.h"
+#include "test_common.h"
+
+#include <string>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+static std::string pattern(size_t len, char seed) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)(seed + i * 7);
+    return data;
+}
+
+static std::string read_exactly(int fd, size_t len) {
+    std::string out(len, '\0');
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = ::read(fd, &out[got], len - got);
+        if (n <= 0) break;
+        got += n;
+    }
+    out.resize(got);
+    return out;
+}
+
+// Kapasite ikinin kuvvetine yuvarlanır; bellek ilk yazımda ayrılır
+static void test_capacity() {
+    RingBuffer buffer(1000);
+    CHECK(buffer.capacity() == 1024);
+    CHECK(buffer.free_space() == 1024);
+    CHECK(buffer.empty());
+
+    RingBuffer none;
+    CHECK(none.write("x", 1) == 0);
+}
+
+// Yazma boş alanla sınırlıdır; gönderilen veri yer açar ve yazım sona sarar
+static void test_wraparound() {
+    int pair[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    RingBuffer buffer(16);
+    std::string first = pattern(12, 'a');
+    CHECK(buffer.write(first.data(), first.size()) == 12);
+    CHECK(buffer.write(first.data(), first.size()) == 4); // Yalnızca boş alan kadar
+    CHECK(buffer.size() == 16);
+    CHECK(buffer.free_space() == 0);
+
+    CHECK(buffer.send_to_socket(pair[0]) == 16);
+    CHECK(read_exactly(pair[1], 16) == first + first.substr(0, 4));
+    CHECK(buffer.empty());
+
+    // Sarılan veri iki parça halinde tek çağrıda gönderilir
+    std::string second = pattern(10, 'k');
+    std::string third = pattern(10, 'u');
+    CHECK(buffer.write(second.data(), second.size()) == 10);
+    CHECK(buffer.send_to_socket(pair[0]) == 10);
+    CHECK(read_exactly(pair[1], 10) == second);
+    CHECK(buffer.write(third.data(), third.size()) == 10);
+    CHECK(buffer.send_to_socket(pair[0]) == 10);
+    CHECK(read_exactly(pair[1], 10) == third);
+
+    buffer.write(first.data(), 5);
+    buffer.clear();
+    CHECK(buffer.empty());
+    CHECK(buffer.free_space() == 16);
+
+    ::close(pair[0]);
+    ::close(pair[1]);
+}
+
+// retain: gönderilen son retain byte boş alandan düşer, rewind ile yeniden gönderilecek veriye döner
+static void test_retain_rewind() {
+    int pair[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    RingBuffer buffer(64, 16);
+    std::string data = pattern(40, '0');
+    CHECK(buffer.write(data.data(), data.size()) == 40);
+
+    CHECK(buffer.send_to_socket(pair[0]) == 40);
+    CHECK(read_exactly(pair[1], 40) == data);
+    CHECK(buffer.empty());
+    CHECK(buffer.free_space() == 64 - 16); // En fazla retain byte saklanır
+
+    CHECK(!buffer.rewind(17)); // Saklanmayan veri geri alınamaz, tampon değişmez
+    CHECK(buffer.empty());
+    CHECK(buffer.rewind(6));
+    CHECK(buffer.size() == 6);
+    CHECK(buffer.send_to_socket(pair[0]) == 6);
+    CHECK(read_exactly(pair[1], 6) == data.substr(34));
+
+    // Saklanan veri üzerine yazılmaz: boş alan dolunca yazım durur
+    std::string more = pattern(64, 'm');
+    CHECK(buffer.write(more.data(), more.size()) == 48);
+    CHECK(buffer.send_to_socket(pair[0]) == 48);
+    CHECK(read_exactly(pair[1], 48) == more.substr(0, 48));
+
+    // Sarılan saklama alanı da geri alınabilir
+    CHECK(buffer.rewind(16));
+    CHECK(buffer.send_to_socket(pair[0]) == 16);
+    CHECK(read_exactly(pair[1], 16) == more.substr(32, 16));
+
+    // Saklama yoksa boşalan tampon başa döner ve hiçbir şey geri alınamaz
+    RingBuffer plain(32);
+    plain.write(data.data(), 20);
+    CHECK(plain.send_to_socket(pair[0]) == 20);
+    CHECK(read_exactly(pair[1], 20) == data.substr(0, 20));
+    CHECK(!plain.rewind(1));
+    CHECK(plain.free_space() == 32);
+
+    ::close(pair[0]);
+    ::close(pair[1]);
+}
+
+// Soketten doğrudan tampona okuma boş alanla ve max_bytes ile sınırlıdır
+static void test_read_from_fd() {
+    int in[2], out[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, in) == 0);
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, out) == 0);
+    RingBuffer incoming(8);
+    CHECK(::write(in[1], "0123456789", 10) == 10);
+    CHECK(incoming.read_from_fd(in[0], 3) == 3);
+    CHECK(incoming.read_from_fd(in[0], 100) == 5); // Boş alanla sınırlı
+    CHECK(incoming.free_space() == 0);
+    CHECK(incoming.send_to_socket(out[0]) == 8);
+    CHECK(read_exactly(out[1], 8) == "01234567");
+    CHECK(incoming.read_from_fd(in[0], 100) == 2);
+    CHECK(incoming.send_to_socket(out[0]) == 2);
+    CHECK(read_exactly(out[1], 2) == "89");
+
+    ::close(in[1]);
+    CHECK(incoming.read_from_fd(in[0], 100) == 0); // Karşı uç kapandı
+    ::close(in[0]);
+    ::close(out[0]);
+    ::close(out[1]);
+}
+
+// discard baştaki veriyi gönderilmiş sayar: saklanıyorsa geri alınabilir; copy_to saklanan ve
+// bekleyen veriyi birlikte verir
+static void test_discard_copy() {
+    RingBuffer buffer(64, 16);
+    std::string data = pattern(40, 'd');
+    CHECK(buffer.write(data.data(), data.size()) == 40);
+    buffer.discard(10);
+    CHECK(buffer.size() == 30);
+    CHECK(buffer.retained() == 10);
+    CHECK(buffer.free_space() == 64 - 40); // Saklanan veri üzerine yazılmaz
+    buffer.discard(20);
+    CHECK(buffer.retained() == 16);
+    CHECK(buffer.free_space() == 64 - 16 - 10);
+
+    std::string copy;
+    buffer.copy_to(&copy);
+    CHECK(copy == data.substr(14));
+    CHECK(buffer.rewind(16));
+    CHECK(buffer.size() == 26);
+    buffer.discard(26);
+    CHECK(buffer.empty());
+    CHECK(buffer.retained() == 16);
+}
+
+// tail_iov son yazılan veriyi kopyalamadan gösterir; sarılmış veri iki parçadır
+static void test_tail_iov() {
+    RingBuffer buffer(16);
+    std::string first = pattern(12, 'a');
+    CHECK(buffer.write(first.data(), first.size()) == 12);
+    struct iovec iov[2];
+    CHECK(buffer.tail_iov(0, iov) == 0);
+    CHECK(buffer.tail_iov(5, iov) == 1);
+    CHECK(std::string((char*)iov[0].iov_base, iov[0].iov_len) == first.substr(7));
+
+    buffer.discard(10);
+    std::string second = pattern(10, 'k');
+    CHECK(buffer.write(second.data(), second.size()) == 10);
+    CHECK(buffer.tail_iov(12, iov) == 2);
+    CHECK(iov[0].iov_len + iov[1].iov_len == 12);
+    std::string tail = std::string((char*)iov[0].iov_base, iov[0].iov_len) +
+                       std::string((char*)iov[1].iov_base, iov[1].iov_len);
+    CHECK(tail == first.substr(10) + second);
+}
+
+// peek veriyi tampondan çıkarmadan kopyalar; truncate bekleyen veriyi sondan kısaltır
+static void test_peek_truncate() {
+    RingBuffer buffer(16);
+    std::string first = pattern(12, 'p');
+    buffer.write(first.data(), first.size());
+    buffer.discard(10);
+    std::string second = pattern(10, 't');
+    buffer.write(second.data(), second.size());
+    std::string expected = first.substr(10) + second;
+
+    char middle[6];
+    CHECK(buffer.peek(0, middle, sizeof(middle)) == 6);
+    CHECK(std::string(middle, 6) == expected.substr(0, 6));
+    CHECK(buffer.peek(9, middle, sizeof(middle)) == 3); // Sarılan veri
+    CHECK(std::string(middle, 3) == expected.substr(9));
+    CHECK(buffer.peek(buffer.size(), middle, 1) == 0);
+    CHECK(buffer.size() == 12);
+
+    buffer.truncate(4);
+    CHECK(buffer.size() == 4);
+    CHECK(buffer.peek(0, middle, sizeof(middle)) == 4);
+    CHECK(std::string(middle, 4) == expected.substr(0, 4));
+    buffer.truncate(100); // Daha uzunsa değişmez
+    CHECK(buffer.size() == 4);
+}
+
+int main() {
+    test_capacity();
+    test_wraparound();
+    test_retain_rewind();
+    test_read_from_fd();
+    test_discard_copy();
+    test_tail_iov();
+    test_peek_truncate();
+    return test::finish("ring_buffer");
+}
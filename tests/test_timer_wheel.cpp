@@ -0,0 +1,171 @@
+// TimerWheel: süre dolumu, üst seviyelerden taşıma (cascade), iptal ve callback içinden kurma/iptal
+
+#include "timer_wheel.h"
+#include "test_common.h"
+
+#include <memory>
+#include <vector>
+
+static uint64_t fake_now_ns = 0;
+
+static uint64_t fake_clock() {
+    return fake_now_ns;
+}
+
+static const uint64_t TICK_MS = 10;
+
+// Saat ve çark birlikte ilerler (relay'de timerfd'nin yaptığı gibi)
+static void advance_to(TimerWheel& wheel, uint64_t ms) {
+    fake_now_ns = ms * 1000000;
+    wheel.advance(ms);
+}
+
+// Zamanlayıcı süresinin dolduğu tick'te, en geç bir tick sonra çalışır
+static void test_expiry() {
+    fake_now_ns = 0;
+    TimerWheel wheel(nullptr, TICK_MS, fake_clock);
+    TimerWheel::Timer timer;
+    uint64_t fired_at = 0;
+    timer.callback = [&]() { fired_at = wheel.now_ms(); };
+    wheel.arm(timer, 25);
+    CHECK(timer.armed());
+    CHECK(wheel.size() == 1);
+    advance_to(wheel, 29);
+    CHECK(fired_at == 0);
+    advance_to(wheel, 30);
+    CHECK(fired_at == 30);
+    CHECK(!timer.armed());
+    CHECK(wheel.size() == 0);
+}
+
+// Her seviyeye düşen süreler üst seviyelerden taşınarak zamanında çalışır
+static void test_cascade() {
+    fake_now_ns = 0;
+    TimerWheel wheel(nullptr, TICK_MS, fake_clock);
+    // Tick cinsinden: seviye 0, 1, 2 ve 3; seviye sınırlarının iki yanı dahil
+    const uint64_t ticks[] = {1, 63, 64, 65, 100, 4095, 4096, 4097, 70000, 262143, 262144, 300001};
+    const size_t count = sizeof(ticks) / sizeof(ticks[0]);
+    std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+    std::vector<uint64_t> fired(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        timers.emplace_back(new TimerWheel::Timer());
+        timers[i]->callback = [&wheel, &fired, i]() { fired[i] = wheel.now_ms(); };
+        wheel.arm(*timers[i], ticks[i] * TICK_MS);
+    }
+    CHECK(wheel.size() == count);
+
+    // Tek adımda ilerletmek de her tick'i sırayla işler
+    advance_to(wheel, 70000 * TICK_MS);
+    for (size_t i = 0; i < count; ++i) {
+        if (ticks[i] <= 70000) {
+            CHECK(fired[i] == ticks[i] * TICK_MS);
+        } else {
+            CHECK(fired[i] == 0);
+        }
+    }
+    advance_to(wheel, 400000 * TICK_MS);
+    for (size_t i = 0; i < count; ++i) CHECK(fired[i] == ticks[i] * TICK_MS);
+    CHECK(wheel.size() == 0);
+}
+
+// İptal edilen zamanlayıcı, alt seviyeye taşınmış olsa da çalışmaz; yok edilen kendini çıkarır
+static void test_cancel() {
+    fake_now_ns = 0;
+    TimerWheel wheel(nullptr, TICK_MS, fake_clock);
+    int fired = 0;
+    TimerWheel::Timer near_timer, far_timer;
+    near_timer.callback = far_timer.callback = [&]() { ++fired; };
+    wheel.arm(near_timer, 50);
+    wheel.arm(far_timer, 5000 * TICK_MS);
+    wheel.cancel(near_timer);
+    CHECK(!near_timer.armed());
+    CHECK(wheel.size() == 1);
+    wheel.cancel(near_timer); // Kurulu değilse bir şey yapmaz
+    CHECK(wheel.size() == 1);
+
+    advance_to(wheel, 4500 * TICK_MS); // far_timer seviye 2'den alt seviyeye taşındı
+    CHECK(far_timer.armed());
+    wheel.cancel(far_timer);
+    advance_to(wheel, 6000 * TICK_MS);
+    CHECK(fired == 0);
+    CHECK(wheel.size() == 0);
+
+    {
+        TimerWheel::Timer scoped;
+        scoped.callback = [&]() { ++fired; };
+        wheel.arm(scoped, 100);
+        CHECK(wheel.size() == 1);
+    }
+    CHECK(wheel.size() == 0);
+    advance_to(wheel, 7000 * TICK_MS);
+    CHECK(fired == 0);
+
+    // Yeniden kurma öncekini iptal eder
+    TimerWheel::Timer rearmed;
+    uint64_t fired_at = 0;
+    rearmed.callback = [&]() { fired_at = wheel.now_ms(); };
+    wheel.arm(rearmed, 100);
+    wheel.arm(rearmed, 300);
+    CHECK(wheel.size() == 1);
+    advance_to(wheel, 7000 * TICK_MS + 200);
+    CHECK(fired_at == 0);
+    advance_to(wheel, 7000 * TICK_MS + 300);
+    CHECK(fired_at == 7000 * TICK_MS + 300);
+}
+
+// Callback kendini yeniden kurabilir ve aynı tick'teki başka bir zamanlayıcıyı iptal edebilir
+static void test_callbacks() {
+    fake_now_ns = 0;
+    TimerWheel wheel(nullptr, TICK_MS, fake_clock);
+    TimerWheel::Timer periodic, victim, killer;
+    std::vector<uint64_t> ticks;
+    periodic.callback = [&]() {
+        ticks.push_back(wheel.now_ms());
+        if (ticks.size() < 5) wheel.arm(periodic, 1000);
+    };
+    wheel.arm(periodic, 1000);
+    bool victim_fired = false;
+    victim.callback = [&]() { victim_fired = true; };
+    killer.callback = [&]() { wheel.cancel(victim); };
+    wheel.arm(killer, 200);
+    wheel.arm(victim, 200);
+    // Yeniden kurma gerçek saate göredir; saat relay'deki gibi tick tick ilerler
+    for (uint64_t ms = TICK_MS; ms <= 10000; ms += TICK_MS) advance_to(wheel, ms);
+    CHECK(ticks.size() == 5);
+    for (size_t i = 0; i < ticks.size(); ++i) CHECK(ticks[i] == (i + 1) * 1000);
+    CHECK(!victim_fired);
+    CHECK(wheel.size() == 0);
+}
+
+// Boş çark ilerletilmese de süre kurma anındaki saate göre hesaplanır; kapsamdan uzun süreler kırpılır
+static void test_clock_and_clamp() {
+    fake_now_ns = 0;
+    TimerWheel wheel(nullptr, TICK_MS, fake_clock);
+    fake_now_ns = 10000ull * 1000000; // Çark bu sürede hiç ilerletilmedi
+    TimerWheel::Timer timer;
+    uint64_t fired_at = 0;
+    timer.callback = [&]() { fired_at = wheel.now_ms(); };
+    wheel.arm(timer, 100);
+    advance_to(wheel, 10090);
+    CHECK(fired_at == 0);
+    advance_to(wheel, 10100);
+    CHECK(fired_at == 10100);
+
+    const uint64_t range_ticks = (1ull << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS)) - 1;
+    fired_at = 0;
+    wheel.arm(timer, range_ticks * TICK_MS * 4);
+    uint64_t start = wheel.now_ms();
+    advance_to(wheel, start + (range_ticks - 1) * TICK_MS);
+    CHECK(fired_at == 0);
+    advance_to(wheel, start + (range_ticks + 1) * TICK_MS);
+    CHECK(fired_at == start + range_ticks * TICK_MS);
+}
+
+int main() {
+    test_expiry();
+    test_cascade();
+    test_cancel();
+    test_callbacks();
+    test_clock_and_clamp();
+    return test::finish("timer_wheel");
+}
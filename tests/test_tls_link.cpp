@@ -0,0 +1,301 @@
+// TlsLink: bağlam hataları, loopback üzerinde TLS 1.3 el sıkışması ve sertifika doğrulama, kTLS'e
+// geçiş (çekirdek destekliyorsa düz soket, desteklemiyorsa kullanıcı alanı TLS), TlsBridge aktarımı ve kapanışı
+
+#include "tls_link.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+// Öz imzalı sertifika ve anahtarı geçici PEM dosyalarına yazar (TlsContext::server dosya bekler)
+static bool write_self_signed(std::string* cert_path, std::string* key_path) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    if (!key || !cert) return false;
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("relay-test"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    char cert_template[] = "/tmp/tls_test_cert_XXXXXX";
+    char key_template[] = "/tmp/tls_test_key_XXXXXX";
+    int cert_fd = ok ? mkstemp(cert_template) : -1;
+    int key_fd = ok ? mkstemp(key_template) : -1;
+    FILE* cert_file = cert_fd >= 0 ? fdopen(cert_fd, "w") : nullptr;
+    FILE* key_file = key_fd >= 0 ? fdopen(key_fd, "w") : nullptr;
+    ok = cert_file && key_file && PEM_write_X509(cert_file, cert) &&
+         PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr);
+    if (cert_file) fclose(cert_file);
+    if (key_file) fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    *cert_path = cert_template;
+    *key_path = key_template;
+    return ok;
+}
+
+// Loopback üzerinde engellemeyen bir TCP bağlantısının iki ucu (kTLS yalnızca TCP'de çalışır)
+static bool tcp_pair(int* server_fd, int* client_fd) {
+    int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(address);
+    if (::bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 || ::listen(listen_fd, 1) != 0 ||
+        ::getsockname(listen_fd, (struct sockaddr*)&address, &len) != 0) {
+        ::close(listen_fd);
+        return false;
+    }
+    *client_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    bool ok = ::connect(*client_fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+    *server_fd = ok ? ::accept(listen_fd, nullptr, nullptr) : -1;
+    ::close(listen_fd);
+    ::fcntl(*server_fd, F_SETFL, O_NONBLOCK);
+    ::fcntl(*client_fd, F_SETFL, O_NONBLOCK);
+    return ok && *server_fd >= 0;
+}
+
+// İki ucun el sıkışmasını aynı thread'de sırayla ilerletir; ikisi de bitince veya biri başarısız
+// olunca döner
+static void handshake_both(TlsStream& server, TlsStream& client, TlsResult* server_result, TlsResult* client_result) {
+    *server_result = *client_result = TLS_WANT_READ;
+    for (int i = 0; i < 1000; ++i) {
+        if (*client_result != TLS_DONE && *client_result != TLS_FAILED) *client_result = client.handshake();
+        if (*server_result != TLS_DONE && *server_result != TLS_FAILED) *server_result = server.handshake();
+        bool client_over = *client_result == TLS_DONE || *client_result == TLS_FAILED;
+        bool server_over = *server_result == TLS_DONE || *server_result == TLS_FAILED;
+        if ((client_over && server_over) || *client_result == TLS_FAILED || *server_result == TLS_FAILED) return;
+        struct pollfd fds[2] = {{server.fd(), POLLIN, 0}, {client.fd(), POLLIN, 0}};
+        ::poll(fds, 2, 10);
+    }
+}
+
+// Engellemeyen uçlar arasında iki yönde eşzamanlı veri taşır; read/write 0 veya EAGAIN döndürebilir
+template <typename Read, typename Write>
+static void transfer(size_t total, Read read_a, Write write_a, Read read_b, Write write_b, std::string* at_a,
+                     std::string* at_b, int fd_a, int fd_b) {
+    size_t sent_a = 0, sent_b = 0;
+    char chunk[16384];
+    for (int i = 0; i < 20000 && (at_a->size() < total || at_b->size() < total); ++i) {
+        if (sent_a < total) {
+            std::string data = pattern(sent_a, std::min<size_t>(sizeof(chunk), total - sent_a));
+            ssize_t n = write_a(data.data(), data.size());
+            if (n > 0) sent_a += n;
+        }
+        if (sent_b < total) {
+            std::string data = pattern(sent_b + 1, std::min<size_t>(sizeof(chunk), total - sent_b));
+            ssize_t n = write_b(data.data(), data.size());
+            if (n > 0) sent_b += n;
+        }
+        ssize_t n;
+        while ((n = read_a(chunk, sizeof(chunk))) > 0) at_a->append(chunk, n);
+        while ((n = read_b(chunk, sizeof(chunk))) > 0) at_b->append(chunk, n);
+        struct pollfd fds[2] = {{fd_a, POLLIN, 0}, {fd_b, POLLIN, 0}};
+        ::poll(fds, 2, 1);
+    }
+}
+
+// Okunamayan sertifika, anahtar veya CA dosyası bağlam oluşturmayı std::runtime_error ile durdurur
+static void test_context_errors(const std::string& cert, const std::string& key) {
+    bool thrown = false;
+    try {
+        TlsContext::server("/nonexistent/relay.crt", key);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try {
+        TlsContext::server(cert, cert);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try {
+        TlsContext::client("/nonexistent/ca.crt");
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(TlsContext::client("") != nullptr);
+}
+
+// CA verilen istemci yalnızca o sertifikayı sunan relay'e bağlanır
+static void test_verify(const TlsContext& server_context, const std::string& cert, const std::string& other_cert) {
+    std::unique_ptr<TlsContext> trusting = TlsContext::client(cert);
+    std::unique_ptr<TlsContext> stranger = TlsContext::client(other_cert);
+    const TlsContext* clients[2] = {trusting.get(), stranger.get()};
+    for (int i = 0; i < 2; ++i) {
+        int server_fd, client_fd;
+        CHECK(tcp_pair(&server_fd, &client_fd));
+        TlsStream server(server_context, server_fd);
+        TlsStream client(*clients[i], client_fd);
+        TlsResult server_result, client_result;
+        handshake_both(server, client, &server_result, &client_result);
+        if (i == 0) {
+            CHECK(server_result == TLS_DONE && client_result == TLS_DONE);
+        } else {
+            CHECK(client_result == TLS_FAILED);
+        }
+        ::close(server_fd);
+        ::close(client_fd);
+    }
+}
+
+// El sıkışmadan sonra iki uç kTLS'e geçer. Çekirdek destekliyorsa soketler düz metin taşır; tls
+// modülü yoksa geçiş UNSUPPORTED ile reddedilir ve oturum kullanıcı alanı TLS ile sürer.
+static void test_ktls(TlsContext& server_context, TlsContext& client_context, bool native) {
+    // native: anahtarları el sıkışmada OpenSSL kursun (SSL_OP_ENABLE_KTLS); değilse enable_ktls kurar
+    server_context.set_ktls(native);
+    client_context.set_ktls(native);
+    int server_fd, client_fd;
+    CHECK(tcp_pair(&server_fd, &client_fd));
+    TlsStream server(server_context, server_fd);
+    TlsStream client(client_context, client_fd);
+    TlsResult server_result, client_result;
+    handshake_both(server, client, &server_result, &client_result);
+    CHECK(server_result == TLS_DONE && client_result == TLS_DONE);
+    CHECK(!server.cipher_name().empty());
+    CHECK(server.cipher_name() == client.cipher_name());
+
+    std::string server_reason, client_reason;
+    KtlsResult server_ktls = server.enable_ktls(&server_reason);
+    KtlsResult client_ktls = client.enable_ktls(&client_reason);
+    CHECK(server_ktls != KTLS_FAILED && client_ktls != KTLS_FAILED);
+    if (server_ktls == KTLS_UNSUPPORTED) CHECK(!server_reason.empty());
+    if (client_ktls == KTLS_UNSUPPORTED) CHECK(!client_reason.empty());
+
+    const size_t total = 1024 * 1024;
+    std::string at_server, at_client;
+    auto raw_read = [](int fd) {
+        return [fd](char* data, size_t len) -> ssize_t { return ::read(fd, data, len); };
+    };
+    auto raw_write = [](int fd) {
+        return [fd](const char* data, size_t len) -> ssize_t { return ::send(fd, data, len, MSG_NOSIGNAL); };
+    };
+    if (server_ktls == KTLS_ENABLED && client_ktls == KTLS_ENABLED) {
+        transfer(total, raw_read(server_fd), raw_write(server_fd), raw_read(client_fd), raw_write(client_fd),
+                 &at_server, &at_client, server_fd, client_fd);
+    } else if (server_ktls == KTLS_UNSUPPORTED && client_ktls == KTLS_UNSUPPORTED) {
+        auto tls_read = [](TlsStream& stream) {
+            return [&stream](char* data, size_t len) -> ssize_t { return stream.read(data, len); };
+        };
+        auto tls_write = [](TlsStream& stream) {
+            return [&stream](const char* data, size_t len) -> ssize_t { return stream.write(data, len); };
+        };
+        std::function<ssize_t(char*, size_t)> read_server = tls_read(server), read_client = tls_read(client);
+        std::function<ssize_t(const char*, size_t)> write_server = tls_write(server), write_client = tls_write(client);
+        transfer(total, read_server, write_server, read_client, write_client, &at_server, &at_client, server_fd,
+                 client_fd);
+    }
+    // Uçlardan biri kTLS'e geçip diğeri geçemezse (farklı çekirdek yetenekleri) aktarım denenmez
+    if (server_ktls == client_ktls) {
+        CHECK(at_server == pattern(1, total));
+        CHECK(at_client == pattern(0, total));
+    }
+    ::close(server_fd);
+    ::close(client_fd);
+}
+
+// Köprü relay'in düz soketiyle TLS ucu arasında iki yönde taşır; relay ucu kapatınca kalan veri
+// gönderilir, close_notify yollanır ve köprü biter; istemci bunu bağlantı sonu olarak okur
+static void test_bridge(const TlsContext& server_context, const TlsContext& client_context) {
+    int server_fd, client_fd;
+    CHECK(tcp_pair(&server_fd, &client_fd));
+    std::unique_ptr<TlsStream> server(new TlsStream(server_context, server_fd));
+    TlsStream client(client_context, client_fd);
+    TlsResult server_result, client_result;
+    handshake_both(*server, client, &server_result, &client_result);
+    CHECK(server_result == TLS_DONE && client_result == TLS_DONE);
+
+    int plain[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, plain) == 0);
+    TlsBridge bridge(std::move(server), plain[0]);
+    CHECK(bridge.tls_fd() == server_fd && bridge.plain_fd() == plain[0]);
+    CHECK(bridge.tls_events() & POLLIN);
+    CHECK(bridge.plain_events() & POLLIN);
+
+    const size_t total = 512 * 1024;
+    std::string at_relay, at_client;
+    std::function<ssize_t(char*, size_t)> read_relay = [&](char* data, size_t len) -> ssize_t {
+        CHECK(bridge.pump());
+        return ::read(plain[1], data, len);
+    };
+    std::function<ssize_t(const char*, size_t)> write_relay = [&](const char* data, size_t len) -> ssize_t {
+        return ::send(plain[1], data, len, MSG_NOSIGNAL);
+    };
+    std::function<ssize_t(char*, size_t)> read_client = [&](char* data, size_t len) -> ssize_t {
+        return client.read(data, len);
+    };
+    std::function<ssize_t(const char*, size_t)> write_client = [&](const char* data, size_t len) -> ssize_t {
+        return client.write(data, len);
+    };
+    transfer(total, read_relay, write_relay, read_client, write_client, &at_relay, &at_client, plain[1], client_fd);
+    CHECK(at_relay == pattern(1, total));
+    CHECK(at_client == pattern(0, total));
+
+    // Relay tarafı kapanır: köprü bitince istemci close_notify'ı 0 olarak okur
+    std::string tail = pattern(7, 1000);
+    CHECK(::send(plain[1], tail.data(), tail.size(), MSG_NOSIGNAL) == (ssize_t)tail.size());
+    ::close(plain[1]);
+    bool finished = false;
+    for (int i = 0; i < 1000 && !finished; ++i) finished = !bridge.pump();
+    CHECK(finished);
+    std::string rest;
+    char chunk[4096];
+    ssize_t n = -1;
+    for (int i = 0; i < 1000; ++i) {
+        n = client.read(chunk, sizeof(chunk));
+        if (n > 0) rest.append(chunk, n);
+        if (n == 0) break;
+        struct pollfd pfd = {client_fd, POLLIN, 0};
+        ::poll(&pfd, 1, 10);
+    }
+    CHECK(n == 0);
+    CHECK(rest == tail);
+    ::close(client_fd);
+}
+
+int main() {
+    std::string cert, key, other_cert, other_key;
+    CHECK(write_self_signed(&cert, &key));
+    CHECK(write_self_signed(&other_cert, &other_key));
+    test_context_errors(cert, key);
+    std::unique_ptr<TlsContext> server_context = TlsContext::server(cert, key);
+    std::unique_ptr<TlsContext> client_context = TlsContext::client("");
+    test_verify(*server_context, cert, other_cert);
+    test_ktls(*server_context, *client_context, false);
+    test_ktls(*server_context, *client_context, true);
+    server_context->set_ktls(false);
+    client_context->set_ktls(false);
+    test_bridge(*server_context, *client_context);
+    for (const std::string& path : {cert, key, other_cert, other_key}) ::unlink(path.c_str());
+    return test::finish("tls_link");
+}
@@ -0,0 +1,141 @@
+// Tünel sıkıştırması: seviye değişimleri (uyarlama ve saklanan bloklar) akış sürerken yapılsa da
+// çözücü akışı parça sınırlarından bağımsız olarak aynen geri verir
+
+#include "tunnel_compression.h"
+#include "test_common.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// RFB benzeri sıkıştırılabilir parça: tekrarlanan pikseller ve az değişen satırlar
+static std::string framebuffer_chunk(size_t len, unsigned seed) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)(((i / 64) * 3 + seed) & 0x3f);
+    return data;
+}
+
+// Zaten sıkıştırılmış (JPEG benzeri) parça
+static std::string random_chunk(size_t len, std::mt19937& rng) {
+    std::string data(len, '\0');
+    for (char& c : data) c = (char)rng();
+    return data;
+}
+
+// Sıkıştırılmış akış ve düz metin; akış farklı boyutlu parçalarla çözülür
+struct Transcript {
+    std::string plain;
+    std::string coded;
+};
+
+static bool decodes_to(const Transcript& transcript, size_t piece) {
+    TunnelDecompressor decompressor;
+    std::string out;
+    for (size_t offset = 0; offset < transcript.coded.size(); offset += piece) {
+        size_t len = std::min(piece, transcript.coded.size() - offset);
+        if (!decompressor.decompress(transcript.coded.data() + offset, len, &out)) return false;
+    }
+    return out == transcript.plain && decompressor.bytes_out() == transcript.plain.size();
+}
+
+static void send_chunk(TunnelCompressor& compressor, Transcript* transcript, const std::string& chunk) {
+    size_t before = transcript->coded.size();
+    CHECK(compressor.compress(chunk.data(), chunk.size(), &transcript->coded));
+    transcript->plain += chunk;
+
+    // Her parça Z_SYNC_FLUSH ile bittiği için o ana kadarki akış tek başına çözülebilir
+    TunnelDecompressor partial;
+    std::string out;
+    CHECK(partial.decompress(transcript->coded.data(), transcript->coded.size(), &out));
+    CHECK(out == transcript->plain);
+    CHECK(transcript->coded.size() > before);
+}
+
+static void wait_window() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(COMPRESSION_WINDOW_MS + 20));
+}
+
+// Gönderim beklerken seviye 1 -> 3 -> 6 artar, bağlantı yetişince azalır; akış her adımda geçerli kalır
+static void test_adaptive_level_switches() {
+    TunnelCompressor compressor;
+    Transcript transcript;
+    CHECK(compressor.level() == COMPRESSION_LEVELS[0]);
+    send_chunk(compressor, &transcript, framebuffer_chunk(32 * 1024, 1)); // Pencere başlar
+
+    std::vector<int> levels;
+    compressor.note_blocked(true); // Bağlantı darboğaz
+    for (int i = 0; i < 3; ++i) {
+        wait_window();
+        send_chunk(compressor, &transcript, framebuffer_chunk(32 * 1024, 2 + i));
+        levels.push_back(compressor.level());
+    }
+    CHECK(levels == std::vector<int>({3, 6, 6})); // En yüksek seviyede kalır
+
+    compressor.note_blocked(false); // Bağlantı yetişiyor
+    for (int i = 0; i < 3; ++i) {
+        wait_window();
+        send_chunk(compressor, &transcript, framebuffer_chunk(32 * 1024, 10 + i));
+        levels.push_back(compressor.level());
+    }
+    CHECK(levels == std::vector<int>({3, 6, 6, 3, 1, 1}));
+    CHECK(compressor.stats().level_changes == 4);
+    CHECK(compressor.stats().bytes_in == transcript.plain.size());
+    CHECK(compressor.stats().bytes_out == transcript.coded.size());
+    CHECK(transcript.coded.size() < transcript.plain.size() / 4);
+
+    CHECK(decodes_to(transcript, 1));
+    CHECK(decodes_to(transcript, 7));
+    CHECK(decodes_to(transcript, 4096));
+}
+
+// Yüksek entropili parçalar saklanan blok (seviye 0) olarak geçer; seviye kendiliğinden geri döner
+static void test_stored_blocks() {
+    std::mt19937 rng(42);
+    TunnelCompressor compressor;
+    Transcript transcript;
+    std::string noise = random_chunk(64 * 1024, rng);
+    CHECK(sample_entropy(noise.data(), noise.size()) > INCOMPRESSIBLE_ENTROPY);
+    CHECK(sample_entropy(framebuffer_chunk(4096, 0).data(), 4096) < INCOMPRESSIBLE_ENTROPY);
+
+    send_chunk(compressor, &transcript, framebuffer_chunk(16 * 1024, 0));
+    send_chunk(compressor, &transcript, noise);
+    send_chunk(compressor, &transcript, framebuffer_chunk(16 * 1024, 5));
+    send_chunk(compressor, &transcript, random_chunk(100, rng)); // Küçük parçalar örneklenmez
+    send_chunk(compressor, &transcript, random_chunk(8 * 1024, rng));
+    send_chunk(compressor, &transcript, "\x05\x00\x01\x02\x03\x04");  // Giriş olayı
+    CHECK(compressor.stats().stored_bytes == noise.size() + 8 * 1024);
+    CHECK(compressor.level() == COMPRESSION_LEVELS[0]);
+    CHECK(compressor.stats().level_changes == 0);
+    CHECK(decodes_to(transcript, 3));
+    CHECK(decodes_to(transcript, 65536));
+}
+
+// Sabit seviyeler (ölçüm kipi) ve bozuk akış
+static void test_fixed_levels_and_corruption() {
+    for (int level : {0, 1, 6, 9}) {
+        TunnelCompressor compressor(level);
+        Transcript transcript;
+        for (unsigned i = 0; i < 4; ++i) send_chunk(compressor, &transcript, framebuffer_chunk(10000 + i, i));
+        CHECK(compressor.level() == level);
+        CHECK(decodes_to(transcript, 1000));
+        if (level == 0) {
+            CHECK(transcript.coded.size() > transcript.plain.size());
+        } else {
+            CHECK(transcript.coded.size() < transcript.plain.size() / 4);
+        }
+    }
+
+    TunnelDecompressor decompressor;
+    std::string out;
+    const char garbage[] = "\xff\xff\xff\xff\xff\xff\xff\xff";
+    CHECK(!decompressor.decompress(garbage, sizeof(garbage) - 1, &out));
+}
+
+int main() {
+    test_adaptive_level_switches();
+    test_stored_blocks();
+    test_fixed_levels_and_corruption();
+    return test::finish("tunnel_compression");
+}
@@ -0,0 +1,188 @@
+// TunnelSession: iki yönde aktarım (splice ve kopyalama yolu), su işaretleriyle okuma durdurma,
+// kopan ucun geri sarılarak devam ettirilmesi, kapanış
+
+#include "tunnel_session.h"
+#include "test_common.h"
+
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static std::string pattern(size_t offset, size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i) data[i] = (char)((offset + i) % 251);
+    return data;
+}
+
+// Uç: relay tarafındaki soketi tutan ClientInfo ve testin istemci rolündeki karşı soketi
+struct Endpoint {
+    ClientInfo info;
+    int peer = -1;
+
+    explicit Endpoint(ClientId id) {
+        info.id = id;
+        info.status = ClientStatus::VncTunnelling;
+        connect();
+    }
+    ~Endpoint() {
+        if (info.socket_fd >= 0) ::close(info.socket_fd);
+        if (peer >= 0) ::close(peer);
+    }
+
+    void connect() {
+        int fds[2];
+        CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        info.socket_fd = fds[0];
+        peer = fds[1];
+    }
+    void disconnect() {
+        ::close(info.socket_fd);
+        ::close(peer);
+        info.socket_fd = peer = -1;
+    }
+};
+
+// Soketin o an kabul ettiği kadarını yazar
+static size_t write_some(int fd, const std::string& data) {
+    ssize_t n = ::write(fd, data.data(), data.size());
+    return n > 0 ? (size_t)n : 0;
+}
+
+// Sokette bekleyen tüm veriyi okur
+static std::string read_available(int fd) {
+    std::string out;
+    char chunk[16384];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) out.append(chunk, n);
+    return out;
+}
+
+// Küçük yükler iki yönde de sırası bozulmadan karşıya geçer; kaynak kapanınca forward_from false döner
+static void test_forward(bool use_splice) {
+    EventLoop loop;
+    Endpoint a(100001), b(100002);
+    TunnelSession session(loop, a.info, b.info, use_splice);
+
+    std::string up = pattern(0, 5000), down = pattern(7, 3000);
+    CHECK(write_some(a.peer, up) == up.size());
+    CHECK(session.forward_from(a.info));
+    CHECK(read_available(b.peer) == up);
+    CHECK(write_some(b.peer, down) == down.size());
+    CHECK(session.forward_from(b.info));
+    CHECK(read_available(a.peer) == down);
+    CHECK(session.received_from(a.info) == up.size());
+    CHECK(session.received_from(b.info) == down.size());
+    CHECK(session.pending_bytes_to(b.info) == 0);
+    CHECK(&session.peer_of(a.info) == &b.info);
+
+    ::shutdown(a.peer, SHUT_WR);
+    CHECK(!session.forward_from(a.info));
+    session.close();
+}
+
+// Alıcı okumazken bekleyen veri high_watermark'a ulaşınca kaynak durdurulur; alıcı okudukça
+// low_watermark'ın altına inildiğinde okuma sürer ve veri eksiksiz, sırayla ulaşır
+static void test_watermarks(bool use_splice) {
+    EventLoop loop;
+    Endpoint a(100003), b(100004);
+    TunnelLimits limits;
+    limits.high_watermark = 64 * 1024;
+    limits.low_watermark = 16 * 1024;
+    TunnelSession session(loop, a.info, b.info, use_splice, limits);
+
+    const size_t total = 4 * 1024 * 1024;
+    size_t written = 0;
+    std::string received;
+    for (int round = 0; round < 100000 && received.size() < total; ++round) {
+        if (written < total) written += write_some(a.peer, pattern(written, std::min<size_t>(65536, total - written)));
+        CHECK(session.forward_from(a.info));
+        if (a.info.read_paused) {
+            CHECK(session.pending_bytes_to(b.info) >= limits.low_watermark);
+            CHECK(session.pending_bytes_to(b.info) <= limits.high_watermark);
+            // Alıcı biraz okur; düşük su işaretine inilene kadar okuma durur
+            received += read_available(b.peer);
+            session.on_writable(b.info);
+            CHECK(!a.info.read_paused || session.pending_bytes_to(b.info) > limits.low_watermark);
+        } else if (written == total) {
+            received += read_available(b.peer);
+            session.on_writable(b.info);
+        }
+    }
+    CHECK(received.size() == total);
+    CHECK(received == pattern(0, total));
+    CHECK(session.received_from(a.info) == total);
+}
+
+// Kopan uca giden veri tamponda bekler; uç yeni soketle döndüğünde aldığını bildirdiği konumdan
+// sonrası yeniden gönderilir. İleri veya artık saklanmayan bir konuma geri sarılamaz.
+static void test_reattach() {
+    EventLoop loop;
+    Endpoint a(100005), b(100006);
+    TunnelLimits limits;
+    limits.replay_bytes = 8 * 1024;
+    TunnelSession session(loop, a.info, b.info, true, limits);
+    CHECK(session.resumable());
+
+    std::string first = pattern(0, 20000);
+    CHECK(write_some(a.peer, first) == first.size());
+    CHECK(session.forward_from(a.info));
+    CHECK(read_available(b.peer) == first);
+
+    // b koptu; bu sırada gelen veri b için bekletilir
+    b.disconnect();
+    b.info.status = ClientStatus::Resuming;
+    std::string second = pattern(first.size(), 3000);
+    CHECK(write_some(a.peer, second) == second.size());
+    CHECK(session.forward_from(a.info));
+    CHECK(session.pending_bytes_to(b.info) == second.size());
+
+    b.connect();
+    b.info.status = ClientStatus::VncTunnelling;
+    CHECK(!session.reattach(b.info, first.size() + 1));          // Gönderilmemiş konum
+    CHECK(!session.reattach(b.info, first.size() - 9 * 1024));   // Artık saklanmıyor
+    const size_t resume_at = first.size() - 5000;
+    CHECK(session.reattach(b.info, resume_at));
+    CHECK(session.pending_bytes_to(b.info) == 5000 + second.size());
+    session.on_writable(b.info);
+    CHECK(read_available(b.peer) == pattern(resume_at, 5000 + second.size()));
+    CHECK(session.pending_bytes_to(b.info) == 0);
+}
+
+// Kapanıştan sonra veri aktarılmaz ve durdurulmuş okuma serbest bırakılır
+static void test_close() {
+    EventLoop loop;
+    Endpoint a(100007), b(100008);
+    TunnelLimits limits;
+    limits.high_watermark = 16 * 1024;
+    limits.low_watermark = 4 * 1024;
+    TunnelSession session(loop, a.info, b.info, false, limits);
+
+    int sndbuf = 4096;
+    ::setsockopt(b.info.socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    for (size_t written = 0; !a.info.read_paused && written < 4 * 1024 * 1024;) {
+        written += write_some(a.peer, pattern(written, 65536));
+        CHECK(session.forward_from(a.info));
+    }
+    CHECK(a.info.read_paused);
+
+    session.close();
+    CHECK(!a.info.read_paused);
+    CHECK(session.pending_bytes_to(b.info) == 0);
+    read_available(b.peer);
+    CHECK(session.forward_from(a.info));
+    CHECK(read_available(b.peer).empty());
+}
+
+int main() {
+    test_forward(true);
+    test_forward(false);
+    test_watermarks(true);
+    test_watermarks(false);
+    test_reattach();
+    test_close();
+    return test::finish("tunnel_session");
+}